@@ -36,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/composite_device.h"
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/eager/eager_operation.h"
+#include "tensorflow/core/common_runtime/eager/lazy_op_buffer.h"
 #include "tensorflow/core/distributed_runtime/coordination/coordination_service_error_util.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/graph_debug_info.pb.h"
@@ -779,6 +780,16 @@ void TFE_ContextSetJitCompileRewrite(TFE_Context* ctx, unsigned char enable,
   tensorflow::unwrap(ctx)->SetJitCompileRewrite(enable);
 }
 
+void TFE_ContextSetLazyExecution(TFE_Context* ctx, unsigned char enable,
+                                 int max_pending_ops, TF_Status* status) {
+  tensorflow::EagerContext* context =
+      tensorflow::ContextFromInterface(tensorflow::unwrap(ctx));
+  status->status = tensorflow::SetLazyExecution(
+      *context, enable,
+      max_pending_ops > 0 ? max_pending_ops
+                          : tensorflow::LazyOpBuffer::kDefaultMaxPendingOps);
+}
+
 const char* TFE_TensorHandleDeviceType(TFE_TensorHandle* h, TF_Status* status) {
   if (h == nullptr) {
     status->status = tensorflow::errors::InvalidArgument("Invalid handle");
@@ -707,6 +707,17 @@ TF_CAPI_EXPORT void TFE_ContextSetJitCompileRewrite(TFE_Context* ctx,
                                                     unsigned char enable,
                                                     TF_Status* status);
 
+// Enables lazy execution of eager ops: consecutive ops that can be deferred
+// are recorded and run as a single function once one of their outputs is
+// needed, or after `max_pending_ops` ops. If `max_pending_ops` is not
+// positive, a default is used. The ops recorded so far are run when this is
+// called, and `status` is set to their status. Ops executing concurrently
+// with this call may still be deferred by the previous setting.
+TF_CAPI_EXPORT extern void TFE_ContextSetLazyExecution(TFE_Context* ctx,
+                                                       unsigned char enable,
+                                                       int max_pending_ops,
+                                                       TF_Status* status);
+
 // Returns the device type of the operation that produced `h`.
 TF_CAPI_EXPORT extern const char* TFE_TensorHandleDeviceType(
     TFE_TensorHandle* h, TF_Status* status);
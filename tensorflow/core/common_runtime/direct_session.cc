@@ -364,6 +364,12 @@ DirectSession::DirectSession(const SessionOptions& options,
   if (!status.ok()) {
     LOG(ERROR) << status.message();
   }
+  const Status priority_status =
+      ReadBoolFromEnvVar("TF_EXECUTOR_PRIORITIZE_CRITICAL_PATH", false,
+                         &prioritize_critical_path_);
+  if (!priority_status.ok()) {
+    LOG(ERROR) << priority_status.message();
+  }
   session_handle_ =
       strings::StrCat("direct", strings::FpToString(random::New64()));
   if (options.config.log_device_placement()) {
@@ -1398,6 +1404,7 @@ Status DirectSession::CreateExecutors(
     params.device = device;
     params.session_metadata = session_metadata;
     params.function_library = lib;
+    params.prioritize_critical_path = prioritize_critical_path_;
     auto opseg = device->op_segment();
     params.create_kernel =
         [this, lib, opseg](const std::shared_ptr<const NodeProperties>& props,
@@ -355,6 +355,10 @@ class DirectSession : public Session {
   // If true, blocks until device has finished all queued operations in a step.
   bool sync_on_finish_ = true;
 
+  // If true, executors dispatch ready nodes by decreasing critical path
+  // length. See `LocalExecutorParams::prioritize_critical_path`.
+  bool prioritize_critical_path_ = false;
+
   std::vector<std::unique_ptr<FunctionInfo>> functions_
       TF_GUARDED_BY(executor_lock_);
 
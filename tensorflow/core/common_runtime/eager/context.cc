@@ -619,6 +619,9 @@ EagerContext::~EagerContext() {
   // don't send RPCs and block in destructor.
   WaitForAndCloseRemoteContexts();
 
+  // Poisons the outputs of the ops still deferred by lazy execution.
+  SetDeferredOps(nullptr);
+
   // Custom devices may have obtained references to various context components
   // (executors, thread pool). It's safer to run their destructors early.
   custom_device_op_handler_.Clear();
@@ -1162,6 +1165,10 @@ Status EagerContext::RemoveFunction(const string& func) {
 Status EagerContext::SyncExecutors() {
   VLOG(6) << "Calling SyncExecutors";
   StatusGroup sg;
+  if (std::shared_ptr<DeferredEagerOps> deferred_ops = GetDeferredOps();
+      deferred_ops != nullptr) {
+    sg.Update(deferred_ops->Flush());
+  }
   // Synchronize on context default executor
   sg.Update(default_executor_.WaitForAllPendingNodes());
   default_executor_.ClearError();
@@ -79,6 +79,27 @@ namespace eager {
 class RemoteMgr;
 }  // namespace eager
 
+class EagerOperation;
+class TensorHandle;
+
+// Eager ops whose execution was deferred by lazy execution. They are recorded
+// and run by the execute library (see `LazyOpBuffer`), which itself depends on
+// the context.
+class DeferredEagerOps {
+ public:
+  virtual ~DeferredEagerOps() = default;
+
+  // Defers `op` if it can be, in which case `retvals` and `*num_retvals` are
+  // set to its non-ready outputs and `*recorded` is true. Otherwise, runs the
+  // deferred ops, since `op` may consume their outputs, and sets `*recorded`
+  // to false so that the caller executes `op`.
+  virtual Status MaybeRecord(EagerOperation* op, TensorHandle** retvals,
+                             int* num_retvals, bool* recorded) = 0;
+
+  // Runs all the deferred ops. Their outputs are poisoned if they fail.
+  virtual Status Flush() = 0;
+};
+
 // Check the value of the environment variable,
 // `TF_REMOTE_HANDLE_SKIP_WAIT_FOR_READY` from its cached copy in memory and if
 // not cached, reads from the environment variable.
@@ -155,6 +176,23 @@ class EagerContext : public ImmediateExecutionContext, public core::RefCounted {
 
   void SetJitCompileRewrite(bool enable) override;
 
+  // The ops deferred by lazy execution, or nullptr if lazy execution is
+  // disabled. Use `SetLazyExecution` in lazy_op_buffer.h to change it. Callers
+  // share ownership of the returned object, so it stays alive while they use
+  // it even if lazy execution is concurrently disabled.
+  std::shared_ptr<DeferredEagerOps> GetDeferredOps() const {
+    tf_shared_lock l(deferred_ops_mu_);
+    return deferred_ops_;
+  }
+  // Replaces the deferred ops and returns the previous ones, which are
+  // destroyed once their last user releases them.
+  std::shared_ptr<DeferredEagerOps> SetDeferredOps(
+      std::shared_ptr<DeferredEagerOps> deferred_ops) {
+    mutex_lock l(deferred_ops_mu_);
+    std::swap(deferred_ops_, deferred_ops);
+    return deferred_ops;
+  }
+
   void ListDevices(std::vector<DeviceAttributes>* device_attributes) override;
 
   Status AddDevices(std::vector<std::unique_ptr<Device>> devices) override;
@@ -271,8 +309,9 @@ class EagerContext : public ImmediateExecutionContext, public core::RefCounted {
   Status AddRemoveFunctionNotifier(const string& func,
                                    std::function<void()> notifier) override;
 
-  // Wait for pending nodes to be finished in local executors (including context
-  // default executor and thread executors) and executors on remote workers.
+  // Run the ops deferred by lazy execution, and wait for pending nodes to be
+  // finished in local executors (including context default executor and thread
+  // executors) and executors on remote workers.
   // Return combined status of remote executors. If there are multiple errors,
   // the Status code will be the same as the first remote executor that has
   // errors, and the error message will be combined from all executors.
@@ -899,6 +938,9 @@ class EagerContext : public ImmediateExecutionContext, public core::RefCounted {
   std::function<void()> resource_deallocator_ = nullptr;
   bool run_eager_op_as_function_;
   bool jit_compile_rewrite_;
+  mutable mutex deferred_ops_mu_;
+  std::shared_ptr<DeferredEagerOps> deferred_ops_
+      TF_GUARDED_BY(deferred_ops_mu_);
 
   // Controls the behavior of
   // `EagerContext::RegisterFunction(AbstractFunction*)` in distributed
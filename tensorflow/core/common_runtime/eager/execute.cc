@@ -2142,6 +2142,18 @@ Status DoEagerExecute(EagerOperation* op, TensorHandle** retvals,
     op->Executor().ClearError();
   }
 
+  // With lazy execution, the op is recorded instead of executed if possible.
+  if (std::shared_ptr<DeferredEagerOps> deferred_ops =
+          op->EagerContext().GetDeferredOps();
+      deferred_ops != nullptr) {
+    bool recorded;
+    TF_RETURN_IF_ERROR(
+        deferred_ops->MaybeRecord(op, retvals, num_retvals, &recorded));
+    if (recorded) {
+      return absl::OkStatus();
+    }
+  }
+
   std::unique_ptr<tensorflow::EagerOperation> out_op;
   TF_RETURN_IF_ERROR(EagerOpRewriteRegistry::Global()->RunRewrite(
       EagerOpRewriteRegistry::PRE_EXECUTION, op, &out_op));
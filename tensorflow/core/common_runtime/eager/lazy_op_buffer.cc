@@ -0,0 +1,380 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/eager/lazy_op_buffer.h"
+
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/inlined_vector.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/c/eager/abstract_operation.h"
+#include "tensorflow/core/common_runtime/eager/context.h"
+#include "tensorflow/core/common_runtime/eager/eager_operation.h"
+#include "tensorflow/core/common_runtime/eager/execute.h"
+#include "tensorflow/core/common_runtime/eager/tensor_handle.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/function.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/op_def.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/casts.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+
+namespace tensorflow {
+namespace {
+
+// Prefix of the names of the functions running recorded ops.
+constexpr char kLazyFunctionPrefix[] = "__lazy_eager_ops_";
+
+bool IsRecordableType(DataType dtype) {
+  return !IsRefType(dtype) && dtype != DT_RESOURCE && dtype != DT_VARIANT;
+}
+
+bool IsHostCpuOnly(EagerContext& ctx) {
+  for (const Device* device : ctx.ListLocalTfDevices()) {
+    if (device->device_type() != DEVICE_CPU) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+LazyOpBuffer::LazyOpBuffer(EagerContext& ctx, int max_pending_ops,
+                           int max_cached_functions)
+    : ctx_(ctx),
+      max_pending_ops_(max_pending_ops),
+      max_cached_functions_(max_cached_functions),
+      host_cpu_only_(IsHostCpuOnly(ctx)) {}
+
+LazyOpBuffer::~LazyOpBuffer() {
+  mutex_lock l(mu_);
+  Release(errors::Cancelled("Lazy eager execution was disabled before the "
+                            "op could run."),
+          fragment_);
+}
+
+Status LazyOpBuffer::MaybeRecord(EagerOperation* op, TensorHandle** retvals,
+                                 int* num_retvals, bool* recorded) {
+  *recorded = false;
+  const absl::InlinedVector<TensorHandle*, 4>* inputs;
+  DataTypeVector output_types;
+  if (op->OpDef() != nullptr && op->TensorHandleInputs(&inputs).ok() &&
+      OutputTypesForNode(op->MutableAttrs()->BuildNodeDef(), *op->OpDef(),
+                         &output_types)
+          .ok() &&
+      static_cast<int>(output_types.size()) <= *num_retvals) {
+    mutex_lock l(mu_);
+    if (CanRecord(op, *inputs, output_types)) {
+      TF_RETURN_IF_ERROR(Record(op, *inputs, output_types, retvals));
+      *num_retvals = output_types.size();
+      *recorded = true;
+    }
+  }
+  if (*recorded) {
+    // Like executing the op would, releases its inputs.
+    op->Clear();
+    if (num_pending_ops() < max_pending_ops_) {
+      return absl::OkStatus();
+    }
+  }
+  // The errors of the recorded ops are reported through their outputs.
+  Flush().IgnoreError();
+  return absl::OkStatus();
+}
+
+Status LazyOpBuffer::Flush() {
+  Fragment fragment;
+  {
+    mutex_lock l(mu_);
+    if (fragment_.nodes.empty()) {
+      return absl::OkStatus();
+    }
+    std::swap(fragment, fragment_);
+  }
+  tsl::profiler::TraceMe activity(
+      [&] {
+        return absl::StrCat("LazyOpBuffer::Flush#num_ops=",
+                            fragment.nodes.size(), "#");
+      },
+      tsl::profiler::TraceMeLevel::kInfo);
+  const Status status = Run(fragment);
+  Release(status, fragment);
+  return status;
+}
+
+int LazyOpBuffer::num_pending_ops() const {
+  tf_shared_lock l(mu_);
+  return fragment_.nodes.size();
+}
+
+int LazyOpBuffer::num_cached_functions() const {
+  tf_shared_lock l(functions_mu_);
+  return functions_.size();
+}
+
+bool LazyOpBuffer::CanRecord(
+    EagerOperation* op, const absl::InlinedVector<TensorHandle*, 4>& inputs,
+    const DataTypeVector& output_types) const {
+  if (!op->IsLocal() || op->is_function() || op->Executor().Async() ||
+      op->OpDef()->is_stateful()) {
+    return false;
+  }
+  if (op->DeviceName().empty() ? !host_cpu_only_
+                               : op->DeviceName() != ctx_.HostCPUName()) {
+    return false;
+  }
+  for (const TensorHandle* input : inputs) {
+    if (!IsRecordableType(input->DataType())) {
+      return false;
+    }
+    if (fragment_.output_indices.contains(input)) {
+      continue;
+    }
+    // Other inputs become arguments of the function, and must be ready host
+    // tensors.
+    if (input->Type() != TensorHandle::LOCAL || input->device() != nullptr ||
+        !input->IsReady()) {
+      return false;
+    }
+  }
+  for (const DataType dtype : output_types) {
+    if (!IsRecordableType(dtype)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Status LazyOpBuffer::Record(EagerOperation* op,
+                            const absl::InlinedVector<TensorHandle*, 4>& inputs,
+                            const DataTypeVector& output_types,
+                            TensorHandle** retvals) {
+  const OpDef& op_def = *op->OpDef();
+  NodeDef node_def = op->MutableAttrs()->BuildNodeDef();
+  NameRangeMap output_ranges;
+  TF_RETURN_IF_ERROR(
+      NameRangesForNode(node_def, op_def, nullptr, &output_ranges));
+
+  node_def.set_name(absl::StrCat("op", fragment_.nodes.size()));
+  node_def.clear_input();
+  for (TensorHandle* input : inputs) {
+    auto output_it = fragment_.output_indices.find(input);
+    if (output_it != fragment_.output_indices.end()) {
+      node_def.add_input(fragment_.outputs[output_it->second].tensor_name);
+      continue;
+    }
+    auto [arg_it, inserted] =
+        fragment_.arg_indices.try_emplace(input, fragment_.args.size());
+    if (inserted) {
+      input->Ref();
+      fragment_.args.push_back(input);
+    }
+    node_def.add_input(absl::StrCat("arg", arg_it->second));
+  }
+
+  for (const OpDef::ArgDef& output_arg : op_def.output_arg()) {
+    const auto [start, limit] = output_ranges.at(output_arg.name());
+    for (int i = start; i < limit; ++i) {
+      TensorHandle* handle = TensorHandle::CreateLazyLocalHandle(
+          /*d=*/ctx_.HostCPU(), /*op_device=*/ctx_.HostCPU(),
+          /*resource_device=*/nullptr, output_types[i],
+          // The buffer may be destroyed before the handle is waited on, in
+          // which case it has already poisoned the handle.
+          [buffer = weak_from_this()] {
+            if (std::shared_ptr<LazyOpBuffer> locked = buffer.lock()) {
+              locked->Flush().IgnoreError();
+            }
+          },
+          &ctx_);
+      // One reference for the caller, one to set the tensor.
+      handle->Ref();
+      fragment_.output_indices[handle] = fragment_.outputs.size();
+      fragment_.outputs.push_back(
+          {handle,
+           absl::StrCat(node_def.name(), ":", output_arg.name(), ":",
+                        i - start)});
+      retvals[i] = handle;
+    }
+  }
+  fragment_.nodes.push_back(std::move(node_def));
+  return absl::OkStatus();
+}
+
+Status LazyOpBuffer::Run(const Fragment& fragment) {
+  FunctionDef fdef;
+  OpDef* signature = fdef.mutable_signature();
+  for (int i = 0, end = fragment.args.size(); i < end; ++i) {
+    OpDef::ArgDef* arg = signature->add_input_arg();
+    arg->set_name(absl::StrCat("arg", i));
+    arg->set_type(fragment.args[i]->DataType());
+  }
+  // Outputs only referenced by the buffer were dropped by the caller, and are
+  // not returned so that grappler can prune or fuse their producers.
+  std::vector<TensorHandle*> returned;
+  for (const PendingOutput& output : fragment.outputs) {
+    if (output.handle->RefCountIsOne()) {
+      continue;
+    }
+    const std::string ret_name = absl::StrCat("ret", returned.size());
+    OpDef::ArgDef* ret = signature->add_output_arg();
+    ret->set_name(ret_name);
+    ret->set_type(output.handle->DataType());
+    (*fdef.mutable_ret())[ret_name] = output.tensor_name;
+    returned.push_back(output.handle);
+  }
+  if (returned.empty()) {
+    // The recorded ops are stateless, so there is nothing to run.
+    return absl::OkStatus();
+  }
+  for (const NodeDef& node_def : fragment.nodes) {
+    *fdef.add_node_def() = node_def;
+  }
+
+  // Names the function after its structure, so that repeated sequences of ops
+  // share the function and its cached kernel.
+  const std::string function_name =
+      absl::StrCat(kLazyFunctionPrefix, FunctionDefHash(fdef));
+  signature->set_name(function_name);
+  TF_RETURN_IF_ERROR(AcquireFunction(fdef));
+  std::vector<TensorHandle*> retvals(returned.size());
+  int num_retvals = retvals.size();
+  Status status = [&]() -> Status {
+    AbstractOperationPtr call_op(ctx_.CreateOperation());
+    TF_RETURN_IF_ERROR(
+        call_op->Reset(function_name.c_str(), ctx_.HostCPUName().c_str()));
+    for (TensorHandle* arg : fragment.args) {
+      TF_RETURN_IF_ERROR(call_op->AddInput(arg));
+    }
+    return EagerExecute(down_cast<EagerOperation*>(call_op.get()),
+                        retvals.data(), &num_retvals);
+  }();
+  ReleaseFunction(function_name);
+  TF_RETURN_IF_ERROR(status);
+  for (int i = 0; i < num_retvals; ++i) {
+    const Tensor* tensor;
+    Status s = retvals[i]->Tensor(&tensor);
+    if (s.ok()) {
+      s = returned[i]->SetTensor(Tensor(*tensor), returned[i]->device());
+    }
+    status.Update(s);
+    retvals[i]->Unref();
+  }
+  return status;
+}
+
+Status LazyOpBuffer::AcquireFunction(const FunctionDef& fdef) {
+  const std::string& function_name = fdef.signature().name();
+  mutex_lock l(functions_mu_);
+  auto it = functions_.find(function_name);
+  if (it != functions_.end()) {
+    function_lru_.splice(function_lru_.begin(), function_lru_,
+                         it->second.lru_position);
+    ++it->second.num_running;
+    return absl::OkStatus();
+  }
+  // The function may have been registered by an earlier buffer of the
+  // context, in which case it is adopted.
+  const FunctionDef* existing_fdef = ctx_.GetFunctionDef(function_name);
+  if (existing_fdef == nullptr) {
+    TF_RETURN_IF_ERROR(ctx_.AddFunctionDef(fdef));
+  } else if (!FunctionDefsEqual(*existing_fdef, fdef)) {
+    return errors::Internal("Lazily executed ops collide with function ",
+                            function_name);
+  }
+  function_lru_.push_front(function_name);
+  functions_.emplace(function_name,
+                     CachedFunction{function_lru_.begin(), /*num_running=*/1});
+
+  auto victim = function_lru_.end();
+  while (static_cast<int>(functions_.size()) > max_cached_functions_ &&
+         victim != function_lru_.begin()) {
+    --victim;
+    auto victim_it = functions_.find(*victim);
+    if (victim_it->second.num_running > 0) {
+      continue;
+    }
+    // Also drops the kernel cached for the function.
+    const Status s = ctx_.RemoveFunction(*victim);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to remove lazily executed function " << *victim
+                   << ": " << s;
+    }
+    functions_.erase(victim_it);
+    victim = function_lru_.erase(victim);
+  }
+  return absl::OkStatus();
+}
+
+void LazyOpBuffer::ReleaseFunction(const std::string& function_name) {
+  mutex_lock l(functions_mu_);
+  auto it = functions_.find(function_name);
+  DCHECK(it != functions_.end());
+  --it->second.num_running;
+}
+
+/*static*/ void LazyOpBuffer::Release(const Status& status,
+                                      Fragment& fragment) {
+  for (TensorHandle* arg : fragment.args) {
+    arg->Unref();
+  }
+  for (const PendingOutput& output : fragment.outputs) {
+    if (!output.handle->IsReady()) {
+      output.handle->Poison(
+          status.ok() ? errors::Internal("Lazily executed op was not run.")
+                      : status,
+          output.handle->device());
+    }
+    output.handle->Unref();
+  }
+  fragment = Fragment();
+}
+
+Status SetLazyExecution(EagerContext& ctx, bool enabled, int max_pending_ops,
+                        int max_cached_functions) {
+  if (enabled && max_pending_ops <= 0) {
+    return errors::InvalidArgument(
+        "max_pending_ops must be positive for lazy execution; got ",
+        max_pending_ops);
+  }
+  if (enabled && max_cached_functions <= 0) {
+    return errors::InvalidArgument(
+        "max_cached_functions must be positive for lazy execution; got ",
+        max_cached_functions);
+  }
+  // Ops executing concurrently keep using the previous buffer until they are
+  // done with it, so its ops are flushed after it is replaced.
+  std::shared_ptr<DeferredEagerOps> previous =
+      ctx.SetDeferredOps(enabled ? std::make_shared<LazyOpBuffer>(
+                                       ctx, max_pending_ops,
+                                       max_cached_functions)
+                                 : nullptr);
+  if (previous == nullptr) {
+    return absl::OkStatus();
+  }
+  return previous->Flush();
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,165 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_EAGER_LAZY_OP_BUFFER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_EAGER_LAZY_OP_BUFFER_H_
+
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
+#include "tensorflow/core/common_runtime/eager/context.h"
+#include "tensorflow/core/common_runtime/eager/eager_operation.h"
+#include "tensorflow/core/common_runtime/eager/tensor_handle.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// Records consecutive eager ops instead of executing them one at a time, and
+// runs them as a single function when their results are needed. This trades
+// the per-op kernel lookup and dispatch of many small ops for one function
+// call, and lets grappler optimize the ops together: outputs that were only
+// consumed by other recorded ops are not returned by the function, so their
+// producers can be fused or pruned.
+//
+// Ops are recorded while they are local, stateless, placed on the host CPU,
+// run by a sync executor, and take and produce neither references, resources
+// nor variants. The recorded ops are run (flushed) when:
+//   - one of their outputs is waited on, e.g. to read its value or shape,
+//   - an op that can't be recorded is executed,
+//   - `max_pending_ops` ops are pending,
+//   - `EagerContext::SyncExecutors` is called.
+// Errors are reported through the outputs of the failed ops, like in async
+// mode. The functions are registered with the context under a name derived
+// from the structure of the recorded ops, so that repeated sequences of ops
+// reuse the same function and kernel. At most `max_cached_functions` of them
+// stay registered; the least recently run ones are removed from the context
+// beyond that.
+class LazyOpBuffer : public DeferredEagerOps,
+                     public std::enable_shared_from_this<LazyOpBuffer> {
+ public:
+  static constexpr int kDefaultMaxPendingOps = 256;
+  static constexpr int kDefaultMaxCachedFunctions = 64;
+
+  LazyOpBuffer(EagerContext& ctx, int max_pending_ops,
+               int max_cached_functions);
+  ~LazyOpBuffer() override;
+
+  LazyOpBuffer(const LazyOpBuffer&) = delete;
+  LazyOpBuffer& operator=(const LazyOpBuffer&) = delete;
+
+  Status MaybeRecord(EagerOperation* op, TensorHandle** retvals,
+                     int* num_retvals, bool* recorded) override;
+
+  Status Flush() override;
+
+  // Returns the number of recorded ops which were not flushed yet.
+  int num_pending_ops() const;
+
+  // Returns the number of functions registered by the buffer.
+  int num_cached_functions() const;
+
+ private:
+  // An output of a recorded op.
+  struct PendingOutput {
+    // Holds a reference until the output is set or poisoned.
+    TensorHandle* handle;
+    // The name of the output in the body of the function.
+    std::string tensor_name;
+  };
+
+  // The recorded ops, and the inputs and outputs of the function running them.
+  struct Fragment {
+    std::vector<NodeDef> nodes;
+    // Hold a reference until the fragment is run.
+    std::vector<TensorHandle*> args;
+    absl::flat_hash_map<const TensorHandle*, int> arg_indices;
+    std::vector<PendingOutput> outputs;
+    absl::flat_hash_map<const TensorHandle*, int> output_indices;
+  };
+
+  // Returns true if `op` can be recorded in `fragment_`, whose outputs may be
+  // inputs of `op`.
+  bool CanRecord(EagerOperation* op,
+                 const absl::InlinedVector<TensorHandle*, 4>& inputs,
+                 const DataTypeVector& output_types) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Adds `op` to `fragment_` and creates its outputs.
+  Status Record(EagerOperation* op,
+                const absl::InlinedVector<TensorHandle*, 4>& inputs,
+                const DataTypeVector& output_types, TensorHandle** retvals)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // A function registered with the context to run recorded ops.
+  struct CachedFunction {
+    // The position of the function's name in `function_lru_`.
+    std::list<std::string>::iterator lru_position;
+    // The number of calls of the function in progress. The function is only
+    // removed from the context when there is none.
+    int num_running = 0;
+  };
+
+  // Runs the ops of `fragment` as a function and sets the outputs.
+  Status Run(const Fragment& fragment);
+
+  // Registers `fdef` with the context unless it already is, and marks it as
+  // running until `ReleaseFunction` is called. Removes the least recently run
+  // functions that are not running beyond `max_cached_functions_`.
+  Status AcquireFunction(const FunctionDef& fdef)
+      TF_LOCKS_EXCLUDED(functions_mu_);
+  void ReleaseFunction(const std::string& function_name)
+      TF_LOCKS_EXCLUDED(functions_mu_);
+
+  // Releases the references held by `fragment` and clears it, poisoning the
+  // outputs that were not set with `status`.
+  static void Release(const Status& status, Fragment& fragment);
+
+  EagerContext& ctx_;
+  const int max_pending_ops_;
+  const int max_cached_functions_;
+  // True if all local devices are CPUs, so that ops with no requested device
+  // are placed on the host CPU.
+  const bool host_cpu_only_;
+
+  mutable mutex mu_;
+  Fragment fragment_ TF_GUARDED_BY(mu_);
+
+  mutable mutex functions_mu_;
+  absl::flat_hash_map<std::string, CachedFunction> functions_
+      TF_GUARDED_BY(functions_mu_);
+  // Names of `functions_`, most recently run first.
+  std::list<std::string> function_lru_ TF_GUARDED_BY(functions_mu_);
+};
+
+// Enables lazy execution of the eager ops of `ctx` (see `LazyOpBuffer`) if
+// `enabled` is true, and disables it otherwise. The ops recorded so far are
+// run, and their status returned. Ops executing concurrently may still be
+// recorded by the previous buffer, which runs them when they are waited on, or
+// cancels them if it is destroyed first.
+Status SetLazyExecution(
+    EagerContext& ctx, bool enabled,
+    int max_pending_ops = LazyOpBuffer::kDefaultMaxPendingOps,
+    int max_cached_functions = LazyOpBuffer::kDefaultMaxCachedFunctions);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_EAGER_LAZY_OP_BUFFER_H_
@@ -0,0 +1,265 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/eager/lazy_op_buffer.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/eager/context.h"
+#include "tensorflow/core/common_runtime/eager/eager_operation.h"
+#include "tensorflow/core/common_runtime/eager/execute.h"
+#include "tensorflow/core/common_runtime/eager/tensor_handle.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+class LazyOpBufferTest : public ::testing::Test {
+ protected:
+  LazyOpBufferTest()
+      : device_mgr_(DeviceFactory::NewDevice(
+            "CPU", {}, "/job:localhost/replica:0/task:0")),
+        ctx_(new EagerContext(
+            SessionOptions(),
+            ContextDevicePlacementPolicy::DEVICE_PLACEMENT_SILENT,
+            /*async=*/false, &device_mgr_, /*device_mgr_owned=*/false,
+            /*rendezvous=*/nullptr, /*cluster_flr=*/nullptr)) {}
+
+  ~LazyOpBufferTest() override { ctx_->Unref(); }
+
+  LazyOpBuffer& lazy_ops() {
+    return *down_cast<LazyOpBuffer*>(ctx_->GetDeferredOps().get());
+  }
+
+  core::RefCountPtr<TensorHandle> Scalar(int64_t value) {
+    return core::RefCountPtr<TensorHandle>(TensorHandle::CreateLocalHandle(
+        test::AsScalar<int64_t>(value), /*d=*/ctx_->HostCPU(),
+        /*op_device=*/nullptr, ctx_));
+  }
+
+  // Executes the single output op `op_name` on `inputs`.
+  core::RefCountPtr<TensorHandle> Execute(
+      const char* op_name, const std::vector<TensorHandle*>& inputs) {
+    EagerOperation op(ctx_);
+    TF_CHECK_OK(op.Reset(op_name, /*raw_device_name=*/nullptr));
+    for (TensorHandle* input : inputs) {
+      TF_CHECK_OK(op.AddInput(input));
+    }
+    TensorHandle* retval = nullptr;
+    int num_retvals = 1;
+    TF_CHECK_OK(EagerExecute(&op, &retval, &num_retvals));
+    return core::RefCountPtr<TensorHandle>(retval);
+  }
+
+  int NumLazyFunctions() {
+    int num_functions = 0;
+    for (const string& name : ctx_->ListFunctionNames()) {
+      if (absl::StartsWith(name, "__lazy_eager_ops_")) {
+        ++num_functions;
+      }
+    }
+    return num_functions;
+  }
+
+  StaticDeviceMgr device_mgr_;
+  EagerContext* ctx_;
+};
+
+TEST_F(LazyOpBufferTest, RunsOpsWhenOutputIsRead) {
+  TF_ASSERT_OK(SetLazyExecution(*ctx_, true));
+  auto x = Scalar(3);
+  auto y = Scalar(4);
+  auto product = Execute("Mul", {x.get(), y.get()});
+  auto sum = Execute("AddV2", {product.get(), x.get()});
+  EXPECT_FALSE(product->IsReady());
+  EXPECT_FALSE(sum->IsReady());
+  EXPECT_EQ(lazy_ops().num_pending_ops(), 2);
+
+  const Tensor* tensor;
+  TF_ASSERT_OK(sum->Tensor(&tensor));
+  test::ExpectEqual(*tensor, test::AsScalar<int64_t>(15));
+  TF_ASSERT_OK(product->Tensor(&tensor));
+  test::ExpectEqual(*tensor, test::AsScalar<int64_t>(12));
+  EXPECT_EQ(lazy_ops().num_pending_ops(), 0);
+  EXPECT_EQ(NumLazyFunctions(), 1);
+}
+
+TEST_F(LazyOpBufferTest, PrunesDroppedOutputs) {
+  TF_ASSERT_OK(SetLazyExecution(*ctx_, true));
+  auto x = Scalar(3);
+  auto sum = Execute("AddV2", {Execute("Mul", {x.get(), x.get()}).get(),
+                               x.get()});
+  const Tensor* tensor;
+  TF_ASSERT_OK(sum->Tensor(&tensor));
+  test::ExpectEqual(*tensor, test::AsScalar<int64_t>(12));
+
+  const std::vector<string> names = ctx_->ListFunctionNames();
+  for (const string& name : names) {
+    if (absl::StartsWith(name, "__lazy_eager_ops_")) {
+      EXPECT_EQ(ctx_->GetFunctionDef(name)->signature().output_arg_size(), 1);
+    }
+  }
+}
+
+TEST_F(LazyOpBufferTest, ReusesFunctionForSameOps) {
+  TF_ASSERT_OK(SetLazyExecution(*ctx_, true));
+  for (int i = 0; i < 3; ++i) {
+    auto x = Scalar(i);
+    auto product = Execute("Mul", {x.get(), x.get()});
+    const Tensor* tensor;
+    TF_ASSERT_OK(product->Tensor(&tensor));
+    test::ExpectEqual(*tensor, test::AsScalar<int64_t>(i * i));
+  }
+  EXPECT_EQ(NumLazyFunctions(), 1);
+}
+
+TEST_F(LazyOpBufferTest, RemovesLeastRecentlyRunFunctions) {
+  TF_ASSERT_OK(SetLazyExecution(*ctx_, true,
+                                LazyOpBuffer::kDefaultMaxPendingOps,
+                                /*max_cached_functions=*/2));
+  for (const char* op_name : {"Mul", "AddV2", "Sub", "Mul"}) {
+    auto x = Scalar(3);
+    auto result = Execute(op_name, {x.get(), x.get()});
+    const Tensor* tensor;
+    TF_ASSERT_OK(result->Tensor(&tensor));
+  }
+  EXPECT_EQ(lazy_ops().num_cached_functions(), 2);
+  EXPECT_EQ(NumLazyFunctions(), 2);
+
+  auto x = Scalar(3);
+  auto product = Execute("Mul", {x.get(), x.get()});
+  const Tensor* tensor;
+  TF_ASSERT_OK(product->Tensor(&tensor));
+  test::ExpectEqual(*tensor, test::AsScalar<int64_t>(9));
+  EXPECT_EQ(NumLazyFunctions(), 2);
+}
+
+TEST_F(LazyOpBufferTest, RunsOpsWhenFull) {
+  TF_ASSERT_OK(SetLazyExecution(*ctx_, true, /*max_pending_ops=*/2));
+  auto x = Scalar(2);
+  auto square = Execute("Mul", {x.get(), x.get()});
+  EXPECT_EQ(lazy_ops().num_pending_ops(), 1);
+  auto cube = Execute("Mul", {square.get(), x.get()});
+  EXPECT_EQ(lazy_ops().num_pending_ops(), 0);
+  EXPECT_TRUE(square->IsReady());
+  EXPECT_TRUE(cube->IsReady());
+}
+
+TEST_F(LazyOpBufferTest, RunsOpsBeforeStatefulOp) {
+  TF_ASSERT_OK(SetLazyExecution(*ctx_, true));
+  auto shape = core::RefCountPtr<TensorHandle>(TensorHandle::CreateLocalHandle(
+      test::AsTensor<int32_t>({2}), /*d=*/ctx_->HostCPU(),
+      /*op_device=*/nullptr, ctx_));
+  auto doubled_shape = Execute("AddV2", {shape.get(), shape.get()});
+  EXPECT_EQ(lazy_ops().num_pending_ops(), 1);
+
+  EagerOperation op(ctx_);
+  TF_ASSERT_OK(op.Reset("RandomUniform", /*raw_device_name=*/nullptr));
+  TF_ASSERT_OK(op.AddInput(doubled_shape.get()));
+  TF_ASSERT_OK(op.SetAttrType("dtype", DT_FLOAT));
+  TensorHandle* retval = nullptr;
+  int num_retvals = 1;
+  TF_ASSERT_OK(EagerExecute(&op, &retval, &num_retvals));
+  core::RefCountPtr<TensorHandle> random(retval);
+
+  EXPECT_EQ(lazy_ops().num_pending_ops(), 0);
+  EXPECT_TRUE(doubled_shape->IsReady());
+  int64_t num_elements;
+  TF_ASSERT_OK(random->NumElements(&num_elements));
+  EXPECT_EQ(num_elements, 4);
+}
+
+TEST_F(LazyOpBufferTest, ReportsErrorsThroughOutputs) {
+  TF_ASSERT_OK(SetLazyExecution(*ctx_, true));
+  auto x = core::RefCountPtr<TensorHandle>(TensorHandle::CreateLocalHandle(
+      test::AsTensor<int64_t>({1, 2}), /*d=*/ctx_->HostCPU(),
+      /*op_device=*/nullptr, ctx_));
+  auto y = core::RefCountPtr<TensorHandle>(TensorHandle::CreateLocalHandle(
+      test::AsTensor<int64_t>({1, 2, 3}), /*d=*/ctx_->HostCPU(),
+      /*op_device=*/nullptr, ctx_));
+  auto product = Execute("Mul", {x.get(), y.get()});
+
+  const Tensor* tensor;
+  EXPECT_EQ(product->Tensor(&tensor).code(), error::INVALID_ARGUMENT);
+}
+
+TEST_F(LazyOpBufferTest, SyncExecutorsRunsOps) {
+  TF_ASSERT_OK(SetLazyExecution(*ctx_, true));
+  auto x = Scalar(5);
+  auto product = Execute("Mul", {x.get(), x.get()});
+  TF_ASSERT_OK(ctx_->SyncExecutors());
+  EXPECT_TRUE(product->IsReady());
+}
+
+TEST_F(LazyOpBufferTest, DisablingRunsOps) {
+  TF_ASSERT_OK(SetLazyExecution(*ctx_, true));
+  auto x = Scalar(5);
+  auto product = Execute("Mul", {x.get(), x.get()});
+  TF_ASSERT_OK(SetLazyExecution(*ctx_, false));
+  EXPECT_EQ(ctx_->GetDeferredOps(), nullptr);
+  EXPECT_TRUE(product->IsReady());
+}
+
+TEST_F(LazyOpBufferTest, DisablingWhileBufferIsInUse) {
+  TF_ASSERT_OK(SetLazyExecution(*ctx_, true));
+  // An op executing concurrently with disabling keeps the buffer alive.
+  std::shared_ptr<DeferredEagerOps> buffer = ctx_->GetDeferredOps();
+  TF_ASSERT_OK(SetLazyExecution(*ctx_, false));
+  auto x = Scalar(5);
+  auto record_mul = [&]() {
+    EagerOperation op(ctx_);
+    TF_CHECK_OK(op.Reset("Mul", /*raw_device_name=*/nullptr));
+    TF_CHECK_OK(op.AddInput(x.get()));
+    TF_CHECK_OK(op.AddInput(x.get()));
+    TensorHandle* retval = nullptr;
+    int num_retvals = 1;
+    bool recorded;
+    TF_CHECK_OK(buffer->MaybeRecord(&op, &retval, &num_retvals, &recorded));
+    CHECK(recorded);
+    return core::RefCountPtr<TensorHandle>(retval);
+  };
+
+  auto product = record_mul();
+  const Tensor* tensor;
+  TF_ASSERT_OK(product->Tensor(&tensor));
+  test::ExpectEqual(*tensor, test::AsScalar<int64_t>(25));
+
+  // Outputs still pending when the buffer is released are cancelled.
+  auto cancelled = record_mul();
+  buffer.reset();
+  EXPECT_EQ(cancelled->Tensor(&tensor).code(), error::CANCELLED);
+}
+
+TEST_F(LazyOpBufferTest, InvalidMaxPendingOps) {
+  EXPECT_FALSE(SetLazyExecution(*ctx_, true, /*max_pending_ops=*/0).ok());
+}
+
+TEST_F(LazyOpBufferTest, InvalidMaxCachedFunctions) {
+  EXPECT_FALSE(SetLazyExecution(*ctx_, true,
+                                LazyOpBuffer::kDefaultMaxPendingOps,
+                                /*max_cached_functions=*/0)
+                   .ok());
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -16,6 +16,7 @@ limitations under the License.
 
 #include <algorithm>
 #include <cstddef>
+#include <functional>
 #include <map>
 #include <memory>
 #include <queue>
@@ -287,9 +288,18 @@ TensorHandle* TensorHandle::CreateEmptyLocalHandle(Device* d, Device* op_device,
   return new TensorHandle(d, op_device, resource_device, dtype, ctx);
 }
 
+TensorHandle* TensorHandle::CreateLazyLocalHandle(
+    Device* d, Device* op_device, Device* resource_device,
+    tensorflow::DataType dtype, std::function<void()> materialize,
+    EagerContext* ctx) {
+  return new TensorHandle(d, op_device, resource_device, dtype, ctx,
+                          std::move(materialize));
+}
+
 TensorHandle::TensorHandle(Device* d, Device* op_device,
                            Device* resource_device, tensorflow::DataType dtype,
-                           EagerContext* ctx)
+                           EagerContext* ctx,
+                           std::function<void()> materialize)
     : ImmediateExecutionTensorHandle(kEager),
       dtype(dtype),
       device_((d == ctx->HostCPU()) ? nullptr : d),
@@ -298,7 +308,8 @@ TensorHandle::TensorHandle(Device* d, Device* op_device,
       resource_remote_device_incarnation_(
           GetRemoteDeviceIncarnation(resource_device_)),
       ctx_(ctx),
-      data_(absl::in_place_type<LocalTensorHandleData>) {
+      data_(absl::in_place_type<LocalTensorHandleData>,
+            std::move(materialize)) {
   DVLOG(3) << "Creating empty Local TensorHandle: " << this
            << " device: " << SafeDeviceDebugString(device_);
 }
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <algorithm>
 #include <cstddef>
+#include <functional>
 #include <memory>
 #include <queue>
 #include <string>
@@ -63,7 +64,8 @@ class TensorHandle : public ImmediateExecutionTensorHandle {
   TensorHandle(tensorflow::Tensor&& t, Device* d, Device* op_device,
                EagerContext* ctx);
   TensorHandle(Device* d, Device* op_device, Device* resource_device,
-               tensorflow::DataType dtype, EagerContext* ctx);
+               tensorflow::DataType dtype, EagerContext* ctx,
+               std::function<void()> materialize = nullptr);
 
 #if !defined(IS_MOBILE_PLATFORM)
   TensorHandle(int64_t op_id, int32_t output_num, const string& remote_task,
@@ -86,6 +88,13 @@ class TensorHandle : public ImmediateExecutionTensorHandle {
                                               Device* resource_device,
                                               tensorflow::DataType dtype,
                                               EagerContext* ctx);
+  // Like `CreateEmptyLocalHandle`, but the tensor is only produced once the
+  // handle is waited on, by calling `materialize` (without holding any lock).
+  // `materialize` must eventually call SetTensor or Poison on the handle.
+  static TensorHandle* CreateLazyLocalHandle(
+      Device* d, Device* op_device, Device* resource_device,
+      tensorflow::DataType dtype, std::function<void()> materialize,
+      EagerContext* ctx);
 
   // Create a handle which packs the given handles of the same dtype and shape.
   // If handles are on different devices, assign the packed handle to a
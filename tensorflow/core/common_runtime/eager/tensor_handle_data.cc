@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/common_runtime/eager/tensor_handle_data.h"
 
+#include <functional>
 #include <utility>
 #include <variant>
 
@@ -111,6 +112,22 @@ void LocalTensorHandleData::BlockingControl::SetReady() {
 
 Status LocalTensorHandleData::BlockingControl::WaitReady(
     const char* caller) const {
+  bool needs_materialize;
+  {
+    tf_shared_lock l(mu_);
+    needs_materialize = !is_ready_ && materialize_ != nullptr;
+  }
+  if (needs_materialize) {
+    std::function<void()> materialize;
+    {
+      mutex_lock l(mu_);
+      materialize.swap(materialize_);
+    }
+    if (materialize != nullptr) {
+      materialize();
+    }
+  }
+
   tf_shared_lock l(mu_);
   if (!is_ready_) {
     tsl::profiler::TraceMe activity(
@@ -15,6 +15,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_COMMON_RUNTIME_EAGER_TENSOR_HANDLE_DATA_H_
 #define TENSORFLOW_CORE_COMMON_RUNTIME_EAGER_TENSOR_HANDLE_DATA_H_
 
+#include <functional>
 #include <utility>
 #include <variant>
 
@@ -29,6 +30,11 @@ namespace tensorflow {
 class LocalTensorHandleData {
  public:
   LocalTensorHandleData() : ctrl_(absl::in_place_type<BlockingControl>) {}
+  // Creates a non-ready handle whose tensor is only produced once it is waited
+  // on: the first WaitReady calls `materialize`, without holding any lock,
+  // which must eventually set or poison the handle.
+  explicit LocalTensorHandleData(std::function<void()> materialize)
+      : ctrl_(absl::in_place_type<BlockingControl>, std::move(materialize)) {}
   explicit LocalTensorHandleData(tensorflow::Tensor&& t)
       : tensor_(std::move(t)),
         forwarding_protection_tensor_(tensor_),
@@ -87,6 +93,10 @@ class LocalTensorHandleData {
 
   class BlockingControl {
    public:
+    BlockingControl() = default;
+    explicit BlockingControl(std::function<void()> materialize)
+        : materialize_(std::move(materialize)) {}
+
     bool IsReady() const {
       tf_shared_lock l(mu_);
       return is_ready_;
@@ -101,8 +111,10 @@ class LocalTensorHandleData {
 
    private:
     mutable mutex mu_;
-    bool is_ready_ TF_GUARDED_BY(mu_);
+    bool is_ready_ TF_GUARDED_BY(mu_) = false;
     Status is_poisoned_ TF_GUARDED_BY(mu_);
+    // Called by the first WaitReady on the non-ready handle, if set.
+    mutable std::function<void()> materialize_ TF_GUARDED_BY(mu_);
   };
 
   std::variant<NonBlockingControl, BlockingControl> ctrl_;
@@ -36,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/renamed_device.h"
 #include "tensorflow/core/common_runtime/simple_propagator_state.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
+#include "tensorflow/core/common_runtime/work_stealing_queues.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/collective.h"
@@ -62,6 +63,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/manual_constructor.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/context.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/logging.h"
@@ -145,9 +147,21 @@ struct KernelTimer {
 typedef gtl::InlinedVector<TensorValue, 4> TensorValueVec;
 typedef gtl::InlinedVector<AllocatorAttributes, 4> AllocatorAttributeVec;
 
+// The work-stealing deques and the slot in them that the current thread is
+// draining, if any. See `ExecutorState::RunWorker()`.
+struct WorkStealingWorker {
+  const void* queues = nullptr;
+  int slot = -1;
+};
+thread_local WorkStealingWorker current_work_stealing_worker;
+
 class ExecutorImpl : public Executor {
  public:
-  explicit ExecutorImpl(const LocalExecutorParams& p) : immutable_state_(p) {}
+  // If `work_stealing` is true, expensive ready nodes are queued on per-worker
+  // deques drained by a bounded number of `runner` closures, instead of each
+  // being passed to `runner` as a separate closure.
+  explicit ExecutorImpl(const LocalExecutorParams& p, bool work_stealing)
+      : immutable_state_(p), work_stealing_(work_stealing) {}
 
   Status Initialize(const Graph& graph) {
     TF_RETURN_IF_ERROR(immutable_state_.Initialize(graph));
@@ -225,6 +239,7 @@ class ExecutorImpl : public Executor {
 
   ImmutableExecutorState immutable_state_;
   KernelStats kernel_stats_;
+  const bool work_stealing_;
 
   ExecutorImpl(const ExecutorImpl&) = delete;
   void operator=(const ExecutorImpl&) = delete;
@@ -284,7 +299,7 @@ class ExecutorState {
  public:
   ExecutorState(const Executor::Args& args,
                 const ImmutableExecutorState& immutable_state_,
-                ExecutorImpl::KernelStats* kernel_stats_);
+                ExecutorImpl::KernelStats* kernel_stats_, bool work_stealing);
   ~ExecutorState();
 
   void RunAsync(Executor::DoneCallback done);
@@ -340,6 +355,22 @@ class ExecutorState {
   // REQUIRES: `!ready->empty()`.
   void ScheduleReady(TaggedNodeSeq* ready, TaggedNodeReadyQueue* inline_ready);
 
+  // Pushes `nodes` onto the work-stealing deques, preferring the deque of the
+  // calling worker, and starts a worker for each node while idle slots remain.
+  //
+  // REQUIRES: `work_queues_ != nullptr`.
+  void ScheduleWorkStealing(const TaggedNodeSeq& nodes);
+
+  // Drains `queues` from worker slot `slot`, stealing from the other slots
+  // when its own deque is empty, and returns once every deque is empty.
+  //
+  // NOTE: `state` may be deleted by the last node it processes, so this only
+  // dereferences `state` while holding a node popped from `queues`; a queued
+  // node is still outstanding and keeps the step alive.
+  static void RunWorker(ExecutorState* state,
+                        std::shared_ptr<WorkStealingQueues<TaggedNode>> queues,
+                        int slot);
+
   // A wrapper for runner_ to keep track of the pending queue length. Op
   // execution should dispatch work using this function instead of using runner_
   // directly.
@@ -399,6 +430,11 @@ class ExecutorState {
   bool sync_on_finish_;
   const bool run_all_kernels_inline_;
 
+  // Per-worker deques of expensive ready nodes, or null if the executor
+  // passes each of them to `runner_` separately. Shared with the worker
+  // closures, which may outlive this state.
+  std::shared_ptr<WorkStealingQueues<TaggedNode>> work_queues_;
+
   PropagatorStateType propagator_;
 
   // Invoked when the execution finishes.
@@ -419,7 +455,7 @@ class ExecutorState {
 template <class PropagatorStateType>
 ExecutorState<PropagatorStateType>::ExecutorState(
     const Executor::Args& args, const ImmutableExecutorState& immutable_state,
-    ExecutorImpl::KernelStats* kernel_stats)
+    ExecutorImpl::KernelStats* kernel_stats, bool work_stealing)
     : vlog_(VLOG_IS_ON(1)),
       log_memory_(LogMemory::IsEnabled()),
       step_id_(args.step_id),
@@ -455,6 +491,17 @@ ExecutorState<PropagatorStateType>::ExecutorState(
     user_device_ = RenamedDevice::NewRenamedDevice(
         device->name(), device, false, false, args.user_intra_op_threadpool);
   }
+  if (work_stealing && !run_all_kernels_inline_) {
+    // One worker per inter-op thread, so that workers never wait on each other
+    // for a thread.
+    int num_workers = port::MaxParallelism();
+    if (session_config_ != nullptr &&
+        session_config_->inter_op_parallelism_threads() > 0) {
+      num_workers = session_config_->inter_op_parallelism_threads();
+    }
+    work_queues_ =
+        std::make_shared<WorkStealingQueues<TaggedNode>>(num_workers);
+  }
 }
 
 template <class PropagatorStateType>
@@ -1299,13 +1346,28 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
       }
     }
   } else {
+    const bool prioritized = immutable_state_.has_node_priorities();
+    if (prioritized && ready->size() > 1) {
+      // Dispatch the nodes on the longest remaining paths first.
+      std::stable_sort(ready->begin(), ready->end(),
+                       [this](const TaggedNode& a, const TaggedNode& b) {
+                         return immutable_state_.node_priority(
+                                    a.get_node_item()) >
+                                immutable_state_.node_priority(
+                                    b.get_node_item());
+                       });
+    }
     const TaggedNode* curr_expensive_node = nullptr;
     TaggedNodeSeq expensive_nodes;
     if (inline_ready == nullptr) {
-      // Schedule to run all the ready ops in thread pool.
-      for (auto& tagged_node : *ready) {
-        RunTask([=]() { Process(tagged_node, scheduled_nsec); },
-                /*sample_rate=*/ready->size());
+      if (work_queues_ != nullptr) {
+        ScheduleWorkStealing(*ready);
+      } else {
+        // Schedule to run all the ready ops in thread pool.
+        for (auto& tagged_node : *ready) {
+          RunTask([=]() { Process(tagged_node, scheduled_nsec); },
+                  /*sample_rate=*/ready->size());
+        }
       }
     } else {
       for (auto& tagged_node : *ready) {
@@ -1313,6 +1375,9 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
         if (tagged_node.get_is_dead() || !kernel_stats_->IsExpensive(item)) {
           // Inline this inexpensive node.
           inline_ready->push_back(tagged_node);
+        } else if (prioritized && curr_expensive_node) {
+          // Keep the most critical expensive node as the one to run inline.
+          expensive_nodes.push_back(tagged_node);
         } else {
           if (curr_expensive_node) {
             expensive_nodes.push_back(*curr_expensive_node);
@@ -1324,6 +1389,10 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
     if (curr_expensive_node) {
       if (inline_ready->empty()) {
         inline_ready->push_back(*curr_expensive_node);
+      } else if (prioritized) {
+        // There are inline nodes to run already. We dispatch this expensive
+        // node to other thread, ahead of the less critical ones.
+        expensive_nodes.insert(expensive_nodes.begin(), *curr_expensive_node);
       } else {
         // There are inline nodes to run already. We dispatch this expensive
         // node to other thread.
@@ -1331,7 +1400,11 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
       }
     }
     if (!expensive_nodes.empty()) {
-      if (expensive_nodes.size() < kInlineScheduleReadyThreshold) {
+      if (work_queues_ != nullptr) {
+        // The current thread keeps running `inline_ready`, and idle workers
+        // steal the expensive nodes from its deque.
+        ScheduleWorkStealing(expensive_nodes);
+      } else if (expensive_nodes.size() < kInlineScheduleReadyThreshold) {
         for (auto& tagged_node : expensive_nodes) {
           RunTask(std::bind(&ExecutorState::Process, this, tagged_node,
                             scheduled_nsec),
@@ -1375,6 +1448,63 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
   ready->clear();
 }
 
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::ScheduleWorkStealing(
+    const TaggedNodeSeq& nodes) {
+  // Hold an extra outstanding op while scheduling, since the workers started
+  // below may otherwise finish the step, and delete this state, before the
+  // remaining workers have been started.
+  num_outstanding_ops_.fetch_add(1, std::memory_order_relaxed);
+  const int num_workers = work_queues_->num_workers();
+  const int current_slot =
+      current_work_stealing_worker.queues == work_queues_.get()
+          ? current_work_stealing_worker.slot
+          : -1;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    // Nodes readied by a thread outside this step's workers, e.g. the roots or
+    // the successors of an asynchronous kernel, are spread over all deques.
+    const int slot = current_slot != -1 ? current_slot : i % num_workers;
+    work_queues_->Push(slot, nodes[i]);
+  }
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    const int slot = work_queues_->TryAcquireWorker();
+    if (slot == -1) break;
+    RunTask([this, queues = work_queues_, slot]() {
+      RunWorker(this, std::move(queues), slot);
+    });
+  }
+  if (num_outstanding_ops_.fetch_sub(1) == 1) ScheduleFinish();
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::RunWorker(
+    ExecutorState* state,
+    std::shared_ptr<WorkStealingQueues<TaggedNode>> queues, int slot) {
+  // A kernel may run another executor synchronously on this thread, so restore
+  // the enclosing worker on exit.
+  const WorkStealingWorker enclosing_worker = current_work_stealing_worker;
+  current_work_stealing_worker.queues = queues.get();
+  while (true) {
+    current_work_stealing_worker.slot = slot;
+    while (std::optional<TaggedNode> tagged_node = queues->Pop(slot)) {
+      int64_t scheduled_nsec = 0;
+      if (state->stats_collector_) {
+        scheduled_nsec = nodestats::NowInNsec();
+      }
+      state->Process(*tagged_node, scheduled_nsec);
+    }
+    queues->ReleaseWorker(slot);
+    // A producer that pushed after our last `Pop()` may have found no idle
+    // slot, in which case it relies on us to run its nodes. Releasing the slot
+    // before checking `Empty()` is ordered against the producer's push and
+    // slot check, see `WorkStealingQueues::TryAcquireWorker()`.
+    if (queues->Empty()) break;
+    slot = queues->TryAcquireWorker();
+    if (slot == -1) break;
+  }
+  current_work_stealing_worker = enclosing_worker;
+}
+
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::ScheduleFinish() {
   // Checks condition to decide if needs to invoke Finish(). If there are
@@ -1514,14 +1644,15 @@ void ExecutorState<PropagatorStateType>::Finish() {
 void ExecutorImpl::RunAsyncInternal(const Args& args, DoneCallback done) {
   if (OpOrderDeterminismRequired()) {
     (new ExecutorState<OrderedPropagatorState>(args, immutable_state_,
-                                               &kernel_stats_))
+                                               &kernel_stats_, work_stealing_))
         ->RunAsync(std::move(done));
   } else if (immutable_state_.requires_control_flow_support()) {
-    (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_))
+    (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_,
+                                        work_stealing_))
         ->RunAsync(std::move(done));
   } else {
     (new ExecutorState<SimplePropagatorState>(args, immutable_state_,
-                                              &kernel_stats_))
+                                              &kernel_stats_, work_stealing_))
         ->RunAsync(std::move(done));
   }
 }
@@ -1530,7 +1661,7 @@ void ExecutorImpl::RunAsyncInternal(const Args& args, DoneCallback done) {
 
 Status NewLocalExecutor(const LocalExecutorParams& params, const Graph& graph,
                         Executor** executor) {
-  ExecutorImpl* impl = new ExecutorImpl(params);
+  ExecutorImpl* impl = new ExecutorImpl(params, /*work_stealing=*/false);
   const Status s = impl->Initialize(graph);
   if (s.ok()) {
     *executor = impl;
@@ -1554,12 +1685,17 @@ void DeleteNonCachedKernel(OpKernel* kernel) { delete kernel; }
 
 namespace {
 
+// The executor type of the default executor with work-stealing scheduling of
+// expensive nodes.
+constexpr char kWorkStealingExecutor[] = "WORK_STEALING";
+
 class DefaultExecutorRegistrar {
  public:
   DefaultExecutorRegistrar() {
     Factory* factory = new Factory;
     ExecutorFactory::Register("", factory);
     ExecutorFactory::Register("DEFAULT", factory);
+    ExecutorFactory::Register(kWorkStealingExecutor, new WorkStealingFactory);
   }
 
  private:
@@ -1572,6 +1708,17 @@ class DefaultExecutorRegistrar {
       return absl::OkStatus();
     }
   };
+
+  class WorkStealingFactory : public ExecutorFactory {
+    Status NewExecutor(const LocalExecutorParams& params, const Graph& graph,
+                       std::unique_ptr<Executor>* out_executor) override {
+      auto impl =
+          std::make_unique<ExecutorImpl>(params, /*work_stealing=*/true);
+      TF_RETURN_IF_ERROR(impl->Initialize(graph));
+      *out_executor = std::move(impl);
+      return absl::OkStatus();
+    }
+  };
 };
 static DefaultExecutorRegistrar registrar;
 
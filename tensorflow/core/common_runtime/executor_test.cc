@@ -25,7 +25,9 @@ limitations under the License.
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/executor_factory.h"
 #include "tensorflow/core/common_runtime/graph_constructor.h"
+#include "tensorflow/core/common_runtime/immutable_executor_state.h"
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/common_runtime/lower_functional_ops.h"
 #include "tensorflow/core/common_runtime/process_util.h"
@@ -76,8 +78,10 @@ class ExecutorTest : public ::testing::Test {
     delete exec_;
   }
 
-  // Resets executor_ with a new executor based on a graph 'gdef'.
-  void Create(std::unique_ptr<const Graph> graph) {
+  // Resets executor_ with a new executor of type 'executor_type' based on a
+  // graph 'gdef'.
+  void Create(std::unique_ptr<const Graph> graph,
+              const string& executor_type = "") {
     const int version = graph->versions().producer();
     LocalExecutorParams params;
     params.device = device_.get();
@@ -90,9 +94,12 @@ class ExecutorTest : public ::testing::Test {
     params.delete_kernel = [](OpKernel* kernel) {
       DeleteNonCachedKernel(kernel);
     };
+    params.prioritize_critical_path = prioritize_critical_path_;
     rendez_ = NewLocalRendezvous();
     delete exec_;
-    TF_CHECK_OK(NewLocalExecutor(params, *graph, &exec_));
+    std::unique_ptr<Executor> exec;
+    TF_CHECK_OK(NewExecutor(executor_type, params, *graph, &exec));
+    exec_ = exec.release();
     runner_ = [this](std::function<void()> fn) { thread_pool_->Schedule(fn); };
   }
 
@@ -111,6 +118,7 @@ class ExecutorTest : public ::testing::Test {
   StepStats step_stats_;
   Executor::Args::Runner runner_;
   Rendezvous* rendez_ = nullptr;
+  bool prioritize_critical_path_ = false;
 };
 
 // A float val -> Tensor<float>
@@ -265,6 +273,75 @@ TEST_F(ExecutorTest, RandomTree) {
   EXPECT_EQ(4096.0, V(out));
 }
 
+TEST_F(ExecutorTest, RandomTreeWorkStealing) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  Create(std::move(g), "WORK_STEALING");
+  // Later runs see updated cost estimates, and inline more of the nodes.
+  for (int iters = 0; iters < 4; ++iters) {
+    Rendezvous::Args args;
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(1.0), false));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(4096.0, V(out));
+  }
+}
+
+TEST_F(ExecutorTest, RandomTreePrioritized) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  prioritize_critical_path_ = true;
+  Create(std::move(g));
+  Rendezvous::Args args;
+  TF_ASSERT_OK(
+      rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0), false));
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out, &is_dead));
+  EXPECT_EQ(4096.0, V(out));
+}
+
+TEST_F(ExecutorTest, CriticalPathPriorities) {
+  // a -> b -> c
+  //  \-> d
+  Graph g(OpRegistry::Global());
+  Node* a = test::graph::Constant(&g, V(1.0));
+  Node* b = test::graph::Identity(&g, a);
+  Node* c = test::graph::Identity(&g, b);
+  Node* d = test::graph::Identity(&g, a);
+  FixupSourceAndSinkEdges(&g);
+
+  LocalExecutorParams params;
+  params.device = device_.get();
+  const int version = g.versions().producer();
+  params.create_kernel =
+      [this, version](const std::shared_ptr<const NodeProperties>& props,
+                      OpKernel** kernel) {
+        return CreateNonCachedKernel(device_.get(), nullptr, props, version,
+                                     kernel);
+      };
+  params.delete_kernel = [](OpKernel* kernel) {
+    DeleteNonCachedKernel(kernel);
+  };
+  params.prioritize_critical_path = true;
+  ImmutableExecutorState state(params);
+  TF_ASSERT_OK(state.Initialize(g));
+  ASSERT_TRUE(state.has_node_priorities());
+  auto priority = [&state](const Node* n) {
+    return state.node_priority(*state.graph_view().node(n->id()));
+  };
+  EXPECT_EQ(priority(c), 1);
+  EXPECT_EQ(priority(b), 2);
+  EXPECT_EQ(priority(d), 1);
+  EXPECT_EQ(priority(a), 3);
+}
+
 void BuildConcurrentAddAssign(Graph* g) {
   auto one = test::graph::Constant(g, V(1.0));
   // A variable holds one float.
@@ -442,7 +519,8 @@ TEST_F(ExecutorTest, NoInputTensors) {
 // Create a graph that is 'depth' deep. At each level, fan-in and fan-out a
 // maximum of 'width' nodes. All nodes are no-ops and all dependencies are
 // control dependencies.
-static void BM_executor(::testing::benchmark::State& state) {
+static void BM_executor_helper(::testing::benchmark::State& state,
+                               const char* executor_type) {
   const int width = state.range(0);
   const int depth = state.range(1);
 
@@ -476,22 +554,156 @@ static void BM_executor(::testing::benchmark::State& state) {
   }
 
   FixupSourceAndSinkEdges(g);
-  test::Benchmark("cpu", g, /*old_benchmark_api=*/false).Run(state);
+  test::Benchmark("cpu", g, /*options=*/nullptr, /*init=*/nullptr,
+                  /*rendez=*/nullptr, executor_type,
+                  /*old_benchmark_api=*/false)
+      .Run(state);
 
   state.SetLabel(strings::StrCat("Nodes = ", cur));
   state.SetItemsProcessed(cur * static_cast<int64_t>(state.iterations()));
 }
 
+static void BM_executor(::testing::benchmark::State& state) {
+  BM_executor_helper(state, "");
+}
+
+static void BM_executor_work_stealing(::testing::benchmark::State& state) {
+  BM_executor_helper(state, "WORK_STEALING");
+}
+
 // Tall skinny graphs
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(16, 1024);
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(32, 8192);
+BENCHMARK(BM_executor_work_stealing)->UseRealTime()->ArgPair(16, 1024);
+BENCHMARK(BM_executor_work_stealing)->UseRealTime()->ArgPair(32, 8192);
 
 // Short fat graphs
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(1024, 16);
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(8192, 32);
+BENCHMARK(BM_executor_work_stealing)->UseRealTime()->ArgPair(1024, 16);
+BENCHMARK(BM_executor_work_stealing)->UseRealTime()->ArgPair(8192, 32);
 
 // Tall fat graph
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(1024, 1024);
+BENCHMARK(BM_executor_work_stealing)->UseRealTime()->ArgPair(1024, 1024);
+
+// Create 'width' independent chains of 'depth' element-wise additions. Unlike
+// the no-ops above, the additions are large enough to stay expensive, so every
+// ready successor is handed to the scheduler.
+static void BM_executor_add_chains_helper(::testing::benchmark::State& state,
+                                          const char* executor_type) {
+  const int width = state.range(0);
+  const int depth = state.range(1);
+
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor t(DT_FLOAT, TensorShape({1 << 16}));
+  t.flat<float>().setZero();
+  Node* input = test::graph::Constant(g, t);
+  for (int i = 0; i < width; ++i) {
+    Node* n = input;
+    for (int j = 0; j < depth; ++j) {
+      n = test::graph::Add(g, n, input);
+    }
+  }
+  FixupSourceAndSinkEdges(g);
+  test::Benchmark("cpu", g, /*options=*/nullptr, /*init=*/nullptr,
+                  /*rendez=*/nullptr, executor_type,
+                  /*old_benchmark_api=*/false)
+      .Run(state);
+  state.SetLabel(strings::StrCat("Nodes = ", width * depth));
+  state.SetItemsProcessed(width * depth *
+                          static_cast<int64_t>(state.iterations()));
+}
+
+static void BM_executor_add_chains(::testing::benchmark::State& state) {
+  BM_executor_add_chains_helper(state, "");
+}
+
+static void BM_executor_add_chains_work_stealing(
+    ::testing::benchmark::State& state) {
+  BM_executor_add_chains_helper(state, "WORK_STEALING");
+}
+
+BENCHMARK(BM_executor_add_chains)
+    ->UseRealTime()
+    ->ArgPair(1, 256)
+    ->ArgPair(16, 16)
+    ->ArgPair(256, 1);
+BENCHMARK(BM_executor_add_chains_work_stealing)
+    ->UseRealTime()
+    ->ArgPair(1, 256)
+    ->ArgPair(16, 16)
+    ->ArgPair(256, 1);
+
+// Measures the per-step latency of a skewed graph: one chain of element-wise
+// additions next to 'width' single additions, all of which become ready at the
+// start of the step. Unless the executor prioritizes the critical path, each
+// link of the chain may queue behind the side branches.
+static void BM_SkewedGraphLatency(::testing::benchmark::State& state) {
+  const bool prioritize_critical_path = state.range(0);
+  const int width = state.range(1);
+  constexpr int kChainLength = 32;
+
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  Tensor t(DT_FLOAT, TensorShape({1 << 16}));
+  t.flat<float>().setZero();
+  Node* input = test::graph::Constant(g.get(), t);
+  Node* n = input;
+  for (int i = 0; i < kChainLength; ++i) {
+    n = test::graph::Add(g.get(), n, input);
+  }
+  for (int i = 0; i < width; ++i) {
+    test::graph::Add(g.get(), input, input);
+  }
+  FixupSourceAndSinkEdges(g.get());
+
+  std::unique_ptr<Device> device = DeviceFactory::NewDevice(
+      "CPU", {}, "/job:localhost/replica:0/task:0");
+  const int version = g->versions().producer();
+  LocalExecutorParams params;
+  params.device = device.get();
+  params.create_kernel =
+      [&device, version](const std::shared_ptr<const NodeProperties>& props,
+                         OpKernel** kernel) {
+        return CreateNonCachedKernel(device.get(), nullptr, props, version,
+                                     kernel);
+      };
+  params.delete_kernel = [](OpKernel* kernel) {
+    DeleteNonCachedKernel(kernel);
+  };
+  params.prioritize_critical_path = prioritize_critical_path;
+  Executor* exec_ptr = nullptr;
+  TF_CHECK_OK(NewLocalExecutor(params, *g, &exec_ptr));
+  std::unique_ptr<Executor> exec(exec_ptr);
+
+  thread::ThreadPool pool(Env::Default(), "skewed", 4);
+  Executor::Args args;
+  args.runner = [&pool](std::function<void()> fn) {
+    pool.Schedule(std::move(fn));
+  };
+  std::vector<uint64> latencies_us;
+  for (auto s : state) {
+    const uint64 start_us = Env::Default()->NowMicros();
+    TF_CHECK_OK(exec->Run(args));
+    latencies_us.push_back(Env::Default()->NowMicros() - start_us);
+  }
+  if (latencies_us.empty()) return;
+  std::sort(latencies_us.begin(), latencies_us.end());
+  auto percentile = [&latencies_us](double p) {
+    return latencies_us[std::min(latencies_us.size() - 1,
+                                 static_cast<size_t>(p * latencies_us.size()))];
+  };
+  state.counters["p50_us"] = percentile(0.5);
+  state.counters["p90_us"] = percentile(0.9);
+  state.counters["p99_us"] = percentile(0.99);
+}
+
+BENCHMARK(BM_SkewedGraphLatency)
+    ->UseRealTime()
+    ->ArgPair(0, 64)
+    ->ArgPair(1, 64)
+    ->ArgPair(0, 512)
+    ->ArgPair(1, 512);
 
 static void BM_const_identity(::testing::benchmark::State& state) {
   const int width = state.range(0);
@@ -15,10 +15,13 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/immutable_executor_state.h"
 
+#include <algorithm>
+
 #include "absl/memory/memory.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/edgeset.h"
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/graph/graph_node_util.h"
@@ -259,9 +262,32 @@ Status ImmutableExecutorState::Initialize(const Graph& graph) {
   // Initialize PendingCounts only after pending_ids_[node.id] is initialized
   // for all nodes.
   InitializePending(&graph, cf_info);
+  if (params_.prioritize_critical_path) {
+    InitializeNodePriorities(graph);
+  }
   return gview_.SetAllocAttrs(&graph, params_.device);
 }
 
+void ImmutableExecutorState::InitializeNodePriorities(const Graph& graph) {
+  node_priorities_.assign(gview_.num_nodes(), 0);
+  // In post order every node follows its successors, except across the back
+  // edges of loops, which are ignored below.
+  std::vector<Node*> order;
+  GetPostOrder(graph, &order);
+  for (const Node* n : order) {
+    if (IsSink(n)) continue;
+    int64_t longest_successor_path = 0;
+    if (!IsNextIteration(n)) {
+      for (const Edge* e : n->out_edges()) {
+        if (IsSink(e->dst())) continue;
+        longest_successor_path = std::max(longest_successor_path,
+                                          node_priorities_[e->dst()->id()]);
+      }
+    }
+    node_priorities_[n->id()] = 1 + longest_successor_path;
+  }
+}
+
 namespace {
 // If a Node has been marked to use a ScopedAllocator x for output i, then
 // sc_attr will contain the subsequence (i, x) at an even offset.  This function
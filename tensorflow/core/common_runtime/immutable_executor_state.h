@@ -101,6 +101,18 @@ class ImmutableExecutorState {
 
   bool requires_control_flow_support() const { return requires_control_flow_; }
 
+  // Returns true if `params().prioritize_critical_path` is set, in which case
+  // `node_priority()` is valid.
+  bool has_node_priorities() const { return !node_priorities_.empty(); }
+
+  // Returns the number of nodes on the longest path from `node_item` to a
+  // sink, including the node itself.
+  //
+  // REQUIRES: `has_node_priorities()`.
+  int64_t node_priority(const NodeItem& node_item) const {
+    return node_priorities_[node_item.node_id];
+  }
+
   // Copies the pending counts for nodes in this graph to the given array.
   //
   // This method provides a more efficient way of initializing
@@ -125,6 +137,7 @@ class ImmutableExecutorState {
   static Status BuildControlFlowInfo(const Graph* graph,
                                      ControlFlowInfo* cf_info);
   void InitializePending(const Graph* graph, const ControlFlowInfo& cf_info);
+  void InitializeNodePriorities(const Graph& graph);
 
   FrameInfo* EnsureFrameInfo(const string& fname);
 
@@ -155,6 +168,10 @@ class ImmutableExecutorState {
   // Shallow copies of the constant tensors used in the graph.
   std::vector<Tensor> const_tensors_;
 
+  // If `params_.prioritize_critical_path` is set, the critical path length of
+  // each node, indexed by node ID. Empty otherwise.
+  std::vector<int64_t> node_priorities_;
+
   ImmutableExecutorState(const ImmutableExecutorState&) = delete;
   void operator=(const ImmutableExecutorState&) = delete;
 };
@@ -50,6 +50,12 @@ struct LocalExecutorParams {
 
   // Whether control flow nodes are allowed to be executed synchronously.
   bool allow_control_flow_sync_execution = false;
+
+  // If true, the executor gives every node a priority equal to the number of
+  // nodes on the longest path from it to a sink, and dispatches ready nodes in
+  // decreasing order of priority, so that long chains are not starved by
+  // short side branches.
+  bool prioritize_critical_path = false;
 };
 
 }  // end namespace tensorflow
@@ -0,0 +1,592 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/thread_caching_cpu_allocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/types/optional.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/allocator_registry.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr size_t kAlignment = Allocator::kAllocatorAlignment;
+constexpr size_t kMaxSizeClassBytes =
+    ThreadCachingCPUAllocator::kMaxSizeClassBytes;
+
+// Size classes are carved out of spans of kSpanBytes, aligned to kSpanBytes.
+constexpr int kSpanShift = 18;
+constexpr size_t kSpanBytes = size_t{1} << kSpanShift;
+
+// The size class of a span is looked up in a two-level page map indexed by
+// the span number. Spans at higher addresses are not used.
+constexpr int kAddressBits = 48;
+constexpr int kPageMapLeafBits = 15;
+constexpr int kPageMapRootBits = kAddressBits - kSpanShift - kPageMapLeafBits;
+constexpr size_t kPageMapLeafSize = size_t{1} << kPageMapLeafBits;
+constexpr size_t kPageMapRootSize = size_t{1} << kPageMapRootBits;
+
+// Bounds on the free blocks a thread caches per size class.
+constexpr size_t kThreadCacheBytesPerClass = 256 << 10;
+constexpr int kMinThreadCacheBlocks = 2;
+constexpr int kMaxThreadCacheBlocks = 256;
+
+struct SizeClassTable {
+  SizeClassTable() {
+    // Multiples of the alignment up to 1KiB, then four size classes per
+    // power of two, which bounds the internal fragmentation to 25%.
+    for (size_t bytes = kAlignment; bytes <= 1024; bytes += kAlignment) {
+      class_bytes.push_back(bytes);
+    }
+    for (size_t base = 1024; base < kMaxSizeClassBytes; base *= 2) {
+      for (int i = 1; i <= 4; ++i) {
+        class_bytes.push_back(base + base / 4 * i);
+      }
+    }
+    DCHECK_EQ(class_bytes.back(), kMaxSizeClassBytes);
+    DCHECK_LE(class_bytes.size(), 255);
+
+    class_for_units.resize(kMaxSizeClassBytes / kAlignment + 1);
+    int size_class = 0;
+    for (size_t units = 1; units < class_for_units.size(); ++units) {
+      while (class_bytes[size_class] < units * kAlignment) {
+        ++size_class;
+      }
+      class_for_units[units] = size_class;
+    }
+
+    for (size_t bytes : class_bytes) {
+      max_cached_blocks.push_back(std::clamp<int>(
+          kThreadCacheBytesPerClass / bytes, kMinThreadCacheBlocks,
+          kMaxThreadCacheBlocks));
+    }
+  }
+
+  int num_classes() const { return class_bytes.size(); }
+
+  // Returns the size class serving `num_bytes`, or -1 if none does.
+  int SizeClass(size_t num_bytes) const {
+    if (num_bytes > kMaxSizeClassBytes) {
+      return -1;
+    }
+    return class_for_units[(num_bytes + kAlignment - 1) / kAlignment];
+  }
+
+  std::vector<size_t> class_bytes;
+  // Size class indexed by the number of kAlignment units of an allocation.
+  std::vector<uint8_t> class_for_units;
+  // Maximum number of free blocks a thread caches per size class.
+  std::vector<int> max_cached_blocks;
+};
+
+const SizeClassTable& GetSizeClassTable() {
+  static const SizeClassTable* table = new SizeClassTable;
+  return *table;
+}
+
+void UpdateMax(std::atomic<int64_t>& max, int64_t value) {
+  int64_t current = max.load(std::memory_order_relaxed);
+  while (current < value &&
+         !max.compare_exchange_weak(current, value,
+                                    std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+// The free blocks that are not cached by any thread, and the spans they were
+// carved out of. Shared with the thread caches, which may outlive the
+// allocator.
+class ThreadCachingCPUAllocator::CentralCache {
+ public:
+  CentralCache()
+      : table_(GetSizeClassTable()),
+        free_lists_(new FreeList[table_.num_classes()]),
+        page_map_(new std::atomic<std::atomic<uint8_t>*>[kPageMapRootSize]) {
+    for (size_t i = 0; i < kPageMapRootSize; ++i) {
+      page_map_[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ~CentralCache() {
+    for (void* span : spans_) {
+      port::AlignedFree(span);
+    }
+    for (size_t i = 0; i < kPageMapRootSize; ++i) {
+      delete[] page_map_[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  const SizeClassTable& table() const { return table_; }
+
+  // Marks the allocator as destroyed.
+  void Close() { closed_.store(true, std::memory_order_release); }
+  bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+  // Appends up to `max_blocks` free blocks of `size_class` to `blocks`.
+  void Fetch(int size_class, int max_blocks, std::vector<void*>* blocks) {
+    FreeList& free_list = free_lists_[size_class];
+    mutex_lock l(free_list.mu);
+    if (free_list.blocks.empty() && !AddSpan(size_class, &free_list.blocks)) {
+      return;
+    }
+    const int num_blocks =
+        std::min<int>(max_blocks, free_list.blocks.size());
+    blocks->insert(blocks->end(), free_list.blocks.end() - num_blocks,
+                   free_list.blocks.end());
+    free_list.blocks.resize(free_list.blocks.size() - num_blocks);
+  }
+
+  // Moves the blocks in [`begin`, `end`) of `size_class` to the free list.
+  void Release(int size_class, std::vector<void*>::const_iterator begin,
+               std::vector<void*>::const_iterator end) {
+    FreeList& free_list = free_lists_[size_class];
+    mutex_lock l(free_list.mu);
+    free_list.blocks.insert(free_list.blocks.end(), begin, end);
+  }
+
+  // Returns the size class of a block, or -1 if `ptr` is not in a span.
+  int SizeClassOf(const void* ptr) const {
+    const uintptr_t span = reinterpret_cast<uintptr_t>(ptr) >> kSpanShift;
+    if (span >> (kPageMapRootBits + kPageMapLeafBits) != 0) {
+      return -1;
+    }
+    const std::atomic<uint8_t>* leaf =
+        page_map_[span >> kPageMapLeafBits].load(std::memory_order_acquire);
+    if (leaf == nullptr) {
+      return -1;
+    }
+    return static_cast<int>(leaf[span & (kPageMapLeafSize - 1)].load(
+               std::memory_order_relaxed)) -
+           1;
+  }
+
+  // Accounts for `num_bytes` obtained from (or, if negative, returned to) the
+  // system.
+  void RecordReserved(int64_t num_bytes) {
+    const int64_t bytes_reserved =
+        bytes_reserved_.fetch_add(num_bytes, std::memory_order_relaxed) +
+        num_bytes;
+    UpdateMax(peak_bytes_reserved_, bytes_reserved);
+  }
+
+  int64_t bytes_reserved() const {
+    return bytes_reserved_.load(std::memory_order_relaxed);
+  }
+  int64_t peak_bytes_reserved() const {
+    return peak_bytes_reserved_.load(std::memory_order_relaxed);
+  }
+  void ClearPeakBytesReserved() {
+    peak_bytes_reserved_.store(bytes_reserved(), std::memory_order_relaxed);
+  }
+  int64_t span_bytes() const {
+    tf_shared_lock l(spans_mu_);
+    return spans_.size() * kSpanBytes;
+  }
+
+ private:
+  struct FreeList {
+    mutex mu;
+    std::vector<void*> blocks TF_GUARDED_BY(mu);
+  };
+
+  // Carves a new span into blocks of `size_class` and appends them to
+  // `blocks`. Returns false if no span could be obtained.
+  bool AddSpan(int size_class, std::vector<void*>* blocks) {
+    void* span = port::AlignedMalloc(kSpanBytes, kSpanBytes);
+    if (span == nullptr) {
+      return false;
+    }
+    const uintptr_t span_number =
+        reinterpret_cast<uintptr_t>(span) >> kSpanShift;
+    if (span_number >> (kPageMapRootBits + kPageMapLeafBits) != 0) {
+      port::AlignedFree(span);
+      return false;
+    }
+    {
+      mutex_lock l(spans_mu_);
+      std::atomic<std::atomic<uint8_t>*>& root =
+          page_map_[span_number >> kPageMapLeafBits];
+      std::atomic<uint8_t>* leaf = root.load(std::memory_order_relaxed);
+      if (leaf == nullptr) {
+        leaf = new std::atomic<uint8_t>[kPageMapLeafSize]();
+        root.store(leaf, std::memory_order_release);
+      }
+      leaf[span_number & (kPageMapLeafSize - 1)].store(
+          size_class + 1, std::memory_order_relaxed);
+      spans_.push_back(span);
+    }
+    RecordReserved(kSpanBytes);
+
+    // Blocks are handed out from the back, so push them in reverse order to
+    // hand them out in address order.
+    const size_t class_bytes = table_.class_bytes[size_class];
+    const size_t num_blocks = kSpanBytes / class_bytes;
+    char* base = static_cast<char*>(span);
+    for (size_t i = num_blocks; i > 0; --i) {
+      blocks->push_back(base + (i - 1) * class_bytes);
+    }
+    return true;
+  }
+
+  const SizeClassTable& table_;
+  const std::unique_ptr<FreeList[]> free_lists_;
+  const std::unique_ptr<std::atomic<std::atomic<uint8_t>*>[]> page_map_;
+  std::atomic<bool> closed_{false};
+
+  std::atomic<int64_t> bytes_reserved_{0};
+  std::atomic<int64_t> peak_bytes_reserved_{0};
+
+  mutable mutex spans_mu_;
+  std::vector<void*> spans_ TF_GUARDED_BY(spans_mu_);
+};
+
+// The free blocks cached by one thread for one allocator.
+class ThreadCachingCPUAllocator::ThreadCache {
+ public:
+  ThreadCache(uint64_t allocator_id, std::shared_ptr<CentralCache> central)
+      : allocator_id_(allocator_id),
+        central_(std::move(central)),
+        blocks_(central_->table().num_classes()) {}
+
+  ~ThreadCache() {
+    // The spans are freed along with the central cache once the allocator is
+    // gone.
+    if (central_->closed()) {
+      return;
+    }
+    for (int i = 0, end = blocks_.size(); i < end; ++i) {
+      central_->Release(i, blocks_[i].begin(), blocks_[i].end());
+    }
+  }
+
+  uint64_t allocator_id() const { return allocator_id_; }
+  bool closed() const { return central_->closed(); }
+
+  void* Allocate(int size_class) {
+    std::vector<void*>& blocks = blocks_[size_class];
+    if (ABSL_PREDICT_FALSE(blocks.empty())) {
+      central_->Fetch(size_class, BatchSize(size_class), &blocks);
+      if (blocks.empty()) {
+        return nullptr;
+      }
+    }
+    void* ptr = blocks.back();
+    blocks.pop_back();
+    return ptr;
+  }
+
+  void Deallocate(int size_class, void* ptr) {
+    std::vector<void*>& blocks = blocks_[size_class];
+    blocks.push_back(ptr);
+    if (ABSL_PREDICT_FALSE(static_cast<int>(blocks.size()) >
+                           central_->table().max_cached_blocks[size_class])) {
+      // Keeps the most recently freed blocks, which are likely still in the
+      // CPU caches.
+      const auto keep_end = blocks.begin() + BatchSize(size_class);
+      central_->Release(size_class, blocks.begin(), keep_end);
+      blocks.erase(blocks.begin(), keep_end);
+    }
+  }
+
+ private:
+  // Number of blocks exchanged with the central cache at once.
+  int BatchSize(int size_class) const {
+    return central_->table().max_cached_blocks[size_class] / 2;
+  }
+
+  const uint64_t allocator_id_;
+  const std::shared_ptr<CentralCache> central_;
+  std::vector<std::vector<void*>> blocks_;
+};
+
+ThreadCachingCPUAllocator::ThreadCachingCPUAllocator(const Options& options)
+    : id_([] {
+        static std::atomic<uint64_t> next_id{0};
+        return next_id.fetch_add(1, std::memory_order_relaxed);
+      }()),
+      bytes_limit_(options.bytes_limit),
+      collect_stats_(options.bytes_limit > 0),
+      central_(std::make_shared<CentralCache>()) {}
+
+ThreadCachingCPUAllocator::~ThreadCachingCPUAllocator() { central_->Close(); }
+
+size_t ThreadCachingCPUAllocator::SizeClassBytes(size_t num_bytes) {
+  const SizeClassTable& table = GetSizeClassTable();
+  const int size_class = table.SizeClass(num_bytes);
+  return size_class < 0 ? 0 : table.class_bytes[size_class];
+}
+
+ThreadCachingCPUAllocator::ThreadCache*
+ThreadCachingCPUAllocator::GetThreadCache() {
+  struct ThreadCaches {
+    // Caches of all allocators used by the thread. They are returned to the
+    // central caches when the thread exits.
+    std::vector<std::unique_ptr<ThreadCache>> caches;
+    ThreadCache* last_used = nullptr;
+  };
+  thread_local ThreadCaches thread_caches;
+
+  if (ABSL_PREDICT_TRUE(thread_caches.last_used != nullptr &&
+                        thread_caches.last_used->allocator_id() == id_)) {
+    return thread_caches.last_used;
+  }
+  std::vector<std::unique_ptr<ThreadCache>>& caches = thread_caches.caches;
+  // Drops the caches of destroyed allocators.
+  caches.erase(std::remove_if(caches.begin(), caches.end(),
+                              [](const std::unique_ptr<ThreadCache>& cache) {
+                                return cache->closed();
+                              }),
+               caches.end());
+  ThreadCache* cache = nullptr;
+  for (const std::unique_ptr<ThreadCache>& c : caches) {
+    if (c->allocator_id() == id_) {
+      cache = c.get();
+      break;
+    }
+  }
+  if (cache == nullptr) {
+    caches.push_back(std::make_unique<ThreadCache>(id_, central_));
+    cache = caches.back().get();
+  }
+  thread_caches.last_used = cache;
+  return cache;
+}
+
+void* ThreadCachingCPUAllocator::AllocateRaw(size_t alignment,
+                                             size_t num_bytes) {
+  const SizeClassTable& table = central_->table();
+  const int size_class =
+      alignment <= kAlignment ? table.SizeClass(num_bytes) : -1;
+  if (size_class < 0) {
+    return AllocateLarge(alignment, num_bytes);
+  }
+  const size_t class_bytes = table.class_bytes[size_class];
+  const bool collect_stats = CollectStats();
+  if (collect_stats && !RecordAllocation(class_bytes)) {
+    return nullptr;
+  }
+  void* ptr = GetThreadCache()->Allocate(size_class);
+  if (ABSL_PREDICT_FALSE(ptr == nullptr)) {
+    // No span could be added, e.g. because the system returned memory the
+    // page map does not cover.
+    if (collect_stats) {
+      RecordDeallocation(class_bytes);
+    }
+    return AllocateLarge(kAlignment, class_bytes);
+  }
+  return ptr;
+}
+
+void ThreadCachingCPUAllocator::DeallocateRaw(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  const int size_class = central_->SizeClassOf(ptr);
+  if (size_class < 0) {
+    DeallocateLarge(ptr);
+    return;
+  }
+  if (CollectStats()) {
+    RecordDeallocation(central_->table().class_bytes[size_class]);
+  }
+  GetThreadCache()->Deallocate(size_class, ptr);
+}
+
+void* ThreadCachingCPUAllocator::AllocateLarge(size_t alignment,
+                                               size_t num_bytes) {
+  if (!CollectStats()) {
+    return port::AlignedMalloc(num_bytes, alignment);
+  }
+  if (!RecordAllocation(num_bytes)) {
+    return nullptr;
+  }
+  void* ptr = port::AlignedMalloc(num_bytes, alignment);
+  if (ptr == nullptr) {
+    RecordDeallocation(num_bytes);
+    return nullptr;
+  }
+  central_->RecordReserved(num_bytes);
+  mutex_lock l(mu_);
+  large_allocations_[ptr] = num_bytes;
+  return ptr;
+}
+
+void ThreadCachingCPUAllocator::DeallocateLarge(void* ptr) {
+  if (CollectStats()) {
+    // The allocation is not tracked if stats were enabled after it was made.
+    size_t num_bytes = 0;
+    {
+      mutex_lock l(mu_);
+      auto it = large_allocations_.find(ptr);
+      if (it != large_allocations_.end()) {
+        num_bytes = it->second;
+        large_allocations_.erase(it);
+      }
+    }
+    RecordDeallocation(num_bytes);
+    central_->RecordReserved(-static_cast<int64_t>(num_bytes));
+  }
+  port::AlignedFree(ptr);
+}
+
+bool ThreadCachingCPUAllocator::RecordAllocation(size_t num_bytes) {
+  const int64_t bytes_in_use =
+      bytes_in_use_.fetch_add(num_bytes, std::memory_order_relaxed) +
+      num_bytes;
+  if (bytes_limit_ > 0 && bytes_in_use > bytes_limit_) {
+    bytes_in_use_.fetch_sub(num_bytes, std::memory_order_relaxed);
+    VLOG(1) << "Allocation of " << num_bytes << " bytes exceeds the limit of "
+            << bytes_limit_ << " bytes of " << Name();
+    return false;
+  }
+  num_allocs_.fetch_add(1, std::memory_order_relaxed);
+  UpdateMax(peak_bytes_in_use_, bytes_in_use);
+  UpdateMax(largest_alloc_size_, num_bytes);
+  return true;
+}
+
+void ThreadCachingCPUAllocator::RecordDeallocation(size_t num_bytes) {
+  bytes_in_use_.fetch_sub(num_bytes, std::memory_order_relaxed);
+}
+
+size_t ThreadCachingCPUAllocator::AllocatedSizeSlow(const void* ptr) const {
+  const int size_class = central_->SizeClassOf(ptr);
+  if (size_class >= 0) {
+    return central_->table().class_bytes[size_class];
+  }
+  if (CollectStats()) {
+    tf_shared_lock l(mu_);
+    auto it = large_allocations_.find(ptr);
+    if (it != large_allocations_.end()) {
+      return it->second;
+    }
+  }
+  return port::MallocExtension_GetAllocatedSize(ptr);
+}
+
+absl::optional<AllocatorStats> ThreadCachingCPUAllocator::GetStats() {
+  if (!CollectStats()) {
+    return absl::nullopt;
+  }
+  AllocatorStats stats;
+  stats.num_allocs = num_allocs_.load(std::memory_order_relaxed);
+  stats.bytes_in_use = bytes_in_use_.load(std::memory_order_relaxed);
+  stats.peak_bytes_in_use = peak_bytes_in_use_.load(std::memory_order_relaxed);
+  stats.largest_alloc_size =
+      largest_alloc_size_.load(std::memory_order_relaxed);
+  if (bytes_limit_ > 0) {
+    stats.bytes_limit = bytes_limit_;
+  }
+  stats.bytes_reserved = central_->bytes_reserved();
+  stats.peak_bytes_reserved = central_->peak_bytes_reserved();
+  stats.pool_bytes = central_->span_bytes();
+  return stats;
+}
+
+bool ThreadCachingCPUAllocator::ClearStats() {
+  if (!CollectStats()) {
+    return false;
+  }
+  num_allocs_.store(0, std::memory_order_relaxed);
+  peak_bytes_in_use_.store(bytes_in_use_.load(std::memory_order_relaxed),
+                           std::memory_order_relaxed);
+  largest_alloc_size_.store(0, std::memory_order_relaxed);
+  central_->ClearPeakBytesReserved();
+  return true;
+}
+
+namespace {
+
+ThreadCachingCPUAllocator::Options OptionsFromEnv() {
+  ThreadCachingCPUAllocator::Options options;
+  int64_t mem_limit_in_mb = 0;
+  Status status = ReadInt64FromEnvVar("TF_CPU_THREAD_CACHING_MEM_LIMIT_IN_MB",
+                                      0, &mem_limit_in_mb);
+  if (!status.ok()) {
+    LOG(ERROR) << "ThreadCachingCPUAllocator: " << status.message();
+  }
+  options.bytes_limit = mem_limit_in_mb * (1LL << 20);
+  return options;
+}
+
+class ThreadCachingCPUAllocatorFactory : public AllocatorFactory {
+ public:
+  Allocator* CreateAllocator() override {
+    return new ThreadCachingCPUAllocator(OptionsFromEnv());
+  }
+
+  SubAllocator* CreateSubAllocator(int numa_node) override {
+    return new ThreadCachingCPUSubAllocator(
+        std::make_unique<ThreadCachingCPUAllocator>(OptionsFromEnv()));
+  }
+
+ private:
+  class ThreadCachingCPUSubAllocator : public SubAllocator {
+   public:
+    explicit ThreadCachingCPUSubAllocator(
+        std::unique_ptr<ThreadCachingCPUAllocator> allocator)
+        : SubAllocator({}, {}), allocator_(std::move(allocator)) {}
+
+    void* Alloc(size_t alignment, size_t num_bytes,
+                size_t* bytes_received) override {
+      *bytes_received = num_bytes;
+      return allocator_->AllocateRaw(alignment, num_bytes);
+    }
+
+    void Free(void* ptr, size_t num_bytes) override {
+      allocator_->DeallocateRaw(ptr);
+    }
+
+    bool SupportsCoalescing() const override { return false; }
+
+    AllocatorMemoryType GetMemoryType() const override {
+      return allocator_->GetMemoryType();
+    }
+
+   private:
+    std::unique_ptr<ThreadCachingCPUAllocator> allocator_;
+  };
+};
+
+// Only preferred over the default CPU allocator (priority 100) if requested.
+int ThreadCachingCPUAllocatorPriority() {
+  bool use_thread_caching = false;
+  Status status = ReadBoolFromEnvVar("TF_CPU_ALLOCATOR_USE_THREAD_CACHING",
+                                     false, &use_thread_caching);
+  if (!status.ok()) {
+    LOG(ERROR) << "ThreadCachingCPUAllocator: " << status.message();
+  }
+  return use_thread_caching ? 150 : 50;
+}
+
+REGISTER_MEM_ALLOCATOR("ThreadCachingCPUAllocator",
+                       ThreadCachingCPUAllocatorPriority(),
+                       ThreadCachingCPUAllocatorFactory);
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,128 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_THREAD_CACHING_CPU_ALLOCATOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_THREAD_CACHING_CPU_ALLOCATOR_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/types/optional.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// A CPU allocator that serves small allocations from size classes, in the
+// spirit of tcmalloc.
+//
+// Blocks of each size class are carved out of spans obtained from
+// port::AlignedMalloc and are never returned to the system while the
+// allocator is alive. Every thread keeps a bounded cache of free blocks per
+// size class, so that most allocations and deallocations do not synchronize
+// with other threads; the caches exchange blocks in batches with central free
+// lists. Allocations larger than kMaxSizeClassBytes, or with an alignment
+// larger than Allocator::kAllocatorAlignment, go straight to
+// port::AlignedMalloc.
+//
+// The allocator is registered with the AllocatorFactoryRegistry and is
+// preferred over the default CPU allocator if the environment variable
+// TF_CPU_ALLOCATOR_USE_THREAD_CACHING is true.
+class ThreadCachingCPUAllocator : public Allocator {
+ public:
+  // Largest allocation served from a size class.
+  static constexpr size_t kMaxSizeClassBytes = 64 << 10;
+
+  struct Options {
+    // If positive, allocations fail once the bytes in use would exceed this
+    // limit. Blocks cached as free do not count towards the limit. Setting it
+    // also enables AllocatorStats, which are otherwise only collected while
+    // CPUAllocatorStatsEnabled() is true.
+    int64_t bytes_limit = 0;
+  };
+
+  explicit ThreadCachingCPUAllocator(const Options& options);
+  ~ThreadCachingCPUAllocator() override;
+
+  std::string Name() override { return "thread_caching_cpu"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void DeallocateRaw(void* ptr) override;
+
+  size_t AllocatedSizeSlow(const void* ptr) const override;
+
+  absl::optional<AllocatorStats> GetStats() override;
+  bool ClearStats() override;
+
+  AllocatorMemoryType GetMemoryType() const override {
+    return AllocatorMemoryType::kHostPageable;
+  }
+
+  // Returns the number of bytes of the size class serving `num_bytes`, or 0
+  // if allocations of `num_bytes` bypass the size classes.
+  static size_t SizeClassBytes(size_t num_bytes);
+
+ private:
+  class CentralCache;
+  class ThreadCache;
+
+  // Returns the cache of the calling thread for this allocator.
+  ThreadCache* GetThreadCache();
+
+  // Allocates and frees memory that is not served from a size class.
+  void* AllocateLarge(size_t alignment, size_t num_bytes);
+  void DeallocateLarge(void* ptr);
+
+  // Whether allocations are accounted for. Like for the default CPU
+  // allocator, CPUAllocatorStatsEnabled() is checked on every call, so stats
+  // only cover the allocations made while it is true.
+  bool CollectStats() const {
+    return collect_stats_ || CPUAllocatorStatsEnabled();
+  }
+
+  // Accounts for an allocation of `num_bytes`. Returns false if it would
+  // exceed the bytes limit.
+  bool RecordAllocation(size_t num_bytes);
+  void RecordDeallocation(size_t num_bytes);
+
+  const uint64_t id_;
+  const int64_t bytes_limit_;
+  // Stats are always collected if `bytes_limit_` is set, to enforce it.
+  const bool collect_stats_;
+  const std::shared_ptr<CentralCache> central_;
+
+  std::atomic<int64_t> num_allocs_{0};
+  std::atomic<int64_t> bytes_in_use_{0};
+  std::atomic<int64_t> peak_bytes_in_use_{0};
+  std::atomic<int64_t> largest_alloc_size_{0};
+
+  // Sizes of the allocations that bypass the size classes. Only tracked while
+  // stats are collected.
+  mutable mutex mu_;
+  absl::flat_hash_map<const void*, size_t> large_allocations_
+      TF_GUARDED_BY(mu_);
+
+  ThreadCachingCPUAllocator(const ThreadCachingCPUAllocator&) = delete;
+  void operator=(const ThreadCachingCPUAllocator&) = delete;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_THREAD_CACHING_CPU_ALLOCATOR_H_
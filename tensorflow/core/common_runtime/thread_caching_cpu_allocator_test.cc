@@ -0,0 +1,240 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/thread_caching_cpu_allocator.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/threadpool.h"
+
+namespace tensorflow {
+namespace {
+
+// Enables the collection of CPU allocator stats while in scope.
+class ScopedCPUAllocatorStats {
+ public:
+  ScopedCPUAllocatorStats() { EnableCPUAllocatorStats(); }
+  ~ScopedCPUAllocatorStats() { DisableCPUAllocatorStats(); }
+};
+
+TEST(ThreadCachingCPUAllocatorTest, SizeClasses) {
+  EXPECT_EQ(ThreadCachingCPUAllocator::SizeClassBytes(0), 64);
+  EXPECT_EQ(ThreadCachingCPUAllocator::SizeClassBytes(1), 64);
+  EXPECT_EQ(ThreadCachingCPUAllocator::SizeClassBytes(64), 64);
+  EXPECT_EQ(ThreadCachingCPUAllocator::SizeClassBytes(65), 128);
+  EXPECT_EQ(ThreadCachingCPUAllocator::SizeClassBytes(1024), 1024);
+  EXPECT_EQ(ThreadCachingCPUAllocator::SizeClassBytes(1025), 1280);
+  EXPECT_EQ(ThreadCachingCPUAllocator::SizeClassBytes(5000), 5120);
+  EXPECT_EQ(ThreadCachingCPUAllocator::SizeClassBytes(
+                ThreadCachingCPUAllocator::kMaxSizeClassBytes),
+            ThreadCachingCPUAllocator::kMaxSizeClassBytes);
+  EXPECT_EQ(ThreadCachingCPUAllocator::SizeClassBytes(
+                ThreadCachingCPUAllocator::kMaxSizeClassBytes + 1),
+            0);
+}
+
+TEST(ThreadCachingCPUAllocatorTest, AllocatesAlignedMemory) {
+  ThreadCachingCPUAllocator allocator({});
+  std::vector<void*> ptrs;
+  for (size_t num_bytes : {1, 100, 4096, 5000, 100000, 1 << 20}) {
+    void* ptr =
+        allocator.AllocateRaw(Allocator::kAllocatorAlignment, num_bytes);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(
+        reinterpret_cast<uintptr_t>(ptr) % Allocator::kAllocatorAlignment, 0);
+    if (num_bytes <= ThreadCachingCPUAllocator::kMaxSizeClassBytes) {
+      EXPECT_EQ(allocator.AllocatedSizeSlow(ptr),
+                ThreadCachingCPUAllocator::SizeClassBytes(num_bytes));
+    }
+    std::memset(ptr, 0xab, num_bytes);
+    ptrs.push_back(ptr);
+  }
+  void* ptr = allocator.AllocateRaw(/*alignment=*/4096, 100);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % 4096, 0);
+  ptrs.push_back(ptr);
+  for (void* ptr : ptrs) {
+    allocator.DeallocateRaw(ptr);
+  }
+}
+
+TEST(ThreadCachingCPUAllocatorTest, ReusesFreedBlocks) {
+  ThreadCachingCPUAllocator allocator({});
+  void* ptr = allocator.AllocateRaw(Allocator::kAllocatorAlignment, 100);
+  allocator.DeallocateRaw(ptr);
+  void* reused = allocator.AllocateRaw(Allocator::kAllocatorAlignment, 120);
+  EXPECT_EQ(reused, ptr);
+  allocator.DeallocateRaw(reused);
+}
+
+TEST(ThreadCachingCPUAllocatorTest, NoStatsByDefault) {
+  ThreadCachingCPUAllocator allocator({});
+  EXPECT_FALSE(allocator.GetStats().has_value());
+  EXPECT_FALSE(allocator.ClearStats());
+}
+
+TEST(ThreadCachingCPUAllocatorTest, Stats) {
+  ScopedCPUAllocatorStats stats_enabled;
+  ThreadCachingCPUAllocator allocator({});
+  void* small = allocator.AllocateRaw(Allocator::kAllocatorAlignment, 100);
+  void* large = allocator.AllocateRaw(Allocator::kAllocatorAlignment, 1 << 20);
+  absl::optional<AllocatorStats> stats = allocator.GetStats();
+  ASSERT_TRUE(stats.has_value());
+  EXPECT_EQ(stats->num_allocs, 2);
+  EXPECT_EQ(stats->bytes_in_use, 128 + (1 << 20));
+  EXPECT_EQ(stats->peak_bytes_in_use, 128 + (1 << 20));
+  EXPECT_EQ(stats->largest_alloc_size, 1 << 20);
+  EXPECT_FALSE(stats->bytes_limit.has_value());
+  EXPECT_GT(*stats->pool_bytes, 0);
+  EXPECT_EQ(stats->bytes_reserved, *stats->pool_bytes + (1 << 20));
+
+  allocator.DeallocateRaw(large);
+  stats = allocator.GetStats();
+  EXPECT_EQ(stats->bytes_in_use, 128);
+  EXPECT_EQ(stats->peak_bytes_in_use, 128 + (1 << 20));
+  EXPECT_EQ(stats->bytes_reserved, *stats->pool_bytes);
+
+  EXPECT_TRUE(allocator.ClearStats());
+  stats = allocator.GetStats();
+  EXPECT_EQ(stats->num_allocs, 0);
+  EXPECT_EQ(stats->peak_bytes_in_use, 128);
+  EXPECT_EQ(stats->largest_alloc_size, 0);
+  EXPECT_EQ(stats->peak_bytes_reserved, stats->bytes_reserved);
+
+  allocator.DeallocateRaw(small);
+  EXPECT_EQ(allocator.GetStats()->bytes_in_use, 0);
+}
+
+TEST(ThreadCachingCPUAllocatorTest, StatsFollowGlobalFlag) {
+  ThreadCachingCPUAllocator allocator({});
+  EXPECT_FALSE(allocator.GetStats().has_value());
+  {
+    ScopedCPUAllocatorStats stats_enabled;
+    void* ptr = allocator.AllocateRaw(Allocator::kAllocatorAlignment, 100);
+    absl::optional<AllocatorStats> stats = allocator.GetStats();
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_EQ(stats->num_allocs, 1);
+    EXPECT_EQ(stats->bytes_in_use, 128);
+    allocator.DeallocateRaw(ptr);
+    EXPECT_EQ(allocator.GetStats()->bytes_in_use, 0);
+  }
+  EXPECT_FALSE(allocator.GetStats().has_value());
+}
+
+TEST(ThreadCachingCPUAllocatorTest, BytesLimit) {
+  ThreadCachingCPUAllocator::Options options;
+  options.bytes_limit = 1000;
+  ThreadCachingCPUAllocator allocator(options);
+  // Stats are collected to enforce the limit, even if not enabled globally.
+  ASSERT_TRUE(allocator.GetStats().has_value());
+  EXPECT_EQ(allocator.GetStats()->bytes_limit, 1000);
+  void* first = allocator.AllocateRaw(Allocator::kAllocatorAlignment, 512);
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(allocator.AllocateRaw(Allocator::kAllocatorAlignment, 512),
+            nullptr);
+  EXPECT_EQ(allocator.AllocateRaw(Allocator::kAllocatorAlignment, 1 << 20),
+            nullptr);
+  allocator.DeallocateRaw(first);
+  void* second = allocator.AllocateRaw(Allocator::kAllocatorAlignment, 512);
+  EXPECT_NE(second, nullptr);
+  allocator.DeallocateRaw(second);
+}
+
+TEST(ThreadCachingCPUAllocatorTest, FreesAcrossThreads) {
+  ScopedCPUAllocatorStats stats_enabled;
+  ThreadCachingCPUAllocator allocator({});
+  constexpr int kNumThreads = 8;
+  constexpr int kNumAllocations = 1000;
+  std::vector<std::vector<void*>> ptrs(kNumThreads);
+  {
+    thread::ThreadPool pool(Env::Default(), "allocate", kNumThreads);
+    for (int t = 0; t < kNumThreads; ++t) {
+      pool.Schedule([&allocator, &ptrs, t]() {
+        for (int i = 0; i < kNumAllocations; ++i) {
+          ptrs[t].push_back(allocator.AllocateRaw(
+              Allocator::kAllocatorAlignment, 64 * (1 + i % 100)));
+        }
+      });
+    }
+  }
+  {
+    // Frees the blocks of each thread on another one.
+    thread::ThreadPool pool(Env::Default(), "deallocate", kNumThreads);
+    for (int t = 0; t < kNumThreads; ++t) {
+      pool.Schedule([&allocator, &ptrs, t]() {
+        for (void* ptr : ptrs[(t + 1) % kNumThreads]) {
+          allocator.DeallocateRaw(ptr);
+        }
+      });
+    }
+  }
+  EXPECT_EQ(allocator.GetStats()->bytes_in_use, 0);
+  EXPECT_EQ(allocator.GetStats()->num_allocs, kNumThreads * kNumAllocations);
+}
+
+TEST(ThreadCachingCPUAllocatorTest, ThreadCachesOutliveAllocator) {
+  for (int i = 0; i < 3; ++i) {
+    ThreadCachingCPUAllocator allocator({});
+    void* ptr = allocator.AllocateRaw(Allocator::kAllocatorAlignment, 100);
+    allocator.DeallocateRaw(ptr);
+  }
+}
+
+// Allocates and frees blocks of a few sizes, keeping each block alive for a
+// number of allocations.
+void BM_Allocation(::testing::benchmark::State& state) {
+  static Allocator* thread_caching_allocator =
+      new ThreadCachingCPUAllocator({});
+  Allocator* allocator =
+      state.range(0) ? thread_caching_allocator : cpu_allocator_base();
+  const int delay = state.range(1);
+
+  const std::vector<size_t> sizes = {64, 256, 1024, 4096, 16384, 512, 128};
+  std::vector<void*> ptrs(delay, nullptr);
+  int size_index = 0;
+  int ptr_index = 0;
+  for (auto s : state) {
+    if (ptrs[ptr_index] != nullptr) {
+      allocator->DeallocateRaw(ptrs[ptr_index]);
+    }
+    ptrs[ptr_index] = allocator->AllocateRaw(
+        Allocator::kAllocatorAlignment, sizes[size_index++ % sizes.size()]);
+    ptr_index = (ptr_index + 1) % delay;
+  }
+  for (void* ptr : ptrs) {
+    if (ptr != nullptr) {
+      allocator->DeallocateRaw(ptr);
+    }
+  }
+  state.SetLabel(allocator->Name());
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_Allocation)
+    ->ArgPair(0, 1)
+    ->ArgPair(1, 1)
+    ->ArgPair(0, 100)
+    ->ArgPair(1, 100)
+    ->ThreadRange(1, 16);
+
+}  // namespace
+}  // namespace tensorflow
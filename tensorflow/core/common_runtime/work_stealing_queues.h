@@ -0,0 +1,142 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_WORK_STEALING_QUEUES_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_WORK_STEALING_QUEUES_H_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// A fixed set of double-ended queues, one per worker slot, for distributing
+// work among a bounded number of workers.
+//
+// A worker first claims a slot with `TryAcquireWorker()`. It pushes new work
+// to the back of its own deque and pops from the back as well, so the most
+// recently produced (and likely cache-hot) item runs next. When its own deque
+// is empty, `Pop()` steals the oldest item from the front of another slot's
+// deque. A worker that finds no work calls `ReleaseWorker()`.
+//
+// Producers that push work and then fail to acquire a slot rely on the active
+// workers to drain it. To avoid losing that work, a worker must check
+// `Empty()` after releasing its slot, and reacquire a slot if it is not.
+//
+// Each deque is protected by its own mutex, so contention is limited to a
+// thief and the owner of the deque it steals from.
+template <typename T>
+class WorkStealingQueues {
+ public:
+  explicit WorkStealingQueues(int num_workers)
+      : num_workers_(num_workers), slots_(new Slot[num_workers]) {
+    DCHECK_GT(num_workers, 0);
+  }
+
+  WorkStealingQueues(const WorkStealingQueues&) = delete;
+  void operator=(const WorkStealingQueues&) = delete;
+
+  int num_workers() const { return num_workers_; }
+
+  // Claims an inactive worker slot and returns its index, or -1 if every slot
+  // is active.
+  //
+  // A producer pushes and then reads `active`, while a releasing worker clears
+  // `active` and then reads the queue size. Every one of these accesses is
+  // sequentially consistent, so at least one of them observes the other's
+  // write and pushed work is never left without a worker.
+  int TryAcquireWorker() {
+    for (int i = 0; i < num_workers_; ++i) {
+      bool expected = false;
+      if (!slots_[i].active.load(std::memory_order_seq_cst) &&
+          slots_[i].active.compare_exchange_strong(expected, true,
+                                                   std::memory_order_seq_cst)) {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  // Returns a slot claimed by `TryAcquireWorker()`.
+  void ReleaseWorker(int worker) {
+    DCHECK(slots_[worker].active.load(std::memory_order_relaxed));
+    slots_[worker].active.store(false, std::memory_order_seq_cst);
+  }
+
+  // Adds `item` to the back of the deque for `worker`. `worker` need not be
+  // active.
+  void Push(int worker, T item) {
+    Slot& slot = slots_[worker];
+    mutex_lock l(slot.mu);
+    slot.items.push_back(std::move(item));
+    size_.fetch_add(1, std::memory_order_seq_cst);
+  }
+
+  // Removes and returns the most recently pushed item of `worker`'s deque or,
+  // if that deque is empty, steals the oldest item of another deque. Returns
+  // std::nullopt if no item was found.
+  std::optional<T> Pop(int worker) {
+    if (size_.load() == 0) return std::nullopt;
+    {
+      Slot& slot = slots_[worker];
+      mutex_lock l(slot.mu);
+      if (!slot.items.empty()) {
+        std::optional<T> item(std::move(slot.items.back()));
+        slot.items.pop_back();
+        size_.fetch_sub(1);
+        return item;
+      }
+    }
+    for (int i = 1; i < num_workers_; ++i) {
+      Slot& victim = slots_[(worker + i) % num_workers_];
+      mutex_lock l(victim.mu);
+      if (!victim.items.empty()) {
+        std::optional<T> item(std::move(victim.items.front()));
+        victim.items.pop_front();
+        size_.fetch_sub(1);
+        return item;
+      }
+    }
+    return std::nullopt;
+  }
+
+  // Returns true if no item is queued. Items pushed concurrently may or may
+  // not be observed.
+  bool Empty() const { return size_.load(std::memory_order_seq_cst) == 0; }
+
+ private:
+  // Padded to a cache line so that workers touching their own slots do not
+  // contend with each other.
+  struct alignas(64) Slot {
+    mutex mu;
+    std::deque<T> items TF_GUARDED_BY(mu);
+    std::atomic<bool> active{false};
+  };
+
+  const int num_workers_;
+  const std::unique_ptr<Slot[]> slots_;
+  std::atomic<int64_t> size_{0};
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_WORK_STEALING_QUEUES_H_
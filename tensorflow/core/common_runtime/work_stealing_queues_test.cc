@@ -0,0 +1,92 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/work_stealing_queues.h"
+
+#include <atomic>
+#include <optional>
+
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/threadpool.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(WorkStealingQueuesTest, OwnerPopsMostRecentItem) {
+  WorkStealingQueues<int> queues(2);
+  queues.Push(0, 1);
+  queues.Push(0, 2);
+  queues.Push(0, 3);
+  EXPECT_EQ(queues.Pop(0), 3);
+  EXPECT_EQ(queues.Pop(0), 2);
+  EXPECT_EQ(queues.Pop(0), 1);
+  EXPECT_EQ(queues.Pop(0), std::nullopt);
+  EXPECT_TRUE(queues.Empty());
+}
+
+TEST(WorkStealingQueuesTest, ThiefStealsOldestItem) {
+  WorkStealingQueues<int> queues(3);
+  queues.Push(1, 1);
+  queues.Push(1, 2);
+  EXPECT_EQ(queues.Pop(0), 1);
+  EXPECT_EQ(queues.Pop(2), 2);
+  EXPECT_EQ(queues.Pop(1), std::nullopt);
+}
+
+TEST(WorkStealingQueuesTest, AcquireAndReleaseWorkers) {
+  WorkStealingQueues<int> queues(2);
+  const int first = queues.TryAcquireWorker();
+  const int second = queues.TryAcquireWorker();
+  EXPECT_NE(first, -1);
+  EXPECT_NE(second, -1);
+  EXPECT_NE(first, second);
+  EXPECT_EQ(queues.TryAcquireWorker(), -1);
+  queues.ReleaseWorker(first);
+  EXPECT_EQ(queues.TryAcquireWorker(), first);
+}
+
+TEST(WorkStealingQueuesTest, ConcurrentWorkersDrainAllItems) {
+  constexpr int kNumWorkers = 4;
+  constexpr int kItemsPerWorker = 10000;
+  WorkStealingQueues<int> queues(kNumWorkers);
+  std::atomic<int64_t> sum{0};
+  std::atomic<int> num_popped{0};
+  {
+    thread::ThreadPool pool(Env::Default(), "test", kNumWorkers);
+    for (int w = 0; w < kNumWorkers; ++w) {
+      pool.Schedule([&queues, &sum, &num_popped, w]() {
+        // Every worker pushes its own items and pops until the total has been
+        // consumed, stealing from the others once its deque runs dry.
+        for (int i = 0; i < kItemsPerWorker; ++i) {
+          queues.Push(w, i);
+        }
+        while (num_popped.load() < kNumWorkers * kItemsPerWorker) {
+          if (std::optional<int> item = queues.Pop(w)) {
+            sum += *item;
+            ++num_popped;
+          }
+        }
+      });
+    }
+  }
+  EXPECT_EQ(num_popped.load(), kNumWorkers * kItemsPerWorker);
+  EXPECT_EQ(sum.load(), static_cast<int64_t>(kNumWorkers) * kItemsPerWorker *
+                            (kItemsPerWorker - 1) / 2);
+  EXPECT_TRUE(queues.Empty());
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,262 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/autotune_coordinator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
+#include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Weight of pipelines whose demand is not known yet.
+constexpr double kUnknownDemandWeight = 1.0;
+
+// Minimum weight of pipelines with a known demand, so that pipelines whose
+// consumer is currently idle keep a small share of the budgets.
+constexpr double kMinDemandWeight = 0.1;
+
+double DemandWeight(double demand) {
+  if (demand <= 0.0) {
+    return kUnknownDemandWeight;
+  }
+  return std::max(demand, kMinDemandWeight);
+}
+
+}  // namespace
+
+AutotuneCoordinator::AutotuneCoordinator(
+    const Env& env, std::function<int64_t()> cpu_budget_func,
+    std::function<int64_t()> available_ram_func,
+    absl::Duration rebalance_period)
+    : env_(env),
+      cpu_budget_func_(std::move(cpu_budget_func)),
+      available_ram_func_(std::move(available_ram_func)),
+      rebalance_period_us_(absl::ToInt64Microseconds(rebalance_period)) {}
+
+AutotuneCoordinator& AutotuneCoordinator::Global() {
+  static AutotuneCoordinator* coordinator = new AutotuneCoordinator(
+      *Env::Default(), [] { return GetCpuBudget(); },
+      [] { return port::AvailableRam(); });
+  return *coordinator;
+}
+
+double AutotuneCoordinator::EstimateDemand(model::Model& model) {
+  std::shared_ptr<model::Node> output = model.output();
+  if (!output) {
+    return 0.0;
+  }
+  const double target_time_nsec = model.ComputeTargetTimeNsec();
+  if (target_time_nsec <= 0.0) {
+    return 0.0;
+  }
+  return output->TotalProcessingTime(/*processing_times=*/nullptr) /
+         target_time_nsec;
+}
+
+void AutotuneCoordinator::Register(std::shared_ptr<model::Model> model,
+                                   double ram_budget_share) {
+  const model::Model* key = model.get();
+  Register(key, ram_budget_share,
+           [model = std::weak_ptr<model::Model>(model)]() {
+             std::shared_ptr<model::Model> locked_model = model.lock();
+             return locked_model ? EstimateDemand(*locked_model) : 0.0;
+           });
+}
+
+void AutotuneCoordinator::Register(const model::Model* model,
+                                   double ram_budget_share,
+                                   std::function<double()> demand_func) {
+  mutex_lock l(mu_);
+  Pipeline& pipeline = pipelines_[model];
+  pipeline.demand_func = std::move(demand_func);
+  pipeline.ram_budget_share = ram_budget_share;
+  pipelines_changed_ = true;
+}
+
+void AutotuneCoordinator::Deregister(const model::Model* model) {
+  mutex_lock l(mu_);
+  if (pipelines_.erase(model) > 0) {
+    pipelines_changed_ = true;
+  }
+}
+
+int64_t AutotuneCoordinator::CpuBudget(const model::Model* model) {
+  MaybeRebalance();
+  {
+    tf_shared_lock l(mu_);
+    auto it = pipelines_.find(model);
+    if (it != pipelines_.end()) {
+      return it->second.allocation.cpu_budget;
+    }
+  }
+  return cpu_budget_func_();
+}
+
+int64_t AutotuneCoordinator::RamBudget(const model::Model* model,
+                                       int64_t buffered_bytes) {
+  {
+    mutex_lock l(mu_);
+    auto it = pipelines_.find(model);
+    if (it == pipelines_.end()) {
+      return 0;
+    }
+    it->second.buffered_bytes = buffered_bytes;
+  }
+  MaybeRebalance();
+  tf_shared_lock l(mu_);
+  auto it = pipelines_.find(model);
+  if (it == pipelines_.end()) {
+    return 0;
+  }
+  return it->second.allocation.ram_budget;
+}
+
+std::optional<AutotuneCoordinator::Allocation>
+AutotuneCoordinator::GetAllocation(const model::Model* model) {
+  tf_shared_lock l(mu_);
+  auto it = pipelines_.find(model);
+  if (it == pipelines_.end()) {
+    return std::nullopt;
+  }
+  return it->second.allocation;
+}
+
+int64_t AutotuneCoordinator::NumPipelines() {
+  tf_shared_lock l(mu_);
+  return pipelines_.size();
+}
+
+void AutotuneCoordinator::MaybeRebalance() {
+  {
+    tf_shared_lock l(mu_);
+    if (!pipelines_changed_ &&
+        env_.NowMicros() - last_rebalance_us_ < rebalance_period_us_) {
+      return;
+    }
+  }
+  Rebalance();
+}
+
+void AutotuneCoordinator::Rebalance() {
+  // The demand functions inspect the models, so they are invoked without
+  // holding `mu_`.
+  std::vector<std::pair<const model::Model*, std::function<double()>>>
+      demand_funcs;
+  int64_t total_buffered_bytes = 0;
+  {
+    mutex_lock l(mu_);
+    demand_funcs.reserve(pipelines_.size());
+    for (const auto& [model, pipeline] : pipelines_) {
+      demand_funcs.emplace_back(model, pipeline.demand_func);
+      total_buffered_bytes += pipeline.buffered_bytes;
+    }
+    pipelines_changed_ = false;
+    last_rebalance_us_ = env_.NowMicros();
+  }
+  absl::flat_hash_map<const model::Model*, double> demands;
+  for (const auto& [model, demand_func] : demand_funcs) {
+    demands[model] = std::max(demand_func(), 0.0);
+  }
+  const int64_t cpu_budget = cpu_budget_func_();
+  // Buffered bytes are added back for the same reason as in
+  // `model::Model::Optimize()`: they no longer show up as available RAM.
+  const int64_t ram_budget = available_ram_func_() + total_buffered_bytes;
+
+  mutex_lock l(mu_);
+  double total_weight = 0.0;
+  for (auto& [model, pipeline] : pipelines_) {
+    // Pipelines registered since the demands were collected are weighted as
+    // if their demand were unknown.
+    auto it = demands.find(model);
+    pipeline.allocation.demand = it == demands.end() ? 0.0 : it->second;
+    total_weight += DemandWeight(pipeline.allocation.demand);
+  }
+  std::vector<Allocation*> allocations;
+  allocations.reserve(pipelines_.size());
+  for (auto& [model, pipeline] : pipelines_) {
+    Allocation& allocation = pipeline.allocation;
+    allocation.share = DemandWeight(allocation.demand) / total_weight;
+    allocation.ram_budget = allocation.share * pipeline.ram_budget_share *
+                            static_cast<double>(ram_budget);
+    allocations.push_back(&allocation);
+  }
+  AllocateCores(cpu_budget, allocations);
+}
+
+void AutotuneCoordinator::AllocateCores(
+    int64_t cpu_budget, const std::vector<Allocation*>& allocations) {
+  const int64_t num_pipelines = allocations.size();
+  if (num_pipelines >= cpu_budget) {
+    // Every pipeline gets the one core minimum, which oversubscribes the
+    // cores if there are more pipelines than cores.
+    for (Allocation* allocation : allocations) {
+      allocation->cpu_budget = 1;
+    }
+    return;
+  }
+  // Rounds each share down, keeping the one core minimum, and then hands out
+  // the remaining cores by largest remainder.
+  int64_t total_cores = 0;
+  for (Allocation* allocation : allocations) {
+    const double cores = allocation->share * static_cast<double>(cpu_budget);
+    allocation->cpu_budget =
+        std::max<int64_t>(1, static_cast<int64_t>(std::floor(cores)));
+    total_cores += allocation->cpu_budget;
+  }
+  auto remainder = [cpu_budget](const Allocation* allocation) {
+    return allocation->share * static_cast<double>(cpu_budget) -
+           static_cast<double>(allocation->cpu_budget);
+  };
+  std::vector<Allocation*> by_remainder = allocations;
+  std::sort(by_remainder.begin(), by_remainder.end(),
+            [&remainder](const Allocation* a, const Allocation* b) {
+              return remainder(a) > remainder(b);
+            });
+  // Cores granted by the one core minimum are taken back from the pipelines
+  // that are furthest above their share. This terminates because there are
+  // fewer pipelines than cores.
+  for (auto it = by_remainder.rbegin(); total_cores > cpu_budget;) {
+    if ((*it)->cpu_budget > 1) {
+      --(*it)->cpu_budget;
+      --total_cores;
+    }
+    if (++it == by_remainder.rend()) {
+      it = by_remainder.rbegin();
+    }
+  }
+  for (auto it = by_remainder.begin();
+       it != by_remainder.end() && total_cores < cpu_budget; ++it) {
+    ++(*it)->cpu_budget;
+    ++total_cores;
+  }
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,166 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_AUTOTUNE_COORDINATOR_H_
+#define TENSORFLOW_CORE_DATA_AUTOTUNE_COORDINATOR_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+
+// Splits the process-wide autotuning CPU and RAM budgets across the live
+// `model::Model`s of concurrent input pipelines.
+//
+// Without coordination, each iterator tunes its parallelism and buffer sizes
+// against the budget of the whole machine, so processes that run many
+// pipelines oversubscribe threads and memory. The coordinator instead gives
+// each registered pipeline a share of the budgets proportional to its consumer
+// demand, i.e. the number of CPU cores the pipeline needs to produce elements
+// as fast as its consumer requests them. Pipelines whose demand is not known
+// yet are weighted as if they needed one core.
+//
+// The CPU allocations add up to at most the process-wide CPU budget, except
+// that every pipeline is allocated at least one core: if there are more
+// pipelines than cores, each pipeline gets one core and the cores are
+// oversubscribed.
+//
+// Allocations are recomputed when pipelines register or deregister, and at
+// most once per rebalance period otherwise. Each pipeline's autotuner reads its
+// budgets through `CpuBudget()` and `RamBudget()` before every optimization
+// round, so the parallelism and buffer sizes of all pipelines follow the
+// allocation as pipelines come and go.
+//
+// Example usage:
+//
+//   AutotuneCoordinator& coordinator = AutotuneCoordinator::Global();
+//   coordinator.Register(model, ram_budget_share);
+//   model->OptimizeLoop(
+//       algorithm, [&]() { return coordinator.CpuBudget(model.get()); },
+//       [&](int64_t buffered_bytes) {
+//         return coordinator.RamBudget(model.get(), buffered_bytes);
+//       },
+//       ram_budget_manager, cancellation_manager);
+//   coordinator.Deregister(model.get());
+class AutotuneCoordinator {
+ public:
+  // The share of the process-wide budgets allocated to a pipeline.
+  struct Allocation {
+    // Number of CPU cores the pipeline needs to keep up with its consumer, or
+    // 0 if it is not known yet.
+    double demand = 0.0;
+    // Fraction of the process-wide budgets allocated to the pipeline.
+    double share = 0.0;
+    int64_t cpu_budget = 0;
+    int64_t ram_budget = 0;
+  };
+
+  // `cpu_budget_func` returns the process-wide CPU budget.
+  // `available_ram_func` returns the available RAM which, plus the bytes
+  // buffered by the registered pipelines, is the process-wide RAM budget
+  // before each pipeline's `ram_budget_share` is applied.
+  AutotuneCoordinator(const Env& env, std::function<int64_t()> cpu_budget_func,
+                      std::function<int64_t()> available_ram_func,
+                      absl::Duration rebalance_period = absl::Seconds(1));
+
+  // Returns the coordinator shared by all pipelines in the process.
+  static AutotuneCoordinator& Global();
+
+  // Returns the number of CPU cores `model` needs to keep up with its
+  // consumer, estimated as the processing time of the whole pipeline per
+  // element divided by the target time between consumer requests. Returns 0 if
+  // the model has not observed enough consumer requests yet.
+  static double EstimateDemand(model::Model& model);
+
+  // Registers `model` with a demand estimated by `EstimateDemand()`. The RAM
+  // budget of `model` is its share of `ram_budget_share` of the process-wide
+  // RAM budget.
+  void Register(std::shared_ptr<model::Model> model, double ram_budget_share)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Registers `model` with a demand, in CPU cores, reported by `demand_func`.
+  void Register(const model::Model* model, double ram_budget_share,
+                std::function<double()> demand_func) TF_LOCKS_EXCLUDED(mu_);
+
+  // Deregisters `model`, returning its share to the remaining pipelines.
+  void Deregister(const model::Model* model) TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the CPU budget allocated to `model`, or the process-wide CPU
+  // budget if `model` is not registered.
+  int64_t CpuBudget(const model::Model* model) TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the RAM budget allocated to `model`, which currently buffers
+  // `buffered_bytes` bytes, or 0 if `model` is not registered.
+  int64_t RamBudget(const model::Model* model, int64_t buffered_bytes)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the current allocation of `model`, or `std::nullopt` if it is not
+  // registered.
+  std::optional<Allocation> GetAllocation(const model::Model* model)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of registered pipelines.
+  int64_t NumPipelines() TF_LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct Pipeline {
+    std::function<double()> demand_func;
+    double ram_budget_share = 0.0;
+    // Bytes buffered by the pipeline as of its last `RamBudget()` call.
+    int64_t buffered_bytes = 0;
+    Allocation allocation;
+  };
+
+  // Recomputes the allocations if pipelines have come or gone, or if the
+  // rebalance period has elapsed since the last rebalance.
+  void MaybeRebalance() TF_LOCKS_EXCLUDED(mu_);
+
+  // Recomputes the allocations of all registered pipelines.
+  void Rebalance() TF_LOCKS_EXCLUDED(mu_);
+
+  // Sets the CPU budgets of `allocations` from their shares of `cpu_budget`
+  // cores. Each budget is at least one core, and the budgets add up to
+  // `cpu_budget` unless there are more allocations than cores.
+  static void AllocateCores(int64_t cpu_budget,
+                            const std::vector<Allocation*>& allocations);
+
+  const Env& env_;
+  const std::function<int64_t()> cpu_budget_func_;
+  const std::function<int64_t()> available_ram_func_;
+  const int64_t rebalance_period_us_;
+
+  mutex mu_;
+  absl::flat_hash_map<const model::Model*, Pipeline> pipelines_
+      TF_GUARDED_BY(mu_);
+  // Whether pipelines have been registered or deregistered since the last
+  // rebalance.
+  bool pipelines_changed_ TF_GUARDED_BY(mu_) = false;
+  int64_t last_rebalance_us_ TF_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_AUTOTUNE_COORDINATOR_H_
@@ -0,0 +1,199 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/autotune_coordinator.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/util/fake_clock_env.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr int64_t kCpuBudget = 16;
+constexpr int64_t kAvailableRam = 1000;
+constexpr double kRamBudgetShare = 0.5;
+
+class AutotuneCoordinatorTest : public ::testing::Test {
+ protected:
+  AutotuneCoordinatorTest()
+      : env_(Env::Default()),
+        coordinator_(
+            env_, [] { return kCpuBudget; }, [] { return kAvailableRam; },
+            absl::Seconds(1)) {}
+
+  FakeClockEnv env_;
+  AutotuneCoordinator coordinator_;
+  model::Model model1_;
+  model::Model model2_;
+};
+
+TEST_F(AutotuneCoordinatorTest, UnregisteredPipelineGetsNoRamBudget) {
+  EXPECT_EQ(coordinator_.CpuBudget(&model1_), kCpuBudget);
+  EXPECT_EQ(coordinator_.RamBudget(&model1_, /*buffered_bytes=*/0), 0);
+  EXPECT_EQ(coordinator_.GetAllocation(&model1_), std::nullopt);
+}
+
+TEST_F(AutotuneCoordinatorTest, SplitsBudgetsEvenlyWithoutDemand) {
+  coordinator_.Register(&model1_, kRamBudgetShare, [] { return 0.0; });
+  coordinator_.Register(&model2_, kRamBudgetShare, [] { return 0.0; });
+  EXPECT_EQ(coordinator_.NumPipelines(), 2);
+  EXPECT_EQ(coordinator_.CpuBudget(&model1_), kCpuBudget / 2);
+  EXPECT_EQ(coordinator_.CpuBudget(&model2_), kCpuBudget / 2);
+  EXPECT_EQ(coordinator_.RamBudget(&model1_, /*buffered_bytes=*/0),
+            kRamBudgetShare * kAvailableRam / 2);
+  EXPECT_EQ(coordinator_.RamBudget(&model2_, /*buffered_bytes=*/0),
+            kRamBudgetShare * kAvailableRam / 2);
+}
+
+TEST_F(AutotuneCoordinatorTest, WeightsBudgetsByDemand) {
+  coordinator_.Register(&model1_, kRamBudgetShare, [] { return 3.0; });
+  coordinator_.Register(&model2_, kRamBudgetShare, [] { return 1.0; });
+  EXPECT_EQ(coordinator_.CpuBudget(&model1_), 12);
+  EXPECT_EQ(coordinator_.CpuBudget(&model2_), 4);
+  EXPECT_EQ(coordinator_.RamBudget(&model1_, /*buffered_bytes=*/0), 375);
+  EXPECT_EQ(coordinator_.RamBudget(&model2_, /*buffered_bytes=*/0), 125);
+
+  std::optional<AutotuneCoordinator::Allocation> allocation =
+      coordinator_.GetAllocation(&model1_);
+  ASSERT_TRUE(allocation.has_value());
+  EXPECT_DOUBLE_EQ(allocation->demand, 3.0);
+  EXPECT_DOUBLE_EQ(allocation->share, 0.75);
+  EXPECT_EQ(allocation->cpu_budget, 12);
+  EXPECT_EQ(allocation->ram_budget, 375);
+}
+
+TEST_F(AutotuneCoordinatorTest, RebalancesWhenPipelinesComeAndGo) {
+  coordinator_.Register(&model1_, kRamBudgetShare, [] { return 1.0; });
+  EXPECT_EQ(coordinator_.CpuBudget(&model1_), kCpuBudget);
+
+  coordinator_.Register(&model2_, kRamBudgetShare, [] { return 1.0; });
+  EXPECT_EQ(coordinator_.CpuBudget(&model1_), kCpuBudget / 2);
+
+  coordinator_.Deregister(&model2_);
+  EXPECT_EQ(coordinator_.NumPipelines(), 1);
+  EXPECT_EQ(coordinator_.CpuBudget(&model1_), kCpuBudget);
+  EXPECT_EQ(coordinator_.GetAllocation(&model2_), std::nullopt);
+}
+
+TEST_F(AutotuneCoordinatorTest, RebalancesAfterRebalancePeriod) {
+  double demand1 = 1.0;
+  coordinator_.Register(&model1_, kRamBudgetShare,
+                        [&demand1] { return demand1; });
+  coordinator_.Register(&model2_, kRamBudgetShare, [] { return 1.0; });
+  EXPECT_EQ(coordinator_.CpuBudget(&model1_), kCpuBudget / 2);
+
+  demand1 = 3.0;
+  EXPECT_EQ(coordinator_.CpuBudget(&model1_), kCpuBudget / 2);
+  env_.AdvanceByMicroseconds(absl::ToInt64Microseconds(absl::Seconds(1)));
+  EXPECT_EQ(coordinator_.CpuBudget(&model1_), 12);
+  EXPECT_EQ(coordinator_.CpuBudget(&model2_), 4);
+}
+
+TEST_F(AutotuneCoordinatorTest, UsesRamBudgetShareOfEachPipeline) {
+  coordinator_.Register(&model1_, /*ram_budget_share=*/0.5, [] { return 1.0; });
+  coordinator_.Register(&model2_, /*ram_budget_share=*/0.9, [] { return 1.0; });
+  EXPECT_EQ(coordinator_.RamBudget(&model1_, /*buffered_bytes=*/0), 250);
+  EXPECT_EQ(coordinator_.RamBudget(&model2_, /*buffered_bytes=*/0), 450);
+}
+
+TEST_F(AutotuneCoordinatorTest, CoreMinimumDoesNotExceedCpuBudget) {
+  // Rounding each of the idle pipelines up to one core would allocate more
+  // than `kCpuBudget` cores, so the extra cores come from the busy pipeline.
+  std::vector<std::unique_ptr<model::Model>> models;
+  for (int i = 0; i < kCpuBudget / 2; ++i) {
+    models.push_back(std::make_unique<model::Model>());
+    coordinator_.Register(models.back().get(), kRamBudgetShare,
+                          [] { return 0.01; });
+  }
+  coordinator_.Register(&model1_, kRamBudgetShare, [] { return 10.0; });
+  int64_t total_cpu_budget = coordinator_.CpuBudget(&model1_);
+  for (const auto& model : models) {
+    EXPECT_EQ(coordinator_.CpuBudget(model.get()), 1);
+    total_cpu_budget += coordinator_.CpuBudget(model.get());
+  }
+  EXPECT_EQ(coordinator_.CpuBudget(&model1_), kCpuBudget / 2);
+  EXPECT_EQ(total_cpu_budget, kCpuBudget);
+}
+
+TEST_F(AutotuneCoordinatorTest, CoreMinimumOversubscribesWithManyPipelines) {
+  // Each pipeline needs at least one core, so with more pipelines than cores
+  // the allocations add up to more than `kCpuBudget`.
+  std::vector<std::unique_ptr<model::Model>> models;
+  for (int i = 0; i < 2 * kCpuBudget; ++i) {
+    models.push_back(std::make_unique<model::Model>());
+    coordinator_.Register(models.back().get(), kRamBudgetShare,
+                          [] { return 1.0; });
+  }
+  for (const auto& model : models) {
+    EXPECT_EQ(coordinator_.CpuBudget(model.get()), 1);
+  }
+}
+
+TEST_F(AutotuneCoordinatorTest, IdlePipelinesKeepMinimumShare) {
+  coordinator_.Register(&model1_, kRamBudgetShare, [] { return 0.01; });
+  coordinator_.Register(&model2_, kRamBudgetShare, [] { return 0.9; });
+  EXPECT_EQ(coordinator_.CpuBudget(&model1_), 2);
+  std::optional<AutotuneCoordinator::Allocation> allocation =
+      coordinator_.GetAllocation(&model1_);
+  ASSERT_TRUE(allocation.has_value());
+  EXPECT_DOUBLE_EQ(allocation->share, 0.1);
+}
+
+TEST_F(AutotuneCoordinatorTest, RamBudgetAddsBackBufferedBytes) {
+  coordinator_.Register(&model1_, kRamBudgetShare, [] { return 1.0; });
+  coordinator_.Register(&model2_, kRamBudgetShare, [] { return 1.0; });
+  coordinator_.RamBudget(&model2_, /*buffered_bytes=*/200);
+  env_.AdvanceByMicroseconds(absl::ToInt64Microseconds(absl::Seconds(1)));
+  // The bytes buffered by all pipelines no longer show up as available RAM,
+  // so they are added back to the process-wide budget before it is split.
+  EXPECT_EQ(coordinator_.RamBudget(&model1_, /*buffered_bytes=*/0),
+            kRamBudgetShare * (kAvailableRam + 200) / 2);
+}
+
+TEST(AutotuneCoordinatorEstimateDemandTest, ProcessingTimeOverTargetTime) {
+  model::Model model;
+  EXPECT_EQ(AutotuneCoordinator::EstimateDemand(model), 0.0);
+
+  std::shared_ptr<model::Node> node;
+  model.AddNode(
+      [](model::Node::Args args) {
+        return model::MakeSourceNode(std::move(args));
+      },
+      "source", nullptr, &node);
+  node->add_processing_time(/*delta=*/2000);
+  node->record_element();
+  // Without enough consumer requests, the demand is unknown.
+  EXPECT_EQ(AutotuneCoordinator::EstimateDemand(model), 0.0);
+
+  // The consumer requests an element every microsecond, while producing an
+  // element takes 2 microseconds of CPU time.
+  for (int i = 0; i < 100; ++i) {
+    model.RecordIteratorGapTime(/*duration_usec=*/1);
+  }
+  EXPECT_DOUBLE_EQ(AutotuneCoordinator::EstimateDemand(model), 2.0);
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
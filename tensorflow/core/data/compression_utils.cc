@@ -14,8 +14,14 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/data/compression_utils.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <limits>
+#include <memory>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "tensorflow/core/common_runtime/dma_helper.h"
@@ -23,9 +29,14 @@ limitations under the License.
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/framework/variant_op_registry.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/platform.h"
 #include "tensorflow/core/platform/snappy.h"
 #include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/platform/types.h"
+#if !defined(IS_MOBILE_PLATFORM)
+#include "zstd.h"
+#endif  // IS_MOBILE_PLATFORM
 
 namespace tensorflow {
 namespace data {
@@ -35,6 +46,11 @@ namespace {
 // `UncompressElement` function will determine what to read according to the
 // version.
 constexpr int kCompressedElementVersion = 0;
+// Version written for elements whose `codec` is not SNAPPY. Snappy elements
+// keep version 0 so that they remain readable by older binaries.
+constexpr int kCompressedElementWithCodecVersion = 1;
+// Version written for elements compressed in chunks, with any codec.
+constexpr int kChunkedCompressedElementVersion = 2;
 
 }  // namespace
 
@@ -42,6 +58,13 @@ class Iov {
  public:
   explicit Iov(size_t size) : iov_(size), idx_(0), num_bytes_(0) {}
 
+  explicit Iov(std::vector<struct iovec> iov)
+      : iov_(std::move(iov)), idx_(iov_.size()), num_bytes_(0) {
+    for (const auto& piece : iov_) {
+      num_bytes_ += piece.iov_len;
+    }
+  }
+
   void Add(void* base, size_t len) {
     iov_[idx_].iov_base = base;
     iov_[idx_].iov_len = len;
@@ -55,14 +78,250 @@ class Iov {
 
   size_t NumPieces() const { return iov_.size(); }
 
+  // Splits the bytes pointed to by this `Iov` into consecutive chunks of
+  // `chunk_size` bytes. The last chunk may be smaller.
+  std::vector<Iov> Split(size_t chunk_size) const {
+    std::vector<Iov> chunks;
+    std::vector<struct iovec> chunk;
+    size_t chunk_bytes = 0;
+    for (const auto& piece : iov_) {
+      char* base = static_cast<char*>(piece.iov_base);
+      size_t remaining = piece.iov_len;
+      while (remaining > 0) {
+        const size_t len = std::min(remaining, chunk_size - chunk_bytes);
+        chunk.push_back({base, len});
+        base += len;
+        remaining -= len;
+        chunk_bytes += len;
+        if (chunk_bytes == chunk_size) {
+          chunks.emplace_back(std::move(chunk));
+          chunk.clear();
+          chunk_bytes = 0;
+        }
+      }
+    }
+    if (chunk_bytes > 0) {
+      chunks.emplace_back(std::move(chunk));
+    }
+    return chunks;
+  }
+
  private:
   std::vector<struct iovec> iov_;
   size_t idx_;
   size_t num_bytes_;
 };
 
+namespace {
+
+// Decompresses the snappy data in `compressed` directly into the pieces of
+// `iov`.
+Status SnappyUncompressToIOVec(const std::string& compressed, Iov& iov) {
+  size_t uncompressed_size;
+  if (!port::Snappy_GetUncompressedLength(compressed.data(), compressed.size(),
+                                          &uncompressed_size)) {
+    return errors::Internal(
+        "Could not get snappy uncompressed length. Compressed data size: ",
+        compressed.size());
+  }
+  if (uncompressed_size != static_cast<size_t>(iov.NumBytes())) {
+    return errors::Internal(
+        "Uncompressed size mismatch. Snappy expects ", uncompressed_size,
+        " whereas the tensor metadata suggests ", iov.NumBytes());
+  }
+  if (!port::Snappy_UncompressToIOVec(compressed.data(), compressed.size(),
+                                      iov.Data(), iov.NumPieces())) {
+    return errors::Internal("Failed to perform snappy decompression.");
+  }
+  return absl::OkStatus();
+}
+
+#if !defined(IS_MOBILE_PLATFORM)
+// Compresses the pieces of `iov` into a single zstd frame stored in `out`.
+Status ZstdCompressFromIOVec(Iov& iov, int level, std::string* out) {
+  std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> cctx(ZSTD_createCCtx(),
+                                                            &ZSTD_freeCCtx);
+  if (cctx == nullptr) {
+    return errors::ResourceExhausted("Failed to create a zstd context.");
+  }
+  size_t result =
+      ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_compressionLevel, level);
+  if (!ZSTD_isError(result)) {
+    // Records the content size in the frame header so that readers can
+    // validate it against the component metadata before decompressing.
+    result = ZSTD_CCtx_setPledgedSrcSize(cctx.get(), iov.NumBytes());
+  }
+  if (ZSTD_isError(result)) {
+    return errors::InvalidArgument("Failed to configure zstd: ",
+                                   ZSTD_getErrorName(result));
+  }
+
+  // The output is sized to the worst case, so every call below makes
+  // progress and the frame is complete after the final `ZSTD_e_end`.
+  out->resize(ZSTD_compressBound(iov.NumBytes()));
+  ZSTD_outBuffer output = {out->data(), out->size(), 0};
+  for (size_t i = 0; i < iov.NumPieces(); ++i) {
+    const iovec& piece = iov.Data()[i];
+    ZSTD_inBuffer input = {piece.iov_base, piece.iov_len, 0};
+    while (input.pos < input.size) {
+      result = ZSTD_compressStream2(cctx.get(), &output, &input,
+                                    ZSTD_e_continue);
+      if (ZSTD_isError(result)) {
+        return errors::Internal("Failed to compress using zstd: ",
+                                ZSTD_getErrorName(result));
+      }
+    }
+  }
+  ZSTD_inBuffer empty = {nullptr, 0, 0};
+  do {
+    result = ZSTD_compressStream2(cctx.get(), &output, &empty, ZSTD_e_end);
+    if (ZSTD_isError(result)) {
+      return errors::Internal("Failed to compress using zstd: ",
+                              ZSTD_getErrorName(result));
+    }
+  } while (result != 0 && output.pos < output.size);
+  if (result != 0) {
+    return errors::Internal("zstd output exceeded its compression bound.");
+  }
+  out->resize(output.pos);
+  return absl::OkStatus();
+}
+
+// Decompresses the zstd frame in `compressed` directly into the pieces of
+// `iov`.
+Status ZstdUncompressToIOVec(const std::string& compressed, Iov& iov) {
+  const unsigned long long content_size =  // NOLINT(runtime/int)
+      ZSTD_getFrameContentSize(compressed.data(), compressed.size());
+  if (content_size == ZSTD_CONTENTSIZE_ERROR ||
+      content_size == ZSTD_CONTENTSIZE_UNKNOWN) {
+    return errors::Internal(
+        "Could not get zstd uncompressed length. Compressed data size: ",
+        compressed.size());
+  }
+  if (content_size != static_cast<uint64_t>(iov.NumBytes())) {
+    return errors::Internal("Uncompressed size mismatch. zstd expects ",
+                            content_size,
+                            " whereas the tensor metadata suggests ",
+                            iov.NumBytes());
+  }
+
+  std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> dctx(ZSTD_createDCtx(),
+                                                            &ZSTD_freeDCtx);
+  if (dctx == nullptr) {
+    return errors::ResourceExhausted("Failed to create a zstd context.");
+  }
+  ZSTD_inBuffer input = {compressed.data(), compressed.size(), 0};
+  size_t result = 0;
+  auto decompress = [&](ZSTD_outBuffer& output) -> Status {
+    const size_t input_pos = input.pos;
+    const size_t output_pos = output.pos;
+    result = ZSTD_decompressStream(dctx.get(), &output, &input);
+    if (ZSTD_isError(result)) {
+      return errors::Internal("Failed to perform zstd decompression: ",
+                              ZSTD_getErrorName(result));
+    }
+    if (input.pos == input_pos && output.pos == output_pos) {
+      return errors::Internal("Truncated zstd frame.");
+    }
+    return absl::OkStatus();
+  };
+  for (size_t i = 0; i < iov.NumPieces(); ++i) {
+    const iovec& piece = iov.Data()[i];
+    ZSTD_outBuffer output = {piece.iov_base, piece.iov_len, 0};
+    while (output.pos < output.size) {
+      TF_RETURN_IF_ERROR(decompress(output));
+    }
+  }
+  // Consumes the end of the frame, which produces no more output.
+  ZSTD_outBuffer empty = {nullptr, 0, 0};
+  while (result != 0) {
+    TF_RETURN_IF_ERROR(decompress(empty));
+  }
+  return absl::OkStatus();
+}
+#endif  // IS_MOBILE_PLATFORM
+
+// Compresses the pieces of `iov` with the codec from `options` into `out`.
+Status CompressIov(Iov& iov, const CompressElementOptions& options,
+                   std::string* out) {
+  switch (options.codec) {
+    case CompressedElement::SNAPPY:
+      if (iov.NumBytes() > kuint32max) {
+        return errors::OutOfRange("Encountered dataset element of size ",
+                                  iov.NumBytes(),
+                                  ", exceeding the 4GB Snappy limit.");
+      }
+      if (!port::Snappy_CompressFromIOVec(iov.Data(), iov.NumBytes(), out)) {
+        return errors::Internal("Failed to compress using snappy.");
+      }
+      return absl::OkStatus();
+    case CompressedElement::ZSTD:
+#if !defined(IS_MOBILE_PLATFORM)
+      return ZstdCompressFromIOVec(iov, options.zstd_level, out);
+#else
+      return errors::Unimplemented(
+          "zstd compression is not supported on mobile platforms.");
+#endif  // IS_MOBILE_PLATFORM
+    default:
+      return errors::InvalidArgument("Unsupported compression codec: ",
+                                     options.codec);
+  }
+}
+
+// Decompresses `compressed`, produced by `codec`, into the pieces of `iov`.
+Status UncompressIov(const std::string& compressed,
+                     CompressedElement::Codec codec, Iov& iov) {
+  switch (codec) {
+    case CompressedElement::SNAPPY:
+      return SnappyUncompressToIOVec(compressed, iov);
+    case CompressedElement::ZSTD:
+#if !defined(IS_MOBILE_PLATFORM)
+      return ZstdUncompressToIOVec(compressed, iov);
+#else
+      return errors::Unimplemented(
+          "zstd decompression is not supported on mobile platforms.");
+#endif  // IS_MOBILE_PLATFORM
+    default:
+      return errors::Internal("Unsupported compression codec: ", codec);
+  }
+}
+
+// Runs `fn` for each of `num_chunks` chunks, in parallel on `thread_pool` if
+// it is not null, and returns the first error.
+Status ForEachChunk(int64_t num_chunks, thread::ThreadPool* thread_pool,
+                    const std::function<Status(int64_t)>& fn) {
+  std::vector<Status> statuses(num_chunks);
+  auto run = [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      statuses[i] = fn(i);
+    }
+  };
+  if (thread_pool == nullptr) {
+    run(0, num_chunks);
+  } else {
+    thread_pool->ParallelFor(
+        num_chunks,
+        thread::ThreadPool::SchedulingParams(
+            thread::ThreadPool::SchedulingStrategy::kFixedBlockSize,
+            /*cost_per_unit=*/std::nullopt, /*block_size=*/1),
+        run);
+  }
+  for (const Status& status : statuses) {
+    TF_RETURN_IF_ERROR(status);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
 Status CompressElement(const std::vector<Tensor>& element,
                        CompressedElement* out) {
+  return CompressElement(element, CompressElementOptions(), out);
+}
+
+Status CompressElement(const std::vector<Tensor>& element,
+                       const CompressElementOptions& options,
+                       CompressedElement* out) {
   // First pass: preprocess the non`memcpy`able tensors.
   size_t num_string_tensors = 0;
   size_t num_string_tensor_strings = 0;
@@ -120,24 +379,51 @@ Status CompressElement(const std::vector<Tensor>& element,
     }
   }
 
-  if (iov.NumBytes() > kuint32max) {
-    return errors::OutOfRange("Encountered dataset element of size ",
-                              iov.NumBytes(),
-                              ", exceeding the 4GB Snappy limit.");
-  }
-  if (!port::Snappy_CompressFromIOVec(iov.Data(), iov.NumBytes(),
-                                      out->mutable_data())) {
-    return errors::Internal("Failed to compress using snappy.");
+  if (options.chunk_size > 0 &&
+      iov.NumBytes() > static_cast<size_t>(options.chunk_size)) {
+    std::vector<Iov> chunks = iov.Split(options.chunk_size);
+    std::vector<std::string*> compressed_chunks;
+    compressed_chunks.reserve(chunks.size());
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      compressed_chunks.push_back(out->add_chunks());
+    }
+    TF_RETURN_IF_ERROR(
+        ForEachChunk(chunks.size(), options.thread_pool, [&](int64_t i) {
+          return CompressIov(chunks[i], options, compressed_chunks[i]);
+        }));
+    out->set_chunk_size(options.chunk_size);
+    out->set_version(kChunkedCompressedElementVersion);
+  } else {
+    TF_RETURN_IF_ERROR(CompressIov(iov, options, out->mutable_data()));
+    out->set_version(options.codec == CompressedElement::SNAPPY
+                         ? kCompressedElementVersion
+                         : kCompressedElementWithCodecVersion);
   }
-  out->set_version(kCompressedElementVersion);
+  out->set_codec(options.codec);
   VLOG(3) << "Compressed element from " << iov.NumBytes() << " bytes to "
-          << out->data().size() << " bytes";
+          << out->ByteSizeLong() << " bytes in " << out->chunks_size()
+          << " chunks";
   return absl::OkStatus();
 }
 
 Status UncompressElement(const CompressedElement& compressed,
                          std::vector<Tensor>* out) {
-  if (compressed.version() != kCompressedElementVersion) {
+  return UncompressElement(compressed, /*thread_pool=*/nullptr, out);
+}
+
+Status UncompressElement(const CompressedElement& compressed,
+                         thread::ThreadPool* thread_pool,
+                         std::vector<Tensor>* out) {
+  const bool chunked = compressed.chunk_size() > 0;
+  bool valid_version;
+  if (chunked) {
+    valid_version = compressed.version() == kChunkedCompressedElementVersion;
+  } else if (compressed.codec() == CompressedElement::SNAPPY) {
+    valid_version = compressed.version() == kCompressedElementVersion;
+  } else {
+    valid_version = compressed.version() == kCompressedElementWithCodecVersion;
+  }
+  if (!valid_version) {
     return errors::Internal("Unsupported compressed element version: ",
                             compressed.version());
   }
@@ -190,23 +476,20 @@ Status UncompressElement(const CompressedElement& compressed,
   }
 
   // Step 2: Uncompress into the iovec.
-  const std::string& compressed_data = compressed.data();
-  size_t uncompressed_size;
-  if (!port::Snappy_GetUncompressedLength(
-          compressed_data.data(), compressed_data.size(), &uncompressed_size)) {
-    return errors::Internal(
-        "Could not get snappy uncompressed length. Compressed data size: ",
-        compressed_data.size());
-  }
-  if (uncompressed_size != static_cast<size_t>(iov.NumBytes())) {
-    return errors::Internal(
-        "Uncompressed size mismatch. Snappy expects ", uncompressed_size,
-        " whereas the tensor metadata suggests ", iov.NumBytes());
-  }
-  if (!port::Snappy_UncompressToIOVec(compressed_data.data(),
-                                      compressed_data.size(), iov.Data(),
-                                      iov.NumPieces())) {
-    return errors::Internal("Failed to perform snappy decompression.");
+  if (chunked) {
+    std::vector<Iov> chunks = iov.Split(compressed.chunk_size());
+    if (chunks.size() != static_cast<size_t>(compressed.chunks_size())) {
+      return errors::Internal("Chunk count mismatch. The element has ",
+                              compressed.chunks_size(),
+                              " chunks whereas the tensor metadata suggests ",
+                              chunks.size());
+    }
+    TF_RETURN_IF_ERROR(ForEachChunk(chunks.size(), thread_pool, [&](int64_t i) {
+      return UncompressIov(compressed.chunks(i), compressed.codec(), chunks[i]);
+    }));
+  } else {
+    TF_RETURN_IF_ERROR(
+        UncompressIov(compressed.data(), compressed.codec(), iov));
   }
 
   // Third pass: deserialize nonstring, non`memcpy`able tensors.
@@ -15,21 +15,49 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_COMPRESSION_UTILS_H_
 #define TENSORFLOW_CORE_DATA_COMPRESSION_UTILS_H_
 
+#include <cstdint>
 #include <vector>
 
 #include "tensorflow/core/framework/dataset.pb.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
 namespace data {
 
+// Suggested chunk size for callers which opt into chunked compression.
+inline constexpr int64_t kDefaultCompressionChunkSize = 8 << 20;  // 8MB
+
+struct CompressElementOptions {
+  // Codec used for the element bytes. Snappy is the fastest to decode; zstd
+  // trades some encode speed for a noticeably better ratio.
+  CompressedElement::Codec codec = CompressedElement::SNAPPY;
+  // zstd compression level. Negative levels select zstd's fast modes, which
+  // approach LZ4 speeds. Ignored by other codecs.
+  int zstd_level = 3;
+  // If positive, elements larger than `chunk_size` bytes are split into chunks
+  // which are compressed independently. Smaller elements are compressed into
+  // a single frame as usual. Chunked elements use version 2 of the
+  // `CompressedElement` format, which older binaries reject, so this must
+  // only be set when every reader supports it.
+  int64_t chunk_size = 0;
+  // If set, chunks are compressed in parallel on this thread pool.
+  thread::ThreadPool* thread_pool = nullptr;
+};
+
 // Compresses the components of `element` into the `CompressedElement` proto.
 //
 // In addition to writing the actual compressed bytes, `Compress` fills
 // out the per-component metadata for the `CompressedElement`.
 //
-// Returns an error if the uncompressed size of the element exceeds 4GB.
+// Returns an error if the element is snappy compressed and its uncompressed
+// size exceeds 4GB, or if the codec is not available on this platform.
+Status CompressElement(const std::vector<Tensor>& element,
+                       const CompressElementOptions& options,
+                       CompressedElement* out);
+
+// Same as above, using snappy.
 Status CompressElement(const std::vector<Tensor>& element,
                        CompressedElement* out);
 
@@ -37,6 +65,12 @@ Status CompressElement(const std::vector<Tensor>& element,
 Status UncompressElement(const CompressedElement& compressed,
                          std::vector<Tensor>* out);
 
+// Same as above, uncompressing the chunks of chunked elements in parallel on
+// `thread_pool` if it is not null.
+Status UncompressElement(const CompressedElement& compressed,
+                         thread::ThreadPool* thread_pool,
+                         std::vector<Tensor>* out);
+
 }  // namespace data
 }  // namespace tensorflow
 
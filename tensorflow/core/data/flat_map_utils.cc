@@ -103,10 +103,14 @@ FlatMapRandomAccessHandler::ComputeCardinalities() {
     TF_ASSIGN_OR_RETURN(input_datasets_, MakeInputDatasets());
   }
 
+  // Random access needs the cardinality of every input, so allow the inputs
+  // to do I/O to compute it (e.g. reading the record index of a file).
+  CardinalityOptions options;
+  options.set_compute_level(CardinalityOptions::CARDINALITY_COMPUTE_MODERATE);
   std::vector<int64_t> cumulative_cardinalities;
   cumulative_cardinalities.reserve(input_datasets_.size());
   for (size_t i = 0; i < input_datasets_.size(); ++i) {
-    int64_t input_cardinality = input_datasets_[i]->Cardinality();
+    int64_t input_cardinality = input_datasets_[i]->Cardinality(options);
     if (input_cardinality == kInfiniteCardinality ||
         input_cardinality == kUnknownCardinality) {
       cumulative_cardinalities.push_back(input_cardinality);
@@ -23,6 +23,7 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "tensorflow/core/data/autotune_coordinator.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/rewrite_utils.h"
@@ -85,6 +86,7 @@ void SetRootDatasetParams(const Options& options, RootDataset::Params* params) {
         options.autotune_options().autotune_algorithm();
   }
   int64_t cpu_budget_from_options = options.autotune_options().cpu_budget();
+  params->autotune_cpu_budget_from_options = cpu_budget_from_options;
   if (cpu_budget_from_options == 0) {
     params->autotune_cpu_budget_func = [] { return GetCpuBudget(); };
   } else {
@@ -94,6 +96,8 @@ void SetRootDatasetParams(const Options& options, RootDataset::Params* params) {
   }
   params->autotune_ram_budget_from_options =
       options.autotune_options().ram_budget();
+  params->coordinate_autotune_budgets =
+      experiments.contains("autotune_coordinator");
   double ram_budget_share;
   if (experiments.contains("autotune_buffer_optimization")) {
     // When running this experiment, increase the ram_budget since it already
@@ -346,7 +350,6 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
       RunMode run_mode = ctx->run_mode();
       model_thread_ = ctx->StartThread("tf_data_model", [this, run_mode]() {
         RootDataset::Params params = dataset()->params_;
-        std::function<int64_t(int64_t)> ram_budget_func;
         std::optional<int64_t> raw_ram_budget;
         if (params.autotune_ram_budget_from_options > 0) {
           raw_ram_budget = params.autotune_ram_budget_from_options;
@@ -354,10 +357,15 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
           // Dynamic RAM budget should only apply to tf.data service.
           raw_ram_budget = params.ComputeInitialAutotuneRamBudget();
         }
-        Status status = model_->OptimizeLoop(
-            params.autotune_algorithm, params.autotune_cpu_budget_func,
-            params.ram_budget_share, raw_ram_budget, *ram_budget_manager_,
-            cancellation_manager_.get());
+        Status status;
+        if (params.coordinate_autotune_budgets) {
+          status = CoordinatedOptimizeLoop(params, raw_ram_budget);
+        } else {
+          status = model_->OptimizeLoop(
+              params.autotune_algorithm, params.autotune_cpu_budget_func,
+              params.ram_budget_share, raw_ram_budget, *ram_budget_manager_,
+              cancellation_manager_.get());
+        }
         if (!status.ok()) {
           LOG(WARNING) << "Optimization loop failed: " << status;
         }
@@ -366,6 +374,36 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
     return absl::OkStatus();
   }
 
+  // Runs the optimization loop with the budgets that are not fixed by the
+  // options allocated by the process-wide `AutotuneCoordinator`.
+  Status CoordinatedOptimizeLoop(const RootDataset::Params& params,
+                                 std::optional<int64_t> raw_ram_budget) {
+    AutotuneCoordinator& coordinator = AutotuneCoordinator::Global();
+    const model::Model* model = model_.get();
+    coordinator.Register(model_, params.ram_budget_share);
+    std::function<int64_t()> cpu_budget_func =
+        params.autotune_cpu_budget_func;
+    if (params.autotune_cpu_budget_from_options == 0) {
+      cpu_budget_func = [&coordinator, model]() {
+        return coordinator.CpuBudget(model);
+      };
+    }
+    std::function<int64_t(int64_t)> ram_budget_func =
+        [&coordinator, model](int64_t buffered_bytes) {
+          return coordinator.RamBudget(model, buffered_bytes);
+        };
+    if (raw_ram_budget.has_value()) {
+      ram_budget_func = [ram_budget = raw_ram_budget.value()](
+                            int64_t buffered_bytes) { return ram_budget; };
+    }
+    Status status = model_->OptimizeLoop(
+        params.autotune_algorithm, std::move(cpu_budget_func),
+        std::move(ram_budget_func), *ram_budget_manager_,
+        cancellation_manager_.get());
+    coordinator.Deregister(model);
+    return status;
+  }
+
   std::shared_ptr<model::Model> model_ = nullptr;
   // `ram_budget_manager_` coordinates the memory budget and allocation
   // between prefetch legacy autotune and `tensorflow::data::model::Model`
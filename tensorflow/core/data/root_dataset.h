@@ -37,7 +37,11 @@ class RootDataset : public DatasetBase {
     model::AutotuneAlgorithm autotune_algorithm;
     std::function<int64_t()> autotune_cpu_budget_func;
     double ram_budget_share;
+    int64_t autotune_cpu_budget_from_options = 0;
     int64_t autotune_ram_budget_from_options;
+    // Whether budgets not fixed by the options are split with the other
+    // pipelines in the process by the `AutotuneCoordinator`.
+    bool coordinate_autotune_budgets = false;
     int64_t max_intra_op_parallelism = 1;
     int64_t private_threadpool_size = 0;
 
@@ -99,18 +99,26 @@ Status ReadElementsFromCheckpoint(IteratorContext* ctx,
                                   IteratorStateReader* reader,
                                   StringPiece key_prefix,
                                   std::vector<std::vector<Tensor>>* elements) {
+  DCHECK(elements->empty());
+  return ReadElementsFromCheckpoint(
+      ctx, reader, key_prefix, [elements](std::vector<Tensor> element) {
+        elements->push_back(std::move(element));
+        return absl::OkStatus();
+      });
+}
+
+Status ReadElementsFromCheckpoint(
+    IteratorContext* ctx, IteratorStateReader* reader, StringPiece key_prefix,
+    const std::function<Status(std::vector<Tensor>)>& callback) {
   int64_t num_elements;
   TF_RETURN_IF_ERROR(
       reader->ReadScalar(key_prefix, kNumElements, &num_elements));
-  DCHECK(elements->empty());
-  elements->reserve(num_elements);
   for (int i = 0; i < num_elements; ++i) {
     std::string element_prefix = absl::StrCat(key_prefix, "::", i);
     int64_t num_components;
     TF_RETURN_IF_ERROR(
         reader->ReadScalar(element_prefix, kNumComponents, &num_components));
-    elements->emplace_back();
-    std::vector<Tensor>& element = elements->at(i);
+    std::vector<Tensor> element;
     element.reserve(num_components);
     for (int j = 0; j < num_components; ++j) {
       element.emplace_back();
@@ -118,14 +126,13 @@ Status ReadElementsFromCheckpoint(IteratorContext* ctx,
           ctx->flr(), element_prefix, absl::StrCat(kComponent, "[", j, "]"),
           &element.back()));
     }
+    TF_RETURN_IF_ERROR(callback(std::move(element)));
   }
   return absl::OkStatus();
 }
 
 Status WriteElement(IteratorStateWriter* writer, StringPiece key_prefix,
-                    const std::vector<std::vector<Tensor>>& elements,
-                    int64_t index) {
-  const std::vector<Tensor>& element = elements[index];
+                    const std::vector<Tensor>& element, int64_t index) {
   std::string element_prefix = absl::StrCat(key_prefix, "::", index);
   TF_RETURN_IF_ERROR(
       writer->WriteScalar(element_prefix, kNumComponents, element.size()));
@@ -142,7 +149,20 @@ Status WriteElementsToCheckpoint(
   TF_RETURN_IF_ERROR(
       writer->WriteScalar(key_prefix, kNumElements, elements.size()));
   for (int i = 0; i < elements.size(); ++i) {
-    TF_RETURN_IF_ERROR(WriteElement(writer, key_prefix, elements, i));
+    TF_RETURN_IF_ERROR(WriteElement(writer, key_prefix, elements[i], i));
+  }
+  return absl::OkStatus();
+}
+
+Status WriteElementsToCheckpoint(
+    IteratorStateWriter* writer, StringPiece key_prefix, int64_t num_elements,
+    const std::function<Status(int64_t, std::vector<Tensor>*)>& get_element) {
+  TF_RETURN_IF_ERROR(
+      writer->WriteScalar(key_prefix, kNumElements, num_elements));
+  for (int64_t i = 0; i < num_elements; ++i) {
+    std::vector<Tensor> element;
+    TF_RETURN_IF_ERROR(get_element(i, &element));
+    TF_RETURN_IF_ERROR(WriteElement(writer, key_prefix, element, i));
   }
   return absl::OkStatus();
 }
@@ -154,7 +174,21 @@ Status UpdateCheckpointElements(
   TF_RETURN_IF_ERROR(
       writer->WriteScalar(key_prefix, kNumElements, elements.size()));
   for (int64_t i : checkpoint_indices) {
-    TF_RETURN_IF_ERROR(WriteElement(writer, key_prefix, elements, i));
+    TF_RETURN_IF_ERROR(WriteElement(writer, key_prefix, elements[i], i));
+  }
+  return absl::OkStatus();
+}
+
+Status UpdateCheckpointElements(
+    IteratorStateWriter* writer, StringPiece key_prefix, int64_t num_elements,
+    const absl::flat_hash_set<int64_t>& checkpoint_indices,
+    const std::function<Status(int64_t, std::vector<Tensor>*)>& get_element) {
+  TF_RETURN_IF_ERROR(
+      writer->WriteScalar(key_prefix, kNumElements, num_elements));
+  for (int64_t i : checkpoint_indices) {
+    std::vector<Tensor> element;
+    TF_RETURN_IF_ERROR(get_element(i, &element));
+    TF_RETURN_IF_ERROR(WriteElement(writer, key_prefix, element, i));
   }
   return absl::OkStatus();
 }
@@ -17,6 +17,7 @@ limitations under the License.
 #define TENSORFLOW_CORE_DATA_SERIALIZATION_UTILS_H_
 
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -42,6 +43,12 @@ Status ReadElementsFromCheckpoint(IteratorContext* ctx,
                                   StringPiece key_prefix,
                                   std::vector<std::vector<Tensor>>* elements);
 
+// Same as above, but passes the elements to `callback` one at a time instead of
+// materializing all of them.
+Status ReadElementsFromCheckpoint(
+    IteratorContext* ctx, IteratorStateReader* reader, StringPiece key_prefix,
+    const std::function<Status(std::vector<Tensor>)>& callback);
+
 // Writes dataset elements to the checkpoint writer using the given key prefix.
 // The elements can be read back by passing the same key prefix to
 // ReadElementsFromCheckpoint. Only one list of elements can be written under
@@ -50,6 +57,13 @@ Status WriteElementsToCheckpoint(
     IteratorStateWriter* writer, StringPiece key_prefix,
     const std::vector<std::vector<Tensor>>& elements);
 
+// Same as above, but fetches the `num_elements` elements one at a time through
+// `get_element`, which appends the element with the given index to its output
+// argument.
+Status WriteElementsToCheckpoint(
+    IteratorStateWriter* writer, StringPiece key_prefix, int64_t num_elements,
+    const std::function<Status(int64_t, std::vector<Tensor>*)>& get_element);
+
 // Updates the dataset elements in the checkpoint for given `checkpoint_indices`
 // using the given key prefix, assuming that vector of elements have
 // checkpointed these before. The elements can be read back by passing the same
@@ -59,6 +73,14 @@ Status UpdateCheckpointElements(
     const std::vector<std::vector<Tensor>>& elements,
     const absl::flat_hash_set<int64_t>& checkpoint_indices);
 
+// Same as above, but fetches the elements to update one at a time through
+// `get_element`, which appends the element with the given index to its output
+// argument.
+Status UpdateCheckpointElements(
+    IteratorStateWriter* writer, StringPiece key_prefix, int64_t num_elements,
+    const absl::flat_hash_set<int64_t>& checkpoint_indices,
+    const std::function<Status(int64_t, std::vector<Tensor>*)>& get_element);
+
 // Helper class for reading data from a vector of VariantTensorData objects.
 class VariantTensorDataReader : public IteratorStateReader {
  public:
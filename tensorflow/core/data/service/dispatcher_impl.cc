@@ -104,6 +104,7 @@ constexpr absl::Duration kDefaultIterationGcCheckInterval = absl::Minutes(10);
 constexpr absl::Duration kDefaultIterationGcTimeout = absl::Minutes(5);
 constexpr absl::Duration kDefaultClientTimeout = absl::Minutes(5);
 constexpr absl::Duration kDefaultWorkerTimeout = absl::Minutes(10);
+constexpr int64_t kDefaultJournalCompactionThreshold = 1 << 20;
 
 constexpr std::array<const char*, 8> kNodeNameSharingOps = {
     "HashTable",
@@ -183,6 +184,10 @@ DispatcherConfig ApplyConfigDefaults(const DispatcherConfig& config) {
     new_config.set_worker_max_concurrent_snapshots(
         kDefaultWorkerMaxConcurrentSnapshots);
   }
+  if (new_config.journal_compaction_threshold() == 0) {
+    new_config.set_journal_compaction_threshold(
+        kDefaultJournalCompactionThreshold);
+  }
   return new_config;
 }
 }  // namespace
@@ -248,9 +253,11 @@ Status DataServiceDispatcherImpl::Start() {
     while (!end_of_journal) {
       TF_RETURN_IF_ERROR(ApplyWithoutJournaling(update));
       TF_RETURN_IF_ERROR(reader.Read(update, end_of_journal));
+      ++num_updates_since_journal_compaction_;
     }
     absl::Duration duration = absl::Microseconds(env_->NowMicros() - start);
-    LOG(INFO) << "Restored from journal in " << duration << ".";
+    LOG(INFO) << "Restored from journal in " << duration << " ("
+              << num_updates_since_journal_compaction_ << " updates).";
   }
   for (const auto& iteration : state_.ListIterations()) {
     if (IsDynamicShard(iteration->job->processing_mode)) {
@@ -1378,10 +1385,30 @@ Status DataServiceDispatcherImpl::Apply(const Update& update)
     TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
   if (journal_writer_.has_value()) {
     TF_RETURN_IF_ERROR(journal_writer_.value()->Write(update));
+    ++num_updates_since_journal_compaction_;
   }
   return state_.Apply(update);
 }
 
+Status DataServiceDispatcherImpl::MaybeCompactJournal()
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  if (!journal_writer_.has_value() ||
+      config_.journal_compaction_threshold() < 0 ||
+      num_updates_since_journal_compaction_ <
+          config_.journal_compaction_threshold()) {
+    return absl::OkStatus();
+  }
+  int64_t start = env_->NowMicros();
+  std::vector<Update> updates = state_.ToUpdates();
+  TF_RETURN_IF_ERROR(journal_writer_.value()->Compact(updates));
+  LOG(INFO) << "Compacted the dispatcher journal from "
+            << num_updates_since_journal_compaction_ << " to "
+            << updates.size() << " updates in "
+            << absl::Microseconds(env_->NowMicros() - start) << ".";
+  num_updates_since_journal_compaction_ = 0;
+  return absl::OkStatus();
+}
+
 void DataServiceDispatcherImpl::MaintenanceThread() {
   int64_t next_check_micros = 0;
   while (true) {
@@ -1416,6 +1443,12 @@ void DataServiceDispatcherImpl::MaintenanceThread() {
       }
     }
     DetectMissingWorkers();
+    {
+      Status s = MaybeCompactJournal();
+      if (!s.ok()) {
+        LOG(WARNING) << "Error compacting the dispatcher journal: " << s;
+      }
+    }
     next_check_micros =
         env_->NowMicros() + (config_.job_gc_check_interval_ms() * 1000);
   }
@@ -334,6 +334,9 @@ class DataServiceDispatcherImpl {
   void DetectMissingWorkers() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
   // Scans for old iterations and marks them as finished.
   Status GcOldIterations() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Replaces the journal with a snapshot of `state_` once enough updates have
+  // been journaled since the last compaction.
+  Status MaybeCompactJournal() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
   // Returns true if an iteration should be garbage collected.
   bool ShouldGcIteration(const DispatcherState::Iteration& iteration,
                          int64_t now_us) const;
@@ -391,6 +394,8 @@ class DataServiceDispatcherImpl {
 
   std::optional<std::unique_ptr<JournalWriter>> journal_writer_
       TF_GUARDED_BY(mu_);
+  // Number of updates in the journal since it was last compacted.
+  int64_t num_updates_since_journal_compaction_ TF_GUARDED_BY(mu_) = 0;
   DispatcherState state_ TF_GUARDED_BY(mu_);
   // Condition variable for waking up the gc thread.
   condition_variable maintenance_thread_cv_;
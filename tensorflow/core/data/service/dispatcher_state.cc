@@ -17,6 +17,7 @@ limitations under the License.
 #include <algorithm>
 #include <memory>
 #include <optional>
+#include <queue>
 #include <string>
 #include <vector>
 
@@ -33,6 +34,41 @@ limitations under the License.
 
 namespace tensorflow {
 namespace data {
+namespace {
+
+// Returns the keys of `map` in sorted order, so that `ToUpdates` is
+// deterministic.
+template <class Map>
+std::vector<typename Map::key_type> SortedKeys(const Map& map) {
+  std::vector<typename Map::key_type> keys;
+  keys.reserve(map.size());
+  for (const auto& [key, value] : map) {
+    keys.push_back(key);
+  }
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+
+template <class Set>
+std::vector<typename Set::value_type> Sorted(const Set& set) {
+  std::vector<typename Set::value_type> values(set.begin(), set.end());
+  std::sort(values.begin(), values.end());
+  return values;
+}
+
+template <class T>
+void SetTaskFields(const DispatcherState::Task& task, T& create_task_update) {
+  create_task_update.set_task_id(task.task_id);
+  create_task_update.set_iteration_id(task.iteration->iteration_id);
+  create_task_update.set_worker_address(task.worker_address);
+  *create_task_update.mutable_transfer_servers() = {
+      task.transfer_servers.begin(), task.transfer_servers.end()};
+  *create_task_update.mutable_worker_tags() = {task.worker_tags.begin(),
+                                               task.worker_tags.end()};
+  create_task_update.set_worker_uid(task.worker_uid);
+}
+
+}  // namespace
 
 DispatcherState::DispatcherState()
     : worker_index_resolver_(std::vector<std::string>{}) {}
@@ -88,6 +124,12 @@ Status DispatcherState::Apply(const Update& update) {
     case Update::kCompressionDisabledAtRuntime:
       CompressionDisabledAtRuntime(update.compression_disabled_at_runtime());
       break;
+    case Update::kRestoreIterationState:
+      RestoreIterationState(update.restore_iteration_state());
+      break;
+    case Update::kReserveIds:
+      ReserveIds(update.reserve_ids());
+      break;
     case Update::UPDATE_TYPE_NOT_SET:
       return errors::Internal("Update type not set.");
   }
@@ -110,6 +152,7 @@ void DispatcherState::RegisterWorker(
   std::string address = register_worker.worker_address();
   DCHECK(!workers_.contains(address));
   workers_[address] = std::make_shared<Worker>(register_worker);
+  worker_addresses_.push_back(address);
   tasks_by_worker_[address] =
       absl::flat_hash_map<int64_t, std::shared_ptr<Task>>();
   worker_index_resolver_.AddWorker(address);
@@ -255,6 +298,11 @@ void DispatcherState::CreatePendingTask(
   DCHECK_NE(iteration, nullptr);
   task = std::make_shared<Task>(create_pending_task, iteration);
   iteration->pending_tasks.emplace(task, create_pending_task.starting_round());
+  PendingTask& pending_task = iteration->pending_tasks.back();
+  pending_task.failures = create_pending_task.failures();
+  pending_task.ready_consumers.insert(
+      create_pending_task.ready_consumers().begin(),
+      create_pending_task.ready_consumers().end());
   tasks_by_worker_[create_pending_task.worker_address()][task->task_id] = task;
   next_available_task_id_ = std::max(next_available_task_id_, task_id + 1);
 }
@@ -289,6 +337,7 @@ void DispatcherState::CreateTask(const CreateTaskUpdate& create_task) {
   auto& iteration = iterations_[create_task.iteration_id()];
   DCHECK_NE(iteration, nullptr);
   task = std::make_shared<Task>(create_task, iteration);
+  task->starting_round = create_task.starting_round();
   tasks_by_iteration_[create_task.iteration_id()].push_back(task);
   tasks_by_worker_[create_task.worker_address()][task->task_id] = task;
   next_available_task_id_ = std::max(next_available_task_id_, task_id + 1);
@@ -313,6 +362,179 @@ void DispatcherState::FinishTask(const FinishTaskUpdate& finish_task) {
   iterations_[task->iteration->iteration_id]->finished = all_finished;
 }
 
+void DispatcherState::RestoreIterationState(
+    const RestoreIterationStateUpdate& restore_iteration_state) {
+  std::shared_ptr<Iteration>& iteration =
+      iterations_[restore_iteration_state.iteration_id()];
+  DCHECK(iteration);
+  if (iteration->distributed_epoch_state.has_value()) {
+    DistributedEpochState& state = iteration->distributed_epoch_state.value();
+    DCHECK_EQ(restore_iteration_state.split_repetitions_size(),
+              state.repetitions.size());
+    DCHECK_EQ(restore_iteration_state.split_indices_size(),
+              state.indices.size());
+    state.repetitions.assign(
+        restore_iteration_state.split_repetitions().begin(),
+        restore_iteration_state.split_repetitions().end());
+    state.indices.assign(restore_iteration_state.split_indices().begin(),
+                         restore_iteration_state.split_indices().end());
+  }
+  iteration->last_client_released_micros =
+      restore_iteration_state.last_client_released_micros();
+  iteration->finished = restore_iteration_state.finished();
+}
+
+void DispatcherState::ReserveIds(const ReserveIdsUpdate& reserve_ids) {
+  next_available_job_id_ =
+      std::max(next_available_job_id_, reserve_ids.next_job_id());
+  next_available_iteration_id_ =
+      std::max(next_available_iteration_id_, reserve_ids.next_iteration_id());
+  next_available_iteration_client_id_ =
+      std::max(next_available_iteration_client_id_,
+               reserve_ids.next_iteration_client_id());
+  next_available_task_id_ =
+      std::max(next_available_task_id_, reserve_ids.next_task_id());
+}
+
+std::vector<Update> DispatcherState::ToUpdates() const {
+  std::vector<Update> updates;
+  ReserveIdsUpdate* reserve_ids = updates.emplace_back().mutable_reserve_ids();
+  reserve_ids->set_next_job_id(next_available_job_id_);
+  reserve_ids->set_next_iteration_id(next_available_iteration_id_);
+  reserve_ids->set_next_iteration_client_id(
+      next_available_iteration_client_id_);
+  reserve_ids->set_next_task_id(next_available_task_id_);
+
+  for (const std::string& dataset_id : SortedKeys(datasets_by_id_)) {
+    const Dataset& dataset = *datasets_by_id_.at(dataset_id);
+    RegisterDatasetUpdate* register_dataset =
+        updates.emplace_back().mutable_register_dataset();
+    register_dataset->set_dataset_id(dataset.dataset_id);
+    *register_dataset->mutable_metadata() = dataset.metadata;
+  }
+  for (const std::string& dataset_id :
+       SortedKeys(compression_disabled_at_runtime_)) {
+    CompressionDisabledAtRuntimeUpdate* compression_disabled_at_runtime =
+        updates.emplace_back().mutable_compression_disabled_at_runtime();
+    compression_disabled_at_runtime->set_dataset_id(dataset_id);
+    compression_disabled_at_runtime->set_compression_disabled(
+        compression_disabled_at_runtime_.at(dataset_id));
+  }
+  // Workers are registered in their original order, since it determines the
+  // worker indices of addresses with dynamic ports.
+  for (const std::string& address : worker_addresses_) {
+    const Worker& worker = *workers_.at(address);
+    RegisterWorkerUpdate* register_worker =
+        updates.emplace_back().mutable_register_worker();
+    register_worker->set_worker_address(worker.address);
+    *register_worker->mutable_transfer_servers() = {
+        worker.transfer_servers.begin(), worker.transfer_servers.end()};
+    *register_worker->mutable_worker_tags() = {worker.tags.begin(),
+                                               worker.tags.end()};
+    register_worker->set_worker_uid(worker.uid);
+  }
+  for (int64_t job_id : SortedKeys(jobs_by_id_)) {
+    const Job& job = *jobs_by_id_.at(job_id);
+    CreateJobUpdate* create_job = updates.emplace_back().mutable_create_job();
+    create_job->set_job_id(job.id);
+    create_job->set_job_name(job.job_name);
+    create_job->set_dataset_id(job.dataset_id);
+    *create_job->mutable_processing_mode_def() = job.processing_mode;
+    if (job.num_consumers.has_value()) {
+      create_job->set_num_consumers(job.num_consumers.value());
+    }
+    create_job->set_target_workers(job.target_workers);
+    create_job->set_use_cross_trainer_cache(job.use_cross_trainer_cache);
+  }
+  // Iterations are created in id order, so that the latest iteration for a
+  // key replaces garbage collected ones.
+  const std::vector<int64_t> iteration_ids = SortedKeys(iterations_);
+  for (int64_t iteration_id : iteration_ids) {
+    const Iteration& iteration = *iterations_.at(iteration_id);
+    CreateIterationUpdate* create_iteration =
+        updates.emplace_back().mutable_create_iteration();
+    create_iteration->set_iteration_id(iteration.iteration_id);
+    create_iteration->set_job_id(iteration.job->id);
+    create_iteration->set_repetition(iteration.iteration_key.repetition);
+    if (iteration.distributed_epoch_state.has_value()) {
+      create_iteration->set_num_split_providers(
+          iteration.distributed_epoch_state->repetitions.size());
+    }
+  }
+  for (int64_t iteration_client_id : SortedKeys(iterations_for_client_ids_)) {
+    const std::shared_ptr<Iteration>& iteration =
+        iterations_for_client_ids_.at(iteration_client_id);
+    if (!iteration) {
+      continue;
+    }
+    AcquireIterationClientUpdate* acquire_iteration_client =
+        updates.emplace_back().mutable_acquire_iteration_client();
+    acquire_iteration_client->set_iteration_id(iteration->iteration_id);
+    acquire_iteration_client->set_iteration_client_id(iteration_client_id);
+  }
+  for (int64_t iteration_id : iteration_ids) {
+    IterationToUpdates(*iterations_.at(iteration_id), updates);
+  }
+  for (const std::string& path : Sorted(snapshot_paths_)) {
+    updates.emplace_back().mutable_snapshot()->set_path(path);
+  }
+  return updates;
+}
+
+void DispatcherState::IterationToUpdates(const Iteration& iteration,
+                                         std::vector<Update>& updates) const {
+  std::vector<std::shared_ptr<Task>> tasks;
+  if (auto it = tasks_by_iteration_.find(iteration.iteration_id);
+      it != tasks_by_iteration_.end()) {
+    for (const std::shared_ptr<Task>& task : it->second) {
+      CreateTaskUpdate* create_task =
+          updates.emplace_back().mutable_create_task();
+      SetTaskFields(*task, *create_task);
+      create_task->set_starting_round(task->starting_round);
+      tasks.push_back(task);
+    }
+  }
+  std::queue<PendingTask> pending_tasks = iteration.pending_tasks;
+  for (; !pending_tasks.empty(); pending_tasks.pop()) {
+    const PendingTask& pending_task = pending_tasks.front();
+    CreatePendingTaskUpdate* create_pending_task =
+        updates.emplace_back().mutable_create_pending_task();
+    SetTaskFields(*pending_task.task, *create_pending_task);
+    create_pending_task->set_starting_round(pending_task.target_round);
+    create_pending_task->set_failures(pending_task.failures);
+    for (int64_t consumer : Sorted(pending_task.ready_consumers)) {
+      create_pending_task->add_ready_consumers(consumer);
+    }
+    tasks.push_back(pending_task.task);
+  }
+  for (const std::shared_ptr<Task>& task : tasks) {
+    if (task->removed) {
+      updates.emplace_back().mutable_remove_task()->set_task_id(task->task_id);
+    } else if (task->finished) {
+      updates.emplace_back().mutable_finish_task()->set_task_id(task->task_id);
+    }
+  }
+  if (iteration.garbage_collected) {
+    updates.emplace_back()
+        .mutable_garbage_collect_iteration()
+        ->set_iteration_id(iteration.iteration_id);
+  }
+  RestoreIterationStateUpdate* restore_iteration_state =
+      updates.emplace_back().mutable_restore_iteration_state();
+  restore_iteration_state->set_iteration_id(iteration.iteration_id);
+  if (iteration.distributed_epoch_state.has_value()) {
+    const DistributedEpochState& state =
+        iteration.distributed_epoch_state.value();
+    *restore_iteration_state->mutable_split_repetitions() = {
+        state.repetitions.begin(), state.repetitions.end()};
+    *restore_iteration_state->mutable_split_indices() = {state.indices.begin(),
+                                                         state.indices.end()};
+  }
+  restore_iteration_state->set_last_client_released_micros(
+      iteration.last_client_released_micros);
+  restore_iteration_state->set_finished(iteration.finished);
+}
+
 std::string DispatcherState::NextAvailableDatasetId() const {
   return absl::StrCat(next_available_dataset_id_);
 }
@@ -73,6 +73,12 @@ class DispatcherState {
   // Applies the given update to the dispatcher's state.
   Status Apply(const Update& update);
 
+  // Returns a compact sequence of updates which restores the current state
+  // when applied to a new `DispatcherState` with the same config. The result
+  // is proportional to the size of the state rather than to the number of
+  // updates applied so far, and is used to compact the journal.
+  std::vector<Update> ToUpdates() const;
+
   // A dataset registered with the dispatcher.
   struct Dataset {
     explicit Dataset(const std::string& dataset_id,
@@ -325,6 +331,13 @@ class DispatcherState {
   void Snapshot(const SnapshotUpdate& snapshot);
   void CompressionDisabledAtRuntime(const CompressionDisabledAtRuntimeUpdate&
                                         compression_disabled_at_runtime);
+  void RestoreIterationState(
+      const RestoreIterationStateUpdate& restore_iteration_state);
+  void ReserveIds(const ReserveIdsUpdate& reserve_ids);
+
+  // Appends the updates which restore `iteration` and its tasks to `updates`.
+  void IterationToUpdates(const Iteration& iteration,
+                          std::vector<Update>& updates) const;
 
   // Updates the next available dataset ID.
   void UpdateNextAvailableDatasetId();
@@ -335,6 +348,8 @@ class DispatcherState {
 
   // Registered workers, keyed by address.
   absl::flat_hash_map<std::string, std::shared_ptr<Worker>> workers_;
+  // Addresses of registered workers, in registration order.
+  std::vector<std::string> worker_addresses_;
 
   // Assigns an index to each worker according to worker addresses list
   // specified in the dispatcher config.
@@ -40,8 +40,10 @@ using IterationKey = DispatcherState::IterationKey;
 using Job = DispatcherState::Job;
 using Iteration = DispatcherState::Iteration;
 using Task = DispatcherState::Task;
+using ::testing::ElementsAre;
 using ::testing::HasSubstr;
 using ::testing::IsEmpty;
+using ::testing::Lt;
 using ::testing::SizeIs;
 using ::testing::UnorderedElementsAre;
 using ::tsl::testing::StatusIs;
@@ -134,6 +136,50 @@ Status Snapshot(const std::string& path, DispatcherState& state) {
   return state.Apply(update);
 }
 
+Status CreateDynamicShardIteration(int64_t iteration_id, int64_t job_id,
+                                   const std::string& dataset_id,
+                                   DispatcherState& state) {
+  Update create_job;
+  create_job.mutable_create_job()->set_job_id(job_id);
+  create_job.mutable_create_job()->set_dataset_id(dataset_id);
+  create_job.mutable_create_job()->set_job_name(absl::StrCat(job_id));
+  create_job.mutable_create_job()
+      ->mutable_processing_mode_def()
+      ->set_sharding_policy(ProcessingModeDef::DYNAMIC);
+  TF_RETURN_IF_ERROR(state.Apply(create_job));
+  Update create_iteration;
+  create_iteration.mutable_create_iteration()->set_iteration_id(iteration_id);
+  create_iteration.mutable_create_iteration()->set_job_id(job_id);
+  create_iteration.mutable_create_iteration()->set_num_split_providers(1);
+  return state.Apply(create_iteration);
+}
+
+Status ProduceSplit(int64_t iteration_id, int64_t repetition, bool finished,
+                    DispatcherState& state) {
+  Update update;
+  ProduceSplitUpdate* produce_split = update.mutable_produce_split();
+  produce_split->set_iteration_id(iteration_id);
+  produce_split->set_repetition(repetition);
+  produce_split->set_finished(finished);
+  return state.Apply(update);
+}
+
+Status RestoreFromUpdates(const DispatcherState& state,
+                          DispatcherState& restored) {
+  for (const Update& update : state.ToUpdates()) {
+    TF_RETURN_IF_ERROR(restored.Apply(update));
+  }
+  return absl::OkStatus();
+}
+
+std::vector<std::string> SerializeUpdates(const DispatcherState& state) {
+  std::vector<std::string> serialized;
+  for (const Update& update : state.ToUpdates()) {
+    serialized.push_back(update.SerializeAsString());
+  }
+  return serialized;
+}
+
 }  // namespace
 
 TEST(DispatcherState, RegisterDataset) {
@@ -652,5 +698,108 @@ TEST(DispatcherState, GetNumberOfRegisteredWorkers) {
   EXPECT_EQ(state.GetNumberOfRegisteredWorkers(), 2);
 }
 
+TEST(DispatcherState, ToUpdatesRestoresState) {
+  DispatcherState state;
+  TF_ASSERT_OK(RegisterDataset("dataset_id", state));
+  TF_ASSERT_OK(RegisterWorker("worker_a", state));
+  TF_ASSERT_OK(RegisterWorker("worker_b", state));
+  TF_ASSERT_OK(CreateIteration(/*iteration_id=*/1, "dataset_id", state));
+  TF_ASSERT_OK(CreateTask(/*task_id=*/10, /*iteration_id=*/1, "worker_a",
+                          state));
+  TF_ASSERT_OK(CreateTask(/*task_id=*/11, /*iteration_id=*/1, "worker_b",
+                          state));
+  TF_ASSERT_OK(FinishTask(/*task_id=*/10, state));
+  TF_ASSERT_OK(AcquireIterationClientId(/*iteration_id=*/1,
+                                        /*iteration_client_id=*/20, state));
+  TF_ASSERT_OK(AcquireIterationClientId(/*iteration_id=*/1,
+                                        /*iteration_client_id=*/21, state));
+  TF_ASSERT_OK(ReleaseIterationClientId(/*iteration_client_id=*/20,
+                                        /*release_time=*/100, state));
+  TF_ASSERT_OK(Snapshot("snapshot_path", state));
+
+  DispatcherState restored;
+  TF_ASSERT_OK(RestoreFromUpdates(state, restored));
+  EXPECT_EQ(SerializeUpdates(restored), SerializeUpdates(state));
+
+  std::shared_ptr<const Dataset> dataset;
+  TF_EXPECT_OK(restored.DatasetFromId("dataset_id", dataset));
+  EXPECT_EQ(restored.NextAvailableDatasetId(), state.NextAvailableDatasetId());
+  EXPECT_THAT(restored.ListWorkers(), SizeIs(2));
+  std::shared_ptr<const Iteration> iteration;
+  TF_ASSERT_OK(restored.IterationFromId(/*id=*/1, iteration));
+  EXPECT_EQ(iteration->num_clients, 1);
+  EXPECT_EQ(iteration->last_client_released_micros, 100);
+  EXPECT_FALSE(iteration->finished);
+  EXPECT_THAT(restored.ListActiveClientIds(), UnorderedElementsAre(21));
+  std::vector<std::shared_ptr<const Task>> tasks;
+  TF_ASSERT_OK(restored.TasksForIteration(/*iteration_id=*/1, tasks));
+  ASSERT_THAT(tasks, SizeIs(2));
+  EXPECT_TRUE(tasks[0]->finished);
+  EXPECT_FALSE(tasks[1]->finished);
+  TF_ASSERT_OK(restored.TasksForWorker("worker_a", tasks));
+  EXPECT_THAT(tasks, IsEmpty());
+  TF_ASSERT_OK(restored.TasksForWorker("worker_b", tasks));
+  EXPECT_THAT(tasks, SizeIs(1));
+  EXPECT_EQ(restored.ListSnapshotPaths(), state.ListSnapshotPaths());
+}
+
+TEST(DispatcherState, ToUpdatesReservesIds) {
+  DispatcherState state;
+  TF_ASSERT_OK(RegisterDataset("dataset_id", state));
+  TF_ASSERT_OK(RegisterWorker("worker_address", state));
+  TF_ASSERT_OK(CreateIteration(/*iteration_id=*/1, "dataset_id", state));
+  TF_ASSERT_OK(CreateTask(/*task_id=*/10, /*iteration_id=*/1,
+                          "worker_address", state));
+  TF_ASSERT_OK(AcquireIterationClientId(/*iteration_id=*/1,
+                                        state.NextAvailableIterationClientId(),
+                                        state));
+  TF_ASSERT_OK(ReleaseIterationClientId(
+      state.NextAvailableIterationClientId() - 1, /*release_time=*/100, state));
+  Update remove_task;
+  remove_task.mutable_remove_task()->set_task_id(10);
+  TF_ASSERT_OK(state.Apply(remove_task));
+
+  DispatcherState restored;
+  TF_ASSERT_OK(RestoreFromUpdates(state, restored));
+  EXPECT_EQ(restored.NextAvailableJobId(), state.NextAvailableJobId());
+  EXPECT_EQ(restored.NextAvailableIterationId(),
+            state.NextAvailableIterationId());
+  EXPECT_EQ(restored.NextAvailableIterationClientId(),
+            state.NextAvailableIterationClientId());
+  EXPECT_EQ(restored.NextAvailableTaskId(), state.NextAvailableTaskId());
+  std::shared_ptr<const Task> task;
+  EXPECT_THAT(restored.TaskFromId(/*id=*/10, task),
+              StatusIs(error::NOT_FOUND));
+}
+
+TEST(DispatcherState, ToUpdatesCompactsSplits) {
+  constexpr int64_t kNumSplits = 1000;
+  DispatcherState state;
+  TF_ASSERT_OK(RegisterDataset("dataset_id", state));
+  TF_ASSERT_OK(CreateDynamicShardIteration(/*iteration_id=*/1, /*job_id=*/2,
+                                           "dataset_id", state));
+  for (int64_t i = 0; i < kNumSplits; ++i) {
+    TF_ASSERT_OK(ProduceSplit(/*iteration_id=*/1, /*repetition=*/0,
+                              /*finished=*/false, state));
+  }
+  TF_ASSERT_OK(ProduceSplit(/*iteration_id=*/1, /*repetition=*/0,
+                            /*finished=*/true, state));
+  for (int64_t i = 0; i < kNumSplits; ++i) {
+    TF_ASSERT_OK(ProduceSplit(/*iteration_id=*/1, /*repetition=*/1,
+                              /*finished=*/false, state));
+  }
+  EXPECT_THAT(state.ToUpdates(), SizeIs(Lt(10)));
+
+  DispatcherState restored;
+  TF_ASSERT_OK(RestoreFromUpdates(state, restored));
+  std::shared_ptr<const Iteration> iteration;
+  TF_ASSERT_OK(restored.IterationFromId(/*id=*/1, iteration));
+  ASSERT_TRUE(iteration->distributed_epoch_state.has_value());
+  EXPECT_THAT(iteration->distributed_epoch_state->repetitions,
+              ElementsAre(1));
+  EXPECT_THAT(iteration->distributed_epoch_state->indices,
+              ElementsAre(kNumSplits));
+}
+
 }  // namespace data
 }  // namespace tensorflow
@@ -20,8 +20,12 @@ limitations under the License.
 #include <string>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "tensorflow/core/data/service/journal.pb.h"
 #include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/lib/io/record_writer.h"
@@ -29,12 +33,15 @@ limitations under the License.
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/regexp.h"
+#include "tsl/platform/statusor.h"
 
 namespace tensorflow {
 namespace data {
 
 namespace {
 constexpr StringPiece kJournal = "journal";
+constexpr StringPiece kSnapshot = "snapshot";
+constexpr StringPiece kTempFileSuffix = ".tmp";
 
 Status ParseSequenceNumber(const std::string& journal_file,
                            int64_t* sequence_number) {
@@ -44,6 +51,84 @@ Status ParseSequenceNumber(const std::string& journal_file,
   }
   return absl::OkStatus();
 }
+
+// Sequence numbers of the journal files and snapshots in a journal directory.
+struct JournalDirContents {
+  std::vector<int64_t> journal_files;
+  std::vector<int64_t> snapshots;
+};
+
+absl::StatusOr<JournalDirContents> ListJournalDir(
+    Env* env, const std::string& journal_dir) {
+  std::vector<std::string> files;
+  TF_RETURN_IF_ERROR(env->GetChildren(journal_dir, &files));
+  JournalDirContents contents;
+  for (const auto& file : files) {
+    if (absl::EndsWith(file, kTempFileSuffix)) {
+      // Left behind by an interrupted compaction.
+      continue;
+    }
+    int64_t sequence_number;
+    TF_RETURN_IF_ERROR(ParseSequenceNumber(file, &sequence_number));
+    if (absl::StartsWith(file, kSnapshot)) {
+      contents.snapshots.push_back(sequence_number);
+    } else {
+      contents.journal_files.push_back(sequence_number);
+    }
+  }
+  return contents;
+}
+
+Status SerializeUpdate(const Update& update, std::string& serialized) {
+  serialized = update.SerializeAsString();
+  if (serialized.empty()) {
+    return errors::Internal("Failed to serialize update ", update.DebugString(),
+                            " to string");
+  }
+  return absl::OkStatus();
+}
+
+// Atomically writes `updates` to the snapshot with the given sequence number.
+Status WriteSnapshot(Env* env, const std::string& journal_dir,
+                     int64_t sequence_number,
+                     const std::vector<Update>& updates) {
+  std::string snapshot_file =
+      DataServiceJournalSnapshotFile(journal_dir, sequence_number);
+  std::string temp_file = absl::StrCat(snapshot_file, kTempFileSuffix);
+  std::unique_ptr<WritableFile> file;
+  TF_RETURN_IF_ERROR(env->NewWritableFile(temp_file, &file));
+  io::RecordWriter writer(file.get());
+  std::string s;
+  for (const auto& update : updates) {
+    TF_RETURN_IF_ERROR(SerializeUpdate(update, s));
+    TF_RETURN_IF_ERROR(writer.WriteRecord(s));
+  }
+  TF_RETURN_IF_ERROR(writer.Close());
+  TF_RETURN_IF_ERROR(file->Sync());
+  TF_RETURN_IF_ERROR(file->Close());
+  return env->RenameFile(temp_file, snapshot_file);
+}
+
+// Deletes the journal files and snapshots replaced by the snapshot with the
+// given sequence number.
+Status DeleteCompactedFiles(Env* env, const std::string& journal_dir,
+                            int64_t sequence_number) {
+  TF_ASSIGN_OR_RETURN(JournalDirContents contents,
+                      ListJournalDir(env, journal_dir));
+  for (int64_t journal_file : contents.journal_files) {
+    if (journal_file < sequence_number) {
+      TF_RETURN_IF_ERROR(
+          env->DeleteFile(DataServiceJournalFile(journal_dir, journal_file)));
+    }
+  }
+  for (int64_t snapshot : contents.snapshots) {
+    if (snapshot < sequence_number) {
+      TF_RETURN_IF_ERROR(env->DeleteFile(
+          DataServiceJournalSnapshotFile(journal_dir, snapshot)));
+    }
+  }
+  return absl::OkStatus();
+}
 }  // namespace
 
 std::string DataServiceJournalFile(const std::string& journal_dir,
@@ -52,6 +137,12 @@ std::string DataServiceJournalFile(const std::string& journal_dir,
                       absl::StrCat(kJournal, "_", sequence_number));
 }
 
+std::string DataServiceJournalSnapshotFile(const std::string& journal_dir,
+                                           int64_t sequence_number) {
+  return io::JoinPath(journal_dir,
+                      absl::StrCat(kSnapshot, "_", sequence_number));
+}
+
 FileJournalWriter::FileJournalWriter(Env* env, const std::string& journal_dir)
     : env_(env), journal_dir_(journal_dir) {}
 
@@ -59,30 +150,35 @@ Status FileJournalWriter::EnsureInitialized() {
   if (writer_) {
     return absl::OkStatus();
   }
-  std::vector<std::string> journal_files;
   TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(journal_dir_));
-  TF_RETURN_IF_ERROR(env_->GetChildren(journal_dir_, &journal_files));
+  TF_ASSIGN_OR_RETURN(JournalDirContents contents,
+                      ListJournalDir(env_, journal_dir_));
   int64_t latest_sequence_number = -1;
-  for (const auto& file : journal_files) {
-    int64_t sequence_number;
-    TF_RETURN_IF_ERROR(ParseSequenceNumber(file, &sequence_number));
+  for (int64_t sequence_number : contents.journal_files) {
     latest_sequence_number = std::max(latest_sequence_number, sequence_number);
   }
+  // The journal files replaced by a snapshot may have been deleted.
+  for (int64_t sequence_number : contents.snapshots) {
+    latest_sequence_number =
+        std::max(latest_sequence_number, sequence_number - 1);
+  }
+  return OpenJournalFile(latest_sequence_number + 1);
+}
+
+Status FileJournalWriter::OpenJournalFile(int64_t sequence_number) {
   std::string journal_file =
-      DataServiceJournalFile(journal_dir_, latest_sequence_number + 1);
+      DataServiceJournalFile(journal_dir_, sequence_number);
   TF_RETURN_IF_ERROR(env_->NewAppendableFile(journal_file, &file_));
   writer_ = std::make_unique<io::RecordWriter>(file_.get());
+  sequence_number_ = sequence_number;
   VLOG(1) << "Created journal writer to write to " << journal_file;
   return absl::OkStatus();
 }
 
 Status FileJournalWriter::Write(const Update& update) {
   TF_RETURN_IF_ERROR(EnsureInitialized());
-  std::string s = update.SerializeAsString();
-  if (s.empty()) {
-    return errors::Internal("Failed to serialize update ", update.DebugString(),
-                            " to string");
-  }
+  std::string s;
+  TF_RETURN_IF_ERROR(SerializeUpdate(update, s));
   TF_RETURN_IF_ERROR(writer_->WriteRecord(s));
   TF_RETURN_IF_ERROR(writer_->Flush());
   TF_RETURN_IF_ERROR(file_->Sync());
@@ -92,6 +188,29 @@ Status FileJournalWriter::Write(const Update& update) {
   return absl::OkStatus();
 }
 
+Status FileJournalWriter::Compact(const std::vector<Update>& updates) {
+  TF_RETURN_IF_ERROR(EnsureInitialized());
+  // Closes the current journal file so that the snapshot replaces exactly the
+  // journal files written so far. If anything below fails, the next write
+  // starts a new journal file.
+  Status s = writer_->Close();
+  writer_.reset();
+  s.Update(file_->Close());
+  file_.reset();
+  TF_RETURN_IF_ERROR(s);
+  const int64_t snapshot_sequence_number = sequence_number_ + 1;
+  TF_RETURN_IF_ERROR(
+      WriteSnapshot(env_, journal_dir_, snapshot_sequence_number, updates));
+  VLOG(1) << "Compacted journal into "
+          << DataServiceJournalSnapshotFile(journal_dir_,
+                                            snapshot_sequence_number)
+          << " with " << updates.size() << " updates";
+  TF_RETURN_IF_ERROR(OpenJournalFile(snapshot_sequence_number));
+  // Readers start from the latest snapshot, so the replaced files are not
+  // needed anymore once it has been written.
+  return DeleteCompactedFiles(env_, journal_dir_, snapshot_sequence_number);
+}
+
 FileJournalReader::FileJournalReader(Env* env, StringPiece journal_dir)
     : env_(env), journal_dir_(journal_dir) {}
 
@@ -99,6 +218,14 @@ Status FileJournalReader::EnsureInitialized() {
   if (reader_) {
     return absl::OkStatus();
   }
+  TF_ASSIGN_OR_RETURN(JournalDirContents contents,
+                      ListJournalDir(env_, journal_dir_));
+  if (!contents.snapshots.empty()) {
+    sequence_number_ = *absl::c_max_element(contents.snapshots);
+    reading_snapshot_ = true;
+    return UpdateFile(
+        DataServiceJournalSnapshotFile(journal_dir_, sequence_number_));
+  }
   return UpdateFile(DataServiceJournalFile(journal_dir_, 0));
 }
 
@@ -108,7 +235,12 @@ Status FileJournalReader::Read(Update& update, bool& end_of_journal) {
     tstring record;
     Status s = reader_->ReadRecord(&record);
     if (absl::IsOutOfRange(s)) {
-      sequence_number_++;
+      // The snapshot with sequence number N is followed by journal file N.
+      if (reading_snapshot_) {
+        reading_snapshot_ = false;
+      } else {
+        sequence_number_++;
+      }
       std::string next_journal_file =
           DataServiceJournalFile(journal_dir_, sequence_number_);
       if (absl::IsNotFound(env_->FileExists(next_journal_file))) {
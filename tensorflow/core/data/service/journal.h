@@ -15,8 +15,10 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_SERVICE_JOURNAL_H_
 #define TENSORFLOW_CORE_DATA_SERVICE_JOURNAL_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "tensorflow/core/data/service/journal.pb.h"
 #include "tensorflow/core/lib/core/status.h"
@@ -31,6 +33,11 @@ namespace data {
 std::string DataServiceJournalFile(const std::string& journal_dir,
                                    int64_t sequence_number);
 
+// Returns the location of the journal snapshot which replaces all journal files
+// with sequence numbers below `sequence_number`.
+std::string DataServiceJournalSnapshotFile(const std::string& journal_dir,
+                                           int64_t sequence_number);
+
 // Interface for writing to a journal.
 class JournalWriter {
  public:
@@ -39,6 +46,9 @@ class JournalWriter {
   virtual Status Write(const Update& update) = 0;
   // Initializes the writer if it is not yet initialized.
   virtual Status EnsureInitialized() = 0;
+  // Replaces all updates written so far with `updates`, which must restore the
+  // same state when replayed. Subsequent writes are appended after `updates`.
+  virtual Status Compact(const std::vector<Update>& updates) = 0;
 };
 
 // FileJournalWriter is not thread-safe, requiring external synchronization when
@@ -57,6 +67,11 @@ class JournalWriter {
 // "journal_0", "journal_1", and "journal_2", the writer will write to
 // "journal_3". The writer will flush updates as they are written, so that they
 // can be stored durably in case of machine failure.
+//
+// `Compact` closes the current journal file, say "journal_3", and atomically
+// writes the compacted updates to "snapshot_4". The snapshot replaces
+// "journal_0" to "journal_3", which are then deleted, and subsequent updates
+// are written to "journal_4".
 class FileJournalWriter : public JournalWriter {
  public:
   // Creates a journal writer to write to the given journal directory.
@@ -68,10 +83,16 @@ class FileJournalWriter : public JournalWriter {
 
   Status Write(const Update& update) override;
   Status EnsureInitialized() override;
+  Status Compact(const std::vector<Update>& updates) override;
 
  private:
+  // Opens the journal file with the given sequence number for writing.
+  Status OpenJournalFile(int64_t sequence_number);
+
   Env* env_;
   const std::string journal_dir_;
+  // Sequence number of the current journal file.
+  int64_t sequence_number_ = -1;
   std::unique_ptr<WritableFile> file_;
   std::unique_ptr<io::RecordWriter> writer_;
 };
@@ -89,7 +110,9 @@ class JournalReader {
 // used by multiple threads.
 //
 // The journal reader reads through all journal files in the configured journal
-// directory, in order of their sequence numbers. See FileJournalWriter above.
+// directory, in order of their sequence numbers. If the directory contains a
+// snapshot, the reader starts with the latest snapshot and continues with the
+// journal files it does not replace. See FileJournalWriter above.
 class FileJournalReader : public JournalReader {
  public:
   explicit FileJournalReader(Env* env, StringPiece journal_dir);
@@ -108,6 +131,9 @@ class FileJournalReader : public JournalReader {
   const std::string journal_dir_;
   // Sequence number of current journal file.
   int64_t sequence_number_ = 0;
+  // Whether the reader is reading the snapshot which replaces the journal files
+  // before `sequence_number_`.
+  bool reading_snapshot_ = false;
   std::unique_ptr<RandomAccessFile> file_;
   std::unique_ptr<io::SequentialRecordReader> reader_;
 };
@@ -21,11 +21,13 @@ limitations under the License.
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "tensorflow/core/data/service/common.pb.h"
+#include "tensorflow/core/data/service/dispatcher_state.h"
 #include "tensorflow/core/data/service/journal.pb.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/protobuf/data_service.pb.h"
 
 namespace tensorflow {
@@ -85,6 +87,55 @@ Status CheckJournalContent(StringPiece journal_dir,
   EXPECT_TRUE(end_of_journal);
   return absl::OkStatus();
 }
+
+Update MakeProduceSplitUpdate() {
+  Update update;
+  ProduceSplitUpdate* produce_split = update.mutable_produce_split();
+  produce_split->set_iteration_id(8);
+  return update;
+}
+
+// Writes a journal which creates a dynamically sharded iteration and produces
+// `num_splits` splits for it. Updates are not synced individually, to make it
+// cheap to generate large journals.
+Status WriteSyntheticJournal(const std::string& journal_dir,
+                             int64_t num_splits) {
+  TF_RETURN_IF_ERROR(Env::Default()->RecursivelyCreateDir(journal_dir));
+  std::unique_ptr<WritableFile> file;
+  TF_RETURN_IF_ERROR(Env::Default()->NewWritableFile(
+      DataServiceJournalFile(journal_dir, /*sequence_number=*/0), &file));
+  io::RecordWriter writer(file.get());
+  Update create_job;
+  create_job.mutable_create_job()->set_job_id(3);
+  create_job.mutable_create_job()->set_job_name("job_name");
+  create_job.mutable_create_job()
+      ->mutable_processing_mode_def()
+      ->set_sharding_policy(ProcessingModeDef::DYNAMIC);
+  Update create_iteration = MakeCreateIterationUpdate();
+  create_iteration.mutable_create_iteration()->set_num_split_providers(1);
+  TF_RETURN_IF_ERROR(writer.WriteRecord(create_job.SerializeAsString()));
+  TF_RETURN_IF_ERROR(writer.WriteRecord(create_iteration.SerializeAsString()));
+  const std::string produce_split =
+      MakeProduceSplitUpdate().SerializeAsString();
+  for (int64_t i = 0; i < num_splits; ++i) {
+    TF_RETURN_IF_ERROR(writer.WriteRecord(produce_split));
+  }
+  TF_RETURN_IF_ERROR(writer.Close());
+  return file->Close();
+}
+
+Status RestoreDispatcherState(const std::string& journal_dir,
+                              DispatcherState& state) {
+  FileJournalReader reader(Env::Default(), journal_dir);
+  Update update;
+  bool end_of_journal = false;
+  TF_RETURN_IF_ERROR(reader.Read(update, end_of_journal));
+  while (!end_of_journal) {
+    TF_RETURN_IF_ERROR(state.Apply(update));
+    TF_RETURN_IF_ERROR(reader.Read(update, end_of_journal));
+  }
+  return absl::OkStatus();
+}
 }  // namespace
 
 TEST(Journal, RoundTripMultiple) {
@@ -115,6 +166,72 @@ TEST(Journal, AppendExistingJournal) {
   TF_EXPECT_OK(CheckJournalContent(journal_dir, updates));
 }
 
+TEST(Journal, Compact) {
+  std::string journal_dir;
+  EXPECT_TRUE(NewJournalDir(journal_dir));
+  FileJournalWriter writer(Env::Default(), journal_dir);
+  TF_ASSERT_OK(writer.Write(MakeCreateIterationUpdate()));
+  TF_ASSERT_OK(writer.Write(MakeProduceSplitUpdate()));
+  TF_ASSERT_OK(writer.Write(MakeProduceSplitUpdate()));
+  TF_ASSERT_OK(writer.Compact({MakeCreateIterationUpdate()}));
+  TF_ASSERT_OK(writer.Write(MakeFinishTaskUpdate()));
+
+  TF_EXPECT_OK(CheckJournalContent(
+      journal_dir, {MakeCreateIterationUpdate(), MakeFinishTaskUpdate()}));
+  EXPECT_TRUE(absl::IsNotFound(Env::Default()->FileExists(
+      DataServiceJournalFile(journal_dir, /*sequence_number=*/0))));
+  TF_EXPECT_OK(Env::Default()->FileExists(
+      DataServiceJournalSnapshotFile(journal_dir, /*sequence_number=*/1)));
+}
+
+TEST(Journal, CompactMultipleTimes) {
+  std::string journal_dir;
+  EXPECT_TRUE(NewJournalDir(journal_dir));
+  {
+    FileJournalWriter writer(Env::Default(), journal_dir);
+    TF_ASSERT_OK(writer.Write(MakeProduceSplitUpdate()));
+    TF_ASSERT_OK(writer.Compact({MakeCreateIterationUpdate()}));
+    TF_ASSERT_OK(writer.Write(MakeProduceSplitUpdate()));
+    TF_ASSERT_OK(writer.Compact({MakeRegisterDatasetUpdate()}));
+  }
+  // A new writer appends to the journal after the latest snapshot.
+  FileJournalWriter writer(Env::Default(), journal_dir);
+  TF_ASSERT_OK(writer.Write(MakeFinishTaskUpdate()));
+
+  TF_EXPECT_OK(CheckJournalContent(
+      journal_dir, {MakeRegisterDatasetUpdate(), MakeFinishTaskUpdate()}));
+  EXPECT_TRUE(absl::IsNotFound(Env::Default()->FileExists(
+      DataServiceJournalSnapshotFile(journal_dir, /*sequence_number=*/1))));
+}
+
+TEST(Journal, CompactEmpty) {
+  std::string journal_dir;
+  EXPECT_TRUE(NewJournalDir(journal_dir));
+  FileJournalWriter writer(Env::Default(), journal_dir);
+  TF_ASSERT_OK(writer.Write(MakeProduceSplitUpdate()));
+  TF_ASSERT_OK(writer.Compact({}));
+
+  TF_EXPECT_OK(CheckJournalContent(journal_dir, {}));
+}
+
+TEST(Journal, RestoreDispatcherStateFromCompactedJournal) {
+  std::string journal_dir;
+  EXPECT_TRUE(NewJournalDir(journal_dir));
+  TF_ASSERT_OK(WriteSyntheticJournal(journal_dir, /*num_splits=*/100));
+  DispatcherState state;
+  TF_ASSERT_OK(RestoreDispatcherState(journal_dir, state));
+  FileJournalWriter writer(Env::Default(), journal_dir);
+  TF_ASSERT_OK(writer.Compact(state.ToUpdates()));
+  TF_ASSERT_OK(writer.Write(MakeProduceSplitUpdate()));
+
+  DispatcherState restored;
+  TF_ASSERT_OK(RestoreDispatcherState(journal_dir, restored));
+  std::shared_ptr<const DispatcherState::Iteration> iteration;
+  TF_ASSERT_OK(restored.IterationFromId(/*id=*/8, iteration));
+  ASSERT_TRUE(iteration->distributed_epoch_state.has_value());
+  EXPECT_EQ(iteration->distributed_epoch_state->indices[0], 101);
+}
+
 TEST(Journal, MissingFile) {
   std::string journal_dir;
   EXPECT_TRUE(NewJournalDir(journal_dir));
@@ -165,5 +282,34 @@ TEST(Journal, InvalidRecordData) {
   EXPECT_THAT(s.message(), HasSubstr("Failed to parse journal record"));
   EXPECT_EQ(s.code(), error::DATA_LOSS);
 }
+
+// Measures the time to restore the dispatcher state from a journal with
+// `state.range(0)` split updates, with or without compaction
+// (`state.range(1)`).
+void BM_RestoreDispatcherState(::testing::benchmark::State& state) {
+  const int64_t num_splits = state.range(0);
+  const bool compact = state.range(1);
+  std::string journal_dir;
+  CHECK(NewJournalDir(journal_dir));
+  TF_CHECK_OK(WriteSyntheticJournal(journal_dir, num_splits));
+  if (compact) {
+    DispatcherState dispatcher_state;
+    TF_CHECK_OK(RestoreDispatcherState(journal_dir, dispatcher_state));
+    FileJournalWriter writer(Env::Default(), journal_dir);
+    TF_CHECK_OK(writer.Compact(dispatcher_state.ToUpdates()));
+  }
+
+  for (auto s : state) {
+    DispatcherState dispatcher_state;
+    TF_CHECK_OK(RestoreDispatcherState(journal_dir, dispatcher_state));
+  }
+  state.SetLabel(compact ? "compacted" : "uncompacted");
+}
+
+BENCHMARK(BM_RestoreDispatcherState)
+    ->ArgPair(100000, 0)
+    ->ArgPair(100000, 1)
+    ->ArgPair(10000000, 0)
+    ->ArgPair(10000000, 1);
 }  // namespace data
 }  // namespace tensorflow
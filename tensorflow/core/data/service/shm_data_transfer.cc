@@ -0,0 +1,859 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/data/service/shm_data_transfer.h"
+
+// POSIX shared memory and sockets are not available on Windows, where the
+// protocol is not registered and clients use gRPC.
+#if !defined(_WIN32)
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/dataset.pb.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/framework/variant.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/host_info.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/protobuf/service_config.pb.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Payloads are aligned so that the client can hand them to vectorized kernels
+// without an extra copy on its side.
+constexpr size_t kAlignment = 64;
+// Segments grow in powers of two starting from this size, so that a stream of
+// similarly sized elements reuses one mapping.
+constexpr size_t kMinSegmentSize = 1 << 20;
+
+enum ComponentKind : uint32_t {
+  kTensor = 0,
+  kCompressedElement = 1,
+};
+
+// Layout of an element in the shared memory segment:
+//
+//   ElementHeader
+//   for each component:
+//     ComponentHeader, int64_t dims[rank], padding to kAlignment,
+//     payload[num_bytes], padding to kAlignment
+//
+// Payloads hold the raw tensor buffer for memcpy-able types, the string
+// lengths followed by the string bytes for DT_STRING, and the serialized proto
+// for compressed elements.
+struct ElementHeader {
+  int64_t element_index;
+  uint32_t end_of_sequence;
+  uint32_t skip;
+  uint32_t num_components;
+  uint32_t padding;
+};
+
+struct ComponentHeader {
+  uint32_t kind;
+  int32_t dtype;
+  uint32_t rank;
+  uint32_t padding;
+  uint64_t num_bytes;
+};
+
+// Sent over the control socket in reply to each request. It is followed by
+// `message_size` bytes holding the error message if `code` is not OK, or the
+// name of a newly created segment of `segment_size` bytes otherwise.
+struct ResponseHeader {
+  int32_t code;
+  uint32_t message_size;
+  uint64_t segment_size;
+  uint64_t element_size;
+};
+
+size_t AlignUp(size_t offset) {
+  return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+size_t RoundUpToPowerOfTwo(size_t size) {
+  size_t result = kMinSegmentSize;
+  while (result < size) {
+    result <<= 1;
+  }
+  return result;
+}
+
+Status SendAll(int fd, const void* data, size_t size) {
+  const char* ptr = static_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t sent = send(fd, ptr, size, MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent <= 0) {
+      return errors::Unavailable(
+          "Failed to write to shm data transfer socket: ", strerror(errno));
+    }
+    ptr += sent;
+    size -= sent;
+  }
+  return absl::OkStatus();
+}
+
+Status RecvAll(int fd, void* data, size_t size) {
+  char* ptr = static_cast<char*>(data);
+  while (size > 0) {
+    ssize_t received = recv(fd, ptr, size, 0);
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received == 0) {
+      return errors::Unavailable("shm data transfer connection was closed.");
+    }
+    if (received < 0) {
+      return errors::Unavailable(
+          "Failed to read from shm data transfer socket: ", strerror(errno));
+    }
+    ptr += received;
+    size -= received;
+  }
+  return absl::OkStatus();
+}
+
+void SetNoDelay(int fd) {
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+// A mapped POSIX shared memory object. The creating side owns the name and
+// unlinks it once the peer has mapped the segment, or on destruction.
+class SharedMemorySegment {
+ public:
+  static absl::StatusOr<std::unique_ptr<SharedMemorySegment>> Create(
+      size_t size) {
+    std::string name = absl::StrCat("/tf_data_shm_", getpid(), "_",
+                                    random::New64());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+      return errors::Internal("Failed to create shared memory segment ", name,
+                              ": ", strerror(errno));
+    }
+    // The pages are reserved up front: with a sparse segment, running out of
+    // shared memory would raise SIGBUS while the element is written into it.
+    // The error is returned to the client instead, which falls back to gRPC.
+#if defined(__linux__)
+    const int error = posix_fallocate(fd, 0, size);
+#else
+    const int error = ftruncate(fd, size) == 0 ? 0 : errno;
+#endif
+    if (error != 0) {
+      Status s = errors::ResourceExhausted("Failed to allocate ", size,
+                                           " bytes for shared memory segment ",
+                                           name, ": ", strerror(error));
+      close(fd);
+      shm_unlink(name.c_str());
+      return s;
+    }
+    return Map(std::move(name), fd, size, PROT_READ | PROT_WRITE,
+               /*owner=*/true);
+  }
+
+  static absl::StatusOr<std::unique_ptr<SharedMemorySegment>> Open(
+      std::string name, size_t size) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+      return errors::Unavailable("Failed to open shared memory segment ", name,
+                                 ": ", strerror(errno));
+    }
+    return Map(std::move(name), fd, size, PROT_READ, /*owner=*/false);
+  }
+
+  ~SharedMemorySegment() {
+    munmap(data_, size_);
+    Unlink();
+  }
+
+  void Unlink() {
+    if (owner_) {
+      shm_unlink(name_.c_str());
+      owner_ = false;
+    }
+  }
+
+  char* data() const { return data_; }
+  size_t size() const { return size_; }
+  const std::string& name() const { return name_; }
+
+ private:
+  SharedMemorySegment(std::string name, char* data, size_t size, bool owner)
+      : name_(std::move(name)), data_(data), size_(size), owner_(owner) {}
+
+  static absl::StatusOr<std::unique_ptr<SharedMemorySegment>> Map(
+      std::string name, int fd, size_t size, int prot, bool owner) {
+    void* data = mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      Status s = errors::Internal("Failed to map shared memory segment ", name,
+                                  ": ", strerror(errno));
+      if (owner) {
+        shm_unlink(name.c_str());
+      }
+      return s;
+    }
+    return absl::WrapUnique(new SharedMemorySegment(
+        std::move(name), static_cast<char*>(data), size, owner));
+  }
+
+  const std::string name_;
+  char* const data_;
+  const size_t size_;
+  bool owner_;
+};
+
+const CompressedElement* GetCompressedElement(const Tensor& tensor) {
+  if (tensor.dtype() != DT_VARIANT ||
+      !TensorShapeUtils::IsScalar(tensor.shape())) {
+    return nullptr;
+  }
+  return tensor.scalar<Variant>()().get<CompressedElement>();
+}
+
+absl::StatusOr<size_t> PayloadSize(const Tensor& tensor) {
+  if (tensor.dtype() == DT_VARIANT) {
+    const CompressedElement* compressed = GetCompressedElement(tensor);
+    if (compressed == nullptr) {
+      return errors::Unimplemented(
+          "The shm data transfer protocol only supports variant tensors "
+          "holding a scalar CompressedElement.");
+    }
+    return compressed->ByteSizeLong();
+  }
+  if (tensor.dtype() == DT_STRING) {
+    auto strings = tensor.flat<tstring>();
+    size_t size = strings.size() * sizeof(uint64_t);
+    for (int64_t i = 0; i < strings.size(); ++i) {
+      size += strings(i).size();
+    }
+    return size;
+  }
+  if (!DataTypeCanUseMemcpy(tensor.dtype())) {
+    return errors::Unimplemented("The shm data transfer protocol does not "
+                                 "support tensors of type ",
+                                 DataTypeString(tensor.dtype()));
+  }
+  return tensor.tensor_data().size();
+}
+
+size_t ComponentHeaderSize(const Tensor& tensor) {
+  return AlignUp(sizeof(ComponentHeader) + tensor.dims() * sizeof(int64_t));
+}
+
+absl::StatusOr<size_t> EncodedSize(const GetElementResult& result) {
+  size_t size = AlignUp(sizeof(ElementHeader));
+  for (const Tensor& component : result.components) {
+    TF_ASSIGN_OR_RETURN(size_t payload_size, PayloadSize(component));
+    size += ComponentHeaderSize(component) + AlignUp(payload_size);
+  }
+  return size;
+}
+
+// Writes `result` into `base`, which must hold `EncodedSize(result)` bytes.
+void EncodeElement(const GetElementResult& result, char* base) {
+  ElementHeader element_header = {};
+  element_header.element_index = result.element_index;
+  element_header.end_of_sequence = result.end_of_sequence;
+  element_header.skip = result.skip;
+  element_header.num_components = result.components.size();
+  memcpy(base, &element_header, sizeof(element_header));
+  size_t offset = AlignUp(sizeof(ElementHeader));
+  for (const Tensor& component : result.components) {
+    const CompressedElement* compressed = GetCompressedElement(component);
+    ComponentHeader header = {};
+    header.kind = compressed ? kCompressedElement : kTensor;
+    header.dtype = component.dtype();
+    header.rank = component.dims();
+    header.num_bytes = PayloadSize(component).value();
+    memcpy(base + offset, &header, sizeof(header));
+    for (int i = 0; i < component.dims(); ++i) {
+      int64_t dim = component.dim_size(i);
+      memcpy(base + offset + sizeof(header) + i * sizeof(int64_t), &dim,
+             sizeof(dim));
+    }
+    offset += ComponentHeaderSize(component);
+    char* payload = base + offset;
+    if (compressed != nullptr) {
+      compressed->SerializeWithCachedSizesToArray(
+          reinterpret_cast<uint8_t*>(payload));
+    } else if (component.dtype() == DT_STRING) {
+      auto strings = component.flat<tstring>();
+      char* bytes = payload + strings.size() * sizeof(uint64_t);
+      for (int64_t i = 0; i < strings.size(); ++i) {
+        uint64_t length = strings(i).size();
+        memcpy(payload + i * sizeof(uint64_t), &length, sizeof(length));
+        memcpy(bytes, strings(i).data(), length);
+        bytes += length;
+      }
+    } else {
+      memcpy(payload, component.tensor_data().data(),
+             component.tensor_data().size());
+    }
+    offset += AlignUp(header.num_bytes);
+  }
+}
+
+// Reads an element written by `EncodeElement` from the first `size` bytes of
+// `base`. Tensor buffers are allocated from `allocator`.
+Status DecodeElement(const char* base, size_t size, Allocator* allocator,
+                     GetElementResult& result) {
+  auto check_bounds = [size](size_t end) -> Status {
+    if (end > size) {
+      return errors::DataLoss("Corrupted element in shm data transfer "
+                              "segment: read past the end of the element.");
+    }
+    return absl::OkStatus();
+  };
+  TF_RETURN_IF_ERROR(check_bounds(sizeof(ElementHeader)));
+  ElementHeader element_header;
+  memcpy(&element_header, base, sizeof(element_header));
+  result.element_index = element_header.element_index;
+  result.end_of_sequence = element_header.end_of_sequence;
+  result.skip = element_header.skip;
+  result.components.clear();
+  result.components.reserve(element_header.num_components);
+  size_t offset = AlignUp(sizeof(ElementHeader));
+  for (uint32_t c = 0; c < element_header.num_components; ++c) {
+    TF_RETURN_IF_ERROR(check_bounds(offset + sizeof(ComponentHeader)));
+    ComponentHeader header;
+    memcpy(&header, base + offset, sizeof(header));
+    const size_t dims_offset = offset + sizeof(header);
+    TF_RETURN_IF_ERROR(
+        check_bounds(dims_offset + header.rank * sizeof(int64_t)));
+    std::vector<int64_t> dims(header.rank);
+    memcpy(dims.data(), base + dims_offset, header.rank * sizeof(int64_t));
+    offset = AlignUp(dims_offset + header.rank * sizeof(int64_t));
+    TF_RETURN_IF_ERROR(check_bounds(offset + header.num_bytes));
+    const char* payload = base + offset;
+    offset += AlignUp(header.num_bytes);
+
+    if (header.kind == kCompressedElement) {
+      CompressedElement compressed;
+      if (!compressed.ParseFromArray(payload, header.num_bytes)) {
+        return errors::DataLoss("Failed to parse compressed element from shm "
+                                "data transfer segment.");
+      }
+      Tensor tensor(DT_VARIANT, TensorShape{});
+      tensor.scalar<Variant>()() = std::move(compressed);
+      result.components.push_back(std::move(tensor));
+      continue;
+    }
+    TensorShape shape;
+    TF_RETURN_IF_ERROR(
+        TensorShapeUtils::MakeShape(dims.data(), dims.size(), &shape));
+    // Only the types written by `EncodeElement` are accepted, so that a
+    // corrupted header cannot make us build a tensor of an invalid or
+    // non-POD type and copy raw bytes into it.
+    if (!DataType_IsValid(header.dtype)) {
+      return errors::DataLoss("Invalid dtype ", header.dtype,
+                              " in shm data transfer segment.");
+    }
+    const DataType dtype = static_cast<DataType>(header.dtype);
+    if (dtype != DT_STRING && !DataTypeCanUseMemcpy(dtype)) {
+      return errors::DataLoss("Unexpected dtype ", DataTypeString(dtype),
+                              " in shm data transfer segment.");
+    }
+    Tensor tensor(allocator, dtype, shape);
+    if (dtype == DT_STRING) {
+      auto strings = tensor.flat<tstring>();
+      const size_t lengths_size = strings.size() * sizeof(uint64_t);
+      if (lengths_size > header.num_bytes) {
+        return errors::DataLoss("Corrupted string tensor in shm data "
+                                "transfer segment.");
+      }
+      const char* bytes = payload + lengths_size;
+      const char* end = payload + header.num_bytes;
+      for (int64_t i = 0; i < strings.size(); ++i) {
+        uint64_t length;
+        memcpy(&length, payload + i * sizeof(uint64_t), sizeof(length));
+        if (length > static_cast<uint64_t>(end - bytes)) {
+          return errors::DataLoss("Corrupted string tensor in shm data "
+                                  "transfer segment.");
+        }
+        strings(i).assign(bytes, length);
+        bytes += length;
+      }
+    } else {
+      if (tensor.tensor_data().size() != header.num_bytes) {
+        return errors::DataLoss("Size mismatch for tensor in shm data "
+                                "transfer segment: expected ",
+                                tensor.tensor_data().size(), " bytes, got ",
+                                header.num_bytes);
+      }
+      memcpy(const_cast<char*>(tensor.tensor_data().data()), payload,
+             header.num_bytes);
+    }
+    result.components.push_back(std::move(tensor));
+  }
+  return absl::OkStatus();
+}
+
+class ShmDataTransferServer : public DataTransferServer {
+ public:
+  explicit ShmDataTransferServer(DataTransferServer::GetElementT get_element)
+      : get_element_(std::move(get_element)) {}
+
+  ~ShmDataTransferServer() override {
+    {
+      mutex_lock l(mu_);
+      cancelled_ = true;
+      if (listen_fd_ >= 0) {
+        shutdown(listen_fd_, SHUT_RDWR);
+      }
+      for (int fd : connection_fds_) {
+        shutdown(fd, SHUT_RDWR);
+      }
+    }
+    // Joins the accept thread before the connection threads, since it is the
+    // only one that adds to `connection_threads_`.
+    accept_thread_.reset();
+    std::vector<std::unique_ptr<Thread>> connection_threads;
+    {
+      mutex_lock l(mu_);
+      connection_threads = std::move(connection_threads_);
+    }
+    connection_threads.clear();
+    if (listen_fd_ >= 0) {
+      close(listen_fd_);
+    }
+  }
+
+  Status Start(const experimental::WorkerConfig& config) override {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+      return errors::Internal("Failed to create shm data transfer socket: ",
+                              strerror(errno));
+    }
+    int one = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    // Only co-located clients can map the segments, so there is no point in
+    // accepting connections from other hosts.
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(config.data_transfer_port());
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) !=
+        0) {
+      return errors::Internal(
+          "Failed to bind shm data transfer socket to port ",
+          config.data_transfer_port(), ": ", strerror(errno));
+    }
+    if (listen(listen_fd_, SOMAXCONN) != 0) {
+      return errors::Internal("Failed to listen on shm data transfer socket: ",
+                              strerror(errno));
+    }
+    socklen_t addr_len = sizeof(addr);
+    if (getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr),
+                    &addr_len) != 0) {
+      return errors::Internal("Failed to get shm data transfer port: ",
+                              strerror(errno));
+    }
+    port_ = ntohs(addr.sin_port);
+    accept_thread_ = absl::WrapUnique(Env::Default()->StartThread(
+        {}, "tf_data_shm_accept", [this]() { AcceptLoop(); }));
+    return absl::OkStatus();
+  }
+
+  int Port() const override { return port_; }
+
+  absl::StatusOr<std::string> GetCompatibilityInfo() const override {
+    return port::Hostname();
+  }
+
+ private:
+  void AcceptLoop() {
+    while (true) {
+      int fd = accept(listen_fd_, nullptr, nullptr);
+      if (fd < 0) {
+        if (errno == EINTR || errno == ECONNABORTED) {
+          continue;
+        }
+        mutex_lock l(mu_);
+        if (!cancelled_) {
+          LOG(ERROR) << "Failed to accept shm data transfer connection: "
+                     << strerror(errno);
+        }
+        return;
+      }
+      SetNoDelay(fd);
+      mutex_lock l(mu_);
+      if (cancelled_) {
+        close(fd);
+        return;
+      }
+      connection_fds_.push_back(fd);
+      connection_threads_.push_back(
+          absl::WrapUnique(Env::Default()->StartThread(
+              {}, "tf_data_shm_connection", [this, fd]() {
+                ServeConnection(fd);
+                mutex_lock l(mu_);
+                connection_fds_.erase(std::find(connection_fds_.begin(),
+                                                connection_fds_.end(), fd));
+                close(fd);
+              })));
+    }
+  }
+
+  // Serves requests from one client until it disconnects. Each connection has
+  // its own segment, which is reused across elements and replaced by a larger
+  // one when an element does not fit.
+  void ServeConnection(int fd) {
+    std::unique_ptr<SharedMemorySegment> segment;
+    while (true) {
+      uint64_t request_size;
+      if (!RecvAll(fd, &request_size, sizeof(request_size)).ok()) {
+        return;
+      }
+      std::string request_bytes(request_size, '\0');
+      if (!RecvAll(fd, request_bytes.data(), request_size).ok()) {
+        return;
+      }
+      // The client maps a new segment before sending its next request, so the
+      // name is no longer needed.
+      if (segment) {
+        segment->Unlink();
+      }
+      ResponseHeader header = {};
+      std::string message;
+      Status s = HandleRequest(request_bytes, segment, header, message);
+      if (!s.ok()) {
+        header = {};
+        header.code = static_cast<int32_t>(s.code());
+        message = std::string(s.message());
+      }
+      header.message_size = message.size();
+      if (!SendAll(fd, &header, sizeof(header)).ok() ||
+          !SendAll(fd, message.data(), message.size()).ok()) {
+        return;
+      }
+    }
+  }
+
+  Status HandleRequest(const std::string& request_bytes,
+                       std::unique_ptr<SharedMemorySegment>& segment,
+                       ResponseHeader& header, std::string& segment_name) {
+    GetElementRequest request;
+    if (!request.ParseFromString(request_bytes)) {
+      return errors::InvalidArgument("Failed to parse GetElementRequest.");
+    }
+    GetElementResult result;
+    TF_RETURN_IF_ERROR(get_element_(&request, &result));
+    TF_ASSIGN_OR_RETURN(size_t element_size, EncodedSize(result));
+    if (!segment || segment->size() < element_size) {
+      segment.reset();
+      TF_ASSIGN_OR_RETURN(segment, SharedMemorySegment::Create(
+                                       RoundUpToPowerOfTwo(element_size)));
+      segment_name = segment->name();
+    }
+    EncodeElement(result, segment->data());
+    header.segment_size = segment->size();
+    header.element_size = element_size;
+    return absl::OkStatus();
+  }
+
+  const DataTransferServer::GetElementT get_element_;
+  int listen_fd_ = -1;
+  int port_ = -1;
+  std::unique_ptr<Thread> accept_thread_;
+
+  mutex mu_;
+  bool cancelled_ TF_GUARDED_BY(mu_) = false;
+  std::vector<int> connection_fds_ TF_GUARDED_BY(mu_);
+  std::vector<std::unique_ptr<Thread>> connection_threads_ TF_GUARDED_BY(mu_);
+};
+
+// Connects to the shm data transfer server listening on `port` of the
+// loopback interface.
+absl::StatusOr<int> ConnectToLoopback(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return errors::Unavailable("Failed to create shm data transfer socket: ",
+                               strerror(errno));
+  }
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    Status s = errors::Unavailable(
+        "Failed to connect to shm data transfer server on loopback port ",
+        port, ": ", strerror(errno));
+    close(fd);
+    return s;
+  }
+  SetNoDelay(fd);
+  return fd;
+}
+
+class ShmDataTransferClient : public DataTransferClient {
+ public:
+  static Status Create(const DataTransferClient::Config& config,
+                       std::unique_ptr<DataTransferClient>* out) {
+    size_t colon = config.address.rfind(':');
+    int port = 0;
+    if (colon == std::string::npos ||
+        !absl::SimpleAtoi(config.address.substr(colon + 1), &port) ||
+        port <= 0 || port > 65535) {
+      return errors::InvalidArgument(
+          "Expected shm data transfer address of the form host:port, got ",
+          config.address);
+    }
+    Allocator* allocator =
+        config.allocator != nullptr ? config.allocator : cpu_allocator();
+    *out = absl::WrapUnique(
+        new ShmDataTransferClient(config.address, port, allocator));
+    return absl::OkStatus();
+  }
+
+  ~ShmDataTransferClient() override {
+    mutex_lock l(fd_mu_);
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  Status GetElement(const GetElementRequest& req,
+                    GetElementResult& result) override {
+    VLOG(3) << "GetElement for task " << req.task_id() << " from shm worker "
+            << "server at " << address_ << ".";
+    mutex_lock l(mu_);
+    TF_RETURN_IF_ERROR(VerifyClientIsNotCancelled());
+    int64_t start_time_us = env_->NowMicros();
+    Status s = GetElementInternal(req, result);
+    if (!s.ok()) {
+      TF_RETURN_IF_ERROR(VerifyClientIsNotCancelled());
+      return s;
+    }
+    int64_t end_time_us = env_->NowMicros();
+    metrics::RecordTFDataServiceGetElementDuration(kShmTransferProtocol,
+                                                   end_time_us - start_time_us);
+    return absl::OkStatus();
+  }
+
+  void TryCancel() override {
+    VLOG(2) << "Cancel ShmDataTransferClient for worker " << address_ << ".";
+    mutex_lock l(fd_mu_);
+    cancelled_ = true;
+    // Unblocks any in-flight read; the connection is not reused afterwards.
+    if (fd_ >= 0) {
+      shutdown(fd_, SHUT_RDWR);
+    }
+  }
+
+  absl::StatusOr<std::string> GetCompatibilityInfo() const override {
+    return port::Hostname();
+  }
+
+  Status CheckCompatibility(
+      const std::string& server_compatibility_info) const override {
+    const std::string hostname = port::Hostname();
+    if (server_compatibility_info != hostname) {
+      return errors::FailedPrecondition(
+          "The shm data transfer protocol requires the client and the worker "
+          "to run on the same host, but the worker runs on '",
+          server_compatibility_info, "' and the client on '", hostname, "'.");
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  // The server only listens on the loopback interface, so the client connects
+  // to `port` there instead of resolving the host the worker advertises. The
+  // connection is made by the first `GetElement()`, i.e. after the caller has
+  // checked that the worker runs on this host.
+  ShmDataTransferClient(std::string address, int port, Allocator* allocator)
+      : address_(std::move(address)), port_(port), allocator_(allocator) {
+    VLOG(2) << "Create ShmDataTransferClient for worker " << address_ << ".";
+  }
+
+  Status VerifyClientIsNotCancelled() {
+    if (cancelled_) {
+      return errors::Cancelled("Client was cancelled.");
+    }
+    return absl::OkStatus();
+  }
+
+  // Connects to the server unless a connection is already open.
+  Status EnsureConnected() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    {
+      mutex_lock l(fd_mu_);
+      if (fd_ >= 0) {
+        return absl::OkStatus();
+      }
+    }
+    absl::StatusOr<int> fd = ConnectToLoopback(port_);
+    if (!fd.ok()) {
+      if (!connected_) {
+        // The server was never reachable, so let the caller fall back to
+        // another protocol rather than retry.
+        return errors::FailedPrecondition(fd.status().message());
+      }
+      return fd.status();
+    }
+    mutex_lock l(fd_mu_);
+    if (cancelled_) {
+      close(*fd);
+      return errors::Cancelled("Client was cancelled.");
+    }
+    fd_ = *fd;
+    connected_ = true;
+    return absl::OkStatus();
+  }
+
+  // Closes the connection and drops the segment. The server releases its end
+  // of both when it notices, and the next request starts over with a new
+  // connection and a new segment.
+  void ResetConnection() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    segment_.reset();
+    mutex_lock l(fd_mu_);
+    if (fd_ >= 0) {
+      close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  Status GetElementInternal(const GetElementRequest& req,
+                            GetElementResult& result)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    std::string request_bytes;
+    if (!req.SerializeToString(&request_bytes)) {
+      return errors::Internal("Failed to serialize GetElementRequest.");
+    }
+    TF_RETURN_IF_ERROR(EnsureConnected());
+    ResponseHeader header;
+    std::string message;
+    Status s = Exchange(request_bytes, header, message);
+    if (s.ok() && header.code == static_cast<int32_t>(absl::StatusCode::kOk)) {
+      if (!message.empty()) {
+        segment_.reset();
+        absl::StatusOr<std::unique_ptr<SharedMemorySegment>> segment =
+            SharedMemorySegment::Open(message, header.segment_size);
+        if (segment.ok()) {
+          segment_ = std::move(*segment);
+        } else {
+          s = segment.status();
+        }
+      }
+      if (s.ok() && (!segment_ || header.element_size > segment_->size())) {
+        s = errors::DataLoss("shm data transfer server sent an element of ",
+                             header.element_size,
+                             " bytes without a segment to hold it.");
+      }
+    }
+    if (!s.ok()) {
+      // Either the connection is out of sync or we hold no segment the server
+      // can write to. The server only sends a segment name when it creates a
+      // segment, so the connection has to be reset to get a new one.
+      ResetConnection();
+      return s;
+    }
+    if (header.code != static_cast<int32_t>(absl::StatusCode::kOk)) {
+      return Status(static_cast<absl::StatusCode>(header.code), message);
+    }
+    return DecodeElement(segment_->data(), header.element_size, allocator_,
+                         result);
+  }
+
+  // Sends a serialized request and receives the response header and message.
+  Status Exchange(const std::string& request_bytes, ResponseHeader& header,
+                  std::string& message) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    int fd;
+    {
+      // `fd_` only changes with `mu_` held, which we hold as well.
+      mutex_lock l(fd_mu_);
+      fd = fd_;
+    }
+    uint64_t request_size = request_bytes.size();
+    TF_RETURN_IF_ERROR(SendAll(fd, &request_size, sizeof(request_size)));
+    TF_RETURN_IF_ERROR(SendAll(fd, request_bytes.data(), request_size));
+    TF_RETURN_IF_ERROR(RecvAll(fd, &header, sizeof(header)));
+    message.resize(header.message_size);
+    return RecvAll(fd, message.data(), message.size());
+  }
+
+  const std::string address_;
+  const int port_;
+  Allocator* const allocator_;
+  std::atomic<bool> cancelled_ = false;
+
+  mutex mu_;
+  std::unique_ptr<SharedMemorySegment> segment_ TF_GUARDED_BY(mu_);
+  // Whether a connection to the server was ever established.
+  bool connected_ TF_GUARDED_BY(mu_) = false;
+
+  // Guards `fd_` against `TryCancel()`, which must not wait for `mu_`.
+  mutex fd_mu_;
+  int fd_ TF_GUARDED_BY(fd_mu_) = -1;
+};
+
+class ShmTransferRegistrar {
+ public:
+  ShmTransferRegistrar() {
+    DataTransferServer::Register(
+        kShmTransferProtocol, [](DataTransferServer::GetElementT get_element,
+                                 std::shared_ptr<DataTransferServer>* out) {
+          *out = std::make_shared<ShmDataTransferServer>(get_element);
+          return absl::OkStatus();
+        });
+    DataTransferClient::Register(
+        kShmTransferProtocol, [](DataTransferClient::Config config,
+                                 std::unique_ptr<DataTransferClient>* out) {
+          return ShmDataTransferClient::Create(config, out);
+        });
+  }
+};
+static ShmTransferRegistrar shm_transfer_registrar;
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // !defined(_WIN32)
@@ -0,0 +1,38 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_SHM_DATA_TRANSFER_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_SHM_DATA_TRANSFER_H_
+
+namespace tensorflow {
+namespace data {
+
+// Data transfer protocol for clients running on the same host as the tf.data
+// service worker. Requests and completion notifications travel over a loopback
+// control socket, while element payloads are written by the worker directly
+// into a POSIX shared memory segment mapped by the client. This avoids the
+// per-element proto serialization of the gRPC protocol.
+//
+// To use it, set `data_transfer_protocol` to "shm" in the worker config, and
+// `data_transfer_address` to "localhost:%dts_port%". Clients on a different
+// host fail the compatibility check and fall back to gRPC. So do clients for
+// which the worker fails to allocate shared memory. The protocol is only
+// available on POSIX platforms.
+constexpr const char kShmTransferProtocol[] = "shm";
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_SHM_DATA_TRANSFER_H_
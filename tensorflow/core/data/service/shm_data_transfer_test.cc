@@ -0,0 +1,351 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/data/service/shm_data_transfer.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/compression_utils.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/framework/dataset.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/variant.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/host_info.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/status_matchers.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/protobuf/error_codes.pb.h"
+#include "tensorflow/core/protobuf/service_config.pb.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using ::tensorflow::testing::StatusIs;
+using ::testing::HasSubstr;
+
+std::shared_ptr<DataTransferServer> StartServer(
+    DataTransferServer::GetElementT get_element) {
+  std::shared_ptr<DataTransferServer> server;
+  TF_CHECK_OK(
+      DataTransferServer::Build(kShmTransferProtocol, get_element, &server));
+  TF_CHECK_OK(server->Start(experimental::WorkerConfig()));
+  return server;
+}
+
+std::unique_ptr<DataTransferClient> NewClient(const std::string& address) {
+  std::unique_ptr<DataTransferClient> client;
+  TF_CHECK_OK(DataTransferClient::Build(
+      kShmTransferProtocol,
+      {kShmTransferProtocol, address,
+       /*accelerator_device_info=*/nullptr, /*allocator=*/nullptr},
+      &client));
+  return client;
+}
+
+std::unique_ptr<DataTransferClient> NewClient(
+    const DataTransferServer& server) {
+  return NewClient(absl::StrCat("localhost:", server.Port()));
+}
+
+// Returns a server which produces `element` for every request.
+std::shared_ptr<DataTransferServer> StartServerWithElement(
+    std::vector<Tensor> element) {
+  return StartServer([element](const GetElementRequest* request,
+                               GetElementResult* result) {
+    result->components = element;
+    result->element_index = request->task_id();
+    return absl::OkStatus();
+  });
+}
+
+TEST(ShmDataTransferTest, RoundTrip) {
+  std::vector<Tensor> element = {
+      test::AsTensor<int64_t>({1, 2, 3, 4, 5, 6}, TensorShape({2, 3})),
+      test::AsTensor<float>({0.5f}, TensorShape({})),
+      test::AsTensor<tstring>({"a", "", "longer string"}, TensorShape({3})),
+      Tensor(DT_INT32, TensorShape({0, 4}))};
+  std::shared_ptr<DataTransferServer> server = StartServerWithElement(element);
+  std::unique_ptr<DataTransferClient> client = NewClient(*server);
+
+  for (int64_t i = 0; i < 3; ++i) {
+    GetElementRequest request;
+    request.set_task_id(i);
+    GetElementResult result;
+    TF_ASSERT_OK(client->GetElement(request, result));
+    EXPECT_EQ(result.element_index, i);
+    EXPECT_FALSE(result.end_of_sequence);
+    EXPECT_FALSE(result.skip);
+    ASSERT_EQ(result.components.size(), element.size());
+    for (int j = 0; j < element.size(); ++j) {
+      test::ExpectEqual(result.components[j], element[j]);
+    }
+  }
+}
+
+TEST(ShmDataTransferTest, CompressedElement) {
+  std::vector<Tensor> uncompressed = {
+      test::AsTensor<int64_t>({7, 8, 9}, TensorShape({3})),
+      test::AsTensor<tstring>({"hello", "world"}, TensorShape({2}))};
+  CompressedElement compressed;
+  TF_ASSERT_OK(CompressElement(uncompressed, &compressed));
+  Tensor tensor(DT_VARIANT, TensorShape({}));
+  tensor.scalar<Variant>()() = compressed;
+  std::shared_ptr<DataTransferServer> server = StartServerWithElement({tensor});
+  std::unique_ptr<DataTransferClient> client = NewClient(*server);
+
+  GetElementResult result;
+  TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+  ASSERT_EQ(result.components.size(), 1);
+  const CompressedElement* received =
+      result.components[0].scalar<Variant>()().get<CompressedElement>();
+  ASSERT_NE(received, nullptr);
+  std::vector<Tensor> round_trip;
+  TF_ASSERT_OK(UncompressElement(*received, &round_trip));
+  ASSERT_EQ(round_trip.size(), uncompressed.size());
+  for (int i = 0; i < uncompressed.size(); ++i) {
+    test::ExpectEqual(round_trip[i], uncompressed[i]);
+  }
+}
+
+TEST(ShmDataTransferTest, GrowsSegmentForLargeElements) {
+  int64_t num_elements = 1;
+  std::shared_ptr<DataTransferServer> server =
+      StartServer([&num_elements](const GetElementRequest* request,
+                                  GetElementResult* result) {
+        Tensor tensor(DT_INT64, TensorShape({num_elements}));
+        tensor.flat<int64_t>().setConstant(num_elements);
+        result->components.push_back(tensor);
+        return absl::OkStatus();
+      });
+  std::unique_ptr<DataTransferClient> client = NewClient(*server);
+
+  // Exceeds the initial segment size after a few iterations.
+  for (; num_elements <= (int64_t{1} << 20); num_elements *= 16) {
+    GetElementResult result;
+    TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+    ASSERT_EQ(result.components.size(), 1);
+    Tensor expected(DT_INT64, TensorShape({num_elements}));
+    expected.flat<int64_t>().setConstant(num_elements);
+    test::ExpectEqual(result.components[0], expected);
+  }
+}
+
+TEST(ShmDataTransferTest, EndOfSequence) {
+  std::shared_ptr<DataTransferServer> server = StartServer(
+      [](const GetElementRequest* request, GetElementResult* result) {
+        result->end_of_sequence = true;
+        return absl::OkStatus();
+      });
+  std::unique_ptr<DataTransferClient> client = NewClient(*server);
+
+  GetElementResult result;
+  TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+  EXPECT_TRUE(result.end_of_sequence);
+  EXPECT_TRUE(result.components.empty());
+}
+
+TEST(ShmDataTransferTest, PropagatesErrors) {
+  std::shared_ptr<DataTransferServer> server = StartServer(
+      [](const GetElementRequest* request, GetElementResult* result) {
+        return errors::NotFound("Task ", request->task_id(), " not found.");
+      });
+  std::unique_ptr<DataTransferClient> client = NewClient(*server);
+
+  GetElementRequest request;
+  request.set_task_id(42);
+  GetElementResult result;
+  EXPECT_THAT(client->GetElement(request, result),
+              StatusIs(error::NOT_FOUND, HasSubstr("Task 42 not found.")));
+  // The connection stays usable after an error.
+  EXPECT_THAT(client->GetElement(request, result),
+              StatusIs(error::NOT_FOUND));
+}
+
+TEST(ShmDataTransferTest, UnsupportedVariant) {
+  Tensor tensor(DT_VARIANT, TensorShape({2}));
+  std::shared_ptr<DataTransferServer> server = StartServerWithElement({tensor});
+  std::unique_ptr<DataTransferClient> client = NewClient(*server);
+
+  GetElementResult result;
+  EXPECT_THAT(client->GetElement(GetElementRequest(), result),
+              StatusIs(error::UNIMPLEMENTED));
+}
+
+TEST(ShmDataTransferTest, CancelClient) {
+  std::shared_ptr<DataTransferServer> server =
+      StartServerWithElement({Tensor(int64_t{1})});
+  std::unique_ptr<DataTransferClient> client = NewClient(*server);
+
+  client->TryCancel();
+  GetElementResult result;
+  EXPECT_THAT(client->GetElement(GetElementRequest(), result),
+              StatusIs(error::CANCELLED));
+}
+
+TEST(ShmDataTransferTest, CompatibilityCheck) {
+  std::shared_ptr<DataTransferServer> server =
+      StartServerWithElement({Tensor(int64_t{1})});
+  std::unique_ptr<DataTransferClient> client = NewClient(*server);
+
+  TF_ASSERT_OK_AND_ASSIGN(std::string server_info,
+                          server->GetCompatibilityInfo());
+  TF_EXPECT_OK(client->CheckCompatibility(server_info));
+  EXPECT_THAT(client->CheckCompatibility(
+                  absl::StrCat("not-", port::Hostname())),
+              StatusIs(error::FAILED_PRECONDITION,
+                       HasSubstr("same host")));
+}
+
+TEST(ShmDataTransferTest, ConnectsToAdvertisedHostname) {
+  std::shared_ptr<DataTransferServer> server =
+      StartServerWithElement({Tensor(int64_t{1})});
+  std::unique_ptr<DataTransferClient> client =
+      NewClient(absl::StrCat(port::Hostname(), ":", server->Port()));
+
+  GetElementResult result;
+  TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+  ASSERT_EQ(result.components.size(), 1);
+  test::ExpectEqual(result.components[0], Tensor(int64_t{1}));
+}
+
+TEST(ShmDataTransferTest, ReconnectsAfterConnectionLoss) {
+  std::shared_ptr<DataTransferServer> server =
+      StartServerWithElement({Tensor(int64_t{1})});
+  const int port = server->Port();
+  std::unique_ptr<DataTransferClient> client = NewClient(*server);
+  GetElementResult result;
+  TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+
+  server.reset();
+  TF_ASSERT_OK(DataTransferServer::Build(
+      kShmTransferProtocol,
+      [](const GetElementRequest* request, GetElementResult* result) {
+        result->components = {Tensor(int64_t{2})};
+        return absl::OkStatus();
+      },
+      &server));
+  experimental::WorkerConfig config;
+  config.set_data_transfer_port(port);
+  TF_ASSERT_OK(server->Start(config));
+
+  EXPECT_THAT(client->GetElement(GetElementRequest(), result),
+              StatusIs(error::UNAVAILABLE));
+  TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+  ASSERT_EQ(result.components.size(), 1);
+  test::ExpectEqual(result.components[0], Tensor(int64_t{2}));
+}
+
+TEST(ShmDataTransferTest, ConnectionRefused) {
+  int port;
+  {
+    std::shared_ptr<DataTransferServer> server =
+        StartServerWithElement({Tensor(int64_t{1})});
+    port = server->Port();
+  }
+  std::unique_ptr<DataTransferClient> client =
+      NewClient(absl::StrCat("localhost:", port));
+  GetElementResult result;
+  EXPECT_THAT(client->GetElement(GetElementRequest(), result),
+              StatusIs(error::FAILED_PRECONDITION));
+}
+
+TEST(ShmDataTransferTest, InvalidAddress) {
+  std::unique_ptr<DataTransferClient> client;
+  EXPECT_THAT(
+      DataTransferClient::Build(
+          kShmTransferProtocol,
+          {kShmTransferProtocol, "localhost",
+           /*accelerator_device_info=*/nullptr, /*allocator=*/nullptr},
+          &client),
+      StatusIs(error::INVALID_ARGUMENT));
+}
+
+// Compares the cost of moving a batch of images from the worker to the client.
+// "local" calls the worker in-process as the local protocol does. "grpc" pays
+// the per-element TensorProto serialization and parsing of the gRPC protocol,
+// but not its network stack. "shm" goes through the shared memory protocol.
+//
+// Args: protocol (0 = local, 1 = grpc, 2 = shm), batch size.
+void BM_GetImageBatch(::testing::benchmark::State& state) {
+  const int protocol = state.range(0);
+  const int64_t batch_size = state.range(1);
+  Tensor images(DT_UINT8, TensorShape({batch_size, 224, 224, 3}));
+  images.flat<uint8_t>().setConstant(127);
+  Tensor labels(DT_INT64, TensorShape({batch_size}));
+  labels.flat<int64_t>().setZero();
+  std::vector<Tensor> element = {images, labels};
+  DataTransferServer::GetElementT get_element =
+      [&element](const GetElementRequest* request, GetElementResult* result) {
+        result->components = element;
+        return absl::OkStatus();
+      };
+
+  std::shared_ptr<DataTransferServer> server;
+  std::unique_ptr<DataTransferClient> client;
+  if (protocol == 2) {
+    server = StartServer(get_element);
+    client = NewClient(*server);
+  }
+  GetElementRequest request;
+  for (auto s : state) {
+    GetElementResult result;
+    if (protocol == 0) {
+      TF_CHECK_OK(get_element(&request, &result));
+    } else if (protocol == 1) {
+      TF_CHECK_OK(get_element(&request, &result));
+      GetElementResponse response;
+      for (const Tensor& component : result.components) {
+        component.AsProtoTensorContent(
+            response.mutable_uncompressed()->add_components());
+      }
+      std::string serialized = response.SerializeAsString();
+      GetElementResponse parsed;
+      CHECK(parsed.ParseFromString(serialized));
+      GetElementResult received;
+      for (const auto& component : parsed.uncompressed().components()) {
+        received.components.emplace_back();
+        CHECK(received.components.back().FromProto(component));
+      }
+    } else {
+      TF_CHECK_OK(client->GetElement(request, result));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          (images.TotalBytes() + labels.TotalBytes()));
+}
+
+BENCHMARK(BM_GetImageBatch)
+    ->ArgPair(0, 32)
+    ->ArgPair(1, 32)
+    ->ArgPair(2, 32)
+    ->ArgPair(0, 256)
+    ->ArgPair(1, 256)
+    ->ArgPair(2, 256);
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -39,9 +39,13 @@ limitations under the License.
 #include "tensorflow/core/lib/io/zlib_compression_options.h"
 #include "tensorflow/core/lib/io/zlib_inputstream.h"
 #include "tensorflow/core/lib/io/zlib_outputbuffer.h"
+#include "tensorflow/core/lib/io/zstd_compression_options.h"
+#include "tensorflow/core/lib/io/zstd_inputstream.h"
+#include "tensorflow/core/lib/io/zstd_outputbuffer.h"
 #include "tensorflow/core/platform/coding.h"
 #include "tensorflow/core/platform/file_system.h"
 #include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/platform.h"
 #include "tensorflow/core/platform/random.h"
 #include "tensorflow/core/platform/strcat.h"
 #include "tensorflow/core/platform/stringprintf.h"
@@ -225,6 +229,17 @@ Status CustomWriter::Initialize(tensorflow::Env* env) {
         zlib_options.output_buffer_size, zlib_options);
     TF_CHECK_OK(zlib_output_buffer->Init());
     dest_.reset(zlib_output_buffer);
+#if !defined(IS_MOBILE_PLATFORM)
+  } else if (compression_type_ == io::compression::kZstd) {
+    zlib_underlying_dest_.swap(dest_);
+    const io::ZstdCompressionOptions zstd_options =
+        io::ZstdCompressionOptions::DEFAULT();
+    auto zstd_output_buffer = std::make_unique<io::ZstdOutputBuffer>(
+        zlib_underlying_dest_.get(), zstd_options.input_buffer_size,
+        zstd_options.output_buffer_size, zstd_options);
+    TF_RETURN_IF_ERROR(zstd_output_buffer->Init());
+    dest_ = std::move(zstd_output_buffer);
+#endif  // IS_MOBILE_PLATFORM
   }
 #endif  // IS_SLIM_BUILD
   simple_tensor_mask_.reserve(dtypes_.size());
@@ -754,6 +769,9 @@ Status TFRecordReaderImpl::Initialize(Env* env) {
   if (output_buffer_size_.has_value()) {
     options.snappy_options.output_buffer_size = *output_buffer_size_;
     options.zlib_options.output_buffer_size = *output_buffer_size_;
+#if !defined(IS_MOBILE_PLATFORM)
+    options.zstd_options.output_buffer_size = *output_buffer_size_;
+#endif  // IS_MOBILE_PLATFORM
   }
 #endif  // IS_SLIM_BUILD
   record_reader_ = std::make_unique<io::RecordReader>(file_.get(), options);
@@ -833,6 +851,14 @@ Status CustomReader::Initialize(Env* env) {
     input_stream_ = std::make_unique<io::ZlibInputStream>(
         input_stream_.release(), zlib_options.input_buffer_size,
         zlib_options.output_buffer_size, zlib_options, true);
+#if !defined(IS_MOBILE_PLATFORM)
+  } else if (compression_type_ == io::compression::kZstd) {
+    const io::ZstdCompressionOptions zstd_options =
+        io::ZstdCompressionOptions::DEFAULT();
+    input_stream_ = std::make_unique<io::ZstdInputStream>(
+        input_stream_.release(), zstd_options.input_buffer_size,
+        zstd_options.output_buffer_size, zstd_options, true);
+#endif  // IS_MOBILE_PLATFORM
   } else if (compression_type_ == io::compression::kSnappy) {
     if (version_ == 0) {
       input_stream_ = std::make_unique<tsl::io::SnappyInputBuffer>(
@@ -23,6 +23,7 @@ limitations under the License.
 
 #include "absl/container/flat_hash_set.h"
 #include "absl/time/time.h"
+#include "tensorflow/core/data/autotune_coordinator.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/platform/env.h"
@@ -138,6 +139,14 @@ std::shared_ptr<model::Model> TfDatazMetricsCollector::GetModel() {
   return model_;
 }
 
+std::optional<AutotuneCoordinator::Allocation>
+TfDatazMetricsCollector::GetAutotuneAllocation() {
+  if (!model_) {
+    return std::nullopt;
+  }
+  return AutotuneCoordinator::Global().GetAllocation(model_.get());
+}
+
 namespace {
 static mutex* get_tfdataz_metrics_registry_lock() {
   static mutex tfdataz_metrics_registry_lock(LINKER_INITIALIZED);
@@ -22,6 +22,7 @@ limitations under the License.
 
 #include "absl/container/flat_hash_set.h"
 #include "absl/time/time.h"
+#include "tensorflow/core/data/autotune_coordinator.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/platform/env.h"
@@ -120,6 +121,11 @@ class TfDatazMetricsCollector {
 
   std::shared_ptr<model::Model> GetModel();
 
+  // Returns the share of the process-wide autotuning budgets allocated to the
+  // iterator by the `AutotuneCoordinator`, or `std::nullopt` if the budgets of
+  // the iterator are not coordinated.
+  std::optional<AutotuneCoordinator::Allocation> GetAutotuneAllocation();
+
  private:
   DatasetBaseIterator* iterator_;  // not owned
   std::shared_ptr<model::Model> model_;
@@ -107,6 +107,16 @@ auto* tf_data_bytes_fetched_counter = tsl::monitoring::Counter<0>::New(
 auto* tf_data_elements_counter = tsl::monitoring::Counter<1>::New(
     "/tensorflow/data/elements", "tf.data elements", "name");
 
+auto* tf_data_cache_queries_counter = tsl::monitoring::Counter<1>::New(
+    "/tensorflow/data/cache_queries",
+    "The number of elements read from a memory-budgeted tf.data cache. The "
+    "result can be a hit (served from memory) or a miss (read from disk).",
+    "cache_hit");
+
+auto* tf_data_cache_spilled_bytes_counter = tsl::monitoring::Counter<0>::New(
+    "/tensorflow/data/cache_spilled_bytes",
+    "The number of bytes spilled to disk by memory-budgeted tf.data caches.");
+
 auto* tf_data_experiment_counter = tsl::monitoring::Counter<1>::New(
     "/tensorflow/data/experiment",
     "The number of times a tf.data experiment was applied.", "name");
@@ -530,6 +540,15 @@ void RecordTFDataBytesFetched(int64_t num_bytes) {
   tf_data_bytes_fetched_counter->GetCell()->IncrementBy(num_bytes);
 }
 
+void RecordTFDataCacheQuery(bool cache_hit) {
+  tf_data_cache_queries_counter->GetCell(cache_hit ? "true" : "false")
+      ->IncrementBy(1);
+}
+
+void RecordTFDataCacheSpilledBytes(int64_t num_bytes) {
+  tf_data_cache_spilled_bytes_counter->GetCell()->IncrementBy(num_bytes);
+}
+
 void RecordTFDataExperiment(const string& name) {
   tf_data_experiment_counter->GetCell(name)->IncrementBy(1);
 }
@@ -81,6 +81,14 @@ monitoring::GaugeCell<std::function<std::string()>>* GetTFDataModelGauge(
 // Records the number of bytes fetched from tf.data.Dataset iterator.
 void RecordTFDataBytesFetched(int64_t num_bytes);
 
+// Records a read from a memory-budgeted tf.data cache. `cache_hit` is true if
+// the element was served from memory and false if it was read back from disk.
+void RecordTFDataCacheQuery(bool cache_hit);
+
+// Records the number of bytes spilled to disk by a memory-budgeted tf.data
+// cache.
+void RecordTFDataCacheSpilledBytes(int64_t num_bytes);
+
 // Records the number of times a tf.data experiment was applied.
 void RecordTFDataExperiment(const string& name);
 
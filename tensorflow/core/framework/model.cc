@@ -283,6 +283,32 @@ inline bool IsAsyncInterleaveManyNode(const Node* node) {
 // Wrapper for the square function to reduce verbosity.
 inline double Square(double x) { return x * x; }
 
+// Returns the per-element cost of grouping `invocation_batch_size` elements
+// into one invocation of a user-defined function: the elements share the
+// `invocation_time` it takes to start the invocation, but are processed one
+// after the other, so an element also waits for half of the others on average.
+inline double InvocationBatchCost(double invocation_batch_size,
+                                  double invocation_time,
+                                  double processing_time) {
+  return invocation_time / invocation_batch_size +
+         (invocation_batch_size - 1.0) * processing_time / 2.0;
+}
+
+// Returns the invocation batch size that minimizes `InvocationBatchCost`.
+// Larger batches only add latency, so they do not make more elements
+// available to the consumer.
+inline double OptimalInvocationBatchSize(double invocation_time,
+                                         double processing_time,
+                                         double max_invocation_batch_size) {
+  if (invocation_time <= 0.0) {
+    return 1.0;
+  }
+  if (processing_time <= 0.0) {
+    return max_invocation_batch_size;
+  }
+  return std::max(1.0, std::sqrt(2.0 * invocation_time / processing_time));
+}
+
 // Collects "essential" parallelism parameters and buffer size parameters in the
 // tree rooted in the given node. Which parallelism parameters are essential is
 // determined by the relative processing time spent in the corresponding
@@ -956,8 +982,13 @@ class AsyncRatio : public Node {
   // specified through `input_times` (since for each element stored in the
   // buffer, the inputs need to be called `Ratio()` times), and if the node has
   // parallelism parameter, then `buffer_size` is derived from `parallelism`.
+  // If the node also has an invocation batch size parameter, each parallel
+  // call produces that many elements, so it scales `buffer_size` up to the
+  // batch size that minimizes `InvocationBatchCost`, which is added to the
+  // self processing time.
   //
-  // Current implementation assumes that there is at most 1 parameter per node.
+  // Apart from the invocation batch size, the current implementation assumes
+  // that there is at most 1 parameter per node.
   void OutputTimeLocked(const NodeValues& input_times,
                         ParameterGradients* gradients, NodeValues* output_times,
                         NodeValues* output_time_gradients) const override
@@ -984,6 +1015,19 @@ class AsyncRatio : public Node {
       buffer_size = (*buffer_size_parameter)->value;
     }
     double self_processing_time = SelfProcessingTimeLocked();
+    auto* invocation_batch_size_parameter =
+        gtl::FindOrNull(parameters_, kInvocationBatchSize);
+    if (invocation_batch_size_parameter) {
+      const double invocation_batch_size =
+          (*invocation_batch_size_parameter)->value;
+      const double invocation_time = InvocationTimeLocked();
+      buffer_size *= std::min(
+          invocation_batch_size,
+          OptimalInvocationBatchSize(invocation_time, self_processing_time,
+                                     invocation_batch_size));
+      self_processing_time += InvocationBatchCost(
+          invocation_batch_size, invocation_time, self_processing_time);
+    }
     double output_time, wait_time, consumer_time, producer_time;
     double input_time = input_times.at(long_name());
 
@@ -1112,6 +1156,11 @@ class AsyncRatio : public Node {
                   memory_ratio_;
       }
     }
+    auto* invocation_batch_size_parameter =
+        gtl::FindOrNull(parameters_, kInvocationBatchSize);
+    if (invocation_batch_size_parameter) {
+      result *= (*invocation_batch_size_parameter)->value;
+    }
     return result;
   }
 
@@ -1394,6 +1443,28 @@ class AsyncUnknownRatio : public AsyncRatio {
   }
 };
 
+// Returns a RAM budget function that returns `fixed_ram_budget` if it is set,
+// and `ram_budget_share` of the available RAM otherwise.
+std::function<int64_t(int64_t)> MakeRamBudgetFunc(
+    double ram_budget_share, std::optional<int64_t> fixed_ram_budget) {
+  if (fixed_ram_budget.has_value()) {
+    return [fixed_ram_budget = fixed_ram_budget.value()](
+               int64_t buffered_bytes) { return fixed_ram_budget; };
+  }
+  // Because the snapshot will take up some memory as time goes,
+  // we need to add the total buffered bytes back
+  // In other words, if we assume the system overall memory does not change:
+  // Assume the port::AvailableRam() returns 1000 before the model starts
+  // to tune the parameters of the dataset ops.
+  // After some time, the dataset ops has buffered some bytes, say `x` bytes
+  // In this case, when we call AvailableRam(), it will return 1000 - `x`.
+  // But we want the `total_ram_budget` to be fixed.
+  // So we need to add `x` bytes back, i.e. AvailableRam() + x == 1000 - x + x
+  return [ram_budget_share](int64_t buffered_bytes) -> int64_t {
+    return ram_budget_share * (port::AvailableRam() + buffered_bytes);
+  };
+}
+
 }  // namespace
 
 thread_local int64_t Node::work_start_;
@@ -1882,6 +1953,14 @@ double Node::SelfProcessingTimeLocked() const {
          static_cast<double>(num_elements_);
 }
 
+double Node::InvocationTimeLocked() const {
+  if (num_invocations_ == 0) {
+    return 0;
+  }
+  return static_cast<double>(invocation_time_) /
+         static_cast<double>(num_invocations_);
+}
+
 Node::NodeVector Node::CollectNodes(
     TraversalOrder order,
     bool collect_node(const std::shared_ptr<Node>)) const {
@@ -2079,6 +2158,8 @@ std::shared_ptr<Node> Node::SnapshotHelper(
     cloned_current->num_elements_.store(num_elements_);
     cloned_current->record_metrics_.store(false);
     cloned_current->processing_time_.store(processing_time_);
+    cloned_current->invocation_time_.store(invocation_time_);
+    cloned_current->num_invocations_.store(num_invocations_);
     {
       mutex_lock l2(cloned_current->mu_);
       cloned_current->parameters_ =
@@ -2346,28 +2427,24 @@ void Model::Optimize(AutotuneAlgorithm algorithm,
                      double model_input_time,
                      RamBudgetManager& ram_budget_manager,
                      CancellationManager* cancellation_manager) {
+  Optimize(algorithm, std::move(cpu_budget_func),
+           MakeRamBudgetFunc(ram_budget_share, fixed_ram_budget),
+           model_input_time, ram_budget_manager, cancellation_manager);
+}
+
+void Model::Optimize(AutotuneAlgorithm algorithm,
+                     std::function<int64_t()> cpu_budget_func,
+                     std::function<int64_t(int64_t)> ram_budget_func,
+                     double model_input_time,
+                     RamBudgetManager& ram_budget_manager,
+                     CancellationManager* cancellation_manager) {
   std::shared_ptr<Node> snapshot;
   {
     tf_shared_lock l(mu_);
     snapshot = output_->Snapshot();
   }
   MaybeSyncStateValuesToValues(snapshot);
-  int64_t total_ram_budget;
-  if (fixed_ram_budget.has_value()) {
-    total_ram_budget = fixed_ram_budget.value();
-  } else {
-    // Because the snapshot will take up some memory as time goes,
-    // we need to add the total buffered bytes back
-    // In other words, if we assume the system overall memory does not change:
-    // Assume the port::AvailableRam() returns 1000 before the model starts
-    // to tune the parameters of the dataset ops.
-    // After some time, the dataset ops has buffered some bytes, say `x` bytes
-    // In this case, when we call AvailableRam(), it will return 1000 - `x`.
-    // But we want the `total_ram_budget` to be fixed.
-    // So we need to add `x` bytes back, i.e. AvailableRam() + x == 1000 - x + x
-    total_ram_budget = ram_budget_share *
-                       (port::AvailableRam() + TotalBufferedBytes(snapshot));
-  }
+  int64_t total_ram_budget = ram_budget_func(TotalBufferedBytes(snapshot));
 
   ram_budget_manager.UpdateBudget(total_ram_budget);
   int64_t model_ram_budget = ram_budget_manager.AvailableModelRam();
@@ -2544,6 +2621,16 @@ Status Model::OptimizeLoop(AutotuneAlgorithm algorithm,
                            std::optional<int64_t> fixed_ram_budget,
                            RamBudgetManager& ram_budget_manager,
                            CancellationManager* cancellation_manager) {
+  return OptimizeLoop(algorithm, std::move(cpu_budget_func),
+                      MakeRamBudgetFunc(ram_budget_share, fixed_ram_budget),
+                      ram_budget_manager, cancellation_manager);
+}
+
+Status Model::OptimizeLoop(AutotuneAlgorithm algorithm,
+                           std::function<int64_t()> cpu_budget_func,
+                           std::function<int64_t(int64_t)> ram_budget_func,
+                           RamBudgetManager& ram_budget_manager,
+                           CancellationManager* cancellation_manager) {
   std::function<void()> unused;
   TF_RETURN_IF_ERROR(RegisterCancellationCallback(
       cancellation_manager,
@@ -2580,8 +2667,8 @@ Status Model::OptimizeLoop(AutotuneAlgorithm algorithm,
     if (algorithm == AutotuneAlgorithm::STAGE_BASED) {
       model_input_time = ComputeTargetTimeNsec();
     }
-    Optimize(algorithm, cpu_budget_func, ram_budget_share, fixed_ram_budget,
-             model_input_time, ram_budget_manager, cancellation_manager);
+    Optimize(algorithm, cpu_budget_func, ram_budget_func, model_input_time,
+             ram_budget_manager, cancellation_manager);
     int64_t end_ms = EnvTime::NowMicros() / EnvTime::kMillisToMicros;
     VLOG(2) << "Optimized for " << end_ms - start_ms << " ms.";
 
@@ -2679,8 +2766,8 @@ void Model::OptimizeHillClimbHelper(
   }
   VLOG(2) << "Number of tunable parameters: " << parameters.size();
 
-  // Buffer size parameter will only be incremented if the output latency
-  // improvement is greater than this constant.
+  // Buffer size and invocation batch size parameters will only be incremented
+  // if the output latency improvement is greater than this constant.
   constexpr double kBufferSizeMinDelta = 1.0L;
 
   // Skip buffer size optimization if we are running the new buffering
@@ -2731,7 +2818,9 @@ void Model::OptimizeHillClimbHelper(
                      /*gradients=*/nullptr);
       double delta = output_time - new_output_time;
       if (delta > best_delta &&
-          (delta > kBufferSizeMinDelta || pair.second->name != kBufferSize)) {
+          (delta > kBufferSizeMinDelta || (pair.second->name != kBufferSize &&
+                                           pair.second->name !=
+                                               kInvocationBatchSize))) {
         best_delta = delta;
         best_parameter = pair.second.get();
       }
@@ -60,6 +60,7 @@ constexpr int64_t kAutotune = -1;
 constexpr char kParallelism[] = "parallelism";
 constexpr char kBufferSize[] = "buffer_size";
 constexpr char kCycleLength[] = "cycle_length";
+constexpr char kInvocationBatchSize[] = "invocation_batch_size";
 constexpr char kDeterministic[] = "deterministic";
 constexpr char kMaxBufferedElements[] = "max_buffered_elements";
 
@@ -310,6 +311,8 @@ class Node {
         bytes_produced_(0),
         num_elements_(0),
         processing_time_(0),
+        invocation_time_(0),
+        num_invocations_(0),
         record_metrics_(true),
         metrics_(name_),
         output_(args.output.get()),
@@ -463,6 +466,15 @@ class Node {
     }
   }
 
+  // Records that it took `time_nanos` to start an invocation of a
+  // user-defined function that processes a group of elements, e.g. to schedule
+  // it on a thread pool. Grouping more elements into an invocation amortizes
+  // this overhead.
+  void record_invocation(int64_t time_nanos) TF_LOCKS_EXCLUDED(mu_) {
+    invocation_time_ += time_nanos;
+    num_invocations_++;
+  }
+
   // Records that the node produced an element.
   void record_element() TF_LOCKS_EXCLUDED(mu_) {
     num_elements_++;
@@ -763,6 +775,10 @@ class Node {
   // Returns the per-element processing time spent in this node.
   double SelfProcessingTimeLocked() const TF_SHARED_LOCKS_REQUIRED(mu_);
 
+  // Returns the average time it took to start an invocation recorded through
+  // `record_invocation`, or 0 if no invocations were recorded.
+  double InvocationTimeLocked() const TF_SHARED_LOCKS_REQUIRED(mu_);
+
   // Computes the per-element CPU time spent in the subtree rooted in this node
   // and stores it in `total_processing_times`. If `processing_times` is not
   // `nullptr`, collects the per-element CPU time spent in each node of the
@@ -842,6 +858,8 @@ class Node {
   std::atomic<int64_t> bytes_produced_;
   std::atomic<int64_t> num_elements_;
   std::atomic<int64_t> processing_time_;
+  std::atomic<int64_t> invocation_time_;
+  std::atomic<int64_t> num_invocations_;
   std::atomic<bool> record_metrics_;
   Metrics metrics_;
   absl::flat_hash_map<string, std::shared_ptr<Parameter>> parameters_
@@ -968,9 +986,8 @@ class Model {
   // values in cases where CPUs budgets may be changed by the runtime
   // dynamically.
   //
-  // `ram_budget_func` is similar to `cpu_budget_func`. This lambda takes a
-  // parameter that is the total number of bytes currently buffered by the
-  // model.
+  // If `fixed_ram_budget` is not set, the RAM budget is `ram_budget_share` of
+  // the available RAM plus the bytes currently buffered by the model.
   //
   // To terminate the execution of the optimization loop, the caller needs to
   // invoke `cancellation_mgr->StartCancel()`.
@@ -981,6 +998,16 @@ class Model {
                       RamBudgetManager& ram_budget_manager,
                       CancellationManager* cancellation_manager);
 
+  // Same as above, except that the RAM budget is provided by
+  // `ram_budget_func`, which is similar to `cpu_budget_func`. This lambda takes
+  // a parameter that is the total number of bytes currently buffered by the
+  // model.
+  Status OptimizeLoop(AutotuneAlgorithm algorithm,
+                      std::function<int64_t()> cpu_budget_func,
+                      std::function<int64_t(int64_t)> ram_budget_func,
+                      RamBudgetManager& ram_budget_manager,
+                      CancellationManager* cancellation_manager);
+
   // Uses the given algorithm and resource budgets to perform the autotuning
   // optimization.
   void Optimize(AutotuneAlgorithm algorithm,
@@ -990,6 +1017,14 @@ class Model {
                 double model_input_time, RamBudgetManager& ram_budget_manager,
                 CancellationManager* cancellation_manager);
 
+  // Same as above, except that the RAM budget is provided by
+  // `ram_budget_func`.
+  void Optimize(AutotuneAlgorithm algorithm,
+                std::function<int64_t()> cpu_budget_func,
+                std::function<int64_t(int64_t)> ram_budget_func,
+                double model_input_time, RamBudgetManager& ram_budget_manager,
+                CancellationManager* cancellation_manager);
+
   // Optimizes buffers in the pipeline rooted at `snapshot`. It downsizes
   // buffers that are too large and upsizes buffers that are too small while
   // respecting the ram budget. If any node is downsized or upsized, the
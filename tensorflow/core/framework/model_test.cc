@@ -3662,6 +3662,115 @@ TEST(NodeTest, TotalMaximumBufferedBytesHasValueWhenElementSizeProvided) {
   EXPECT_EQ(root->TotalMaximumBufferedBytes(), element_size * 7);
 }
 
+TEST(NodeTest, InvocationBatchSizeScalesBufferSize) {
+  // Builds a graph:
+  // root <- parallel_map <- source
+
+  static constexpr int64_t element_size = 100;
+
+  auto invocation_batch_size_parameter = model::MakeParameter(
+      kInvocationBatchSize,
+      std::make_shared<SharedState>(kAutotune, /*mu=*/nullptr,
+                                    /*cond_var=*/nullptr),
+      /*min=*/1, /*max=*/64);
+  auto parallel_map = model::MakeAsyncKnownRatioNode(
+      {0, "parallel_map", nullptr}, /*ratio=*/1,
+      {model::MakeParameter(kParallelism,
+                            std::make_shared<SharedState>(/*value=*/2,
+                                                          /*mu=*/nullptr,
+                                                          /*cond_var=*/nullptr),
+                            /*min=*/1, /*max=*/16),
+       invocation_batch_size_parameter},
+      /*is_legacy_prefetch_autotuned=*/false, element_size);
+  std::shared_ptr<Node> source =
+      model::MakeSourceNode({1, "source", parallel_map});
+  parallel_map->add_input(source);
+  source->add_processing_time(100);
+  source->record_element();
+  // Starting an invocation is expensive compared to the map function.
+  parallel_map->record_invocation(1000);
+
+  auto root = MakeUnknownNode({2, "unknown0", nullptr});
+  root->add_input(parallel_map);
+
+  Model::NodeValues input_times;
+  input_times[kModelInputTimeKey] = 100;
+  EXPECT_EQ(root->TotalMaximumBufferedBytes(), element_size * 2);
+  const double output_time = parallel_map->OutputTime(&input_times, nullptr);
+
+  // Each parallel call now produces 4 elements, so the buffer holds 8 elements
+  // and the invocation time is shared by 4 elements.
+  invocation_batch_size_parameter->value = 4;
+  EXPECT_EQ(root->TotalMaximumBufferedBytes(), element_size * 2 * 4);
+  EXPECT_LT(parallel_map->OutputTime(&input_times, nullptr), output_time);
+}
+
+// Optimizes a parallel map whose map function takes `processing_time` per
+// element and whose invocations take `invocation_time` to start, and returns
+// the chosen invocation batch size.
+double OptimizeInvocationBatchSize(AutotuneAlgorithm algorithm,
+                                   int64_t processing_time,
+                                   int64_t invocation_time) {
+  std::shared_ptr<mutex> mu = std::make_shared<mutex>();
+  std::shared_ptr<condition_variable> cond_var =
+      std::make_shared<condition_variable>();
+  std::shared_ptr<Node> parallel_map = model::MakeAsyncKnownRatioNode(
+      {1, "parallel_map", nullptr}, /*ratio=*/1,
+      {model::MakeParameter(
+           kParallelism,
+           std::make_shared<SharedState>(kAutotune, mu, cond_var),
+           /*min=*/1, /*max=*/4),
+       model::MakeParameter(
+           kInvocationBatchSize,
+           std::make_shared<SharedState>(kAutotune, mu, cond_var),
+           /*min=*/1, /*max=*/64)},
+      /*is_legacy_prefetch_autotuned=*/false, /*estimated_element_size=*/100);
+  parallel_map->add_processing_time(processing_time);
+  parallel_map->record_element();
+  parallel_map->record_invocation(invocation_time);
+  std::shared_ptr<Node> source =
+      model::MakeSourceNode({2, "source", parallel_map});
+  source->add_processing_time(1000);
+  source->record_element();
+
+  model::Model model;
+  model.AddNode(
+      [&parallel_map](model::Node::Args args) { return parallel_map; },
+      "parallel_map", nullptr, &parallel_map);
+  model.AddNode([&source](model::Node::Args args) { return source; }, "source",
+                parallel_map, &source);
+  CancellationManager cancellation_manager;
+  RamBudgetManager ram_budget_manager(/*budget=*/1 << 30);
+  model.Optimize(algorithm, CpuBudgetFunc(4),
+                 /*ram_budget_share=*/1.0,
+                 /*fixed_ram_budget=*/1 << 30,
+                 /*model_input_time=*/1000, ram_budget_manager,
+                 &cancellation_manager);
+  return parallel_map->parameter_value(kInvocationBatchSize);
+}
+
+TEST(ModelTest, InvocationBatchSizeStaysMinimalWithNegligibleOverhead) {
+  // Larger batches would only make the elements of a batch wait for each
+  // other, even though they buffer more elements.
+  EXPECT_EQ(OptimizeInvocationBatchSize(AutotuneAlgorithm::MAX_PARALLELISM,
+                                        /*processing_time=*/1000,
+                                        /*invocation_time=*/1),
+            1);
+  EXPECT_EQ(OptimizeInvocationBatchSize(AutotuneAlgorithm::MAX_PARALLELISM,
+                                        /*processing_time=*/1000,
+                                        /*invocation_time=*/0),
+            1);
+}
+
+TEST(ModelTest, InvocationBatchSizeAmortizesOverhead) {
+  // The cost of a batch is minimal at sqrt(2 * 100000 / 1000) ~ 14 elements.
+  const double invocation_batch_size = OptimizeInvocationBatchSize(
+      AutotuneAlgorithm::MAX_PARALLELISM, /*processing_time=*/1000,
+      /*invocation_time=*/100000);
+  EXPECT_GT(invocation_batch_size, 1);
+  EXPECT_LT(invocation_batch_size, 64);
+}
+
 TEST(NodeTest, TotalMaximumBufferedBytesNoValueWhenElementSizeNotProvided) {
   // Builds a graph:
   // root <- parallel_map <- parallel_interleave
@@ -306,6 +306,14 @@ BatchFunctionKernel::BatchFunctionKernel(OpKernelConstruction* c)
   OP_REQUIRES_OK(c,
                  c->GetAttr("mixed_priority_policy", &mixed_priority_policy_));
   OP_REQUIRES_OK(c, c->GetAttr("batch_padding_policy", &batch_padding_policy_));
+  OP_REQUIRES_OK(c, c->GetAttr("max_batch_tokens",
+                               &token_budget_options_.max_batch_tokens));
+  OP_REQUIRES_OK(c, c->GetAttr("ragged_dimension",
+                               &token_budget_options_.ragged_dimension));
+  OP_REQUIRES_OK(
+      c, c->GetAttr("length_bucket_boundaries",
+                    &token_budget_options_.length_bucket_boundaries));
+  OP_REQUIRES_OK(c, serving::ValidateTokenBudgetOptions(token_budget_options_));
 
   OP_REQUIRES_OK(c, c->GetAttr("f", &func_));
 
@@ -418,6 +426,8 @@ void BatchFunctionKernel::ComputeAsync(OpKernelContext* c, DoneCallback done) {
           adaptive_shared_batch_scheduler_options, max_batch_size_,
           batch_timeout_micros_, max_enqueued_batches_, allowed_batch_sizes_,
           &new_resource));
+      TF_RETURN_IF_ERROR(
+          new_resource->SetTokenBudgetOptions(token_budget_options_));
       if (session_metadata) {
         new_resource->set_session_metadata(*session_metadata);
       }
@@ -440,6 +450,8 @@ void BatchFunctionKernel::ComputeAsync(OpKernelContext* c, DoneCallback done) {
           low_priority_max_enqueued_batches_, low_priority_allowed_batch_sizes_,
           mixed_priority_batching_policy, enable_large_batch_splitting_,
           &new_resource));
+      TF_RETURN_IF_ERROR(
+          new_resource->SetTokenBudgetOptions(token_budget_options_));
       if (session_metadata) {
         new_resource->set_session_metadata(*session_metadata);
       }
@@ -0,0 +1,125 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/batching_util/batch_buffer_pool.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/statusor.h"
+
+namespace tensorflow {
+namespace serving {
+
+BatchBufferPool::BatchBufferPool(const Options& options)
+    : options_(options) {}
+
+StatusOr<Tensor> BatchBufferPool::Get(Allocator* allocator, DataType dtype,
+                                      const TensorShape& shape) {
+  const std::string key = absl::StrCat(dtype, shape.DebugString());
+  {
+    mutex_lock l(mu_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+      for (const Tensor& buffer : it->second.buffers) {
+        // Only the pool holds a reference to this buffer, and no one else can
+        // acquire one while `mu_` is held.
+        if (buffer.RefCountIsOne()) {
+          ++num_reused_buffers_;
+          return buffer;
+        }
+      }
+    }
+  }
+
+  // Allocating is left out of the critical section.
+  Tensor tensor(allocator, dtype, shape);
+  if (!tensor.IsInitialized()) {
+    return errors::ResourceExhausted(
+        "OOM when allocating batch buffer with shape ", shape.DebugString(),
+        " and type ", DataTypeString(dtype), " by allocator ",
+        allocator->Name());
+  }
+  const int64_t bytes = tensor.TotalBytes();
+  mutex_lock l(mu_);
+  auto it = entries_.find(key);
+  if (it != entries_.end() &&
+      static_cast<int>(it->second.buffers.size()) >=
+          options_.max_buffers_per_shape) {
+    return tensor;
+  }
+  if (!MakeRoom(key, bytes)) {
+    return tensor;
+  }
+  it = entries_.find(key);
+  if (it == entries_.end()) {
+    lru_.push_front(key);
+    it = entries_.emplace(key, Entry{{}, lru_.begin()}).first;
+  }
+  it->second.buffers.push_back(tensor);
+  ++num_pooled_buffers_;
+  num_pooled_bytes_ += bytes;
+  return tensor;
+}
+
+bool BatchBufferPool::MakeRoom(const std::string& key, int64_t bytes) {
+  if (options_.max_buffers_per_shape <= 0 || bytes > options_.max_bytes) {
+    return false;
+  }
+  auto victim = lru_.end();
+  while (num_pooled_bytes_ + bytes > options_.max_bytes &&
+         victim != lru_.begin()) {
+    --victim;
+    if (*victim == key) {
+      continue;
+    }
+    auto it = entries_.find(*victim);
+    for (const Tensor& buffer : it->second.buffers) {
+      // Tensors still in use stay alive until their users release them.
+      num_pooled_bytes_ -= buffer.TotalBytes();
+      --num_pooled_buffers_;
+    }
+    entries_.erase(it);
+    victim = lru_.erase(victim);
+  }
+  return num_pooled_bytes_ + bytes <= options_.max_bytes;
+}
+
+int64_t BatchBufferPool::num_pooled_buffers() const {
+  tf_shared_lock l(mu_);
+  return num_pooled_buffers_;
+}
+
+int64_t BatchBufferPool::num_pooled_bytes() const {
+  tf_shared_lock l(mu_);
+  return num_pooled_bytes_;
+}
+
+int64_t BatchBufferPool::num_reused_buffers() const {
+  tf_shared_lock l(mu_);
+  return num_reused_buffers_;
+}
+
+}  // namespace serving
+}  // namespace tensorflow
@@ -0,0 +1,107 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_BATCH_BUFFER_POOL_H_
+#define TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_BATCH_BUFFER_POOL_H_
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace serving {
+
+// A pool of tensors holding the concatenated inputs of batches, so that
+// batches of an already seen dtype and shape (typically one of the allowed
+// batch sizes) are concatenated without allocating.
+//
+// The pool is bounded by the total size of the tensors it keeps. When a new
+// tensor does not fit, the tensors of the least recently requested dtypes and
+// shapes are dropped from the pool to make room for it.
+//
+// A pooled tensor is handed out again only once every tensor sharing its
+// buffer (including slices and outputs forwarded from it) has been destroyed,
+// so callers can pass the tensors they get on to a batch function like any
+// freshly allocated tensor. Thread-safe.
+class BatchBufferPool {
+ public:
+  struct Options {
+    // The maximum number of tensors kept for each dtype and shape. Once they
+    // are all in use, `Get` returns tensors that are not pooled.
+    int max_buffers_per_shape = 1;
+    // The maximum total number of bytes of the tensors kept by the pool.
+    // Tensors larger than this are never pooled.
+    int64_t max_bytes = 0;
+  };
+
+  explicit BatchBufferPool(const Options& options);
+
+  BatchBufferPool(const BatchBufferPool&) = delete;
+  BatchBufferPool& operator=(const BatchBufferPool&) = delete;
+
+  // Returns a tensor of `dtype` and `shape` with unspecified contents, reusing
+  // a pooled tensor no longer in use if there is one, and otherwise allocating
+  // one with `allocator`. All calls are expected to pass the same allocator.
+  StatusOr<Tensor> Get(Allocator* allocator, DataType dtype,
+                       const TensorShape& shape);
+
+  // The number of tensors kept by the pool.
+  int64_t num_pooled_buffers() const;
+
+  // The total number of bytes of the tensors kept by the pool.
+  int64_t num_pooled_bytes() const;
+
+  // The number of `Get` calls that reused a pooled tensor.
+  int64_t num_reused_buffers() const;
+
+ private:
+  // The pooled tensors of one dtype and shape.
+  struct Entry {
+    std::vector<Tensor> buffers;
+    // The position of the entry's key in `lru_`.
+    std::list<std::string>::iterator lru_position;
+  };
+
+  // Drops entries other than `key`, least recently requested first, until
+  // `bytes` more can be pooled. Returns false if that is not possible.
+  bool MakeRoom(const std::string& key, int64_t bytes)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const Options options_;
+
+  mutable mutex mu_;
+  // Pooled tensors, keyed by dtype and shape.
+  absl::flat_hash_map<std::string, Entry> entries_ TF_GUARDED_BY(mu_);
+  // Keys of `entries_`, most recently requested first.
+  std::list<std::string> lru_ TF_GUARDED_BY(mu_);
+  int64_t num_pooled_buffers_ TF_GUARDED_BY(mu_) = 0;
+  int64_t num_pooled_bytes_ TF_GUARDED_BY(mu_) = 0;
+  int64_t num_reused_buffers_ TF_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_BATCH_BUFFER_POOL_H_
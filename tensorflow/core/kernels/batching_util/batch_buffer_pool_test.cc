@@ -0,0 +1,248 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/batching_util/batch_buffer_pool.h"
+
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/device_base.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/kernels/batching_util/concat_split_util.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/threadpool.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+// A host device whose intra-op threads run the sharded concat copies.
+class TestCpuDevice {
+ public:
+  TestCpuDevice()
+      : threads_(Env::Default(), "batch_buffer_pool_test", 4),
+        device_(Env::Default()) {
+    worker_threads_.num_threads = threads_.NumThreads();
+    worker_threads_.workers = &threads_;
+    device_.set_tensorflow_cpu_worker_threads(&worker_threads_);
+  }
+
+  DeviceBase* device() { return &device_; }
+
+ private:
+  thread::ThreadPool threads_;
+  DeviceBase::CpuWorkerThreads worker_threads_;
+  DeviceBase device_;
+};
+
+BatchBufferPool::Options PoolOptions(int max_buffers_per_shape,
+                                     int64_t max_bytes = int64_t{1} << 30) {
+  BatchBufferPool::Options options;
+  options.max_buffers_per_shape = max_buffers_per_shape;
+  options.max_bytes = max_bytes;
+  return options;
+}
+
+TEST(BatchBufferPoolTest, ReusesReleasedBuffer) {
+  BatchBufferPool pool(PoolOptions(/*max_buffers_per_shape=*/2));
+  const void* data;
+  {
+    TF_ASSERT_OK_AND_ASSIGN(Tensor tensor,
+                            pool.Get(cpu_allocator(), DT_FLOAT, {4, 8}));
+    data = tensor.data();
+  }
+  TF_ASSERT_OK_AND_ASSIGN(Tensor tensor,
+                          pool.Get(cpu_allocator(), DT_FLOAT, {4, 8}));
+  EXPECT_EQ(tensor.data(), data);
+  EXPECT_EQ(tensor.shape(), TensorShape({4, 8}));
+  EXPECT_EQ(pool.num_pooled_buffers(), 1);
+  EXPECT_EQ(pool.num_reused_buffers(), 1);
+}
+
+TEST(BatchBufferPoolTest, DoesNotReuseBufferInUse) {
+  BatchBufferPool pool(PoolOptions(/*max_buffers_per_shape=*/2));
+  TF_ASSERT_OK_AND_ASSIGN(Tensor first,
+                          pool.Get(cpu_allocator(), DT_FLOAT, {4, 8}));
+  TF_ASSERT_OK_AND_ASSIGN(Tensor second,
+                          pool.Get(cpu_allocator(), DT_FLOAT, {4, 8}));
+  EXPECT_NE(first.data(), second.data());
+  EXPECT_EQ(pool.num_pooled_buffers(), 2);
+  EXPECT_EQ(pool.num_reused_buffers(), 0);
+}
+
+TEST(BatchBufferPoolTest, DoesNotReuseBufferWithLiveSlice) {
+  BatchBufferPool pool(PoolOptions(/*max_buffers_per_shape=*/2));
+  Tensor slice;
+  const void* data;
+  {
+    TF_ASSERT_OK_AND_ASSIGN(Tensor tensor,
+                            pool.Get(cpu_allocator(), DT_FLOAT, {4, 8}));
+    data = tensor.data();
+    slice = tensor.Slice(0, 1);
+  }
+  TF_ASSERT_OK_AND_ASSIGN(Tensor tensor,
+                          pool.Get(cpu_allocator(), DT_FLOAT, {4, 8}));
+  EXPECT_NE(tensor.data(), data);
+  EXPECT_EQ(pool.num_reused_buffers(), 0);
+}
+
+TEST(BatchBufferPoolTest, PoolsBuffersPerShape) {
+  BatchBufferPool pool(PoolOptions(/*max_buffers_per_shape=*/1));
+  TF_ASSERT_OK_AND_ASSIGN(Tensor first,
+                          pool.Get(cpu_allocator(), DT_FLOAT, {4, 8}));
+  TF_ASSERT_OK_AND_ASSIGN(Tensor second,
+                          pool.Get(cpu_allocator(), DT_FLOAT, {4, 8}));
+  TF_ASSERT_OK_AND_ASSIGN(Tensor third,
+                          pool.Get(cpu_allocator(), DT_FLOAT, {8, 8}));
+  TF_ASSERT_OK_AND_ASSIGN(Tensor fourth,
+                          pool.Get(cpu_allocator(), DT_INT32, {4, 8}));
+  EXPECT_EQ(pool.num_pooled_buffers(), 3);
+}
+
+// The size of a tensor of 32 floats or int32s.
+constexpr int64_t kBufferBytes = 4 * 8 * sizeof(float);
+
+TEST(BatchBufferPoolTest, EvictsLeastRecentlyUsedShapes) {
+  BatchBufferPool pool(PoolOptions(/*max_buffers_per_shape=*/1,
+                                   /*max_bytes=*/2 * kBufferBytes));
+  const void* first_data;
+  const void* second_data;
+  {
+    TF_ASSERT_OK_AND_ASSIGN(Tensor first,
+                            pool.Get(cpu_allocator(), DT_FLOAT, {4, 8}));
+    TF_ASSERT_OK_AND_ASSIGN(Tensor second,
+                            pool.Get(cpu_allocator(), DT_INT32, {4, 8}));
+    first_data = first.data();
+    second_data = second.data();
+  }
+  // Requesting the first shape again makes the second one the least recently
+  // used, so it is dropped to make room for the third one.
+  {
+    TF_ASSERT_OK_AND_ASSIGN(Tensor first,
+                            pool.Get(cpu_allocator(), DT_FLOAT, {4, 8}));
+    EXPECT_EQ(first.data(), first_data);
+    TF_ASSERT_OK_AND_ASSIGN(Tensor third,
+                            pool.Get(cpu_allocator(), DT_FLOAT, {8, 4}));
+  }
+  EXPECT_EQ(pool.num_pooled_buffers(), 2);
+  EXPECT_EQ(pool.num_pooled_bytes(), 2 * kBufferBytes);
+  {
+    TF_ASSERT_OK_AND_ASSIGN(Tensor first,
+                            pool.Get(cpu_allocator(), DT_FLOAT, {4, 8}));
+    EXPECT_EQ(first.data(), first_data);
+  }
+  EXPECT_EQ(pool.num_reused_buffers(), 2);
+  TF_ASSERT_OK_AND_ASSIGN(Tensor second,
+                          pool.Get(cpu_allocator(), DT_INT32, {4, 8}));
+  EXPECT_EQ(pool.num_reused_buffers(), 2);
+  EXPECT_LE(pool.num_pooled_bytes(), 2 * kBufferBytes);
+}
+
+TEST(BatchBufferPoolTest, DoesNotPoolBuffersLargerThanMaxBytes) {
+  BatchBufferPool pool(PoolOptions(/*max_buffers_per_shape=*/1,
+                                   /*max_bytes=*/kBufferBytes));
+  TF_ASSERT_OK_AND_ASSIGN(Tensor small,
+                          pool.Get(cpu_allocator(), DT_FLOAT, {4, 8}));
+  TF_ASSERT_OK_AND_ASSIGN(Tensor large,
+                          pool.Get(cpu_allocator(), DT_FLOAT, {8, 8}));
+  EXPECT_EQ(pool.num_pooled_buffers(), 1);
+  EXPECT_EQ(pool.num_pooled_bytes(), kBufferBytes);
+}
+
+TEST(BatchBufferPoolTest, ConcatIntoPooledBuffer) {
+  BatchBufferPool pool(PoolOptions(/*max_buffers_per_shape=*/1));
+  TestCpuDevice cpu;
+  const std::vector<Tensor> inputs = {
+      test::AsTensor<int64_t>({1, 2, 3, 4}, {2, 2}),
+      test::AsTensor<int64_t>({5, 6}, {1, 2})};
+  for (int i = 0; i < 2; ++i) {
+    TF_ASSERT_OK_AND_ASSIGN(Tensor output,
+                            pool.Get(cpu_allocator(), DT_INT64, {3, 2}));
+    TF_ASSERT_OK(concat_split_util::ConcatInto(cpu.device(), inputs, &output));
+    test::ExpectEqual(output,
+                      test::AsTensor<int64_t>({1, 2, 3, 4, 5, 6}, {3, 2}));
+  }
+  EXPECT_EQ(pool.num_reused_buffers(), 1);
+
+  Tensor output(DT_INT64, {4, 2});
+  EXPECT_FALSE(
+      concat_split_util::ConcatInto(cpu.device(), inputs, &output).ok());
+}
+
+// Number of floats in each row of the benchmark batches.
+constexpr int64_t kRowSize = 4096;
+
+// Concatenates `batch_size` single-row inputs and splits the batch back into
+// rows, as `BatchResourceBase` does around the batch function. With
+// `state.range(1) == 0` the batch is freshly allocated and the outputs are
+// copied; otherwise the batch comes from a `BatchBufferPool` and the outputs
+// are slices of it.
+void BM_BatchConcatSplit(::testing::benchmark::State& state) {
+  const int batch_size = state.range(0);
+  const bool reuse_buffers = state.range(1) != 0;
+
+  TestCpuDevice cpu;
+  std::vector<Tensor> inputs;
+  for (int i = 0; i < batch_size; ++i) {
+    Tensor input(DT_FLOAT, {1, kRowSize});
+    input.flat<float>().setConstant(i);
+    inputs.push_back(input);
+  }
+  const std::vector<int64_t> sizes(batch_size, 1);
+  const TensorShape batch_shape({batch_size, kRowSize});
+  BatchBufferPool pool(PoolOptions(/*max_buffers_per_shape=*/2));
+
+  for (auto s : state) {
+    Tensor batch;
+    if (reuse_buffers) {
+      batch = pool.Get(cpu_allocator(), DT_FLOAT, batch_shape).value();
+    } else {
+      batch = Tensor(cpu_allocator(), DT_FLOAT, batch_shape);
+    }
+    TF_CHECK_OK(concat_split_util::ConcatInto(cpu.device(), inputs, &batch));
+
+    std::vector<Tensor> outputs;
+    bool done = false;
+    if (reuse_buffers) {
+      TF_CHECK_OK(
+          concat_split_util::SplitEasyCases(batch, sizes, &outputs, &done));
+    }
+    if (!done) {
+      TF_CHECK_OK(tensor::Split(batch, sizes, &outputs));
+    }
+    tensorflow::testing::DoNotOptimize(outputs);
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size);
+  state.SetBytesProcessed(state.iterations() * batch_size * kRowSize *
+                          sizeof(float));
+}
+
+BENCHMARK(BM_BatchConcatSplit)
+    ->ArgPair(32, 0)
+    ->ArgPair(32, 1)
+    ->ArgPair(256, 0)
+    ->ArgPair(256, 1);
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
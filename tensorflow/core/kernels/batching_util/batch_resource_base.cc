@@ -27,6 +27,7 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/container/fixed_array.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/functional/bind_front.h"
@@ -51,11 +52,13 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/kernels/batching_util/batch_buffer_pool.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler_utils.h"
 #include "tensorflow/core/kernels/batching_util/batch_stats.h"
 #include "tensorflow/core/kernels/batching_util/concat_split_util.h"
 #include "tensorflow/core/kernels/batching_util/input_split_metadata.h"
+#include "tensorflow/core/kernels/batching_util/ragged_batching_util.h"
 #include "tensorflow/core/kernels/batching_util/threadsafe_status.h"
 #include "tensorflow/core/kernels/batching_util/warmup.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
@@ -288,6 +291,22 @@ int GetTotalTaskSize(
   return tasks_size;
 }
 
+// Caps the number of rows in the batches formed by a queue with `options` at
+// `max_rows`. Padding to allowed batch sizes is dropped, since the token budget
+// already bounds the batches.
+template <typename QueueOptionsT>
+void CapBatchRows(size_t max_rows, bool enable_large_batch_splitting,
+                  QueueOptionsT& options) {
+  if (enable_large_batch_splitting) {
+    options.max_execution_batch_size =
+        std::min(options.max_execution_batch_size, max_rows);
+  } else {
+    options.input_batch_size_limit =
+        std::min(options.input_batch_size_limit, max_rows);
+  }
+  options.allowed_batch_sizes.clear();
+}
+
 }  // namespace
 
 std::unique_ptr<BatchResourceBase::BatchTask>
@@ -308,6 +327,7 @@ BatchResourceBase::BatchTask::CreateSplitTask(
   task->start_time = this->start_time;
   task->request_cost = this->request_cost;
   task->forced_warmup_batch_size = this->forced_warmup_batch_size;
+  task->request_deadline = this->request_deadline;
 
   return task;
 }
@@ -367,11 +387,16 @@ Status BatchResourceBase::RegisterInput(
     int64_t guid, OpKernelContext* context, const string& batcher_queue_name,
     const CreateBatchTaskFn& create_batch_task_fn,
     AsyncOpKernel::DoneCallback done_callback, int forced_warmup_batch_size) {
+  {
+    absl::MutexLock l(&token_budget_mu_);
+    inputs_registered_ = true;
+  }
   TF_ASSIGN_OR_RETURN(std::unique_ptr<BatchTask> batch_components,
                       create_batch_task_fn());
   batch_components->start_time = EnvTime::NowNanos();
   batch_components->guid = guid;
   batch_components->propagated_context = Context(ContextKind::kThread);
+  batch_components->request_deadline = context->deadline();
 
   OpInputList tensors;
   TF_RETURN_IF_ERROR(context->input_list("in_tensors", &tensors));
@@ -471,9 +496,34 @@ Status BatchResourceBase::RegisterInput(
     batch_components->request_cost = request_cost_accessor->GetRequestCost();
   }
 
+  // With token budget batching, requests are queued per length bucket.
+  string bucketed_queue_name = batcher_queue_name;
+  int length_bucket = -1;
+  if (token_budget_options_.enabled()) {
+    const int ragged_dimension = token_budget_options_.ragged_dimension;
+    TF_ASSIGN_OR_RETURN(
+        const int64_t row_length,
+        GetRowLength(batch_components->inputs[0], ragged_dimension));
+    for (const Tensor& tensor : batch_components->inputs) {
+      if (tensor.dims() > ragged_dimension &&
+          GetRowLength(tensor, ragged_dimension).value() != row_length) {
+        return errors::InvalidArgument(
+            "Ragged batching input tensors supplied in a given op invocation "
+            "must have equal sizes along dimensions [1, ",
+            ragged_dimension, "].\nBelow are the input tensors: \n",
+            GetTensorNamesAndShapesString(context, tensors));
+      }
+    }
+    TF_ASSIGN_OR_RETURN(length_bucket,
+                        GetLengthBucket(row_length, token_budget_options_));
+    bucketed_queue_name =
+        absl::StrCat(batcher_queue_name, "/length_bucket_", length_bucket);
+  }
+
   BatcherQueueT* batcher_queue;
-  TF_RETURN_IF_ERROR(
-      LookupOrCreateBatcherQueue(batcher_queue_name, &batcher_queue));
+  TF_RETURN_IF_ERROR(LookupOrCreateBatcherQueue(
+      bucketed_queue_name, GetModelName(context), context->op_kernel().name(),
+      length_bucket, &batcher_queue));
 
   if (!session_metadata().name().empty()) {
     absl::MutexLock lock(&outstanding_batch_mu_);
@@ -637,6 +687,10 @@ bool BatchResourceBase::IsLowPriorityBatch(const BatchT& batch) const {
 // returns 'batch_size'.
 int BatchResourceBase::RoundToLowestAllowedBatchSize(
     int batch_size, bool is_low_priority_batch) const {
+  // Packed ragged inputs are never padded.
+  if (token_budget_options_.enabled()) {
+    return batch_size;
+  }
   const std::vector<int32>& allowed_batch_sizes =
       is_low_priority_batch ? batcher_queue_options_.low_priority_queue_options
                                   .allowed_batch_sizes
@@ -689,7 +743,20 @@ Status BatchResourceBase::ConcatInputTensors(
 
   // All tasks should have the same number of input edges.
   const int num_inputs = batch.task(0).inputs.size();
-  concatenated_tensors->reserve(num_inputs);
+  concatenated_tensors->reserve(num_inputs + 1);
+  const bool pack_ragged_inputs = token_budget_options_.enabled();
+  const int ragged_dimension = token_budget_options_.ragged_dimension;
+  Tensor row_splits;
+  // Batches which are not padded to an allowed batch size may have any size,
+  // which would fill the pool with shapes that are rarely seen again.
+  const std::vector<int32>& allowed_batch_sizes =
+      IsLowPriorityBatch(batch)
+          ? batcher_queue_options_.low_priority_queue_options
+                .allowed_batch_sizes
+          : allowed_batch_sizes_;
+  const bool use_buffer_pool =
+      input_buffer_pool_ != nullptr && !pack_ragged_inputs &&
+      absl::c_linear_search(allowed_batch_sizes, padded_batch_size);
 
   // Process each input one at a time (the typical case has just one). When
   // `just_for_warmup` is true, the real data is not added. Otherwise, the real
@@ -731,12 +798,46 @@ Status BatchResourceBase::ConcatInputTensors(
       }
     }
 
+    // Merge the rows of ragged inputs into the 0th dimension, so that they
+    // can be concatenated without padding them to a common length.
+    if (pack_ragged_inputs && i == 0) {
+      TF_ASSIGN_OR_RETURN(row_splits,
+                          MakeRowSplits(to_concatenate, ragged_dimension));
+    }
+    if (pack_ragged_inputs &&
+        batch.task(0).inputs.at(i).dims() > ragged_dimension) {
+      for (Tensor& tensor : to_concatenate) {
+        TF_ASSIGN_OR_RETURN(tensor,
+                            FlattenRaggedRows(tensor, ragged_dimension));
+      }
+    }
+
     Tensor concatenated_tensor;
-    Status concat_status =
-        Concat(context, to_concatenate, &concatenated_tensor);
-    TF_RETURN_IF_ERROR(concat_status);
+    if (use_buffer_pool) {
+      // Reuses the buffer of an earlier batch of the same size if one is no
+      // longer in use.
+      TensorShape concatenated_shape;
+      TF_RETURN_IF_ERROR(concat_split_util::GetConcatOutputShape(
+          to_concatenate, &concatenated_shape));
+      AllocatorAttributes attr;
+      attr.set_on_host(true);
+      TF_ASSIGN_OR_RETURN(
+          concatenated_tensor,
+          input_buffer_pool_->Get(context->get_allocator(attr),
+                                  to_concatenate[0].dtype(),
+                                  concatenated_shape));
+      TF_RETURN_IF_ERROR(concat_split_util::ConcatInto(
+          context->device(), to_concatenate, &concatenated_tensor));
+    } else {
+      Status concat_status =
+          Concat(context, to_concatenate, &concatenated_tensor);
+      TF_RETURN_IF_ERROR(concat_status);
+    }
     concatenated_tensors->push_back(concatenated_tensor);
   }
+  if (pack_ragged_inputs) {
+    concatenated_tensors->push_back(std::move(row_splits));
+  }
   return absl::OkStatus();
 }
 
@@ -889,12 +990,20 @@ Status BatchResourceBase::SplitOutputTensors(
     }
 
     std::vector<Tensor> split_tensor;
-    const Status split_status = tensor::Split(
-        output_tensor, task_sizes_plus_optional_padding, &split_tensor);
-    DCHECK(split_status.ok()) << split_status;
-    if (!split_status.ok()) {
-      return errors::Internal("Tensor split operation failed: ",
-                              split_status.message());
+    bool sliced = false;
+    if (batch_copy_options_.slice_outputs) {
+      TF_RETURN_IF_ERROR(concat_split_util::SplitEasyCases(
+          output_tensor, task_sizes_plus_optional_padding, &split_tensor,
+          &sliced));
+    }
+    if (!sliced) {
+      const Status split_status = tensor::Split(
+          output_tensor, task_sizes_plus_optional_padding, &split_tensor);
+      DCHECK(split_status.ok()) << split_status;
+      if (!split_status.ok()) {
+        return errors::Internal("Tensor split operation failed: ",
+                                split_status.message());
+      }
     }
     DCHECK_EQ(split_tensor.size(), task_sizes_plus_optional_padding.size());
     if (split_tensor.size() != task_sizes_plus_optional_padding.size()) {
@@ -1172,9 +1281,41 @@ void BatchResourceBase::ProcessBatchCallBack(
   }
 }
 
+Status BatchResourceBase::SetTokenBudgetOptions(TokenBudgetOptions options) {
+  TF_RETURN_IF_ERROR(ValidateTokenBudgetOptions(options));
+  if (options.enabled() && !has_process_batch_function_) {
+    return errors::InvalidArgument(
+        "Token budget batching requires a batch processing function.");
+  }
+  absl::MutexLock l(&token_budget_mu_);
+  if (inputs_registered_) {
+    return errors::FailedPrecondition(
+        "Token budget options must be set before the first input is "
+        "registered.");
+  }
+  token_budget_options_ = std::move(options);
+  return absl::OkStatus();
+}
+
+void BatchResourceBase::SetBatchCopyOptions(BatchCopyOptions options) {
+  batch_copy_options_ = std::move(options);
+  if (batch_copy_options_.max_pooled_buffers_per_shape > 0) {
+    BatchBufferPool::Options pool_options;
+    pool_options.max_buffers_per_shape =
+        batch_copy_options_.max_pooled_buffers_per_shape;
+    pool_options.max_bytes = batch_copy_options_.max_pooled_bytes;
+    input_buffer_pool_ = std::make_unique<BatchBufferPool>(pool_options);
+  } else {
+    input_buffer_pool_.reset();
+  }
+}
+
 // Looks up the batcher queue for 'queue_name'. If it didn't previously exist,
 // creates it.
 Status BatchResourceBase::LookupOrCreateBatcherQueue(const string& queue_name,
+                                                     const string& model_name,
+                                                     const string& op_name,
+                                                     int length_bucket,
                                                      BatcherQueueT** queue) {
   mutex_lock l(batcher_queues_mu_);
 
@@ -1186,8 +1327,26 @@ Status BatchResourceBase::LookupOrCreateBatcherQueue(const string& queue_name,
 
   std::unique_ptr<BatcherQueueT> new_queue;
   if (batcher_) {
+    BatcherT::QueueOptions queue_options = batcher_queue_options_;
+    if (queue_options.enable_deadline_aware_scheduling &&
+        queue_options.batch_stats == nullptr) {
+      // The same costs are registered by SplitBatchCostsAndRecordMetrics().
+      queue_options.batch_stats =
+          &GlobalBatchStats().model(/*model_name=*/model_name,
+                                    /*op_name=*/op_name);
+    }
+    if (length_bucket >= 0) {
+      const size_t max_rows =
+          GetMaxBatchRows(token_budget_options_, length_bucket);
+      const bool splitting = queue_options.enable_large_batch_splitting;
+      CapBatchRows(max_rows, splitting, queue_options);
+      CapBatchRows(max_rows, splitting,
+                   queue_options.high_priority_queue_options);
+      CapBatchRows(max_rows, splitting,
+                   queue_options.low_priority_queue_options);
+    }
     TF_RETURN_IF_ERROR(batcher_->AddQueue(
-        batcher_queue_options_,
+        queue_options,
         absl::bind_front(&BatchResourceBase::ProcessBatchCallBack, this),
         &new_queue));
   } else if (adaptive_batcher_) {
@@ -1195,9 +1354,15 @@ Status BatchResourceBase::LookupOrCreateBatcherQueue(const string& queue_name,
         reduced_process_batch_callback = [this](std::unique_ptr<BatchT> batch) {
           ProcessBatchCallBack(std::move(batch), {});
         };
+    AdaptiveBatcherT::QueueOptions queue_options =
+        adaptive_batcher_queue_options_;
+    if (length_bucket >= 0) {
+      queue_options.max_batch_size = std::min<int64_t>(
+          queue_options.max_batch_size,
+          GetMaxBatchRows(token_budget_options_, length_bucket));
+    }
     TF_RETURN_IF_ERROR(adaptive_batcher_->AddQueue(
-        adaptive_batcher_queue_options_, reduced_process_batch_callback,
-        &new_queue));
+        queue_options, reduced_process_batch_callback, &new_queue));
   } else {
     return errors::Internal("No batcher defined.");
   }
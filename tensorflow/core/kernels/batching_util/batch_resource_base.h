@@ -20,12 +20,14 @@ limitations under the License.
 #include <functional>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/strings/str_join.h"
 #include "absl/synchronization/blocking_counter.h"
+#include "absl/time/time.h"
 #include "tensorflow/core/common_runtime/cost_measurement_registry.h"
 #include "tensorflow/core/common_runtime/request_cost.h"
 #include "tensorflow/core/framework/op_kernel.h"
@@ -33,7 +35,9 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/kernels/batching_util/adaptive_shared_batch_scheduler.h"
+#include "tensorflow/core/kernels/batching_util/batch_buffer_pool.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler.h"
+#include "tensorflow/core/kernels/batching_util/ragged_batching_util.h"
 #include "tensorflow/core/kernels/batching_util/shared_batch_scheduler.h"
 #include "tensorflow/core/kernels/batching_util/threadsafe_status.h"
 #include "tensorflow/core/platform/context.h"
@@ -134,6 +138,14 @@ class BatchResourceBase : public ResourceBase {
       return criticality_val;
     };
 
+    // The deadline of the op invocation, propagated from the session run (and
+    // thus from the RPC that triggered it, if any).
+    std::optional<absl::Time> request_deadline;
+
+    std::optional<absl::Time> deadline() const override {
+      return request_deadline;
+    }
+
     // If nonzero, make a batch of this size entirely out of padding. This
     // batch is processed, but is not propagated to the kernel outputs.
     int forced_warmup_batch_size = 0;
@@ -183,6 +195,43 @@ class BatchResourceBase : public ResourceBase {
 
   const SessionMetadata& session_metadata() const { return session_metadata_; }
 
+  // Enables token budget batching (see `TokenBudgetOptions`) if
+  // `options.max_batch_tokens` is positive. Requires a batch processing
+  // function, which receives the row splits of the packed inputs after the
+  // batched inputs. Fails once an input has been registered, after which the
+  // options are read without synchronization.
+  Status SetTokenBudgetOptions(TokenBudgetOptions options);
+
+  const TokenBudgetOptions& token_budget_options() const {
+    return token_budget_options_;
+  }
+
+  // Options of the copies of the task tensors into and out of the batches.
+  struct BatchCopyOptions {
+    // If positive, the batched inputs are written to host tensors kept in a
+    // `BatchBufferPool`, up to this many per dtype and shape, instead of
+    // tensors allocated for each batch. Only batches padded to one of the
+    // allowed batch sizes are pooled, so that the number of shapes is bounded.
+    // The inputs packed by token budget batching are not pooled, as their
+    // shapes vary with every batch.
+    int max_pooled_buffers_per_shape = 0;
+    // The maximum total number of bytes of the pooled tensors. The tensors of
+    // the least recently used shapes are dropped from the pool beyond it.
+    int64_t max_pooled_bytes = int64_t{1} << 30;
+    // If true, the outputs of the tasks are slices sharing the buffers of the
+    // batched outputs instead of copies, whenever the slices are aligned. The
+    // batched outputs then stay alive as long as the output of any task of the
+    // batch, which consumers holding on to outputs must be able to afford.
+    bool slice_outputs = false;
+  };
+
+  // Must be called before the first input is registered.
+  void SetBatchCopyOptions(BatchCopyOptions options);
+
+  const BatchCopyOptions& batch_copy_options() const {
+    return batch_copy_options_;
+  }
+
   using CreateBatchTaskFn =
       std::function<StatusOr<std::unique_ptr<BatchTask>>()>;
 
@@ -333,12 +382,27 @@ class BatchResourceBase : public ResourceBase {
                                 int output_index);
 
   // Looks up the batcher queue for 'queue_name'. If it did't previously exist,
-  // creates it.
+  // creates it. 'length_bucket' is the length bucket of the queue when token
+  // budget batching is enabled, and -1 otherwise. 'model_name' and 'op_name'
+  // identify the batch costs used by deadline-aware queues.
   Status LookupOrCreateBatcherQueue(const string& queue_name,
+                                    const string& model_name,
+                                    const string& op_name, int length_bucket,
                                     BatcherQueueT** queue);
 
   SessionMetadata session_metadata_;
 
+  absl::Mutex token_budget_mu_;
+  // Set by the first `RegisterInput`. `token_budget_options_` is only written
+  // before that, so it can be read without holding `token_budget_mu_`.
+  bool inputs_registered_ TF_GUARDED_BY(token_budget_mu_) = false;
+  TokenBudgetOptions token_budget_options_;
+
+  BatchCopyOptions batch_copy_options_;
+  // Pool of the batched inputs, set if
+  // `batch_copy_options_.max_pooled_buffers_per_shape` is positive.
+  std::unique_ptr<BatchBufferPool> input_buffer_pool_;
+
   absl::Mutex outstanding_batch_mu_;
   int num_outstanding_batched_items_ TF_GUARDED_BY(outstanding_batch_mu_) = 0;
 
@@ -16,27 +16,43 @@ limitations under the License.
 #include "tensorflow/core/kernels/batching_util/batch_resource_base.h"
 
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "tensorflow/core/common_runtime/cost_constants.h"
 #include "tensorflow/core/common_runtime/cost_measurement.h"
 #include "tensorflow/core/common_runtime/cost_measurement_registry.h"
 #include "tensorflow/core/common_runtime/request_cost.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/kernels/batching_util/batch_stats.h"
+#include "tensorflow/core/kernels/batching_util/ragged_batching_util.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/platform/refcount.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tsl/platform/criticality.h"
 
 namespace tensorflow {
 namespace serving {
 namespace {
 
+using ::testing::ElementsAre;
 using ::testing::Pair;
 using ::testing::UnorderedElementsAre;
 
@@ -400,6 +416,259 @@ TEST(SplitBatchCostsAndRecordMetricsTest, GlobalBatchStatsProcessedSize) {
             original_cumulative_processed_size + 4);
 }
 
+// A batch resource which runs `process_batch` as its batch function.
+class TestBatchResource : public BatchResourceBase {
+ public:
+  using ProcessBatchFn =
+      std::function<Status(absl::Span<const Tensor>, std::vector<Tensor>*)>;
+
+  TestBatchResource(std::shared_ptr<BatcherT> batcher,
+                    const BatcherT::QueueOptions& queue_options,
+                    std::vector<int32> allowed_batch_sizes,
+                    ProcessBatchFn process_batch)
+      : BatchResourceBase(/*has_process_batch_function=*/true,
+                          std::move(batcher), queue_options,
+                          std::move(allowed_batch_sizes)),
+        process_batch_(std::move(process_batch)) {}
+
+  string DebugString() const override { return "TestBatchResource"; }
+
+ private:
+  void ProcessFuncBatchImpl(
+      const BatchTask& last_task, absl::Span<const Tensor> inputs,
+      std::vector<Tensor>* combined_outputs,
+      std::function<void(const Status&)> done) const override {
+    done(process_batch_(inputs, combined_outputs));
+  }
+
+  const ProcessBatchFn process_batch_;
+};
+
+core::RefCountPtr<TestBatchResource> CreateTestBatchResource(
+    int max_batch_size, const std::vector<int32>& allowed_batch_sizes,
+    TestBatchResource::ProcessBatchFn process_batch) {
+  BatchResourceBase::BatcherT::Options options;
+  options.num_batch_threads = 2;
+  std::shared_ptr<BatchResourceBase::BatcherT> batcher;
+  TF_CHECK_OK(BatchResourceBase::BatcherT::Create(options, &batcher));
+  // Batches are only processed once they are full.
+  return core::RefCountPtr<TestBatchResource>(new TestBatchResource(
+      std::move(batcher),
+      BatchResourceBase::GetBatcherQueueOptions(
+          /*num_batch_threads=*/2, max_batch_size,
+          /*batch_timeout_micros=*/60 * 1000 * 1000,
+          /*max_enqueued_batches=*/10, allowed_batch_sizes,
+          /*enable_large_batch_splitting=*/false, /*disable_padding=*/false),
+      allowed_batch_sizes, std::move(process_batch)));
+}
+
+// The resource `BatchResourceBaseTestOp` registers its inputs with.
+BatchResourceBase* test_op_batch_resource = nullptr;
+
+REGISTER_OP("BatchResourceBaseTestOp")
+    .Input("in_tensors: Tin")
+    .Output("out_tensors: Tout")
+    .Attr("Tin: list(type)")
+    .Attr("Tout: list(type)");
+
+class BatchResourceBaseTestOp : public AsyncOpKernel {
+ public:
+  explicit BatchResourceBaseTestOp(OpKernelConstruction* context)
+      : AsyncOpKernel(context) {}
+
+  void ComputeAsync(OpKernelContext* context, DoneCallback done) override {
+    OP_REQUIRES_OK_ASYNC(
+        context,
+        test_op_batch_resource->RegisterInput(
+            random::New64(), context, "batch_queue",
+            []() -> StatusOr<std::unique_ptr<BatchResourceBase::BatchTask>> {
+              return std::make_unique<BatchResourceBase::BatchTask>();
+            },
+            done),
+        done);
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("BatchResourceBaseTestOp").Device(DEVICE_CPU),
+                        BatchResourceBaseTestOp);
+
+// Runs `BatchResourceBaseTestOp` on a single int64 input.
+class TestOpRunner : public OpsTestBase {
+ public:
+  Status Run(const Tensor& input, Tensor* output) {
+    TF_RETURN_IF_ERROR(
+        NodeDefBuilder("batch", "BatchResourceBaseTestOp")
+            .Input(std::vector<NodeDefBuilder::NodeOut>{{"input", 0, DT_INT64}})
+            .Attr("Tout", {DT_INT64})
+            .Finalize(node_def()));
+    TF_RETURN_IF_ERROR(InitOp());
+    AddInputFromArray<int64_t>(input.shape(), input.flat<int64_t>());
+    TF_RETURN_IF_ERROR(RunOpKernel());
+    *output = *GetOutput(0);
+    return absl::OkStatus();
+  }
+
+  void TestBody() override {}
+};
+
+// Runs `BatchResourceBaseTestOp` on each of `inputs` concurrently, so that they
+// can be batched together by `resource`, and returns the outputs.
+std::vector<Tensor> RunConcurrently(BatchResourceBase* resource,
+                                    const std::vector<Tensor>& inputs) {
+  test_op_batch_resource = resource;
+  std::vector<Tensor> outputs(inputs.size());
+  {
+    thread::ThreadPool pool(Env::Default(), "test_op_runners", inputs.size());
+    for (int i = 0; i < inputs.size(); ++i) {
+      pool.Schedule([&inputs, &outputs, i]() {
+        TestOpRunner runner;
+        TF_ASSERT_OK(runner.Run(inputs[i], &outputs[i]));
+      });
+    }
+  }
+  test_op_batch_resource = nullptr;
+  return outputs;
+}
+
+TEST(BatchResourceBaseTest, TokenBudgetBatching) {
+  mutex mu;
+  std::vector<std::vector<int64_t>> batch_row_splits;
+  std::vector<TensorShape> batch_value_shapes;
+  // Returns the sum of the values of each packed row.
+  core::RefCountPtr<TestBatchResource> resource = CreateTestBatchResource(
+      /*max_batch_size=*/8, /*allowed_batch_sizes=*/{},
+      [&](absl::Span<const Tensor> inputs, std::vector<Tensor>* outputs) {
+        if (inputs.size() != 2) {
+          return errors::InvalidArgument("Expected values and row splits.");
+        }
+        auto values = inputs[0].flat<int64_t>();
+        auto row_splits = inputs[1].vec<int64_t>();
+        {
+          mutex_lock l(mu);
+          batch_row_splits.emplace_back(row_splits.data(),
+                                        row_splits.data() + row_splits.size());
+          batch_value_shapes.push_back(inputs[0].shape());
+        }
+        Tensor sums(DT_INT64, TensorShape({row_splits.size() - 1}));
+        for (int64_t row = 0; row + 1 < row_splits.size(); ++row) {
+          int64_t sum = 0;
+          for (int64_t i = row_splits(row); i < row_splits(row + 1); ++i) {
+            sum += values(i);
+          }
+          sums.vec<int64_t>()(row) = sum;
+        }
+        outputs->push_back(std::move(sums));
+        return absl::OkStatus();
+      });
+  // Rows of up to 4 tokens are batched 4 at a time, rows of up to 8 tokens 2
+  // at a time.
+  TokenBudgetOptions token_budget_options;
+  token_budget_options.max_batch_tokens = 16;
+  token_budget_options.length_bucket_boundaries = {4, 8};
+  TF_ASSERT_OK(resource->SetTokenBudgetOptions(token_budget_options));
+
+  std::vector<Tensor> inputs;
+  std::vector<int64_t> row_lengths = {3, 3, 3, 3, 6, 6};
+  for (int i = 0; i < row_lengths.size(); ++i) {
+    Tensor input(DT_INT64, TensorShape({1, row_lengths[i]}));
+    input.flat<int64_t>().setConstant(i + 1);
+    inputs.push_back(input);
+  }
+  std::vector<Tensor> outputs = RunConcurrently(resource.get(), inputs);
+
+  // Each length bucket has its own queue, and its rows are packed without
+  // padding.
+  EXPECT_THAT(batch_row_splits,
+              UnorderedElementsAre(ElementsAre(0, 3, 6, 9, 12),
+                                   ElementsAre(0, 6, 12)));
+  EXPECT_THAT(batch_value_shapes,
+              ElementsAre(TensorShape({12}), TensorShape({12})));
+  // The outputs are split back into one row per task.
+  for (int i = 0; i < row_lengths.size(); ++i) {
+    test::ExpectEqual(outputs[i], test::AsTensor<int64_t>(
+                                      {(i + 1) * row_lengths[i]}, {1}));
+  }
+}
+
+TEST(BatchResourceBaseTest, TokenBudgetOptionsFrozenByFirstInput) {
+  core::RefCountPtr<TestBatchResource> resource = CreateTestBatchResource(
+      /*max_batch_size=*/1, /*allowed_batch_sizes=*/{},
+      // Returns one value per packed row.
+      [](absl::Span<const Tensor> inputs, std::vector<Tensor>* outputs) {
+        Tensor output(DT_INT64, TensorShape({inputs[1].NumElements() - 1}));
+        output.flat<int64_t>().setZero();
+        outputs->push_back(std::move(output));
+        return absl::OkStatus();
+      });
+  TokenBudgetOptions token_budget_options;
+  token_budget_options.max_batch_tokens = 16;
+  TF_ASSERT_OK(resource->SetTokenBudgetOptions(token_budget_options));
+
+  RunConcurrently(resource.get(), {test::AsTensor<int64_t>({1, 2}, {1, 2})});
+
+  // The batcher queues and the batching of registered inputs depend on the
+  // options, so they can no longer change.
+  EXPECT_TRUE(errors::IsFailedPrecondition(
+      resource->SetTokenBudgetOptions(TokenBudgetOptions())));
+}
+
+TEST(BatchResourceBaseTest, PooledInputsAndSlicedOutputs) {
+  mutex mu;
+  std::vector<TensorShape> batch_shapes;
+  // Forwards the batched input, so that the outputs of the tasks are slices of
+  // the pooled input buffer.
+  core::RefCountPtr<TestBatchResource> resource = CreateTestBatchResource(
+      /*max_batch_size=*/4, /*allowed_batch_sizes=*/{2, 4},
+      [&](absl::Span<const Tensor> inputs, std::vector<Tensor>* outputs) {
+        {
+          mutex_lock l(mu);
+          batch_shapes.push_back(inputs[0].shape());
+        }
+        outputs->push_back(inputs[0]);
+        return absl::OkStatus();
+      });
+  BatchResourceBase::BatchCopyOptions batch_copy_options;
+  batch_copy_options.max_pooled_buffers_per_shape = 1;
+  batch_copy_options.slice_outputs = true;
+  resource->SetBatchCopyOptions(batch_copy_options);
+
+  // Rows of 8 int64s keep the output slices aligned.
+  auto make_inputs = [](int64_t round) {
+    std::vector<Tensor> inputs;
+    for (int i = 0; i < 4; ++i) {
+      Tensor input(DT_INT64, TensorShape({1, 8}));
+      input.flat<int64_t>().setConstant(round * 100 + i);
+      inputs.push_back(input);
+    }
+    return inputs;
+  };
+  const std::vector<Tensor> first_inputs = make_inputs(1);
+  std::vector<Tensor> first_outputs =
+      RunConcurrently(resource.get(), first_inputs);
+  // The outputs of the first batch still use the pooled buffer, so the second
+  // batch must not be written to it.
+  const std::vector<Tensor> second_inputs = make_inputs(2);
+  std::vector<Tensor> second_outputs =
+      RunConcurrently(resource.get(), second_inputs);
+  for (int i = 0; i < 4; ++i) {
+    test::ExpectEqual(first_outputs[i], first_inputs[i]);
+    test::ExpectEqual(second_outputs[i], second_inputs[i]);
+  }
+
+  // Once released, the pooled buffer is written again.
+  first_outputs.clear();
+  second_outputs.clear();
+  const std::vector<Tensor> third_inputs = make_inputs(3);
+  std::vector<Tensor> third_outputs =
+      RunConcurrently(resource.get(), third_inputs);
+  for (int i = 0; i < 4; ++i) {
+    test::ExpectEqual(third_outputs[i], third_inputs[i]);
+  }
+  EXPECT_THAT(batch_shapes, ElementsAre(TensorShape({4, 8}),
+                                        TensorShape({4, 8}),
+                                        TensorShape({4, 8})));
+}
+
 }  // namespace
 }  // namespace serving
 }  // namespace tensorflow
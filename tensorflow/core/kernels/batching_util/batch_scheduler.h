@@ -40,6 +40,7 @@ limitations under the License.
 
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/logging.h"
@@ -92,6 +93,10 @@ class BatchTask {
   virtual tsl::criticality::Criticality criticality() const {
     return tsl::criticality::Criticality::kCritical;
   }
+
+  // Returns the time by which the task should be processed, if any. Only
+  // consulted by queues with deadline-aware scheduling enabled.
+  virtual std::optional<absl::Time> deadline() const { return std::nullopt; }
 };
 
 // A thread-safe collection of BatchTasks. Tasks can be either added or removed
@@ -117,6 +117,7 @@ class CostTracker {
 class BatchSizeStats {
  public:
   CostTracker& tpu_cost() { return tpu_cost_; };
+  const CostTracker& tpu_cost() const { return tpu_cost_; };
 
  private:
   CostTracker tpu_cost_;
@@ -167,6 +168,33 @@ class ModelBatchStats {
     return result;
   }
 
+  // Returns the estimated TPU cost of processing a batch of size `batch_size`:
+  // the mean cost of the smallest batch size with samples that is at least
+  // `batch_size`, or, if `batch_size` is larger than all of them, the mean
+  // cost of the largest one scaled linearly.
+  //
+  // Returns std::nullopt if no samples have been registered.
+  std::optional<absl::Duration> EstimateTpuCost(int32 batch_size) const {
+    std::optional<int32> ceil_size, max_size;
+    absl::Duration ceil_cost, max_cost;
+    mutex_lock l(mu_);
+    for (const auto& [size, stats] : batch_size_stats_by_batch_size_) {
+      std::optional<absl::Duration> cost = stats.tpu_cost().mean();
+      if (!cost.has_value()) continue;
+      if (size >= batch_size && (!ceil_size.has_value() || size < *ceil_size)) {
+        ceil_size = size;
+        ceil_cost = *cost;
+      }
+      if (!max_size.has_value() || size > *max_size) {
+        max_size = size;
+        max_cost = *cost;
+      }
+    }
+    if (ceil_size.has_value()) return ceil_cost;
+    if (max_size.has_value()) return max_cost * batch_size / *max_size;
+    return std::nullopt;
+  }
+
  private:
   mutable mutex mu_;
 
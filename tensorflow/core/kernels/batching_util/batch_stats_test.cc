@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/batching_util/batch_stats.h"
 
+#include <optional>
 #include <tuple>
 
 #include <gmock/gmock.h>
@@ -126,6 +127,24 @@ TEST(BatchStatsTest, BatchSizesAreCorrect) {
   ASSERT_THAT(stats.BatchSizes(), UnorderedElementsAre(1, 2, 4));
 }
 
+TEST(BatchStatsTest, EstimateTpuCost) {
+  ModelBatchStats stats;
+  ASSERT_EQ(stats.EstimateTpuCost(1), std::nullopt);
+
+  stats.batch_size(2).tpu_cost().Register(absl::Milliseconds(2));
+  stats.batch_size(8).tpu_cost().Register(absl::Milliseconds(5));
+  stats.batch_size(8).tpu_cost().Register(absl::Milliseconds(7));
+  // A batch size without samples is ignored.
+  stats.batch_size(4);
+
+  // Rounded up to the smallest batch size with samples.
+  ASSERT_EQ(stats.EstimateTpuCost(1), absl::Milliseconds(2));
+  ASSERT_EQ(stats.EstimateTpuCost(2), absl::Milliseconds(2));
+  ASSERT_EQ(stats.EstimateTpuCost(3), absl::Milliseconds(6));
+  // Extrapolated linearly from the largest batch size.
+  ASSERT_EQ(stats.EstimateTpuCost(16), absl::Milliseconds(12));
+}
+
 }  // namespace
 
 }  // namespace tensorflow::serving
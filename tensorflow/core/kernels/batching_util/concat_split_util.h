@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_CONCAT_SPLIT_UTIL_H_
 #define TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_CONCAT_SPLIT_UTIL_H_
 
+#include "tensorflow/core/framework/device_base.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/ops_util.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -30,21 +31,13 @@ namespace concat_split_util {
 typedef Eigen::ThreadPoolDevice CPUDevice;
 typedef Eigen::GpuDevice GPUDevice;
 
-// Concatenates 'inputs' into a single tensor along the zeroth dimension.
-// Requires that all elements of 'inputs' have element type T. Writes to
-// 'output' using 'context' for the allocation to ensure proper device
-// placement.
-template <typename T>
-Status Concat(OpKernelContext* context, const absl::Span<const Tensor> inputs,
-              Tensor* output) {
+// Computes the shape of the concatenation of 'inputs' along the zeroth
+// dimension, checking that all other dimensions of 'inputs' match.
+inline Status GetConcatOutputShape(const absl::Span<const Tensor> inputs,
+                                   TensorShape* output_shape) {
   const int input_dims = inputs[0].dims();
   const TensorShape& input_shape = inputs[0].shape();
 
-  // Note that we reduce the concat of k-dimensional tensors into a two
-  // dimensional concat. Assuming the dimensions of any input tensor are
-  // {y0, y1,...,ym-1}, we flatten it to {1, y}, where y = Prod_i(yi).
-  std::vector<std::unique_ptr<typename TTypes<T, 2>::ConstMatrix>> inputs_flat;
-  inputs_flat.reserve(inputs.size());
   int64_t output_dim0 = 0;
   for (size_t i = 0; i < inputs.size(); ++i) {
     const Tensor& input = inputs[i];
@@ -62,30 +55,70 @@ Status Concat(OpKernelContext* context, const absl::Span<const Tensor> inputs,
             "] = ", input.shape().DebugString());
       }
     }
+    output_dim0 += input.dim_size(0);
+  }
+
+  *output_shape = input_shape;
+  output_shape->set_dim(0, output_dim0);
+  return absl::OkStatus();
+}
+
+// Copies 'inputs' into the host tensor 'output', whose shape must be the one
+// computed by 'GetConcatOutputShape'. On CPU the copies are sharded across the
+// intra-op threads of 'device'.
+template <typename T>
+void ConcatCopy(DeviceBase* device, const absl::Span<const Tensor> inputs,
+                Tensor* output) {
+  if (output->NumElements() == 0) {
+    return;
+  }
+
+  // Note that we reduce the concat of k-dimensional tensors into a two
+  // dimensional concat. Assuming the dimensions of any input tensor are
+  // {y0, y1,...,ym-1}, we flatten it to {1, y}, where y = Prod_i(yi).
+  std::vector<std::unique_ptr<typename TTypes<T, 2>::ConstMatrix>> inputs_flat;
+  inputs_flat.reserve(inputs.size());
+  for (const Tensor& input : inputs) {
     if (input.NumElements() > 0) {
       inputs_flat.emplace_back(new typename TTypes<T, 2>::ConstMatrix(
           input.shaped<T, 2>({1, input.NumElements()})));
     }
-    output_dim0 += input.dim_size(0);
   }
+  auto output_flat = output->shaped<T, 2>({1, output->NumElements()});
+  ConcatCPU<T>(device, inputs_flat, &output_flat);
+}
 
-  TensorShape output_shape(input_shape);
-  output_shape.set_dim(0, output_dim0);
+// Concatenates 'inputs' into a single tensor along the zeroth dimension.
+// Requires that all elements of 'inputs' have element type T. Writes to
+// 'output' using 'context' for the allocation to ensure proper device
+// placement.
+template <typename T>
+Status Concat(OpKernelContext* context, const absl::Span<const Tensor> inputs,
+              Tensor* output) {
+  TensorShape output_shape;
+  TF_RETURN_IF_ERROR(GetConcatOutputShape(inputs, &output_shape));
   AllocatorAttributes attr;
   attr.set_on_host(true);
   TF_RETURN_IF_ERROR(context->allocate_temp(DataTypeToEnum<T>::value,
                                             output_shape, output, attr));
-  if (output->NumElements() > 0) {
-    auto output_flat = output->shaped<T, 2>({1, output->NumElements()});
 #if (defined(GOOGLE_CUDA) && GOOGLE_CUDA) || \
     (defined(TENSORFLOW_USE_ROCM) && TENSORFLOW_USE_ROCM)
-    if (std::is_same<Device, GPUDevice>::value) {
-      ConcatGPU<T>(context, inputs_flat, output, &output_flat);
-      return OkStatus();
+  if (std::is_same<Device, GPUDevice>::value && output->NumElements() > 0) {
+    std::vector<std::unique_ptr<typename TTypes<T, 2>::ConstMatrix>>
+        inputs_flat;
+    inputs_flat.reserve(inputs.size());
+    for (const Tensor& input : inputs) {
+      if (input.NumElements() > 0) {
+        inputs_flat.emplace_back(new typename TTypes<T, 2>::ConstMatrix(
+            input.shaped<T, 2>({1, input.NumElements()})));
+      }
     }
-#endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
-    ConcatCPU<T>(context->device(), inputs_flat, &output_flat);
+    auto output_flat = output->shaped<T, 2>({1, output->NumElements()});
+    ConcatGPU<T>(context, inputs_flat, output, &output_flat);
+    return OkStatus();
   }
+#endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+  ConcatCopy<T>(context->device(), inputs, output);
 
   return absl::OkStatus();
 }
@@ -109,6 +142,37 @@ inline Status Concat(OpKernelContext* context,
   return concat_status;
 }
 
+// Concatenates 'inputs' along the zeroth dimension into 'output', a host
+// tensor that the caller already allocated, e.g. to reuse the buffer of an
+// earlier batch. The shape of 'output' must match the concatenated shape.
+inline Status ConcatInto(DeviceBase* device,
+                         const absl::Span<const Tensor> inputs,
+                         Tensor* output) {
+  TensorShape output_shape;
+  TF_RETURN_IF_ERROR(GetConcatOutputShape(inputs, &output_shape));
+  if (output->dtype() != inputs[0].dtype() ||
+      output->shape() != output_shape) {
+    return errors::InvalidArgument(
+        "Concatenation output should have type ",
+        DataTypeString(inputs[0].dtype()), " and shape ",
+        output_shape.DebugString(), "; got type ",
+        DataTypeString(output->dtype()), " and shape ",
+        output->shape().DebugString());
+  }
+  switch (output->dtype()) {
+#define CASE(type)                            \
+  case DataTypeToEnum<type>::value:           \
+    ConcatCopy<type>(device, inputs, output); \
+    break;
+    TF_CALL_ALL_TYPES(CASE);
+#undef CASE
+    default:
+      return errors::InvalidArgument("Unsupported data type: ",
+                                     output->dtype());
+  }
+  return absl::OkStatus();
+}
+
 // The Split*() functions split 'input' with element type T into 'sizes.size()'
 // tensors along the zeroth dimension, with the ith split having zeroth-
 // dimension size 'sizes[i]'. They allocate the output tensors using 'context',
@@ -152,6 +216,30 @@ Status SplitEasyCases(OpKernelContext* context, const Tensor& input,
   return absl::OkStatus();
 }
 
+// Same as 'SplitEasyCases' above, but handles Tensor dtype automatically. The
+// easy cases only produce slices sharing the buffer of 'input', so this never
+// copies or allocates.
+inline Status SplitEasyCases(const Tensor& input,
+                             const absl::Span<const int64_t> sizes,
+                             std::vector<Tensor>* outputs, bool* done) {
+  const DataType type = input.dtype();
+  Status split_status;
+  switch (type) {
+#define CASE(type)                                                  \
+  case DataTypeToEnum<type>::value:                                 \
+    split_status = SplitEasyCases<type>(/*context=*/nullptr, input, \
+                                        sizes, outputs, done);      \
+    break;
+    TF_CALL_ALL_TYPES(CASE);
+#undef CASE
+    default:
+      // Other types are left to the general case.
+      *done = false;
+      break;
+  }
+  return split_status;
+}
+
 // Handles the general case, on CPU.
 template <typename T>
 Status SplitCPU(OpKernelContext* context, const Tensor& input,
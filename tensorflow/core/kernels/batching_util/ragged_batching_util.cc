@@ -0,0 +1,130 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/batching_util/ragged_batching_util.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/strings/str_join.h"
+#include "absl/types/span.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+
+namespace tensorflow {
+namespace serving {
+
+Status ValidateTokenBudgetOptions(const TokenBudgetOptions& options) {
+  if (!options.enabled()) {
+    return absl::OkStatus();
+  }
+  if (options.ragged_dimension < 1) {
+    return errors::InvalidArgument(
+        "ragged_dimension must be at least 1; was ", options.ragged_dimension);
+  }
+  if (options.length_bucket_boundaries.empty()) {
+    return errors::InvalidArgument(
+        "length_bucket_boundaries must be specified when max_batch_tokens is "
+        "set");
+  }
+  for (int i = 0; i < options.length_bucket_boundaries.size(); ++i) {
+    const int64_t boundary = options.length_bucket_boundaries[i];
+    if (boundary <= 0 ||
+        (i > 0 && boundary <= options.length_bucket_boundaries[i - 1])) {
+      return errors::InvalidArgument(
+          "length_bucket_boundaries must be positive and strictly "
+          "increasing; got ",
+          absl::StrJoin(options.length_bucket_boundaries, ","));
+    }
+  }
+  return absl::OkStatus();
+}
+
+StatusOr<int64_t> GetRowLength(const Tensor& tensor, int ragged_dimension) {
+  if (tensor.dims() <= ragged_dimension) {
+    return errors::InvalidArgument(
+        "Token budget batching requires inputs with more than ",
+        ragged_dimension, " dimensions; got shape ",
+        tensor.shape().DebugString());
+  }
+  int64_t row_length = 1;
+  for (int i = 1; i <= ragged_dimension; ++i) {
+    row_length *= tensor.dim_size(i);
+  }
+  return row_length;
+}
+
+StatusOr<int> GetLengthBucket(int64_t row_length,
+                              const TokenBudgetOptions& options) {
+  const std::vector<int64_t>& boundaries = options.length_bucket_boundaries;
+  auto it = absl::c_lower_bound(boundaries, row_length);
+  if (it == boundaries.end()) {
+    return errors::InvalidArgument(
+        "Row length ", row_length,
+        " exceeds the largest length bucket boundary ",
+        boundaries.empty() ? 0 : boundaries.back());
+  }
+  return static_cast<int>(it - boundaries.begin());
+}
+
+int64_t GetMaxBatchRows(const TokenBudgetOptions& options, int bucket) {
+  return std::max<int64_t>(
+      1, options.max_batch_tokens / options.length_bucket_boundaries[bucket]);
+}
+
+StatusOr<Tensor> FlattenRaggedRows(const Tensor& tensor,
+                                   int ragged_dimension) {
+  TF_ASSIGN_OR_RETURN(int64_t row_length,
+                      GetRowLength(tensor, ragged_dimension));
+  TensorShape flat_shape({tensor.dim_size(0) * row_length});
+  for (int i = ragged_dimension + 1; i < tensor.dims(); ++i) {
+    flat_shape.AddDim(tensor.dim_size(i));
+  }
+  Tensor flat_tensor;
+  if (!flat_tensor.CopyFrom(tensor, flat_shape)) {
+    return errors::Internal("Failed to flatten tensor of shape ",
+                            tensor.shape().DebugString(), " into ",
+                            flat_shape.DebugString());
+  }
+  return flat_tensor;
+}
+
+StatusOr<Tensor> MakeRowSplits(absl::Span<const Tensor> tensors,
+                               int ragged_dimension) {
+  int64_t num_rows = 0;
+  for (const Tensor& tensor : tensors) {
+    num_rows += tensor.dim_size(0);
+  }
+  Tensor row_splits(DT_INT64, TensorShape({num_rows + 1}));
+  auto row_splits_flat = row_splits.vec<int64_t>();
+  int64_t row = 0;
+  row_splits_flat(0) = 0;
+  for (const Tensor& tensor : tensors) {
+    TF_ASSIGN_OR_RETURN(int64_t row_length,
+                        GetRowLength(tensor, ragged_dimension));
+    for (int64_t i = 0; i < tensor.dim_size(0); ++i, ++row) {
+      row_splits_flat(row + 1) = row_splits_flat(row) + row_length;
+    }
+  }
+  return row_splits;
+}
+
+}  // namespace serving
+}  // namespace tensorflow
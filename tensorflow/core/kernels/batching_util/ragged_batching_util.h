@@ -0,0 +1,83 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_RAGGED_BATCHING_UTIL_H_
+#define TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_RAGGED_BATCHING_UTIL_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+
+namespace tensorflow {
+namespace serving {
+
+// Options of the token budget batching mode, in which a batch is bounded by the
+// total number of tokens (elements along `ragged_dimension`) rather than by the
+// number of requests.
+//
+// Requests are routed to one queue per length bucket, so that a batch only
+// holds rows of similar length, and the inputs of a batch are packed without
+// padding: every input with more than `ragged_dimension` dimensions has its
+// dimensions [0, ragged_dimension] merged into one, and an int64 row-splits
+// tensor describing the packed rows is passed after the batched inputs.
+struct TokenBudgetOptions {
+  // The maximum number of tokens in a batch. Token budget batching is disabled
+  // if this is zero.
+  int64_t max_batch_tokens = 0;
+
+  // The dimension along which the inputs are ragged. Dimension 0 is the batch
+  // dimension, so this must be at least 1. If it is greater than 1, the length
+  // of a row is the product of the sizes of dimensions [1, ragged_dimension].
+  int ragged_dimension = 1;
+
+  // Inclusive upper bounds on the row length of each bucket, in increasing
+  // order. Requests whose rows are longer than the last boundary are rejected.
+  std::vector<int64_t> length_bucket_boundaries;
+
+  bool enabled() const { return max_batch_tokens > 0; }
+};
+
+// Returns an error if token budget batching is enabled by `options` and the
+// other options are inconsistent with it.
+Status ValidateTokenBudgetOptions(const TokenBudgetOptions& options);
+
+// Returns the number of tokens in each row of `tensor`.
+StatusOr<int64_t> GetRowLength(const Tensor& tensor, int ragged_dimension);
+
+// Returns the index of the smallest bucket that holds rows of `row_length`.
+StatusOr<int> GetLengthBucket(int64_t row_length,
+                              const TokenBudgetOptions& options);
+
+// Returns the number of rows of bucket `bucket` that fit in the token budget.
+// Always at least one, so that a single maximal row can be processed.
+int64_t GetMaxBatchRows(const TokenBudgetOptions& options, int bucket);
+
+// Returns `tensor` with dimensions [0, ragged_dimension] merged into the 0th
+// dimension. The returned tensor shares the buffer of `tensor`.
+StatusOr<Tensor> FlattenRaggedRows(const Tensor& tensor, int ragged_dimension);
+
+// Returns the row splits of the rows of `tensors` once they are flattened with
+// `FlattenRaggedRows` and concatenated, i.e. a vector of length
+// `total_rows + 1` whose entry i is the offset of the i-th row.
+StatusOr<Tensor> MakeRowSplits(absl::Span<const Tensor> tensors,
+                               int ragged_dimension);
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_RAGGED_BATCHING_UTIL_H_
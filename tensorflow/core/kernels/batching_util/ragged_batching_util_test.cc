@@ -0,0 +1,231 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/batching_util/ragged_batching_util.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/status_matchers.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+using ::testing::HasSubstr;
+using ::tsl::testing::StatusIs;
+
+TokenBudgetOptions MakeOptions(int64_t max_batch_tokens,
+                               std::vector<int64_t> boundaries) {
+  TokenBudgetOptions options;
+  options.max_batch_tokens = max_batch_tokens;
+  options.length_bucket_boundaries = std::move(boundaries);
+  return options;
+}
+
+TEST(ValidateTokenBudgetOptionsTest, DisabledOptionsAreValid) {
+  TF_EXPECT_OK(ValidateTokenBudgetOptions(TokenBudgetOptions()));
+}
+
+TEST(ValidateTokenBudgetOptionsTest, ValidOptions) {
+  TF_EXPECT_OK(ValidateTokenBudgetOptions(MakeOptions(1024, {16, 64, 256})));
+}
+
+TEST(ValidateTokenBudgetOptionsTest, InvalidOptions) {
+  EXPECT_THAT(ValidateTokenBudgetOptions(MakeOptions(1024, {})),
+              StatusIs(error::INVALID_ARGUMENT,
+                       HasSubstr("length_bucket_boundaries")));
+  EXPECT_THAT(ValidateTokenBudgetOptions(MakeOptions(1024, {16, 16})),
+              StatusIs(error::INVALID_ARGUMENT, HasSubstr("increasing")));
+  EXPECT_THAT(ValidateTokenBudgetOptions(MakeOptions(1024, {0, 16})),
+              StatusIs(error::INVALID_ARGUMENT, HasSubstr("positive")));
+
+  TokenBudgetOptions options = MakeOptions(1024, {16});
+  options.ragged_dimension = 0;
+  EXPECT_THAT(ValidateTokenBudgetOptions(options),
+              StatusIs(error::INVALID_ARGUMENT, HasSubstr("ragged_dimension")));
+}
+
+TEST(GetRowLengthTest, RaggedDimension) {
+  Tensor tensor(DT_FLOAT, TensorShape({2, 3, 4, 5}));
+  EXPECT_THAT(GetRowLength(tensor, 1), tsl::testing::IsOkAndHolds(3));
+  EXPECT_THAT(GetRowLength(tensor, 2), tsl::testing::IsOkAndHolds(12));
+  EXPECT_THAT(GetRowLength(tensor, 4),
+              StatusIs(error::INVALID_ARGUMENT, HasSubstr("dimensions")));
+}
+
+TEST(GetLengthBucketTest, BoundariesAreInclusive) {
+  const TokenBudgetOptions options = MakeOptions(1024, {16, 64, 256});
+  EXPECT_THAT(GetLengthBucket(1, options), tsl::testing::IsOkAndHolds(0));
+  EXPECT_THAT(GetLengthBucket(16, options), tsl::testing::IsOkAndHolds(0));
+  EXPECT_THAT(GetLengthBucket(17, options), tsl::testing::IsOkAndHolds(1));
+  EXPECT_THAT(GetLengthBucket(256, options), tsl::testing::IsOkAndHolds(2));
+  EXPECT_THAT(GetLengthBucket(257, options),
+              StatusIs(error::INVALID_ARGUMENT, HasSubstr("exceeds")));
+}
+
+TEST(GetMaxBatchRowsTest, RowsFitInTokenBudget) {
+  const TokenBudgetOptions options = MakeOptions(1000, {16, 64, 2048});
+  EXPECT_EQ(GetMaxBatchRows(options, 0), 62);
+  EXPECT_EQ(GetMaxBatchRows(options, 1), 15);
+  EXPECT_EQ(GetMaxBatchRows(options, 2), 1);
+}
+
+TEST(FlattenRaggedRowsTest, MergesLeadingDimensions) {
+  Tensor tensor = test::AsTensor<int32>({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12},
+                                        TensorShape({2, 3, 2}));
+  TF_ASSERT_OK_AND_ASSIGN(Tensor flat, FlattenRaggedRows(tensor, 1));
+  test::ExpectTensorEqual<int32>(
+      flat, test::AsTensor<int32>({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12},
+                                  TensorShape({6, 2})));
+  EXPECT_TRUE(flat.SharesBufferWith(tensor));
+
+  TF_ASSERT_OK_AND_ASSIGN(flat, FlattenRaggedRows(tensor, 2));
+  EXPECT_EQ(flat.shape(), TensorShape({12}));
+}
+
+TEST(MakeRowSplitsTest, RowsOfSeveralTensors) {
+  std::vector<Tensor> tensors = {Tensor(DT_FLOAT, TensorShape({2, 3, 8})),
+                                 Tensor(DT_FLOAT, TensorShape({1, 5, 8})),
+                                 Tensor(DT_FLOAT, TensorShape({3, 1, 8}))};
+  TF_ASSERT_OK_AND_ASSIGN(Tensor row_splits, MakeRowSplits(tensors, 1));
+  test::ExpectTensorEqual<int64_t>(
+      row_splits, test::AsTensor<int64_t>({0, 3, 6, 11, 12, 13, 14}));
+}
+
+// Number of floats in each token of the benchmark requests.
+constexpr int kTokenSize = 16;
+
+// Returns the row lengths of `num_requests` single-row requests. Lengths follow
+// an exponential distribution, so most requests are short and a few are close
+// to `max_length`.
+std::vector<int64_t> SkewedRowLengths(int num_requests, int64_t max_length) {
+  std::mt19937 rng(/*seed=*/42);
+  std::exponential_distribution<double> distribution(8.0 / max_length);
+  std::vector<int64_t> lengths(num_requests);
+  for (int64_t& length : lengths) {
+    length = std::clamp<int64_t>(1 + distribution(rng), 1, max_length);
+  }
+  return lengths;
+}
+
+// Compares padding every request of a fixed-size batch to the longest row in
+// the batch (mode 0) with token budget batching (mode 1), which packs requests
+// of the same length bucket until the token budget is reached.
+void BM_RaggedBatching(::testing::benchmark::State& state) {
+  constexpr int kNumRequests = 1024;
+  constexpr int kRequestsPerBatch = 32;
+  const int64_t max_length = state.range(0);
+  const bool token_budget = state.range(1);
+
+  TokenBudgetOptions options;
+  options.max_batch_tokens = kRequestsPerBatch * max_length / 4;
+  for (int64_t boundary = 8; boundary < max_length; boundary *= 2) {
+    options.length_bucket_boundaries.push_back(boundary);
+  }
+  options.length_bucket_boundaries.push_back(max_length);
+
+  std::vector<Tensor> requests;
+  int64_t real_tokens = 0;
+  for (int64_t length : SkewedRowLengths(kNumRequests, max_length)) {
+    Tensor request(DT_FLOAT, TensorShape({1, length, kTokenSize}));
+    request.flat<float>().setConstant(1.0f);
+    requests.push_back(request);
+    real_tokens += length;
+  }
+
+  int64_t processed_tokens = 0;
+  int64_t num_batches = 0;
+  for (auto s : state) {
+    processed_tokens = 0;
+    num_batches = 0;
+    if (!token_budget) {
+      for (int start = 0; start < kNumRequests; start += kRequestsPerBatch) {
+        const int end = std::min(start + kRequestsPerBatch, kNumRequests);
+        int64_t batch_length = 0;
+        for (int i = start; i < end; ++i) {
+          batch_length = std::max(batch_length, requests[i].dim_size(1));
+        }
+        Tensor batch(DT_FLOAT,
+                     TensorShape({end - start, batch_length, kTokenSize}));
+        auto batch_flat = batch.flat_inner_dims<float, 3>();
+        batch_flat.setZero();
+        for (int i = start; i < end; ++i) {
+          auto request_flat = requests[i].flat_inner_dims<float, 3>();
+          batch_flat.chip<0>(i - start).slice(
+              Eigen::array<Eigen::Index, 2>{0, 0},
+              Eigen::array<Eigen::Index, 2>{requests[i].dim_size(1),
+                                            kTokenSize}) =
+              request_flat.chip<0>(0);
+        }
+        processed_tokens += batch.dim_size(0) * batch_length;
+        ++num_batches;
+      }
+    } else {
+      std::vector<std::vector<Tensor>> buckets(
+          options.length_bucket_boundaries.size());
+      auto flush = [&](std::vector<Tensor>& bucket) {
+        std::vector<Tensor> flat_rows;
+        flat_rows.reserve(bucket.size());
+        for (const Tensor& tensor : bucket) {
+          flat_rows.push_back(FlattenRaggedRows(tensor, 1).value());
+        }
+        Tensor batch;
+        TF_CHECK_OK(tensor::Concat(flat_rows, &batch));
+        Tensor row_splits = MakeRowSplits(bucket, 1).value();
+        tensorflow::testing::DoNotOptimize(row_splits);
+        processed_tokens += batch.dim_size(0);
+        ++num_batches;
+        bucket.clear();
+      };
+      for (const Tensor& request : requests) {
+        const int bucket =
+            GetLengthBucket(request.dim_size(1), options).value();
+        buckets[bucket].push_back(request);
+        if (buckets[bucket].size() >= GetMaxBatchRows(options, bucket)) {
+          flush(buckets[bucket]);
+        }
+      }
+      for (std::vector<Tensor>& bucket : buckets) {
+        if (!bucket.empty()) flush(bucket);
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * real_tokens);
+  state.counters["padding_waste"] =
+      1.0 - static_cast<double>(real_tokens) / processed_tokens;
+  state.counters["num_batches"] = num_batches;
+}
+
+BENCHMARK(BM_RaggedBatching)
+    ->ArgPair(128, 0)
+    ->ArgPair(128, 1)
+    ->ArgPair(1024, 0)
+    ->ArgPair(1024, 1);
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
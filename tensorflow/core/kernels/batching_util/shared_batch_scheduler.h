@@ -25,6 +25,8 @@ limitations under the License.
 #include <functional>
 #include <list>
 #include <memory>
+#include <optional>
+#include <type_traits>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -33,9 +35,11 @@ limitations under the License.
 #include "absl/status/status.h"
 #include "absl/strings/str_format.h"
 #include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "tensorflow/core/kernels/batching_util/batch_input_task.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler_utils.h"
+#include "tensorflow/core/kernels/batching_util/batch_stats.h"
 #include "tensorflow/core/kernels/batching_util/periodic_function.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
@@ -269,6 +273,25 @@ class SharedBatchScheduler
     // effective only when enable_priority_queue is true.
     MixedPriorityBatchingPolicy mixed_priority_batching_policy =
         MixedPriorityBatchingPolicy::kLowPriorityPaddingWithMaxBatchSize;
+
+    // If true, the queue takes the deadlines of its tasks (see
+    // `BatchTask::deadline()`) into account, to maximize the number of tasks
+    // processed before their deadline:
+    //  - The open batch is closed as soon as waiting any longer for it to fill
+    //    up would make the earliest deadline among its tasks unattainable.
+    //  - Batch threads take the ready batch with the least slack (the time
+    //    between its estimated completion and its earliest deadline) among all
+    //    such queues, before falling back to round-robin. Batches that can no
+    //    longer meet their deadline are left to the round-robin.
+    //
+    // Must be false if `enable_lazy_split` is true.
+    bool enable_deadline_aware_scheduling = false;
+
+    // The batch costs of the model served by this queue, used to estimate the
+    // processing time of a batch when `enable_deadline_aware_scheduling` is
+    // true. If null, or if no cost is known yet, processing is assumed to be
+    // instantaneous. Not owned; must outlive the queue.
+    ModelBatchStats* batch_stats = nullptr;
   };
   Status AddQueue(const QueueOptions& options,
                   ProcessBatchCallback process_batch_callback,
@@ -312,6 +335,9 @@ class SharedBatchScheduler
   // available batch thread should grab work.
   typename QueueList::iterator next_queue_to_schedule_ TF_GUARDED_BY(mu_);
 
+  // Whether any queue was added with `enable_deadline_aware_scheduling`.
+  bool has_deadline_aware_queues_ TF_GUARDED_BY(mu_) = false;
+
   // Used by idle batch threads to wait for work to enter the system. Notified
   // whenever a batch becomes schedulable.
   condition_variable schedulable_batch_cv_;
@@ -410,6 +436,16 @@ class Queue {
   // Batches are guaranteed to form at task enqueue time.
   std::unique_ptr<Batch<TaskType>> ScheduleBatchWithEagerSplit();
 
+  // Returns the slack of the batch that ScheduleBatch() would return now, i.e.
+  // the time between its estimated completion and the earliest deadline of its
+  // tasks. Returns std::nullopt if deadline-aware scheduling is disabled, if no
+  // batch is ready, or if none of the tasks of the batch has a deadline.
+  std::optional<absl::Duration> NextBatchSlack() const;
+
+  bool deadline_aware() const {
+    return options_.enable_deadline_aware_scheduling;
+  }
+
   // Retrieves the low priority tasks that can be padded to a high priority
   // batch of the specified size.
   std::vector<std::unique_ptr<TaskType>> GetLowPriorityTasksForPadding(
@@ -471,6 +507,16 @@ class Queue {
   // 'high_priority_batches_' is currently schedulable.
   bool IsOpenBatchSchedulable() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  // Returns the slack of `batch` if it were processed now. See
+  // NextBatchSlack().
+  std::optional<absl::Duration> BatchSlack(const Batch<TaskType>& batch) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns true if the open batch `open_batch` must be closed now for its
+  // earliest deadline to remain attainable.
+  bool IsOpenBatchDueForDeadline(const Batch<TaskType>& open_batch) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   // A variant of `IsOpenBatchSchedulable`; used when batches are formed at
   // task enqueue time, and open batch is `high_priority_batches_.back()`.
   bool IsOpenBatchSchedulableAfterEagerSplit() const
@@ -716,6 +762,12 @@ Status SharedBatchScheduler<TaskType>::AddQueueAfterRewritingOptions(
         options.enable_large_batch_splitting);
   }
 
+  if (options.enable_deadline_aware_scheduling && options.enable_lazy_split) {
+    return errors::InvalidArgument(
+        "enable_deadline_aware_scheduling requires enable_lazy_split to be "
+        "false");
+  }
+
   if (options.enable_lazy_split && (!options.enable_large_batch_splitting)) {
     return errors::InvalidArgument(
         "enable_lazy_split should be enabled only if "
@@ -749,6 +801,9 @@ Status SharedBatchScheduler<TaskType>::AddQueueAfterRewritingOptions(
     if (next_queue_to_schedule_ == queues_.end()) {
       next_queue_to_schedule_ = queues_.begin();
     }
+    if (options.enable_deadline_aware_scheduling) {
+      has_deadline_aware_queues_ = true;
+    }
   }
   *queue = std::move(handle);
   return absl::OkStatus();
@@ -784,6 +839,31 @@ void SharedBatchScheduler<TaskType>::GetNextWorkItem_Locked(
     BatchUniquePtr* batch_to_process_out) {
   BatchUniquePtr batch_to_process;
   internal::Queue<TaskType>* queue_for_batch = nullptr;
+
+  // Deadline-aware queues take precedence: run the ready batch that is the
+  // closest to missing its deadline, as long as it can still meet it.
+  if (has_deadline_aware_queues_) {
+    internal::Queue<TaskType>* most_urgent_queue = nullptr;
+    absl::Duration least_slack = absl::InfiniteDuration();
+    for (const auto& queue : queues_) {
+      if (!queue->deadline_aware()) continue;
+      const std::optional<absl::Duration> slack = queue->NextBatchSlack();
+      if (slack.has_value() && *slack >= absl::ZeroDuration() &&
+          *slack < least_slack) {
+        most_urgent_queue = queue.get();
+        least_slack = *slack;
+      }
+    }
+    if (most_urgent_queue != nullptr) {
+      batch_to_process = most_urgent_queue->ScheduleBatch();
+      if (BatchExists(batch_to_process)) {
+        *queue_for_batch_out = most_urgent_queue;
+        *batch_to_process_out = std::move(batch_to_process);
+        return;
+      }
+    }
+  }
+
   const int num_queues = queues_.size();
   for (int num_queues_tried = 0;
        !BatchExists(batch_to_process) && num_queues_tried < num_queues;
@@ -1419,7 +1499,67 @@ bool Queue<TaskType>::IsOpenBatchSchedulableAfterEagerSplit() const {
   }
   return closed_ || open_batch->size() >= max_execution_batch_size() ||
          env_->NowMicros() >=
-             open_batch_start_time_micros_ + options_.batch_timeout_micros;
+             open_batch_start_time_micros_ + options_.batch_timeout_micros ||
+         IsOpenBatchDueForDeadline(*open_batch);
+}
+
+template <typename TaskType>
+std::optional<absl::Duration> Queue<TaskType>::NextBatchSlack() const {
+  if (!options_.enable_deadline_aware_scheduling) {
+    return std::nullopt;
+  }
+  mutex_lock l(mu_);
+  const std::deque<std::unique_ptr<Batch<TaskType>>>& batches = GetBatches();
+  if (batches.size() >= 2) {
+    return BatchSlack(*batches.front());
+  }
+  if (IsOpenBatchSchedulable()) {
+    return BatchSlack(*batches.back());
+  }
+  return std::nullopt;
+}
+
+template <typename TaskType>
+std::optional<absl::Duration> Queue<TaskType>::BatchSlack(
+    const Batch<TaskType>& batch) const {
+  // Deadlines are defined only when the task is a derived class of BatchTask.
+  if constexpr (std::is_base_of_v<BatchTask, TaskType>) {
+    std::optional<absl::Time> earliest_deadline;
+    for (int i = 0; i < batch.num_tasks(); ++i) {
+      const std::optional<absl::Time> deadline = batch.task(i).deadline();
+      if (deadline.has_value() &&
+          (!earliest_deadline.has_value() || *deadline < *earliest_deadline)) {
+        earliest_deadline = deadline;
+      }
+    }
+    if (!earliest_deadline.has_value()) {
+      return std::nullopt;
+    }
+    absl::Duration cost = absl::ZeroDuration();
+    if (options_.batch_stats != nullptr) {
+      // Costs are registered per processed batch size, i.e. after padding.
+      const int processed_size = GetNextAllowedBatchSize(
+          batch.size(), options_.allowed_batch_sizes, options_.disable_padding);
+      cost = options_.batch_stats->EstimateTpuCost(processed_size)
+                 .value_or(absl::ZeroDuration());
+    }
+    return *earliest_deadline -
+           (absl::FromUnixMicros(env_->NowMicros()) + cost);
+  }
+  return std::nullopt;
+}
+
+template <typename TaskType>
+bool Queue<TaskType>::IsOpenBatchDueForDeadline(
+    const Batch<TaskType>& open_batch) const {
+  if (!options_.enable_deadline_aware_scheduling) {
+    return false;
+  }
+  // Idle batch threads poll the queues every millisecond, so the batch is
+  // closed one poll interval ahead of the time it must start processing.
+  constexpr absl::Duration kPollInterval = absl::Milliseconds(1);
+  const std::optional<absl::Duration> slack = BatchSlack(open_batch);
+  return slack.has_value() && *slack <= kPollInterval;
 }
 
 template <typename TaskType>
@@ -16,7 +16,10 @@ limitations under the License.
 #include "tensorflow/core/kernels/batching_util/shared_batch_scheduler.h"
 
 #include <cstddef>
+#include <array>
 #include <memory>
+#include <optional>
+#include <random>
 #include <string>
 #include <thread>  // NOLINT(build/c++11)
 #include <tuple>
@@ -28,6 +31,7 @@ limitations under the License.
 #include "absl/status/status.h"
 #include "absl/time/time.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler.h"
+#include "tensorflow/core/kernels/batching_util/batch_stats.h"
 #include "tensorflow/core/kernels/batching_util/fake_clock_env.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
@@ -50,9 +54,11 @@ using ::testing::HasSubstr;
 
 class FakeTask : public BatchTask {
  public:
-  explicit FakeTask(size_t size, tsl::criticality::Criticality criticality =
-                                     tsl::criticality::Criticality::kCritical)
-      : size_(size), criticality_(criticality) {}
+  explicit FakeTask(size_t size,
+                    tsl::criticality::Criticality criticality =
+                        tsl::criticality::Criticality::kCritical,
+                    std::optional<absl::Time> deadline = std::nullopt)
+      : size_(size), criticality_(criticality), deadline_(deadline) {}
 
   ~FakeTask() override = default;
 
@@ -62,9 +68,12 @@ class FakeTask : public BatchTask {
     return criticality_;
   }
 
+  std::optional<absl::Time> deadline() const override { return deadline_; }
+
  private:
   const size_t size_;
   const tsl::criticality::Criticality criticality_;
+  const std::optional<absl::Time> deadline_;
 
   FakeTask(const FakeTask&) = delete;
   void operator=(const FakeTask&) = delete;
@@ -1063,6 +1072,157 @@ INSTANTIATE_TEST_SUITE_P(
                       std::make_tuple(/*enable_input_batch_split=*/false,
                                       /*enable_lazy_split=*/false)));
 
+// Creates a FakeTask of size 'task_size' due at 'deadline', and calls
+// 'scheduler->Schedule()' on that task. Returns the resulting status.
+Status ScheduleTaskWithDeadline(size_t task_size, absl::Time deadline,
+                                BatchScheduler<FakeTask>* scheduler) {
+  std::unique_ptr<FakeTask> task(new FakeTask(
+      task_size, tsl::criticality::Criticality::kCritical, deadline));
+  Status status = scheduler->Schedule(&task);
+  CHECK_EQ(status.ok(), task == nullptr);
+  return status;
+}
+
+QueueOptions CreateDeadlineAwareQueueOptions(size_t max_batch_size,
+                                             size_t batch_timeout_micros,
+                                             ModelBatchStats* batch_stats) {
+  QueueOptions options = CreateQueueOptions(
+      max_batch_size, max_batch_size, batch_timeout_micros,
+      /*max_enqueued_batches=*/100, /*enable_large_batch_splitting=*/false,
+      /*enable_lazy_split=*/false, /*split_func=*/nullptr);
+  options.enable_deadline_aware_scheduling = true;
+  options.batch_stats = batch_stats;
+  return options;
+}
+
+TEST(SharedBatchSchedulerDeadlineTest, ClosesBatchBeforeDeadline) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+  {
+    Notification batch_processed;
+    auto callback = [&](std::unique_ptr<Batch<FakeTask>> batch) {
+      ASSERT_TRUE(batch->IsClosed());
+      EXPECT_EQ(batch->size(), 1);
+      batch_processed.Notify();
+    };
+
+    ModelBatchStats batch_stats;
+    batch_stats.batch_size(4).tpu_cost().Register(absl::Milliseconds(2));
+    auto scheduler = CreateSharedBatchScheduler(1, &env);
+    auto queue = CreateQueue(
+        scheduler,
+        CreateDeadlineAwareQueueOptions(
+            /*max_batch_size=*/4, /*batch_timeout_micros=*/1000 * 1000,
+            &batch_stats),
+        callback);
+
+    // The batch takes 2ms to process, and batch threads may take up to 1ms to
+    // pick it up, so it must be closed 3ms before the deadline, well before
+    // the 1s timeout.
+    TF_ASSERT_OK(ScheduleTaskWithDeadline(
+        1, absl::FromUnixMicros(env.NowMicros()) + absl::Milliseconds(10),
+        queue.get()));
+    env.AdvanceByMicroseconds(6 * 1000);
+    Env::Default()->SleepForMicroseconds(10 * 1000 /* 10 milliseconds */);
+    EXPECT_FALSE(batch_processed.HasBeenNotified());
+    env.AdvanceByMicroseconds(1000);
+    batch_processed.WaitForNotification();
+
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+TEST(SharedBatchSchedulerDeadlineTest, PrefersBatchWithLeastSlack) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+  {
+    mutex mu;
+    std::vector<std::string> processed_queues;
+    Notification blocking_batch_started, unblock, all_batches_processed;
+    auto callback_for = [&](std::string name) {
+      return [&, name](std::unique_ptr<Batch<FakeTask>> batch) {
+        if (name == "blocking") {
+          blocking_batch_started.Notify();
+          unblock.WaitForNotification();
+          return;
+        }
+        mutex_lock l(mu);
+        processed_queues.push_back(name);
+        if (processed_queues.size() == 2) {
+          all_batches_processed.Notify();
+        }
+      };
+    };
+
+    auto scheduler = CreateSharedBatchScheduler(1, &env);
+    // Occupies the only batch thread while the other batches become ready.
+    auto blocking_queue = CreateQueue(
+        scheduler,
+        CreateQueueOptions(/*max_execution_batch_size=*/1,
+                           /*input_batch_size_limit=*/1,
+                           /*batch_timeout_micros=*/0,
+                           /*max_enqueued_batches=*/1,
+                           /*enable_large_batch_splitting=*/false,
+                           /*enable_lazy_split=*/false,
+                           /*split_func=*/nullptr),
+        callback_for("blocking"));
+    // Round-robin would schedule `loose_queue` first, since it was added
+    // first.
+    auto loose_queue = CreateQueue(
+        scheduler,
+        CreateDeadlineAwareQueueOptions(/*max_batch_size=*/1,
+                                        /*batch_timeout_micros=*/0,
+                                        /*batch_stats=*/nullptr),
+        callback_for("loose"));
+    auto tight_queue = CreateQueue(
+        scheduler,
+        CreateDeadlineAwareQueueOptions(/*max_batch_size=*/1,
+                                        /*batch_timeout_micros=*/0,
+                                        /*batch_stats=*/nullptr),
+        callback_for("tight"));
+
+    TF_ASSERT_OK(ScheduleTask(1, blocking_queue.get()));
+    blocking_batch_started.WaitForNotification();
+    const absl::Time now = absl::FromUnixMicros(env.NowMicros());
+    TF_ASSERT_OK(ScheduleTaskWithDeadline(1, now + absl::Seconds(100),
+                                          loose_queue.get()));
+    TF_ASSERT_OK(ScheduleTaskWithDeadline(1, now + absl::Seconds(10),
+                                          tight_queue.get()));
+    unblock.Notify();
+    all_batches_processed.WaitForNotification();
+    EXPECT_THAT(processed_queues, ::testing::ElementsAre("tight", "loose"));
+
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+TEST(SharedBatchSchedulerDeadlineTest, InvalidWithLazySplit) {
+  auto callback = [](std::unique_ptr<Batch<FakeTask>> batch) {
+    // do nothing.
+  };
+  auto scheduler = CreateSharedBatchScheduler(2);
+  QueueOptions options = CreateQueueOptions(
+      /*max_execution_batch_size=*/10, /*input_batch_size_limit=*/10,
+      /*batch_timeout_micros=*/0, /*max_enqueued_batches=*/2,
+      /*enable_large_batch_splitting=*/true, /*enable_lazy_split=*/true,
+      [](std::unique_ptr<FakeTask>* input_task, int first_output_task_size,
+         int input_batch_size_limit,
+         std::vector<std::unique_ptr<FakeTask>>* output_tasks) {
+        return absl::OkStatus();
+      });
+  options.enable_deadline_aware_scheduling = true;
+  std::unique_ptr<Queue> queue;
+  EXPECT_THAT(scheduler->AddQueue(options, callback, &queue),
+              testing::StatusIs(error::INVALID_ARGUMENT,
+                                HasSubstr("enable_deadline_aware_scheduling")));
+}
+
 class SharedBatchSchedulerPriorityTest
     : public ::testing::TestWithParam<
           std::tuple<bool, bool, MixedPriorityBatchingPolicy>>,
@@ -1615,6 +1775,100 @@ INSTANTIATE_TEST_SUITE_P(
                       std::make_tuple(/*enable_input_batch_split=*/false,
                                       /*enable_lazy_split=*/false)));
 
+// Simulates, on a fake clock, two models sharing one batch thread: a cheap one
+// with a tight SLO and an expensive one with a loose SLO. Batches take as long
+// to process as their registered costs say. Reports the fraction of tasks
+// processed before their deadline (SLO attainment) with round-robin scheduling
+// (argument 0) and deadline-aware scheduling (argument 1).
+void BM_DeadlineAwareScheduling(::testing::benchmark::State& state) {
+  const bool deadline_aware = state.range(0);
+  struct SimulatedModel {
+    absl::Duration fixed_cost;
+    absl::Duration cost_per_task;
+    absl::Duration slo;
+    // The probability that a task arrives during each tick.
+    double arrival_probability;
+  };
+  const std::array<SimulatedModel, 2> models = {
+      SimulatedModel{absl::Microseconds(500), absl::Microseconds(50),
+                     absl::Milliseconds(5), 0.3},
+      SimulatedModel{absl::Milliseconds(4), absl::Microseconds(200),
+                     absl::Milliseconds(40), 0.1}};
+  constexpr int kTickMicros = 200;
+  constexpr int kNumTicks = 500;
+  constexpr size_t kMaxBatchSize = 16;
+  constexpr size_t kBatchTimeoutMicros = 2000;
+
+  int64_t num_tasks = 0;
+  int64_t num_tasks_on_time = 0;
+  for (auto s : state) {
+    test_util::FakeClockEnv env(Env::Default());
+    std::array<ModelBatchStats, 2> batch_stats;
+    mutex mu;
+    int64_t processed = 0;
+    int64_t on_time = 0;
+
+    auto scheduler = CreateSharedBatchScheduler(1, &env);
+    std::vector<std::unique_ptr<Queue>> queues;
+    for (size_t m = 0; m < models.size(); ++m) {
+      const SimulatedModel& model = models[m];
+      for (size_t size = 1; size <= kMaxBatchSize; ++size) {
+        batch_stats[m].batch_size(size).tpu_cost().Register(
+            model.fixed_cost + model.cost_per_task * size);
+      }
+      QueueOptions options = CreateQueueOptions(
+          kMaxBatchSize, kMaxBatchSize, kBatchTimeoutMicros,
+          /*max_enqueued_batches=*/1000,
+          /*enable_large_batch_splitting=*/false,
+          /*enable_lazy_split=*/false, /*split_func=*/nullptr);
+      options.enable_deadline_aware_scheduling = deadline_aware;
+      options.batch_stats = &batch_stats[m];
+      auto callback = [&env, &mu, &processed, &on_time,
+                       model](std::unique_ptr<Batch<FakeTask>> batch) {
+        env.SleepForMicroseconds(absl::ToInt64Microseconds(
+            model.fixed_cost + model.cost_per_task * batch->size()));
+        const absl::Time now = absl::FromUnixMicros(env.NowMicros());
+        mutex_lock l(mu);
+        for (int i = 0; i < batch->num_tasks(); ++i) {
+          ++processed;
+          if (*batch->task(i).deadline() >= now) ++on_time;
+        }
+      };
+      queues.push_back(CreateQueue(scheduler, options, callback));
+    }
+
+    // Tasks arrive during `kNumTicks` ticks, after which the queues drain. The
+    // fake clock advances in lockstep with the real one, so that batch threads
+    // observe roughly the same timing as in production.
+    std::mt19937 rng(/*seed=*/42);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    int64_t scheduled = 0;
+    for (int tick = 0;; ++tick) {
+      if (tick < kNumTicks) {
+        for (size_t m = 0; m < models.size(); ++m) {
+          if (uniform(rng) >= models[m].arrival_probability) continue;
+          TF_CHECK_OK(ScheduleTaskWithDeadline(
+              1, absl::FromUnixMicros(env.NowMicros()) + models[m].slo,
+              queues[m].get()));
+          ++scheduled;
+        }
+      } else {
+        mutex_lock l(mu);
+        if (processed == scheduled) break;
+      }
+      env.AdvanceByMicroseconds(kTickMicros);
+      Env::Default()->SleepForMicroseconds(kTickMicros);
+    }
+    queues.clear();
+    num_tasks += scheduled;
+    num_tasks_on_time += on_time;
+  }
+  state.counters["slo_attainment"] =
+      static_cast<double>(num_tasks_on_time) / num_tasks;
+}
+
+BENCHMARK(BM_DeadlineAwareScheduling)->Arg(0)->Arg(1);
+
 #ifdef PLATFORM_GOOGLE
 // This benchmark relies on https://github.com/google/benchmark features,
 // (in particular, `Benchmark::ThreadRange`) not available in open-sourced TF
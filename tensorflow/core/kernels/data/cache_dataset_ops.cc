@@ -33,6 +33,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/data/cache_ops.h"
 #include "tensorflow/core/kernels/data/iterator_ops.h"
+#include "tensorflow/core/kernels/data/spilling_cache.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/env.h"
@@ -52,6 +53,8 @@ namespace data {
 /* static */ constexpr const char* const CacheDatasetOp::kFileName;
 /* static */ constexpr const char* const CacheDatasetOp::kOutputTypes;
 /* static */ constexpr const char* const CacheDatasetOp::kOutputShapes;
+/* static */ constexpr const char* const CacheDatasetOp::kMemoryBudgetBytes;
+/* static */ constexpr const char* const CacheDatasetOp::kSpillDirectory;
 
 namespace {
 
@@ -760,10 +763,12 @@ class CacheDatasetOp::FileDatasetV2 : public CacheDatasetOp::FileDatasetBase {
 class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
  public:
   explicit MemoryDatasetBase(OpKernelContext* ctx, const DatasetBase* input,
-                             std::shared_ptr<MemoryCache> cache)
+                             std::shared_ptr<MemoryCache> cache,
+                             const SpillingCache::Options& spilling_options)
       : DatasetBase(DatasetContext(ctx)),
         input_(input),
-        cache_(std::move(cache)) {
+        cache_(std::move(cache)),
+        spilling_options_(spilling_options) {
     input_->Ref();
     random_indexing_compatible_ = input_->RandomIndexingCompatible();
   }
@@ -842,6 +847,18 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
   }
 
  protected:
+  // Returns the attributes configuring the memory budget.
+  std::vector<std::pair<StringPiece, AttrValue>> SpillingAttrs(
+      DatasetGraphDefBuilder* b) const {
+    AttrValue memory_budget_bytes;
+    b->BuildAttrValue<int64_t>(spilling_options_.memory_budget_bytes,
+                               &memory_budget_bytes);
+    AttrValue spill_directory;
+    b->BuildAttrValue(spilling_options_.spill_directory, &spill_directory);
+    return {{kMemoryBudgetBytes, memory_budget_bytes},
+            {kSpillDirectory, spill_directory}};
+  }
+
   class MemoryIterator : public DatasetIterator<MemoryDatasetBase> {
    public:
     explicit MemoryIterator(const Params& params, MemoryCache* cache)
@@ -877,8 +894,16 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
       mutex_lock l(mu_);
       if (cache_->IsCompleted()) {
         TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kCacheCompleted, ""));
-        TF_RETURN_IF_ERROR(
-            WriteElementsToCheckpoint(writer, prefix(), cache_->data()));
+        if (cache_->spilling_cache() != nullptr) {
+          TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(
+              writer, prefix(), cache_->size(),
+              [this](int64_t index, std::vector<Tensor>* element) {
+                return cache_->Get(index, element);
+              }));
+        } else {
+          TF_RETURN_IF_ERROR(
+              WriteElementsToCheckpoint(writer, prefix(), cache_->data()));
+        }
       }
       return SaveInput(ctx, writer, iterator_);
     }
@@ -892,10 +917,21 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
       iterator_.reset();
       cache_->Reset();
       if (reader->Contains(prefix(), kCacheCompleted)) {
-        std::vector<std::vector<Tensor>> temp_cache;
-        TF_RETURN_IF_ERROR(
-            ReadElementsFromCheckpoint(ctx, reader, prefix(), &temp_cache));
-        cache_->Complete(std::move(temp_cache));
+        if (dataset()->spilling_options_.memory_budget_bytes > 0) {
+          auto spilling_cache = std::make_unique<SpillingCache>(
+              ctx->env(), dataset()->spilling_options_);
+          TF_RETURN_IF_ERROR(ReadElementsFromCheckpoint(
+              ctx, reader, prefix(),
+              [&spilling_cache](std::vector<Tensor> element) {
+                return spilling_cache->Append(std::move(element));
+              }));
+          cache_->Complete(std::move(spilling_cache));
+        } else {
+          std::vector<std::vector<Tensor>> temp_cache;
+          TF_RETURN_IF_ERROR(
+              ReadElementsFromCheckpoint(ctx, reader, prefix(), &temp_cache));
+          cache_->Complete(std::move(temp_cache));
+        }
       }
       TF_RETURN_IF_ERROR(InitializeIterator(ctx));
       return RestoreInput(ctx, reader, iterator_);
@@ -909,13 +945,18 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
 
       ~MemoryWriterIterator() override {
         mutex_lock l(mu_);
-        if (!temp_cache_.empty() && !cache_->IsCompleted()) {
+        if (TempCacheSize() > 0 && !cache_->IsCompleted()) {
           LOG(WARNING) << kIncompleteCacheErrorMessage;
           cache_->Reset();
         }
       }
 
       Status Initialize(IteratorContext* ctx) override {
+        mutex_lock l(mu_);
+        if (dataset()->spilling_options_.memory_budget_bytes > 0) {
+          spilling_temp_cache_ = std::make_unique<SpillingCache>(
+              ctx->env(), dataset()->spilling_options_);
+        }
         return dataset()->input_->MakeIterator(ctx, this, prefix(),
                                                &input_impl_);
       }
@@ -929,16 +970,20 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         if (*end_of_sequence) {
           if (!cache_->IsCompleted()) {
             VLOG(2) << "Finalizing the cache because EOF has been reached.";
-            cache_->Complete(std::move(temp_cache_));
+            CompleteCache();
           }
           return absl::OkStatus();
         }
         RecordBufferEnqueue(ctx, *out_tensors);
-        temp_cache_.emplace_back(*out_tensors);
-        if (temp_cache_.size() == dataset()->input_->Cardinality()) {
+        if (spilling_temp_cache_) {
+          TF_RETURN_IF_ERROR(spilling_temp_cache_->Append(*out_tensors));
+        } else {
+          temp_cache_.emplace_back(*out_tensors);
+        }
+        if (TempCacheSize() == dataset()->input_->Cardinality()) {
           VLOG(2) << "Finalizing the cache because its size matches the "
                      "expected input cardinality.";
-          cache_->Complete(std::move(temp_cache_));
+          CompleteCache();
         }
         return absl::OkStatus();
       }
@@ -954,8 +999,17 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
                           IteratorStateWriter* writer) override {
         mutex_lock l(mu_);
         if (!cache_->IsCompleted()) {
-          TF_RETURN_IF_ERROR(
-              WriteElementsToCheckpoint(writer, prefix(), temp_cache_));
+          if (spilling_temp_cache_) {
+            SpillingCache* spilling_cache = spilling_temp_cache_.get();
+            TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(
+                writer, prefix(), spilling_cache->size(),
+                [spilling_cache](int64_t index, std::vector<Tensor>* element) {
+                  return spilling_cache->Get(index, element);
+                }));
+          } else {
+            TF_RETURN_IF_ERROR(
+                WriteElementsToCheckpoint(writer, prefix(), temp_cache_));
+          }
         }
         return SaveInput(ctx, writer, input_impl_);
       }
@@ -964,17 +1018,42 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
                              IteratorStateReader* reader) override {
         mutex_lock l(mu_);
         if (!reader->Contains(prefix(), kCacheCompleted)) {
-          TF_RETURN_IF_ERROR(
-              ReadElementsFromCheckpoint(ctx, reader, prefix(), &temp_cache_));
+          if (spilling_temp_cache_) {
+            SpillingCache* spilling_cache = spilling_temp_cache_.get();
+            TF_RETURN_IF_ERROR(ReadElementsFromCheckpoint(
+                ctx, reader, prefix(),
+                [spilling_cache](std::vector<Tensor> element) {
+                  return spilling_cache->Append(std::move(element));
+                }));
+          } else {
+            TF_RETURN_IF_ERROR(ReadElementsFromCheckpoint(ctx, reader,
+                                                          prefix(),
+                                                          &temp_cache_));
+          }
         }
         return RestoreInput(ctx, reader, input_impl_);
       }
 
      private:
+      size_t TempCacheSize() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        return spilling_temp_cache_ ? spilling_temp_cache_->size()
+                                    : temp_cache_.size();
+      }
+
+      void CompleteCache() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (spilling_temp_cache_) {
+          cache_->Complete(std::move(spilling_temp_cache_));
+        } else {
+          cache_->Complete(std::move(temp_cache_));
+        }
+      }
+
       mutex mu_;
       std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
       MemoryCache* const cache_ TF_GUARDED_BY(mu_);  // not owned.
       std::vector<std::vector<Tensor>> temp_cache_ TF_GUARDED_BY(mu_);
+      // Used instead of `temp_cache_` if the dataset has a memory budget.
+      std::unique_ptr<SpillingCache> spilling_temp_cache_ TF_GUARDED_BY(mu_);
     };  // MemoryWriterIterator
 
     class MemoryReaderIterator : public DatasetIterator<MemoryDatasetBase> {
@@ -990,9 +1069,12 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         // thus we record the memory allocated for the cache here. The caveat
         // is that this is incorrect if there are concurrent instances of this
         // iterator.
+        //
+        // Elements held by a spilling cache are not recorded since most of
+        // them are on disk.
         tf_shared_lock l(mu_);
-        for (size_t i = 0; i < cache_->size(); ++i) {
-          RecordBufferEnqueue(ctx, cache_->at(i));
+        for (const std::vector<Tensor>& element : cache_->data()) {
+          RecordBufferEnqueue(ctx, element);
         }
         return absl::OkStatus();
       }
@@ -1002,9 +1084,7 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
                              bool* end_of_sequence) override {
         mutex_lock l(mu_);
         if (index_ < cache_->size()) {
-          const std::vector<Tensor>& cache_tensors = cache_->at(index_);
-          out_tensors->insert(out_tensors->begin(), cache_tensors.begin(),
-                              cache_tensors.end());
+          TF_RETURN_IF_ERROR(cache_->Get(index_, out_tensors));
           index_++;
           *end_of_sequence = false;
           return absl::OkStatus();
@@ -1075,6 +1155,7 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
   mutable mutex mu_;
   const DatasetBase* const input_;
   const std::shared_ptr<MemoryCache> cache_;
+  const SpillingCache::Options spilling_options_;
   mutable std::unique_ptr<DatasetRandomAccessCache> dataset_random_access_cache_
       TF_GUARDED_BY(mu_);
   mutable std::unique_ptr<IteratorRandomAccessCache>
@@ -1088,8 +1169,9 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
 class CacheDatasetOp::MemoryDataset : public CacheDatasetOp::MemoryDatasetBase {
  public:
   MemoryDataset(OpKernelContext* ctx, const DatasetBase* input,
-                MemoryCacheManager* manager, ResourceHandle&& resource_handle)
-      : MemoryDatasetBase(ctx, input, manager->get()),
+                MemoryCacheManager* manager, ResourceHandle&& resource_handle,
+                const SpillingCache::Options& spilling_options)
+      : MemoryDatasetBase(ctx, input, manager->get(), spilling_options),
         manager_(manager),
         resource_handle_(std::move(resource_handle)),
         resource_mgr_(ctx->resource_manager()) {}
@@ -1111,8 +1193,8 @@ class CacheDatasetOp::MemoryDataset : public CacheDatasetOp::MemoryDatasetBase {
     TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_node));
     Node* filename_node = nullptr;
     TF_RETURN_IF_ERROR(b->AddScalar(tstring(""), &filename_node));
-    TF_RETURN_IF_ERROR(
-        b->AddDataset(this, {input_node, filename_node}, output));
+    TF_RETURN_IF_ERROR(b->AddDataset(this, {input_node, filename_node},
+                                     SpillingAttrs(b), output));
     return absl::OkStatus();
   }
 
@@ -1130,8 +1212,9 @@ class CacheDatasetOp::MemoryDatasetV2
  public:
   MemoryDatasetV2(OpKernelContext* ctx, const DatasetBase* input,
                   MemoryCacheManager* manager, ResourceHandle&& resource_handle,
-                  bool owns_resource)
-      : MemoryDatasetBase(ctx, input, manager->get()),
+                  bool owns_resource,
+                  const SpillingCache::Options& spilling_options)
+      : MemoryDatasetBase(ctx, input, manager->get(), spilling_options),
         manager_(manager),
         owns_resource_(owns_resource),
         resource_handle_(std::move(resource_handle)),
@@ -1160,8 +1243,9 @@ class CacheDatasetOp::MemoryDatasetV2
     Tensor handle(DT_RESOURCE, TensorShape({}));
     handle.scalar<ResourceHandle>()() = resource_handle_;
     TF_RETURN_IF_ERROR(b->AddTensor(handle, &resource_handle_node));
-    TF_RETURN_IF_ERROR(b->AddDataset(
-        this, {input_node, filename_node, resource_handle_node}, output));
+    TF_RETURN_IF_ERROR(
+        b->AddDataset(this, {input_node, filename_node, resource_handle_node},
+                      SpillingAttrs(b), output));
     return absl::OkStatus();
   }
 
@@ -1174,14 +1258,27 @@ class CacheDatasetOp::MemoryDatasetV2
 
 CacheDatasetOp::CacheDatasetOp(OpKernelConstruction* ctx)
     : UnaryDatasetOpKernel(ctx),
-      op_version_(ctx->def().op() == kCacheDataset ? 1 : 2) {}
+      op_version_(ctx->def().op() == kCacheDataset ? 1 : 2) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kMemoryBudgetBytes, &memory_budget_bytes_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kSpillDirectory, &spill_directory_));
+}
 
 void CacheDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
                                  DatasetBase** output) {
   // Parse out the filenames tensor.
   tstring filename;
   OP_REQUIRES_OK(ctx, ParseScalarArgument<tstring>(ctx, kFileName, &filename));
+  OP_REQUIRES(ctx,
+              filename.empty() ||
+                  (memory_budget_bytes_ == 0 && spill_directory_.empty()),
+              errors::InvalidArgument(
+                  "`memory_budget_bytes` and `spill_directory` can only be "
+                  "set when caching in memory, but got filename ",
+                  filename, "."));
   if (filename.empty()) {
+    SpillingCache::Options spilling_options;
+    spilling_options.memory_budget_bytes = memory_budget_bytes_;
+    spilling_options.spill_directory = spill_directory_;
     static std::atomic<int64_t> resource_id_counter(0);
     const string& container = ctx->resource_manager()->default_container();
     auto name = strings::StrCat(ctx->op_kernel().name(), "/", kMemoryCache, "_",
@@ -1207,7 +1304,7 @@ void CacheDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
       }
       // Ownership of manager is transferred onto `MemoryDatasetV2`.
       *output = new MemoryDatasetV2(ctx, input, manager, std::move(handle),
-                                    owns_resource);
+                                    owns_resource, spilling_options);
     } else {
       MemoryCacheManager* manager;
       OP_REQUIRES_OK(
@@ -1219,7 +1316,8 @@ void CacheDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
       auto handle =
           MakeResourceHandle<MemoryCacheManager>(ctx, container, name);
       // Ownership of manager is transferred onto `MemoryDataset`.
-      *output = new MemoryDataset(ctx, input, manager, std::move(handle));
+      *output = new MemoryDataset(ctx, input, manager, std::move(handle),
+                                  spilling_options);
     }
   } else {
     if (op_version_ == 2) {
@@ -15,6 +15,9 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_DATA_CACHE_DATASET_OPS_H_
 #define TENSORFLOW_CORE_KERNELS_DATA_CACHE_DATASET_OPS_H_
 
+#include <cstdint>
+#include <string>
+
 #include "tensorflow/core/framework/dataset.h"
 
 namespace tensorflow {
@@ -30,6 +33,9 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
   static constexpr const char* const kFileName = "filename";
   static constexpr const char* const kOutputTypes = "output_types";
   static constexpr const char* const kOutputShapes = "output_shapes";
+  static constexpr const char* const kMemoryBudgetBytes =
+      "memory_budget_bytes";
+  static constexpr const char* const kSpillDirectory = "spill_directory";
 
   explicit CacheDatasetOp(OpKernelConstruction* ctx);
 
@@ -44,6 +50,8 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
   class MemoryDatasetV2;
 
   const int op_version_;
+  int64_t memory_budget_bytes_ = 0;
+  std::string spill_directory_;
 };
 
 }  // namespace data
@@ -41,6 +41,14 @@ void MemoryCache::Complete(std::vector<std::vector<Tensor>>&& cache) {
   }
 }
 
+void MemoryCache::Complete(std::unique_ptr<SpillingCache> cache) {
+  mutex_lock l(mu_);
+  if (!completed_) {
+    spilling_cache_ = std::move(cache);
+    completed_ = true;
+  }
+}
+
 bool MemoryCache::IsCompleted() {
   tf_shared_lock l(mu_);
   return completed_;
@@ -50,6 +58,7 @@ void MemoryCache::Reset() {
   mutex_lock l(mu_);
   completed_ = false;
   cache_.clear();
+  spilling_cache_.reset();
 }
 
 const std::vector<Tensor>& MemoryCache::at(int64_t index) {
@@ -58,8 +67,27 @@ const std::vector<Tensor>& MemoryCache::at(int64_t index) {
   return cache_[index];
 }
 
+Status MemoryCache::Get(int64_t index, std::vector<Tensor>* out_tensors) {
+  std::shared_ptr<SpillingCache> spilling_cache;
+  {
+    tf_shared_lock l(mu_);
+    spilling_cache = spilling_cache_;
+  }
+  if (spilling_cache) {
+    return spilling_cache->Get(index, out_tensors);
+  }
+  tf_shared_lock l(mu_);
+  DCHECK(index < cache_.size());
+  const std::vector<Tensor>& element = cache_[index];
+  out_tensors->insert(out_tensors->end(), element.begin(), element.end());
+  return absl::OkStatus();
+}
+
 size_t MemoryCache::size() {
   tf_shared_lock l(mu_);
+  if (spilling_cache_) {
+    return spilling_cache_->size();
+  }
   return cache_.size();
 }
 
@@ -68,6 +96,11 @@ const std::vector<std::vector<Tensor>>& MemoryCache::data() {
   return cache_;
 }
 
+SpillingCache* MemoryCache::spilling_cache() {
+  tf_shared_lock l(mu_);
+  return spilling_cache_.get();
+}
+
 AnonymousMemoryCacheHandleOp::AnonymousMemoryCacheHandleOp(
     OpKernelConstruction* ctx)
     : AnonymousResourceOp<MemoryCacheManager>(ctx,
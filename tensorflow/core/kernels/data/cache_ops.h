@@ -16,8 +16,11 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_DATA_CACHE_OPS_H_
 #define TENSORFLOW_CORE_KERNELS_DATA_CACHE_OPS_H_
 
+#include <memory>
+
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/kernels/data/spilling_cache.h"
 
 namespace tensorflow {
 namespace data {
@@ -27,6 +30,9 @@ namespace data {
 // The expected use is that a single `MemoryWriterIterator` populates the
 // cache with dataset elements. Once all elements are cached, the cache can
 // be used by one or more `MemoryReaderIterator`s.
+//
+// If the cache was built with a memory budget, it is completed with a
+// `SpillingCache` and its elements must be accessed through `Get()`.
 class MemoryCache {
  public:
   MemoryCache() = default;
@@ -34,27 +40,42 @@ class MemoryCache {
   // Marks the cache as completed.
   void Complete(std::vector<std::vector<Tensor>>&& cache);
 
+  // Marks the cache as completed with elements held by a `SpillingCache`.
+  void Complete(std::unique_ptr<SpillingCache> cache);
+
   // Returns whether the cache is completed.
   bool IsCompleted();
 
   // Resets the cache.
   void Reset();
 
-  // Returns the element at the given index.
+  // Returns the element at the given index. Must not be used if the cache was
+  // completed with a `SpillingCache`.
   const std::vector<Tensor>& at(int64_t index);
 
+  // Appends the element at the given index to `out_tensors`.
+  Status Get(int64_t index, std::vector<Tensor>* out_tensors);
+
   // Returns the size of the cache.
   size_t size();
 
   // Returns a reference to the cache's data. The returned reference will be
-  // invalidated by any call to Reset().
+  // invalidated by any call to Reset(). The data is empty if the cache was
+  // completed with a `SpillingCache`.
   const std::vector<std::vector<Tensor>>& data();
 
+  // Returns the spilling cache, or nullptr if the cache was completed without
+  // one.
+  SpillingCache* spilling_cache();
+
  private:
   mutex mu_;
   // Determines whether all elements of the dataset have been cached.
   bool completed_ TF_GUARDED_BY(mu_) = false;
   std::vector<std::vector<Tensor>> cache_ TF_GUARDED_BY(mu_);
+  // Shared with `Get()` calls so that they do not hold `mu_` while reading
+  // from disk.
+  std::shared_ptr<SpillingCache> spilling_cache_ TF_GUARDED_BY(mu_);
 };
 
 // A resource wrapping a shared instance of a memory cache.
@@ -25,15 +25,26 @@ namespace data {
 namespace experimental {
 
 CompressElementOp::CompressElementOp(OpKernelConstruction* ctx)
-    : OpKernel(ctx) {}
+    : OpKernel(ctx) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kChunkSize, &chunk_size_));
+  OP_REQUIRES(ctx, chunk_size_ >= 0,
+              errors::InvalidArgument("`chunk_size` must be non-negative, ",
+                                      "but got ", chunk_size_));
+}
 
 void CompressElementOp::Compute(OpKernelContext* ctx) {
   std::vector<Tensor> components;
   for (size_t i = 0; i < ctx->num_inputs(); ++i) {
     components.push_back(ctx->input(i));
   }
+  // If requested, large elements are compressed in chunks, in parallel on the
+  // intra-op thread pool. Chunked elements can not be read by binaries which
+  // predate them, so they are only produced on request.
+  CompressElementOptions options;
+  options.chunk_size = chunk_size_;
+  options.thread_pool = ctx->device()->tensorflow_cpu_worker_threads()->workers;
   CompressedElement compressed;
-  OP_REQUIRES_OK(ctx, CompressElement(components, &compressed));
+  OP_REQUIRES_OK(ctx, CompressElement(components, options, &compressed));
 
   Tensor* output;
   OP_REQUIRES_OK(ctx, ctx->allocate_output(0, TensorShape({}), &output));
@@ -67,7 +78,11 @@ void UncompressElementOp::Compute(OpKernelContext* ctx) {
           tensor.DebugString()));
 
   std::vector<Tensor> components;
-  OP_REQUIRES_OK(ctx, UncompressElement(*compressed, &components));
+  OP_REQUIRES_OK(
+      ctx, UncompressElement(
+               *compressed,
+               ctx->device()->tensorflow_cpu_worker_threads()->workers,
+               &components));
   OP_REQUIRES(ctx, components.size() == output_types_.size(),
               errors::FailedPrecondition("Expected ", output_types_.size(),
                                          " outputs from uncompress, but got ",
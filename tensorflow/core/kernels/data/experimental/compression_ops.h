@@ -23,9 +23,14 @@ namespace experimental {
 
 class CompressElementOp : public OpKernel {
  public:
+  static constexpr const char* const kChunkSize = "chunk_size";
+
   explicit CompressElementOp(OpKernelConstruction* ctx);
 
   void Compute(OpKernelContext* ctx) override;
+
+ private:
+  int64_t chunk_size_;
 };
 
 class UncompressElementOp : public OpKernel {
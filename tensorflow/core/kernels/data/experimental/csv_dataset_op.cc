@@ -12,6 +12,10 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
+#include <array>
+#include <cstdint>
+#include <cstring>
+
 #include "tensorflow/core/framework/common_shape_fns.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/op.h"
@@ -26,6 +30,60 @@ namespace data {
 namespace experimental {
 namespace {
 
+// Returns a word with every byte set to `c`.
+constexpr uint64_t BroadcastByte(char c) {
+  return 0x0101010101010101ULL * static_cast<uint8_t>(c);
+}
+
+// Returns a non-zero value iff one of the bytes of `word` is zero.
+constexpr uint64_t HasZeroByte(uint64_t word) {
+  return (word - 0x0101010101010101ULL) & ~word & 0x8080808080808080ULL;
+}
+
+// Finds the characters that end an unquoted field: the field delimiter, line
+// breaks and, if quotes are used as delimiters, quotation marks (which are
+// invalid inside unquoted fields). Eight bytes are compared at a time, so that
+// only words containing one of these characters are examined byte by byte.
+class FieldScanner {
+ public:
+  FieldScanner(char delim, bool use_quote_delim)
+      : delim_mask_(BroadcastByte(delim)), use_quote_delim_(use_quote_delim) {
+    is_special_.fill(false);
+    is_special_[static_cast<uint8_t>(delim)] = true;
+    is_special_[static_cast<uint8_t>('\n')] = true;
+    is_special_[static_cast<uint8_t>('\r')] = true;
+    if (use_quote_delim) is_special_[static_cast<uint8_t>('"')] = true;
+  }
+
+  // Returns the index of the first special character in `data[pos, size)`, or
+  // `size` if there is none.
+  size_t Find(const char* data, size_t pos, size_t size) const {
+    while (pos + sizeof(uint64_t) <= size) {
+      uint64_t word;
+      std::memcpy(&word, data + pos, sizeof(word));
+      uint64_t matches = HasZeroByte(word ^ delim_mask_) |
+                         HasZeroByte(word ^ kNewLineMask) |
+                         HasZeroByte(word ^ kCarriageReturnMask);
+      if (use_quote_delim_) matches |= HasZeroByte(word ^ kQuoteMask);
+      if (matches != 0) break;
+      pos += sizeof(uint64_t);
+    }
+    for (; pos < size; ++pos) {
+      if (is_special_[static_cast<uint8_t>(data[pos])]) return pos;
+    }
+    return size;
+  }
+
+ private:
+  static constexpr uint64_t kNewLineMask = BroadcastByte('\n');
+  static constexpr uint64_t kCarriageReturnMask = BroadcastByte('\r');
+  static constexpr uint64_t kQuoteMask = BroadcastByte('"');
+
+  const uint64_t delim_mask_;
+  const bool use_quote_delim_;
+  std::array<bool, 256> is_special_;
+};
+
 class CSVDatasetOp : public DatasetOpKernel {
  public:
   explicit CSVDatasetOp(OpKernelConstruction* ctx)
@@ -184,7 +242,8 @@ class CSVDatasetOp : public DatasetOpKernel {
           op_version_(op_version),
           use_compression_(!compression_type.empty()),
           compression_type_(std::move(compression_type)),
-          options_(options) {}
+          options_(options),
+          field_scanner_(delim, use_quote_delim) {}
 
     std::unique_ptr<IteratorBase> MakeIteratorInternal(
         const string& prefix) const override {
@@ -508,7 +567,7 @@ class CSVDatasetOp : public DatasetOpKernel {
         pos_++;  // Starting quotation mark
 
         Status parse_result;
-        while (true) {  // Each iter reads 1 char, filling buffer if necessary
+        while (true) {  // Each iter handles 1 quote, filling buffer if necessary
           if (pos_ >= buffer_.size()) {
             Status s = SaveAndFillBuffer(&earlier_pieces, &start, include);
             if (errors::IsOutOfRange(s)) {
@@ -562,7 +621,13 @@ class CSVDatasetOp : public DatasetOpKernel {
             }
 
           } else {
-            pos_++;
+            // Only quotation marks are special inside a quoted field, so skip
+            // straight to the next one.
+            const void* quote = std::memchr(buffer_.data() + pos_ + 1, '"',
+                                            buffer_.size() - pos_ - 1);
+            pos_ = quote == nullptr
+                       ? buffer_.size()
+                       : static_cast<const char*>(quote) - buffer_.data();
           }
         }
       }
@@ -641,7 +706,9 @@ class CSVDatasetOp : public DatasetOpKernel {
         size_t start = pos_;
         Status parse_result;
 
-        while (true) {  // Each iter reads 1 char, filling buffer if necessary
+        // Each iter skips to the next special char, filling buffer if
+        // necessary
+        while (true) {
           if (pos_ >= buffer_.size()) {
             Status s = SaveAndFillBuffer(&earlier_pieces, &start, include);
             // Handle errors
@@ -657,6 +724,9 @@ class CSVDatasetOp : public DatasetOpKernel {
             }
           }
 
+          pos_ = dataset()->field_scanner_.Find(buffer_.data(), pos_,
+                                                buffer_.size());
+          if (pos_ >= buffer_.size()) continue;
           char ch = buffer_[pos_];
 
           if (ch == dataset()->delim_) {
@@ -677,12 +747,10 @@ class CSVDatasetOp : public DatasetOpKernel {
             if (ch == '\r') SkipNewLineIfNecessary();
             return parse_result;
           }
-          if (dataset()->use_quote_delim_ && ch == '"') {
-            // Take note of the error, but keep going to end of field.
-            parse_result.Update(errors::InvalidArgument(
-                "Unquoted fields cannot have quotes inside"));
-          }
-          // Otherwise, go to next character
+          // Otherwise, `ch` is a quote. Take note of the error, but keep going
+          // to end of field.
+          parse_result.Update(errors::InvalidArgument(
+              "Unquoted fields cannot have quotes inside"));
           pos_++;
         }
       }
@@ -789,7 +857,7 @@ class CSVDatasetOp : public DatasetOpKernel {
               component.scalar<tstring>()() =
                   dataset()->record_defaults_[output_idx].flat<tstring>()(0);
             } else {
-              component.scalar<tstring>()() = string(field);
+              component.scalar<tstring>()().assign(field.data(), field.size());
             }
             break;
           }
@@ -920,6 +988,7 @@ class CSVDatasetOp : public DatasetOpKernel {
     const bool use_compression_;
     const tstring compression_type_;
     const io::ZlibCompressionOptions options_;
+    const FieldScanner field_scanner_;
   };  // class Dataset
 
   const int op_version_;
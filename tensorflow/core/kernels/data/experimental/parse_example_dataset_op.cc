@@ -192,6 +192,9 @@ class ParseExampleDatasetOp : public UnaryDatasetOpKernel {
                   errors::InvalidArgument("Duplicate key not allowed: ",
                                           ragged_keys_[d]));
     }
+    // The config does not change for the lifetime of the dataset, so the
+    // feature name index is built once rather than for every batch.
+    OP_REQUIRES_OK(ctx, example::CompileFastParseExampleConfig(&config));
     int i = 0;
     for (auto it = key_to_output_index.begin(); it != key_to_output_index.end();
          it++) {
@@ -0,0 +1,304 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/data/packed_element_buffer.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/snappy.h"
+#include "tensorflow/core/platform/stringpiece.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+absl::Status Corrupted() {
+  return errors::DataLoss("Corrupted element in packed element buffer.");
+}
+
+}  // namespace
+
+PackedElementBuffer::PackedElementBuffer(const DataTypeVector& dtypes,
+                                         const Options& options)
+    : dtypes_(dtypes), options_(options) {
+  DCHECK(CanPack(dtypes_));
+}
+
+bool PackedElementBuffer::CanPack(const DataTypeVector& dtypes) {
+  for (DataType dtype : dtypes) {
+    if (dtype != DT_STRING && !DataTypeCanUseMemcpy(dtype)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void PackedElementBuffer::Resize(int64_t size) {
+  for (int64_t i = size; i < slots_.size(); ++i) {
+    Release(slots_[i]);
+  }
+  slots_.resize(size);
+}
+
+void PackedElementBuffer::GrowRing(int64_t size, int64_t begin, int64_t end) {
+  DCHECK_GE(size, slots_.size());
+  DCHECK_LE(end - begin, slots_.size());
+  std::vector<Slot> slots(size);
+  for (int64_t p = begin; p < end; ++p) {
+    std::swap(slots[p % size], slots_[p % slots_.size()]);
+  }
+  for (Slot& slot : slots_) {
+    Release(slot);
+  }
+  slots_ = std::move(slots);
+}
+
+absl::Status PackedElementBuffer::Put(int64_t index,
+                                      const std::vector<Tensor>& element) {
+  if (element.size() != dtypes_.size()) {
+    return errors::InvalidArgument("Expected an element with ", dtypes_.size(),
+                                   " components, got ", element.size());
+  }
+  encoded_.clear();
+  for (int i = 0; i < element.size(); ++i) {
+    const Tensor& tensor = element[i];
+    if (tensor.dtype() != dtypes_[i]) {
+      return errors::InvalidArgument(
+          "Expected component ", i, " to have type ",
+          DataTypeString(dtypes_[i]), ", got ", DataTypeString(tensor.dtype()));
+    }
+    core::PutVarint64(&encoded_, tensor.dims());
+    for (int d = 0; d < tensor.dims(); ++d) {
+      core::PutVarint64(&encoded_, tensor.dim_size(d));
+    }
+    if (tensor.dtype() == DT_STRING) {
+      auto strings = tensor.flat<tstring>();
+      for (int64_t j = 0; j < strings.size(); ++j) {
+        core::PutVarint64(&encoded_, strings(j).size());
+      }
+      for (int64_t j = 0; j < strings.size(); ++j) {
+        encoded_.append(strings(j).data(), strings(j).size());
+      }
+    } else {
+      encoded_.append(tensor.tensor_data().data(),
+                      tensor.tensor_data().size());
+    }
+  }
+
+  absl::string_view bytes = encoded_;
+  bool compressed = false;
+  if (options_.compress &&
+      port::Snappy_Compress(encoded_.data(), encoded_.size(), &compressed_) &&
+      compressed_.size() < encoded_.size()) {
+    bytes = compressed_;
+    compressed = true;
+  }
+  if (bytes.size() > std::numeric_limits<uint32_t>::max()) {
+    return errors::InvalidArgument("Element of ", bytes.size(),
+                                   " bytes is too large for a packed buffer.");
+  }
+  Release(slots_[index]);
+  Append(bytes, slots_[index]);
+  slots_[index].compressed = compressed;
+  MaybeRepack();
+  return absl::OkStatus();
+}
+
+absl::Status PackedElementBuffer::Take(int64_t index,
+                                       std::vector<Tensor>* out_tensors) {
+  out_tensors->clear();
+  TF_RETURN_IF_ERROR(Get(index, out_tensors));
+  Release(slots_[index]);
+  MaybeRepack();
+  return absl::OkStatus();
+}
+
+absl::Status PackedElementBuffer::Get(int64_t index,
+                                      std::vector<Tensor>* out_tensors) const {
+  const Slot& slot = slots_[index];
+  if (slot.chunk < 0) {
+    return absl::OkStatus();
+  }
+  return Decode(slot, out_tensors);
+}
+
+void PackedElementBuffer::CopyFrom(const PackedElementBuffer& src,
+                                   int64_t src_index, int64_t index) {
+  DCHECK_NE(&src, this);
+  DCHECK(src.dtypes_ == dtypes_);
+  Release(slots_[index]);
+  const Slot& src_slot = src.slots_[src_index];
+  if (src_slot.chunk >= 0) {
+    const char* data =
+        src.chunks_[src_slot.chunk].data.get() + src_slot.offset;
+    Append(absl::string_view(data, src_slot.length), slots_[index]);
+    slots_[index].compressed = src_slot.compressed;
+  }
+  MaybeRepack();
+}
+
+void PackedElementBuffer::Append(absl::string_view bytes, Slot& slot) {
+  int32_t chunk_index = current_chunk_;
+  if (chunk_index < 0 ||
+      chunks_[chunk_index].capacity - chunks_[chunk_index].used <
+          bytes.size()) {
+    const bool dedicated = bytes.size() > options_.chunk_size_bytes;
+    const uint32_t capacity =
+        dedicated ? bytes.size() : options_.chunk_size_bytes;
+    if (free_chunks_.empty()) {
+      chunk_index = chunks_.size();
+      chunks_.emplace_back();
+    } else {
+      chunk_index = free_chunks_.back();
+      free_chunks_.pop_back();
+    }
+    Chunk& chunk = chunks_[chunk_index];
+    chunk.data = std::make_unique<char[]>(capacity);
+    chunk.capacity = capacity;
+    chunk.used = 0;
+    chunk.live_bytes = 0;
+    allocated_bytes_ += capacity;
+    if (!dedicated) {
+      // The previous chunk is released once its last element is removed.
+      current_chunk_ = chunk_index;
+    }
+  }
+  Chunk& chunk = chunks_[chunk_index];
+  memcpy(chunk.data.get() + chunk.used, bytes.data(), bytes.size());
+  slot.chunk = chunk_index;
+  slot.offset = chunk.used;
+  slot.length = bytes.size();
+  chunk.used += bytes.size();
+  chunk.live_bytes += bytes.size();
+  packed_bytes_ += bytes.size();
+}
+
+void PackedElementBuffer::Release(Slot& slot) {
+  if (slot.chunk < 0) {
+    return;
+  }
+  Chunk& chunk = chunks_[slot.chunk];
+  chunk.live_bytes -= slot.length;
+  packed_bytes_ -= slot.length;
+  if (chunk.live_bytes == 0) {
+    if (slot.chunk == current_chunk_) {
+      chunk.used = 0;
+    } else {
+      allocated_bytes_ -= chunk.capacity;
+      chunk = Chunk();
+      free_chunks_.push_back(slot.chunk);
+    }
+  }
+  slot = Slot();
+}
+
+void PackedElementBuffer::MaybeRepack() {
+  if (allocated_bytes_ > 2 * (packed_bytes_ + options_.chunk_size_bytes)) {
+    Repack();
+  }
+}
+
+void PackedElementBuffer::Repack() {
+  std::vector<Chunk> old_chunks = std::move(chunks_);
+  chunks_.clear();
+  free_chunks_.clear();
+  current_chunk_ = -1;
+  packed_bytes_ = 0;
+  allocated_bytes_ = 0;
+  for (Slot& slot : slots_) {
+    if (slot.chunk < 0) {
+      continue;
+    }
+    const Chunk& old_chunk = old_chunks[slot.chunk];
+    Append(absl::string_view(old_chunk.data.get() + slot.offset, slot.length),
+           slot);
+  }
+}
+
+absl::Status PackedElementBuffer::Decode(
+    const Slot& slot, std::vector<Tensor>* out_tensors) const {
+  const char* data = chunks_[slot.chunk].data.get() + slot.offset;
+  std::string uncompressed;
+  StringPiece input(data, slot.length);
+  if (slot.compressed) {
+    size_t length;
+    if (!port::Snappy_GetUncompressedLength(data, slot.length, &length)) {
+      return Corrupted();
+    }
+    uncompressed.resize(length);
+    if (!port::Snappy_Uncompress(data, slot.length, uncompressed.data())) {
+      return Corrupted();
+    }
+    input = uncompressed;
+  }
+
+  out_tensors->reserve(out_tensors->size() + dtypes_.size());
+  for (DataType dtype : dtypes_) {
+    uint64_t rank;
+    if (!core::GetVarint64(&input, &rank)) {
+      return Corrupted();
+    }
+    TensorShape shape;
+    for (uint64_t d = 0; d < rank; ++d) {
+      uint64_t dim;
+      if (!core::GetVarint64(&input, &dim)) {
+        return Corrupted();
+      }
+      TF_RETURN_IF_ERROR(shape.AddDimWithStatus(dim));
+    }
+    Tensor tensor(dtype, shape);
+    if (dtype == DT_STRING) {
+      auto strings = tensor.flat<tstring>();
+      std::vector<uint64_t> lengths(strings.size());
+      for (uint64_t& length : lengths) {
+        if (!core::GetVarint64(&input, &length)) {
+          return Corrupted();
+        }
+      }
+      for (int64_t j = 0; j < strings.size(); ++j) {
+        if (input.size() < lengths[j]) {
+          return Corrupted();
+        }
+        strings(j).assign(input.data(), lengths[j]);
+        input.remove_prefix(lengths[j]);
+      }
+    } else {
+      const size_t num_bytes = tensor.tensor_data().size();
+      if (input.size() < num_bytes) {
+        return Corrupted();
+      }
+      memcpy(const_cast<char*>(tensor.tensor_data().data()), input.data(),
+             num_bytes);
+      input.remove_prefix(num_bytes);
+    }
+    out_tensors->push_back(std::move(tensor));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace data
+}  // namespace tensorflow
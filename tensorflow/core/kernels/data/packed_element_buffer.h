@@ -0,0 +1,155 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_PACKED_ELEMENT_BUFFER_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_PACKED_ELEMENT_BUFFER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+
+namespace tensorflow {
+namespace data {
+
+// A fixed set of slots holding dataset elements in packed form.
+//
+// Instead of keeping a `std::vector<Tensor>` per element, each element is
+// serialized into a contiguous byte string (shapes as varints followed by the
+// raw tensor bytes, optionally snappy-compressed) and appended to large
+// arena chunks. A slot only holds the location of its bytes, so moving
+// elements between slots is cheap and millions of small elements do not pay
+// per-tensor allocation overhead.
+//
+// Space freed by removed elements is reclaimed when a chunk becomes empty, or
+// by repacking all live elements once the chunks hold more dead bytes than
+// live ones. Only element types whose tensors are memcpy-able or strings are
+// supported; see `CanPack()`.
+//
+// Not thread-safe.
+class PackedElementBuffer {
+ public:
+  struct Options {
+    // Whether to snappy-compress each element before storing it.
+    bool compress = false;
+    // The size of the arena chunks. Larger elements get a dedicated chunk.
+    int64_t chunk_size_bytes = 1 << 20;
+  };
+
+  PackedElementBuffer(const DataTypeVector& dtypes, const Options& options);
+
+  PackedElementBuffer(const PackedElementBuffer&) = delete;
+  PackedElementBuffer& operator=(const PackedElementBuffer&) = delete;
+
+  // Returns whether elements with the given component types can be packed.
+  static bool CanPack(const DataTypeVector& dtypes);
+
+  // Returns the number of slots.
+  int64_t size() const { return slots_.size(); }
+
+  // Changes the number of slots. Elements in removed slots are dropped, and
+  // added slots are empty.
+  void Resize(int64_t size);
+
+  // Grows the buffer to `size` slots, treating it as a ring buffer whose
+  // elements occupy the positions [`begin`, `end`): the element at position
+  // `p` is moved from slot `p % size()` to slot `p % size`.
+  void GrowRing(int64_t size, int64_t begin, int64_t end);
+
+  // Returns whether the slot at `index` holds no element.
+  bool IsEmpty(int64_t index) const { return slots_[index].chunk < 0; }
+
+  // Stores `element` in the slot at `index`, replacing any previous element.
+  absl::Status Put(int64_t index, const std::vector<Tensor>& element);
+
+  // Moves the element at `index` into `out_tensors`, leaving the slot empty.
+  absl::Status Take(int64_t index, std::vector<Tensor>* out_tensors);
+
+  // Appends a copy of the element at `index` to `out_tensors`. Does nothing if
+  // the slot is empty.
+  absl::Status Get(int64_t index, std::vector<Tensor>* out_tensors) const;
+
+  // Stores a copy of the element in slot `src_index` of `src` in the slot at
+  // `index`, replacing any previous element. The element is copied in packed
+  // form, so `src` must hold elements of the same types.
+  void CopyFrom(const PackedElementBuffer& src, int64_t src_index,
+                int64_t index);
+
+  // Exchanges the contents of two slots.
+  void Swap(int64_t i, int64_t j) { std::swap(slots_[i], slots_[j]); }
+
+  // Returns the number of bytes of packed element data in the buffer.
+  int64_t packed_bytes() const { return packed_bytes_; }
+
+  // Returns the number of bytes allocated for arena chunks.
+  int64_t allocated_bytes() const { return allocated_bytes_; }
+
+ private:
+  struct Slot {
+    // The index of the chunk holding the element, or -1 if the slot is empty.
+    int32_t chunk = -1;
+    uint32_t offset = 0;
+    uint32_t length = 0;
+    bool compressed = false;
+  };
+
+  struct Chunk {
+    std::unique_ptr<char[]> data;
+    uint32_t capacity = 0;
+    uint32_t used = 0;
+    // The number of bytes in the chunk still referenced by a slot.
+    int64_t live_bytes = 0;
+  };
+
+  // Copies `bytes` into the current chunk, starting a new one if needed, and
+  // points `slot` at them.
+  void Append(absl::string_view bytes, Slot& slot);
+
+  // Releases the bytes referenced by `slot` and marks it empty.
+  void Release(Slot& slot);
+
+  // Repacks the buffer if the chunks hold more dead bytes than live ones.
+  void MaybeRepack();
+
+  // Moves all live elements into fresh chunks.
+  void Repack();
+
+  absl::Status Decode(const Slot& slot, std::vector<Tensor>* out_tensors) const;
+
+  const DataTypeVector dtypes_;
+  const Options options_;
+  std::vector<Slot> slots_;
+  std::vector<Chunk> chunks_;
+  // Indices of chunks whose memory has been released and can be reused.
+  std::vector<int32_t> free_chunks_;
+  // The chunk new elements are appended to, or -1.
+  int32_t current_chunk_ = -1;
+  int64_t packed_bytes_ = 0;
+  int64_t allocated_bytes_ = 0;
+  // Scratch space reused across calls to `Put()`.
+  std::string encoded_;
+  std::string compressed_;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_PACKED_ELEMENT_BUFFER_H_
@@ -0,0 +1,225 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/packed_element_buffer.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+const DataTypeVector& ElementTypes() {
+  static const DataTypeVector* dtypes =
+      new DataTypeVector({DT_INT64, DT_STRING, DT_FLOAT});
+  return *dtypes;
+}
+
+// Each element is an int64 scalar, a string scalar and a float vector.
+std::vector<Tensor> MakeElement(int64_t i) {
+  return {test::AsScalar<int64_t>(i),
+          test::AsScalar<tstring>(strings::StrCat("element_", i)),
+          test::AsTensor<float>({1.0f * i, 2.0f * i, 3.0f * i})};
+}
+
+void ExpectElement(const std::vector<Tensor>& element, int64_t i) {
+  std::vector<Tensor> expected = MakeElement(i);
+  ASSERT_EQ(element.size(), expected.size());
+  for (int j = 0; j < expected.size(); ++j) {
+    test::ExpectEqual(element[j], expected[j]);
+  }
+}
+
+TEST(PackedElementBufferTest, CanPack) {
+  EXPECT_TRUE(PackedElementBuffer::CanPack(ElementTypes()));
+  EXPECT_TRUE(PackedElementBuffer::CanPack({DT_BOOL, DT_BFLOAT16}));
+  EXPECT_FALSE(PackedElementBuffer::CanPack({DT_INT64, DT_VARIANT}));
+  EXPECT_FALSE(PackedElementBuffer::CanPack({DT_RESOURCE}));
+}
+
+TEST(PackedElementBufferTest, PutAndTake) {
+  PackedElementBuffer buffer(ElementTypes(), PackedElementBuffer::Options());
+  buffer.Resize(10);
+  for (int64_t i = 0; i < 10; ++i) {
+    EXPECT_TRUE(buffer.IsEmpty(i));
+    TF_ASSERT_OK(buffer.Put(i, MakeElement(i)));
+    EXPECT_FALSE(buffer.IsEmpty(i));
+  }
+  EXPECT_GT(buffer.packed_bytes(), 0);
+  for (int64_t i = 0; i < 10; ++i) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(buffer.Get(i, &element));
+    ExpectElement(element, i);
+    element.clear();
+    TF_ASSERT_OK(buffer.Take(i, &element));
+    ExpectElement(element, i);
+    EXPECT_TRUE(buffer.IsEmpty(i));
+  }
+  EXPECT_EQ(buffer.packed_bytes(), 0);
+}
+
+TEST(PackedElementBufferTest, Compressed) {
+  PackedElementBuffer::Options options;
+  options.compress = true;
+  PackedElementBuffer buffer({DT_INT64, DT_STRING}, options);
+  buffer.Resize(2);
+  std::vector<Tensor> element = {
+      test::AsScalar<int64_t>(7),
+      test::AsScalar<tstring>(std::string(4096, 'a'))};
+  TF_ASSERT_OK(buffer.Put(0, element));
+  TF_ASSERT_OK(buffer.Put(1, MakeElement(1)));
+  EXPECT_LT(buffer.packed_bytes(), 4096);
+
+  std::vector<Tensor> out;
+  TF_ASSERT_OK(buffer.Take(0, &out));
+  ASSERT_EQ(out.size(), 2);
+  test::ExpectEqual(out[0], element[0]);
+  test::ExpectEqual(out[1], element[1]);
+}
+
+TEST(PackedElementBufferTest, PutReplacesElement) {
+  PackedElementBuffer buffer(ElementTypes(), PackedElementBuffer::Options());
+  buffer.Resize(1);
+  TF_ASSERT_OK(buffer.Put(0, MakeElement(1)));
+  int64_t packed_bytes = buffer.packed_bytes();
+  TF_ASSERT_OK(buffer.Put(0, MakeElement(2)));
+  EXPECT_EQ(buffer.packed_bytes(), packed_bytes);
+  std::vector<Tensor> element;
+  TF_ASSERT_OK(buffer.Take(0, &element));
+  ExpectElement(element, 2);
+}
+
+TEST(PackedElementBufferTest, Swap) {
+  PackedElementBuffer buffer(ElementTypes(), PackedElementBuffer::Options());
+  buffer.Resize(3);
+  TF_ASSERT_OK(buffer.Put(0, MakeElement(0)));
+  TF_ASSERT_OK(buffer.Put(2, MakeElement(2)));
+  buffer.Swap(0, 1);
+  buffer.Swap(1, 2);
+  EXPECT_FALSE(buffer.IsEmpty(0) && buffer.IsEmpty(1) && buffer.IsEmpty(2));
+  std::vector<Tensor> element;
+  TF_ASSERT_OK(buffer.Take(1, &element));
+  ExpectElement(element, 2);
+  element.clear();
+  TF_ASSERT_OK(buffer.Take(2, &element));
+  ExpectElement(element, 0);
+  EXPECT_TRUE(buffer.IsEmpty(0));
+}
+
+TEST(PackedElementBufferTest, GrowRingPreservesPositions) {
+  PackedElementBuffer buffer(ElementTypes(), PackedElementBuffer::Options());
+  buffer.Resize(4);
+  // Positions [6, 10) occupy slots 2, 3, 0, 1.
+  for (int64_t p = 6; p < 10; ++p) {
+    TF_ASSERT_OK(buffer.Put(p % 4, MakeElement(p)));
+  }
+  buffer.GrowRing(8, /*begin=*/6, /*end=*/10);
+  EXPECT_EQ(buffer.size(), 8);
+  for (int64_t p = 6; p < 10; ++p) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(buffer.Take(p % 8, &element));
+    ExpectElement(element, p);
+  }
+  for (int64_t i = 0; i < 8; ++i) {
+    EXPECT_TRUE(buffer.IsEmpty(i));
+  }
+}
+
+TEST(PackedElementBufferTest, CopyFrom) {
+  PackedElementBuffer::Options options;
+  options.compress = true;
+  PackedElementBuffer src(ElementTypes(), options);
+  PackedElementBuffer dst(ElementTypes(), options);
+  src.Resize(3);
+  dst.Resize(3);
+  TF_ASSERT_OK(src.Put(0, MakeElement(0)));
+  TF_ASSERT_OK(src.Put(1, MakeElement(1)));
+  TF_ASSERT_OK(dst.Put(2, MakeElement(2)));
+  dst.CopyFrom(src, 0, 1);
+  dst.CopyFrom(src, 2, 2);
+  EXPECT_TRUE(dst.IsEmpty(0));
+  EXPECT_TRUE(dst.IsEmpty(2));
+  EXPECT_GT(dst.packed_bytes(), 0);
+  EXPECT_LT(dst.packed_bytes(), src.packed_bytes());
+
+  // The copy is independent of the source.
+  std::vector<Tensor> element;
+  TF_ASSERT_OK(src.Take(0, &element));
+  element.clear();
+  TF_ASSERT_OK(dst.Take(1, &element));
+  ExpectElement(element, 0);
+}
+
+TEST(PackedElementBufferTest, ReclaimsMemory) {
+  PackedElementBuffer::Options options;
+  options.chunk_size_bytes = 1024;
+  PackedElementBuffer buffer(ElementTypes(), options);
+  buffer.Resize(1000);
+  for (int64_t i = 0; i < 1000; ++i) {
+    TF_ASSERT_OK(buffer.Put(i, MakeElement(i)));
+  }
+  const int64_t full_allocated_bytes = buffer.allocated_bytes();
+  EXPECT_GE(full_allocated_bytes, buffer.packed_bytes());
+
+  // Keep every fourth element so that no chunk becomes empty on its own.
+  for (int64_t i = 0; i < 1000; ++i) {
+    if (i % 4 == 0) {
+      continue;
+    }
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(buffer.Take(i, &element));
+    ExpectElement(element, i);
+  }
+  EXPECT_LT(buffer.allocated_bytes(), full_allocated_bytes);
+  EXPECT_LE(buffer.allocated_bytes(),
+            2 * (buffer.packed_bytes() + options.chunk_size_bytes));
+  for (int64_t i = 0; i < 1000; i += 4) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(buffer.Take(i, &element));
+    ExpectElement(element, i);
+  }
+  EXPECT_EQ(buffer.packed_bytes(), 0);
+}
+
+TEST(PackedElementBufferTest, ElementLargerThanChunk) {
+  PackedElementBuffer::Options options;
+  options.chunk_size_bytes = 64;
+  PackedElementBuffer buffer({DT_STRING}, options);
+  buffer.Resize(2);
+  std::vector<Tensor> large = {test::AsScalar<tstring>(std::string(1000, 'x'))};
+  std::vector<Tensor> small = {test::AsScalar<tstring>("small")};
+  TF_ASSERT_OK(buffer.Put(0, large));
+  TF_ASSERT_OK(buffer.Put(1, small));
+  EXPECT_GE(buffer.allocated_bytes(), 1000);
+
+  std::vector<Tensor> out;
+  TF_ASSERT_OK(buffer.Take(0, &out));
+  test::ExpectEqual(out[0], large[0]);
+  EXPECT_LT(buffer.allocated_bytes(), 1000);
+  out.clear();
+  TF_ASSERT_OK(buffer.Take(1, &out));
+  test::ExpectEqual(out[0], small[0]);
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/parallel_map_dataset_op.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <deque>
 #include <functional>
@@ -83,6 +84,28 @@ constexpr char kErrorMessage[] = "error_message";
 // Period between reporting dataset statistics.
 constexpr int kStatsReportingPeriodMillis = 1000;
 
+// Upper bound on the number of elements grouped into a single invocation task
+// when the invocation batch size is autotuned.
+constexpr int64_t kMaxInvocationBatchSize = 64;
+
+// Returns the invocation batch size requested through
+// `AutotuneOptions.map_invocation_batch_size`, or 1 if grouping is disabled.
+int64_t GetInvocationBatchSizeOption(IteratorContext* ctx) {
+  if (!ctx->options()) {
+    return 1;
+  }
+  const AutotuneOptions& autotune_options = ctx->options()->autotune_options();
+  if (autotune_options.optional_map_invocation_batch_size_case() !=
+      AutotuneOptions::kMapInvocationBatchSize) {
+    return 1;
+  }
+  int64_t value = autotune_options.map_invocation_batch_size();
+  if (value == model::kAutotune) {
+    return model::kAutotune;
+  }
+  return std::max<int64_t>(1, value);
+}
+
 }  // namespace
 
 class ParallelMapDatasetOp::Dataset : public DatasetBase {
@@ -253,6 +276,8 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
           cond_var_(std::make_shared<condition_variable>()),
           num_parallel_calls_(std::make_shared<model::SharedState>(
               params.dataset->num_parallel_calls_, mu_, cond_var_)),
+          invocation_batch_size_(std::make_shared<model::SharedState>(
+              model::kAutotune, mu_, cond_var_)),
           deterministic_(params.dataset->deterministic_.IsDeterministic() ||
                          params.dataset->deterministic_.IsDefault()),
           preserve_cardinality_(params.dataset->preserve_cardinality_),
@@ -275,6 +300,10 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
       if (num_parallel_calls_->value == model::kAutotune) {
         num_parallel_calls_->value = GetAutotuneDefaultParallelism(ctx);
       }
+      // When autotuned, calls start with one element each and the model grows
+      // them while doing so reduces the output latency.
+      invocation_batch_size_->value =
+          std::max<int64_t>(1, GetInvocationBatchSizeOption(ctx));
       cancellation_manager_ = std::make_unique<CancellationManager>();
       TF_RETURN_IF_ERROR(RegisterCancellationCallback(
           ctx->cancellation_manager(),
@@ -337,6 +366,13 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
             model::MakeParameter("parallelism", num_parallel_calls_, /*min=*/1,
                                  /*max=*/ctx->runner_threadpool_size());
       }
+      std::vector<std::shared_ptr<model::Parameter>> parameters;
+      parameters.push_back(std::move(parameter));
+      if (GetInvocationBatchSizeOption(ctx) == model::kAutotune) {
+        parameters.push_back(model::MakeParameter(
+            model::kInvocationBatchSize, invocation_batch_size_, /*min=*/1,
+            /*max=*/kMaxInvocationBatchSize));
+      }
       std::optional<int64_t> estimated_element_size =
           dataset()->GetEstimatedElementSize();
       if (!estimated_element_size) {
@@ -348,7 +384,7 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
 
       return model::MakeAsyncKnownRatioNode(
           std::move(args),
-          /*ratio=*/1, {std::move(parameter)},
+          /*ratio=*/1, std::move(parameters),
           /*is_legacy_prefetch_autotuned=*/false, estimated_element_size);
     }
 
@@ -445,10 +481,12 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
 
     TraceMeMetadata GetTraceMeMetadata() const override {
       int64_t parallelism = -1;
+      int64_t invocation_batch_size = -1;
       // NOTE: We only set the parallelism value if the lock can be acquired
       // right away to avoid introducing tracing overhead.
       if (mu_->try_lock()) {
         parallelism = num_parallel_calls_->value;
+        invocation_batch_size = invocation_batch_size_->value;
         mu_->unlock();
       }
       data::TraceMeMetadata result;
@@ -461,6 +499,12 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
           parallelism == -1
               ? kTraceInfoUnavailable
               : strings::Printf("%lld", static_cast<long long>(parallelism))));
+      result.push_back(std::make_pair(
+          "invocation_batch_size",
+          invocation_batch_size == -1
+              ? kTraceInfoUnavailable
+              : strings::Printf(
+                    "%lld", static_cast<long long>(invocation_batch_size))));
       result.push_back(std::make_pair(
           "interleave_depth",
           strings::Printf("%lld", static_cast<long long>(interleave_depth_))));
@@ -507,74 +551,146 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
       }
     }
 
+    // The input elements and results of a single invocation task, which
+    // applies the map function to one or more consecutive input elements.
+    struct Invocation {
+      std::vector<std::vector<Tensor>> input_elements;
+      std::vector<std::shared_ptr<InvocationResult>> results;
+    };
+
+    // Publishes `result` to the consumer. If `call_completed` is set, this was
+    // the last element of its invocation task, which no longer counts towards
+    // the outstanding calls.
     void CallCompleted(const std::shared_ptr<IteratorContext>& ctx,
-                       const std::shared_ptr<InvocationResult>& result)
-        TF_LOCKS_EXCLUDED(*mu_) {
+                       const std::shared_ptr<InvocationResult>& result,
+                       bool call_completed) TF_LOCKS_EXCLUDED(*mu_) {
       mutex_lock l(*mu_);
-      num_calls_--;
+      if (call_completed) {
+        num_calls_--;
+        last_call_completed_nanos_ = EnvTime::NowNanos();
+      }
       result->notification.Notify();
       cond_var_->notify_all();
     }
 
-    void CallFunction(const std::shared_ptr<IteratorContext>& ctx,
-                      const std::shared_ptr<InvocationResult>& result)
+    void ElementCompleted(const std::shared_ptr<IteratorContext>& ctx,
+                          const std::shared_ptr<InvocationResult>& result,
+                          const Status& status, bool call_completed)
         TF_LOCKS_EXCLUDED(*mu_) {
-      tsl::profiler::TraceMe traceme([&] {
-        return tsl::profiler::TraceMeEncode("ParallelMapProduce",
-                                            {{"element_id", result->uid}});
-      });
-      // Get the next input element.
-      std::vector<Tensor> input_element;
-      result->status = input_impl_->GetNext(ctx.get(), &input_element,
-                                            &result->end_of_input);
-      result->checkpoint.Merge(ctx->checkpoint());
-      if (result->end_of_input || !result->status.ok()) {
-        CallCompleted(ctx, result);
-        return;
+      if (!status.ok()) {
+        result->status = AddErrorContext(status);
       }
+      RecordBufferEnqueue(ctx.get(), result->return_values);
+      CallCompleted(ctx, result, call_completed);
+    }
 
-      auto done = [this, ctx, result](Status status) {
-        if (!status.ok()) {
-          result->status = AddErrorContext(status);
+    // Fetches an input element for each of `results` and applies the map
+    // function to them in a single invocation task. The function is still
+    // invoked once per element, so an error only affects the element that
+    // produced it, and each result is published as soon as it is ready.
+    //
+    // `issue_nanos` is the runner thread's share of the time it took to start
+    // the task. Grouping elements amortizes it, together with the time it
+    // takes to schedule the task, so both are recorded for the model.
+    void CallFunction(const std::shared_ptr<IteratorContext>& ctx,
+                      std::vector<std::shared_ptr<InvocationResult>> results,
+                      int64_t issue_nanos) TF_LOCKS_EXCLUDED(*mu_) {
+      auto invocation = std::make_shared<Invocation>();
+      invocation->input_elements.reserve(results.size());
+      invocation->results.reserve(results.size());
+      for (size_t i = 0; i < results.size(); ++i) {
+        const std::shared_ptr<InvocationResult>& result = results[i];
+        tsl::profiler::TraceMe traceme([&] {
+          return tsl::profiler::TraceMeEncode("ParallelMapProduce",
+                                              {{"element_id", result->uid}});
+        });
+        // Get the next input element.
+        std::vector<Tensor> input_element;
+        result->status = input_impl_->GetNext(ctx.get(), &input_element,
+                                              &result->end_of_input);
+        result->checkpoint.Merge(ctx->checkpoint());
+        if (result->end_of_input || !result->status.ok()) {
+          CallCompleted(ctx, result,
+                        /*call_completed=*/i + 1 == results.size() &&
+                            invocation->results.empty());
+          continue;
         }
-        RecordBufferEnqueue(ctx.get(), result->return_values);
-        CallCompleted(ctx, result);
-      };
+        invocation->input_elements.push_back(std::move(input_element));
+        invocation->results.push_back(result);
+      }
+      if (invocation->results.empty()) {
+        return;
+      }
 
-      // Apply the map function on `input_element`, storing the result in
-      // `result->return_values`, and invoking `done` when finished.
+      // Apply the map function to the input elements, storing the results in
+      // `invocation->results`.
       if (dataset()->captured_func_->use_inter_op_parallelism()) {
-        instantiated_captured_func_->RunAsync(
-            ctx.get(), std::move(input_element), &result->return_values,
-            std::move(done), model_node());
+        if (model_node()) {
+          model_node()->record_invocation(issue_nanos);
+        }
+        RunAsync(ctx, std::move(invocation), /*index=*/0);
       } else {
         // In this case, the function will be executed using single-threaded
         // executor. We schedule it using `ctx->runner()` to enable concurrent
-        // application of the function over different input elements.
-        auto fn = std::bind(
-            [this, ctx, result](std::vector<Tensor> input_element) {
+        // application of the function over different groups of input
+        // elements.
+        const int64_t schedule_nanos = EnvTime::NowNanos();
+        (*ctx->runner())([this, ctx, invocation = std::move(invocation),
+                          issue_nanos, schedule_nanos]() {
+          if (model_node()) {
+            model_node()->record_invocation(issue_nanos + EnvTime::NowNanos() -
+                                            schedule_nanos);
+          }
+          const size_t num_elements = invocation->results.size();
+          for (size_t i = 0; i < num_elements; ++i) {
+            const std::shared_ptr<InvocationResult>& result =
+                invocation->results[i];
+            auto fn = [&]() {
               return instantiated_captured_func_->Run(
-                  ctx.get(), std::move(input_element), &result->return_values,
-                  model_node());
-            },
-            std::move(input_element));
-        (*ctx->runner())(
-            [this, ctx, fn = std::move(fn), done = std::move(done)]() {
-              Status s;
-              // Check whether we are already recording to prevent invalid
-              // nesting of `RecordStart` calls.
-              if (IsRecording(ctx.get())) {
-                s = fn();
-              } else {
-                RecordStart(ctx.get());
-                s = fn();
-                RecordStop(ctx.get());
-              }
-              done(s);
-            });
+                  ctx.get(), std::move(invocation->input_elements[i]),
+                  &result->return_values, model_node());
+            };
+            Status s;
+            // Check whether we are already recording to prevent invalid
+            // nesting of `RecordStart` calls.
+            if (IsRecording(ctx.get())) {
+              s = fn();
+            } else {
+              RecordStart(ctx.get());
+              s = fn();
+              RecordStop(ctx.get());
+            }
+            ElementCompleted(ctx, result, s,
+                             /*call_completed=*/i + 1 == num_elements);
+          }
+        });
       }
     }
 
+    // Applies the map function to the input element at `index` of
+    // `invocation` and, once it completes, to the remaining ones in order.
+    // Like in the runner task, the elements of a group run one after the
+    // other, so a group never takes more than one of the
+    // `num_parallel_calls_` slots. The model charges the latency this adds to
+    // the group size.
+    void RunAsync(const std::shared_ptr<IteratorContext>& ctx,
+                  std::shared_ptr<Invocation> invocation, size_t index)
+        TF_LOCKS_EXCLUDED(*mu_) {
+      std::shared_ptr<InvocationResult> result = invocation->results[index];
+      std::vector<Tensor> input_element =
+          std::move(invocation->input_elements[index]);
+      auto done = [this, ctx, invocation, index, result](Status status) {
+        const bool call_completed = index + 1 == invocation->results.size();
+        ElementCompleted(ctx, result, status, call_completed);
+        if (!call_completed) {
+          RunAsync(ctx, invocation, index + 1);
+        }
+      };
+      instantiated_captured_func_->RunAsync(
+          ctx.get(), std::move(input_element), &result->return_values,
+          std::move(done), model_node());
+    }
+
     Status ProcessResult(IteratorContext* ctx,
                          const std::shared_ptr<InvocationResult>& result,
                          std::vector<Tensor>* out_tensors,
@@ -609,20 +725,31 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
         TF_LOCKS_EXCLUDED(*mu_) {
       RecordStart(ctx.get());
       auto cleanup = gtl::MakeCleanup([this, ctx] { RecordStop(ctx.get()); });
-      std::vector<std::shared_ptr<InvocationResult>> new_calls;
+      std::vector<std::vector<std::shared_ptr<InvocationResult>>> new_calls;
       {
         tf_shared_lock l(*mu_);  // mu_ == num_parallel_calls_->mu
         new_calls.reserve(num_parallel_calls_->value);
       }
-      auto busy = [this]() TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) -> bool {
+      // Each call applies the function to up to `invocation_batch_size_`
+      // elements, so the buffer holds that many elements per parallel call.
+      auto buffer_limit = [this]() TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+        return static_cast<int64_t>(num_parallel_calls_->value) *
+               static_cast<int64_t>(invocation_batch_size_->value);
+      };
+      auto busy = [this, &buffer_limit]()
+                      TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) -> bool {
         int64_t num_parallel_calls = num_parallel_calls_->value;
         return num_calls_ >= num_parallel_calls ||
-               invocation_results_.size() >= num_parallel_calls;
+               invocation_results_.size() >= buffer_limit();
       };
       while (true) {
+        int64_t issue_nanos = 0;
         {
           mutex_lock l(*mu_);
           while (!cancelled_ && busy()) {
+            // Only the completion that lets the runner thread issue new calls
+            // counts, not earlier ones that left it waiting for buffer space.
+            last_call_completed_nanos_ = 0;
             RecordStop(ctx.get());
             cond_var_->wait(l);
             RecordStart(ctx.get());
@@ -630,16 +757,28 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
           if (cancelled_) {
             return;
           }
+          if (last_call_completed_nanos_ > 0) {
+            issue_nanos = EnvTime::NowNanos() - last_call_completed_nanos_;
+            last_call_completed_nanos_ = 0;
+          }
           while (!busy()) {
-            invocation_results_.push_back(
-                std::make_shared<InvocationResult>(ctx.get()));
-            new_calls.push_back(invocation_results_.back());
+            const int64_t invocation_batch_size = invocation_batch_size_->value;
+            std::vector<std::shared_ptr<InvocationResult>> call;
+            call.reserve(invocation_batch_size);
+            while (static_cast<int64_t>(call.size()) < invocation_batch_size &&
+                   invocation_results_.size() < buffer_limit()) {
+              invocation_results_.push_back(
+                  std::make_shared<InvocationResult>(ctx.get()));
+              call.push_back(invocation_results_.back());
+            }
+            new_calls.push_back(std::move(call));
             num_calls_++;
           }
           cond_var_->notify_all();
         }
-        for (const auto& call : new_calls) {
-          CallFunction(ctx, call);
+        for (auto& call : new_calls) {
+          CallFunction(ctx, std::move(call),
+                       issue_nanos / static_cast<int64_t>(new_calls.size()));
         }
         new_calls.clear();
       }
@@ -749,11 +888,17 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
     const std::shared_ptr<condition_variable> cond_var_;
     // Identifies the maximum number of parallel calls.
     const std::shared_ptr<model::SharedState> num_parallel_calls_;
+    // Identifies the number of input elements each call applies the function
+    // to.
+    const std::shared_ptr<model::SharedState> invocation_batch_size_;
     const bool deterministic_;
     const bool preserve_cardinality_;
     const bool autotune_;
     // Counts the number of outstanding calls.
     int64_t num_calls_ TF_GUARDED_BY(*mu_) = 0;
+    // When the last call completed while the runner thread was waiting, or 0.
+    // Used to measure how long it takes the runner thread to issue new calls.
+    int64_t last_call_completed_nanos_ TF_GUARDED_BY(*mu_) = 0;
     // Controls cancellation of `input_impl_`. Must be ordered before
     // `input_impl_` so that `input_impl_` is destroyed first.
     std::unique_ptr<CancellationManager> cancellation_manager_;
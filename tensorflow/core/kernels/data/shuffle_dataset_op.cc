@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/shuffle_dataset_op.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <deque>
 #include <memory>
@@ -32,6 +33,7 @@ limitations under the License.
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/data/packed_element_buffer.h"
 #include "tensorflow/core/kernels/data/random_seed_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/random/philox_random.h"
@@ -54,6 +56,8 @@ namespace data {
 /* static */ constexpr const char* const ShuffleDatasetOpBase::kOutputShapes;
 /* static */ constexpr const char* const
     ShuffleDatasetOpBase::kReshuffleEachIteration;
+/* static */ constexpr const char* const ShuffleDatasetOpBase::kBufferSizeBytes;
+/* static */ constexpr const char* const ShuffleDatasetOpBase::kCompressBuffer;
 
 /* static */ constexpr const char* const ShuffleDatasetOp::kDatasetType;
 
@@ -63,6 +67,17 @@ namespace data {
 
 const int64_t kLogIntervalMicros = 10 * 1000000;  // 10 seconds.
 const int64_t kMaxEpochsInBuffer = 3;
+// The initial number of slots of a packed shuffle buffer. The slots grow with
+// the number of buffered elements up to `buffer_size`.
+const int64_t kMinPackedBufferSlots = 1024;
+
+// Keeps the snapshot of the buffer written by non-symbolic checkpoints
+// between saves, so that each save only copies the slots changed since the
+// previous one. The snapshot holds on to elements that have already left the
+// buffer (or, for a packed buffer, a second copy of it), so this can double
+// the memory used by the shuffle buffer.
+constexpr char kIncrementalShuffleCheckpoint[] =
+    "incremental_shuffle_checkpoint";
 
 constexpr char kNumRandomSamples[] = "num_random_samples";
 constexpr char kDataProduced[] = "data_produced";
@@ -82,7 +97,14 @@ constexpr char kShuffleAndRepeatDatasetV1[] = "ShuffleAndRepeatDataset";
 constexpr char kShuffleAndRepeatDatasetV2[] = "ShuffleAndRepeatDatasetV2";
 
 ShuffleDatasetOpBase::ShuffleDatasetOpBase(OpKernelConstruction* ctx)
-    : UnaryDatasetOpKernel(ctx) {}
+    : UnaryDatasetOpKernel(ctx) {
+  if (ctx->HasAttr(kBufferSizeBytes)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kBufferSizeBytes, &buffer_size_bytes_));
+  }
+  if (ctx->HasAttr(kCompressBuffer)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kCompressBuffer, &compress_buffer_));
+  }
+}
 
 // Abstract base dataset that implements a shuffling iterator.
 class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
@@ -90,16 +112,28 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
   ShuffleDatasetBase(OpKernelContext* ctx, const DatasetBase* input,
                      int64_t buffer_size,
                      std::shared_ptr<SeedGenerator> seed_generator,
-                     int64_t count)
+                     int64_t count, int64_t buffer_size_bytes = 0,
+                     bool compress_buffer = false)
       : DatasetBase(DatasetContext(ctx)),
         input_(input),
         buffer_size_(buffer_size),
         seed_generator_(std::move(seed_generator)),
         count_(count),
+        buffer_size_bytes_(buffer_size_bytes),
+        compress_buffer_(compress_buffer),
+        use_packed_buffer_(
+            buffer_size_bytes > 0 &&
+            PackedElementBuffer::CanPack(input->output_dtypes())),
         traceme_metadata_(
             {{"buffer_size",
               strings::Printf("%lld", static_cast<long long>(buffer_size))}}) {
     input_->Ref();
+    if (buffer_size_bytes > 0 && !use_packed_buffer_) {
+      LOG(WARNING) << "Ignoring `buffer_size_bytes` for a shuffle buffer with "
+                   << "element types "
+                   << DataTypeVectorString(input_->output_dtypes())
+                   << ": only numeric and string elements can be packed.";
+    }
   }
 
   ~ShuffleDatasetBase() override { input_->Unref(); }
@@ -188,10 +222,19 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
    public:
     explicit Iterator(const Params& params, SeedGenerator* seed_generator)
         : DatasetIterator<ShuffleDatasetBase>(params),
+          incremental_checkpoint_(
+              GetExperiments().contains(kIncrementalShuffleCheckpoint)),
           seed_generator_(seed_generator),
           parent_generator_(seed_generator->seed(), seed_generator->seed2()),
           generator_(&parent_generator_) {
-      if (params.dataset->buffer_size_ == kUnknownCardinality) {
+      if (params.dataset->use_packed_buffer_) {
+        buffer_ = std::make_unique<std::vector<std::vector<Tensor>>>();
+        packed_buffer_ = NewPackedBuffer();
+        if (params.dataset->buffer_size_ != kUnknownCardinality) {
+          packed_buffer_->Resize(std::min(params.dataset->buffer_size_,
+                                          kMinPackedBufferSlots));
+        }
+      } else if (params.dataset->buffer_size_ == kUnknownCardinality) {
         buffer_ = std::make_unique<std::vector<std::vector<Tensor>>>();
       } else {
         buffer_ = std::make_unique<std::vector<std::vector<Tensor>>>(
@@ -207,7 +250,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       ResetRngs();
       // Initialize checkpoint_indices_ to the entire buffer.
       if (ctx->symbolic_checkpoint()) {
-        for (int64_t i = 0; i < buffer_->size(); ++i) {
+        for (int64_t i = 0; i < BufferSize(); ++i) {
           checkpoint_indices_.insert(i);
         }
       }
@@ -232,13 +275,18 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       // slice, and then remove the element from the slice.
       int64_t offset =
           Random() % (slices_.front()->end - slices_.front()->start);
-      int64_t index = (slices_.front()->start + offset) % buffer_->size();
-      *out_tensors = std::move(buffer_->at(index));
+      int64_t index = (slices_.front()->start + offset) % BufferSize();
+      int64_t front = slices_.front()->start % BufferSize();
+      if (packed_buffer_) {
+        TF_RETURN_IF_ERROR(packed_buffer_->Take(index, out_tensors));
+        packed_buffer_->Swap(index, front);
+      } else {
+        *out_tensors = std::move(buffer_->at(index));
+        std::swap(buffer_->at(index), buffer_->at(front));
+      }
       this->RecordBufferDequeue(ctx, *out_tensors);
-      std::swap(buffer_->at(index),
-                buffer_->at(slices_.front()->start % buffer_->size()));
       checkpoint_indices_.insert(index);
-      checkpoint_indices_.insert(slices_.front()->start % buffer_->size());
+      checkpoint_indices_.insert(front);
       slices_.front()->start++;
       num_elements_--;
       return absl::OkStatus();
@@ -261,7 +309,43 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
 
     Status SaveInternal(SerializationContext* ctx,
                         IteratorStateWriter* writer) override {
-      mutex_lock l(mu_);
+      mutex_lock save_l(save_mu_);
+      {
+        mutex_lock l(mu_);
+        TF_RETURN_IF_ERROR(SaveStateLocked(ctx, writer));
+        if (ctx->symbolic_checkpoint()) {
+          return absl::OkStatus();
+        }
+        UpdateSavedBuffer();
+      }
+      // The snapshot is written out without holding `mu_`, so that the
+      // iterator can keep producing elements while a large buffer is saved.
+      const std::string key_prefix = absl::StrCat(prefix(), kColon, "buffer");
+      Status s;
+      if (saved_packed_buffer_) {
+        PackedElementBuffer* saved_buffer = saved_packed_buffer_.get();
+        s = WriteElementsToCheckpoint(
+            writer, key_prefix, saved_buffer->size(),
+            [saved_buffer](int64_t index, std::vector<Tensor>* element) {
+              return saved_buffer->Get(index, element);
+            });
+      } else {
+        s = WriteElementsToCheckpoint(writer, key_prefix, *saved_buffer_);
+      }
+      if (!incremental_checkpoint_) {
+        // Releases the elements only referenced by the snapshot, at the cost
+        // of copying the whole buffer again in the next save.
+        saved_buffer_.reset();
+        saved_packed_buffer_.reset();
+      }
+      return s;
+    }
+
+    // Saves the iterator state, except for the elements of the buffer if
+    // symbolic checkpointing is disabled.
+    Status SaveStateLocked(SerializationContext* ctx,
+                           IteratorStateWriter* writer)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       // Save state needed to restore the random number generators.
       TF_RETURN_IF_ERROR(
           writer->WriteScalar(prefix(), kEpochNumRandomSamples,
@@ -283,18 +367,25 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kEpoch, epoch_));
       TF_RETURN_IF_ERROR(
           writer->WriteScalar(prefix(), kNumElements, num_elements_));
+      // When symbolic checkpointing is turned on, `writer` already contains
+      // checkpoint of the shuffle buffer created by the previous invocation of
+      // this instance and the indices that need to be updated are stored in
+      // `checkpoint_indices`. Otherwise the buffer is written by the caller.
       const std::string key_prefix = absl::StrCat(prefix(), kColon, "buffer");
-      if (ctx->symbolic_checkpoint()) {
-        // When symbolic checkpointing is turned on, `writer`
-        // already contains checkpoint of the shuffle buffer created by the
-        // previous invocation of this instance and the indices that need to be
-        // updated are stored in `checkpoint_indices`.
+      if (ctx->symbolic_checkpoint() && packed_buffer_) {
+        // Packed elements are unpacked one at a time, so that checkpointing
+        // does not materialize the whole buffer.
+        PackedElementBuffer* packed_buffer = packed_buffer_.get();
+        TF_RETURN_IF_ERROR(UpdateCheckpointElements(
+            writer, key_prefix, BufferSize(), checkpoint_indices_,
+            [packed_buffer](int64_t index, std::vector<Tensor>* element) {
+              return packed_buffer->Get(index, element);
+            }));
+        checkpoint_indices_.clear();
+      } else if (ctx->symbolic_checkpoint()) {
         TF_RETURN_IF_ERROR(UpdateCheckpointElements(
             writer, key_prefix, *buffer_, checkpoint_indices_));
         checkpoint_indices_.clear();
-      } else {
-        TF_RETURN_IF_ERROR(
-            WriteElementsToCheckpoint(writer, key_prefix, *buffer_));
       }
 
       TF_RETURN_IF_ERROR(
@@ -321,6 +412,9 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
 
     Status RestoreInternal(IteratorContext* ctx,
                            IteratorStateReader* reader) override {
+      mutex_lock save_l(save_mu_);
+      saved_buffer_.reset();
+      saved_packed_buffer_.reset();
       mutex_lock l(mu_);
       // Restore the random number generators.
       int64_t num_random_samples;
@@ -358,21 +452,39 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         slices_size = static_cast<size_t>(temp);
       }
       buffer_ = std::make_unique<std::vector<std::vector<Tensor>>>();
-      TF_RETURN_IF_ERROR(ReadElementsFromCheckpoint(
-          ctx, reader, absl::StrCat(prefix(), kColon, "buffer"),
-          buffer_.get()));
+      if (packed_buffer_) {
+        // The packed buffer keeps the number of slots it was checkpointed
+        // with, since the positions of the slices depend on it.
+        packed_buffer_ = NewPackedBuffer();
+        PackedElementBuffer* packed_buffer = packed_buffer_.get();
+        TF_RETURN_IF_ERROR(ReadElementsFromCheckpoint(
+            ctx, reader, absl::StrCat(prefix(), kColon, "buffer"),
+            [this, ctx, packed_buffer](std::vector<Tensor> element) {
+              RecordBufferEnqueue(ctx, element);
+              const int64_t index = packed_buffer->size();
+              packed_buffer->Resize(index + 1);
+              if (element.empty()) {
+                return absl::OkStatus();
+              }
+              return packed_buffer->Put(index, element);
+            }));
+      } else {
+        TF_RETURN_IF_ERROR(ReadElementsFromCheckpoint(
+            ctx, reader, absl::StrCat(prefix(), kColon, "buffer"),
+            buffer_.get()));
+        for (const auto& element : *buffer_) {
+          RecordBufferEnqueue(ctx, element);
+        }
+        if (!IsShuffleAll()) {
+          buffer_->resize(dataset()->buffer_size_);
+        }
+      }
       if (ctx->symbolic_checkpoint()) {
         DCHECK(checkpoint_indices_.empty());
-        for (size_t i = 0; i < buffer_->size(); ++i) {
+        for (size_t i = 0; i < BufferSize(); ++i) {
           checkpoint_indices_.insert(i);
         }
       }
-      for (const auto& element : *buffer_) {
-        RecordBufferEnqueue(ctx, element);
-      }
-      if (!IsShuffleAll()) {
-        buffer_->resize(dataset()->buffer_size_);
-      }
       slices_.clear();
       for (size_t i = 0; i < slices_size; ++i) {
         int64_t start;
@@ -439,6 +551,80 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       return dataset()->buffer_size_ == kUnknownCardinality;
     }
 
+    // Brings the snapshot of the buffer written by non-symbolic checkpoints up
+    // to date. If the snapshot was kept since the previous save, only the
+    // slots changed since then are copied, so the time spent holding `mu_`
+    // does not grow with the size of the buffer.
+    void UpdateSavedBuffer() TF_EXCLUSIVE_LOCKS_REQUIRED(save_mu_, mu_) {
+      const int64_t size = BufferSize();
+      bool copy_all = false;
+      if (packed_buffer_) {
+        if (!saved_packed_buffer_) {
+          saved_packed_buffer_ = NewPackedBuffer();
+          copy_all = true;
+        }
+        // The packed buffer only changes size when it grows, which marks
+        // every slot as changed.
+        copy_all |= saved_packed_buffer_->size() != size;
+        saved_packed_buffer_->Resize(size);
+      } else {
+        if (!saved_buffer_) {
+          saved_buffer_ = std::make_unique<std::vector<std::vector<Tensor>>>();
+          copy_all = true;
+        }
+        saved_buffer_->resize(size);
+      }
+      if (copy_all) {
+        for (int64_t i = 0; i < size; ++i) {
+          CopyToSavedBuffer(i);
+        }
+      } else {
+        for (int64_t i : checkpoint_indices_) {
+          if (i < size) {
+            CopyToSavedBuffer(i);
+          }
+        }
+      }
+      checkpoint_indices_.clear();
+    }
+
+    void CopyToSavedBuffer(int64_t index)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(save_mu_, mu_) {
+      if (packed_buffer_) {
+        saved_packed_buffer_->CopyFrom(*packed_buffer_, index, index);
+      } else {
+        (*saved_buffer_)[index] = (*buffer_)[index];
+      }
+    }
+
+    std::unique_ptr<PackedElementBuffer> NewPackedBuffer() {
+      PackedElementBuffer::Options options;
+      options.compress = dataset()->compress_buffer_;
+      return std::make_unique<PackedElementBuffer>(dataset()->output_dtypes(),
+                                                   options);
+    }
+
+    // Returns the number of slots in the shuffle buffer.
+    int64_t BufferSize() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return packed_buffer_ ? packed_buffer_->size() : buffer_->size();
+    }
+
+    // Doubles the number of slots of a full packed buffer, up to
+    // `buffer_size`.
+    void GrowPackedBuffer() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const int64_t size = packed_buffer_->size();
+      DCHECK_LT(size, dataset()->buffer_size_);
+      const int64_t new_size = std::min(dataset()->buffer_size_,
+                                        std::max(2 * size, int64_t{1}));
+      const int64_t begin = slices_.empty() ? 0 : slices_.front()->start;
+      const int64_t end = slices_.empty() ? 0 : slices_.back()->end;
+      packed_buffer_->GrowRing(new_size, begin, end);
+      // Every slot may have moved.
+      for (int64_t i = 0; i < new_size; ++i) {
+        checkpoint_indices_.insert(i);
+      }
+    }
+
     // Fills the shuffle buffer, preparing the buffer for sampling.
     Status FillBuffer(IteratorContext* ctx) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       int64_t start_micros = EnvTime::NowMicros();
@@ -463,7 +649,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
           slices_.back()->reached_end_of_sequence = true;
         }
         if (!end_of_input_sequence) {
-          AddToShuffleBuffer(ctx, std::move(input_element));
+          TF_RETURN_IF_ERROR(AddToShuffleBuffer(ctx, std::move(input_element)));
           continue;
         }
         input_impl_.reset();
@@ -500,7 +686,15 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         // we need to add to the buffer.
         return true;
       }
-      return num_elements_ < buffer_->size();
+      if (packed_buffer_ && !IsShuffleAll()) {
+        // At least one element is buffered even if it exceeds the budget.
+        if (num_elements_ > 0 &&
+            packed_buffer_->packed_bytes() >= dataset()->buffer_size_bytes_) {
+          return false;
+        }
+        return num_elements_ < dataset()->buffer_size_;
+      }
+      return num_elements_ < BufferSize();
     }
 
     Status PrepareNextEpoch(IteratorContext* ctx)
@@ -520,7 +714,8 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       return absl::OkStatus();
     }
 
-    void AddToShuffleBuffer(IteratorContext* ctx, std::vector<Tensor>&& element)
+    Status AddToShuffleBuffer(IteratorContext* ctx,
+                              std::vector<Tensor>&& element)
         TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       data_produced_ = true;
       if (num_elements_ == 0) {
@@ -528,7 +723,20 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
                 << BufferSizeString();
       }
       this->RecordBufferEnqueue(ctx, element);
-      if (num_elements_ == buffer_->size()) {
+      if (packed_buffer_) {
+        int64_t index;
+        if (num_elements_ == packed_buffer_->size() && IsShuffleAll()) {
+          index = packed_buffer_->size();
+          packed_buffer_->Resize(index + 1);
+        } else {
+          if (num_elements_ == packed_buffer_->size()) {
+            GrowPackedBuffer();
+          }
+          index = slices_.back()->end % packed_buffer_->size();
+        }
+        checkpoint_indices_.insert(index);
+        TF_RETURN_IF_ERROR(packed_buffer_->Put(index, element));
+      } else if (num_elements_ == buffer_->size()) {
         DCHECK(IsShuffleAll());
         checkpoint_indices_.insert(buffer_->size());
         buffer_->push_back(element);
@@ -539,6 +747,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       }
       num_elements_++;
       slices_.back()->end++;
+      return absl::OkStatus();
     }
 
     void ClearEmptySlices() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
@@ -553,16 +762,35 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     }
 
     std::string BufferSizeString() {
+      if (dataset()->use_packed_buffer_) {
+        return absl::StrCat(dataset()->buffer_size_, " (at most ",
+                            dataset()->buffer_size_bytes_, " bytes)");
+      }
       return absl::StrCat(dataset()->buffer_size_);
     }
 
+    // Whether the `incremental_shuffle_checkpoint` experiment is enabled.
+    const bool incremental_checkpoint_;
+    // Serializes saves, which write the buffer out after releasing `mu_`.
+    mutex save_mu_ TF_ACQUIRED_BEFORE(mu_);
     mutex mu_;
+    // The buffer as of the last non-symbolic save. It only outlives the save
+    // if `incremental_checkpoint_` is true, in which case the next save only
+    // copies the slots in `checkpoint_indices_`.
+    std::unique_ptr<std::vector<std::vector<Tensor>>> saved_buffer_
+        TF_GUARDED_BY(save_mu_);
+    // Replaces `saved_buffer_` when the packed buffer is used.
+    std::unique_ptr<PackedElementBuffer> saved_packed_buffer_
+        TF_GUARDED_BY(save_mu_);
     SeedGenerator* const seed_generator_ TF_GUARDED_BY(mu_);  // Not owned.
     std::unique_ptr<std::vector<std::vector<Tensor>>> buffer_
         TF_GUARDED_BY(mu_);
+    // Replaces `buffer_` when `buffer_size_bytes` is set.
+    std::unique_ptr<PackedElementBuffer> packed_buffer_ TF_GUARDED_BY(mu_);
     // Holds the indices of `buffer_` that have changed since the previous
     // `SaveInternal()` and need to be updated in the MemoryCheckpoint
-    // (if symbolic checkpointing is used) in the next `SaveInternal()`.
+    // (if symbolic checkpointing is used) or in the saved buffer in the next
+    // `SaveInternal()`.
     absl::flat_hash_set<int64_t> checkpoint_indices_ TF_GUARDED_BY(mu_);
     std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_) = nullptr;
     int64_t epoch_ TF_GUARDED_BY(mu_) = 0;
@@ -588,6 +816,9 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
   // fuse shuffle and repeat together, and make the shuffle dataset op
   // responsible for repeating as well.
   const int64_t count_;
+  const int64_t buffer_size_bytes_;
+  const bool compress_buffer_;
+  const bool use_packed_buffer_;
   const TraceMeMetadata traceme_metadata_;
   mutable mutex mu_;
   mutable std::vector<std::int64_t> shuffled_indices_ TF_GUARDED_BY(mu_);
@@ -713,8 +944,10 @@ class ShuffleDatasetOp::DatasetV3 : public ShuffleDatasetBase {
  public:
   DatasetV3(OpKernelContext* ctx, const DatasetBase* input, int64_t buffer_size,
             int64_t count, RandomSeeds&& seeds, SeedGeneratorManager* manager,
-            ResourceHandle&& resource_handle, bool owns_resource)
-      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count),
+            ResourceHandle&& resource_handle, bool owns_resource,
+            int64_t buffer_size_bytes, bool compress_buffer)
+      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count,
+                           buffer_size_bytes, compress_buffer),
         manager_(manager),
         owns_resource_(owns_resource),
         resource_handle_(std::move(resource_handle)),
@@ -753,12 +986,18 @@ class ShuffleDatasetOp::DatasetV3 : public ShuffleDatasetBase {
     AttrValue reshuffle_each_iteration;
     b->BuildAttrValue(seed_generator_->reshuffle_each_iteration(),
                       &reshuffle_each_iteration);
+    AttrValue buffer_size_bytes;
+    b->BuildAttrValue(buffer_size_bytes_, &buffer_size_bytes);
+    AttrValue compress_buffer;
+    b->BuildAttrValue(compress_buffer_, &compress_buffer);
     TF_RETURN_IF_ERROR(
         b->AddDataset(this,
                       {input_graph_node, buffer_size_node, seed_node,
                        seed2_node, resource_handle_node},  // Inputs
                       {std::make_pair(kReshuffleEachIteration,
-                                      reshuffle_each_iteration)},  // Attrs
+                                      reshuffle_each_iteration),
+                       std::make_pair(kBufferSizeBytes, buffer_size_bytes),
+                       std::make_pair(kCompressBuffer, compress_buffer)},
                       output));
     return absl::OkStatus();
   }
@@ -836,9 +1075,9 @@ void ShuffleDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
     }
 
     // Ownership of manager is transferred onto `DatasetV3`.
-    *output = new ShuffleDatasetOp::DatasetV3(ctx, input, buffer_size, count,
-                                              std::move(seeds), manager,
-                                              std::move(handle), owns_resource);
+    *output = new ShuffleDatasetOp::DatasetV3(
+        ctx, input, buffer_size, count, std::move(seeds), manager,
+        std::move(handle), owns_resource, buffer_size_bytes_, compress_buffer_);
   } else if (op_version_ == 2) {
     auto handle = HandleFromInput(ctx, 2);
     SeedGeneratorManager* manager = nullptr;
@@ -963,8 +1202,10 @@ class ShuffleAndRepeatDatasetOp::DatasetV2 : public ShuffleDatasetBase {
  public:
   DatasetV2(OpKernelContext* ctx, const DatasetBase* input, int64_t buffer_size,
             int64_t count, RandomSeeds&& seeds, SeedGeneratorManager* manager,
-            ResourceHandle&& resource_handle, bool owns_resource)
-      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count),
+            ResourceHandle&& resource_handle, bool owns_resource,
+            int64_t buffer_size_bytes, bool compress_buffer)
+      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count,
+                           buffer_size_bytes, compress_buffer),
         manager_(manager),
         owns_resource_(owns_resource),
         resource_handle_(std::move(resource_handle)),
@@ -1005,12 +1246,18 @@ class ShuffleAndRepeatDatasetOp::DatasetV2 : public ShuffleDatasetBase {
     AttrValue reshuffle_each_iteration;
     b->BuildAttrValue(seed_generator_->reshuffle_each_iteration(),
                       &reshuffle_each_iteration);
+    AttrValue buffer_size_bytes;
+    b->BuildAttrValue(buffer_size_bytes_, &buffer_size_bytes);
+    AttrValue compress_buffer;
+    b->BuildAttrValue(compress_buffer_, &compress_buffer);
     TF_RETURN_IF_ERROR(
         b->AddDataset(this,
                       {input_graph_node, buffer_size_node, seed_node,
                        seed2_node, count_node, resource_handle_node},  // Inputs
                       {std::make_pair(kReshuffleEachIteration,
-                                      reshuffle_each_iteration)},  // Attrs
+                                      reshuffle_each_iteration),
+                       std::make_pair(kBufferSizeBytes, buffer_size_bytes),
+                       std::make_pair(kCompressBuffer, compress_buffer)},
                       output));
     return absl::OkStatus();
   }
@@ -1098,7 +1345,7 @@ void ShuffleAndRepeatDatasetOp::MakeDataset(OpKernelContext* ctx,
     // Ownership of manager is transferred onto `DatasetV2`.
     *output = new ShuffleAndRepeatDatasetOp::DatasetV2(
         ctx, input, buffer_size, count, std::move(seeds), manager,
-        std::move(handle), owns_resource);
+        std::move(handle), owns_resource, buffer_size_bytes_, compress_buffer_);
   } else {
     if (op_version_ != 1) {
       LOG(WARNING) << "Unsupported version of shuffle dataset op: "
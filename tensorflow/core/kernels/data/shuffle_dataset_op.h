@@ -15,6 +15,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_DATA_SHUFFLE_DATASET_OP_H_
 #define TENSORFLOW_CORE_KERNELS_DATA_SHUFFLE_DATASET_OP_H_
 
+#include <cstdint>
+
 #include "tensorflow/core/framework/dataset.h"
 
 namespace tensorflow {
@@ -30,11 +32,19 @@ class ShuffleDatasetOpBase : public UnaryDatasetOpKernel {
   static constexpr const char* const kOutputShapes = "output_shapes";
   static constexpr const char* const kReshuffleEachIteration =
       "reshuffle_each_iteration";
+  static constexpr const char* const kBufferSizeBytes = "buffer_size_bytes";
+  static constexpr const char* const kCompressBuffer = "compress_buffer";
 
   explicit ShuffleDatasetOpBase(OpKernelConstruction* ctx);
 
  protected:
   class ShuffleDatasetBase;
+
+  // If positive, the shuffle buffer packs its elements into arena chunks and
+  // stops filling once they take up this many bytes.
+  int64_t buffer_size_bytes_ = 0;
+  // Whether packed elements are compressed.
+  bool compress_buffer_ = false;
 };
 
 class ShuffleDatasetOp : public ShuffleDatasetOpBase {
@@ -11,8 +11,11 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/shuffle_dataset_op.h"
 
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/core/data/dataset_test_base.h"
 #include "tensorflow/core/data/dataset_utils.h"
@@ -583,6 +586,91 @@ INSTANTIATE_TEST_CASE_P(ShuffleDatasetOpTest,
                         ParameterizedIteratorSaveAndRestoreTest,
                         ::testing::ValuesIn(IteratorSaveAndRestoreTestCases()));
 
+TEST_F(ShuffleDatasetOpTest, RepeatedSavesOfSameIterator) {
+  // With the experiment, every save after the first only updates the slots
+  // changed since the previous one, so restoring from each of them checks the
+  // chain of deltas.
+  setenv("TF_JOB_NAME", "test_job", /*overwrite=*/1);
+  setenv("TF_TASK_ID", "0", /*overwrite=*/1);
+  setenv("TF_DATA_EXPERIMENT_OPT_IN", "incremental_shuffle_checkpoint",
+         /*overwrite=*/1);
+  ASSERT_TRUE(GetExperiments().contains("incremental_shuffle_checkpoint"));
+  auto dataset_params = ShuffleDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::vector<Tensor> expected_outputs = CreateTensors<int64_t>(
+      TensorShape({}), {{2}, {3}, {0}, {5}, {6}, {4}, {7}, {8}, {9}, {1}});
+  const int num_outputs = expected_outputs.size();
+
+  std::unique_ptr<SerializationContext> serialization_ctx;
+  TF_ASSERT_OK(CreateSerializationContext(&serialization_ctx));
+  auto save_and_restore = [&](IteratorBase* iterator,
+                              std::unique_ptr<IteratorBase>* restored)
+      -> Status {
+    VariantTensorDataWriter writer;
+    TF_RETURN_IF_ERROR(iterator->Save(serialization_ctx.get(), &writer));
+    std::vector<const VariantTensorData*> data;
+    writer.GetData(&data);
+    VariantTensorDataReader reader(data);
+    return RestoreIterator(iterator_ctx_.get(), &reader,
+                           dataset_params.iterator_prefix(), *dataset_,
+                           restored);
+  };
+  auto get_remaining = [&](IteratorBase* iterator,
+                           std::vector<Tensor>* outputs) -> Status {
+    bool end_of_sequence = false;
+    while (!end_of_sequence) {
+      std::vector<Tensor> next;
+      TF_RETURN_IF_ERROR(
+          iterator->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+      outputs->insert(outputs->end(), next.begin(), next.end());
+    }
+    return absl::OkStatus();
+  };
+  auto expected_from = [&](int index) {
+    return std::vector<Tensor>(expected_outputs.begin() + index,
+                               expected_outputs.end());
+  };
+
+  for (int i = 0; i <= num_outputs; ++i) {
+    std::unique_ptr<IteratorBase> restored_iterator;
+    TF_ASSERT_OK(save_and_restore(iterator_.get(), &restored_iterator));
+
+    if (i < num_outputs) {
+      // Another save/restore cycle on the restored iterator, whose first save
+      // is a full snapshot and its next one a delta on top of it.
+      std::unique_ptr<IteratorBase> unused;
+      TF_ASSERT_OK(save_and_restore(restored_iterator.get(), &unused));
+      std::vector<Tensor> next;
+      bool end_of_sequence = false;
+      TF_ASSERT_OK(restored_iterator->GetNext(iterator_ctx_.get(), &next,
+                                              &end_of_sequence));
+      TF_EXPECT_OK(ExpectEqual(next, {expected_outputs[i]},
+                               /*compare_order=*/true));
+      std::unique_ptr<IteratorBase> twice_restored_iterator;
+      TF_ASSERT_OK(save_and_restore(restored_iterator.get(),
+                                    &twice_restored_iterator));
+      std::vector<Tensor> twice_restored_outputs;
+      TF_ASSERT_OK(get_remaining(twice_restored_iterator.get(),
+                                 &twice_restored_outputs));
+      TF_EXPECT_OK(ExpectEqual(twice_restored_outputs, expected_from(i + 1),
+                               /*compare_order=*/true));
+    }
+    std::vector<Tensor> restored_outputs;
+    TF_ASSERT_OK(get_remaining(restored_iterator.get(), &restored_outputs));
+    TF_EXPECT_OK(ExpectEqual(restored_outputs,
+                             expected_from(std::min(i + 1, num_outputs)),
+                             /*compare_order=*/true));
+
+    std::vector<Tensor> next;
+    bool end_of_sequence = false;
+    TF_ASSERT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+  }
+  unsetenv("TF_JOB_NAME");
+  unsetenv("TF_TASK_ID");
+  unsetenv("TF_DATA_EXPERIMENT_OPT_IN");
+}
+
 TEST_F(ShuffleDatasetOpTest, InvalidArguments) {
   std::vector<ShuffleDatasetParams> dataset_params_vec(
       {ShuffleDatasetParamsWithInvalidBufferSize(),
@@ -0,0 +1,378 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/spilling_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/lib/hash/crc32c.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/strcat.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/protobuf/snapshot.pb.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr char kSpillFilePrefix[] = "tf_data_cache_";
+constexpr char kSpillFileSuffix[] = ".spill";
+constexpr int kNumPrefetchThreads = 4;
+
+absl::Status CreateSpillFilename(Env* env, std::string directory,
+                                 std::string* filename) {
+  static std::atomic<int64_t> file_counter(0);
+  if (directory.empty()) {
+    std::vector<string> temp_dirs;
+    env->GetLocalTempDirectories(&temp_dirs);
+    for (const string& dir : temp_dirs) {
+      if (env->IsDirectory(dir).ok()) {
+        directory = dir;
+        break;
+      }
+    }
+    if (directory.empty()) {
+      return errors::FailedPrecondition(
+          "Could not find a local temporary directory to spill the tf.data "
+          "cache to. Please set `spill_directory`.");
+    }
+  }
+  TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(directory));
+  *filename = io::JoinPath(
+      directory, strings::StrCat(kSpillFilePrefix, file_counter.fetch_add(1),
+                                 "_"));
+  if (!env->CreateUniqueFileName(filename, kSpillFileSuffix)) {
+    return errors::Internal("Failed to create a unique spill file name in ",
+                            directory);
+  }
+  return absl::OkStatus();
+}
+
+// Reads a `SnapshotRecord` written by `SpillingCache::WriteSpills` with a
+// single positional read.
+absl::Status ReadElement(RandomAccessFile* reader, int64_t offset,
+                         int64_t length, uint32 crc,
+                         std::vector<Tensor>* element) {
+  std::string buffer(length, '\0');
+  StringPiece result;
+  TF_RETURN_IF_ERROR(reader->Read(offset, length, &result, buffer.data()));
+  if (crc32c::Value(result.data(), result.size()) != crc) {
+    return errors::DataLoss("Checksum mismatch for the element at offset ",
+                            offset, " of the tf.data cache spill file.");
+  }
+  experimental::SnapshotRecord record;
+  if (!record.ParseFromArray(result.data(), result.size())) {
+    return errors::DataLoss("Failed to parse the element at offset ", offset,
+                            " of the tf.data cache spill file.");
+  }
+  element->reserve(record.tensor_size());
+  for (const TensorProto& proto : record.tensor()) {
+    Tensor tensor;
+    if (!tensor.FromProto(proto)) {
+      return errors::DataLoss("Failed to parse a tensor of the element at "
+                              "offset ",
+                              offset, " of the tf.data cache spill file.");
+    }
+    element->push_back(std::move(tensor));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+SpillingCache::SpillingCache(Env* env, const Options& options)
+    : env_(env),
+      options_(options),
+      thread_pool_(std::make_unique<thread::ThreadPool>(
+          env, ThreadOptions(), "tf_data_spilling_cache", kNumPrefetchThreads,
+          /*low_latency_hint=*/false)) {}
+
+SpillingCache::~SpillingCache() {
+  // Waits for outstanding prefetches.
+  thread_pool_.reset();
+  mutex_lock write_lock(write_mu_);
+  mutex_lock l(mu_);
+  spill_reader_.reset();
+  if (spill_file_) {
+    spill_file_->Close().IgnoreError();
+    spill_file_.reset();
+  }
+  if (!spill_filename_.empty()) {
+    absl::Status s = env_->DeleteFile(spill_filename_);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to delete tf.data cache spill file "
+                   << spill_filename_ << ": " << s;
+    }
+  }
+}
+
+absl::Status SpillingCache::Append(std::vector<Tensor> element) {
+  std::vector<PendingSpill> spills;
+  {
+    mutex_lock l(mu_);
+    const int64_t index = entries_.size();
+    entries_.emplace_back();
+    Entry& entry = entries_.back();
+    for (const Tensor& tensor : element) {
+      entry.bytes += tensor.TotalBytes();
+    }
+    entry.element = std::move(element);
+    lru_.push_front(index);
+    entry.lru_position = lru_.begin();
+    stats_.memory_bytes += entry.bytes;
+    SelectVictims(/*pinned=*/-1, &spills);
+  }
+  return Spill(std::move(spills));
+}
+
+absl::Status SpillingCache::Get(int64_t index,
+                                std::vector<Tensor>* out_tensors) {
+  {
+    mutex_lock l(mu_);
+    if (index < 0 || index >= static_cast<int64_t>(entries_.size())) {
+      return errors::OutOfRange("Index ", index, " out of range [0, ",
+                                entries_.size(), ")");
+    }
+    bool hit = true;
+    while (entries_[index].loading) {
+      hit = false;
+      cond_var_.wait(l);
+    }
+    Entry& entry = entries_[index];
+    if (entry.in_memory) {
+      out_tensors->insert(out_tensors->end(), entry.element.begin(),
+                          entry.element.end());
+      Touch(index);
+      if (hit) {
+        ++stats_.hits;
+      } else {
+        ++stats_.misses;
+      }
+      metrics::RecordTFDataCacheQuery(hit);
+      return absl::OkStatus();
+    }
+    entry.loading = true;
+    ++stats_.misses;
+    metrics::RecordTFDataCacheQuery(/*cache_hit=*/false);
+    Prefetch(index);
+  }
+  return Load(index, out_tensors);
+}
+
+size_t SpillingCache::size() {
+  tf_shared_lock l(mu_);
+  return entries_.size();
+}
+
+SpillingCache::Stats SpillingCache::stats() {
+  tf_shared_lock l(mu_);
+  return stats_;
+}
+
+void SpillingCache::Touch(int64_t index) {
+  Entry& entry = entries_[index];
+  if (entry.evicting) {
+    // Keeps the element in memory once it has been written.
+    entry.evicting = false;
+    evicting_bytes_ -= entry.bytes;
+    lru_.push_front(index);
+    entry.lru_position = lru_.begin();
+    return;
+  }
+  lru_.splice(lru_.begin(), lru_, entry.lru_position);
+}
+
+void SpillingCache::SelectVictims(int64_t pinned,
+                                  std::vector<PendingSpill>* spills) {
+  while (stats_.memory_bytes - evicting_bytes_ > options_.memory_budget_bytes &&
+         !lru_.empty() && lru_.back() != pinned) {
+    const int64_t victim = lru_.back();
+    lru_.pop_back();
+    Entry& entry = entries_[victim];
+    if (entry.offset >= 0) {
+      Drop(victim);
+      continue;
+    }
+    entry.evicting = true;
+    evicting_bytes_ += entry.bytes;
+    // Copying the element only copies references to the tensor buffers.
+    spills->push_back({victim, entry.element});
+  }
+}
+
+void SpillingCache::Drop(int64_t index) {
+  Entry& entry = entries_[index];
+  entry.element.clear();
+  entry.in_memory = false;
+  stats_.memory_bytes -= entry.bytes;
+}
+
+absl::Status SpillingCache::Spill(std::vector<PendingSpill> spills) {
+  if (spills.empty()) {
+    return absl::OkStatus();
+  }
+  std::vector<SpillLocation> locations;
+  const absl::Status status = WriteSpills(spills, &locations);
+
+  mutex_lock l(mu_);
+  for (size_t i = 0; i < spills.size(); ++i) {
+    const int64_t index = spills[i].index;
+    Entry& entry = entries_[index];
+    if (status.ok()) {
+      entry.offset = locations[i].offset;
+      entry.length = locations[i].length;
+      entry.crc = locations[i].crc;
+      stats_.spilled_bytes += entry.length;
+    }
+    if (!entry.evicting) {
+      // The element was looked up while it was written.
+      continue;
+    }
+    entry.evicting = false;
+    evicting_bytes_ -= entry.bytes;
+    if (status.ok()) {
+      Drop(index);
+    } else {
+      // Keeps the element so that a later eviction retries the write.
+      lru_.push_back(index);
+      entry.lru_position = std::prev(lru_.end());
+    }
+  }
+  return status;
+}
+
+absl::Status SpillingCache::WriteSpills(
+    const std::vector<PendingSpill>& spills,
+    std::vector<SpillLocation>* locations) {
+  std::vector<std::string> serialized(spills.size());
+  for (size_t i = 0; i < spills.size(); ++i) {
+    experimental::SnapshotRecord record;
+    for (const Tensor& tensor : spills[i].element) {
+      tensor.AsProtoTensorContent(record.add_tensor());
+    }
+    if (!record.SerializeToString(&serialized[i])) {
+      return errors::Internal("Failed to serialize element ", spills[i].index,
+                              " of the tf.data cache for spilling.");
+    }
+  }
+
+  mutex_lock write_lock(write_mu_);
+  if (!spill_file_) {
+    std::string filename;
+    TF_RETURN_IF_ERROR(
+        CreateSpillFilename(env_, options_.spill_directory, &filename));
+    TF_RETURN_IF_ERROR(env_->NewWritableFile(filename, &spill_file_));
+    mutex_lock l(mu_);
+    spill_filename_ = filename;
+  }
+  locations->reserve(spills.size());
+  for (const std::string& element : serialized) {
+    TF_RETURN_IF_ERROR(spill_file_->Append(element));
+    locations->push_back(
+        {spill_file_size_, static_cast<int64_t>(element.size()),
+         crc32c::Value(element.data(), element.size())});
+    spill_file_size_ += element.size();
+    metrics::RecordTFDataCacheSpilledBytes(element.size());
+  }
+  // Makes the spilled elements visible to `spill_reader_`.
+  return spill_file_->Flush();
+}
+
+absl::Status SpillingCache::Load(int64_t index,
+                                 std::vector<Tensor>* out_tensors) {
+  RandomAccessFile* reader = nullptr;
+  int64_t offset = 0;
+  int64_t length = 0;
+  uint32 crc = 0;
+  absl::Status status;
+  {
+    mutex_lock l(mu_);
+    if (!spill_reader_) {
+      status = env_->NewRandomAccessFile(spill_filename_, &spill_reader_);
+    }
+    reader = spill_reader_.get();
+    offset = entries_[index].offset;
+    length = entries_[index].length;
+    crc = entries_[index].crc;
+  }
+
+  std::vector<Tensor> element;
+  if (status.ok()) {
+    status = ReadElement(reader, offset, length, crc, &element);
+  }
+
+  std::vector<PendingSpill> spills;
+  {
+    mutex_lock l(mu_);
+    Entry& entry = entries_[index];
+    entry.loading = false;
+    cond_var_.notify_all();
+    if (!status.ok()) {
+      return status;
+    }
+    if (out_tensors != nullptr) {
+      out_tensors->insert(out_tensors->end(), element.begin(), element.end());
+    }
+    entry.element = std::move(element);
+    entry.in_memory = true;
+    lru_.push_front(index);
+    entry.lru_position = lru_.begin();
+    stats_.memory_bytes += entry.bytes;
+    SelectVictims(/*pinned=*/index, &spills);
+  }
+  return Spill(std::move(spills));
+}
+
+void SpillingCache::Prefetch(int64_t index) {
+  // Limits read-ahead to half of the budget so that it does not evict the
+  // elements it is reading ahead for.
+  int64_t prefetch_bytes = 0;
+  const int64_t end = std::min<int64_t>(
+      entries_.size(), index + 1 + options_.prefetch_elements);
+  for (int64_t i = index + 1; i < end; ++i) {
+    Entry& entry = entries_[i];
+    if (entry.in_memory || entry.loading) {
+      continue;
+    }
+    prefetch_bytes += entry.bytes;
+    if (prefetch_bytes > options_.memory_budget_bytes / 2) {
+      break;
+    }
+    entry.loading = true;
+    thread_pool_->Schedule([this, i]() {
+      absl::Status s = Load(i, /*out_tensors=*/nullptr);
+      if (!s.ok()) {
+        VLOG(1) << "Failed to prefetch element " << i
+                << " of the tf.data cache: " << s;
+      }
+    });
+  }
+}
+
+}  // namespace data
+}  // namespace tensorflow
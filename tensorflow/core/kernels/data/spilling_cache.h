@@ -0,0 +1,186 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_SPILLING_CACHE_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_SPILLING_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/threadpool.h"
+
+namespace tensorflow {
+namespace data {
+
+// A thread-safe store of dataset elements which keeps at most
+// `memory_budget_bytes` worth of tensor data in memory.
+//
+// Elements are appended in order and looked up by index. When the budget is
+// exceeded, the least recently used elements are evicted. An element is
+// written to an append-only spill file the first time it is evicted and read
+// back from that file with a single positional read when it is needed again.
+// A read from disk triggers a background read of the next `prefetch_elements`
+// spilled elements so that sequential passes over the cache hide the disk
+// latency.
+class SpillingCache {
+ public:
+  struct Options {
+    // The maximum number of bytes of tensor data kept in memory.
+    int64_t memory_budget_bytes = 0;
+    // The directory the spill file is created in. If empty, a local temporary
+    // directory is used.
+    std::string spill_directory;
+    // The number of spilled elements to read ahead after a cache miss.
+    int64_t prefetch_elements = 16;
+  };
+
+  struct Stats {
+    // The number of lookups served from memory.
+    int64_t hits = 0;
+    // The number of lookups which had to wait for a read from disk.
+    int64_t misses = 0;
+    // The number of bytes of tensor data currently held in memory.
+    int64_t memory_bytes = 0;
+    // The number of bytes written to the spill file.
+    int64_t spilled_bytes = 0;
+  };
+
+  SpillingCache(Env* env, const Options& options);
+  ~SpillingCache();
+
+  SpillingCache(const SpillingCache&) = delete;
+  SpillingCache& operator=(const SpillingCache&) = delete;
+
+  // Appends `element` to the cache, spilling older elements if the memory
+  // budget is exceeded.
+  absl::Status Append(std::vector<Tensor> element);
+
+  // Copies the element at `index` into `out_tensors`, reading it from the
+  // spill file if it is not in memory.
+  absl::Status Get(int64_t index, std::vector<Tensor>* out_tensors);
+
+  // Returns the number of elements in the cache.
+  size_t size();
+
+  // Returns a snapshot of the cache statistics.
+  Stats stats();
+
+ private:
+  struct Entry {
+    // The element, if `in_memory` is true.
+    std::vector<Tensor> element;
+    bool in_memory = true;
+    // Whether a thread is reading the element from the spill file.
+    bool loading = false;
+    // Whether the element was picked for eviction and is being written to the
+    // spill file. It stays in memory, but not in `lru_`, until the write
+    // completes, and a lookup in the meantime keeps it in memory.
+    bool evicting = false;
+    // The number of bytes of tensor data in the element.
+    int64_t bytes = 0;
+    // The location of the serialized element in the spill file, or -1 if the
+    // element has not been spilled yet.
+    int64_t offset = -1;
+    int64_t length = 0;
+    uint32 crc = 0;
+    // The position of the element in `lru_` if `in_memory` is true and
+    // `evicting` is false.
+    std::list<int64_t>::iterator lru_position;
+  };
+
+  // An element picked for eviction which has to be written to the spill file
+  // first.
+  struct PendingSpill {
+    int64_t index;
+    std::vector<Tensor> element;
+  };
+
+  // The location of a written element in the spill file.
+  struct SpillLocation {
+    int64_t offset;
+    int64_t length;
+    uint32 crc;
+  };
+
+  // Moves the element at `index` to the front of the LRU list.
+  void Touch(int64_t index) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Evicts least recently used elements until the memory budget is met. The
+  // element at `pinned` is never evicted. Elements which are already in the
+  // spill file are dropped right away, the others are added to `spills`.
+  void SelectVictims(int64_t pinned, std::vector<PendingSpill>* spills)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Drops the in-memory copy of the element at `index`.
+  void Drop(int64_t index) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Writes `spills` to the spill file and then drops them from memory, unless
+  // they were looked up in the meantime.
+  absl::Status Spill(std::vector<PendingSpill> spills) TF_LOCKS_EXCLUDED(mu_);
+
+  // Appends `spills` to the spill file and stores where they were written in
+  // `locations`.
+  absl::Status WriteSpills(const std::vector<PendingSpill>& spills,
+                           std::vector<SpillLocation>* locations)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Reads the element at `index` from the spill file and puts it back in
+  // memory. If `out_tensors` is non-null, the element is also copied into it.
+  // The entry must have been marked as `loading` by the caller.
+  absl::Status Load(int64_t index, std::vector<Tensor>* out_tensors)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Schedules background reads of the spilled elements following `index`.
+  void Prefetch(int64_t index) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  Env* const env_;
+  const Options options_;
+
+  mutex mu_;
+  condition_variable cond_var_;
+  std::vector<Entry> entries_ TF_GUARDED_BY(mu_);
+  // Indices of the in-memory elements, most recently used first.
+  std::list<int64_t> lru_ TF_GUARDED_BY(mu_);
+  // The bytes of the elements being evicted.
+  int64_t evicting_bytes_ TF_GUARDED_BY(mu_) = 0;
+  Stats stats_ TF_GUARDED_BY(mu_);
+  std::string spill_filename_ TF_GUARDED_BY(mu_);
+
+  // Serializes writes to the spill file, which happen without holding `mu_`.
+  // Acquired before `mu_` if both are needed.
+  mutex write_mu_;
+  std::unique_ptr<WritableFile> spill_file_ TF_GUARDED_BY(write_mu_);
+  int64_t spill_file_size_ TF_GUARDED_BY(write_mu_) = 0;
+  // Opened when the first spilled element is read back. Reads through it do
+  // not require `mu_`.
+  std::unique_ptr<RandomAccessFile> spill_reader_ TF_GUARDED_BY(mu_);
+
+  // Destroyed first so that no prefetch is running while the other members
+  // are torn down.
+  std::unique_ptr<thread::ThreadPool> thread_pool_;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_SPILLING_CACHE_H_
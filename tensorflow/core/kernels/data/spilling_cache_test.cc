@@ -0,0 +1,266 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/spilling_cache.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/threadpool.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Each element is an int64 scalar and a string scalar.
+std::vector<Tensor> MakeElement(int64_t i) {
+  return {test::AsScalar<int64_t>(i),
+          test::AsScalar<tstring>(strings::StrCat("element_", i))};
+}
+
+void ExpectElement(const std::vector<Tensor>& element, int64_t i) {
+  ASSERT_EQ(element.size(), 2);
+  test::ExpectEqual(element[0], test::AsScalar<int64_t>(i));
+  test::ExpectEqual(element[1],
+                    test::AsScalar<tstring>(strings::StrCat("element_", i)));
+}
+
+int64_t ElementBytes() {
+  int64_t bytes = 0;
+  for (const Tensor& tensor : MakeElement(0)) {
+    bytes += tensor.TotalBytes();
+  }
+  return bytes;
+}
+
+std::string SpillDirectory(const std::string& name) {
+  return io::JoinPath(testing::TmpDir(), "spilling_cache_test", name);
+}
+
+TEST(SpillingCacheTest, KeepsElementsWithinBudgetInMemory) {
+  SpillingCache::Options options;
+  options.memory_budget_bytes = 10 * ElementBytes();
+  options.spill_directory = SpillDirectory("within_budget");
+  SpillingCache cache(Env::Default(), options);
+  for (int64_t i = 0; i < 10; ++i) {
+    TF_ASSERT_OK(cache.Append(MakeElement(i)));
+  }
+  EXPECT_EQ(cache.size(), 10);
+  for (int64_t i = 0; i < 10; ++i) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(cache.Get(i, &element));
+    ExpectElement(element, i);
+  }
+  SpillingCache::Stats stats = cache.stats();
+  EXPECT_EQ(stats.hits, 10);
+  EXPECT_EQ(stats.misses, 0);
+  EXPECT_EQ(stats.spilled_bytes, 0);
+  EXPECT_EQ(stats.memory_bytes, 10 * ElementBytes());
+}
+
+TEST(SpillingCacheTest, SpillsLeastRecentlyUsedElements) {
+  SpillingCache::Options options;
+  options.memory_budget_bytes = 4 * ElementBytes();
+  options.spill_directory = SpillDirectory("lru");
+  options.prefetch_elements = 0;
+  SpillingCache cache(Env::Default(), options);
+  for (int64_t i = 0; i < 10; ++i) {
+    TF_ASSERT_OK(cache.Append(MakeElement(i)));
+  }
+  SpillingCache::Stats stats = cache.stats();
+  EXPECT_EQ(stats.memory_bytes, 4 * ElementBytes());
+  EXPECT_GT(stats.spilled_bytes, 0);
+
+  // Elements 6..9 are the most recently appended ones.
+  std::vector<Tensor> element;
+  TF_ASSERT_OK(cache.Get(9, &element));
+  ExpectElement(element, 9);
+  element.clear();
+  TF_ASSERT_OK(cache.Get(0, &element));
+  ExpectElement(element, 0);
+  stats = cache.stats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 1);
+
+  // Reading element 0 back evicted element 6, the least recently used one.
+  element.clear();
+  TF_ASSERT_OK(cache.Get(0, &element));
+  ExpectElement(element, 0);
+  element.clear();
+  TF_ASSERT_OK(cache.Get(6, &element));
+  ExpectElement(element, 6);
+  stats = cache.stats();
+  EXPECT_EQ(stats.hits, 2);
+  EXPECT_EQ(stats.misses, 2);
+  EXPECT_EQ(stats.memory_bytes, 4 * ElementBytes());
+}
+
+TEST(SpillingCacheTest, ElementsAreSpilledOnce) {
+  SpillingCache::Options options;
+  options.memory_budget_bytes = 2 * ElementBytes();
+  options.spill_directory = SpillDirectory("spilled_once");
+  options.prefetch_elements = 0;
+  SpillingCache cache(Env::Default(), options);
+  for (int64_t i = 0; i < 10; ++i) {
+    TF_ASSERT_OK(cache.Append(MakeElement(i)));
+  }
+  // The first pass evicts the elements that were still in memory after
+  // appending, which spills every element once.
+  for (int64_t i = 0; i < 10; ++i) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(cache.Get(i, &element));
+    ExpectElement(element, i);
+  }
+  const int64_t spilled_bytes = cache.stats().spilled_bytes;
+  for (int epoch = 0; epoch < 2; ++epoch) {
+    for (int64_t i = 0; i < 10; ++i) {
+      std::vector<Tensor> element;
+      TF_ASSERT_OK(cache.Get(i, &element));
+      ExpectElement(element, i);
+    }
+  }
+  EXPECT_EQ(cache.stats().spilled_bytes, spilled_bytes);
+}
+
+TEST(SpillingCacheTest, SequentialReadsWithPrefetching) {
+  SpillingCache::Options options;
+  options.memory_budget_bytes = 16 * ElementBytes();
+  options.spill_directory = SpillDirectory("prefetch");
+  options.prefetch_elements = 4;
+  SpillingCache cache(Env::Default(), options);
+  for (int64_t i = 0; i < 100; ++i) {
+    TF_ASSERT_OK(cache.Append(MakeElement(i)));
+  }
+  for (int epoch = 0; epoch < 2; ++epoch) {
+    for (int64_t i = 0; i < 100; ++i) {
+      std::vector<Tensor> element;
+      TF_ASSERT_OK(cache.Get(i, &element));
+      ExpectElement(element, i);
+    }
+  }
+  SpillingCache::Stats stats = cache.stats();
+  EXPECT_EQ(stats.hits + stats.misses, 200);
+  EXPECT_LE(stats.memory_bytes, options.memory_budget_bytes);
+}
+
+TEST(SpillingCacheTest, ConcurrentReads) {
+  SpillingCache::Options options;
+  options.memory_budget_bytes = 8 * ElementBytes();
+  options.spill_directory = SpillDirectory("concurrent");
+  SpillingCache cache(Env::Default(), options);
+  for (int64_t i = 0; i < 64; ++i) {
+    TF_ASSERT_OK(cache.Append(MakeElement(i)));
+  }
+  {
+    thread::ThreadPool pool(Env::Default(), "readers", 4);
+    for (int reader = 0; reader < 4; ++reader) {
+      pool.Schedule([&cache, reader]() {
+        for (int64_t i = 0; i < 64; ++i) {
+          const int64_t index = (i * (reader + 1)) % 64;
+          std::vector<Tensor> element;
+          TF_ASSERT_OK(cache.Get(index, &element));
+          ExpectElement(element, index);
+        }
+      });
+    }
+  }
+  EXPECT_EQ(cache.stats().hits + cache.stats().misses, 4 * 64);
+}
+
+TEST(SpillingCacheTest, ReadsDuringSpills) {
+  SpillingCache::Options options;
+  options.memory_budget_bytes = 4 * ElementBytes();
+  options.spill_directory = SpillDirectory("reads_during_spills");
+  SpillingCache cache(Env::Default(), options);
+  TF_ASSERT_OK(cache.Append(MakeElement(0)));
+  {
+    thread::ThreadPool pool(Env::Default(), "readers", 4);
+    pool.Schedule([&cache]() {
+      for (int64_t i = 1; i < 64; ++i) {
+        TF_ASSERT_OK(cache.Append(MakeElement(i)));
+      }
+    });
+    for (int reader = 0; reader < 3; ++reader) {
+      pool.Schedule([&cache]() {
+        for (int64_t i = 0; i < 64; ++i) {
+          const int64_t index = i % cache.size();
+          std::vector<Tensor> element;
+          TF_ASSERT_OK(cache.Get(index, &element));
+          ExpectElement(element, index);
+        }
+      });
+    }
+  }
+  EXPECT_EQ(cache.size(), 64);
+  for (int64_t i = 0; i < 64; ++i) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(cache.Get(i, &element));
+    ExpectElement(element, i);
+  }
+  EXPECT_LE(cache.stats().memory_bytes, options.memory_budget_bytes);
+}
+
+TEST(SpillingCacheTest, EmptyElements) {
+  SpillingCache::Options options;
+  options.memory_budget_bytes = 1;
+  options.spill_directory = SpillDirectory("empty_elements");
+  SpillingCache cache(Env::Default(), options);
+  TF_ASSERT_OK(cache.Append({}));
+  TF_ASSERT_OK(cache.Append(MakeElement(1)));
+  std::vector<Tensor> element;
+  TF_ASSERT_OK(cache.Get(0, &element));
+  EXPECT_TRUE(element.empty());
+  TF_ASSERT_OK(cache.Get(1, &element));
+  ExpectElement(element, 1);
+}
+
+TEST(SpillingCacheTest, OutOfRange) {
+  SpillingCache cache(Env::Default(), SpillingCache::Options());
+  TF_ASSERT_OK(cache.Append(MakeElement(0)));
+  std::vector<Tensor> element;
+  EXPECT_TRUE(absl::IsOutOfRange(cache.Get(1, &element)));
+  EXPECT_TRUE(absl::IsOutOfRange(cache.Get(-1, &element)));
+}
+
+TEST(SpillingCacheTest, DeletesSpillFile) {
+  const std::string directory = SpillDirectory("delete");
+  SpillingCache::Options options;
+  options.memory_budget_bytes = ElementBytes();
+  options.spill_directory = directory;
+  {
+    SpillingCache cache(Env::Default(), options);
+    for (int64_t i = 0; i < 4; ++i) {
+      TF_ASSERT_OK(cache.Append(MakeElement(i)));
+    }
+    std::vector<string> children;
+    TF_ASSERT_OK(Env::Default()->GetChildren(directory, &children));
+    EXPECT_EQ(children.size(), 1);
+  }
+  std::vector<string> children;
+  TF_ASSERT_OK(Env::Default()->GetChildren(directory, &children));
+  EXPECT_TRUE(children.empty());
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/text_line_dataset_op.h"
 
+#include <cstring>
+
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/utils.h"
 #include "tensorflow/core/framework/metrics.h"
@@ -21,6 +23,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/io/buffered_inputstream.h"
 #include "tensorflow/core/lib/io/inputbuffer.h"
+#include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/io/random_inputstream.h"
 #include "tensorflow/core/lib/io/zlib_compression_options.h"
 #include "tensorflow/core/lib/io/zlib_inputstream.h"
@@ -37,6 +40,39 @@ constexpr char kZLIB[] = "ZLIB";
 constexpr char kGZIP[] = "GZIP";
 constexpr char kCurrentFileIndex[] = "current_file_index";
 constexpr char kCurrentPos[] = "current_pos";
+constexpr char kFileScheme[] = "file";
+
+namespace {
+
+// Returns true if `filename` refers to the local file system, whose files can
+// be memory-mapped cheaply.
+bool IsLocalFile(const string& filename) {
+  StringPiece scheme, host, path;
+  io::ParseURI(filename, &scheme, &host, &path);
+  return scheme.empty() || scheme == kFileScheme;
+}
+
+// Assigns `[begin, end)` to `line`, dropping carriage returns like
+// `io::BufferedInputStream::ReadLine()` does.
+void AssignWithoutCarriageReturns(const char* begin, const char* end,
+                                  tstring* line) {
+  const char* cr =
+      static_cast<const char*>(std::memchr(begin, '\r', end - begin));
+  if (cr == nullptr) {
+    line->assign(begin, end - begin);
+    return;
+  }
+  line->clear();
+  line->reserve(end - begin);
+  while (cr != nullptr) {
+    line->append(begin, cr - begin);
+    begin = cr + 1;
+    cr = static_cast<const char*>(std::memchr(begin, '\r', end - begin));
+  }
+  line->append(begin, end - begin);
+}
+
+}  // namespace
 
 class TextLineDatasetOp::Dataset : public DatasetBase {
  public:
@@ -106,10 +142,12 @@ class TextLineDatasetOp::Dataset : public DatasetBase {
       mutex_lock l(mu_);
       do {
         // We are currently processing a file, so try to read the next line.
-        if (buffered_input_stream_) {
+        if (mapped_file_ || buffered_input_stream_) {
           Tensor line_contents(tstring{});
           tstring& line_contents_str = line_contents.scalar<tstring>()();
-          Status s = buffered_input_stream_->ReadLine(&line_contents_str);
+          Status s = mapped_file_
+                         ? ReadMappedLineLocked(&line_contents_str)
+                         : buffered_input_stream_->ReadLine(&line_contents_str);
 
           if (s.ok()) {
             // Produce the line as output.
@@ -151,10 +189,13 @@ class TextLineDatasetOp::Dataset : public DatasetBase {
       mutex_lock l(mu_);
       TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kCurrentFileIndex,
                                              current_file_index_));
-      // `buffered_input_stream_` is empty if
+      // `mapped_file_` and `buffered_input_stream_` are empty if
       // 1. GetNext has not been called even once.
       // 2. All files have been read and iterator has been exhausted.
-      if (buffered_input_stream_) {
+      if (mapped_file_) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            prefix(), kCurrentPos, static_cast<int64_t>(mapped_file_pos_)));
+      } else if (buffered_input_stream_) {
         TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kCurrentPos,
                                                buffered_input_stream_->Tell()));
       }
@@ -177,12 +218,41 @@ class TextLineDatasetOp::Dataset : public DatasetBase {
             reader->ReadScalar(prefix(), kCurrentPos, &current_pos));
 
         TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx->env()));
-        TF_RETURN_IF_ERROR(buffered_input_stream_->Seek(current_pos));
+        if (mapped_file_) {
+          mapped_file_pos_ = current_pos;
+        } else {
+          TF_RETURN_IF_ERROR(buffered_input_stream_->Seek(current_pos));
+        }
       }
       return absl::OkStatus();
     }
 
    private:
+    // Reads the next line of `mapped_file_` into `line`, with the same
+    // semantics as `io::BufferedInputStream::ReadLine()`.
+    Status ReadMappedLineLocked(tstring* line)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const char* data = static_cast<const char*>(mapped_file_->data());
+      const size_t size = mapped_file_->length();
+      if (mapped_file_pos_ >= size) {
+        return errors::OutOfRange("EOF reached");
+      }
+      const char* begin = data + mapped_file_pos_;
+      const char* newline = static_cast<const char*>(
+          std::memchr(begin, '\n', size - mapped_file_pos_));
+      const char* end = newline == nullptr ? data + size : newline;
+      AssignWithoutCarriageReturns(begin, end, line);
+      if (newline == nullptr) {
+        mapped_file_pos_ = size;
+        // Like a line break at the end of the file, trailing carriage returns
+        // do not start a new line.
+        if (line->empty()) return errors::OutOfRange("EOF reached");
+      } else {
+        mapped_file_pos_ = newline + 1 - data;
+      }
+      return absl::OkStatus();
+    }
+
     // Sets up reader streams to read from the file at `current_file_index_`.
     Status SetupStreamsLocked(Env* env) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       if (current_file_index_ >= dataset()->filenames_.size()) {
@@ -192,9 +262,19 @@ class TextLineDatasetOp::Dataset : public DatasetBase {
       }
 
       // Actually move on to next file.
-      TF_RETURN_IF_ERROR(env->NewRandomAccessFile(
-          TranslateFileName(dataset()->filenames_[current_file_index_]),
-          &file_));
+      const string filename =
+          TranslateFileName(dataset()->filenames_[current_file_index_]);
+      // Uncompressed local files are memory-mapped, so that lines are found
+      // with `memchr` directly in the page cache rather than by scanning a
+      // copy of the file byte by byte. Files that can't be mapped (e.g. empty
+      // files) are read through the streams below.
+      if (!dataset()->use_compression_ && IsLocalFile(filename) &&
+          env->NewReadOnlyMemoryRegionFromFile(filename, &mapped_file_).ok()) {
+        mapped_file_pos_ = 0;
+        return absl::OkStatus();
+      }
+      mapped_file_.reset();
+      TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename, &file_));
       input_stream_ =
           std::make_unique<io::RandomAccessInputStream>(file_.get(), false);
 
@@ -214,6 +294,7 @@ class TextLineDatasetOp::Dataset : public DatasetBase {
 
     // Resets all reader streams.
     void ResetStreamsLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      mapped_file_.reset();
       input_stream_.reset();
       zlib_input_stream_.reset();
       buffered_input_stream_.reset();
@@ -221,6 +302,9 @@ class TextLineDatasetOp::Dataset : public DatasetBase {
     }
 
     mutex mu_;
+    // Set instead of the streams below if the current file is memory-mapped.
+    std::unique_ptr<ReadOnlyMemoryRegion> mapped_file_ TF_GUARDED_BY(mu_);
+    size_t mapped_file_pos_ TF_GUARDED_BY(mu_) = 0;
     std::unique_ptr<io::RandomAccessInputStream> input_stream_
         TF_GUARDED_BY(mu_);
     std::unique_ptr<io::ZlibInputStream> zlib_input_stream_ TF_GUARDED_BY(mu_);
@@ -12,6 +12,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/data/text_line_dataset_op.h"
 
 #include "tensorflow/core/data/dataset_test_base.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace data {
@@ -140,6 +141,28 @@ TextLineDatasetParams TextLineDatasetParams3() {
                                /*node_name=*/kNodeName);
 }
 
+// Test case 4: uncompressed text files with carriage returns, empty lines and
+// no trailing line break. The local file is memory-mapped, whereas the
+// in-memory file is read through a stream; both must produce the same lines.
+TextLineDatasetParams TextLineDatasetParams4() {
+  static int ram_file_index = 0;
+  std::vector<tstring> filenames = {
+      LocalTempFilename(),
+      absl::StrCat("ram://text_line_dataset_", ram_file_index++)};
+  std::vector<tstring> contents = {
+      absl::StrCat("hello\r\n", "\n", "wor\rld\r\n", "last"),
+      absl::StrCat("hello\r\n", "\n", "wor\rld\r\n", "last")};
+  CompressionType compression_type = CompressionType::UNCOMPRESSED;
+  if (!CreateTestFiles(filenames, contents, compression_type).ok()) {
+    LOG(WARNING) << "Failed to create the test files: "
+                 << absl::StrJoin(filenames, ", ");
+  }
+  return TextLineDatasetParams(filenames,
+                               /*compression_type=*/compression_type,
+                               /*buffer_size=*/10,
+                               /*node_name=*/kNodeName);
+}
+
 std::vector<GetNextTestCase<TextLineDatasetParams>> GetNextTestCases() {
   return {{/*dataset_params=*/TextLineDatasetParams1(),
            /*expected_outputs=*/
@@ -159,7 +182,16 @@ std::vector<GetNextTestCase<TextLineDatasetParams>> GetNextTestCases() {
                                                     {"11223334455"},
                                                     {"abcd, EFgH"},
                                                     {"           "},
-                                                    {"$%^&*()"}})}};
+                                                    {"$%^&*()"}})},
+          {/*dataset_params=*/TextLineDatasetParams4(),
+           CreateTensors<tstring>(TensorShape({}), {{"hello"},
+                                                    {""},
+                                                    {"world"},
+                                                    {"last"},
+                                                    {"hello"},
+                                                    {""},
+                                                    {"world"},
+                                                    {"last"}})}};
 }
 
 ITERATOR_GET_NEXT_TEST_P(TextLineDatasetOpTest, TextLineDatasetParams,
@@ -239,12 +271,77 @@ IteratorSaveAndRestoreTestCases() {
                                                     {"11223334455"},
                                                     {"abcd, EFgH"},
                                                     {"           "},
-                                                    {"$%^&*()"}})}};
+                                                    {"$%^&*()"}})},
+          {/*dataset_params=*/TextLineDatasetParams4(),
+           /*breakpoints=*/{0, 3, 6, 9},
+           CreateTensors<tstring>(TensorShape({}), {{"hello"},
+                                                    {""},
+                                                    {"world"},
+                                                    {"last"},
+                                                    {"hello"},
+                                                    {""},
+                                                    {"world"},
+                                                    {"last"}})}};
 }
 
 ITERATOR_SAVE_AND_RESTORE_TEST_P(TextLineDatasetOpTest, TextLineDatasetParams,
                                  IteratorSaveAndRestoreTestCases())
 
+class TextLineDatasetBenchmark : public DatasetOpsTestBase {
+ public:
+  void TestBody() override {}
+
+  // Reads all lines of the dataset with a new iterator.
+  void ReadAllLines(const DatasetParams& dataset_params) {
+    std::unique_ptr<IteratorBase> iterator;
+    TF_CHECK_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                       dataset_params.iterator_prefix(),
+                                       &iterator));
+    std::vector<Tensor> out_tensors;
+    bool end_of_sequence = false;
+    while (!end_of_sequence) {
+      out_tensors.clear();
+      TF_CHECK_OK(iterator->GetNext(iterator_ctx_.get(), &out_tensors,
+                                    &end_of_sequence));
+    }
+  }
+};
+
+// Reads a corpus of `state.range(0)`-byte lines. If `state.range(1)` is
+// non-zero, the corpus is a local file that is memory-mapped, and otherwise
+// an in-memory file that is read through a buffered stream.
+void BM_TextLineDataset(::testing::benchmark::State& state) {
+  const int64_t line_length = state.range(0);
+  const bool local_file = state.range(1) != 0;
+  constexpr int64_t kCorpusBytes = 64 << 20;
+  const string line = absl::StrCat(string(line_length - 1, 'x'), "\n");
+  string contents;
+  contents.reserve(kCorpusBytes);
+  while (contents.size() + line.size() <= kCorpusBytes) {
+    contents.append(line);
+  }
+  const tstring filename =
+      local_file ? LocalTempFilename() : tstring("ram://text_line_benchmark");
+  TF_CHECK_OK(WriteDataToFile(filename, contents.data()));
+  TextLineDatasetParams dataset_params({filename},
+                                       CompressionType::UNCOMPRESSED,
+                                       /*buffer_size=*/0, kNodeName);
+
+  TextLineDatasetBenchmark benchmark;
+  TF_CHECK_OK(benchmark.Initialize(dataset_params));
+  for (auto s : state) {
+    benchmark.ReadAllLines(dataset_params);
+  }
+  state.SetBytesProcessed(state.iterations() * contents.size());
+  TF_CHECK_OK(Env::Default()->DeleteFile(filename));
+}
+
+BENCHMARK(BM_TextLineDataset)
+    ->ArgPair(16, 0)
+    ->ArgPair(16, 1)
+    ->ArgPair(4096, 0)
+    ->ArgPair(4096, 1);
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
@@ -14,8 +14,14 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/tf_record_dataset_op.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <list>
+#include <memory>
+#include <optional>
+#include <utility>
 
+#include "tensorflow/core/data/global_shuffle_utils.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/utils.h"
 #include "tensorflow/core/framework/metrics.h"
@@ -24,10 +30,12 @@ limitations under the License.
 #include "tensorflow/core/lib/io/buffered_inputstream.h"
 #include "tensorflow/core/lib/io/inputbuffer.h"
 #include "tensorflow/core/lib/io/random_inputstream.h"
+#include "tensorflow/core/lib/io/record_index.h"
 #include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/lib/io/zlib_compression_options.h"
 #include "tensorflow/core/lib/io/zlib_inputstream.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/statusor.h"
 
 namespace tensorflow {
 namespace data {
@@ -40,6 +48,8 @@ namespace data {
 /* static */ constexpr const char* const TFRecordDatasetOp::kCompressionType;
 /* static */ constexpr const char* const TFRecordDatasetOp::kBufferSize;
 /* static */ constexpr const char* const TFRecordDatasetOp::kByteOffsets;
+/* static */ constexpr const char* const TFRecordDatasetOp::kReadaheadDepth;
+/* static */ constexpr const char* const TFRecordDatasetOp::kReadaheadChunkSize;
 
 constexpr char kTFRecordDataset[] = "TFRecordDataset";
 constexpr char kCurrentFileIndex[] = "current_file_index";
@@ -50,6 +60,10 @@ constexpr int64_t kUnspecifiedBufferSize = -1;
 constexpr int64_t kDefaultBufferSize = 256LL << 10;  // 256KB
 constexpr int64_t kCloudTpuBlockSize = 127LL << 20;  // 127MB.
 constexpr int64_t kS3BlockSize = kCloudTpuBlockSize;
+// The number of files kept open for random access. Globally shuffled reads
+// jump between all the files, so keeping every one of them open would hold
+// two descriptors per file for the lifetime of the dataset.
+constexpr size_t kMaxOpenIndexedFiles = 16;
 
 bool is_cloud_tpu_gcs_fs() {
 #if (defined(PLATFORM_CLOUD_TPU) && defined(TPU_GCS_FS)) || \
@@ -63,7 +77,8 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
  public:
   explicit Dataset(OpKernelContext* ctx, std::vector<string> filenames,
                    const string& compression_type, int64_t buffer_size,
-                   std::vector<int64_t> byte_offsets, int op_version)
+                   std::vector<int64_t> byte_offsets, int64_t readahead_depth,
+                   int64_t readahead_chunk_size, int op_version)
       : DatasetBase(DatasetContext(ctx)),
         filenames_(std::move(filenames)),
         compression_type_(compression_type),
@@ -74,6 +89,8 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     if (buffer_size > 0) {
       options_.buffer_size = buffer_size;
     }
+    options_.readahead_depth = static_cast<int>(readahead_depth);
+    options_.readahead_chunk_size = readahead_chunk_size;
   }
 
   std::unique_ptr<IteratorBase> MakeIteratorInternal(
@@ -107,6 +124,66 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
 
   Status CheckExternalState() const override { return absl::OkStatus(); }
 
+  // The cardinality is only known when every file has a record index, which
+  // is read at the moderate compute level. Compressed or unindexed files are
+  // the common case, so they silently yield an unknown cardinality.
+  int64_t CardinalityInternal(CardinalityOptions options) const override {
+    if (options.compute_level() <
+        CardinalityOptions::CARDINALITY_COMPUTE_MODERATE) {
+      return kUnknownCardinality;
+    }
+    absl::StatusOr<IndexedFiles*> indexed_files = GetIndexedFiles();
+    if (!indexed_files.ok()) {
+      VLOG(2) << "Unable to compute cardinality for dataset " << DebugString()
+              << " due to error: " << indexed_files.status();
+      return kUnknownCardinality;
+    }
+    return (*indexed_files)->first_record.back();
+  }
+
+  Status Get(OpKernelContext* ctx, int64 index,
+             std::vector<Tensor>* out_tensors) const override {
+    return Get(AnyContext(ctx), index, out_tensors);
+  }
+
+  Status Get(AnyContext ctx, int64 index,
+             std::vector<Tensor>* out_tensors) const override {
+    TF_ASSIGN_OR_RETURN(IndexedFiles * indexed_files, GetIndexedFiles());
+    TF_RETURN_IF_ERROR(CheckRandomAccessCompatible(index));
+    const std::vector<int64_t>& first_record = indexed_files->first_record;
+    // The last file whose first record is at or before `index`. Empty files
+    // are skipped since the next file starts at the same record.
+    const size_t file_index =
+        std::upper_bound(first_record.begin(), first_record.end(), index) -
+        first_record.begin() - 1;
+    TF_ASSIGN_OR_RETURN(std::shared_ptr<const IndexedFile> file,
+                        GetIndexedFile(indexed_files, file_index));
+    out_tensors->clear();
+    out_tensors->emplace_back(ctx.allocator, DT_STRING, TensorShape({}));
+    tstring& record = out_tensors->back().scalar<tstring>()();
+    TF_RETURN_IF_ERROR(
+        file->reader->ReadRecord(index - first_record[file_index], &record));
+    static monitoring::CounterCell* bytes_counter =
+        metrics::GetTFDataBytesReadCounter(kDatasetType);
+    bytes_counter->IncrementBy(record.size());
+    return absl::OkStatus();
+  }
+
+  absl::Status RandomIndexingCompatible() const override {
+    if (!compression_type_.empty()) {
+      return errors::FailedPrecondition(
+          "Random access to ", DebugString(),
+          " requires uncompressed files, but the compression type is ",
+          compression_type_, ".");
+    }
+    if (std::any_of(byte_offsets_.begin(), byte_offsets_.end(),
+                    [](int64_t offset) { return offset != 0; })) {
+      return errors::FailedPrecondition("Random access to ", DebugString(),
+                                        " does not support `byte_offsets`.");
+    }
+    return absl::OkStatus();
+  }
+
  protected:
   Status AsGraphDefInternal(SerializationContext* ctx,
                             DatasetGraphDefBuilder* b,
@@ -117,24 +194,48 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     TF_RETURN_IF_ERROR(b->AddScalar(compression_type_, &compression_type));
     Node* buffer_size = nullptr;
     TF_RETURN_IF_ERROR(b->AddScalar(options_.buffer_size, &buffer_size));
-    TF_RETURN_IF_ERROR(b->AddDataset(
-        this, {filenames, compression_type, buffer_size}, output));
-    Node* byte_offsets = nullptr;
-    TF_RETURN_IF_ERROR(b->AddVector(byte_offsets_, &byte_offsets));
-    return absl::OkStatus();
+    std::vector<Node*> inputs = {filenames, compression_type, buffer_size};
+    if (op_version_ > 1) {
+      Node* byte_offsets = nullptr;
+      TF_RETURN_IF_ERROR(b->AddVector(byte_offsets_, &byte_offsets));
+      inputs.push_back(byte_offsets);
+    }
+    // The readahead attrs are only set when they differ from their defaults,
+    // so that the graphs of datasets without readahead can still be loaded by
+    // binaries which predate the attrs.
+    const io::RecordReaderOptions default_options;
+    std::vector<std::pair<StringPiece, AttrValue>> attrs;
+    if (options_.readahead_depth != default_options.readahead_depth) {
+      AttrValue readahead_depth;
+      b->BuildAttrValue<int64_t>(options_.readahead_depth, &readahead_depth);
+      attrs.emplace_back(kReadaheadDepth, readahead_depth);
+    }
+    if (options_.readahead_chunk_size != default_options.readahead_chunk_size) {
+      AttrValue readahead_chunk_size;
+      b->BuildAttrValue<int64_t>(options_.readahead_chunk_size,
+                                 &readahead_chunk_size);
+      attrs.emplace_back(kReadaheadChunkSize, readahead_chunk_size);
+    }
+    return b->AddDataset(this, inputs, attrs, output);
   }
 
  private:
   class Iterator : public DatasetIterator<Dataset> {
    public:
     explicit Iterator(const Params& params)
-        : DatasetIterator<Dataset>(params) {}
+        : DatasetIterator<Dataset>(params),
+          global_shuffle_iterator_(dataset()) {}
 
     bool SymbolicCheckpointCompatible() const override { return true; }
 
     Status GetNextInternal(IteratorContext* ctx,
                            std::vector<Tensor>* out_tensors,
                            bool* end_of_sequence) override {
+      if (ctx->index_mapper() != nullptr) {
+        return global_shuffle_iterator_.GetNext(ctx, out_tensors,
+                                                end_of_sequence);
+      }
+
       out_tensors->reserve(1);
       mutex_lock l(mu_);
       do {
@@ -240,6 +341,9 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
 
     Status RestoreInternal(IteratorContext* ctx,
                            IteratorStateReader* reader) override {
+      if (ctx->restored_element_count().has_value()) {
+        return global_shuffle_iterator_.Restore(ctx);
+      }
       mutex_lock l(mu_);
       ResetStreamsLocked();
       int64_t current_file_index;
@@ -290,18 +394,173 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     // we must destroy `reader_` before `file_`.
     std::unique_ptr<RandomAccessFile> file_ TF_GUARDED_BY(mu_);
     std::unique_ptr<io::SequentialRecordReader> reader_ TF_GUARDED_BY(mu_);
+
+    GlobalShuffleIterator global_shuffle_iterator_;
+  };
+
+  // A file and its record index, opened for random access.
+  struct IndexedFile {
+    // `reader` borrows the objects that `file` and `index_file` point to, so
+    // it is declared last to be destroyed first.
+    std::unique_ptr<RandomAccessFile> file;
+    std::unique_ptr<RandomAccessFile> index_file;
+    std::unique_ptr<io::IndexedRecordReader> reader;
   };
 
+  // Record counts of all the files, used for random access. The files are
+  // opened when first read, and only the `kMaxOpenIndexedFiles` most recently
+  // read ones are kept open.
+  struct IndexedFiles {
+    // `first_record[i]` is the number of records in the files before file
+    // `i`; the last entry is the total number of records.
+    std::vector<int64_t> first_record;
+
+    mutex mu;
+    // Pairs of file index and open file, most recently read first. Readers
+    // hold a reference, so a file evicted during a read stays open until the
+    // read completes.
+    std::list<std::pair<size_t, std::shared_ptr<const IndexedFile>>>
+        open_files TF_GUARDED_BY(mu);
+  };
+
+  // Counts the records of every file on first use. The outcome, including a
+  // missing index, is cached for the lifetime of the dataset.
+  absl::StatusOr<IndexedFiles*> GetIndexedFiles() const {
+    mutex_lock l(indexed_files_mu_);
+    if (!indexed_files_status_.has_value()) {
+      auto indexed_files = std::make_unique<IndexedFiles>();
+      indexed_files_status_ = CountIndexedRecords(indexed_files.get());
+      if (indexed_files_status_->ok()) {
+        indexed_files_ = std::move(indexed_files);
+      }
+    }
+    TF_RETURN_IF_ERROR(*indexed_files_status_);
+    return indexed_files_.get();
+  }
+
+  Status CountIndexedRecords(IndexedFiles* indexed_files) const {
+    TF_RETURN_IF_ERROR(RandomIndexingCompatible());
+    indexed_files->first_record.reserve(filenames_.size() + 1);
+    indexed_files->first_record.push_back(0);
+    for (const string& filename : filenames_) {
+      // Only the footer of the index is read, and the index file is closed
+      // again right away.
+      std::unique_ptr<RandomAccessFile> index_file;
+      std::unique_ptr<io::RecordIndex> index;
+      TF_RETURN_IF_ERROR(
+          OpenRecordIndex(TranslateFileName(filename), &index_file, &index));
+      indexed_files->first_record.push_back(
+          indexed_files->first_record.back() + index->num_records());
+    }
+    return absl::OkStatus();
+  }
+
+  // Returns the open file `file_index`, opening it and evicting the least
+  // recently read file if it is not open yet.
+  absl::StatusOr<std::shared_ptr<const IndexedFile>> GetIndexedFile(
+      IndexedFiles* indexed_files, size_t file_index) const {
+    {
+      mutex_lock l(indexed_files->mu);
+      std::shared_ptr<const IndexedFile> file =
+          FindOpenFile(indexed_files, file_index);
+      if (file) {
+        return file;
+      }
+    }
+    // Opens the file without holding the lock, so that reads from the files
+    // which are already open are not blocked on I/O.
+    auto file = std::make_shared<IndexedFile>();
+    TF_RETURN_IF_ERROR(OpenIndexedFile(indexed_files, file_index, file.get()));
+    mutex_lock l(indexed_files->mu);
+    // Another reader may have opened the same file in the meantime.
+    std::shared_ptr<const IndexedFile> open_file =
+        FindOpenFile(indexed_files, file_index);
+    if (open_file) {
+      return open_file;
+    }
+    indexed_files->open_files.emplace_front(file_index, file);
+    if (indexed_files->open_files.size() > kMaxOpenIndexedFiles) {
+      indexed_files->open_files.pop_back();
+    }
+    return file;
+  }
+
+  // Returns the open file `file_index` and marks it as the most recently
+  // read, or returns nullptr if it is not open.
+  static std::shared_ptr<const IndexedFile> FindOpenFile(
+      IndexedFiles* indexed_files, size_t file_index)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(indexed_files->mu) {
+    auto& open_files = indexed_files->open_files;
+    for (auto it = open_files.begin(); it != open_files.end(); ++it) {
+      if (it->first == file_index) {
+        open_files.splice(open_files.begin(), open_files, it);
+        return it->second;
+      }
+    }
+    return nullptr;
+  }
+
+  Status OpenIndexedFile(const IndexedFiles* indexed_files, size_t file_index,
+                         IndexedFile* file) const {
+    const string translated_filename =
+        TranslateFileName(filenames_[file_index]);
+    std::unique_ptr<io::RecordIndex> index;
+    TF_RETURN_IF_ERROR(
+        OpenRecordIndex(translated_filename, &file->index_file, &index));
+    const int64_t num_records = indexed_files->first_record[file_index + 1] -
+                                indexed_files->first_record[file_index];
+    if (index->num_records() != num_records) {
+      return errors::FailedPrecondition(
+          "The record index of ", translated_filename, " changed from ",
+          num_records, " to ", index->num_records(),
+          " records while reading ", DebugString(), ".");
+    }
+    TF_RETURN_IF_ERROR(
+        Env::Default()->NewRandomAccessFile(translated_filename, &file->file));
+    file->reader = std::make_unique<io::IndexedRecordReader>(file->file.get(),
+                                                             std::move(index));
+    return absl::OkStatus();
+  }
+
+  Status OpenRecordIndex(const string& translated_filename,
+                         std::unique_ptr<RandomAccessFile>* index_file,
+                         std::unique_ptr<io::RecordIndex>* index) const {
+    Env* env = Env::Default();
+    const string index_filename = io::RecordIndexFilename(translated_filename);
+    uint64 index_size;
+    Status s = env->GetFileSize(index_filename, &index_size);
+    if (errors::IsNotFound(s)) {
+      return errors::FailedPrecondition(
+          "Random access to ", DebugString(),
+          " requires a record index for every file, but ", index_filename,
+          " does not exist. Write it with "
+          "`tf.io.TFRecordWriter(..., write_index=True)`.");
+    }
+    TF_RETURN_IF_ERROR(s);
+    TF_RETURN_IF_ERROR(env->NewRandomAccessFile(index_filename, index_file));
+    return io::RecordIndex::Open(index_file->get(), index_size, index);
+  }
+
   const std::vector<string> filenames_;
   const tstring compression_type_;
   io::RecordReaderOptions options_;
   const std::vector<int64_t> byte_offsets_;
   const int op_version_;
+
+  mutable mutex indexed_files_mu_;
+  mutable std::optional<absl::Status> indexed_files_status_
+      TF_GUARDED_BY(indexed_files_mu_);
+  mutable std::unique_ptr<IndexedFiles> indexed_files_
+      TF_GUARDED_BY(indexed_files_mu_);
 };
 
 TFRecordDatasetOp::TFRecordDatasetOp(OpKernelConstruction* ctx)
     : DatasetOpKernel(ctx),
-      op_version_(ctx->def().op() == kTFRecordDataset ? 1 : 2) {}
+      op_version_(ctx->def().op() == kTFRecordDataset ? 1 : 2) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kReadaheadDepth, &readahead_depth_));
+  OP_REQUIRES_OK(ctx,
+                 ctx->GetAttr(kReadaheadChunkSize, &readahead_chunk_size_));
+}
 
 void TFRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
                                     DatasetBase** output) {
@@ -380,7 +639,8 @@ void TFRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
   }
 
   *output = new Dataset(ctx, std::move(filenames), compression_type,
-                        buffer_size, std::move(byte_offsets), op_version_);
+                        buffer_size, std::move(byte_offsets), readahead_depth_,
+                        readahead_chunk_size_, op_version_);
 }
 
 namespace {
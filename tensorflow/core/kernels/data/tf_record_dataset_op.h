@@ -27,6 +27,9 @@ class TFRecordDatasetOp : public DatasetOpKernel {
   static constexpr const char* const kCompressionType = "compression_type";
   static constexpr const char* const kBufferSize = "buffer_size";
   static constexpr const char* const kByteOffsets = "byte_offsets";
+  static constexpr const char* const kReadaheadDepth = "readahead_depth";
+  static constexpr const char* const kReadaheadChunkSize =
+      "readahead_chunk_size";
 
   explicit TFRecordDatasetOp(OpKernelConstruction* ctx);
 
@@ -36,6 +39,8 @@ class TFRecordDatasetOp : public DatasetOpKernel {
  private:
   class Dataset;
   int op_version_;
+  int64_t readahead_depth_ = 0;
+  int64_t readahead_chunk_size_ = 0;
 };
 
 }  // namespace data
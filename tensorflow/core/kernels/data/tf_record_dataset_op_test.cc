@@ -15,7 +15,10 @@ limitations under the License.
 #include <string>
 
 #include "tensorflow/core/data/dataset_test_base.h"
+#include "tensorflow/core/graph/graph_def_builder.h"
+#include "tensorflow/core/lib/io/record_index.h"
 #include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/file_system.h"
 
@@ -46,13 +49,17 @@ class TFRecordDatasetParams : public DatasetParams {
  public:
   TFRecordDatasetParams(std::vector<tstring> filenames,
                         CompressionType compression_type, int64_t buffer_size,
-                        std::vector<int64_t> byte_offsets, string node_name)
+                        std::vector<int64_t> byte_offsets, string node_name,
+                        int64_t readahead_depth = 0,
+                        int64_t readahead_chunk_size = 8 << 20)
       : DatasetParams({DT_STRING}, {PartialTensorShape({})},
                       std::move(node_name)),
         filenames_(std::move(filenames)),
         compression_type_(compression_type),
         buffer_size_(buffer_size),
-        byte_offsets_(std::move(byte_offsets)) {
+        byte_offsets_(std::move(byte_offsets)),
+        readahead_depth_(readahead_depth),
+        readahead_chunk_size_(readahead_chunk_size) {
     op_version_ = 2;
   }
 
@@ -80,6 +87,10 @@ class TFRecordDatasetParams : public DatasetParams {
   Status GetAttributes(AttributeVector* attr_vector) const override {
     attr_vector->clear();
     attr_vector->emplace_back("metadata", "");
+    attr_vector->emplace_back(TFRecordDatasetOp::kReadaheadDepth,
+                              readahead_depth_);
+    attr_vector->emplace_back(TFRecordDatasetOp::kReadaheadChunkSize,
+                              readahead_chunk_size_);
     return absl::OkStatus();
   }
 
@@ -92,6 +103,8 @@ class TFRecordDatasetParams : public DatasetParams {
   CompressionType compression_type_;
   int64_t buffer_size_;
   std::vector<int64_t> byte_offsets_;
+  int64_t readahead_depth_;
+  int64_t readahead_chunk_size_;
 };
 
 class TFRecordDatasetOpTest : public DatasetOpsTestBase {};
@@ -114,6 +127,28 @@ Status CreateTestFiles(const std::vector<tstring>& filenames,
   return absl::OkStatus();
 }
 
+// Writes uncompressed files together with their record indices.
+Status CreateIndexedTestFiles(
+    const std::vector<tstring>& filenames,
+    const std::vector<std::vector<string>>& contents) {
+  Env* env = Env::Default();
+  for (int i = 0; i < filenames.size(); ++i) {
+    std::unique_ptr<WritableFile> file;
+    TF_RETURN_IF_ERROR(env->NewWritableFile(filenames[i], &file));
+    std::unique_ptr<WritableFile> index_file;
+    TF_RETURN_IF_ERROR(env->NewWritableFile(
+        io::RecordIndexFilename(filenames[i]), &index_file));
+    io::RecordWriter writer(file.get(), index_file.get());
+    for (const string& record : contents[i]) {
+      TF_RETURN_IF_ERROR(writer.WriteRecord(record));
+    }
+    TF_RETURN_IF_ERROR(writer.Close());
+    TF_RETURN_IF_ERROR(file->Close());
+    TF_RETURN_IF_ERROR(index_file->Close());
+  }
+  return absl::OkStatus();
+}
+
 // Test case 1: multiple text files with ZLIB compression.
 TFRecordDatasetParams TFRecordDatasetParams1() {
   std::vector<tstring> filenames = {
@@ -193,7 +228,48 @@ TFRecordDatasetParams TFRecordDatasetParams4() {
                                /*node_name=*/kNodeName);
 }
 
-// Test case 5: Read invalid byte_offsets for records.
+// Test case 5: uncompressed files read ahead in chunks smaller than a record,
+// so that records span several chunks.
+TFRecordDatasetParams ReadaheadDatasetParams() {
+  std::vector<tstring> filenames = {
+      absl::StrCat(testing::TmpDir(), "/tf_record_READAHEAD_1"),
+      absl::StrCat(testing::TmpDir(), "/tf_record_READAHEAD_2")};
+  std::vector<std::vector<string>> contents = {{"1", "22", "333"},
+                                               {"a", "bb", "ccc"}};
+  CompressionType compression_type = CompressionType::UNCOMPRESSED;
+  absl::Status status = CreateTestFiles(filenames, contents, compression_type);
+  TF_CHECK_OK(status) << "Failed to create the test files: "
+                      << absl::StrJoin(filenames, ", ") << ": " << status;
+  return TFRecordDatasetParams(filenames,
+                               /*compression_type=*/compression_type,
+                               /*buffer_size=*/10,
+                               /*byte_offsets=*/{},
+                               /*node_name=*/kNodeName,
+                               /*readahead_depth=*/3,
+                               /*readahead_chunk_size=*/7);
+}
+
+// Test case 6: ZLIB compressed files read ahead underneath the decompressor.
+TFRecordDatasetParams ReadaheadZlibDatasetParams() {
+  std::vector<tstring> filenames = {
+      absl::StrCat(testing::TmpDir(), "/tf_record_READAHEAD_ZLIB_1"),
+      absl::StrCat(testing::TmpDir(), "/tf_record_READAHEAD_ZLIB_2")};
+  std::vector<std::vector<string>> contents = {{"1", "22", "333"},
+                                               {"a", "bb", "ccc"}};
+  CompressionType compression_type = CompressionType::ZLIB;
+  absl::Status status = CreateTestFiles(filenames, contents, compression_type);
+  TF_CHECK_OK(status) << "Failed to create the test files: "
+                      << absl::StrJoin(filenames, ", ") << ": " << status;
+  return TFRecordDatasetParams(filenames,
+                               /*compression_type=*/compression_type,
+                               /*buffer_size=*/10,
+                               /*byte_offsets=*/{},
+                               /*node_name=*/kNodeName,
+                               /*readahead_depth=*/2,
+                               /*readahead_chunk_size=*/5);
+}
+
+// Test case 7: Read invalid byte_offsets for records.
 TFRecordDatasetParams InvalidByteOffsets() {
   std::vector<tstring> filenames = {
       absl::StrCat(testing::TmpDir(), "/tf_record_UNCOMPRESSED_1")};
@@ -223,7 +299,13 @@ std::vector<GetNextTestCase<TFRecordDatasetParams>> GetNextTestCases() {
       {/*dataset_params=*/TFRecordDatasetParams4(),
        CreateTensors<tstring>(
            TensorShape({}),
-           {{"1"}, {"22"}, {"333"}, {"bb"}, {"ccc"}, {"zzz"}})}};
+           {{"1"}, {"22"}, {"333"}, {"bb"}, {"ccc"}, {"zzz"}})},
+      {/*dataset_params=*/ReadaheadDatasetParams(),
+       CreateTensors<tstring>(
+           TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})},
+      {/*dataset_params=*/ReadaheadZlibDatasetParams(),
+       CreateTensors<tstring>(
+           TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})}};
 }
 
 ITERATOR_GET_NEXT_TEST_P(TFRecordDatasetOpTest, TFRecordDatasetParams,
@@ -322,6 +404,43 @@ TEST_F(TFRecordDatasetOpTest, IteratorPrefix) {
       iterator_prefix_params)));
 }
 
+// Returns the node of `dataset` in its serialized graph.
+StatusOr<NodeDef> GetDatasetNodeDef(const DatasetBase* dataset) {
+  GraphDefBuilder b;
+  DatasetBase::DatasetGraphDefBuilder db(&b);
+  SerializationContext serialization_ctx((SerializationContext::Params()));
+  Node* output_node = nullptr;
+  TF_RETURN_IF_ERROR(
+      db.AddInputDataset(&serialization_ctx, dataset, &output_node));
+  GraphDef graph_def;
+  TF_RETURN_IF_ERROR(b.ToGraphDef(&graph_def));
+  for (const NodeDef& node : graph_def.node()) {
+    if (node.name() == output_node->name()) {
+      return node;
+    }
+  }
+  return errors::NotFound("No node for ", dataset->DebugString());
+}
+
+TEST_F(TFRecordDatasetOpTest, GraphDefOmitsDefaultReadahead) {
+  auto dataset_params = TFRecordDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK_AND_ASSIGN(NodeDef node_def, GetDatasetNodeDef(dataset_));
+  EXPECT_EQ(node_def.input_size(), 4);
+  EXPECT_FALSE(node_def.attr().contains(TFRecordDatasetOp::kReadaheadDepth));
+  EXPECT_FALSE(
+      node_def.attr().contains(TFRecordDatasetOp::kReadaheadChunkSize));
+}
+
+TEST_F(TFRecordDatasetOpTest, GraphDefKeepsReadahead) {
+  auto dataset_params = ReadaheadDatasetParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK_AND_ASSIGN(NodeDef node_def, GetDatasetNodeDef(dataset_));
+  EXPECT_EQ(node_def.input_size(), 4);
+  EXPECT_EQ(node_def.attr().at(TFRecordDatasetOp::kReadaheadDepth).i(), 3);
+  EXPECT_EQ(node_def.attr().at(TFRecordDatasetOp::kReadaheadChunkSize).i(), 7);
+}
+
 TEST_F(TFRecordDatasetOpTest, InvalidByteOffsetsToSeek) {
   auto dataset_params = InvalidByteOffsets();
   TF_ASSERT_OK(Initialize(dataset_params));
@@ -333,6 +452,95 @@ TEST_F(TFRecordDatasetOpTest, InvalidByteOffsetsToSeek) {
       absl::StatusCode::kDataLoss);
 }
 
+// Uncompressed files with record indices, one of them empty.
+TFRecordDatasetParams IndexedDatasetParams() {
+  std::vector<tstring> filenames = {
+      absl::StrCat(testing::TmpDir(), "/tf_record_INDEXED_1"),
+      absl::StrCat(testing::TmpDir(), "/tf_record_INDEXED_2"),
+      absl::StrCat(testing::TmpDir(), "/tf_record_INDEXED_3")};
+  std::vector<std::vector<string>> contents = {
+      {"1", "22", "333"}, {}, {"a", "bb", "ccc"}};
+  TF_CHECK_OK(CreateIndexedTestFiles(filenames, contents));
+  return TFRecordDatasetParams(filenames,
+                               /*compression_type=*/
+                               CompressionType::UNCOMPRESSED,
+                               /*buffer_size=*/10,
+                               /*byte_offsets=*/{0, 0, 0},
+                               /*node_name=*/kNodeName);
+}
+
+TEST_F(TFRecordDatasetOpTest, RandomAccess) {
+  auto dataset_params = IndexedDatasetParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(dataset_->RandomIndexingCompatible());
+  CardinalityOptions options;
+  options.set_compute_level(CardinalityOptions::CARDINALITY_COMPUTE_MODERATE);
+  EXPECT_EQ(dataset_->Cardinality(options), 6);
+
+  std::vector<tstring> expected = {"1", "22", "333", "a", "bb", "ccc"};
+  std::vector<Tensor> out_tensors;
+  for (int64_t i = expected.size() - 1; i >= 0; --i) {
+    TF_ASSERT_OK(dataset_->Get(dataset_ctx_.get(), i, &out_tensors));
+    ASSERT_EQ(out_tensors.size(), 1);
+    EXPECT_EQ(out_tensors[0].scalar<tstring>()(), expected[i]);
+  }
+  EXPECT_EQ(dataset_->Get(dataset_ctx_.get(), 6, &out_tensors).code(),
+            absl::StatusCode::kOutOfRange);
+}
+
+// Reads from more files than are kept open, so that files are evicted and
+// opened again.
+TEST_F(TFRecordDatasetOpTest, RandomAccessManyFiles) {
+  constexpr int kNumFiles = 40;
+  std::vector<tstring> filenames;
+  std::vector<std::vector<string>> contents;
+  for (int i = 0; i < kNumFiles; ++i) {
+    filenames.push_back(
+        absl::StrCat(testing::TmpDir(), "/tf_record_INDEXED_MANY_", i));
+    contents.push_back({absl::StrCat(i, "a"), absl::StrCat(i, "b")});
+  }
+  TF_ASSERT_OK(CreateIndexedTestFiles(filenames, contents));
+  TFRecordDatasetParams dataset_params(
+      filenames, /*compression_type=*/CompressionType::UNCOMPRESSED,
+      /*buffer_size=*/10, /*byte_offsets=*/std::vector<int64_t>(kNumFiles, 0),
+      /*node_name=*/kNodeName);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  CardinalityOptions options;
+  options.set_compute_level(CardinalityOptions::CARDINALITY_COMPUTE_MODERATE);
+  EXPECT_EQ(dataset_->Cardinality(options), 2 * kNumFiles);
+
+  std::vector<Tensor> out_tensors;
+  for (int pass = 0; pass < 2; ++pass) {
+    // Alternates between the first and the second half of the files.
+    for (int i = 0; i < kNumFiles / 2; ++i) {
+      for (int file : {i, i + kNumFiles / 2}) {
+        TF_ASSERT_OK(
+            dataset_->Get(dataset_ctx_.get(), 2 * file + pass, &out_tensors));
+        ASSERT_EQ(out_tensors.size(), 1);
+        EXPECT_EQ(out_tensors[0].scalar<tstring>()(), contents[file][pass]);
+      }
+    }
+  }
+}
+
+TEST_F(TFRecordDatasetOpTest, RandomAccessRequiresIndex) {
+  auto dataset_params = TFRecordDatasetParams3();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  CardinalityOptions options;
+  options.set_compute_level(CardinalityOptions::CARDINALITY_COMPUTE_MODERATE);
+  EXPECT_EQ(dataset_->Cardinality(options), kUnknownCardinality);
+  std::vector<Tensor> out_tensors;
+  EXPECT_EQ(dataset_->Get(dataset_ctx_.get(), 0, &out_tensors).code(),
+            absl::StatusCode::kFailedPrecondition);
+}
+
+TEST_F(TFRecordDatasetOpTest, RandomAccessRequiresUncompressedFiles) {
+  auto dataset_params = TFRecordDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  EXPECT_EQ(dataset_->RandomIndexingCompatible().code(),
+            absl::StatusCode::kFailedPrecondition);
+}
+
 std::vector<IteratorSaveAndRestoreTestCase<TFRecordDatasetParams>>
 IteratorSaveAndRestoreTestCases() {
   return {
@@ -346,6 +554,10 @@ IteratorSaveAndRestoreTestCases() {
        CreateTensors<tstring>(
            TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})},
       {/*dataset_params=*/TFRecordDatasetParams3(),
+       /*breakpoints=*/{0, 2, 7},
+       CreateTensors<tstring>(
+           TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})},
+      {/*dataset_params=*/ReadaheadDatasetParams(),
        /*breakpoints=*/{0, 2, 7},
        CreateTensors<tstring>(
            TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})}};
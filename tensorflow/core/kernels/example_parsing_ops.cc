@@ -15,6 +15,8 @@ limitations under the License.
 
 // See docs in ../ops/parsing_ops.cc.
 
+#include <algorithm>
+#include <memory>
 #include <numeric>
 #include <unordered_set>
 #include <vector>
@@ -30,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 #include "tensorflow/core/util/example_proto_helper.h"
@@ -89,6 +92,7 @@ class ParseExampleOp : public OpKernel {
 
     example::FastParseExampleConfig config =
         MakeConfig(dense_keys_t, sparse_keys_t, ragged_keys_t, dense_defaults);
+    OP_REQUIRES_OK(ctx, SetFeatureNameIndex(&config));
 
     example::Result result;
     if (TensorShapeUtils::IsVector(serialized->shape())) {
@@ -234,6 +238,36 @@ class ParseExampleOp : public OpKernel {
     return config;
   }
 
+  // Sets the feature name index of `config`. The index of the previous call is
+  // reused if the keys have not changed, which is the case when the keys are
+  // constants.
+  Status SetFeatureNameIndex(example::FastParseExampleConfig* config) {
+    std::vector<StringPiece> keys;
+    keys.reserve(config->dense.size() + config->sparse.size() +
+                 config->ragged.size());
+    for (const auto& dense : config->dense) keys.push_back(dense.feature_name);
+    for (const auto& sparse : config->sparse) {
+      keys.push_back(sparse.feature_name);
+    }
+    for (const auto& ragged : config->ragged) {
+      keys.push_back(ragged.feature_name);
+    }
+    {
+      tf_shared_lock l(mu_);
+      if (feature_name_index_ != nullptr &&
+          std::equal(keys.begin(), keys.end(), feature_name_index_keys_.begin(),
+                     feature_name_index_keys_.end())) {
+        config->feature_name_index = feature_name_index_;
+        return absl::OkStatus();
+      }
+    }
+    TF_RETURN_IF_ERROR(example::CompileFastParseExampleConfig(config));
+    mutex_lock l(mu_);
+    feature_name_index_keys_.assign(keys.begin(), keys.end());
+    feature_name_index_ = config->feature_name_index;
+    return absl::OkStatus();
+  }
+
   // Parses a single example.
   Status ParseExampleScalar(const example::FastParseExampleConfig& config,
                             const Tensor* serialized, OpKernelContext* ctx,
@@ -290,6 +324,11 @@ class ParseExampleOp : public OpKernel {
   ParseExampleAttrs attrs_;
   int op_version_;
   absl::once_flag flag_;
+  mutex mu_;
+  // Keys and feature name index of the most recent call.
+  std::vector<tstring> feature_name_index_keys_ TF_GUARDED_BY(mu_);
+  std::shared_ptr<const example::FeatureNameIndex> feature_name_index_
+      TF_GUARDED_BY(mu_);
 };
 
 REGISTER_KERNEL_BUILDER(Name("ParseExample").Device(DEVICE_CPU),
@@ -303,6 +342,18 @@ class ParseSingleExampleOp : public OpKernel {
     OP_REQUIRES_OK(ctx, attrs_.Init(ctx));
     metrics::RecordParseDenseFeature(attrs_.dense_keys.size());
     metrics::RecordParseSparseFeature(attrs_.sparse_keys.size());
+    // The keys are attributes, so the configuration is built once. Only the
+    // dense defaults are filled in for each call.
+    for (int d = 0; d < attrs_.dense_keys.size(); ++d) {
+      config_.dense.push_back({attrs_.dense_keys[d], attrs_.dense_types[d],
+                               attrs_.dense_shapes[d], Tensor(),
+                               attrs_.variable_length[d],
+                               attrs_.elements_per_stride[d]});
+    }
+    for (int d = 0; d < attrs_.sparse_keys.size(); ++d) {
+      config_.sparse.push_back({attrs_.sparse_keys[d], attrs_.sparse_types[d]});
+    }
+    OP_REQUIRES_OK(ctx, example::CompileFastParseExampleConfig(&config_));
   }
 
   void Compute(OpKernelContext* ctx) override {
@@ -353,16 +404,9 @@ class ParseSingleExampleOp : public OpKernel {
 
     example::Result result;
 
-    // TODO(mrry): Build the configuration once and cache it.
-    example::FastParseExampleConfig config;
+    example::FastParseExampleConfig config = config_;
     for (int d = 0; d < attrs_.dense_keys.size(); ++d) {
-      config.dense.push_back({attrs_.dense_keys[d], attrs_.dense_types[d],
-                              attrs_.dense_shapes[d], dense_defaults[d],
-                              attrs_.variable_length[d],
-                              attrs_.elements_per_stride[d]});
-    }
-    for (int d = 0; d < attrs_.sparse_keys.size(); ++d) {
-      config.sparse.push_back({attrs_.sparse_keys[d], attrs_.sparse_types[d]});
+      config.dense[d].default_value = dense_defaults[d];
     }
 
     const tstring& serialized_proto = serialized->scalar<tstring>()();
@@ -390,6 +434,7 @@ class ParseSingleExampleOp : public OpKernel {
 
  protected:
   ParseSingleExampleAttrs attrs_;
+  example::FastParseExampleConfig config_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("ParseSingleExample").Device(DEVICE_CPU),
@@ -16,17 +16,23 @@ limitations under the License.
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #define EIGEN_USE_THREADS
 
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/variant.h"
 #include "tensorflow/core/kernels/initializable_lookup_table.h"
+#include "tensorflow/core/lib/core/bits.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/platform/prefetch.h"
 #include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 namespace lookup {
@@ -410,6 +416,457 @@ class MutableHashTableOfTensors final : public LookupInterface {
 
 namespace {
 
+// Finalizer of MurmurHash3. Integer keys are often sequential ids, so they are
+// mixed before their high bits are used to select a shard.
+inline uint64 MixHash(uint64 h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+template <typename T>
+inline uint64 ShardedHashKey(const T& key) {
+  return MixHash(static_cast<uint64>(key));
+}
+
+inline uint64 ShardedHashKey(const tstring& key) { return Hash64(key); }
+
+}  // namespace
+
+// Lookup table that stripes its entries across `num_shards` independently
+// locked shards. Each shard is an open-addressing table with linear probing
+// that keeps its keys, slot states and values in flat arrays. Concurrent Find
+// and Insert calls therefore only contend when they touch the same shard, and
+// a batch of keys takes each shard lock at most once.
+//
+// Values can be scalars or vectors. ExportValues produces the same layout as
+// MutableHashTableOfScalars and MutableHashTableOfTensors, so checkpoints can
+// be restored into either kind of table.
+template <class K, class V>
+class ShardedMutableHashTable final : public LookupInterface {
+ public:
+  ShardedMutableHashTable(OpKernelContext* ctx, OpKernel* kernel) {
+    OP_REQUIRES_OK(ctx,
+                   GetNodeAttr(kernel->def(), "value_shape", &value_shape_));
+    OP_REQUIRES(ctx,
+                TensorShapeUtils::IsScalar(value_shape_) ||
+                    TensorShapeUtils::IsVector(value_shape_),
+                errors::InvalidArgument(
+                    "Default value must be a scalar or a vector, got shape ",
+                    value_shape_.DebugString()));
+    OP_REQUIRES_OK(ctx, GetNodeAttr(kernel->def(), "num_shards", &num_shards_));
+    OP_REQUIRES(ctx, num_shards_ > 0 && (num_shards_ & (num_shards_ - 1)) == 0,
+                errors::InvalidArgument(
+                    "num_shards must be a positive power of 2, got: ",
+                    num_shards_));
+    value_dim_ = value_shape_.num_elements();
+    shard_bits_ = Log2Floor64(num_shards_);
+    shards_.reset(new Shard[num_shards_]);
+  }
+
+  size_t size() const override {
+    size_t total = 0;
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      tf_shared_lock l(shards_[s].mu);
+      total += shards_[s].num_entries;
+    }
+    return total;
+  }
+
+  Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
+              const Tensor& default_value) override {
+    const auto key_values = key.flat<K>();
+    const int64_t num_keys = key_values.size();
+    auto value_matrix = value->shaped<V, 2>({num_keys, value_dim_});
+
+    // is_full_size_default is true:
+    //   Each key has an independent default value, key_values(i)
+    //   corresponding uses default_matrix(i) as its default value.
+    //
+    // is_full_size_default is false:
+    //   All keys will share the default_matrix(0) as default value.
+    const bool is_full_size_default =
+        num_keys > 1 && default_value.NumElements() == num_keys * value_dim_;
+    const auto default_matrix = default_value.shaped<V, 2>(
+        {is_full_size_default ? num_keys : 1, value_dim_});
+
+    std::vector<uint64> hashes;
+    std::vector<int64_t> offsets;
+    std::vector<int64_t> order;
+    PartitionByShard(key_values, &hashes, &offsets, &order);
+
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      if (offsets[s] == offsets[s + 1]) continue;
+      const Shard& shard = shards_[s];
+      tf_shared_lock l(shard.mu);
+      for (int64_t n = offsets[s]; n < offsets[s + 1]; ++n) {
+        const int64_t i = order[n];
+        const int64_t slot = FindSlot(
+            shard, SubtleMustCopyIfIntegral(key_values(i)), hashes[i]);
+        if (slot >= 0) {
+          const V* found = shard.values.data() + slot * value_dim_;
+          for (int64_t j = 0; j < value_dim_; ++j) {
+            value_matrix(i, j) = found[j];
+          }
+        } else {
+          const int64_t default_row = is_full_size_default ? i : 0;
+          for (int64_t j = 0; j < value_dim_; ++j) {
+            value_matrix(i, j) = default_matrix(default_row, j);
+          }
+        }
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  Status Insert(OpKernelContext* ctx, const Tensor& keys,
+                const Tensor& values) override {
+    return DoInsert(false, keys, values);
+  }
+
+  Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
+    const auto key_values = keys.flat<K>();
+
+    std::vector<uint64> hashes;
+    std::vector<int64_t> offsets;
+    std::vector<int64_t> order;
+    PartitionByShard(key_values, &hashes, &offsets, &order);
+
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      if (offsets[s] == offsets[s + 1]) continue;
+      Shard* shard = &shards_[s];
+      mutex_lock l(shard->mu);
+      for (int64_t n = offsets[s]; n < offsets[s + 1]; ++n) {
+        const int64_t i = order[n];
+        const int64_t slot = FindSlot(
+            *shard, SubtleMustCopyIfIntegral(key_values(i)), hashes[i]);
+        if (slot >= 0) {
+          shard->states[slot] = kDeleted;
+          shard->keys[slot] = K();
+          --shard->num_entries;
+          ++shard->num_deleted;
+        }
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
+                      const Tensor& values) override {
+    return DoInsert(true, keys, values);
+  }
+
+  Status ExportValues(OpKernelContext* ctx) override {
+    LockAllShardsShared();
+    const int64_t size = TotalEntries();
+    TensorShape values_shape({size});
+    values_shape.AppendShape(value_shape_);
+
+    Tensor* keys;
+    Tensor* values;
+    Status s = ctx->allocate_output("keys", TensorShape({size}), &keys);
+    if (s.ok()) {
+      s = ctx->allocate_output("values", values_shape, &values);
+    }
+    if (s.ok()) {
+      ExportKeysAndValues(keys, values);
+    }
+    UnlockAllShardsShared();
+    return s;
+  }
+
+  DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
+
+  DataType value_dtype() const override { return DataTypeToEnum<V>::v(); }
+
+  TensorShape key_shape() const final { return TensorShape(); }
+
+  TensorShape value_shape() const override { return value_shape_; }
+
+  int64_t MemoryUsed() const override {
+    int64_t ret = 0;
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      tf_shared_lock l(shards_[s].mu);
+      ret += shards_[s].states.size() *
+             (sizeof(uint8) + sizeof(K) + value_dim_ * sizeof(V));
+    }
+    return sizeof(ShardedMutableHashTable) + num_shards_ * sizeof(Shard) + ret;
+  }
+
+  Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
+    LockAllShardsShared();
+    const int64_t size = TotalEntries();
+    TensorShape values_shape({size});
+    values_shape.AppendShape(value_shape_);
+    Tensor keys(key_dtype(), TensorShape({size}));
+    Tensor values(value_dtype(), values_shape);
+    ExportKeysAndValues(&keys, &values);
+    UnlockAllShardsShared();
+
+    // We set use_node_name_sharing with a unique node name so that the resource
+    // can outlive the MutableShardedHashTable kernel. This means that the
+    // lifetime of the resource will be tied to the lifetime of the resource
+    // manager it is created in.
+    Node* table = ops::SourceOp(
+        "MutableShardedHashTable",
+        builder->opts()
+            .WithName(UniqueNodeName("MutableShardedHashTableFromGraphDef"))
+            .WithAttr("use_node_name_sharing", true)
+            .WithAttr("key_dtype", key_dtype())
+            .WithAttr("value_dtype", value_dtype())
+            .WithAttr("value_shape", value_shape_)
+            .WithAttr("num_shards", num_shards_));
+    Node* keys_node = ops::SourceOp(
+        "Const",
+        builder->opts().WithAttr("dtype", key_dtype()).WithAttr("value", keys));
+    Node* values_node =
+        ops::SourceOp("Const", builder->opts()
+                                   .WithAttr("dtype", value_dtype())
+                                   .WithAttr("value", values));
+    Node* import_table =
+        ops::TernaryOp("LookupTableImportV2", table, keys_node, values_node,
+                       builder->opts()
+                           .WithAttr("Tin", key_dtype())
+                           .WithAttr("Tout", value_dtype()));
+    *out = ops::UnaryOp("Identity", table,
+                        builder->opts().WithControlInput(import_table));
+    return absl::OkStatus();
+  }
+
+ private:
+  // Slot states.
+  static constexpr uint8 kEmpty = 0;
+  static constexpr uint8 kFull = 1;
+  static constexpr uint8 kDeleted = 2;
+
+  // Shards never hold fewer slots than this once they have been written to.
+  static constexpr int64_t kMinShardCapacity = 16;
+
+  // Values are addressed through data(), which std::vector<bool> lacks.
+  using ValueVector = gtl::InlinedVector<V, 4>;
+
+  struct Shard {
+    mutable mutex mu;
+    int64_t num_entries TF_GUARDED_BY(mu) = 0;
+    int64_t num_deleted TF_GUARDED_BY(mu) = 0;
+    // One of kEmpty, kFull or kDeleted for each slot. The number of slots is
+    // either zero or a power of 2.
+    std::vector<uint8> states TF_GUARDED_BY(mu);
+    std::vector<K> keys TF_GUARDED_BY(mu);
+    // `value_dim_` values per slot, stored contiguously.
+    ValueVector values TF_GUARDED_BY(mu);
+  };
+
+  int64_t ShardIndex(uint64 hash) const {
+    return shard_bits_ == 0 ? 0
+                            : static_cast<int64_t>(hash >> (64 - shard_bits_));
+  }
+
+  // Computes the hash of every key and groups the key indices by shard, so
+  // that `order[offsets[s]:offsets[s + 1]]` are the indices of the keys that
+  // belong to shard `s`.
+  void PartitionByShard(typename TTypes<K>::ConstFlat keys,
+                        std::vector<uint64>* hashes,
+                        std::vector<int64_t>* offsets,
+                        std::vector<int64_t>* order) const {
+    const int64_t num_keys = keys.size();
+    hashes->resize(num_keys);
+    offsets->assign(num_shards_ + 1, 0);
+    order->resize(num_keys);
+    for (int64_t i = 0; i < num_keys; ++i) {
+      (*hashes)[i] = ShardedHashKey(SubtleMustCopyIfIntegral(keys(i)));
+      ++(*offsets)[ShardIndex((*hashes)[i]) + 1];
+    }
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      (*offsets)[s + 1] += (*offsets)[s];
+    }
+    std::vector<int64_t> next(offsets->begin(), offsets->end() - 1);
+    for (int64_t i = 0; i < num_keys; ++i) {
+      (*order)[next[ShardIndex((*hashes)[i])]++] = i;
+    }
+  }
+
+  // Returns the slot holding `key` in `shard`, or -1 if it is not present.
+  int64_t FindSlot(const Shard& shard, const K& key, uint64 hash) const
+      TF_SHARED_LOCKS_REQUIRED(shard.mu) {
+    const int64_t capacity = shard.states.size();
+    if (capacity == 0) return -1;
+    const int64_t mask = capacity - 1;
+    int64_t slot = hash & mask;
+    for (int64_t num_probes = 0; num_probes < capacity; ++num_probes) {
+      const uint8 state = shard.states[slot];
+      if (state == kEmpty) return -1;
+      if (state == kFull && shard.keys[slot] == key) return slot;
+      slot = (slot + 1) & mask;
+    }
+    return -1;
+  }
+
+  // Grows (or compacts) `shard` so that `num_pending` more entries fit under
+  // the maximum load factor of 3/4. Deleted slots count towards the load and
+  // are dropped when the shard is rebuilt.
+  void ReserveInShard(Shard* shard, int64_t num_pending)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(shard->mu) {
+    const int64_t capacity = shard->states.size();
+    const int64_t required =
+        shard->num_entries + shard->num_deleted + num_pending;
+    if (required * 4 <= capacity * 3) return;
+
+    int64_t new_capacity = kMinShardCapacity;
+    while ((shard->num_entries + num_pending) * 4 > new_capacity * 3) {
+      new_capacity <<= 1;
+    }
+    std::vector<uint8> old_states = std::move(shard->states);
+    std::vector<K> old_keys = std::move(shard->keys);
+    ValueVector old_values = std::move(shard->values);
+    shard->states.assign(new_capacity, kEmpty);
+    shard->keys.assign(new_capacity, K());
+    shard->values.assign(new_capacity * value_dim_, V());
+    shard->num_entries = 0;
+    shard->num_deleted = 0;
+    for (int64_t slot = 0; slot < capacity; ++slot) {
+      if (old_states[slot] != kFull) continue;
+      InsertIntoShard(shard, old_keys[slot], ShardedHashKey(old_keys[slot]),
+                      old_values.data() + slot * value_dim_);
+    }
+  }
+
+  // Inserts or updates `key` in `shard`. The shard must have room for one
+  // more entry, see ReserveInShard().
+  void InsertIntoShard(Shard* shard, const K& key, uint64 hash, const V* value)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(shard->mu) {
+    const int64_t mask = shard->states.size() - 1;
+    int64_t slot = hash & mask;
+    int64_t first_deleted = -1;
+    while (shard->states[slot] != kEmpty) {
+      if (shard->states[slot] == kDeleted) {
+        if (first_deleted < 0) first_deleted = slot;
+      } else if (shard->keys[slot] == key) {
+        std::copy_n(value, value_dim_,
+                    shard->values.data() + slot * value_dim_);
+        return;
+      }
+      slot = (slot + 1) & mask;
+    }
+    if (first_deleted >= 0) {
+      slot = first_deleted;
+      --shard->num_deleted;
+    }
+    shard->states[slot] = kFull;
+    shard->keys[slot] = key;
+    std::copy_n(value, value_dim_, shard->values.data() + slot * value_dim_);
+    ++shard->num_entries;
+  }
+
+  Status DoInsert(bool clear, const Tensor& keys, const Tensor& values) {
+    const auto key_values = keys.flat<K>();
+    const int64_t num_keys = key_values.size();
+    const auto value_matrix = values.shaped<V, 2>({num_keys, value_dim_});
+
+    std::vector<uint64> hashes;
+    std::vector<int64_t> offsets;
+    std::vector<int64_t> order;
+    PartitionByShard(key_values, &hashes, &offsets, &order);
+
+    ValueVector value_row(value_dim_);
+    auto insert_into_shard = [&](int64_t s) TF_NO_THREAD_SAFETY_ANALYSIS {
+      Shard* shard = &shards_[s];
+      // For simplicity we assume that all keys result in inserts rather than
+      // updates, which may grow the shard more than necessary.
+      ReserveInShard(shard, offsets[s + 1] - offsets[s]);
+      for (int64_t n = offsets[s]; n < offsets[s + 1]; ++n) {
+        const int64_t i = order[n];
+        for (int64_t j = 0; j < value_dim_; ++j) {
+          value_row[j] = SubtleMustCopyIfIntegral(value_matrix(i, j));
+        }
+        InsertIntoShard(shard, SubtleMustCopyIfIntegral(key_values(i)),
+                        hashes[i], value_row.data());
+      }
+    };
+
+    if (clear) {
+      // Imports replace the whole table atomically.
+      LockAllShards();
+      for (int64_t s = 0; s < num_shards_; ++s) {
+        ClearShard(&shards_[s]);
+        insert_into_shard(s);
+      }
+      UnlockAllShards();
+      return absl::OkStatus();
+    }
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      if (offsets[s] == offsets[s + 1]) continue;
+      mutex_lock l(shards_[s].mu);
+      insert_into_shard(s);
+    }
+    return absl::OkStatus();
+  }
+
+  void ClearShard(Shard* shard) TF_EXCLUSIVE_LOCKS_REQUIRED(shard->mu) {
+    shard->states.clear();
+    shard->keys.clear();
+    shard->values.clear();
+    shard->num_entries = 0;
+    shard->num_deleted = 0;
+  }
+
+  // Shard locks are always acquired in index order when several of them are
+  // held at once.
+  void LockAllShards() const TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (int64_t s = 0; s < num_shards_; ++s) shards_[s].mu.lock();
+  }
+  void UnlockAllShards() const TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (int64_t s = num_shards_ - 1; s >= 0; --s) shards_[s].mu.unlock();
+  }
+  void LockAllShardsShared() const TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (int64_t s = 0; s < num_shards_; ++s) shards_[s].mu.lock_shared();
+  }
+  void UnlockAllShardsShared() const TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (int64_t s = num_shards_ - 1; s >= 0; --s) {
+      shards_[s].mu.unlock_shared();
+    }
+  }
+
+  // Requires all shard locks to be held.
+  int64_t TotalEntries() const TF_NO_THREAD_SAFETY_ANALYSIS {
+    int64_t total = 0;
+    for (int64_t s = 0; s < num_shards_; ++s) total += shards_[s].num_entries;
+    return total;
+  }
+
+  // Writes all keys and values into `keys` and `values`, which must have
+  // TotalEntries() rows. Requires all shard locks to be held.
+  void ExportKeysAndValues(Tensor* keys, Tensor* values) const
+      TF_NO_THREAD_SAFETY_ANALYSIS {
+    auto keys_data = keys->flat<K>();
+    auto values_data = values->shaped<V, 2>({keys_data.size(), value_dim_});
+    int64_t i = 0;
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      const Shard& shard = shards_[s];
+      const int64_t capacity = shard.states.size();
+      for (int64_t slot = 0; slot < capacity; ++slot) {
+        if (shard.states[slot] != kFull) continue;
+        keys_data(i) = shard.keys[slot];
+        for (int64_t j = 0; j < value_dim_; ++j) {
+          values_data(i, j) = shard.values[slot * value_dim_ + j];
+        }
+        ++i;
+      }
+    }
+  }
+
+  TensorShape value_shape_;
+  int64_t value_dim_;
+  int64_t num_shards_;
+  int shard_bits_;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+namespace {
+
 template <typename T>
 inline uint64 HashScalar(const T& key) {
   return static_cast<uint64>(key);
@@ -508,59 +965,32 @@ class MutableDenseHashTable final : public LookupInterface {
                                      expected_shape.DebugString(), " got ",
                                      key.shape().DebugString());
     }
-    const auto key_matrix = key.shaped<K, 2>({num_elements, key_size});
-    auto value_matrix = value->shaped<V, 2>({num_elements, value_size});
-    const auto default_flat = default_value.flat<V>();
+    const K* key_data = key.flat<K>().data();
+    V* value_data = value->flat<V>().data();
+    const V* default_data = default_value.flat<V>().data();
 
     tf_shared_lock l(mu_);
-    const auto key_buckets_matrix = key_buckets_.template matrix<K>();
-    const auto value_buckets_matrix = value_buckets_.template matrix<V>();
-    const auto empty_key_matrix =
-        empty_key_.template shaped<K, 2>({1, key_size});
-    const auto deleted_key_matrix =
-        deleted_key_.template shaped<K, 2>({1, key_size});
+    const K* key_buckets = key_buckets_.template flat<K>().data();
+    const V* value_buckets = value_buckets_.template flat<V>().data();
     const int64_t bit_mask = num_buckets_ - 1;
-    // TODO(andreasst): parallelize using work_sharder
-    for (int64_t i = 0; i < num_elements; ++i) {
-      const uint64 key_hash = HashKey(key_matrix, i);
-      if (empty_key_hash_ == key_hash &&
-          IsEqualKey(empty_key_matrix, 0, key_matrix, i)) {
-        return errors::InvalidArgument(
-            "Using the empty_key as a table key is not allowed");
-      }
-      if (deleted_key_hash_ == key_hash &&
-          IsEqualKey(deleted_key_matrix, 0, key_matrix, i)) {
-        return errors::InvalidArgument(
-            "Using the deleted_key as a table key is not allowed");
-      }
-      int64_t bucket_index = key_hash & bit_mask;
-      int64_t num_probes = 0;
-      while (true) {
-        if (IsEqualKey(key_buckets_matrix, bucket_index, key_matrix, i)) {
-          for (int64_t j = 0; j < value_size; ++j) {
-            // TODO(andreasst): check if we can get rid of SubtleMustCopy
-            // here and elsewhere in this file.
-            value_matrix(i, j) =
-                SubtleMustCopyIfIntegral(value_buckets_matrix(bucket_index, j));
-          }
-          break;
-        }
-        if (IsEqualKey(key_buckets_matrix, bucket_index, empty_key_matrix, 0)) {
-          for (int64_t j = 0; j < value_size; ++j) {
-            value_matrix(i, j) = SubtleMustCopyIfIntegral(default_flat(j));
-          }
-          break;
-        }
-        ++num_probes;
-        bucket_index =
-            (bucket_index + num_probes) & bit_mask;  // quadratic probing
-        if (num_probes >= num_buckets_) {
-          return errors::Internal(
-              "Internal error in MutableDenseHashTable lookup");
-        }
+
+    // Large batches are split across the intra-op threads. The buckets are
+    // only read here, so the shards can share the lock held by this thread.
+    mutex status_mu;
+    Status status;
+    auto find_range = [&](int64_t begin, int64_t end) {
+      Status s = FindRange(key_data, begin, end, key_buckets, value_buckets,
+                           bit_mask, default_data, value_data);
+      if (!s.ok()) {
+        mutex_lock status_lock(status_mu);
+        status.Update(s);
       }
-    }
-    return absl::OkStatus();
+    };
+    const int64_t cost_per_key = 50 * (key_size + value_size);
+    auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, num_elements,
+          cost_per_key, find_range);
+    return status;
   }
 
   Status Insert(OpKernelContext* ctx, const Tensor& key,
@@ -840,6 +1270,95 @@ class MutableDenseHashTable final : public LookupInterface {
     return DoInsert(ctx, old_key_buckets, old_value_buckets, true);
   }
 
+  // Looks up the keys with indices [begin, end) and writes their values, or
+  // `default_value` for missing keys, into `values`. Keys are processed in
+  // blocks: the hashes of a whole block are computed and the home buckets of
+  // its keys prefetched before any of them is probed, so that the cache misses
+  // of the keys in a block overlap instead of being paid one after the other.
+  Status FindRange(const K* keys, int64_t begin, int64_t end,
+                   const K* key_buckets, const V* value_buckets,
+                   int64_t bit_mask, const V* default_value, V* values) const {
+    constexpr int64_t kFindBlockSize = 32;
+    const int64_t key_size = key_shape_.num_elements();
+    const int64_t value_size = value_shape_.num_elements();
+    const K* empty_key = empty_key_.template flat<K>().data();
+    const K* deleted_key = deleted_key_.template flat<K>().data();
+    uint64 hashes[kFindBlockSize];
+    for (int64_t block_begin = begin; block_begin < end;
+         block_begin += kFindBlockSize) {
+      const int64_t block_end = std::min(end, block_begin + kFindBlockSize);
+      for (int64_t i = block_begin; i < block_end; ++i) {
+        const K* key = keys + i * key_size;
+        const uint64 key_hash = HashKey(key);
+        if (empty_key_hash_ == key_hash && IsEqualKey(empty_key, key)) {
+          return errors::InvalidArgument(
+              "Using the empty_key as a table key is not allowed");
+        }
+        if (deleted_key_hash_ == key_hash && IsEqualKey(deleted_key, key)) {
+          return errors::InvalidArgument(
+              "Using the deleted_key as a table key is not allowed");
+        }
+        const int64_t bucket_index = key_hash & bit_mask;
+        port::prefetch<port::PREFETCH_HINT_T0>(key_buckets +
+                                               bucket_index * key_size);
+        port::prefetch<port::PREFETCH_HINT_T0>(value_buckets +
+                                               bucket_index * value_size);
+        hashes[i - block_begin] = key_hash;
+      }
+      for (int64_t i = block_begin; i < block_end; ++i) {
+        const K* key = keys + i * key_size;
+        int64_t bucket_index = hashes[i - block_begin] & bit_mask;
+        int64_t num_probes = 0;
+        const V* found;
+        while (true) {
+          const K* bucket_key = key_buckets + bucket_index * key_size;
+          if (IsEqualKey(bucket_key, key)) {
+            found = value_buckets + bucket_index * value_size;
+            break;
+          }
+          if (IsEqualKey(bucket_key, empty_key)) {
+            found = default_value;
+            break;
+          }
+          ++num_probes;
+          bucket_index =
+              (bucket_index + num_probes) & bit_mask;  // quadratic probing
+          if (num_probes > bit_mask) {
+            return errors::Internal(
+                "Internal error in MutableDenseHashTable lookup");
+          }
+        }
+        V* out = values + i * value_size;
+        for (int64_t j = 0; j < value_size; ++j) {
+          // TODO(andreasst): check if we can get rid of SubtleMustCopy
+          // here and elsewhere in this file.
+          out[j] = SubtleMustCopyIfIntegral(found[j]);
+        }
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  uint64 HashKey(const K* key) const {
+    if (key_shape_.num_elements() == 1) {
+      return HashScalar(key[0]);
+    }
+    uint64 result = 0;
+    for (int64_t i = 0; i < key_shape_.num_elements(); ++i) {
+      result = Hash64Combine(result, HashScalar(key[i]));
+    }
+    return result;
+  }
+
+  bool IsEqualKey(const K* key1, const K* key2) const {
+    for (int64_t i = 0; i < key_shape_.num_elements(); ++i) {
+      if (key1[i] != key2[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   uint64 HashKey(typename TTypes<K>::ConstMatrix key, int64_t index) const {
     if (key_shape_.num_elements() == 1) {
       return HashScalar(key(index, 0));
@@ -1146,6 +1665,7 @@ REGISTER_KERNEL(tstring, tstring);
 REGISTER_KERNEL(int32, double);
 REGISTER_KERNEL(int32, float);
 REGISTER_KERNEL(int32, int32);
+REGISTER_KERNEL(int32, tstring);
 REGISTER_KERNEL(int64_t, double);
 REGISTER_KERNEL(int64_t, float);
 REGISTER_KERNEL(int64_t, int32);
@@ -1157,6 +1677,7 @@ REGISTER_KERNEL(tstring, double);
 REGISTER_KERNEL(tstring, float);
 REGISTER_KERNEL(tstring, int32);
 REGISTER_KERNEL(tstring, int64_t);
+REGISTER_KERNEL(tstring, tstring);
 
 #undef REGISTER_KERNEL
 
@@ -1201,6 +1722,35 @@ REGISTER_KERNEL(tstring, int64_t);
 
 #undef REGISTER_KERNEL
 
+// Register the MutableShardedHashTable op.
+#define REGISTER_KERNEL(key_dtype, value_dtype)                              \
+  REGISTER_KERNEL_BUILDER(                                                   \
+      Name("MutableShardedHashTable")                                        \
+          .Device(DEVICE_CPU)                                                \
+          .TypeConstraint<key_dtype>("key_dtype")                            \
+          .TypeConstraint<value_dtype>("value_dtype"),                       \
+      LookupTableOp<lookup::ShardedMutableHashTable<key_dtype, value_dtype>, \
+                    key_dtype, value_dtype>)
+
+REGISTER_KERNEL(int32, double);
+REGISTER_KERNEL(int32, float);
+REGISTER_KERNEL(int32, int32);
+REGISTER_KERNEL(int32, tstring);
+REGISTER_KERNEL(int64_t, double);
+REGISTER_KERNEL(int64_t, float);
+REGISTER_KERNEL(int64_t, int32);
+REGISTER_KERNEL(int64_t, int64_t);
+REGISTER_KERNEL(int64_t, tstring);
+REGISTER_KERNEL(int64_t, Variant);
+REGISTER_KERNEL(tstring, bool);
+REGISTER_KERNEL(tstring, double);
+REGISTER_KERNEL(tstring, float);
+REGISTER_KERNEL(tstring, int32);
+REGISTER_KERNEL(tstring, int64_t);
+REGISTER_KERNEL(tstring, tstring);
+
+#undef REGISTER_KERNEL
+
 // Register the MutableDenseHashTable op.
 #define REGISTER_KERNEL(key_dtype, value_dtype)                             \
   REGISTER_KERNEL_BUILDER(                                                  \
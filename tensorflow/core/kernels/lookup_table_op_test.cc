@@ -0,0 +1,464 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Tests and benchmarks of the mutable lookup tables, run through a session.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+namespace {
+
+Node* MutableHashTable(Graph* g, const string& shared_name) {
+  Node* table;
+  TF_CHECK_OK(NodeBuilder(g->NewName("table"), "MutableHashTableV2")
+                  .Attr("shared_name", shared_name)
+                  .Attr("key_dtype", DT_INT64)
+                  .Attr("value_dtype", DT_FLOAT)
+                  .Finalize(g, &table));
+  return table;
+}
+
+Node* MutableShardedHashTable(Graph* g, const string& shared_name,
+                              const TensorShape& value_shape,
+                              int64_t num_shards,
+                              DataType key_dtype = DT_INT64,
+                              DataType value_dtype = DT_FLOAT) {
+  Node* table;
+  TF_CHECK_OK(NodeBuilder(g->NewName("table"), "MutableShardedHashTable")
+                  .Attr("shared_name", shared_name)
+                  .Attr("key_dtype", key_dtype)
+                  .Attr("value_dtype", value_dtype)
+                  .Attr("value_shape", value_shape)
+                  .Attr("num_shards", num_shards)
+                  .Finalize(g, &table));
+  return table;
+}
+
+template <typename K>
+Node* MutableDenseHashTable(Graph* g, const TensorShape& key_shape,
+                            const K& empty_key, const K& deleted_key,
+                            int64_t initial_num_buckets,
+                            float max_load_factor) {
+  Tensor empty_key_tensor(DataTypeToEnum<K>::v(), key_shape);
+  empty_key_tensor.flat<K>().setConstant(empty_key);
+  Tensor deleted_key_tensor(DataTypeToEnum<K>::v(), key_shape);
+  deleted_key_tensor.flat<K>().setConstant(deleted_key);
+  Node* table;
+  TF_CHECK_OK(NodeBuilder(g->NewName("table"), "MutableDenseHashTableV2")
+                  .Input(test::graph::Constant(g, empty_key_tensor))
+                  .Input(test::graph::Constant(g, deleted_key_tensor))
+                  .Attr("shared_name", "table")
+                  .Attr("value_dtype", DT_FLOAT)
+                  .Attr("value_shape", TensorShape({}))
+                  .Attr("initial_num_buckets", initial_num_buckets)
+                  .Attr("max_load_factor", max_load_factor)
+                  .Finalize(g, &table));
+  return table;
+}
+
+Node* Insert(Graph* g, Node* table, Node* keys, Node* values) {
+  Node* ret;
+  TF_CHECK_OK(NodeBuilder(g->NewName("insert"), "LookupTableInsertV2")
+                  .Input(table)
+                  .Input(keys)
+                  .Input(values)
+                  .Finalize(g, &ret));
+  return ret;
+}
+
+Node* Find(Graph* g, Node* table, Node* keys, Node* default_value) {
+  Node* ret;
+  TF_CHECK_OK(NodeBuilder(g->NewName("find"), "LookupTableFindV2")
+                  .Input(table)
+                  .Input(keys)
+                  .Input(default_value)
+                  .Finalize(g, &ret));
+  return ret;
+}
+
+Node* Remove(Graph* g, Node* table, Node* keys) {
+  Node* ret;
+  TF_CHECK_OK(NodeBuilder(g->NewName("remove"), "LookupTableRemoveV2")
+                  .Input(table)
+                  .Input(keys)
+                  .Finalize(g, &ret));
+  return ret;
+}
+
+Node* Size(Graph* g, Node* table) {
+  Node* ret;
+  TF_CHECK_OK(NodeBuilder(g->NewName("size"), "LookupTableSizeV2")
+                  .Input(table)
+                  .Finalize(g, &ret));
+  return ret;
+}
+
+Node* Export(Graph* g, Node* table) {
+  Node* ret;
+  TF_CHECK_OK(NodeBuilder(g->NewName("export"), "LookupTableExportV2")
+                  .Input(table)
+                  .Attr("Tkeys", DT_INT64)
+                  .Attr("Tvalues", DT_FLOAT)
+                  .Finalize(g, &ret));
+  return ret;
+}
+
+Node* Import(Graph* g, Node* table, NodeBuilder::NodeOut keys,
+             NodeBuilder::NodeOut values) {
+  Node* ret;
+  TF_CHECK_OK(NodeBuilder(g->NewName("import"), "LookupTableImportV2")
+                  .Input(table)
+                  .Input(keys)
+                  .Input(values)
+                  .Finalize(g, &ret));
+  return ret;
+}
+
+Tensor Range(int64_t start, int64_t limit) {
+  Tensor t(DT_INT64, TensorShape({limit - start}));
+  for (int64_t i = start; i < limit; ++i) {
+    t.flat<int64_t>()(i - start) = i;
+  }
+  return t;
+}
+
+std::unique_ptr<Session> CreateSession(const Graph& g, int threads = 0) {
+  GraphDef gd;
+  g.ToGraphDef(&gd);
+  SessionOptions opts;
+  opts.config.set_inter_op_parallelism_threads(threads);
+  std::unique_ptr<Session> session(NewSession(opts));
+  TF_CHECK_OK(session->Create(gd));
+  return session;
+}
+
+TEST(ShardedMutableHashTableTest, InsertFindRemove) {
+  Graph g(OpRegistry::Global());
+  Node* table = MutableShardedHashTable(&g, "table", TensorShape({}), 4);
+
+  constexpr int64_t kNumKeys = 1000;
+  Tensor values(DT_FLOAT, TensorShape({kNumKeys}));
+  for (int64_t i = 0; i < kNumKeys; ++i) {
+    values.flat<float>()(i) = 2.0f * i;
+  }
+  Node* insert =
+      Insert(&g, table, test::graph::Constant(&g, Range(0, kNumKeys)),
+             test::graph::Constant(&g, values));
+  Node* find = Find(&g, table, test::graph::Constant(&g, Range(995, 1005)),
+                    test::graph::Constant(&g, test::AsScalar<float>(-1.0f)));
+  Node* remove =
+      Remove(&g, table, test::graph::Constant(&g, Range(990, kNumKeys)));
+  Node* size = Size(&g, table);
+
+  std::unique_ptr<Session> session = CreateSession(g);
+  TF_ASSERT_OK(session->Run({}, {}, {insert->name()}, nullptr));
+
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->Run({}, {find->name(), size->name()}, {}, &outputs));
+  test::ExpectTensorEqual<float>(
+      outputs[0], test::AsTensor<float>({1990, 1992, 1994, 1996, 1998, -1, -1,
+                                         -1, -1, -1}));
+  test::ExpectTensorEqual<int64_t>(outputs[1], test::AsScalar<int64_t>(1000));
+
+  TF_ASSERT_OK(session->Run({}, {}, {remove->name()}, nullptr));
+  TF_ASSERT_OK(session->Run({}, {find->name(), size->name()}, {}, &outputs));
+  test::ExpectTensorEqual<float>(
+      outputs[0],
+      test::AsTensor<float>({-1, -1, -1, -1, -1, -1, -1, -1, -1, -1}));
+  test::ExpectTensorEqual<int64_t>(outputs[1], test::AsScalar<int64_t>(990));
+
+  // Removed slots are reused by later inserts.
+  TF_ASSERT_OK(session->Run({}, {}, {insert->name()}, nullptr));
+  TF_ASSERT_OK(session->Run({}, {size->name()}, {}, &outputs));
+  test::ExpectTensorEqual<int64_t>(outputs[0], test::AsScalar<int64_t>(1000));
+}
+
+TEST(ShardedMutableHashTableTest, StringKeysAndValues) {
+  Graph g(OpRegistry::Global());
+  Node* table = MutableShardedHashTable(&g, "table", TensorShape({}), 4,
+                                        DT_STRING, DT_STRING);
+  Node* insert =
+      Insert(&g, table,
+             test::graph::Constant(&g, test::AsTensor<tstring>({"a", "b"})),
+             test::graph::Constant(&g, test::AsTensor<tstring>({"x", "y"})));
+  Node* find =
+      Find(&g, table,
+           test::graph::Constant(&g, test::AsTensor<tstring>({"b", "c"})),
+           test::graph::Constant(&g, test::AsScalar<tstring>("?")));
+
+  std::unique_ptr<Session> session = CreateSession(g);
+  TF_ASSERT_OK(session->Run({}, {}, {insert->name()}, nullptr));
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->Run({}, {find->name()}, {}, &outputs));
+  test::ExpectTensorEqual<tstring>(outputs[0],
+                                   test::AsTensor<tstring>({"y", "?"}));
+}
+
+TEST(ShardedMutableHashTableTest, VectorValuesWithFullSizeDefault) {
+  Graph g(OpRegistry::Global());
+  Node* table = MutableShardedHashTable(&g, "table", TensorShape({2}), 2);
+  Node* insert = Insert(&g, table, test::graph::Constant(&g, Range(0, 2)),
+                        test::graph::Constant(&g, test::AsTensor<float>(
+                                                      {0, 1, 10, 11}, {2, 2})));
+  Node* find = Find(&g, table, test::graph::Constant(&g, Range(1, 3)),
+                    test::graph::Constant(&g, test::AsTensor<float>(
+                                                  {-1, -2, -3, -4}, {2, 2})));
+
+  std::unique_ptr<Session> session = CreateSession(g);
+  TF_ASSERT_OK(session->Run({}, {}, {insert->name()}, nullptr));
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->Run({}, {find->name()}, {}, &outputs));
+  test::ExpectTensorEqual<float>(
+      outputs[0], test::AsTensor<float>({10, 11, -3, -4}, {2, 2}));
+}
+
+TEST(ShardedMutableHashTableTest, ImportFromMutableHashTableExport) {
+  Graph g(OpRegistry::Global());
+  Node* source = MutableHashTable(&g, "source");
+  Node* insert =
+      Insert(&g, source, test::graph::Constant(&g, Range(0, 100)),
+             test::graph::Constant(&g, test::AsTensor<float>(
+                                           std::vector<float>(100, 7.0f))));
+  Node* exported = Export(&g, source);
+  Node* target = MutableShardedHashTable(&g, "target", TensorShape({}), 8);
+  Node* import = Import(&g, target, NodeBuilder::NodeOut(exported, 0),
+                        NodeBuilder::NodeOut(exported, 1));
+  Node* find = Find(&g, target, test::graph::Constant(&g, Range(98, 101)),
+                    test::graph::Constant(&g, test::AsScalar<float>(0.0f)));
+  Node* size = Size(&g, target);
+
+  std::unique_ptr<Session> session = CreateSession(g);
+  TF_ASSERT_OK(session->Run({}, {}, {insert->name()}, nullptr));
+  TF_ASSERT_OK(session->Run({}, {}, {import->name()}, nullptr));
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->Run({}, {find->name(), size->name()}, {}, &outputs));
+  test::ExpectTensorEqual<float>(outputs[0],
+                                 test::AsTensor<float>({7.0f, 7.0f, 0.0f}));
+  test::ExpectTensorEqual<int64_t>(outputs[1], test::AsScalar<int64_t>(100));
+}
+
+TEST(ShardedMutableHashTableTest, NumShardsMustBePowerOfTwo) {
+  Graph g(OpRegistry::Global());
+  Node* table = MutableShardedHashTable(&g, "table", TensorShape({}), 3);
+
+  std::unique_ptr<Session> session = CreateSession(g);
+  Status s = session->Run({}, {}, {table->name()}, nullptr);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+}
+
+TEST(MutableDenseHashTableTest, FindSpansSeveralBlocks) {
+  Graph g(OpRegistry::Global());
+  Node* table = MutableDenseHashTable<int64_t>(&g, TensorShape({2}), -1, -2,
+                                               /*initial_num_buckets=*/16,
+                                               /*max_load_factor=*/0.8);
+  // Keys are pairs (i, i + 1) for i in [0, 100).
+  Tensor keys(DT_INT64, TensorShape({100, 2}));
+  Tensor values(DT_FLOAT, TensorShape({100}));
+  for (int64_t i = 0; i < 100; ++i) {
+    keys.matrix<int64_t>()(i, 0) = i;
+    keys.matrix<int64_t>()(i, 1) = i + 1;
+    values.flat<float>()(i) = i;
+  }
+  Node* insert = Insert(&g, table, test::graph::Constant(&g, keys),
+                        test::graph::Constant(&g, values));
+  // Looks up (i, i + 1) for even i and the missing (i, i) for odd i.
+  Tensor lookup_keys(DT_INT64, TensorShape({100, 2}));
+  Tensor expected(DT_FLOAT, TensorShape({100}));
+  for (int64_t i = 0; i < 100; ++i) {
+    lookup_keys.matrix<int64_t>()(i, 0) = i;
+    lookup_keys.matrix<int64_t>()(i, 1) = i % 2 == 0 ? i + 1 : i;
+    expected.flat<float>()(i) = i % 2 == 0 ? i : -1.0f;
+  }
+  Node* find = Find(&g, table, test::graph::Constant(&g, lookup_keys),
+                    test::graph::Constant(&g, test::AsScalar<float>(-1.0f)));
+
+  std::unique_ptr<Session> session = CreateSession(g);
+  TF_ASSERT_OK(session->Run({}, {}, {insert->name()}, nullptr));
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->Run({}, {find->name()}, {}, &outputs));
+  test::ExpectTensorEqual<float>(outputs[0], expected);
+}
+
+TEST(MutableDenseHashTableTest, FindRejectsEmptyKey) {
+  Graph g(OpRegistry::Global());
+  Node* table = MutableDenseHashTable<int64_t>(&g, TensorShape({}), -1, -2,
+                                               /*initial_num_buckets=*/16,
+                                               /*max_load_factor=*/0.8);
+  Node* find = Find(&g, table,
+                    test::graph::Constant(&g, test::AsTensor<int64_t>(
+                                                  {0, 1, 2, -1, 4})),
+                    test::graph::Constant(&g, test::AsScalar<float>(-1.0f)));
+
+  std::unique_ptr<Session> session = CreateSession(g);
+  Status s = session->Run({}, {find->name()}, {}, nullptr);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+}
+
+template <typename K>
+K DenseBenchmarkKey(int64_t i);
+
+// Scatters the keys over the buckets; MutableDenseHashTable hashes integers
+// with the identity function.
+template <>
+int64_t DenseBenchmarkKey<int64_t>(int64_t i) {
+  return static_cast<int64_t>(i * 0x9E3779B97F4A7C15ULL);
+}
+
+template <>
+tstring DenseBenchmarkKey<tstring>(int64_t i) {
+  return strings::StrCat("feature_value_", i);
+}
+
+// Benchmark of one LookupTableFind of `kNumLookups` keys on a
+// MutableDenseHashTable filled to `load_percent` percent of its buckets. Half
+// of the looked up keys are present in the table.
+template <typename K>
+void DenseTableFindHelper(int load_percent,
+                          ::testing::benchmark::State& state) {
+  constexpr int64_t kNumBuckets = 1 << 20;
+  constexpr int64_t kNumLookups = 1 << 17;
+  const int64_t num_entries = kNumBuckets * load_percent / 100;
+
+  Graph g(OpRegistry::Global());
+  Node* table = MutableDenseHashTable<K>(
+      &g, TensorShape({}), DenseBenchmarkKey<K>(-1), DenseBenchmarkKey<K>(-2),
+      kNumBuckets, /*max_load_factor=*/0.95);
+  Tensor keys(DataTypeToEnum<K>::v(), TensorShape({num_entries}));
+  Tensor values(DT_FLOAT, TensorShape({num_entries}));
+  for (int64_t i = 0; i < num_entries; ++i) {
+    keys.flat<K>()(i) = DenseBenchmarkKey<K>(i);
+    values.flat<float>()(i) = i;
+  }
+  Node* insert = Insert(&g, table, test::graph::Constant(&g, keys),
+                        test::graph::Constant(&g, values));
+  Tensor lookup_keys(DataTypeToEnum<K>::v(), TensorShape({kNumLookups}));
+  for (int64_t i = 0; i < kNumLookups; ++i) {
+    lookup_keys.flat<K>()(i) = DenseBenchmarkKey<K>(
+        i % 2 == 0 ? (i * 7919) % num_entries : num_entries + i);
+  }
+  Node* find = Find(&g, table, test::graph::Constant(&g, lookup_keys),
+                    test::graph::Constant(&g, test::AsScalar<float>(-1.0f)));
+
+  std::unique_ptr<Session> session = CreateSession(g);
+  TF_CHECK_OK(session->Run({}, {}, {insert->name()}, nullptr));
+  for (auto s : state) {
+    TF_CHECK_OK(session->Run({}, {}, {find->name()}, nullptr));
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          kNumLookups);
+}
+
+void BM_MutableDenseHashTableFindInt64(::testing::benchmark::State& state) {
+  DenseTableFindHelper<int64_t>(state.range(0), state);
+}
+
+BENCHMARK(BM_MutableDenseHashTableFindInt64)
+    ->UseRealTime()
+    ->Arg(25)
+    ->Arg(50)
+    ->Arg(75)
+    ->Arg(90);
+
+void BM_MutableDenseHashTableFindString(::testing::benchmark::State& state) {
+  DenseTableFindHelper<tstring>(state.range(0), state);
+}
+
+BENCHMARK(BM_MutableDenseHashTableFindString)
+    ->UseRealTime()
+    ->Arg(25)
+    ->Arg(50)
+    ->Arg(75)
+    ->Arg(90);
+
+// Benchmark of `num_steps` concurrent find/insert pairs on one table, which
+// mirrors many inter-op threads serving lookups from a shared embedding table.
+// num_shards == 0 benchmarks MutableHashTable as the baseline.
+void TableContentionHelper(int num_steps, int num_shards,
+                           ::testing::benchmark::State& state) {
+  constexpr int64_t kNumKeys = 1 << 16;
+  constexpr int64_t kBatchSize = 1024;
+
+  Graph g(OpRegistry::Global());
+  Node* table = num_shards == 0
+                    ? MutableHashTable(&g, "table")
+                    : MutableShardedHashTable(&g, "table", TensorShape({}),
+                                              num_shards);
+  Tensor values(DT_FLOAT, TensorShape({kNumKeys}));
+  values.flat<float>().setConstant(1.0f);
+  Node* init = Insert(&g, table, test::graph::Constant(&g, Range(0, kNumKeys)),
+                      test::graph::Constant(&g, values));
+
+  Tensor batch_values(DT_FLOAT, TensorShape({kBatchSize}));
+  batch_values.flat<float>().setConstant(2.0f);
+  Node* batch_values_node = test::graph::Constant(&g, batch_values);
+  Node* default_value = test::graph::Constant(&g, test::AsScalar<float>(0.0f));
+  std::vector<string> targets;
+  for (int i = 0; i < num_steps; ++i) {
+    const int64_t start = (i * 7919 * kBatchSize) % kNumKeys;
+    Node* keys = test::graph::Constant(&g, Range(start, start + kBatchSize));
+    targets.push_back(Find(&g, table, keys, default_value)->name());
+    targets.push_back(Insert(&g, table, keys, batch_values_node)->name());
+  }
+
+  std::unique_ptr<Session> session = CreateSession(g, num_steps);
+  TF_CHECK_OK(session->Run({}, {}, {init->name()}, nullptr));
+  TF_CHECK_OK(session->Run({}, {}, targets, nullptr));
+  for (auto s : state) {
+    TF_CHECK_OK(session->Run({}, {}, targets, nullptr));
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_steps * kBatchSize * 2);
+}
+
+void BM_MutableHashTableContention(::testing::benchmark::State& state) {
+  TableContentionHelper(state.range(0), 0, state);
+}
+
+BENCHMARK(BM_MutableHashTableContention)
+    ->UseRealTime()
+    ->Arg(1)
+    ->Arg(8)
+    ->Arg(32);
+
+void BM_MutableShardedHashTableContention(::testing::benchmark::State& state) {
+  TableContentionHelper(state.range(0), state.range(1), state);
+}
+
+BENCHMARK(BM_MutableShardedHashTableContention)
+    ->UseRealTime()
+    ->ArgPair(1, 16)
+    ->ArgPair(8, 16)
+    ->ArgPair(32, 16)
+    ->ArgPair(32, 64);
+
+}  // namespace
+}  // namespace tensorflow
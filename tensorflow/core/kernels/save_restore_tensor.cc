@@ -405,20 +405,63 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
     return errors::InvalidArgument(error_msg);
   }
 
-  // Split restore ops into two groups: large and small. We schedule
-  // large ops first, to prevent them from waiting on the small op.
+  // Full tensors are restored together: the reader plans the reads of all
+  // data shards at once, coalescing small neighbors and chunking large
+  // tensors, and issues them on the device's worker threads.
+  std::vector<RestoreOp*> full_restore_ops;
+  std::vector<string> full_tensor_names;
+  std::vector<Tensor*> full_tensors;
+  std::vector<RestoreOp*> sliced_restore_ops;
+  bool has_large_full_tensor = false;
+  for (RestoreOp& restore_op : restore_ops) {
+    if (!restore_op.shape_and_slice.empty()) {
+      sliced_restore_ops.push_back(&restore_op);
+      continue;
+    }
+    TensorShape restored_full_shape;
+    TF_RETURN_IF_ERROR(default_reader.LookupTensorShape(
+        restore_op.tensor_name, &restored_full_shape));
+    Tensor* restored_tensor;
+    TF_RETURN_IF_ERROR(context->allocate_output(
+        restore_op.idx, restored_full_shape, &restored_tensor));
+    has_large_full_tensor |=
+        restored_full_shape.num_elements() > kLargeShapeThreshold;
+    VLOG(1) << "Restoring tensor " << restore_op.idx << " : "
+            << restore_op.tensor_name << " : "
+            << restored_full_shape.num_elements();
+    full_restore_ops.push_back(&restore_op);
+    full_tensor_names.push_back(restore_op.tensor_name);
+    full_tensors.push_back(restored_tensor);
+  }
+  if (!full_tensors.empty()) {
+    thread::ThreadPool* reader_pool =
+        full_tensors.size() > 1 || has_large_full_tensor
+            ? context->device()->tensorflow_cpu_worker_threads()->workers
+            : nullptr;
+    TF_RETURN_IF_ERROR(default_reader.LookupMany(full_tensor_names,
+                                                 full_tensors, reader_pool));
+    for (int i = 0; i < full_restore_ops.size(); ++i) {
+      VLOG(1) << "Done restoring tensor " << full_restore_ops[i]->idx << " : "
+              << full_tensor_names[i] << " : "
+              << full_tensors[i]->NumElements();
+    }
+  }
+
+  // Split the remaining restore ops into two groups: large and small. We
+  // schedule large ops first, to prevent them from waiting on the small op.
   std::vector<RestoreOp*> large_restore_ops;
   std::vector<RestoreOp*> small_restore_ops;
-  for (RestoreOp& restore_op : restore_ops) {
-    if (restore_op.is_large_shape(&default_reader)) {
-      large_restore_ops.push_back(&restore_op);
+  for (RestoreOp* restore_op : sliced_restore_ops) {
+    if (restore_op->is_large_shape(&default_reader)) {
+      large_restore_ops.push_back(restore_op);
     } else {
-      small_restore_ops.push_back(&restore_op);
+      small_restore_ops.push_back(restore_op);
     }
   }
 
   if (context->session_config() != nullptr &&
-      context->session_config()->intra_op_parallelism_threads() > 0) {
+      context->session_config()->intra_op_parallelism_threads() > 0 &&
+      !sliced_restore_ops.empty()) {
     // If an explicit restore parallelism is specified, we use it to run
     // run both small and large restore ops in parallel.
     auto reader_pool = std::make_unique<thread::ThreadPool>(
@@ -79,6 +79,16 @@ REGISTER_OP("BatchFunction")
     .Attr(
         "batch_padding_policy: "
         "{'PAD_UP'} = 'PAD_UP'")
+    // Token budget batching: if 'max_batch_tokens' is positive, batches are
+    // bounded by the number of tokens, i.e. elements along 'ragged_dimension'
+    // of the inputs, instead of 'max_batch_size'. Requests are grouped by row
+    // length into buckets with the inclusive upper bounds
+    // 'length_bucket_boundaries', and the rows of a batch are packed without
+    // padding. 'f' then receives an int64 row splits tensor describing the
+    // packed rows after the batched inputs.
+    .Attr("max_batch_tokens: int = 0")
+    .Attr("ragged_dimension: int = 1")
+    .Attr("length_bucket_boundaries: list(int) = []")
     .Attr("Tin: list(type)")
     .Attr("Tcaptured: list(type) >= 0")
     .Attr("Tout: list(type)")
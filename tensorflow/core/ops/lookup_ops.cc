@@ -441,6 +441,18 @@ REGISTER_OP("AnonymousMutableHashTableOfTensors")
     .SetIsStateful()
     .SetShapeFn(MutableHashTableOfTensorsShapeFn);
 
+REGISTER_OP("MutableShardedHashTable")
+    .Output("table_handle: resource")
+    .Attr("container: string = ''")
+    .Attr("shared_name: string = ''")
+    .Attr("use_node_name_sharing: bool = false")
+    .Attr("key_dtype: type")
+    .Attr("value_dtype: type")
+    .Attr("value_shape: shape = {}")
+    .Attr("num_shards: int = 16")
+    .SetIsStateful()
+    .SetShapeFn(MutableHashTableOfTensorsShapeFn);
+
 REGISTER_OP("MutableDenseHashTable")
     .Input("empty_key: key_dtype")
     .Output("table_handle: Ref(string)")
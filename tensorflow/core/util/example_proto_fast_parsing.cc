@@ -15,7 +15,9 @@ limitations under the License.
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
 #include <algorithm>
+#include <cstring>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <utility>
 #include <vector>
@@ -41,6 +43,7 @@ limitations under the License.
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/util/presized_cuckoo_map.h"
 #include "tensorflow/core/util/sparse/sparse_tensor.h"
+#include "tsl/platform/statusor.h"
 
 namespace tensorflow {
 namespace example {
@@ -115,6 +118,24 @@ uint8 PeekTag(protobuf::io::CodedInputStream* stream) {
   return *static_cast<const uint8*>(ptr);
 }
 
+// Returns true if none of the `size` bytes at `data` has its most significant
+// bit set, i.e. if they encode `size` varints of one byte each. The bytes are
+// tested eight at a time.
+bool AllSingleByteVarints(const uint8* data, size_t size) {
+  constexpr uint64 kContinuationBits = 0x8080808080808080ULL;
+  uint64 bits = 0;
+  size_t i = 0;
+  for (; i + sizeof(uint64) <= size; i += sizeof(uint64)) {
+    uint64 word;
+    std::memcpy(&word, data + i, sizeof(word));
+    bits |= word;
+  }
+  for (; i < size; ++i) {
+    bits |= data[i];
+  }
+  return (bits & kContinuationBits) == 0;
+}
+
 constexpr uint8 kVarintTag(uint32 tag) { return (tag << 3) | 0; }
 constexpr uint8 kDelimitedTag(uint32 tag) { return (tag << 3) | 2; }
 constexpr uint8 kFixed32Tag(uint32 tag) { return (tag << 3) | 5; }
@@ -307,6 +328,27 @@ class Feature {
         if (!stream.ReadVarint32(&packed_length)) return false;
         auto packed_limit = stream.PushLimit(packed_length);
 
+        // If every value fits in a single byte, which is common for ids and
+        // labels, the values are the bytes themselves.
+        const void* packed_data;
+        int packed_size;
+        if (packed_length > 0 &&
+            stream.GetDirectBufferPointer(&packed_data, &packed_size) &&
+            static_cast<uint32>(packed_size) == packed_length &&
+            AllSingleByteVarints(static_cast<const uint8*>(packed_data),
+                                 packed_length)) {
+          const uint8* values = static_cast<const uint8*>(packed_data);
+          const size_t initial_size = int64_list->size();
+          int64_list->resize(initial_size + packed_length);
+          const size_t num_values = std::min<size_t>(
+              int64_list->size() - initial_size, packed_length);
+          int64_t* out = int64_list->data() + initial_size;
+          for (size_t i = 0; i < num_values; ++i) {
+            out[i] = values[i];
+          }
+          if (!stream.Skip(packed_length)) return false;
+        }
+
         while (!stream.ExpectAtEnd()) {
           protobuf_uint64 n;  // There is no API for int64
           if (!stream.ReadVarint64(&n)) return false;
@@ -1133,23 +1175,24 @@ void CopySparseBufferToTensor(DataType dtype, size_t offset, SparseBuffer* src,
 
 }  // namespace
 
-Status FastParseExample(const Config& config,
-                        absl::Span<const tstring> serialized,
-                        absl::Span<const tstring> example_names,
-                        thread::ThreadPool* thread_pool, Result* result) {
-  DCHECK(result != nullptr);
-  // Check config so we can safely CHECK(false) in switches on config.*.dtype
-  TF_RETURN_IF_ERROR(CheckConfigDataTypes(config));
+// Maps the feature names of a config to their sub-config. The seed of `hasher`
+// is chosen so that none of the feature names of the config collide.
+struct FeatureNameIndex {
+  explicit FeatureNameIndex(size_t size) : config_index(size) {}
 
-  if (config.collect_feature_stats) {
-    result->feature_stats.resize(serialized.size());
-  }
+  SeededHasher hasher;
+  PresizedCuckooMap<std::pair<size_t, Type>> config_index;
+};
+
+namespace {
 
+std::unique_ptr<FeatureNameIndex> BuildFeatureNameIndex(const Config& config) {
   size_t config_size =
       config.dense.size() + config.sparse.size() + config.ragged.size();
-  SeededHasher hasher;
-  // Build config index.
-  PresizedCuckooMap<std::pair<size_t, Type>> config_index(config_size);
+  auto index = std::make_unique<FeatureNameIndex>(config_size);
+  SeededHasher& hasher = index->hasher;
+  PresizedCuckooMap<std::pair<size_t, Type>>& config_index =
+      index->config_index;
   bool ok = true;
   for (size_t i = 0; i < 1000; ++i) {
     for (size_t d = 0; d < config.dense.size(); ++d) {
@@ -1164,17 +1207,62 @@ Status FastParseExample(const Config& config,
       ok &= config_index.InsertUnique(hasher(config.ragged[d].feature_name),
                                       {d, Type::Ragged});
     }
-    if (ok) break;
+    if (ok) return index;
     LOG(WARNING) << "Collision found. This should happen only if you have "
                     "around 2^32 entries in your config.";
     hasher.seed++;
     config_index.Clear(config_size);
     ok = true;
   }
-  if (!ok) {
+  return nullptr;
+}
+
+// Returns the feature name index of `config`. If the config was not compiled,
+// builds a temporary index and stores it in `local_index`.
+StatusOr<const FeatureNameIndex*> GetFeatureNameIndex(
+    const Config& config, std::unique_ptr<FeatureNameIndex>* local_index) {
+  if (config.feature_name_index != nullptr) {
+    return config.feature_name_index.get();
+  }
+  *local_index = BuildFeatureNameIndex(config);
+  if (*local_index == nullptr) {
+    return errors::Internal(
+        "Could not avoid collision. This should not happen.");
+  }
+  return local_index->get();
+}
+
+}  // namespace
+
+Status CompileFastParseExampleConfig(Config* config) {
+  TF_RETURN_IF_ERROR(CheckConfigDataTypes(*config));
+  std::shared_ptr<const FeatureNameIndex> index =
+      BuildFeatureNameIndex(*config);
+  if (index == nullptr) {
     return errors::Internal(
         "Could not avoid collision. This should not happen.");
   }
+  config->feature_name_index = std::move(index);
+  return absl::OkStatus();
+}
+
+Status FastParseExample(const Config& config,
+                        absl::Span<const tstring> serialized,
+                        absl::Span<const tstring> example_names,
+                        thread::ThreadPool* thread_pool, Result* result) {
+  DCHECK(result != nullptr);
+  // Check config so we can safely CHECK(false) in switches on config.*.dtype
+  TF_RETURN_IF_ERROR(CheckConfigDataTypes(config));
+
+  if (config.collect_feature_stats) {
+    result->feature_stats.resize(serialized.size());
+  }
+
+  std::unique_ptr<FeatureNameIndex> local_index;
+  TF_ASSIGN_OR_RETURN(const FeatureNameIndex* index,
+                      GetFeatureNameIndex(config, &local_index));
+  const auto& config_index = index->config_index;
+  const SeededHasher& hasher = index->hasher;
 
   // Allocate dense output for fixed length dense values
   // (variable-length dense and sparse and ragged have to be buffered).
@@ -1459,37 +1547,11 @@ Status FastParseSingleExample(const Config& config, StringPiece serialized,
     stats = &result->feature_stats.back();
   }
 
-  // TODO(mrry): Cache the construction of this map at Op construction time.
-  size_t config_size =
-      config.dense.size() + config.sparse.size() + config.ragged.size();
-  SeededHasher hasher;
-  // Build config index.
-  PresizedCuckooMap<std::pair<size_t, Type>> config_index(config_size);
-  bool ok = true;
-  for (size_t i = 0; i < 1000; ++i) {
-    for (size_t d = 0; d < config.dense.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.dense[d].feature_name),
-                                      {d, Type::Dense});
-    }
-    for (size_t d = 0; d < config.sparse.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.sparse[d].feature_name),
-                                      {d, Type::Sparse});
-    }
-    for (size_t d = 0; d < config.ragged.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.ragged[d].feature_name),
-                                      {d, Type::Ragged});
-    }
-    if (ok) break;
-    LOG(WARNING) << "Collision found. This should happen only if you have "
-                    "around 2^32 entries in your config.";
-    hasher.seed++;
-    config_index.Clear(config_size);
-    ok = true;
-  }
-  if (!ok) {
-    return errors::Internal(
-        "Could not avoid collision. This should not happen.");
-  }
+  std::unique_ptr<FeatureNameIndex> local_index;
+  TF_ASSIGN_OR_RETURN(const FeatureNameIndex* index,
+                      GetFeatureNameIndex(config, &local_index));
+  const auto& config_index = index->config_index;
+  const SeededHasher& hasher = index->hasher;
 
   result->sparse_indices.reserve(config.sparse.size());
   result->sparse_values.reserve(config.sparse.size());
@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_UTIL_EXAMPLE_PROTO_FAST_PARSING_H_
 #define TENSORFLOW_CORE_UTIL_EXAMPLE_PROTO_FAST_PARSING_H_
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -35,6 +36,8 @@ limitations under the License.
 namespace tensorflow {
 namespace example {
 
+struct FeatureNameIndex;
+
 // FastParseExampleConfig defines how to parse features in Example.
 // Each sub-config is responsible for one feature identified with feature_name.
 // FastParseExampleConfig can't have two sub-configs with the same feature_name.
@@ -96,8 +99,18 @@ struct FastParseExampleConfig {
   // If `true`, `Result::feature_stats` will contain one
   // `PerExampleFeatureStats` for each serialized example in the input.
   bool collect_feature_stats = false;
+
+  // Index of the feature names above, set by `CompileFastParseExampleConfig()`.
+  // If null, the index is built on every call to `FastParse[Single]Example()`.
+  std::shared_ptr<const FeatureNameIndex> feature_name_index;
 };
 
+// Builds the feature name index of `config` once, so that the calls to
+// `FastParse[Single]Example()` with this config can skip building it. This is
+// worthwhile whenever a config is used for more than one call. The feature
+// names and their order must not change after the config is compiled.
+Status CompileFastParseExampleConfig(FastParseExampleConfig* config);
+
 // Statistics about the features in each example passed to
 // `FastParse[Single]Example()`.
 //
@@ -139,7 +152,6 @@ Status FastParseExample(const FastParseExampleConfig& config,
                         absl::Span<const tstring> example_names,
                         thread::ThreadPool* thread_pool, Result* result);
 
-// TODO(mrry): Move the hash table construction into the config object.
 typedef FastParseExampleConfig FastParseSingleExampleConfig;
 
 Status FastParseSingleExample(const FastParseSingleExampleConfig& config,
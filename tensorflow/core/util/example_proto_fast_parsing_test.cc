@@ -21,6 +21,7 @@ limitations under the License.
 
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/example/feature.pb.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/protobuf.h"
@@ -172,6 +173,24 @@ TEST(FastParse, Packed) {
       "\x0a\x0d\x0a\x0b\x0a\x03\x61\x67\x65\x12\x04\x1a\x02\x08\x0d");
 }
 
+TEST(FastParse, PackedSingleByteInt64) {
+  Example example;
+  auto* int64_list = (*example.mutable_features()->mutable_feature())["ids"]
+                         .mutable_int64_list();
+  for (int i = 0; i < 19; ++i) int64_list->add_value(i * 6);
+  TestCorrectness(Serialize(example));
+}
+
+TEST(FastParse, PackedMultiByteInt64) {
+  Example example;
+  auto* int64_list = (*example.mutable_features()->mutable_feature())["ids"]
+                         .mutable_int64_list();
+  for (int i = 0; i < 19; ++i) int64_list->add_value(i);
+  int64_list->add_value(128);
+  int64_list->add_value(-1);
+  TestCorrectness(Serialize(example));
+}
+
 TEST(FastParse, ValueBeforeKeyInMap) {
   TestCorrectness("\x0a\x12\x0a\x10\x12\x09\x0a\x07\x0a\x05value\x0a\x03key");
 }
@@ -327,6 +346,55 @@ TEST(FastParse, StatsCollection) {
   }
 }
 
+void ExpectTensorsEqual(const std::vector<Tensor>& expected,
+                        const std::vector<Tensor>& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i].DebugString(/*num_values=*/-1),
+              actual[i].DebugString(/*num_values=*/-1));
+  }
+}
+
+TEST(FastParse, CompiledConfig) {
+  std::vector<tstring> serialized(7, ExampleWithSomeFeatures());
+
+  FastParseExampleConfig config;
+  AddDenseFeature("bytes_list", DT_STRING, {2}, false, 2, &config);
+  AddDenseFeature("float_list", DT_FLOAT, {-1}, true, 1, &config);
+  AddSparseFeature("int64_list", DT_INT64, &config);
+  AddSparseFeature("missing", DT_INT64, &config);
+  FastParseExampleConfig compiled_config = config;
+  TF_ASSERT_OK(CompileFastParseExampleConfig(&compiled_config));
+  ASSERT_NE(compiled_config.feature_name_index, nullptr);
+
+  Result result;
+  TF_ASSERT_OK(FastParseExample(config, serialized, {}, nullptr, &result));
+  Result compiled_result;
+  TF_ASSERT_OK(FastParseExample(compiled_config, serialized, {}, nullptr,
+                                &compiled_result));
+  ExpectTensorsEqual(result.dense_values, compiled_result.dense_values);
+  ExpectTensorsEqual(result.sparse_indices, compiled_result.sparse_indices);
+  ExpectTensorsEqual(result.sparse_values, compiled_result.sparse_values);
+  ExpectTensorsEqual(result.sparse_shapes, compiled_result.sparse_shapes);
+
+  Result single_result;
+  TF_ASSERT_OK(FastParseSingleExample(config, serialized[0], &single_result));
+  Result compiled_single_result;
+  TF_ASSERT_OK(FastParseSingleExample(compiled_config, serialized[0],
+                                      &compiled_single_result));
+  ExpectTensorsEqual(single_result.dense_values,
+                     compiled_single_result.dense_values);
+  ExpectTensorsEqual(single_result.sparse_values,
+                     compiled_single_result.sparse_values);
+}
+
+TEST(FastParse, CompileConfigWithUnsupportedType) {
+  FastParseExampleConfig config;
+  AddSparseFeature("int32_list", DT_INT32, &config);
+  EXPECT_FALSE(CompileFastParseExampleConfig(&config).ok());
+  EXPECT_EQ(config.feature_name_index, nullptr);
+}
+
 string RandStr(random::SimplePhilox* rng) {
   static const char key_char_lookup[] =
       "0123456789{}~`!@#$%^&*()"
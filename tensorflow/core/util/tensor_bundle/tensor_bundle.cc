@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <memory>
@@ -23,6 +25,7 @@ limitations under the License.
 #include "absl/base/call_once.h"
 #include "absl/synchronization/mutex.h"
 #include "xla/tsl/util/byte_swap_array.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
@@ -41,6 +44,7 @@ limitations under the License.
 #include "tensorflow/core/lib/io/table_builder.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/bfloat16.h"
+#include "tensorflow/core/platform/blocking_counter.h"
 #include "tensorflow/core/platform/cord.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/mem.h"
@@ -233,6 +237,79 @@ tstring* GetStringBackingBuffer(const Tensor& val) {
   return const_cast<tstring*>(val.flat<tstring>().data());
 }
 
+Status ChecksumMismatchError(StringPiece prefix, const BundleEntryProto& entry,
+                             uint32 actual_crc32c) {
+  return errors::DataLoss(
+      "TensorBundle at ", prefix, " shard ", entry.shard_id(), " (",
+      entry.size(), " bytes): Checksum does not match: stored ",
+      strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
+      " vs. calculated on the restored bytes ", actual_crc32c);
+}
+
+// Tensor buffer that aliases a range of a memory-mapped data file and keeps
+// the mapping alive for as long as any tensor refers to it. The mapping is
+// read-only, so the buffer reports that it does not own its memory, which
+// keeps ops from forwarding it to outputs that are updated in place.
+class MappedRegionBuffer : public TensorBuffer {
+ public:
+  MappedRegionBuffer(std::shared_ptr<ReadOnlyMemoryRegion> region,
+                     const char* data, size_t size)
+      : TensorBuffer(const_cast<char*>(data)),
+        region_(std::move(region)),
+        size_(size) {}
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("BundleReaderMemoryMap");
+  }
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  const size_t size_;
+};
+
+// A full numeric tensor being restored by BundleReader::LookupMany().
+struct PendingLookup {
+  BundleEntryProto entry;
+  Tensor* val;
+  // Number of planned reads that have yet to land in "val".
+  std::atomic<int64_t> pending_reads{0};
+};
+
+// A read of "size" bytes at "offset" of data file "shard_id". Chunks of a
+// large tensor land directly in "dest"; otherwise "dest" is null and the bytes
+// go through a temporary buffer that is scattered to the neighboring
+// "tensors" sharing the read.
+struct PlannedRead {
+  int32_t shard_id;
+  int64_t offset;
+  int64_t size;
+  char* dest;
+  std::vector<PendingLookup*> tensors;
+};
+
+Status ExecutePlannedRead(RandomAccessFile* file, const PlannedRead& read) {
+  StringPiece sp;
+  if (read.dest != nullptr) {
+    TF_RETURN_IF_ERROR(file->Read(read.offset, read.size, &sp, read.dest));
+    if (sp.data() != read.dest) {
+      memmove(read.dest, sp.data(), read.size);
+    }
+    return absl::OkStatus();
+  }
+  std::unique_ptr<char[]> buffer(new char[read.size]);
+  TF_RETURN_IF_ERROR(file->Read(read.offset, read.size, &sp, buffer.get()));
+  for (const PendingLookup* lookup : read.tensors) {
+    memcpy(GetBackingBuffer(*lookup->val),
+           sp.data() + (lookup->entry.offset() - read.offset),
+           lookup->entry.size());
+  }
+  return absl::OkStatus();
+}
+
 Status ParseEntryProto(StringPiece key, StringPiece value,
                        protobuf::MessageLite* out) {
   if (!out->ParseFromArray(value.data(), value.size())) {
@@ -783,6 +860,7 @@ BundleReader::BundleReader(Env* env, StringPiece prefix, Options options)
       table_(nullptr),
       index_cache_(nullptr),
       iter_(nullptr),
+      use_mmap_(options.use_mmap),
       need_to_swap_bytes_(false),
       enable_multi_threading_for_testing_(
           options.enable_multi_threading_for_testing) {
@@ -812,6 +890,13 @@ BundleReader::BundleReader(Env* env, StringPiece prefix, Options options)
     o.block_cache = index_cache_;
   }
 
+  if (!use_mmap_) {
+    s = ReadBoolFromEnvVar("TF_BUNDLE_READER_USE_MMAP", false, &use_mmap_);
+    if (!s.ok()) {
+      LOG(WARNING) << "Ignoring TF_BUNDLE_READER_USE_MMAP: " << s;
+    }
+  }
+
   status_ = table::Table::Open(o, metadata_, file_size, &table_);
   if (!status_.ok()) return;
   iter_ = table_->NewIterator();
@@ -906,6 +991,17 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
     }
   }
 
+  if (use_mmap_ && DataTypeCanUseMemcpy(entry.dtype())) {
+    std::shared_ptr<ReadOnlyMemoryRegion> region;
+    GetMappedDataFile(entry.shard_id(), &region);
+    if (region != nullptr) {
+      Status s = GetMappedValue(entry, std::move(region), ret);
+      if (s.ok()) *val = *ret;
+      if (ret != val) delete ret;
+      return s;
+    }
+  }
+
   // Open the data file if it has not been opened.
   io::InputBuffer* buffered_file = data_[entry.shard_id()];
   if (buffered_file == nullptr) {
@@ -1007,11 +1103,7 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
         GetStringBackingBuffer(*ret), &actual_crc32c, need_to_swap_bytes_));
   }
   if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
-    return errors::DataLoss(
-        "TensorBundle at ", prefix_, " shard ", entry.shard_id(), " (",
-        entry.size(), " bytes): Checksum does not match: stored ",
-        strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
-        " vs. calculated on the restored bytes ", actual_crc32c);
+    return ChecksumMismatchError(prefix_, entry, actual_crc32c);
   }
 
   *val = *ret;
@@ -1019,6 +1111,61 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
   return absl::OkStatus();
 }
 
+void BundleReader::GetMappedDataFile(
+    int32_t shard_id, std::shared_ptr<ReadOnlyMemoryRegion>* region) {
+  auto it = mapped_data_.find(shard_id);
+  if (it == mapped_data_.end()) {
+    const string filename = DataFilename(prefix_, shard_id, num_shards_);
+    std::unique_ptr<ReadOnlyMemoryRegion> mapped;
+    Status s = env_->NewReadOnlyMemoryRegionFromFile(filename, &mapped);
+    if (!s.ok()) {
+      // Not all file systems support memory mapping. Errors that also affect
+      // regular reads are reported by the buffered path.
+      VLOG(1) << "Unable to memory-map " << filename
+              << ", falling back to buffered reads: " << s;
+      mapped.reset();
+    }
+    it = mapped_data_.emplace(shard_id, std::move(mapped)).first;
+  }
+  *region = it->second;
+}
+
+Status BundleReader::GetMappedValue(
+    const BundleEntryProto& entry,
+    std::shared_ptr<ReadOnlyMemoryRegion> region, Tensor* val) {
+  const uint64 length = region->length();
+  if (entry.offset() < 0 || static_cast<uint64>(entry.offset()) > length ||
+      entry.size() > length - entry.offset()) {
+    return errors::OutOfRange(
+        "Tensor at offset ", entry.offset(), " with ", entry.size(),
+        " bytes is past the end of data file shard ", entry.shard_id(),
+        " of TensorBundle at ", prefix_, " (", length, " bytes)");
+  }
+  const char* data = static_cast<const char*>(region->data()) + entry.offset();
+
+  // The checksum is on the bytes in the order they appear in the file.
+  const uint32 actual_crc32c = crc32c::Value(data, entry.size());
+  if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
+    return ChecksumMismatchError(prefix_, entry, actual_crc32c);
+  }
+
+  const TensorShape shape(entry.shape());
+  if (!need_to_swap_bytes_ &&
+      reinterpret_cast<uintptr_t>(data) % EIGEN_MAX_ALIGN_BYTES == 0) {
+    auto* buffer =
+        new MappedRegionBuffer(std::move(region), data, entry.size());
+    *val = Tensor(entry.dtype(), shape, buffer);
+    buffer->Unref();
+    return absl::OkStatus();
+  }
+
+  memcpy(GetBackingBuffer(*val), data, entry.size());
+  if (need_to_swap_bytes_) {
+    TF_RETURN_IF_ERROR(ByteSwapTensor(val));
+  }
+  return absl::OkStatus();
+}
+
 Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   CHECK(val != nullptr);
   BundleEntryProto entry;
@@ -1033,6 +1180,150 @@ Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   }
 }
 
+Status BundleReader::LookupMany(absl::Span<const std::string> keys,
+                                absl::Span<Tensor* const> vals,
+                                thread::ThreadPool* pool,
+                                const ParallelLookupOptions& options) {
+  if (keys.size() != vals.size()) {
+    return errors::InvalidArgument("LookupMany got ", keys.size(),
+                                   " keys but ", vals.size(), " tensors");
+  }
+
+  // Plans the full numeric tensors and leaves everything else to Lookup().
+  std::vector<size_t> serial_lookups;
+  std::vector<std::unique_ptr<PendingLookup>> pending;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    CHECK(vals[i] != nullptr);
+    BundleEntryProto entry;
+    TF_RETURN_IF_ERROR(GetBundleEntryProto(keys[i], &entry));
+    // A pre-allocated output must have the stored dtype, or the bytes read
+    // below would be reinterpreted as another type of the same size.
+    if (vals[i]->NumElements() != 0 && vals[i]->dtype() != entry.dtype()) {
+      return errors::InvalidArgument(
+          "Tensor for key ", keys[i], " has dtype ",
+          DataTypeString(vals[i]->dtype()), " but the bundle stores dtype ",
+          DataTypeString(entry.dtype()));
+    }
+    if (use_mmap_ || !entry.slices().empty() ||
+        !DataTypeCanUseMemcpy(entry.dtype())) {
+      serial_lookups.push_back(i);
+      continue;
+    }
+    Tensor* val = vals[i];
+    if (val->NumElements() == 0) {
+      *val = Tensor(entry.dtype(), TensorShape(entry.shape()));
+    }
+    if (entry.size() != val->TotalBytes()) {
+      return errors::DataLoss("Invalid size in bundle entry: key ", keys[i],
+                              "; stored size ", entry.size(),
+                              "; expected size ", val->TotalBytes());
+    }
+    auto lookup = std::make_unique<PendingLookup>();
+    lookup->entry.Swap(&entry);
+    lookup->val = val;
+    pending.push_back(std::move(lookup));
+  }
+
+  // Validates and byte-swaps a tensor once all of its reads have landed.
+  auto finish_lookup = [this](const PendingLookup& lookup) -> Status {
+    // The checksum is on the bytes in the order they appear in the file.
+    const uint32 actual_crc32c =
+        crc32c::Value(GetBackingBuffer(*lookup.val), lookup.entry.size());
+    if (crc32c::Unmask(lookup.entry.crc32c()) != actual_crc32c) {
+      return ChecksumMismatchError(prefix_, lookup.entry, actual_crc32c);
+    }
+    if (need_to_swap_bytes_) {
+      return ByteSwapTensor(lookup.val);
+    }
+    return absl::OkStatus();
+  };
+
+  // Walks the tensors in file order so that neighbors can share a read.
+  std::sort(pending.begin(), pending.end(),
+            [](const std::unique_ptr<PendingLookup>& a,
+               const std::unique_ptr<PendingLookup>& b) {
+              return std::make_pair(a->entry.shard_id(), a->entry.offset()) <
+                     std::make_pair(b->entry.shard_id(), b->entry.offset());
+            });
+  const int64_t chunk_bytes = std::max<int64_t>(options.chunk_bytes, 1);
+  std::vector<PlannedRead> reads;
+  for (const auto& lookup : pending) {
+    const BundleEntryProto& entry = lookup->entry;
+    if (entry.size() == 0) {
+      TF_RETURN_IF_ERROR(finish_lookup(*lookup));
+      continue;
+    }
+    if (entry.size() > options.max_coalesced_read_bytes) {
+      char* data = GetBackingBuffer(*lookup->val);
+      for (int64_t offset = 0; offset < entry.size(); offset += chunk_bytes) {
+        reads.push_back({entry.shard_id(), entry.offset() + offset,
+                         std::min(chunk_bytes, entry.size() - offset),
+                         data + offset, {lookup.get()}});
+        ++lookup->pending_reads;
+      }
+      continue;
+    }
+    lookup->pending_reads = 1;
+    if (!reads.empty()) {
+      PlannedRead& last = reads.back();
+      const int64_t end = entry.offset() + entry.size();
+      if (last.dest == nullptr && last.shard_id == entry.shard_id() &&
+          entry.offset() >= last.offset + last.size &&
+          end - last.offset <= options.max_coalesced_read_bytes) {
+        last.size = end - last.offset;
+        last.tensors.push_back(lookup.get());
+        continue;
+      }
+    }
+    reads.push_back({entry.shard_id(), entry.offset(), entry.size(), nullptr,
+                     {lookup.get()}});
+  }
+
+  absl::flat_hash_map<int32_t, RandomAccessFile*> files;
+  for (const PlannedRead& read : reads) {
+    RandomAccessFile*& file = files[read.shard_id];
+    if (file == nullptr) {
+      TF_RETURN_IF_ERROR(cache_->GetFile(
+          DataFilename(prefix_, read.shard_id, num_shards_), &file));
+    }
+  }
+
+  absl::Mutex mu;
+  Status status;
+  BlockingCounter counter(reads.size());
+  for (const PlannedRead& read : reads) {
+    auto execute = [&, file = files[read.shard_id]]() {
+      Status s = ExecutePlannedRead(file, read);
+      for (PendingLookup* lookup : read.tensors) {
+        // The thread landing the last read of a tensor finishes it.
+        if (lookup->pending_reads.fetch_sub(1) == 1 && s.ok()) {
+          s = finish_lookup(*lookup);
+        }
+      }
+      if (!s.ok()) {
+        absl::MutexLock l(&mu);
+        status.Update(s);
+      }
+      counter.DecrementCount();
+    };
+    if (pool != nullptr) {
+      pool->Schedule(std::move(execute));
+    } else {
+      execute();
+    }
+  }
+
+  Status serial_status;
+  for (size_t i : serial_lookups) {
+    serial_status = Lookup(keys[i], vals[i]);
+    if (!serial_status.ok()) break;
+  }
+  counter.Wait();
+  TF_RETURN_IF_ERROR(serial_status);
+  absl::MutexLock l(&mu);
+  return status;
+}
+
 Status BundleReader::ReadCurrent(Tensor* val) {
   CHECK(val != nullptr);
   BundleEntryProto entry;
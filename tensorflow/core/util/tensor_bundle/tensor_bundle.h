@@ -72,9 +72,11 @@ limitations under the License.
 #include "absl/container/flat_hash_map.h"
 #include "absl/functional/function_ref.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_slice.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/io/cache.h"
 #include "tensorflow/core/lib/io/inputbuffer.h"
@@ -212,6 +214,21 @@ class BundleReader {
 
     // For tests only.
     bool enable_multi_threading_for_testing = false;
+
+    // If true, data files are memory-mapped and numeric tensors alias the
+    // mapping instead of being copied into newly allocated buffers, which
+    // keeps restores of large checkpoints from holding a second copy of the
+    // data in anonymous memory. Tensors are still copied out of the mapping
+    // when their data is not aligned to EIGEN_MAX_ALIGN_BYTES in the file (see
+    // BundleWriter::Options::data_alignment) or the bundle has the other
+    // endianness. String and variant tensors are always read through the
+    // buffered path, as is any data file that cannot be mapped.
+    //
+    // Aliased tensors are read-only and keep the mapping alive. Ops never
+    // forward them for in-place updates, so restored variables get a copy on
+    // their first assignment. Can also be enabled by setting the environment
+    // variable TF_BUNDLE_READER_USE_MMAP to true.
+    bool use_mmap = false;
   };
   BundleReader(Env* env, absl::string_view prefix, Options options);
 
@@ -264,6 +281,38 @@ class BundleReader {
   // REQUIRES: status().ok()
   Status Lookup(absl::string_view key, Tensor* val) TF_MUST_USE_RESULT;
 
+  struct ParallelLookupOptions {
+    ParallelLookupOptions() {}
+
+    // Neighboring tensors of the same data file are fetched with a single
+    // read of at most this many bytes.
+    int64_t max_coalesced_read_bytes = 4 << 20;
+    // Tensors larger than this are fetched in reads of this many bytes that
+    // run concurrently.
+    int64_t chunk_bytes = 32 << 20;
+  };
+
+  // Looks up the tensors keyed by "keys" into "vals", as if by calling
+  // "Lookup()" for each pair, but with the reads of all data shards planned
+  // together and issued concurrently on "pool".
+  //
+  // Full numeric tensors are read in file order with small neighbors
+  // coalesced and large tensors split into chunks. Each tensor's checksum is
+  // validated, and its bytes swapped if needed, by the pool thread that
+  // lands its last chunk, so this work overlaps with the remaining reads.
+  // Partitioned, string and variant tensors are looked up on the calling
+  // thread while the pool reads the rest. If "pool" is null, all reads run
+  // on the calling thread. Non-empty entries of "vals" must already have the
+  // stored dtype.
+  //
+  // Returns the first error encountered. On error, "vals" may contain
+  // nonsense data.
+  // REQUIRES: status().ok() && keys.size() == vals.size()
+  Status LookupMany(absl::Span<const std::string> keys,
+                    absl::Span<Tensor* const> vals, thread::ThreadPool* pool,
+                    const ParallelLookupOptions& options =
+                        ParallelLookupOptions()) TF_MUST_USE_RESULT;
+
   // Looks up the tensor pointed to by the internal iterator.
   //
   // On error, "val" may contain nonsense data.
@@ -322,6 +371,17 @@ class BundleReader {
   Status GetValue(const BundleEntryProto& entry,
                   Tensor* val) TF_MUST_USE_RESULT;
 
+  // Reads the numeric tensor described by "entry" out of the memory-mapped
+  // data file "region", aliasing the mapping when possible.
+  Status GetMappedValue(const BundleEntryProto& entry,
+                        std::shared_ptr<ReadOnlyMemoryRegion> region,
+                        Tensor* val) TF_MUST_USE_RESULT;
+
+  // Returns the memory-mapped data file of shard "shard_id" in "region", or
+  // nullptr if the file cannot be mapped.
+  void GetMappedDataFile(int32_t shard_id,
+                         std::shared_ptr<ReadOnlyMemoryRegion>* region);
+
   // Reads the slice described by "slice_spec".  The corresponding full tensor
   // has key "ful_tensor_key" and metadata proto "full_tensor_entry".
   // REQUIRES: full_tensor_entry.slices_size() > 0
@@ -344,6 +404,13 @@ class BundleReader {
   // Owned InputBuffer objects. cache_ owns the underlying RandomAccessFiles.
   std::unordered_map<int32_t, io::InputBuffer*> data_;
 
+  // Whether data files are memory-mapped, see Options::use_mmap.
+  bool use_mmap_;
+  // Memory-mapped data files, shared with the tensors that alias them. Holds
+  // nullptr for files that could not be mapped.
+  std::unordered_map<int32_t, std::shared_ptr<ReadOnlyMemoryRegion>>
+      mapped_data_;
+
   // Maps each partitioned tensor's key to its stored slices (represented in a
   // TensorSliceSet).  Populated on-demand.
   std::unordered_map<std::string, checkpoint::TensorSliceSet*> tensor_slices_;
@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
+#include <cinttypes>
+#include <cstdio>
 #include <random>
 #include <string>
 #include <vector>
@@ -1151,6 +1153,229 @@ TEST(TensorBundleTest, LargeVariableLoadingTest) {
   }
 }
 
+BundleReader::Options MmapOptions() {
+  BundleReader::Options options;
+  options.use_mmap = true;
+  return options;
+}
+
+TEST(TensorBundleTest, MmapAliasesAlignedTensors) {
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = EIGEN_MAX_ALIGN_BYTES;
+    BundleWriter writer(Env::Default(), Prefix("foo"), opts);
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_100x100<float>(0)));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant(int8{1}, TensorShape({3}))));
+    TF_EXPECT_OK(writer.Add("foo_002", Constant_100x100<double>(2)));
+    TF_EXPECT_OK(writer.Add("foo_003", test::AsTensor<tstring>({"a", "b"})));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  Tensor foo_000;
+  {
+    BundleReader reader(Env::Default(), Prefix("foo"), MmapOptions());
+    TF_ASSERT_OK(reader.status());
+    Expect<float>(&reader, "foo_000", Constant_100x100<float>(0));
+    Expect<int8>(&reader, "foo_001", Constant(int8{1}, TensorShape({3})));
+    Expect<double>(&reader, "foo_002", Constant_100x100<double>(2));
+    Expect<tstring>(&reader, "foo_003", test::AsTensor<tstring>({"a", "b"}));
+
+    TF_ASSERT_OK(reader.Lookup("foo_000", &foo_000));
+    Tensor foo_003;
+    TF_ASSERT_OK(reader.Lookup("foo_003", &foo_003));
+    // Aliased tensors are never forwarded for in-place updates.
+    EXPECT_FALSE(foo_000.RefCountIsOne());
+    EXPECT_TRUE(foo_003.RefCountIsOne());
+  }
+  // The mapping outlives the reader.
+  test::ExpectTensorEqual<float>(foo_000, Constant_100x100<float>(0));
+}
+
+TEST(TensorBundleTest, MmapCopiesMisalignedTensors) {
+  {
+    BundleWriter writer(Env::Default(), Prefix("foo"));
+    TF_EXPECT_OK(writer.Add("foo_000", Constant(int8{1}, TensorShape({1}))));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_100x100<float>(1)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader reader(Env::Default(), Prefix("foo"), MmapOptions());
+  TF_ASSERT_OK(reader.status());
+  Tensor val(DT_FLOAT, TensorShape({100, 100}));
+  TF_ASSERT_OK(reader.Lookup("foo_001", &val));
+  test::ExpectTensorEqual<float>(val, Constant_100x100<float>(1));
+  EXPECT_TRUE(val.RefCountIsOne());
+}
+
+TEST(TensorBundleTest, MmapSwapsBytes) {
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = EIGEN_MAX_ALIGN_BYTES;
+    BundleWriter writer(Env::Default(), Prefix("foo"), opts);
+    TF_EXPECT_OK(writer.Add("foo_000", ByteSwap(Constant_2x3<int32>(7))));
+    TF_ASSERT_OK(writer.Finish());
+    TF_ASSERT_OK(FlipEndiannessBit(Prefix("foo")));
+  }
+  BundleReader reader(Env::Default(), Prefix("foo"), MmapOptions());
+  TF_ASSERT_OK(reader.status());
+  Expect<int32>(&reader, "foo_000", Constant_2x3<int32>(7));
+}
+
+TEST(TensorBundleTest, MmapDetectsCorruption) {
+  Env* env = Env::Default();
+  {
+    BundleWriter writer(env, Prefix("foo"));
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_2x3<float>(1.0)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  const string datafile = DataFilename(Prefix("foo"), 0, 1);
+  string data;
+  TF_ASSERT_OK(ReadFileToString(env, datafile, &data));
+  data[0] = ~data[0];
+  TF_ASSERT_OK(WriteStringToFile(env, datafile, data));
+  {
+    BundleReader reader(env, Prefix("foo"), MmapOptions());
+    TF_ASSERT_OK(reader.status());
+    Tensor val(DT_FLOAT, TensorShape({2, 3}));
+    EXPECT_TRUE(errors::IsDataLoss(reader.Lookup("foo_000", &val)));
+  }
+
+  TF_ASSERT_OK(WriteStringToFile(env, datafile,
+                                 StringPiece(data.data(), data.size() - 1)));
+  {
+    BundleReader reader(env, Prefix("foo"), MmapOptions());
+    TF_ASSERT_OK(reader.status());
+    Tensor val(DT_FLOAT, TensorShape({2, 3}));
+    EXPECT_TRUE(errors::IsOutOfRange(reader.Lookup("foo_000", &val)));
+  }
+}
+
+// Writes tensors "a"..."e" to "foo" and "f"..."h" to "bar" and merges them
+// into a two-shard bundle at "merged".
+void WriteTwoShardBundle(const string& merged) {
+  Env* env = Env::Default();
+  {
+    BundleWriter writer(env, Prefix("foo"));
+    TF_EXPECT_OK(writer.Add("a", Constant_2x3<float>(1.0)));
+    TF_EXPECT_OK(writer.Add("b", Constant_100x100<double>(2.0)));
+    TF_EXPECT_OK(writer.Add("c", test::AsTensor<tstring>({"x", "yz"})));
+    TF_EXPECT_OK(writer.Add("d", Constant(int8{3}, TensorShape({5}))));
+    TF_EXPECT_OK(writer.Add("e", Constant(4.f, TensorShape({0}))));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  {
+    BundleWriter writer(env, Prefix("bar"));
+    TF_EXPECT_OK(writer.Add("f", Constant_2x3<int32>(5)));
+    TF_EXPECT_OK(writer.Add("g", Constant_100x100<float>(6.0)));
+    TF_EXPECT_OK(writer.AddSlice("h", TensorShape({4}),
+                                 TensorSlice::ParseOrDie("0,2"),
+                                 Constant(7.f, TensorShape({2}))));
+    TF_EXPECT_OK(writer.AddSlice("h", TensorShape({4}),
+                                 TensorSlice::ParseOrDie("2,2"),
+                                 Constant(7.f, TensorShape({2}))));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  TF_ASSERT_OK(MergeBundles(env, {Prefix("foo"), Prefix("bar")}, merged));
+}
+
+TEST(TensorBundleTest, LookupManyAcrossShards) {
+  WriteTwoShardBundle(Prefix("merged"));
+  BundleReader reader(Env::Default(), Prefix("merged"));
+  TF_ASSERT_OK(reader.status());
+
+  // Small reads and chunks force both coalescing and chunking.
+  BundleReader::ParallelLookupOptions options;
+  options.max_coalesced_read_bytes = 1024;
+  options.chunk_bytes = 4096;
+  auto lookup_and_check = [&](thread::ThreadPool* pool) {
+    const std::vector<string> keys = {"g", "c", "a", "h", "f", "b", "e", "d"};
+    std::vector<Tensor> vals = {
+        Tensor(DT_FLOAT, TensorShape({100, 100})), Tensor(),
+        Tensor(DT_FLOAT, TensorShape({2, 3})),     Tensor(),
+        Tensor(DT_INT32, TensorShape({2, 3})),     Tensor(),
+        Tensor(DT_FLOAT, TensorShape({0})),        Tensor()};
+    std::vector<Tensor*> val_ptrs;
+    for (Tensor& val : vals) val_ptrs.push_back(&val);
+    TF_ASSERT_OK(reader.LookupMany(keys, val_ptrs, pool, options));
+
+    test::ExpectTensorEqual<float>(vals[0], Constant_100x100<float>(6.0));
+    test::ExpectTensorEqual<tstring>(vals[1],
+                                     test::AsTensor<tstring>({"x", "yz"}));
+    test::ExpectTensorEqual<float>(vals[2], Constant_2x3<float>(1.0));
+    test::ExpectTensorEqual<float>(vals[3], Constant(7.f, TensorShape({4})));
+    test::ExpectTensorEqual<int32>(vals[4], Constant_2x3<int32>(5));
+    test::ExpectTensorEqual<double>(vals[5], Constant_100x100<double>(2.0));
+    test::ExpectTensorEqual<float>(vals[6], Constant(4.f, TensorShape({0})));
+    test::ExpectTensorEqual<int8>(vals[7], Constant(int8{3}, TensorShape({5})));
+  };
+  lookup_and_check(/*pool=*/nullptr);
+  thread::ThreadPool pool(Env::Default(), "lookup_many", 4);
+  lookup_and_check(&pool);
+}
+
+TEST(TensorBundleTest, LookupManySwapsBytes) {
+  {
+    BundleWriter writer(Env::Default(), Prefix("foo"));
+    TF_EXPECT_OK(writer.Add("foo_000", ByteSwap(Constant_2x3<int32>(7))));
+    TF_EXPECT_OK(writer.Add("foo_001", ByteSwap(Constant_100x100<float>(8))));
+    TF_ASSERT_OK(writer.Finish());
+    TF_ASSERT_OK(FlipEndiannessBit(Prefix("foo")));
+  }
+  BundleReader reader(Env::Default(), Prefix("foo"));
+  TF_ASSERT_OK(reader.status());
+  BundleReader::ParallelLookupOptions options;
+  options.max_coalesced_read_bytes = 1024;
+  options.chunk_bytes = 4096;
+  thread::ThreadPool pool(Env::Default(), "lookup_many", 4);
+  Tensor foo_000, foo_001;
+  TF_ASSERT_OK(reader.LookupMany({"foo_000", "foo_001"}, {&foo_000, &foo_001},
+                                 &pool, options));
+  test::ExpectTensorEqual<int32>(foo_000, Constant_2x3<int32>(7));
+  test::ExpectTensorEqual<float>(foo_001, Constant_100x100<float>(8));
+}
+
+TEST(TensorBundleTest, LookupManyDetectsCorruption) {
+  Env* env = Env::Default();
+  {
+    BundleWriter writer(env, Prefix("foo"));
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_2x3<float>(1.0)));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_100x100<float>(2.0)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  const string datafile = DataFilename(Prefix("foo"), 0, 1);
+  string data;
+  TF_ASSERT_OK(ReadFileToString(env, datafile, &data));
+  data[data.size() - 1] = ~data[data.size() - 1];
+  TF_ASSERT_OK(WriteStringToFile(env, datafile, data));
+
+  BundleReader reader(env, Prefix("foo"));
+  TF_ASSERT_OK(reader.status());
+  BundleReader::ParallelLookupOptions options;
+  options.chunk_bytes = 4096;
+  thread::ThreadPool pool(env, "lookup_many", 4);
+  Tensor foo_000, foo_001;
+  Status s = reader.LookupMany({"foo_000", "foo_001"}, {&foo_000, &foo_001},
+                               &pool, options);
+  EXPECT_TRUE(errors::IsDataLoss(s)) << s;
+  EXPECT_TRUE(absl::StrContains(s.message(), "Checksum does not match"));
+  test::ExpectTensorEqual<float>(foo_000, Constant_2x3<float>(1.0));
+}
+
+TEST(TensorBundleTest, LookupManyChecksDtype) {
+  {
+    BundleWriter writer(Env::Default(), Prefix("foo"));
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_2x3<float>(1.0)));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_2x3<int32>(2)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader reader(Env::Default(), Prefix("foo"));
+  TF_ASSERT_OK(reader.status());
+  Tensor foo_000(DT_FLOAT, TensorShape({2, 3}));
+  Tensor foo_001(DT_FLOAT, TensorShape({2, 3}));
+  Status s = reader.LookupMany({"foo_000", "foo_001"}, {&foo_000, &foo_001},
+                               /*pool=*/nullptr);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+  EXPECT_TRUE(absl::StrContains(s.message(), "foo_001")) << s;
+}
+
 absl::Status CreateFile(Env* env, const std::string& fname) {
   std::unique_ptr<WritableFile> file;
   TF_RETURN_IF_ERROR(env->NewWritableFile(fname, &file));
@@ -1321,4 +1546,126 @@ static void BM_BundleWriterLargeTensor(::testing::benchmark::State& state) {
 BENCHMARK(BM_BundleWriterLargeTensor)->Arg(1 << 10);
 BENCHMARK(BM_BundleWriterLargeTensor)->Arg(4 << 10);
 
+// Returns the resident anonymous memory of this process in bytes, or -1 if it
+// is not available on this platform.
+static int64_t AnonymousRssBytes() {
+  string status;
+  if (!ReadFileToString(Env::Default(), "/proc/self/status", &status).ok()) {
+    return -1;
+  }
+  for (const string& line : str_util::Split(status, '\n')) {
+    int64_t kb;
+    if (sscanf(line.c_str(), "RssAnon: %" SCNd64 " kB", &kb) == 1) {
+      return kb << 10;
+    }
+  }
+  return -1;
+}
+
+// Restores a bundle of 8 float tensors with `state.range(0)` MB in total,
+// with (`state.range(1)` == 1) or without memory mapping. Reports the
+// anonymous memory held by the restored tensors.
+static void BM_BundleReaderRestore(::testing::benchmark::State& state) {
+  const int64_t mb = state.range(0);
+  const bool use_mmap = state.range(1) == 1;
+  constexpr int kNumTensors = 8;
+  const int64_t elements_per_tensor =
+      (mb << 20) / kNumTensors / sizeof(float);
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = EIGEN_MAX_ALIGN_BYTES;
+    BundleWriter writer(Env::Default(), Prefix("restore"), opts);
+    for (int i = 0; i < kNumTensors; ++i) {
+      TF_CHECK_OK(writer.Add(strings::StrCat("var_", i),
+                             Constant(static_cast<float>(i),
+                                      TensorShape({elements_per_tensor}))));
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+  BundleReader::Options options;
+  options.use_mmap = use_mmap;
+  int64_t anonymous_bytes = 0;
+  for (auto s : state) {
+    BundleReader reader(Env::Default(), Prefix("restore"), options);
+    TF_CHECK_OK(reader.status());
+    const int64_t rss_before = AnonymousRssBytes();
+    std::vector<Tensor> restored(kNumTensors);
+    for (int i = 0; i < kNumTensors; ++i) {
+      TF_CHECK_OK(reader.Lookup(strings::StrCat("var_", i), &restored[i]));
+    }
+    anonymous_bytes = AnonymousRssBytes() - rss_before;
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          (mb << 20));
+  state.counters["anon_rss_mb"] = anonymous_bytes >> 20;
+}
+
+BENCHMARK(BM_BundleReaderRestore)->ArgPair(256, 0);
+BENCHMARK(BM_BundleReaderRestore)->ArgPair(256, 1);
+BENCHMARK(BM_BundleReaderRestore)->ArgPair(1024, 0);
+BENCHMARK(BM_BundleReaderRestore)->ArgPair(1024, 1);
+
+// Restores a bundle of `state.range(0)` MB spread over `state.range(1)` data
+// shards. Each shard holds many 64KB tensors and a few large ones. Tensors are
+// restored one at a time with Lookup() if `state.range(2)` is 0, or with
+// LookupMany() on a pool of that many threads.
+static void BM_BundleReaderLookupMany(::testing::benchmark::State& state) {
+  const int64_t mb = state.range(0);
+  const int num_shards = state.range(1);
+  const int num_threads = state.range(2);
+  constexpr int64_t kSmallElements = (64 << 10) / sizeof(float);
+  constexpr int kLargePerShard = 4;
+  const int64_t shard_bytes = (mb << 20) / num_shards;
+  const int small_per_shard = shard_bytes / 2 / (64 << 10);
+  const int64_t large_elements =
+      shard_bytes / 2 / kLargePerShard / sizeof(float);
+
+  Env* env = Env::Default();
+  std::vector<string> keys;
+  std::vector<Tensor> vals;
+  std::vector<tstring> shard_prefixes;
+  for (int shard = 0; shard < num_shards; ++shard) {
+    shard_prefixes.push_back(Prefix(strings::StrCat("lookup_many_", shard)));
+    BundleWriter writer(env, shard_prefixes.back());
+    for (int i = 0; i < small_per_shard + kLargePerShard; ++i) {
+      const int64_t elements =
+          i < small_per_shard ? kSmallElements : large_elements;
+      keys.push_back(strings::StrCat("var_", shard, "_", i));
+      vals.emplace_back(DT_FLOAT, TensorShape({elements}));
+      TF_CHECK_OK(writer.Add(
+          keys.back(),
+          Constant(static_cast<float>(i), TensorShape({elements}))));
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+  TF_CHECK_OK(MergeBundles(env, shard_prefixes, Prefix("lookup_many")));
+
+  std::vector<Tensor*> val_ptrs;
+  for (Tensor& val : vals) val_ptrs.push_back(&val);
+  std::unique_ptr<thread::ThreadPool> pool;
+  if (num_threads > 0) {
+    pool = std::make_unique<thread::ThreadPool>(env, "lookup_many",
+                                                num_threads);
+  }
+  for (auto s : state) {
+    BundleReader reader(env, Prefix("lookup_many"));
+    TF_CHECK_OK(reader.status());
+    if (pool == nullptr) {
+      for (size_t i = 0; i < keys.size(); ++i) {
+        TF_CHECK_OK(reader.Lookup(keys[i], val_ptrs[i]));
+      }
+    } else {
+      TF_CHECK_OK(reader.LookupMany(keys, val_ptrs, pool.get()));
+    }
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          (mb << 20));
+}
+
+BENCHMARK(BM_BundleReaderLookupMany)->Args({2048, 1, 0});
+BENCHMARK(BM_BundleReaderLookupMany)->Args({2048, 1, 8});
+BENCHMARK(BM_BundleReaderLookupMany)->Args({2048, 8, 0});
+BENCHMARK(BM_BundleReaderLookupMany)->Args({2048, 8, 8});
+BENCHMARK(BM_BundleReaderLookupMany)->Args({2048, 8, 16});
+
 }  // namespace tensorflow
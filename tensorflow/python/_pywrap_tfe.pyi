@@ -206,6 +206,7 @@ def TFE_ContextOptionsSetTfrt(arg0: TFE_ContextOptions, arg1: bool) -> None: ...
 def TFE_ContextRemoveFunction(arg0: object, arg1: str) -> None: ...
 def TFE_ContextSetExecutorForThread(arg0: object, arg1: TFE_Executor) -> None: ...
 def TFE_ContextSetJitCompileRewrite(arg0: object, arg1: bool) -> None: ...
+def TFE_ContextSetLazyExecution(arg0: object, arg1: bool, arg2: int) -> None: ...
 def TFE_ContextSetLogDevicePlacement(arg0: object, arg1: bool) -> None: ...
 def TFE_ContextSetRunEagerOpAsFunction(arg0: object, arg1: bool) -> None: ...
 def TFE_ContextSetServerDef(arg0: object, arg1: int, arg2: bytes) -> None: ...
@@ -18,6 +18,7 @@ import numpy as np
 from tensorflow.python.data.benchmarks import benchmark_base
 from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.data.ops import map_op
+from tensorflow.python.data.ops import options as options_lib
 from tensorflow.python.framework import constant_op
 from tensorflow.python.ops import array_ops
 from tensorflow.python.ops import map_fn
@@ -189,6 +190,51 @@ class MapBenchmark(benchmark_base.DatasetBenchmarkBase):
       for num_parallel_calls in nums_parallel_calls:
         self._benchmark_nested_parallel_map(cycle_length, num_parallel_calls)
 
+  def _benchmark_tiny_function_parallel_map(self, num_parallel_calls,
+                                            invocation_batch_size,
+                                            use_inter_op_parallelism):
+    num_elements = 100000
+    dataset = dataset_ops.Dataset.range(num_elements)
+    dataset = map_op._ParallelMapDataset(  # pylint: disable=protected-access
+        dataset,
+        lambda x: x + 1,
+        num_parallel_calls=num_parallel_calls,
+        deterministic=True,
+        use_inter_op_parallelism=use_inter_op_parallelism)
+    if invocation_batch_size is not None:
+      options = options_lib.Options()
+      options.autotune.map_invocation_batch_size = invocation_batch_size
+      dataset = dataset.with_options(options)
+
+    if invocation_batch_size is None:
+      invocation_batch_size_str = "none"
+    elif invocation_batch_size == dataset_ops.AUTOTUNE:
+      invocation_batch_size_str = "autotune"
+    else:
+      invocation_batch_size_str = str(invocation_batch_size)
+    label = "" if use_inter_op_parallelism else "_single_threaded"
+
+    self.run_and_report_benchmark(
+        dataset,
+        num_elements=num_elements,
+        extras={
+            "model_name": "map.benchmark.11",
+            "parameters": "%d_%s" % (num_parallel_calls,
+                                     invocation_batch_size_str),
+        },
+        name="tiny_function_num_parallel_calls_%d_invocation_batch_size_%s%s" %
+        (num_parallel_calls, invocation_batch_size_str, label))
+
+  def benchmark_tiny_function_parallel_map(self):
+    nums_parallel_calls = [1, 2, 4, 8, 16]
+    invocation_batch_sizes = [None, 8, dataset_ops.AUTOTUNE]
+    for num_parallel_calls in nums_parallel_calls:
+      for invocation_batch_size in invocation_batch_sizes:
+        for use_inter_op_parallelism in [True, False]:
+          self._benchmark_tiny_function_parallel_map(num_parallel_calls,
+                                                     invocation_batch_size,
+                                                     use_inter_op_parallelism)
+
 
 if __name__ == "__main__":
   benchmark_base.test.main()
@@ -0,0 +1,125 @@
+# Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Benchmarks for checkpointing a `tf.data.Dataset.shuffle()` iterator."""
+import os
+import threading
+import time
+from unittest import mock
+
+import numpy as np
+
+from tensorflow.python.checkpoint import checkpoint as trackable_utils
+from tensorflow.python.data.benchmarks import benchmark_base
+from tensorflow.python.data.ops import dataset_ops
+
+
+class ShuffleCheckpointBenchmark(benchmark_base.DatasetBenchmarkBase):
+  """Benchmarks for checkpointing a `tf.data.Dataset.shuffle()` iterator."""
+
+  def _checkpoint_bytes(self, path):
+    return sum(
+        os.path.getsize(os.path.join(directory, filename))
+        for directory, _, filenames in os.walk(path)
+        for filename in filenames)
+
+  def _benchmark_checkpoint(self, buffer_size, name, buffer_size_bytes=None,
+                            incremental=True, num_saves=5,
+                            steps_between_saves=100):
+    dataset = dataset_ops.Dataset.range(10 * buffer_size)
+    dataset = dataset.shuffle(
+        buffer_size, seed=42, buffer_size_bytes=buffer_size_bytes)
+    # Experiments are only enabled for jobs with a name and task id, and are
+    # read when the iterator is created.
+    experiment_env = {}
+    if incremental:
+      experiment_env = {
+          "TF_JOB_NAME": "shuffle_checkpoint_benchmark",
+          "TF_TASK_ID": "0",
+          "TF_DATA_EXPERIMENT_OPT_IN": "incremental_shuffle_checkpoint",
+      }
+    with mock.patch.dict(os.environ, experiment_env):
+      iterator = iter(dataset)
+    # Fill the shuffle buffer.
+    next(iterator)
+    checkpoint = trackable_utils.Checkpoint(iterator=iterator)
+
+    # A consumer keeps pulling elements while the checkpoints are written, to
+    # measure how long a save stalls the input pipeline.
+    stop = threading.Event()
+    saving = threading.Event()
+    stalls = []
+
+    def consume():
+      while not stop.is_set():
+        start = time.time()
+        next(iterator)
+        if saving.is_set():
+          stalls.append(time.time() - start)
+
+    save_times = []
+    checkpoint_bytes = []
+    for i in range(num_saves):
+      prefix = os.path.join(self.get_temp_dir(), name, str(i), "ckpt")
+      consumer = None
+      if i > 0:
+        consumer = threading.Thread(target=consume)
+        consumer.start()
+        saving.set()
+      start = time.time()
+      checkpoint.write(prefix)
+      save_times.append(time.time() - start)
+      saving.clear()
+      if consumer:
+        stop.set()
+        consumer.join()
+        stop.clear()
+      checkpoint_bytes.append(self._checkpoint_bytes(os.path.dirname(prefix)))
+      for _ in range(steps_between_saves):
+        next(iterator)
+
+    # The first save copies the whole buffer; with `incremental`, the following
+    # ones only copy the slots changed since the previous save.
+    self.report_benchmark(
+        wall_time=np.median(save_times[1:]),
+        iters=num_saves - 1,
+        name=name,
+        extras={
+            "model_name": "shuffle_checkpoint.benchmark.1",
+            "parameters": "%d.%s.%s" % (buffer_size, buffer_size_bytes,
+                                        incremental),
+            "first_save_time": save_times[0],
+            "checkpoint_bytes": int(np.median(checkpoint_bytes)),
+            "max_stall_time": max(stalls) if stalls else 0.0,
+        })
+
+  def benchmark_checkpoint_1m_buffer(self):
+    self._benchmark_checkpoint(
+        buffer_size=1000000, name="checkpoint_1m_buffer")
+
+  def benchmark_checkpoint_1m_buffer_full_saves(self):
+    self._benchmark_checkpoint(
+        buffer_size=1000000,
+        incremental=False,
+        name="checkpoint_1m_buffer_full_saves")
+
+  def benchmark_checkpoint_1m_packed_buffer(self):
+    self._benchmark_checkpoint(
+        buffer_size=1000000,
+        buffer_size_bytes=64 << 20,
+        name="checkpoint_1m_packed_buffer")
+
+
+if __name__ == "__main__":
+  benchmark_base.test.main()
@@ -21,6 +21,7 @@ import tempfile
 from tensorflow.python.data.benchmarks import benchmark_base
 from tensorflow.python.data.experimental.ops import readers
 from tensorflow.python.data.ops import readers as core_readers
+from tensorflow.python.eager import context
 from tensorflow.python.ops import parsing_ops
 from tensorflow.python.platform import gfile
 from tensorflow.python.platform import googletest
@@ -40,6 +41,7 @@ class CsvDatasetBenchmark(benchmark_base.DatasetBenchmarkBase):
     self._num_cols = [4, 64, 256]
     self._num_per_iter = 5000
     self._filenames = []
+    self._row_sizes = []
     for n in self._num_cols:
       fn = os.path.join(self._temp_dir, 'file%d.csv' % n)
       with open(fn, 'w') as f:
@@ -48,22 +50,28 @@ class CsvDatasetBenchmark(benchmark_base.DatasetBenchmarkBase):
         row = ','.join(str_val for _ in range(n))
         f.write('\n'.join(row for _ in range(100)))
       self._filenames.append(fn)
+      self._row_sizes.append(len(row) + 1)
 
   def _tear_down(self):
     gfile.DeleteRecursively(self._temp_dir)
 
   def _run_benchmark(self, dataset, num_cols, prefix, benchmark_id):
-
-    self.run_and_report_benchmark(
-        dataset=dataset,
-        num_elements=self._num_per_iter,
-        name='%s_with_cols_%d' % (prefix, num_cols),
+    row_size = self._row_sizes[self._num_cols.index(num_cols)]
+    wall_time = self.run_benchmark(
+        dataset=dataset, num_elements=self._num_per_iter, iters=10, warmup=True)
+    implementation = 'eager' if context.executing_eagerly() else 'graph'
+    # The pipelines are single-threaded, so this is the throughput per core.
+    self.report_benchmark(
+        wall_time=wall_time,
         iters=10,
+        name='%s_with_cols_%d.%s' % (prefix, num_cols, implementation),
         extras={
             'model_name': 'csv.benchmark.%d' % benchmark_id,
             'parameters': '%d' % num_cols,
-        },
-        warmup=True)
+            'implementation': implementation,
+            'num_elements': self._num_per_iter,
+            'mb_per_second': row_size / wall_time / 1e6,
+        })
 
   def benchmark_map_with_floats(self):
     self._set_up(self.FLOAT_VAL)
@@ -109,6 +109,17 @@ class CompressionOpsTest(test_base.DatasetTestBase, parameterized.TestCase):
     dataset = dataset.map(lambda x: compression_ops.uncompress(x, element_spec))
     self.assertDatasetProduces(dataset, [element])
 
+  @combinations.generate(
+      combinations.times(test_base.default_test_combinations(),
+                         combinations.combine(chunk_size=[0, 7, 1 << 20])))
+  def testChunkedCompression(self, chunk_size):
+    element = (list(range(100)), "ABCDEFGHIJKLMNOPQRSTUVWXYZ")
+
+    compressed = compression_ops.compress(element, chunk_size=chunk_size)
+    uncompressed = compression_ops.uncompress(
+        compressed, structure.type_spec_from_value(element))
+    self.assertValuesEqual(element, self.evaluate(uncompressed))
+
   @combinations.generate(
       combinations.times(test_base.default_test_combinations()))
   def testCompressionOutputDTypeMismatch(self):
@@ -534,6 +534,22 @@ class CsvDatasetTest(test_base.DatasetTestBase, parameterized.TestCase):
     self._test_dataset_on_buffer_sizes(
         inputs, expected, linebreak='\r\n', record_defaults=record_defaults)
 
+  @combinations.generate(test_base.default_test_combinations())
+  def testWithLongFields(self):
+    # Fields that span several words and buffers, with special characters at
+    # varying offsets.
+    record_defaults = [['NA']] * 3
+    inputs = [[
+        'abcdefghijklmnop,"q,r\ns""t",uvwxyz0123456789',
+        '0123456,,"abcdefgh"', ',abcdefghi,j'
+    ]]
+    expected = [['abcdefghijklmnop', 'q,r\ns"t', 'uvwxyz0123456789'],
+                ['0123456', 'NA', 'abcdefgh'], ['NA', 'abcdefghi', 'j']]
+    for linebreak in ['\n', '\r', '\r\n']:
+      self._test_dataset_on_buffer_sizes(
+          inputs, expected, linebreak=linebreak,
+          record_defaults=record_defaults)
+
   @combinations.generate(test_base.default_test_combinations())
   def testWithGzipCompressionType(self):
     record_defaults = [['NA']] * 3
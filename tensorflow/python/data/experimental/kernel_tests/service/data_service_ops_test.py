@@ -1328,6 +1328,18 @@ class DataServiceOpsGrpcDataTransferTest(
     )
     self.assertDatasetProduces(ds, list(range(num_elements)))
 
+  @combinations.generate(test_base.default_test_combinations())
+  def testDistributeChunkedCompression(self):
+    cluster = self.make_test_cluster(num_workers=1)
+    # Elements of 4KB are compressed in 4 chunks.
+    ds = dataset_ops.Dataset.range(5).map(
+        lambda i: array_ops.fill([1024], math_ops.cast(i, dtypes.int32))
+    )
+    ds = self.make_distributed_dataset(
+        ds, cluster, compression="AUTO", compression_chunk_size=1024
+    )
+    self.assertDatasetProduces(ds, [[i] * 1024 for i in range(5)])
+
 
 if __name__ == "__main__":
   test.main()
@@ -448,6 +448,7 @@ def _distribute(
     compression="AUTO",
     cross_trainer_cache=None,
     target_workers="AUTO",
+    compression_chunk_size=0,
 ) -> Callable[dataset_ops.Dataset, dataset_ops.Dataset]:
   """A transformation that moves dataset processing to the tf.data service.
 
@@ -505,6 +506,11 @@ def _distribute(
       data copy if every TF worker colocates with a tf.data service worker.
       Consumers of a shared job must use the same `target_workers`. Defaults to
       `"AUTO"`.
+    compression_chunk_size: (Optional.) If positive and `compression` is
+      `"AUTO"`, elements larger than `compression_chunk_size` bytes are
+      compressed in parallel, in chunks of that size. Chunked elements can not
+      be read by TensorFlow versions which predate chunking. Defaults to 0,
+      which compresses each element as a whole.
 
   Returns:
     Dataset: A `Dataset` of the elements produced by the data service.
@@ -513,7 +519,11 @@ def _distribute(
   _validate_compression(compression)
 
   def _apply_fn(dataset) -> dataset_ops.Dataset:  # pylint: disable=missing-docstring
-    dataset_id = _register_dataset(service, dataset, compression=compression)
+    dataset_id = _register_dataset(
+        service,
+        dataset,
+        compression=compression,
+        compression_chunk_size=compression_chunk_size)
     return _from_dataset_id(
         processing_mode,
         service,
@@ -782,7 +792,11 @@ def distribute(
 
 
 def _register_dataset(
-    service, dataset, compression, dataset_id=None) -> tensor.Tensor:
+    service,
+    dataset,
+    compression,
+    dataset_id=None,
+    compression_chunk_size=0) -> tensor.Tensor:
   """Registers a dataset with the tf.data service.
 
   This transformation is similar to `register_dataset`, but supports additional
@@ -804,6 +818,9 @@ def _register_dataset(
       no new dataset is registered. This is useful if multiple training jobs
       want to (re)use the same dataset for training. In this case, they can
       register the dataset with the same dataset ID.
+    compression_chunk_size: (Optional.) If positive and `compression` is
+      `"AUTO"`, elements larger than `compression_chunk_size` bytes are
+      compressed in parallel, in chunks of that size.
 
   Returns:
     A scalar string tensor representing the dataset ID.
@@ -825,7 +842,8 @@ def _register_dataset(
 
   if compression == COMPRESSION_AUTO:
     dataset = dataset.map(
-        lambda *x: compression_ops.compress(x),
+        lambda *x: compression_ops.compress(
+            x, chunk_size=compression_chunk_size),
         num_parallel_calls=dataset_ops.AUTOTUNE)
   dataset = dataset._apply_debug_options()  # pylint: disable=protected-access
 
@@ -423,6 +423,42 @@ class MemoryCacheTest(test_base.DatasetTestBase, parameterized.TestCase):
     with self.assertRaises(StopIteration):
       next(iterator)
 
+  @combinations.generate(test_base.default_test_combinations())
+  def testMemoryBudget(self):
+    counter = variables.Variable(0)
+    self.evaluate(counter.initializer)
+
+    def increment_fn(x):
+      counter.assign_add(1)
+      return x
+
+    # Each element is 8 bytes, so the budget holds 4 of the 20 elements.
+    dataset = dataset_ops.Dataset.range(20).map(increment_fn).cache(
+        memory_budget_bytes=32,
+        spill_directory=os.path.join(self.get_temp_dir(), "spill"))
+    dataset = dataset.repeat(3)
+    options = options_lib.Options()
+    options.experimental_optimization.inject_prefetch = False
+    dataset = dataset.with_options(options)
+    self.assertDatasetProduces(
+        dataset, list(range(20)) * 3, requires_initialization=True)
+    self.assertEqual(20, self.evaluate(counter))
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testInvalidMemoryBudget(self):
+    with self.assertRaisesRegex(ValueError, "must be positive"):
+      dataset_ops.Dataset.range(10).cache(memory_budget_bytes=0)
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testMemoryBudgetWithFilename(self):
+    with self.assertRaisesRegex(ValueError, "only be set when caching in"):
+      dataset_ops.Dataset.range(10).cache(
+          os.path.join(self.get_temp_dir(), "cache"), memory_budget_bytes=32)
+    with self.assertRaisesRegex(ValueError, "only be set when caching in"):
+      dataset_ops.Dataset.range(10).cache(
+          os.path.join(self.get_temp_dir(), "cache"),
+          spill_directory=self.get_temp_dir())
+
   @combinations.generate(test_base.default_test_combinations())
   def testName(self):
     dataset = dataset_ops.Dataset.from_tensors(42).cache(name="cache")
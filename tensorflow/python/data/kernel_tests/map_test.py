@@ -1289,6 +1289,52 @@ class MapTest(test_base.DatasetTestBase, parameterized.TestCase):
     with self.assertRaises(errors.InvalidArgumentError):
       self.evaluate(get_next())
 
+  @combinations.generate(
+      combinations.combine(
+          tf_api_version=2,
+          mode="graph",
+          invocation_batch_size=[1, 3, dataset_ops.AUTOTUNE],
+          use_inter_op_parallelism=[False, True]))
+  def testInvocationBatchSize(self, invocation_batch_size,
+                              use_inter_op_parallelism):
+    dataset = dataset_ops.Dataset.range(100).map(
+        lambda x: x * x, num_parallel_calls=4)
+    dataset._variant_tensor.op._set_attr(
+        "use_inter_op_parallelism",
+        attr_value_pb2.AttrValue(b=use_inter_op_parallelism))
+    options = options_lib.Options()
+    options.autotune.map_invocation_batch_size = invocation_batch_size
+    dataset = dataset.with_options(options)
+    self.assertDatasetProduces(dataset, [x * x for x in range(100)])
+
+  @combinations.generate(
+      combinations.times(
+          test_base.default_test_combinations(),
+          combinations.combine(
+              invocation_batch_size=[3, dataset_ops.AUTOTUNE])))
+  def testInvocationBatchSizeError(self, invocation_batch_size):
+
+    def raising_py_func(i):
+      if i == 5:
+        raise ValueError("Invalid element")
+      return i
+
+    dataset = dataset_ops.Dataset.range(10).map(
+        lambda x: script_ops.py_func(raising_py_func, [x], dtypes.int64),
+        num_parallel_calls=2)
+    options = options_lib.Options()
+    options.autotune.map_invocation_batch_size = invocation_batch_size
+    dataset = dataset.with_options(options)
+    get_next = self.getNext(dataset)
+    # The error only affects the element that raised it, not the other
+    # elements grouped into the same invocation.
+    for i in range(10):
+      if i == 5:
+        with self.assertRaises(errors.InvalidArgumentError):
+          self.evaluate(get_next())
+      else:
+        self.assertEqual(i, self.evaluate(get_next()))
+
   @combinations.generate(_test_combinations_with_mode("graph"))
   def testCollectionCopy(self, apply_map):
     w = variable_scope.get_variable("w", [])
@@ -1592,6 +1638,23 @@ class MapCheckpointTest(checkpoint_test_base.CheckpointTestBase,
 
     verify_fn(self, _build_ds, tensor_slice_len * num_epochs)
 
+  @combinations.generate(
+      combinations.times(
+          test_base.default_test_combinations(),
+          checkpoint_test_base.default_test_combinations(),
+          combinations.combine(invocation_batch_size=[3,
+                                                      dataset_ops.AUTOTUNE])))
+  def testInvocationBatchSize(self, verify_fn, invocation_batch_size):
+
+    def _build_ds():
+      dataset = dataset_ops.Dataset.range(20).map(
+          lambda x: x * x, num_parallel_calls=2)
+      options = options_lib.Options()
+      options.autotune.map_invocation_batch_size = invocation_batch_size
+      return dataset.with_options(options)
+
+    verify_fn(self, _build_ds, num_outputs=20)
+
   @combinations.generate(
       combinations.times(test_base.default_test_combinations(),
                          combinations.combine(num_parallel_calls=[None, 2])))
@@ -525,6 +525,45 @@ class ShuffleTest(test_base.DatasetTestBase, parameterized.TestCase):
     del iterator
     manager.restore_or_initialize()
 
+  @combinations.generate(
+      combinations.times(
+          test_base.default_test_combinations(),
+          combinations.combine(compress_buffer=[True, False])))
+  def testBufferSizeBytes(self, compress_buffer):
+    dataset = dataset_ops.Dataset.range(100).map(
+        lambda x: (x, array_ops.fill([x % 7], "element")))
+    dataset = dataset.shuffle(
+        buffer_size=1000,
+        seed=37,
+        buffer_size_bytes=256,
+        compress_buffer=compress_buffer)
+    get_next = self.getNext(dataset)
+    results = []
+    for _ in range(100):
+      x, strings = self.evaluate(get_next())
+      self.assertLen(strings, x % 7)
+      results.append(x)
+    with self.assertRaises(errors.OutOfRangeError):
+      self.evaluate(get_next())
+    self.assertCountEqual(results, range(100))
+    self.assertNotEqual(results, list(range(100)))
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testBufferSizeBytesMatchesUnpackedShuffle(self):
+    # The byte budget holds every element, so the packed buffer must sample
+    # exactly like the default buffer.
+    dataset = dataset_ops.Dataset.range(50)
+    unpacked = dataset.shuffle(10, seed=42, reshuffle_each_iteration=False)
+    packed = dataset.shuffle(
+        10, seed=42, reshuffle_each_iteration=False, buffer_size_bytes=1 << 20)
+    self.assertEqual(
+        self.getDatasetOutput(unpacked), self.getDatasetOutput(packed))
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testInvalidBufferSizeBytes(self):
+    with self.assertRaisesRegex(ValueError, "must be positive"):
+      dataset_ops.Dataset.range(10).shuffle(10, buffer_size_bytes=0)
+
   @combinations.generate(test_base.default_test_combinations())
   def testName(self):
     dataset = dataset_ops.Dataset.from_tensors(42).shuffle(1, name="shuffle")
@@ -596,6 +635,22 @@ class ShuffleCheckpointTest(checkpoint_test_base.CheckpointTestBase,
         num_outputs,
     )
 
+  @combinations.generate(
+      combinations.times(
+          test_base.default_test_combinations(),
+          checkpoint_test_base.default_test_combinations(),
+          combinations.combine(compress_buffer=[True, False])))
+  def testPackedBuffer(self, verify_fn, compress_buffer):
+
+    def build_dataset():
+      return dataset_ops.Dataset.range(20).shuffle(
+          8,
+          seed=55,
+          buffer_size_bytes=64,
+          compress_buffer=compress_buffer).repeat(2)
+
+    verify_fn(self, build_dataset, num_outputs=40)
+
   @combinations.generate(
       combinations.combine(
           tf_api_version=1,
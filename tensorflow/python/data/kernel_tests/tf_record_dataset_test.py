@@ -20,6 +20,7 @@ import zlib
 
 from absl.testing import parameterized
 
+from tensorflow.python.data.experimental.ops import global_shuffle_op
 from tensorflow.python.data.kernel_tests import checkpoint_test_base
 from tensorflow.python.data.kernel_tests import test_base
 from tensorflow.python.data.kernel_tests import tf_record_test_base
@@ -28,6 +29,8 @@ from tensorflow.python.data.ops import options as options_lib
 from tensorflow.python.data.ops import readers
 from tensorflow.python.framework import combinations
 from tensorflow.python.framework import constant_op
+from tensorflow.python.framework import errors
+from tensorflow.python.lib.io import tf_record
 from tensorflow.python.platform import test
 
 
@@ -271,5 +274,72 @@ class TFRecordDatasetCheckpointTest(tf_record_test_base.TFRecordTestBase,
             num_epochs, compression_type=compression_type), num_outputs)
 
 
+class TFRecordDatasetGlobalShuffleTest(tf_record_test_base.TFRecordTestBase,
+                                       checkpoint_test_base.CheckpointTestBase,
+                                       parameterized.TestCase):
+
+  def _createIndexedFiles(self):
+    filenames = []
+    for i in range(self._num_files):
+      fn = os.path.join(self.get_temp_dir(), "tf_record_indexed.%d.txt" % i)
+      filenames.append(fn)
+      with tf_record.TFRecordWriter(fn, write_index=True) as writer:
+        for j in range(self._num_records):
+          writer.write(self._record(i, j))
+    return filenames
+
+  @combinations.generate(
+      combinations.times(
+          test_base.default_test_combinations(),
+          combinations.combine(reshuffle_each_iteration=[True, False])))
+  def testGlobalShuffle(self, reshuffle_each_iteration):
+    dataset = readers.TFRecordDataset(self._createIndexedFiles())
+    dataset = global_shuffle_op._global_shuffle(
+        dataset, seed=42, reshuffle_each_iteration=reshuffle_each_iteration)
+
+    expected = [
+        self._record(i, j)
+        for i in range(self._num_files)
+        for j in range(self._num_records)
+    ]
+    self.assertLen(expected, self.evaluate(dataset.cardinality()))
+    dataset_output = self.getDatasetOutput(
+        dataset, requires_initialization=True)
+    self.assertCountEqual(dataset_output, expected)
+    self.assertNotEqual(dataset_output, expected)
+
+  @combinations.generate(test_base.default_test_combinations())
+  def testGlobalShuffleRequiresIndex(self):
+    dataset = readers.TFRecordDataset(self._filenames)
+    with self.assertRaises(errors.FailedPreconditionError):
+      dataset = global_shuffle_op._global_shuffle(dataset, seed=42)
+      self.getDatasetOutput(dataset, requires_initialization=True)
+
+  @combinations.generate(
+      combinations.times(
+          test_base.default_test_combinations(),
+          checkpoint_test_base.default_test_combinations(),
+          combinations.combine(
+              reshuffle_each_iteration=[True, False],
+              symbolic_checkpoint=[True, False])))
+  def testGlobalShuffleCheckpoint(self, verify_fn, reshuffle_each_iteration,
+                                  symbolic_checkpoint):
+    filenames = self._createIndexedFiles()
+
+    def _build_dataset():
+      dataset = readers.TFRecordDataset(filenames)
+      dataset = global_shuffle_op._global_shuffle(
+          dataset, seed=42, reshuffle_each_iteration=reshuffle_each_iteration)
+      options = options_lib.Options()
+      options.experimental_symbolic_checkpoint = symbolic_checkpoint
+      return dataset.with_options(options)
+
+    verify_fn(
+        self,
+        _build_dataset,
+        num_outputs=self._num_files * self._num_records,
+        assert_items_equal=reshuffle_each_iteration)
+
+
 if __name__ == "__main__":
   test.main()
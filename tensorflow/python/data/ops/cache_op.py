@@ -19,31 +19,56 @@ from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.eager import context
 from tensorflow.python.framework import dtypes
 from tensorflow.python.framework import ops
+from tensorflow.python.framework import tensor_util
 from tensorflow.python.ops import gen_dataset_ops
 
 
-def _cache(input_dataset, filename, name):  # pylint: disable=unused-private-name
-  return CacheDataset(input_dataset, filename, name)
+def _cache(  # pylint: disable=unused-private-name
+    input_dataset, filename, name, memory_budget_bytes, spill_directory):
+  return CacheDataset(input_dataset, filename, name, memory_budget_bytes,
+                      spill_directory)
 
 
 class CacheDataset(dataset_ops.UnaryUnchangedStructureDataset):
   """A `Dataset` that caches elements of its input."""
 
-  def __init__(self, input_dataset, filename, name=None):
+  def __init__(self,
+               input_dataset,
+               filename,
+               name=None,
+               memory_budget_bytes=None,
+               spill_directory=None):
     """See `Dataset.cache()` for details."""
     self._input_dataset = input_dataset
     self._filename = ops.convert_to_tensor(
         filename, dtype=dtypes.string, name="filename")
     self._name = name
+    spilling_args = {}
+    if memory_budget_bytes is not None:
+      if memory_budget_bytes <= 0:
+        raise ValueError("`memory_budget_bytes` must be positive, but got "
+                         f"{memory_budget_bytes}.")
+      spilling_args["memory_budget_bytes"] = memory_budget_bytes
+    if spill_directory is not None:
+      spilling_args["spill_directory"] = spill_directory
+    # Only the in-memory cache spills. A filename that is not known statically
+    # is checked by the kernel instead.
+    filename_value = tensor_util.constant_value(self._filename)
+    if spilling_args and filename_value:
+      raise ValueError("`memory_budget_bytes` and `spill_directory` can only "
+                       "be set when caching in memory, but got filename "
+                       f"{filename_value!r}.")
     if tf2.enabled() and (context.executing_eagerly() or ops.inside_function()):
       variant_tensor = gen_dataset_ops.cache_dataset_v2(
           input_dataset._variant_tensor,  # pylint: disable=protected-access
           filename=self._filename,
           cache=gen_dataset_ops.dummy_memory_cache(),
+          **spilling_args,
           **self._common_args)
     else:
       variant_tensor = gen_dataset_ops.cache_dataset(
           input_dataset._variant_tensor,  # pylint: disable=protected-access
           filename=self._filename,
+          **spilling_args,
           **self._common_args)
     super().__init__(input_dataset, variant_tensor)
@@ -1408,7 +1408,13 @@ class DatasetV2(
     return Dataset.zip((range_dataset, self), name=name)
 
   def shuffle(
-      self, buffer_size, seed=None, reshuffle_each_iteration=True, name=None
+      self,
+      buffer_size,
+      seed=None,
+      reshuffle_each_iteration=True,
+      buffer_size_bytes=None,
+      compress_buffer=False,
+      name=None,
   ) -> "DatasetV2":
     """Randomly shuffles the elements of this dataset.
 
@@ -1482,6 +1488,20 @@ class DatasetV2(
     # [18, 4, 9, 2, 17, 8, 5, 10, 0, 6, 16, 3, 19, 7, 14, 11, 15, 13, 12, 1]
     ```
 
+    #### Bounding the buffer by memory
+
+    When elements vary in size, a buffer size in elements is a poor proxy for
+    memory. Setting `buffer_size_bytes` stores the buffered elements in a
+    compact packed form and stops filling the buffer once it holds that many
+    bytes, so `buffer_size` becomes an upper bound on the number of elements.
+    Setting `compress_buffer=True` additionally compresses each buffered
+    element, trading CPU for more elements in the same memory. Elements are
+    still sampled uniformly from the buffer.
+
+    ```python
+    dataset = dataset.shuffle(1_000_000, buffer_size_bytes=4 << 30)
+    ```
+
     Args:
       buffer_size: An int or `tf.int64` scalar `tf.Tensor`, representing the
         number of elements from this dataset from which the new dataset will
@@ -1493,15 +1513,30 @@ class DatasetV2(
       reshuffle_each_iteration: (Optional.) A boolean, which if true indicates
         that the dataset should be pseudorandomly reshuffled each time it is
         iterated over. (Defaults to `True`.)
+      buffer_size_bytes: (Optional.) The maximum number of bytes of packed
+        elements to keep in the shuffle buffer. If not set, the buffer holds
+        `buffer_size` elements regardless of their size.
+      compress_buffer: (Optional.) Whether to compress the elements kept in a
+        packed shuffle buffer. (Defaults to `False`.)
       name: (Optional.) A name for the tf.data operation.
 
     Returns:
       A new `Dataset` with the transformation applied as described above.
     """
     return shuffle_op._shuffle(  # pylint: disable=protected-access
-        self, buffer_size, seed, reshuffle_each_iteration, name=name)
+        self,
+        buffer_size,
+        seed,
+        reshuffle_each_iteration,
+        buffer_size_bytes=buffer_size_bytes,
+        compress_buffer=compress_buffer,
+        name=name)
 
-  def cache(self, filename="", name=None) -> "DatasetV2":
+  def cache(self,
+            filename="",
+            name=None,
+            memory_budget_bytes=None,
+            spill_directory=None) -> "DatasetV2":
     """Caches the elements in this dataset.
 
     The first time the dataset is iterated over, its elements will be cached
@@ -1539,6 +1574,16 @@ class DatasetV2(
     # [0, 1, 2, 3, 4]
     ```
 
+    When caching in memory, `memory_budget_bytes` bounds the memory used by
+    the cache. Elements beyond the budget are spilled to a local file and read
+    back when they are needed, least recently used elements first. This allows
+    caching datasets that are somewhat larger than the available memory.
+
+    ```python
+    dataset = dataset.cache(memory_budget_bytes=8 << 30,
+                            spill_directory="/local/ssd/cache")
+    ```
+
     Note: `cache` will produce exactly the same elements during each iteration
     through the dataset. If you wish to randomize the iteration order, make sure
     to call `shuffle` *after* calling `cache`.
@@ -1548,15 +1593,25 @@ class DatasetV2(
         directory on the filesystem to use for caching elements in this Dataset.
         If a filename is not provided, the dataset will be cached in memory.
       name: (Optional.) A name for the tf.data operation.
+      memory_budget_bytes: (Optional.) When caching in memory, the maximum
+        number of bytes of elements to keep in memory. The remaining elements
+        are spilled to disk. If not set, all elements are kept in memory.
+      spill_directory: (Optional.) The local directory to spill elements to
+        when `memory_budget_bytes` is set. Defaults to a temporary directory.
 
     Returns:
       A new `Dataset` with the transformation applied as described above.
+
+    Raises:
+      ValueError: If `memory_budget_bytes` or `spill_directory` is set together
+        with a `filename`.
     """
     # Loaded lazily due to a circular dependency (dataset_ops -> cache_op ->
     # -> dataset_ops).
     # pylint: disable=g-import-not-at-top,protected-access
     from tensorflow.python.data.ops import cache_op
-    return cache_op._cache(self, filename, name)
+    return cache_op._cache(self, filename, name, memory_budget_bytes,
+                           spill_directory)
     # pylint: enable=g-import-not-at-top,protected-access
 
   def take(self, count, name=None) -> "DatasetV2":
@@ -4033,14 +4088,30 @@ class DatasetV1(DatasetV2, data_types.DatasetV1):
               buffer_size,
               seed=None,
               reshuffle_each_iteration=None,
+              buffer_size_bytes=None,
+              compress_buffer=False,
               name=None):
     return DatasetV1Adapter(
         super(DatasetV1, self).shuffle(
-            buffer_size, seed, reshuffle_each_iteration, name=name))
+            buffer_size,
+            seed,
+            reshuffle_each_iteration,
+            buffer_size_bytes=buffer_size_bytes,
+            compress_buffer=compress_buffer,
+            name=name))
 
   @functools.wraps(DatasetV2.cache)
-  def cache(self, filename="", name=None):
-    return DatasetV1Adapter(super(DatasetV1, self).cache(filename, name=name))
+  def cache(self,
+            filename="",
+            name=None,
+            memory_budget_bytes=None,
+            spill_directory=None):
+    return DatasetV1Adapter(
+        super(DatasetV1, self).cache(
+            filename,
+            name=name,
+            memory_budget_bytes=memory_budget_bytes,
+            spill_directory=spill_directory))
 
   @functools.wraps(DatasetV2.take)
   def take(self, count, name=None):
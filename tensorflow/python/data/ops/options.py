@@ -241,6 +241,20 @@ class AutotuneOptions(options_lib.OptionsBase):
       ),
   )
 
+  map_invocation_batch_size = options_lib.create_option(
+      name="map_invocation_batch_size",
+      ty=int,
+      docstring=(
+          "If set, parallel `map` transformations apply their function to"
+          " groups of this many consecutive input elements, running each"
+          " group as a single task instead of scheduling one task per element."
+          " This reduces the scheduling overhead of cheap map functions. If"
+          " set to `tf.data.AUTOTUNE`, the group size is chosen by autotuning,"
+          " which weighs the measured time to start a task against the latency"
+          " of running the elements of a group one after the other."
+      ),
+  )
+
   def _to_proto(self):
     pb = dataset_options_pb2.AutotuneOptions()
     if self.enabled is not None:
@@ -254,6 +268,8 @@ class AutotuneOptions(options_lib.OptionsBase):
           self.autotune_algorithm)
     if self.initial_parallelism is not None:
       pb.initial_parallelism = self.initial_parallelism
+    if self.map_invocation_batch_size is not None:
+      pb.map_invocation_batch_size = self.map_invocation_batch_size
     return pb
 
   def _from_proto(self, pb):
@@ -268,6 +284,8 @@ class AutotuneOptions(options_lib.OptionsBase):
           pb.autotune_algorithm)
     if pb.WhichOneof("optional_initial_parallelism") is not None:
       self.initial_parallelism = pb.initial_parallelism
+    if pb.WhichOneof("optional_map_invocation_batch_size") is not None:
+      self.map_invocation_batch_size = pb.map_invocation_batch_size
 
   def _set_mutable(self, mutable):
     """Change the mutability value to `mutable` on this options and children."""
@@ -289,6 +289,8 @@ class _TFRecordDataset(dataset_ops.DatasetSource):
                filenames,
                compression_type=None,
                buffer_size=None,
+               readahead_depth=None,
+               readahead_chunk_size=None,
                name=None):
     """Creates a `TFRecordDataset`.
 
@@ -298,6 +300,10 @@ class _TFRecordDataset(dataset_ops.DatasetSource):
         `""` (no compression), `"ZLIB"`, or `"GZIP"`.
       buffer_size: (Optional.) A `tf.int64` scalar representing the number of
         bytes in the read buffer. 0 means no buffering.
+      readahead_depth: (Optional.) A Python integer. If positive, the number
+        of reads kept in flight ahead of the consumer.
+      readahead_chunk_size: (Optional.) A Python integer, the number of bytes
+        fetched by each readahead read.
       name: (Optional.) A name for the tf.data operation.
     """
     self._filenames = filenames
@@ -312,9 +318,16 @@ class _TFRecordDataset(dataset_ops.DatasetSource):
         argument_default=_DEFAULT_TF_RECORD_BUFFER_SIZE_BYTES)
     self._name = name
 
+    # Only set the readahead attrs when requested so that graphs which do not
+    # use readahead stay loadable by older binaries.
+    readahead_kwargs = {}
+    if readahead_depth:
+      readahead_kwargs["readahead_depth"] = readahead_depth
+    if readahead_chunk_size:
+      readahead_kwargs["readahead_chunk_size"] = readahead_chunk_size
     variant_tensor = gen_dataset_ops.tf_record_dataset(
         self._filenames, self._compression_type, self._buffer_size,
-        metadata=self._metadata.SerializeToString())
+        metadata=self._metadata.SerializeToString(), **readahead_kwargs)
     super(_TFRecordDataset, self).__init__(variant_tensor)
 
   @property
@@ -437,6 +450,8 @@ class TFRecordDatasetV2(dataset_ops.DatasetV2):
                compression_type=None,
                buffer_size=None,
                num_parallel_reads=None,
+               readahead_depth=None,
+               readahead_chunk_size=None,
                name=None):
     """Creates a `TFRecordDataset` to read one or more TFRecord files.
 
@@ -457,6 +472,12 @@ class TFRecordDatasetV2(dataset_ops.DatasetV2):
         input pipeline is I/O bottlenecked, consider setting this parameter to a
         value greater than one to parallelize the I/O. If `None`, files will be
         read sequentially.
+      readahead_depth: (Optional.) A Python integer. If positive, each file is
+        read by this many concurrent background reads issued ahead of the
+        consumer, which hides the per-request latency of remote file systems.
+        Takes precedence over `buffer_size`. If `None`, no readahead is used.
+      readahead_chunk_size: (Optional.) A Python integer representing the
+        number of bytes fetched by each readahead read. If `None`, 8MB is used.
       name: (Optional.) A name for the tf.data operation.
 
     Raises:
@@ -472,7 +493,12 @@ class TFRecordDatasetV2(dataset_ops.DatasetV2):
 
     def creator_fn(filename):
       return _TFRecordDataset(
-          filename, compression_type, buffer_size, name=name)
+          filename,
+          compression_type,
+          buffer_size,
+          readahead_depth=readahead_depth,
+          readahead_chunk_size=readahead_chunk_size,
+          name=name)
 
     self._impl = _create_dataset_reader(
         creator_fn, filenames, num_parallel_reads, name=name)
@@ -496,9 +522,17 @@ class TFRecordDatasetV1(dataset_ops.DatasetV1Adapter):
                compression_type=None,
                buffer_size=None,
                num_parallel_reads=None,
+               readahead_depth=None,
+               readahead_chunk_size=None,
                name=None):
     wrapped = TFRecordDatasetV2(
-        filenames, compression_type, buffer_size, num_parallel_reads, name=name)
+        filenames,
+        compression_type,
+        buffer_size,
+        num_parallel_reads,
+        readahead_depth=readahead_depth,
+        readahead_chunk_size=readahead_chunk_size,
+        name=name)
     super(TFRecordDatasetV1, self).__init__(wrapped)
 
   __init__.__doc__ = TFRecordDatasetV2.__init__.__doc__
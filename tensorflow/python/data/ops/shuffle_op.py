@@ -27,10 +27,18 @@ def _shuffle(  # pylint: disable=unused-private-name
     buffer_size,
     seed=None,
     reshuffle_each_iteration=True,
+    buffer_size_bytes=None,
+    compress_buffer=False,
     name=None,
 ):
   return _ShuffleDataset(
-      input_dataset, buffer_size, seed, reshuffle_each_iteration, name=name)
+      input_dataset,
+      buffer_size,
+      seed,
+      reshuffle_each_iteration,
+      buffer_size_bytes=buffer_size_bytes,
+      compress_buffer=compress_buffer,
+      name=name)
 
 
 class _ShuffleDataset(dataset_ops.UnaryUnchangedStructureDataset):
@@ -42,6 +50,8 @@ class _ShuffleDataset(dataset_ops.UnaryUnchangedStructureDataset):
       buffer_size,
       seed=None,
       reshuffle_each_iteration=True,
+      buffer_size_bytes=None,
+      compress_buffer=False,
       name=None,
   ):
     """See `Dataset.shuffle()` for details."""
@@ -51,9 +61,19 @@ class _ShuffleDataset(dataset_ops.UnaryUnchangedStructureDataset):
     self._seed, self._seed2 = random_seed.get_seed(seed)
     self._reshuffle_each_iteration = reshuffle_each_iteration
     self._name = name
+    packed_args = {}
+    if buffer_size_bytes is not None:
+      if buffer_size_bytes <= 0:
+        raise ValueError("`buffer_size_bytes` must be positive, but got "
+                         f"{buffer_size_bytes}.")
+      packed_args["buffer_size_bytes"] = buffer_size_bytes
+    if compress_buffer:
+      packed_args["compress_buffer"] = True
 
-    if (tf2.enabled() and
-        (context.executing_eagerly() or ops.inside_function())):
+    # Only `ShuffleDatasetV3` supports the packed buffer, so it is also used
+    # in graph mode when the packed buffer is requested.
+    if packed_args or (tf2.enabled() and
+                       (context.executing_eagerly() or ops.inside_function())):
       variant_tensor = gen_dataset_ops.shuffle_dataset_v3(
           input_dataset._variant_tensor,  # pylint: disable=protected-access
           buffer_size=self._buffer_size,
@@ -61,6 +81,7 @@ class _ShuffleDataset(dataset_ops.UnaryUnchangedStructureDataset):
           seed2=self._seed2,
           seed_generator=gen_dataset_ops.dummy_seed_generator(),
           reshuffle_each_iteration=self._reshuffle_each_iteration,
+          **packed_args,
           **self._common_args)
     else:
       variant_tensor = gen_dataset_ops.shuffle_dataset(
@@ -590,6 +590,7 @@ class Context:
     self._default_is_async = execution_mode == ASYNC
     self._use_tfrt = is_tfrt_enabled()
     self._jit_compile_rewrite = jit_compile_rewrite_enabled()
+    self._lazy_execution = False
     self._xla_sharding_for_resource_variables = (
         xla_sharding_for_resource_variables_enabled()
     )
@@ -745,6 +746,8 @@ class Context:
         pywrap_tfe.TFE_EnableCollectiveOps(context_handle, server_def_str)
 
       self._context_handle = context_handle
+      if self._lazy_execution:
+        pywrap_tfe.TFE_ContextSetLazyExecution(context_handle, True, 0)
       self._initialize_logical_devices()
       self._initialized = True
 
@@ -2265,6 +2268,20 @@ class Context:
       pywrap_tfe.TFE_ContextSetJitCompileRewrite(self._handle, enable)
     self._jit_compile_rewrite = enable
 
+  @property
+  def lazy_execution(self):
+    """Whether eager ops are deferred and run as functions when needed."""
+    return self._lazy_execution
+
+  @lazy_execution.setter
+  def lazy_execution(self, enable):
+    # Holds the lock so that a concurrent initialization sees the new value.
+    with self._initialize_lock:
+      if self._context_handle is not None:
+        pywrap_tfe.TFE_ContextSetLazyExecution(
+            self._context_handle, enable, 0)
+      self._lazy_execution = enable
+
   @property
   def xla_sharding_for_resource_variables(self):
     return self._xla_sharding_for_resource_variables
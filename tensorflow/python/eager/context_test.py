@@ -165,6 +165,18 @@ class ContextTest(test.TestCase, parameterized.TestCase):
     self.assertIn(concrete.name.decode(),
                   context.context().list_function_names())
 
+  def testLazyExecution(self):
+    ctx = context.context()
+    ctx.lazy_execution = True
+    try:
+      self.assertTrue(ctx.lazy_execution)
+      x = constant_op.constant(3)
+      y = x * x + x
+      self.assertEqual(y.numpy(), 12)
+    finally:
+      ctx.lazy_execution = False
+    self.assertFalse(ctx.lazy_execution)
+
   def testSetLogicalDeviceAfterContextInitialization(self):
     ctx = context.Context()
     ctx.set_logical_cpu_devices(4)
@@ -4226,6 +4226,91 @@ class MutableHashTableOpTest(test.TestCase):
     self.assertTrue(inferred_shapes[1].is_compatible_with(actual_shapes[1]))
 
 
+class MutableShardedHashTableOpTest(test.TestCase):
+
+  def testMutableShardedHashTable(self):
+    keys = constant_op.constant(["brain", "salad", "surgery", "tarkus"])
+    values = constant_op.constant([0, 1, 2, 3], dtypes.int64)
+    table = lookup_ops.MutableShardedHashTable(
+        dtypes.string, dtypes.int64, default_value=-1, num_shards=4)
+    self.assertAllEqual(0, self.evaluate(table.size()))
+
+    self.evaluate(table.insert(keys, values))
+    self.assertAllEqual(4, self.evaluate(table.size()))
+
+    self.evaluate(table.remove(constant_op.constant(["tarkus", "tank"])))
+    self.assertAllEqual(3, self.evaluate(table.size()))
+
+    output = table.lookup(constant_op.constant(["brain", "salad", "tank"]))
+    self.assertAllEqual([0, 1, -1], self.evaluate(output))
+
+    exported_keys, exported_values = table.export()
+    self.assertAllEqual([b"brain", b"salad", b"surgery"],
+                        np.sort(self.evaluate(exported_keys)))
+    self.assertAllEqual([0, 1, 2], np.sort(self.evaluate(exported_values)))
+
+  def testMutableShardedHashTableOfVectors(self):
+    table = lookup_ops.MutableShardedHashTable(
+        dtypes.int64, dtypes.float32, default_value=[-1.0, -1.0])
+    self.evaluate(
+        table.insert(
+            constant_op.constant([3, 5], dtypes.int64),
+            constant_op.constant([[1.0, 2.0], [3.0, 4.0]], dtypes.float32)))
+    output = table.lookup(constant_op.constant([5, 7], dtypes.int64))
+    self.assertAllEqual([2, 2], output.get_shape())
+    self.assertAllEqual([[3.0, 4.0], [-1.0, -1.0]], self.evaluate(output))
+
+  def testInvalidNumShards(self):
+    with self.assertRaisesRegex(ValueError, "power of 2"):
+      lookup_ops.MutableShardedHashTable(
+          dtypes.string, dtypes.int64, default_value=-1, num_shards=3)
+
+  @test_util.run_in_graph_and_eager_modes
+  def testObjectSaveRestore(self):
+    save_prefix = os.path.join(self.get_temp_dir(), "hash")
+    table = lookup_ops.MutableShardedHashTable(
+        dtypes.string, dtypes.int64, default_value=-1, name="t1")
+    checkpoint = trackable.Checkpoint(table=table)
+    self.evaluate(
+        table.insert(
+            constant_op.constant(["b", "c", "d"], dtypes.string),
+            constant_op.constant([0, 1, 2], dtypes.int64)))
+    save_path = checkpoint.save(save_prefix)
+    del table, checkpoint
+
+    table = lookup_ops.MutableShardedHashTable(
+        dtypes.string, dtypes.int64, default_value=-1, name="t1")
+    self.evaluate(
+        table.insert(
+            constant_op.constant(["a", "c"], dtypes.string),
+            constant_op.constant([12, 24], dtypes.int64)))
+    checkpoint = trackable.Checkpoint(table=table)
+    checkpoint.restore(save_path).run_restore_ops()
+
+    self.assertAllEqual(3, self.evaluate(table.size()))
+    output = table.lookup(
+        constant_op.constant(["a", "b", "c", "d", "e"], dtypes.string))
+    self.assertAllEqual([-1, 0, 1, 2, -1], self.evaluate(output))
+
+  @test_util.run_v2_only
+  def testRestoreFromMutableHashTable(self):
+    save_prefix = os.path.join(self.get_temp_dir(), "hash")
+    table = lookup_ops.MutableHashTable(
+        dtypes.int64, dtypes.int64, default_value=-1)
+    self.evaluate(
+        table.insert(
+            constant_op.constant([1, 2], dtypes.int64),
+            constant_op.constant([10, 20], dtypes.int64)))
+    save_path = trackable.Checkpoint(table=table).save(save_prefix)
+
+    sharded_table = lookup_ops.MutableShardedHashTable(
+        dtypes.int64, dtypes.int64, default_value=-1)
+    trackable.Checkpoint(table=sharded_table).restore(save_path)
+    output = sharded_table.lookup(
+        constant_op.constant([1, 2, 3], dtypes.int64))
+    self.assertAllEqual([10, 20, -1], self.evaluate(output))
+
+
 class MutableHashTableBenchmark(test.Benchmark):
 
   def _create_table(self):
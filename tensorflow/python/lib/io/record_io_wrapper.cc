@@ -20,6 +20,7 @@ limitations under the License.
 #include "pybind11/pybind11.h"  // from @pybind11
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/lib/io/record_index.h"
 #include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/lib/io/record_writer.h"
 #include "tensorflow/core/lib/io/zlib_compression_options.h"
@@ -166,14 +167,24 @@ class PyRecordWriter {
  public:
   static tensorflow::Status New(
       const std::string& filename,
-      const tensorflow::io::RecordWriterOptions& options,
+      const tensorflow::io::RecordWriterOptions& options, bool write_index,
       PyRecordWriter** out) {
     std::unique_ptr<tensorflow::WritableFile> file;
     TF_RETURN_IF_ERROR(
         tensorflow::Env::Default()->NewWritableFile(filename, &file));
-    auto writer =
-        std::make_unique<tensorflow::io::RecordWriter>(file.get(), options);
-    *out = new PyRecordWriter(std::move(file), std::move(writer));
+    std::unique_ptr<tensorflow::WritableFile> index_file;
+    std::unique_ptr<tensorflow::io::RecordWriter> writer;
+    if (write_index) {
+      TF_RETURN_IF_ERROR(tensorflow::Env::Default()->NewWritableFile(
+          tensorflow::io::RecordIndexFilename(filename), &index_file));
+      writer = std::make_unique<tensorflow::io::RecordWriter>(
+          file.get(), index_file.get(), options);
+    } else {
+      writer =
+          std::make_unique<tensorflow::io::RecordWriter>(file.get(), options);
+    }
+    *out = new PyRecordWriter(std::move(file), std::move(index_file),
+                              std::move(writer));
     return absl::OkStatus();
   }
 
@@ -214,15 +225,25 @@ class PyRecordWriter {
       file_ = nullptr;
       if (!status.ok()) return status;
     }
+    if (index_file_ != nullptr) {
+      auto status = index_file_->Close();
+      index_file_ = nullptr;
+      if (!status.ok()) return status;
+    }
     return absl::OkStatus();
   }
 
  private:
   PyRecordWriter(std::unique_ptr<tensorflow::WritableFile> file,
+                 std::unique_ptr<tensorflow::WritableFile> index_file,
                  std::unique_ptr<tensorflow::io::RecordWriter> writer)
-      : file_(std::move(file)), writer_(std::move(writer)) {}
+      : file_(std::move(file)),
+        index_file_(std::move(index_file)),
+        writer_(std::move(writer)) {}
 
   std::unique_ptr<tensorflow::WritableFile> file_;
+  // Only set when writing a record index.
+  std::unique_ptr<tensorflow::WritableFile> index_file_;
   std::unique_ptr<tensorflow::io::RecordWriter> writer_;
 
   PyRecordWriter(const PyRecordWriter&) = delete;
@@ -328,17 +349,20 @@ PYBIND11_MODULE(_pywrap_record_io, m) {
   using tensorflow::MaybeRaiseRegisteredFromStatus;
 
   py::class_<PyRecordWriter>(m, "RecordWriter")
-      .def(py::init(
-          [](const std::string& filename, const RecordWriterOptions& options) {
-            PyRecordWriter* self = nullptr;
-            tensorflow::Status status;
-            {
-              py::gil_scoped_release release;
-              status = PyRecordWriter::New(filename, options, &self);
-            }
-            tsl::MaybeRaiseRegisteredFromStatus(status);
-            return self;
-          }))
+      .def(py::init([](const std::string& filename,
+                       const RecordWriterOptions& options, bool write_index) {
+             PyRecordWriter* self = nullptr;
+             tensorflow::Status status;
+             {
+               py::gil_scoped_release release;
+               status =
+                   PyRecordWriter::New(filename, options, write_index, &self);
+             }
+             tsl::MaybeRaiseRegisteredFromStatus(status);
+             return self;
+           }),
+           py::arg("filename"), py::arg("options"),
+           py::arg("write_index") = false)
       .def("__enter__", [](const py::object& self) { return self; })
       .def("__exit__",
            [](PyRecordWriter* self, py::args) {
@@ -275,13 +275,17 @@ class TFRecordWriter(_pywrap_record_io.RecordWriter):
   """
 
   # TODO(josh11b): Support appending?
-  def __init__(self, path, options=None):
+  def __init__(self, path, options=None, write_index=False):
     """Opens file `path` and creates a `TFRecordWriter` writing to it.
 
     Args:
       path: The path to the TFRecords file.
       options: (optional) String specifying compression type,
           `TFRecordCompressionType`, or `TFRecordOptions` object.
+      write_index: (optional) If `True`, also writes a record index to
+          `path + ".idx"`, which lets `tf.data.TFRecordDataset` read the
+          records of uncompressed files in any order, as needed to shuffle
+          them globally.
 
     Raises:
       IOError: If `path` cannot be opened for writing.
@@ -292,7 +296,8 @@ class TFRecordWriter(_pywrap_record_io.RecordWriter):
 
     # pylint: disable=protected-access
     super(TFRecordWriter, self).__init__(
-        compat.as_bytes(path), options._as_record_writer_options())
+        compat.as_bytes(path), options._as_record_writer_options(),
+        write_index)
     # pylint: enable=protected-access
 
   # TODO(slebedev): The following wrapper methods are there to compensate
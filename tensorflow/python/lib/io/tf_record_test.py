@@ -292,6 +292,24 @@ class TFRecordWriterTest(TFCompressionTestCase):
             "Setting {} = {}, file was {} smaller didn't match sign of {}"
             .format(prop, value, delta, delta_sign))
 
+  def testWriteIndex(self):
+    """test the record index written next to the file"""
+    fn = os.path.join(self.get_temp_dir(), "tfrecord_indexed")
+    records = [b"a" * i for i in range(5)]
+    with tf_record.TFRecordWriter(fn, write_index=True) as writer:
+      for record in records:
+        writer.write(record)
+    self.assertEqual(records, list(tf_record.tf_record_iterator(fn)))
+    with open(fn + ".idx", "rb") as f:
+      index = f.read()
+    # Magic, one offset per record, the end offset, count and magic.
+    self.assertLen(index, 8 * (len(records) + 4))
+
+    fn = os.path.join(self.get_temp_dir(), "tfrecord_unindexed")
+    with tf_record.TFRecordWriter(fn) as writer:
+      writer.write(b"a")
+    self.assertFalse(os.path.exists(fn + ".idx"))
+
 
 class TFRecordWriterZlibTest(TFCompressionTestCase):
   """TFRecordWriter Zlib test"""
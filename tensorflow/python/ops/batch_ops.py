@@ -15,6 +15,7 @@
 
 """Operations for automatic batching and unbatching."""
 from tensorflow.python.eager import def_function
+from tensorflow.python.framework import dtypes
 from tensorflow.python.framework import ops
 from tensorflow.python.framework import tensor
 from tensorflow.python.ops import gen_batch_ops
@@ -32,7 +33,10 @@ def batch_function(num_batch_threads,
                    allowed_batch_sizes=None,
                    max_enqueued_batches=10,
                    autograph=True,
-                   enable_large_batch_splitting=True):
+                   enable_large_batch_splitting=True,
+                   max_batch_tokens=0,
+                   ragged_dimension=1,
+                   length_bucket_boundaries=None):
   """Batches the computation done by the decorated function.
 
   So, for example, in the following code
@@ -78,6 +82,18 @@ def batch_function(num_batch_threads,
      is 32 -> implementation can split input of 128 into 4 x 32, schedule
      concurrent processing, and then return concatenated results corresponding
      to 128.
+    max_batch_tokens: If positive, enables token budget batching: inputs are
+     ragged along `ragged_dimension`, batches are formed so that the sum of the
+     input lengths stays within this budget, and the decorated function
+     is called with the rows of each batched input packed along its first
+     dimension and an extra int64 row splits tensor describing them as its
+     last argument.
+     Defaults to 0 (disabled).
+    ragged_dimension: The dimension of the inputs whose length counts towards
+     `max_batch_tokens`. Defaults to 1.
+    length_bucket_boundaries: Optional increasing list of lengths. If set,
+     inputs are only batched with other inputs that fall into the same length
+     bucket.
 
   Returns:
     The decorated function will return the unbatched computation output Tensors.
@@ -91,11 +107,27 @@ def batch_function(num_batch_threads,
       def computation(*computation_args):
         return fn(*computation_args)
 
-      computation = computation.get_concrete_function(*[
-          tensor.TensorSpec(
-              dtype=x.dtype, shape=x.shape, name="batch_" + str(i))
-          for i, x in enumerate(args)
-      ])
+      if max_batch_tokens > 0:
+        # The rows of the batched inputs are packed along their first
+        # dimension, and their row splits are passed after them.
+        specs = []
+        for i, x in enumerate(args):
+          shape = x.shape
+          if shape.rank is not None and shape.rank > ragged_dimension:
+            shape = [None] + shape[ragged_dimension + 1:].as_list()
+          specs.append(
+              tensor.TensorSpec(dtype=x.dtype, shape=shape,
+                                name="batch_" + str(i)))
+        specs.append(
+            tensor.TensorSpec(dtype=dtypes.int64, shape=[None],
+                              name="row_splits"))
+      else:
+        specs = [
+            tensor.TensorSpec(
+                dtype=x.dtype, shape=x.shape, name="batch_" + str(i))
+            for i, x in enumerate(args)
+        ]
+      computation = computation.get_concrete_function(*specs)
 
       with ops.name_scope("batch") as name:
         for a in args:
@@ -111,6 +143,9 @@ def batch_function(num_batch_threads,
             max_enqueued_batches=max_enqueued_batches,
             shared_name=name,
             enable_large_batch_splitting=enable_large_batch_splitting,
+            max_batch_tokens=max_batch_tokens,
+            ragged_dimension=ragged_dimension,
+            length_bucket_boundaries=length_bucket_boundaries,
             f=computation,
             in_tensors=list(args),
             captured_tensors=computation.captured_inputs,
@@ -2107,6 +2107,102 @@ class MutableHashTable(LookupInterface):
                                                        restored_tensors[1])
 
 
+@tf_export("lookup.experimental.MutableShardedHashTable")
+@saveable_compat.legacy_saveable_name("table")
+class MutableShardedHashTable(MutableHashTable):
+  """A mutable hash table that is split into independently locked shards.
+
+  It is used like `MutableHashTable`, but the keys are spread over `num_shards`
+  open-addressing tables that are locked separately. Concurrent lookups and
+  inserts therefore only contend when they touch the same shard, which helps
+  tables that are updated and read by many ops at once. Values must be scalars
+  or vectors.
+
+  The table is checkpointed with the same keys and values tensors as
+  `MutableHashTable`, so a checkpoint of either table can be restored into the
+  other.
+
+  Example usage:
+
+  >>> table = tf.lookup.experimental.MutableShardedHashTable(
+  ...     key_dtype=tf.string, value_dtype=tf.int64, default_value=-1,
+  ...     num_shards=4)
+  >>> table.insert(tf.constant(['a', 'b', 'c']),
+  ...              tf.constant([7, 8, 9], dtype=tf.int64))
+  >>> table.lookup(tf.constant(['a', 'f'])).numpy()
+  array([ 7, -1])
+  """
+
+  def __init__(self,
+               key_dtype,
+               value_dtype,
+               default_value,
+               num_shards=16,
+               name="MutableShardedHashTable",
+               checkpoint=True):
+    """Creates an empty `MutableShardedHashTable` object.
+
+    Args:
+      key_dtype: the type of the key tensors.
+      value_dtype: the type of the value tensors.
+      default_value: The value to use if a key is missing in the table. Must be
+        a scalar or a vector.
+      num_shards: The number of shards, a positive power of 2.
+      name: A name for the operation (optional).
+      checkpoint: if True, the contents of the table are saved to and restored
+        from checkpoints. If `shared_name` is empty for a checkpointed table, it
+        is shared using the table node name.
+
+    Returns:
+      A `MutableShardedHashTable` object.
+
+    Raises:
+      ValueError: If `num_shards` is not a positive power of 2.
+    """
+    if num_shards <= 0 or num_shards & (num_shards - 1):
+      raise ValueError("Argument `num_shards` must be a positive power of 2, "
+                       f"received: {num_shards}")
+    self._num_shards = num_shards
+    super(MutableShardedHashTable, self).__init__(
+        key_dtype, value_dtype, default_value, name=name, checkpoint=checkpoint)
+
+  def _create_resource(self):
+    # The table must be shared if checkpointing is requested for multi-worker
+    # training to work correctly. Use the node name if no shared_name has been
+    # explicitly specified.
+    use_node_name_sharing = self._checkpoint and self._shared_name is None
+    table_ref = gen_lookup_ops.mutable_sharded_hash_table(
+        shared_name=self._shared_name,
+        use_node_name_sharing=use_node_name_sharing,
+        key_dtype=self._key_dtype,
+        value_dtype=self._value_dtype,
+        value_shape=self._default_value.get_shape(),
+        num_shards=self._num_shards,
+        name=self._name)
+
+    if context.executing_eagerly():
+      self._table_name = None
+    else:
+      self._table_name = table_ref.op.name.split("/")[-1]
+    return table_ref
+
+  def _copy_trackable_to_cpu(self, object_map):
+    """Implements checkpointing protocols for `Trackable`."""
+    if self not in object_map:
+      # If self is not already populated in object map, instantiate the copy
+      object_map[self] = MutableShardedHashTable(
+          self._key_dtype,
+          self._value_dtype,
+          self._default_value,
+          self._num_shards,
+          self._name,
+          self._checkpoint)
+
+    # Copy values from `self` to copy of `self`
+    serialized = self._serialize_to_tensors()
+    object_map[self]._restore_from_tensors(serialized)  # pylint: disable=protected-access
+
+
 @tf_export("lookup.experimental.DenseHashTable")
 @saveable_compat.legacy_saveable_name("table")
 class DenseHashTable(LookupInterface):
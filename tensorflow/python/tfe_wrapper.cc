@@ -1120,6 +1120,14 @@ PYBIND11_MODULE(_pywrap_tfe, m) {
     TFE_ContextSetJitCompileRewrite(tensorflow::InputTFE_Context(ctx), enable,
                                     status.get());
   });
+  m.def("TFE_ContextSetLazyExecution",
+        [](py::handle& ctx, bool enable, int max_pending_ops) {
+          tensorflow::Safe_TF_StatusPtr status =
+              tensorflow::make_safe(TF_NewStatus());
+          TFE_ContextSetLazyExecution(tensorflow::InputTFE_Context(ctx), enable,
+                                      max_pending_ops, status.get());
+          tensorflow::MaybeRaiseRegisteredFromTFStatus(status.get());
+        });
   m.def("TFE_GetTaskStates", [](py::handle& ctx,
                                 const std::vector<std::string>& job_names,
                                 const std::vector<int>& task_nums) {
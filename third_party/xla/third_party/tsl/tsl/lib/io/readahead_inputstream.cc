@@ -0,0 +1,214 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tsl/lib/io/readahead_inputstream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "tsl/platform/errors.h"
+
+namespace tsl {
+namespace io {
+
+ReadaheadInputStream::ReadaheadInputStream(RandomAccessFile* file,
+                                           int64_t chunk_bytes, int depth,
+                                           Env* env)
+    : file_(file),
+      chunk_bytes_(std::max<int64_t>(chunk_bytes, 1)),
+      depth_(std::max(depth, 1)),
+      pool_(std::make_unique<thread::ThreadPool>(env, "readahead_inputstream",
+                                                 depth_)) {}
+
+ReadaheadInputStream::~ReadaheadInputStream() {
+  {
+    mutex_lock l(mu_);
+    ++generation_;
+    chunks_.clear();
+  }
+  // Joins the threads once the reads that already started have finished.
+  pool_.reset();
+}
+
+void ReadaheadInputStream::Restart(uint64 position) {
+  mutex_lock l(mu_);
+  ++generation_;
+  chunks_.clear();
+  next_offset_ = position;
+  eof_seen_ = false;
+  position_ = position;
+  front_pos_ = 0;
+}
+
+void ReadaheadInputStream::FillPipeline() {
+  while (!eof_seen_ && chunks_.size() < static_cast<size_t>(depth_)) {
+    auto chunk = std::make_shared<Chunk>();
+    chunk->offset = next_offset_;
+    next_offset_ += chunk_bytes_;
+    chunks_.push_back(chunk);
+    pool_->Schedule([this, chunk, generation = generation_]() {
+      ReadChunk(std::move(chunk), generation);
+    });
+  }
+}
+
+void ReadaheadInputStream::ReadChunk(std::shared_ptr<Chunk> chunk,
+                                     int64_t generation) {
+  {
+    mutex_lock l(mu_);
+    if (generation != generation_) return;
+  }
+  tstring buffer;
+  buffer.resize_uninitialized(chunk_bytes_);
+  StringPiece result;
+  absl::Status s =
+      file_->Read(chunk->offset, chunk_bytes_, &result, buffer.mdata());
+  // Some filesystems return a pointer into their own memory.
+  if (result.data() != buffer.data()) {
+    memmove(buffer.mdata(), result.data(), result.size());
+  }
+  buffer.resize(result.size());
+  // A short read marks the end of the file, which the consumer detects from
+  // the chunk size.
+  if (errors::IsOutOfRange(s)) s = absl::OkStatus();
+
+  mutex_lock l(mu_);
+  if (s.ok() && result.size() < static_cast<size_t>(chunk_bytes_) &&
+      generation == generation_) {
+    eof_seen_ = true;
+  }
+  chunk->data = std::move(buffer);
+  chunk->status = std::move(s);
+  chunk->done = true;
+  cv_.notify_all();
+}
+
+absl::Status ReadaheadInputStream::FrontChunk(std::shared_ptr<Chunk>* chunk) {
+  mutex_lock l(mu_);
+  while (true) {
+    if (chunks_.empty()) {
+      FillPipeline();
+      if (chunks_.empty()) {
+        *chunk = nullptr;
+        return absl::OkStatus();
+      }
+    }
+    std::shared_ptr<Chunk> front = chunks_.front();
+    while (!front->done) {
+      cv_.wait(l);
+    }
+    TF_RETURN_IF_ERROR(front->status);
+    if (front_pos_ < front->data.size()) {
+      *chunk = std::move(front);
+      return absl::OkStatus();
+    }
+    if (front->data.size() < static_cast<size_t>(chunk_bytes_)) {
+      // Consumed the last, partial chunk of the file.
+      *chunk = nullptr;
+      return absl::OkStatus();
+    }
+    // The front chunk is consumed. It is only released here, on the call
+    // after the one that consumed it, so that views into it stay valid.
+    chunks_.pop_front();
+    front_pos_ = 0;
+    FillPipeline();
+  }
+}
+
+absl::Status ReadaheadInputStream::ReadNBytes(int64_t bytes_to_read,
+                                              tstring* result) {
+  if (bytes_to_read < 0) {
+    return errors::InvalidArgument("Can't read a negative number of bytes: ",
+                                   bytes_to_read);
+  }
+  result->clear();
+  result->reserve(bytes_to_read);
+  while (result->size() < static_cast<size_t>(bytes_to_read)) {
+    std::shared_ptr<Chunk> chunk;
+    TF_RETURN_IF_ERROR(FrontChunk(&chunk));
+    if (chunk == nullptr) {
+      return errors::OutOfRange("reached end of file");
+    }
+    const size_t n = std::min<size_t>(bytes_to_read - result->size(),
+                                      chunk->data.size() - front_pos_);
+    result->append(chunk->data.data() + front_pos_, n);
+    front_pos_ += n;
+    position_ += n;
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ReadaheadInputStream::ReadNBytesView(int64_t bytes_to_read,
+                                                  StringPiece* result,
+                                                  tstring* scratch) {
+  if (bytes_to_read > 0) {
+    std::shared_ptr<Chunk> chunk;
+    TF_RETURN_IF_ERROR(FrontChunk(&chunk));
+    if (chunk != nullptr && chunk->data.size() - front_pos_ >=
+                                static_cast<size_t>(bytes_to_read)) {
+      *result = StringPiece(chunk->data.data() + front_pos_, bytes_to_read);
+      front_pos_ += bytes_to_read;
+      position_ += bytes_to_read;
+      return absl::OkStatus();
+    }
+  }
+  absl::Status s = ReadNBytes(bytes_to_read, scratch);
+  *result = *scratch;
+  return s;
+}
+
+absl::Status ReadaheadInputStream::SkipNBytes(int64_t bytes_to_skip) {
+  if (bytes_to_skip < 0) {
+    return errors::InvalidArgument("Can't skip a negative number of bytes: ",
+                                   bytes_to_skip);
+  }
+  if (bytes_to_skip == 0) return absl::OkStatus();
+  const uint64 target = position_ + bytes_to_skip;
+  bool within_requested;
+  {
+    mutex_lock l(mu_);
+    within_requested = target < next_offset_;
+  }
+  if (within_requested) {
+    while (position_ < target) {
+      std::shared_ptr<Chunk> chunk;
+      TF_RETURN_IF_ERROR(FrontChunk(&chunk));
+      if (chunk == nullptr) {
+        return errors::OutOfRange("reached end of file");
+      }
+      const size_t n = std::min<size_t>(target - position_,
+                                        chunk->data.size() - front_pos_);
+      front_pos_ += n;
+      position_ += n;
+    }
+    return absl::OkStatus();
+  }
+  // Restarts one byte early and reads it, which reports OUT_OF_RANGE if the
+  // target lies past the end of the file.
+  Restart(target - 1);
+  tstring last_byte;
+  return ReadNBytes(1, &last_byte);
+}
+
+int64_t ReadaheadInputStream::Tell() const { return position_; }
+
+absl::Status ReadaheadInputStream::Reset() {
+  Restart(0);
+  return absl::OkStatus();
+}
+
+}  // namespace io
+}  // namespace tsl
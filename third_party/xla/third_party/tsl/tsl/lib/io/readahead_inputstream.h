@@ -0,0 +1,118 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TSL_LIB_IO_READAHEAD_INPUTSTREAM_H_
+#define TENSORFLOW_TSL_LIB_IO_READAHEAD_INPUTSTREAM_H_
+
+#include <deque>
+#include <memory>
+
+#include "tsl/lib/io/inputstream_interface.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/file_system.h"
+#include "tsl/platform/mutex.h"
+#include "tsl/platform/stringpiece.h"
+#include "tsl/platform/thread_annotations.h"
+#include "tsl/platform/threadpool.h"
+
+namespace tsl {
+namespace io {
+
+// Reads a RandomAccessFile sequentially while keeping up to `depth` reads of
+// `chunk_bytes` each in flight on background threads. Intended for
+// filesystems where each read pays a large round trip, so that the consumer
+// finds the next chunk already in memory.
+//
+// Skipping within the chunks already requested reuses them; skipping further
+// ahead or backwards drops the pipeline and restarts it at the new position.
+//
+// A given instance of ReadaheadInputStream is NOT safe for concurrent use by
+// multiple threads.
+class ReadaheadInputStream : public InputStreamInterface {
+ public:
+  // Does not take ownership of `file`, which must outlive *this.
+  ReadaheadInputStream(RandomAccessFile* file, int64_t chunk_bytes, int depth,
+                       Env* env = Env::Default());
+
+  // Waits for reads that are already running; queued ones are dropped.
+  ~ReadaheadInputStream() override;
+
+  absl::Status ReadNBytes(int64_t bytes_to_read, tstring* result) override;
+
+  // Like ReadNBytes, but when the requested bytes lie within a single landed
+  // chunk, points `*result` at them instead of copying. Otherwise the bytes
+  // are copied into `*scratch` and `*result` points there. Either way
+  // `*result` stays valid until the next call on this stream.
+  absl::Status ReadNBytesView(int64_t bytes_to_read, StringPiece* result,
+                              tstring* scratch);
+
+  absl::Status SkipNBytes(int64_t bytes_to_skip) override;
+
+  int64_t Tell() const override;
+
+  absl::Status Reset() override;
+
+ private:
+  struct Chunk {
+    uint64 offset = 0;
+    tstring data;
+    absl::Status status;
+    bool done = false;
+  };
+
+  // Drops all chunks and starts reading again at `position`.
+  void Restart(uint64 position);
+
+  // Schedules reads until `depth_` chunks are queued or the end of the file
+  // has been seen.
+  void FillPipeline() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Executed on the pool: reads `chunk` from the file unless it was dropped
+  // by a Restart() since `generation`.
+  void ReadChunk(std::shared_ptr<Chunk> chunk, int64_t generation);
+
+  // Makes the front chunk contain the current position, waiting for it to
+  // land if needed. Sets `*chunk` to nullptr at end of file.
+  absl::Status FrontChunk(std::shared_ptr<Chunk>* chunk);
+
+  RandomAccessFile* const file_;  // Not owned.
+  const int64_t chunk_bytes_;
+  const int depth_;
+
+  // Current position in the file and within the front chunk.
+  uint64 position_ = 0;
+  size_t front_pos_ = 0;
+
+  mutex mu_;
+  condition_variable cv_;
+  std::deque<std::shared_ptr<Chunk>> chunks_ TF_GUARDED_BY(mu_);
+  // Offset of the next chunk to schedule.
+  uint64 next_offset_ TF_GUARDED_BY(mu_) = 0;
+  // Set once a short read has shown where the file ends.
+  bool eof_seen_ TF_GUARDED_BY(mu_) = false;
+  // Incremented by Restart() so that dropped chunks are not read.
+  int64_t generation_ TF_GUARDED_BY(mu_) = 0;
+
+  // Destroyed first so that no read touches the members above afterwards.
+  std::unique_ptr<thread::ThreadPool> pool_;
+
+  ReadaheadInputStream(const ReadaheadInputStream&) = delete;
+  void operator=(const ReadaheadInputStream&) = delete;
+};
+
+}  // namespace io
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_LIB_IO_READAHEAD_INPUTSTREAM_H_
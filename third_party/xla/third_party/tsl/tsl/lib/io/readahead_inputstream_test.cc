@@ -0,0 +1,221 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tsl/lib/io/readahead_inputstream.h"
+
+#include <memory>
+#include <string>
+
+#include "tsl/lib/core/status_test_util.h"
+#include "tsl/lib/io/buffered_inputstream.h"
+#include "tsl/lib/io/random_inputstream.h"
+#include "tsl/lib/io/record_reader.h"
+#include "tsl/lib/io/record_writer.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/errors.h"
+#include "tsl/platform/strcat.h"
+#include "tsl/platform/test.h"
+#include "tsl/platform/test_benchmark.h"
+
+namespace tsl {
+namespace io {
+namespace {
+
+// Sleeps for a fixed time on every Read to mimic a remote filesystem.
+class SlowRandomAccessFile : public RandomAccessFile {
+ public:
+  SlowRandomAccessFile(RandomAccessFile* file, int64_t latency_micros)
+      : file_(file), latency_micros_(latency_micros) {}
+
+  absl::Status Read(uint64 offset, size_t n, StringPiece* result,
+                    char* scratch) const override {
+    Env::Default()->SleepForMicroseconds(latency_micros_);
+    return file_->Read(offset, n, result, scratch);
+  }
+
+ private:
+  RandomAccessFile* const file_;
+  const int64_t latency_micros_;
+};
+
+string TestContents() {
+  string contents;
+  for (int i = 0; i < 1000; ++i) {
+    strings::StrAppend(&contents, i, ",");
+  }
+  return contents;
+}
+
+std::unique_ptr<RandomAccessFile> WriteTestFile(const string& contents) {
+  Env* env = Env::Default();
+  string fname;
+  CHECK(env->LocalTempFilename(&fname));
+  TF_CHECK_OK(WriteStringToFile(env, fname, contents));
+  std::unique_ptr<RandomAccessFile> file;
+  TF_CHECK_OK(env->NewRandomAccessFile(fname, &file));
+  return file;
+}
+
+TEST(ReadaheadInputStream, ReadAll) {
+  const string contents = TestContents();
+  std::unique_ptr<RandomAccessFile> file = WriteTestFile(contents);
+  for (int64_t chunk_bytes : {1, 7, 64, 1 << 20}) {
+    for (int depth : {1, 2, 5}) {
+      ReadaheadInputStream in(file.get(), chunk_bytes, depth);
+      string read;
+      tstring piece;
+      const int64_t size = contents.size();
+      for (int64_t n = 1; in.Tell() < size; n = n % 13 + 1) {
+        absl::Status s = in.ReadNBytes(n, &piece);
+        if (!s.ok()) {
+          EXPECT_TRUE(errors::IsOutOfRange(s));
+        }
+        read.append(piece.data(), piece.size());
+      }
+      EXPECT_EQ(contents, read) << chunk_bytes << " " << depth;
+      EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(1, &piece)));
+      EXPECT_EQ(0, piece.size());
+    }
+  }
+}
+
+TEST(ReadaheadInputStream, ReadNBytesView) {
+  const string contents = TestContents();
+  std::unique_ptr<RandomAccessFile> file = WriteTestFile(contents);
+  ReadaheadInputStream in(file.get(), 16, 3);
+  StringPiece view;
+  tstring scratch;
+  // Within the first chunk: points into the chunk, scratch is left alone.
+  TF_ASSERT_OK(in.ReadNBytesView(10, &view, &scratch));
+  EXPECT_EQ(contents.substr(0, 10), view);
+  EXPECT_TRUE(scratch.empty());
+  // Straddles two chunks: copied into scratch.
+  TF_ASSERT_OK(in.ReadNBytesView(10, &view, &scratch));
+  EXPECT_EQ(contents.substr(10, 10), view);
+  EXPECT_EQ(scratch.data(), view.data());
+  EXPECT_EQ(20, in.Tell());
+}
+
+TEST(ReadaheadInputStream, SkipNBytes) {
+  const string contents = TestContents();
+  std::unique_ptr<RandomAccessFile> file = WriteTestFile(contents);
+  ReadaheadInputStream in(file.get(), 8, 2);
+  tstring read;
+  // Within the requested window.
+  TF_ASSERT_OK(in.SkipNBytes(5));
+  TF_ASSERT_OK(in.ReadNBytes(3, &read));
+  EXPECT_EQ(contents.substr(5, 3), read);
+  // Far beyond it, which restarts the pipeline.
+  TF_ASSERT_OK(in.SkipNBytes(1000));
+  EXPECT_EQ(1008, in.Tell());
+  TF_ASSERT_OK(in.ReadNBytes(4, &read));
+  EXPECT_EQ(contents.substr(1008, 4), read);
+  // Past the end of the file.
+  EXPECT_TRUE(errors::IsOutOfRange(in.SkipNBytes(contents.size())));
+}
+
+TEST(ReadaheadInputStream, Reset) {
+  const string contents = TestContents();
+  std::unique_ptr<RandomAccessFile> file = WriteTestFile(contents);
+  ReadaheadInputStream in(file.get(), 32, 4);
+  tstring read;
+  TF_ASSERT_OK(in.ReadNBytes(100, &read));
+  TF_ASSERT_OK(in.Reset());
+  EXPECT_EQ(0, in.Tell());
+  TF_ASSERT_OK(in.ReadNBytes(100, &read));
+  EXPECT_EQ(contents.substr(0, 100), read);
+}
+
+TEST(ReadaheadInputStream, EmptyFile) {
+  std::unique_ptr<RandomAccessFile> file = WriteTestFile("");
+  ReadaheadInputStream in(file.get(), 32, 4);
+  tstring read;
+  EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(1, &read)));
+  TF_EXPECT_OK(in.ReadNBytes(0, &read));
+}
+
+TEST(ReadaheadInputStream, RecordReaderRoundTrip) {
+  for (const char* compression : {"", "ZLIB"}) {
+    Env* env = Env::Default();
+    string fname;
+    ASSERT_TRUE(env->LocalTempFilename(&fname));
+    {
+      std::unique_ptr<WritableFile> file;
+      TF_ASSERT_OK(env->NewWritableFile(fname, &file));
+      RecordWriter writer(
+          file.get(),
+          RecordWriterOptions::CreateRecordWriterOptions(compression));
+      for (int i = 0; i < 100; ++i) {
+        TF_ASSERT_OK(writer.WriteRecord(string(i, 'a' + i % 26)));
+      }
+      TF_ASSERT_OK(writer.Close());
+    }
+    std::unique_ptr<RandomAccessFile> file;
+    TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file));
+    RecordReaderOptions options =
+        RecordReaderOptions::CreateRecordReaderOptions(compression);
+    options.readahead_depth = 3;
+    options.readahead_chunk_size = 64;
+    RecordReader reader(file.get(), options);
+    uint64 offset = 0;
+    StringPiece view;
+    tstring record;
+    for (int i = 0; i < 100; ++i) {
+      if (i % 2 == 0) {
+        TF_ASSERT_OK(reader.ReadRecord(&offset, &view));
+        EXPECT_EQ(string(i, 'a' + i % 26), view);
+      } else {
+        TF_ASSERT_OK(reader.ReadRecord(&offset, &record));
+        EXPECT_EQ(string(i, 'a' + i % 26), record);
+      }
+    }
+    EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecord(&offset, &view)));
+  }
+}
+
+// Reads 4MB through a file that sleeps 1ms per read. Arguments are the read
+// size and the readahead depth; depth 0 uses a BufferedInputStream with the
+// same read size instead.
+void BM_ReadaheadSlowFile(::testing::benchmark::State& state) {
+  const int64_t chunk_bytes = state.range(0);
+  const int depth = state.range(1);
+  const string contents(4 << 20, 'x');
+  std::unique_ptr<RandomAccessFile> file = WriteTestFile(contents);
+  SlowRandomAccessFile slow_file(file.get(), /*latency_micros=*/1000);
+  tstring read;
+  for (auto s : state) {
+    std::unique_ptr<InputStreamInterface> in;
+    std::unique_ptr<RandomAccessInputStream> base;
+    if (depth == 0) {
+      base = std::make_unique<RandomAccessInputStream>(&slow_file);
+      in = std::make_unique<BufferedInputStream>(base.get(), chunk_bytes);
+    } else {
+      in = std::make_unique<ReadaheadInputStream>(&slow_file, chunk_bytes,
+                                                  depth);
+    }
+    while (in->ReadNBytes(1 << 16, &read).ok()) {
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * contents.size());
+}
+BENCHMARK(BM_ReadaheadSlowFile)
+    ->ArgPair(256 << 10, 0)
+    ->ArgPair(256 << 10, 1)
+    ->ArgPair(256 << 10, 4)
+    ->ArgPair(256 << 10, 16);
+
+}  // namespace
+}  // namespace io
+}  // namespace tsl
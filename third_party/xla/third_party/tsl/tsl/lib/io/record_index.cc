@@ -0,0 +1,185 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tsl/lib/io/record_index.h"
+
+#include <cstring>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "tsl/lib/hash/crc32c.h"
+#include "tsl/platform/coding.h"
+#include "tsl/platform/errors.h"
+#include "tsl/platform/raw_coding.h"
+
+namespace tsl {
+namespace io {
+namespace {
+
+constexpr uint64 kIndexMagic = 0x3130584449524654ull;  // "TFRIDX01"
+constexpr size_t kIndexHeaderSize = sizeof(uint64);
+constexpr size_t kIndexFooterSize = 2 * sizeof(uint64);
+constexpr size_t kEntrySize = sizeof(uint64);
+
+// Framing of a single record, see RecordWriter.
+constexpr size_t kHeaderSize = sizeof(uint64) + sizeof(uint32);
+constexpr size_t kFooterSize = sizeof(uint32);
+
+absl::Status AppendFixed64(WritableFile* dest, uint64 value) {
+  char buf[sizeof(uint64)];
+  core::EncodeFixed64(buf, value);
+  return dest->Append(StringPiece(buf, sizeof(buf)));
+}
+
+absl::Status ReadExactly(RandomAccessFile* file, uint64 offset, size_t n,
+                         char* scratch, StringPiece* result) {
+  absl::Status s = file->Read(offset, n, result, scratch);
+  if (errors::IsOutOfRange(s) && result->size() < n) {
+    return errors::DataLoss("truncated read of ", n, " bytes at ", offset);
+  }
+  TF_RETURN_IF_ERROR(s);
+  if (result->size() != n) {
+    return errors::DataLoss("truncated read of ", n, " bytes at ", offset);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+std::string RecordIndexFilename(StringPiece filename) {
+  return absl::StrCat(filename, ".idx");
+}
+
+RecordIndexWriter::RecordIndexWriter(WritableFile* dest) : dest_(dest) {}
+
+absl::Status RecordIndexWriter::MaybeWriteHeader() {
+  if (finished_) {
+    return errors::FailedPrecondition("Record index already finished");
+  }
+  if (!header_written_) {
+    TF_RETURN_IF_ERROR(AppendFixed64(dest_, kIndexMagic));
+    header_written_ = true;
+  }
+  return absl::OkStatus();
+}
+
+absl::Status RecordIndexWriter::Add(uint64 offset) {
+  TF_RETURN_IF_ERROR(MaybeWriteHeader());
+  TF_RETURN_IF_ERROR(AppendFixed64(dest_, offset));
+  ++num_records_;
+  return absl::OkStatus();
+}
+
+absl::Status RecordIndexWriter::Finish(uint64 end_offset) {
+  TF_RETURN_IF_ERROR(MaybeWriteHeader());
+  finished_ = true;
+  char footer[kEntrySize + kIndexFooterSize];
+  core::EncodeFixed64(footer, end_offset);
+  core::EncodeFixed64(footer + kEntrySize, num_records_);
+  core::EncodeFixed64(footer + kEntrySize + sizeof(uint64), kIndexMagic);
+  return dest_->Append(StringPiece(footer, sizeof(footer)));
+}
+
+absl::Status RecordIndex::Open(RandomAccessFile* file, uint64 file_size,
+                               std::unique_ptr<RecordIndex>* index) {
+  if (file_size < kIndexHeaderSize + kEntrySize + kIndexFooterSize) {
+    return errors::DataLoss("record index too short: ", file_size, " bytes");
+  }
+  char scratch[kIndexFooterSize];
+  StringPiece data;
+  TF_RETURN_IF_ERROR(
+      ReadExactly(file, 0, kIndexHeaderSize, scratch, &data));
+  if (core::DecodeFixed64(data.data()) != kIndexMagic) {
+    return errors::DataLoss("not a record index: bad header magic");
+  }
+  TF_RETURN_IF_ERROR(ReadExactly(file, file_size - kIndexFooterSize,
+                                 kIndexFooterSize, scratch, &data));
+  const uint64 num_records = core::DecodeFixed64(data.data());
+  if (core::DecodeFixed64(data.data() + sizeof(uint64)) != kIndexMagic) {
+    return errors::DataLoss("not a record index: bad footer magic");
+  }
+  const uint64 entries_size =
+      file_size - kIndexHeaderSize - kIndexFooterSize;
+  if (entries_size % kEntrySize != 0 ||
+      entries_size / kEntrySize != num_records + 1) {
+    return errors::DataLoss("record index of ", file_size,
+                            " bytes does not hold ", num_records,
+                            " records");
+  }
+  index->reset(new RecordIndex(file, num_records));
+  return absl::OkStatus();
+}
+
+absl::Status RecordIndex::Lookup(uint64 record_number, uint64* start,
+                                 uint64* limit) const {
+  if (record_number >= num_records_) {
+    return errors::OutOfRange("record ", record_number, " is out of range [0, ",
+                              num_records_, ")");
+  }
+  char scratch[2 * kEntrySize];
+  StringPiece data;
+  TF_RETURN_IF_ERROR(ReadExactly(file_,
+                                 kIndexHeaderSize + record_number * kEntrySize,
+                                 sizeof(scratch), scratch, &data));
+  *start = core::DecodeFixed64(data.data());
+  *limit = core::DecodeFixed64(data.data() + kEntrySize);
+  if (*limit < *start + kHeaderSize + kFooterSize) {
+    return errors::DataLoss("corrupted record index entry ", record_number,
+                            ": [", *start, ", ", *limit, ")");
+  }
+  return absl::OkStatus();
+}
+
+IndexedRecordReader::IndexedRecordReader(RandomAccessFile* file,
+                                         std::unique_ptr<RecordIndex> index)
+    : file_(file), index_(std::move(index)) {}
+
+absl::Status IndexedRecordReader::ReadRecord(uint64 record_number,
+                                             tstring* record) const {
+  uint64 start, limit;
+  TF_RETURN_IF_ERROR(index_->Lookup(record_number, &start, &limit));
+  const size_t length = limit - start - kHeaderSize - kFooterSize;
+
+  // Reads header, data and footer at once and then moves the data to the
+  // front of the buffer.
+  record->resize_uninitialized(limit - start);
+  StringPiece data;
+  TF_RETURN_IF_ERROR(
+      ReadExactly(file_, start, limit - start, record->mdata(), &data));
+  if (data.data() != record->data()) {
+    memmove(record->mdata(), data.data(), data.size());
+  }
+  const char* header = record->data();
+  if (crc32c::Unmask(core::DecodeFixed32(header + sizeof(uint64))) !=
+      crc32c::Value(header, sizeof(uint64))) {
+    return errors::DataLoss("corrupted record header at ", start);
+  }
+  if (core::DecodeFixed64(header) != length) {
+    return errors::DataLoss("record at ", start, " has length ",
+                            core::DecodeFixed64(header), " but its index ",
+                            "entry implies ", length);
+  }
+  const char* payload = header + kHeaderSize;
+  if (crc32c::Unmask(core::DecodeFixed32(payload + length)) !=
+      crc32c::Value(payload, length)) {
+    return errors::DataLoss("corrupted record at ", start);
+  }
+  memmove(record->mdata(), payload, length);
+  record->resize(length);
+  return absl::OkStatus();
+}
+
+}  // namespace io
+}  // namespace tsl
@@ -0,0 +1,138 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TSL_LIB_IO_RECORD_INDEX_H_
+#define TENSORFLOW_TSL_LIB_IO_RECORD_INDEX_H_
+
+#include <memory>
+#include <string>
+
+#include "tsl/platform/file_system.h"
+#include "tsl/platform/status.h"
+#include "tsl/platform/stringpiece.h"
+#include "tsl/platform/types.h"
+
+namespace tsl {
+namespace io {
+
+// A record index maps the number of a record in a TFRecord file to its byte
+// offset, so that a record can be read without walking the headers of all
+// the records before it. It is stored next to the data file, in the file
+// named by RecordIndexFilename().
+//
+// Format:
+//  fixed64   magic
+//  fixed64   offset[0] ... offset[n]
+//  fixed64   n
+//  fixed64   magic
+//
+// offset[i] is the position of the header of record i in the uncompressed
+// record stream and offset[n] is the end of the last record, so record i
+// spans [offset[i], offset[i + 1]). Entries have a fixed width, so a lookup
+// is a single read at a computed position.
+
+// Returns the name of the index file of the TFRecord file `filename`.
+std::string RecordIndexFilename(StringPiece filename);
+
+// Streams the entries of a record index to a WritableFile.
+//
+// Note: this class is not thread safe; external synchronization required.
+class RecordIndexWriter {
+ public:
+  // Does not take ownership of "*dest", which must be initially empty and
+  // remain live while this writer is in use.
+  explicit RecordIndexWriter(WritableFile* dest);
+
+  // Records that the next record starts at `offset`.
+  absl::Status Add(uint64 offset);
+
+  // Writes the end of the last record and the footer. Does *not* close the
+  // WritableFile. No further calls are allowed afterwards.
+  absl::Status Finish(uint64 end_offset);
+
+  uint64 num_records() const { return num_records_; }
+  bool finished() const { return finished_; }
+
+ private:
+  absl::Status MaybeWriteHeader();
+
+  WritableFile* const dest_;  // Not owned.
+  uint64 num_records_ = 0;
+  bool header_written_ = false;
+  bool finished_ = false;
+
+  RecordIndexWriter(const RecordIndexWriter&) = delete;
+  void operator=(const RecordIndexWriter&) = delete;
+};
+
+// Looks up records in a record index. Does not cache entries, so memory use
+// is independent of the number of records.
+//
+// Thread-safe, as long as `file` is.
+class RecordIndex {
+ public:
+  // Validates the index stored in the first `file_size` bytes of `file`. Does
+  // not take ownership of `file`, which must outlive `*index`.
+  static absl::Status Open(RandomAccessFile* file, uint64 file_size,
+                           std::unique_ptr<RecordIndex>* index);
+
+  uint64 num_records() const { return num_records_; }
+
+  // Sets [*start, *limit) to the byte range of record `record_number`,
+  // header and footer included. Returns OUT_OF_RANGE past the last record.
+  absl::Status Lookup(uint64 record_number, uint64* start,
+                      uint64* limit) const;
+
+ private:
+  RecordIndex(RandomAccessFile* file, uint64 num_records)
+      : file_(file), num_records_(num_records) {}
+
+  RandomAccessFile* const file_;  // Not owned.
+  const uint64 num_records_;
+
+  RecordIndex(const RecordIndex&) = delete;
+  void operator=(const RecordIndex&) = delete;
+};
+
+// Reads records of an uncompressed TFRecord file by number, using its index.
+// Each read issues one read of the index and one of the data file, and
+// verifies the record's checksums, which also catches an index that does not
+// match the data file.
+//
+// Thread-safe, as long as `file` and the index file are.
+class IndexedRecordReader {
+ public:
+  // Does not take ownership of `file`, which must outlive *this.
+  IndexedRecordReader(RandomAccessFile* file,
+                      std::unique_ptr<RecordIndex> index);
+
+  uint64 num_records() const { return index_->num_records(); }
+
+  // Reads record number `record_number` into `*record`. Returns OUT_OF_RANGE
+  // past the last record.
+  absl::Status ReadRecord(uint64 record_number, tstring* record) const;
+
+ private:
+  RandomAccessFile* const file_;  // Not owned.
+  const std::unique_ptr<RecordIndex> index_;
+
+  IndexedRecordReader(const IndexedRecordReader&) = delete;
+  void operator=(const IndexedRecordReader&) = delete;
+};
+
+}  // namespace io
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_LIB_IO_RECORD_INDEX_H_
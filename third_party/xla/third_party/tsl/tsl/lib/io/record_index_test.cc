@@ -0,0 +1,208 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tsl/lib/io/record_index.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tsl/lib/core/status_test_util.h"
+#include "tsl/lib/io/record_reader.h"
+#include "tsl/lib/io/record_writer.h"
+#include "tsl/lib/random/simple_philox.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/errors.h"
+#include "tsl/platform/test.h"
+#include "tsl/platform/test_benchmark.h"
+
+namespace tsl {
+namespace io {
+namespace {
+
+string Record(int i) { return string(i % 37, 'a' + i % 26); }
+
+// Writes `num_records` records and their index to a temporary file and
+// returns its name.
+string WriteIndexedFile(int num_records,
+                        const string& compression_type = "") {
+  Env* env = Env::Default();
+  string fname;
+  CHECK(env->LocalTempFilename(&fname));
+  std::unique_ptr<WritableFile> file;
+  TF_CHECK_OK(env->NewWritableFile(fname, &file));
+  std::unique_ptr<WritableFile> index_file;
+  TF_CHECK_OK(env->NewWritableFile(RecordIndexFilename(fname), &index_file));
+  RecordWriter writer(
+      file.get(), index_file.get(),
+      RecordWriterOptions::CreateRecordWriterOptions(compression_type));
+  for (int i = 0; i < num_records; ++i) {
+    TF_CHECK_OK(writer.WriteRecord(Record(i)));
+  }
+  TF_CHECK_OK(writer.Close());
+  TF_CHECK_OK(file->Close());
+  TF_CHECK_OK(index_file->Close());
+  return fname;
+}
+
+struct OpenedIndex {
+  std::unique_ptr<RandomAccessFile> index_file;
+  std::unique_ptr<RecordIndex> index;
+};
+
+absl::Status OpenIndex(const string& index_fname, OpenedIndex* opened) {
+  Env* env = Env::Default();
+  uint64 size;
+  TF_RETURN_IF_ERROR(env->GetFileSize(index_fname, &size));
+  TF_RETURN_IF_ERROR(env->NewRandomAccessFile(index_fname,
+                                              &opened->index_file));
+  return RecordIndex::Open(opened->index_file.get(), size, &opened->index);
+}
+
+TEST(RecordIndexTest, ReadsRecordsInAnyOrder) {
+  const int kNumRecords = 200;
+  const string fname = WriteIndexedFile(kNumRecords);
+  OpenedIndex opened;
+  TF_ASSERT_OK(OpenIndex(RecordIndexFilename(fname), &opened));
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(Env::Default()->NewRandomAccessFile(fname, &file));
+  IndexedRecordReader reader(file.get(), std::move(opened.index));
+  EXPECT_EQ(kNumRecords, reader.num_records());
+
+  tstring record;
+  for (int i = kNumRecords - 1; i >= 0; i -= 3) {
+    TF_ASSERT_OK(reader.ReadRecord(i, &record));
+    EXPECT_EQ(Record(i), record);
+  }
+  for (int i = 0; i < kNumRecords; i += 7) {
+    TF_ASSERT_OK(reader.ReadRecord(i, &record));
+    EXPECT_EQ(Record(i), record);
+  }
+  EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecord(kNumRecords, &record)));
+}
+
+TEST(RecordIndexTest, OffsetsWorkWithCompressedRecordReader) {
+  const int kNumRecords = 50;
+  const string fname = WriteIndexedFile(kNumRecords, "ZLIB");
+  OpenedIndex opened;
+  TF_ASSERT_OK(OpenIndex(RecordIndexFilename(fname), &opened));
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(Env::Default()->NewRandomAccessFile(fname, &file));
+  RecordReader reader(file.get(),
+                      RecordReaderOptions::CreateRecordReaderOptions("ZLIB"));
+  for (int i : {3, 40, 7, 49, 0}) {
+    uint64 start, limit;
+    TF_ASSERT_OK(opened.index->Lookup(i, &start, &limit));
+    tstring record;
+    TF_ASSERT_OK(reader.ReadRecord(&start, &record));
+    EXPECT_EQ(Record(i), record);
+    EXPECT_EQ(limit, start);
+  }
+}
+
+TEST(RecordIndexTest, EmptyFile) {
+  const string fname = WriteIndexedFile(0);
+  OpenedIndex opened;
+  TF_ASSERT_OK(OpenIndex(RecordIndexFilename(fname), &opened));
+  EXPECT_EQ(0, opened.index->num_records());
+  uint64 start, limit;
+  EXPECT_TRUE(errors::IsOutOfRange(opened.index->Lookup(0, &start, &limit)));
+}
+
+TEST(RecordIndexTest, RejectsIndexOfAnotherFile) {
+  const string fname = WriteIndexedFile(20);
+  const string other_fname = WriteIndexedFile(40);
+  // Pair the data file with an index of a file with different records.
+  OpenedIndex opened;
+  TF_ASSERT_OK(OpenIndex(RecordIndexFilename(other_fname), &opened));
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(Env::Default()->NewRandomAccessFile(fname, &file));
+  IndexedRecordReader reader(file.get(), std::move(opened.index));
+  tstring record;
+  EXPECT_TRUE(errors::IsDataLoss(reader.ReadRecord(30, &record)));
+}
+
+TEST(RecordIndexTest, RejectsCorruptedIndex) {
+  Env* env = Env::Default();
+  const string fname = WriteIndexedFile(10);
+  string contents;
+  TF_ASSERT_OK(ReadFileToString(env, RecordIndexFilename(fname), &contents));
+
+  string corrupted_fname;
+  ASSERT_TRUE(env->LocalTempFilename(&corrupted_fname));
+  OpenedIndex opened;
+  // Truncated.
+  TF_ASSERT_OK(WriteStringToFile(env, corrupted_fname,
+                                 contents.substr(0, contents.size() - 8)));
+  EXPECT_TRUE(errors::IsDataLoss(OpenIndex(corrupted_fname, &opened)));
+  // Bad magic.
+  string bad_magic = contents;
+  bad_magic[0] ^= 1;
+  TF_ASSERT_OK(WriteStringToFile(env, corrupted_fname, bad_magic));
+  EXPECT_TRUE(errors::IsDataLoss(OpenIndex(corrupted_fname, &opened)));
+  // Not an index at all.
+  EXPECT_TRUE(errors::IsDataLoss(OpenIndex(fname, &opened)));
+}
+
+TEST(RecordIndexTest, WriteAfterCloseFails) {
+  Env* env = Env::Default();
+  string fname;
+  ASSERT_TRUE(env->LocalTempFilename(&fname));
+  std::unique_ptr<WritableFile> file;
+  TF_ASSERT_OK(env->NewWritableFile(fname, &file));
+  std::unique_ptr<WritableFile> index_file;
+  TF_ASSERT_OK(env->NewWritableFile(RecordIndexFilename(fname), &index_file));
+  RecordWriter writer(file.get(), index_file.get());
+  TF_ASSERT_OK(writer.WriteRecord("abc"));
+  TF_ASSERT_OK(writer.Close());
+  // A second Close() is fine; writing past the finished index is not.
+  TF_ASSERT_OK(writer.Close());
+  EXPECT_TRUE(errors::IsFailedPrecondition(writer.WriteRecord("def")));
+}
+
+// Reads random records of a 100k record file, either by skipping from the
+// start of the file with RecordReader::SkipRecords (arg 0) or through the
+// index (arg 1).
+void BM_RandomRecordAccess(::testing::benchmark::State& state) {
+  const bool use_index = state.range(0);
+  const int kNumRecords = 100000;
+  static const string* fname = new string(WriteIndexedFile(kNumRecords));
+  Env* env = Env::Default();
+  std::unique_ptr<RandomAccessFile> file;
+  TF_CHECK_OK(env->NewRandomAccessFile(*fname, &file));
+  OpenedIndex opened;
+  TF_CHECK_OK(OpenIndex(RecordIndexFilename(*fname), &opened));
+  IndexedRecordReader indexed_reader(file.get(), std::move(opened.index));
+  RecordReader reader(file.get());
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  tstring record;
+  for (auto s : state) {
+    const int i = rnd.Uniform(kNumRecords);
+    if (use_index) {
+      TF_CHECK_OK(indexed_reader.ReadRecord(i, &record));
+    } else {
+      uint64 offset = 0;
+      int num_skipped;
+      TF_CHECK_OK(reader.SkipRecords(&offset, i, &num_skipped));
+      TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    }
+  }
+}
+BENCHMARK(BM_RandomRecordAccess)->Arg(0)->Arg(1);
+
+}  // namespace
+}  // namespace io
+}  // namespace tsl
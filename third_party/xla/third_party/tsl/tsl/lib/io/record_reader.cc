@@ -21,6 +21,7 @@ limitations under the License.
 #include "tsl/lib/io/buffered_inputstream.h"
 #include "tsl/lib/io/compression.h"
 #include "tsl/lib/io/random_inputstream.h"
+#include "tsl/lib/io/readahead_inputstream.h"
 #include "tsl/platform/env.h"
 #include "tsl/platform/errors.h"
 #include "tsl/platform/raw_coding.h"
@@ -46,6 +47,11 @@ RecordReaderOptions RecordReaderOptions::CreateRecordReaderOptions(
     options.zlib_options = io::ZlibCompressionOptions::GZIP();
   } else if (compression_type == compression::kSnappy) {
     options.compression_type = io::RecordReaderOptions::SNAPPY_COMPRESSION;
+#if !defined(IS_MOBILE_PLATFORM)
+  } else if (compression_type == compression::kZstd) {
+    options.compression_type = io::RecordReaderOptions::ZSTD_COMPRESSION;
+    options.zstd_options = io::ZstdCompressionOptions::DEFAULT();
+#endif  // IS_MOBILE_PLATFORM
   } else if (compression_type != compression::kNone) {
     LOG(ERROR) << "Unsupported compression_type:" << compression_type
                << ". No compression will be used.";
@@ -59,7 +65,14 @@ RecordReader::RecordReader(RandomAccessFile* file,
     : options_(options),
       input_stream_(new RandomAccessInputStream(file)),
       last_read_failed_(false) {
-  if (options.buffer_size > 0) {
+  if (options.readahead_depth > 0) {
+    auto* readahead_stream = new ReadaheadInputStream(
+        file, options.readahead_chunk_size, options.readahead_depth);
+    input_stream_.reset(readahead_stream);
+    if (options.compression_type == RecordReaderOptions::NONE) {
+      readahead_stream_ = readahead_stream;
+    }
+  } else if (options.buffer_size > 0) {
     input_stream_.reset(new BufferedInputStream(input_stream_.release(),
                                                 options.buffer_size, true));
   }
@@ -77,6 +90,13 @@ RecordReader::RecordReader(RandomAccessFile* file,
     input_stream_.reset(
         new SnappyInputStream(input_stream_.release(),
                               options.snappy_options.output_buffer_size, true));
+#if !defined(IS_MOBILE_PLATFORM)
+  } else if (options.compression_type ==
+             RecordReaderOptions::ZSTD_COMPRESSION) {
+    input_stream_.reset(new ZstdInputStream(
+        input_stream_.release(), options.zstd_options.input_buffer_size,
+        options.zstd_options.output_buffer_size, options.zstd_options, true));
+#endif  // IS_MOBILE_PLATFORM
   } else if (options.compression_type == RecordReaderOptions::NONE) {
     // Nothing to do.
   } else {
@@ -103,16 +123,36 @@ inline const char* GetChecksumErrorSuffix(uint64 offset) {
 // contain no explicit format marker.
 absl::Status RecordReader::ReadChecksummed(uint64 offset, size_t n,
                                            tstring* result) {
+  StringPiece view;
+  TF_RETURN_IF_ERROR(ReadChecksummedView(offset, n, &view, result));
+  if (view.data() == result->data()) {
+    result->resize(n);
+  } else {
+    result->assign(view.data(), view.size());
+  }
+  return absl::OkStatus();
+}
+
+absl::Status RecordReader::ReadChecksummedView(uint64 offset, size_t n,
+                                               StringPiece* result,
+                                               tstring* scratch) {
   if (n >= SIZE_MAX - sizeof(uint32)) {
     return errors::DataLoss("record size too large",
                             GetChecksumErrorSuffix(offset));
   }
 
   const size_t expected = n + sizeof(uint32);
-  TF_RETURN_IF_ERROR(input_stream_->ReadNBytes(expected, result));
+  StringPiece data;
+  if (readahead_stream_ != nullptr) {
+    TF_RETURN_IF_ERROR(
+        readahead_stream_->ReadNBytesView(expected, &data, scratch));
+  } else {
+    TF_RETURN_IF_ERROR(input_stream_->ReadNBytes(expected, scratch));
+    data = *scratch;
+  }
 
-  if (result->size() != expected) {
-    if (result->empty()) {
+  if (data.size() != expected) {
+    if (data.empty()) {
       return errors::OutOfRange("eof", GetChecksumErrorSuffix(offset));
     } else {
       return errors::DataLoss("truncated record at ", offset,
@@ -120,12 +160,12 @@ absl::Status RecordReader::ReadChecksummed(uint64 offset, size_t n,
     }
   }
 
-  const uint32 masked_crc = core::DecodeFixed32(result->data() + n);
-  if (crc32c::Unmask(masked_crc) != crc32c::Value(result->data(), n)) {
+  const uint32 masked_crc = core::DecodeFixed32(data.data() + n);
+  if (crc32c::Unmask(masked_crc) != crc32c::Value(data.data(), n)) {
     return errors::DataLoss("corrupted record at ", offset,
                             GetChecksumErrorSuffix(offset));
   }
-  result->resize(n);
+  *result = StringPiece(data.data(), n);
   return absl::OkStatus();
 }
 
@@ -224,6 +264,36 @@ absl::Status RecordReader::ReadRecord(uint64* offset, tstring* record) {
   return absl::OkStatus();
 }
 
+absl::Status RecordReader::ReadRecord(uint64* offset, StringPiece* record) {
+  TF_RETURN_IF_ERROR(PositionInputStream(*offset));
+
+  // Read header data.
+  StringPiece header;
+  absl::Status s =
+      ReadChecksummedView(*offset, sizeof(uint64), &header, &view_scratch_);
+  if (!s.ok()) {
+    last_read_failed_ = true;
+    return s;
+  }
+  const uint64 length = core::DecodeFixed64(header.data());
+
+  // Read data
+  s = ReadChecksummedView(*offset + kHeaderSize, length, record,
+                          &view_scratch_);
+  if (!s.ok()) {
+    last_read_failed_ = true;
+    if (errors::IsOutOfRange(s)) {
+      s = errors::DataLoss("truncated record at ", *offset, "' failed with ",
+                           s.message());
+    }
+    return s;
+  }
+
+  *offset += kHeaderSize + length + kFooterSize;
+  DCHECK_EQ(*offset, input_stream_->Tell());
+  return absl::OkStatus();
+}
+
 absl::Status RecordReader::SkipRecords(uint64* offset, int num_to_skip,
                                        int* num_skipped) {
   TF_RETURN_IF_ERROR(PositionInputStream(*offset));
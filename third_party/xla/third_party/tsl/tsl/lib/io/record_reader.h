@@ -17,6 +17,7 @@ limitations under the License.
 #define TENSORFLOW_TSL_LIB_IO_RECORD_READER_H_
 
 #include "tsl/lib/io/inputstream_interface.h"
+#include "tsl/lib/io/readahead_inputstream.h"
 #include "tsl/platform/errors.h"
 #include "tsl/platform/stringpiece.h"
 #if !defined(IS_SLIM_BUILD)
@@ -26,7 +27,12 @@ limitations under the License.
 #include "tsl/lib/io/zlib_inputstream.h"
 #endif  // IS_SLIM_BUILD
 #include "tsl/platform/macros.h"
+#include "tsl/platform/platform.h"
 #include "tsl/platform/types.h"
+#if !defined(IS_SLIM_BUILD) && !defined(IS_MOBILE_PLATFORM)
+#include "tsl/lib/io/zstd_compression_options.h"
+#include "tsl/lib/io/zstd_inputstream.h"
+#endif  // !IS_SLIM_BUILD && !IS_MOBILE_PLATFORM
 
 namespace tsl {
 class RandomAccessFile;
@@ -37,7 +43,8 @@ struct RecordReaderOptions {
   enum CompressionType {
     NONE = 0,
     ZLIB_COMPRESSION = 1,
-    SNAPPY_COMPRESSION = 2
+    SNAPPY_COMPRESSION = 2,
+    ZSTD_COMPRESSION = 3
   };
   CompressionType compression_type = NONE;
 
@@ -46,6 +53,14 @@ struct RecordReaderOptions {
   // compressed files.) Consider using SequentialRecordReader.
   int64_t buffer_size = 0;
 
+  // If readahead_depth is positive, the file is read by up to readahead_depth
+  // background reads of readahead_chunk_size bytes each, issued ahead of the
+  // consumer. This hides the per-read latency of remote filesystems and takes
+  // precedence over buffer_size. As with buffer_size, reads should be
+  // sequential: seeking outside of the chunks in flight restarts the pipeline.
+  int readahead_depth = 0;
+  int64_t readahead_chunk_size = 8 << 20;
+
   static RecordReaderOptions CreateRecordReaderOptions(
       const string& compression_type);
 
@@ -54,6 +69,9 @@ struct RecordReaderOptions {
   ZlibCompressionOptions zlib_options;
   SnappyCompressionOptions snappy_options;
 #endif  // IS_SLIM_BUILD
+#if !defined(IS_SLIM_BUILD) && !defined(IS_MOBILE_PLATFORM)
+  ZstdCompressionOptions zstd_options;
+#endif  // !IS_SLIM_BUILD && !IS_MOBILE_PLATFORM
 };
 
 // Low-level interface to read TFRecord files.
@@ -96,6 +114,11 @@ class RecordReader {
   // OUT_OF_RANGE for end of file, or something else for an error.
   absl::Status ReadRecord(uint64* offset, tstring* record);
 
+  // Same as ReadRecord, but sets "*record" to a view that is valid until the
+  // next call on this reader. With readahead and no compression the view
+  // usually points into the landed read buffer, saving a copy.
+  absl::Status ReadRecord(uint64* offset, StringPiece* record);
+
   // Skip num_to_skip record starting at "*offset" and update *offset
   // to point to the offset of the next num_to_skip + 1 record.
   // Return OK on success, OUT_OF_RANGE for end of file, or something
@@ -116,10 +139,18 @@ class RecordReader {
 
  private:
   absl::Status ReadChecksummed(uint64 offset, size_t n, tstring* result);
+  // Like ReadChecksummed, but `*result` may point into the readahead buffer
+  // instead of `*scratch`.
+  absl::Status ReadChecksummedView(uint64 offset, size_t n, StringPiece* result,
+                                   tstring* scratch);
   absl::Status PositionInputStream(uint64 offset);
 
   RecordReaderOptions options_;
   std::unique_ptr<InputStreamInterface> input_stream_;
+  // Set when `input_stream_` is a ReadaheadInputStream that can hand out
+  // views of uncompressed data. Not owned.
+  ReadaheadInputStream* readahead_stream_ = nullptr;
+  tstring view_scratch_;
   bool last_read_failed_;
 
   std::unique_ptr<Metadata> cached_metadata_;
@@ -147,6 +178,12 @@ class SequentialRecordReader {
     return underlying_.ReadRecord(&offset_, record);
   }
 
+  // Same as above, but sets "*record" to a view that is valid until the next
+  // call on this reader.
+  absl::Status ReadRecord(StringPiece* record) {
+    return underlying_.ReadRecord(&offset_, record);
+  }
+
   // Skip the next num_to_skip record in the file. Return OK on success,
   // OUT_OF_RANGE for end of file, or something else for an error.
   // "*num_skipped" records the number of records that are actually skipped.
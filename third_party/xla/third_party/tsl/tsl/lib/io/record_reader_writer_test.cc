@@ -30,6 +30,7 @@ limitations under the License.
 #include "tsl/platform/status.h"
 #include "tsl/platform/strcat.h"
 #include "tsl/platform/test.h"
+#include "tsl/platform/test_benchmark.h"
 
 namespace tsl {
 
@@ -45,6 +46,9 @@ io::RecordReaderOptions GetMatchingReaderOptions(
   if (options.compression_type == io::RecordWriterOptions::ZLIB_COMPRESSION) {
     return io::RecordReaderOptions::CreateRecordReaderOptions("ZLIB");
   }
+  if (options.compression_type == io::RecordWriterOptions::ZSTD_COMPRESSION) {
+    return io::RecordReaderOptions::CreateRecordReaderOptions("ZSTD");
+  }
   return io::RecordReaderOptions::CreateRecordReaderOptions("");
 }
 
@@ -121,6 +125,12 @@ TEST(RecordReaderWriterTest, TestZlibSyncFlush) {
   VerifyFlush(options);
 }
 
+TEST(RecordReaderWriterTest, TestZstdFlush) {
+  io::RecordWriterOptions options =
+      io::RecordWriterOptions::CreateRecordWriterOptions("ZSTD");
+  VerifyFlush(options);
+}
+
 TEST(RecordReaderWriterTest, TestBasics) {
   Env* env = Env::Default();
   string fname = testing::TmpDir() + "/record_reader_writer_test";
@@ -343,6 +353,49 @@ TEST(RecordReaderWriterTest, TestZlib) {
   }
 }
 
+TEST(RecordReaderWriterTest, TestZstd) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_zstd_test";
+
+  for (auto buf_size : BufferSizes()) {
+    for (int level : {-5, 3, 19}) {
+      {
+        std::unique_ptr<WritableFile> file;
+        TF_CHECK_OK(env->NewWritableFile(fname, &file));
+
+        io::RecordWriterOptions options;
+        options.compression_type = io::RecordWriterOptions::ZSTD_COMPRESSION;
+        options.zstd_options.compression_level = level;
+        options.zstd_options.input_buffer_size = buf_size;
+        options.zstd_options.output_buffer_size = buf_size;
+        io::RecordWriter writer(file.get(), options);
+        TF_EXPECT_OK(writer.WriteRecord("abc"));
+        TF_EXPECT_OK(writer.WriteRecord("defg"));
+        TF_CHECK_OK(writer.Close());
+      }
+
+      {
+        std::unique_ptr<RandomAccessFile> read_file;
+        // Read it back with the RecordReader.
+        TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+        io::RecordReaderOptions options;
+        options.compression_type = io::RecordReaderOptions::ZSTD_COMPRESSION;
+        options.zstd_options.input_buffer_size = buf_size;
+        options.zstd_options.output_buffer_size = buf_size;
+        io::RecordReader reader(read_file.get(), options);
+        uint64 offset = 0;
+        tstring record;
+        TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+        EXPECT_EQ("abc", record);
+        TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+        EXPECT_EQ("defg", record);
+        EXPECT_EQ(reader.ReadRecord(&offset, &record).code(),
+                  error::OUT_OF_RANGE);
+      }
+    }
+  }
+}
+
 TEST(RecordReaderWriterTest, TestUseAfterClose) {
   Env* env = Env::Default();
   string fname = testing::TmpDir() + "/record_reader_writer_flush_close_test";
@@ -366,4 +419,69 @@ TEST(RecordReaderWriterTest, TestUseAfterClose) {
   }
 }
 
+// Writes and reads back records of semi-structured text with each codec.
+// Throughput is reported against the uncompressed record bytes and the
+// compression ratio as a counter.
+//
+// Args: compression type, zstd level (only used for "ZSTD"), write (1) or
+// read (0).
+static const char* const kBenchmarkCompressionTypes[] = {"", "ZLIB", "GZIP",
+                                                         "SNAPPY", "ZSTD"};
+
+void BM_RecordCodec(::testing::benchmark::State& state) {
+  const string compression_type = kBenchmarkCompressionTypes[state.range(0)];
+  const bool write = state.range(2);
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_codec_benchmark";
+
+  std::vector<string> records;
+  int64_t record_bytes = 0;
+  for (int i = 0; i < 1024; ++i) {
+    records.push_back(strings::StrCat("{\"id\": ", i, ", \"label\": ", i % 10,
+                                      ", \"text\": \"example ", i % 97,
+                                      " of some repeated text\"}"));
+    record_bytes += records.back().size();
+  }
+
+  io::RecordWriterOptions writer_options =
+      io::RecordWriterOptions::CreateRecordWriterOptions(compression_type);
+  writer_options.zstd_options.compression_level = state.range(1);
+  auto write_records = [&]() {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get(), writer_options);
+    for (const string& record : records) {
+      TF_CHECK_OK(writer.WriteRecord(record));
+    }
+    TF_CHECK_OK(writer.Close());
+    TF_CHECK_OK(file->Close());
+  };
+
+  write_records();
+  const io::RecordReaderOptions reader_options =
+      io::RecordReaderOptions::CreateRecordReaderOptions(compression_type);
+  for (auto s : state) {
+    if (write) {
+      write_records();
+      continue;
+    }
+    std::unique_ptr<RandomAccessFile> read_file;
+    TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+    io::RecordReader reader(read_file.get(), reader_options);
+    uint64 offset = 0;
+    tstring record;
+    for (size_t i = 0; i < records.size(); ++i) {
+      TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * record_bytes);
+  state.counters["ratio"] =
+      static_cast<double>(record_bytes) / GetFileSize(fname);
+}
+
+BENCHMARK(BM_RecordCodec)
+    ->ArgNames({"codec", "level", "write"})
+    ->ArgsProduct({{0, 1, 2, 3}, {0}, {0, 1}})
+    ->ArgsProduct({{4}, {-5, 1, 3, 9}, {0, 1}});
+
 }  // namespace tsl
@@ -30,6 +30,10 @@ bool IsZlibCompressed(const RecordWriterOptions& options) {
 bool IsSnappyCompressed(const RecordWriterOptions& options) {
   return options.compression_type == RecordWriterOptions::SNAPPY_COMPRESSION;
 }
+
+bool IsZstdCompressed(const RecordWriterOptions& options) {
+  return options.compression_type == RecordWriterOptions::ZSTD_COMPRESSION;
+}
 }  // namespace
 
 RecordWriterOptions RecordWriterOptions::CreateRecordWriterOptions(
@@ -49,6 +53,11 @@ RecordWriterOptions RecordWriterOptions::CreateRecordWriterOptions(
     options.zlib_options = io::ZlibCompressionOptions::GZIP();
   } else if (compression_type == compression::kSnappy) {
     options.compression_type = io::RecordWriterOptions::SNAPPY_COMPRESSION;
+#if !defined(IS_MOBILE_PLATFORM)
+  } else if (compression_type == compression::kZstd) {
+    options.compression_type = io::RecordWriterOptions::ZSTD_COMPRESSION;
+    options.zstd_options = io::ZstdCompressionOptions::DEFAULT();
+#endif  // IS_MOBILE_PLATFORM
   } else if (compression_type != compression::kNone) {
     LOG(ERROR) << "Unsupported compression_type:" << compression_type
                << ". No compression will be used.";
@@ -79,6 +88,18 @@ RecordWriter::RecordWriter(WritableFile* dest,
     dest_ =
         new SnappyOutputBuffer(dest, options.snappy_options.input_buffer_size,
                                options.snappy_options.output_buffer_size);
+#if !defined(IS_MOBILE_PLATFORM)
+  } else if (IsZstdCompressed(options)) {
+    ZstdOutputBuffer* zstd_output_buffer = new ZstdOutputBuffer(
+        dest, options.zstd_options.input_buffer_size,
+        options.zstd_options.output_buffer_size, options.zstd_options);
+    absl::Status s = zstd_output_buffer->Init();
+    if (!s.ok()) {
+      LOG(FATAL) << "Failed to initialize Zstd outputbuffer. Error: "
+                 << s.ToString();
+    }
+    dest_ = zstd_output_buffer;
+#endif  // IS_MOBILE_PLATFORM
   } else if (options.compression_type == RecordWriterOptions::NONE) {
     // Nothing to do
   } else {
@@ -87,6 +108,12 @@ RecordWriter::RecordWriter(WritableFile* dest,
 #endif
 }
 
+RecordWriter::RecordWriter(WritableFile* dest, WritableFile* index_dest,
+                           const RecordWriterOptions& options)
+    : RecordWriter(dest, options) {
+  index_ = std::make_unique<RecordIndexWriter>(index_dest);
+}
+
 RecordWriter::~RecordWriter() {
   if (dest_ != nullptr) {
     absl::Status s = Close();
@@ -106,6 +133,7 @@ absl::Status RecordWriter::WriteRecord(StringPiece data) {
   //  uint32    masked crc of length
   //  byte      data[length]
   //  uint32    masked crc of data
+  TF_RETURN_IF_ERROR(AddIndexEntry(data.size()));
   char header[kHeaderSize];
   char footer[kFooterSize];
   PopulateHeader(header, data.data(), data.size());
@@ -126,6 +154,7 @@ absl::Status RecordWriter::WriteRecord(const absl::Cord& data) {
   //  uint32    masked crc of length
   //  byte      data[length]
   //  uint32    masked crc of data
+  TF_RETURN_IF_ERROR(AddIndexEntry(data.size()));
   char header[kHeaderSize];
   char footer[kFooterSize];
   PopulateHeader(header, data);
@@ -136,9 +165,23 @@ absl::Status RecordWriter::WriteRecord(const absl::Cord& data) {
 }
 #endif
 
+absl::Status RecordWriter::AddIndexEntry(size_t n) {
+  if (index_ == nullptr) return absl::OkStatus();
+  TF_RETURN_IF_ERROR(index_->Add(offset_));
+  offset_ += kHeaderSize + n + kFooterSize;
+  return absl::OkStatus();
+}
+
 absl::Status RecordWriter::Close() {
   if (dest_ == nullptr) return absl::OkStatus();
-  if (IsZlibCompressed(options_) || IsSnappyCompressed(options_)) {
+  // The index writer is kept so that a later WriteRecord() on an
+  // uncompressed writer, which keeps its destination, fails instead of
+  // leaving records out of the index.
+  if (index_ != nullptr && !index_->finished()) {
+    TF_RETURN_IF_ERROR(index_->Finish(offset_));
+  }
+  if (IsZlibCompressed(options_) || IsSnappyCompressed(options_) ||
+      IsZstdCompressed(options_)) {
     absl::Status s = dest_->Close();
     delete dest_;
     dest_ = nullptr;
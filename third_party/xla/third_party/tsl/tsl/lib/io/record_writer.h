@@ -16,7 +16,10 @@ limitations under the License.
 #ifndef TENSORFLOW_TSL_LIB_IO_RECORD_WRITER_H_
 #define TENSORFLOW_TSL_LIB_IO_RECORD_WRITER_H_
 
+#include <memory>
+
 #include "tsl/lib/hash/crc32c.h"
+#include "tsl/lib/io/record_index.h"
 #include "tsl/platform/coding.h"
 #include "tsl/platform/status.h"
 #include "tsl/platform/stringpiece.h"
@@ -28,7 +31,12 @@ limitations under the License.
 #endif  // IS_SLIM_BUILD
 #include "tsl/platform/cord.h"
 #include "tsl/platform/macros.h"
+#include "tsl/platform/platform.h"
 #include "tsl/platform/types.h"
+#if !defined(IS_SLIM_BUILD) && !defined(IS_MOBILE_PLATFORM)
+#include "tsl/lib/io/zstd_compression_options.h"
+#include "tsl/lib/io/zstd_outputbuffer.h"
+#endif  // !IS_SLIM_BUILD && !IS_MOBILE_PLATFORM
 
 namespace tsl {
 
@@ -41,7 +49,8 @@ struct RecordWriterOptions {
   enum CompressionType {
     NONE = 0,
     ZLIB_COMPRESSION = 1,
-    SNAPPY_COMPRESSION = 2
+    SNAPPY_COMPRESSION = 2,
+    ZSTD_COMPRESSION = 3
   };
   CompressionType compression_type = NONE;
 
@@ -53,6 +62,9 @@ struct RecordWriterOptions {
   io::ZlibCompressionOptions zlib_options;
   io::SnappyCompressionOptions snappy_options;
 #endif  // IS_SLIM_BUILD
+#if !defined(IS_SLIM_BUILD) && !defined(IS_MOBILE_PLATFORM)
+  io::ZstdCompressionOptions zstd_options;
+#endif  // !IS_SLIM_BUILD && !IS_MOBILE_PLATFORM
 };
 
 class RecordWriter {
@@ -71,6 +83,13 @@ class RecordWriter {
   explicit RecordWriter(WritableFile* dest, const RecordWriterOptions& options =
                                                 RecordWriterOptions());
 
+  // Same as above, but also writes a record index (see record_index.h) to
+  // "*index_dest", which is finished by Close(). Like "*dest", "*index_dest"
+  // must be initially empty, must remain live while this Writer is in use
+  // and is not closed by it.
+  RecordWriter(WritableFile* dest, WritableFile* index_dest,
+               const RecordWriterOptions& options = RecordWriterOptions());
+
   // Calls Close() and logs if an error occurs.
   //
   // TODO(jhseu): Require that callers explicitly call Close() and remove the
@@ -111,9 +130,17 @@ class RecordWriter {
 #endif
 
  private:
+  // Adds the index entry of the next record, of `n` bytes of data.
+  absl::Status AddIndexEntry(size_t n);
+
   WritableFile* dest_;
   RecordWriterOptions options_;
 
+  // Only set when writing an index.
+  std::unique_ptr<RecordIndexWriter> index_;
+  // Offset of the next record in the uncompressed record stream.
+  uint64 offset_ = 0;
+
   inline static uint32 MaskedCrc(const char* data, size_t n) {
     return crc32c::Mask(crc32c::Value(data, n));
   }
@@ -0,0 +1,251 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "tsl/lib/core/status_test_util.h"
+#include "tsl/lib/io/random_inputstream.h"
+#include "tsl/lib/io/zstd_compression_options.h"
+#include "tsl/lib/io/zstd_inputstream.h"
+#include "tsl/lib/io/zstd_outputbuffer.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/errors.h"
+#include "tsl/platform/strcat.h"
+#include "tsl/platform/test.h"
+
+namespace tsl {
+namespace io {
+namespace {
+
+std::vector<int> InputBufferSizes() { return {1, 10, 100, 1000, 10000}; }
+
+std::vector<int> OutputBufferSizes() { return {1, 100, 500, 1000}; }
+
+std::vector<int> NumCopies() { return {1, 50, 500}; }
+
+string GetRecord() {
+  static const string lorem_ipsum =
+      "Lorem ipsum dolor sit amet, consectetur adipiscing elit."
+      " Fusce vehicula tincidunt libero sit amet ultrices. Vestibulum non "
+      "felis augue. Duis vitae augue id lectus lacinia congue et ut purus. "
+      "Donec auctor, nisl at dapibus volutpat, diam ante lacinia dolor, vel"
+      "dignissim lacus nisi sed purus. Duis fringilla nunc ac lacus sagittis"
+      " efficitur. Praesent tincidunt egestas eros, eu vehicula urna ultrices"
+      " et. Aliquam erat volutpat. Maecenas vehicula risus consequat risus"
+      " dictum, luctus tincidunt nibh imperdiet. Aenean bibendum ac erat"
+      " cursus scelerisque. Cras lacinia in enim dapibus iaculis. Nunc porta"
+      " felis lectus, ac tincidunt massa pharetra quis. Fusce feugiat dolor"
+      " vel ligula rutrum egestas. Donec vulputate quam eros, et commodo"
+      " purus lobortis sed.";
+  return lorem_ipsum;
+}
+
+string GenTestString(int copies = 1) {
+  string result = "";
+  for (int i = 0; i < copies; i++) {
+    result += GetRecord();
+  }
+  return result;
+}
+
+// Compresses `data` into `fname` with the given buffer sizes and options.
+void WriteCompressed(const string& fname, const string& data,
+                     int input_buf_size, int output_buf_size,
+                     const ZstdCompressionOptions& options) {
+  Env* env = Env::Default();
+  std::unique_ptr<WritableFile> file_writer;
+  TF_ASSERT_OK(env->NewWritableFile(fname, &file_writer));
+  ZstdOutputBuffer out(file_writer.get(), input_buf_size, output_buf_size,
+                       options);
+  TF_ASSERT_OK(out.Init());
+  TF_ASSERT_OK(out.Append(StringPiece(data)));
+  TF_ASSERT_OK(out.Close());
+  TF_ASSERT_OK(file_writer->Flush());
+  TF_ASSERT_OK(file_writer->Close());
+}
+
+void TestAllCombinations(const ZstdCompressionOptions& input_options,
+                         const ZstdCompressionOptions& output_options) {
+  Env* env = Env::Default();
+  string fname;
+  ASSERT_TRUE(env->LocalTempFilename(&fname));
+  for (auto file_size : NumCopies()) {
+    string data = GenTestString(file_size);
+    for (auto input_buf_size : InputBufferSizes()) {
+      for (auto output_buf_size : OutputBufferSizes()) {
+        WriteCompressed(fname, data, input_buf_size, output_buf_size,
+                        output_options);
+
+        std::unique_ptr<RandomAccessFile> file_reader;
+        TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file_reader));
+        std::unique_ptr<RandomAccessInputStream> input_stream(
+            new RandomAccessInputStream(file_reader.get()));
+        ZstdInputStream in(input_stream.get(), input_buf_size, output_buf_size,
+                           input_options);
+        tstring result;
+        TF_ASSERT_OK(in.ReadNBytes(data.size(), &result));
+        EXPECT_EQ(result, data);
+        EXPECT_EQ(in.Tell(), data.size());
+        EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(1, &result)));
+      }
+    }
+  }
+}
+
+TEST(ZstdBuffers, DefaultOptions) {
+  TestAllCombinations(ZstdCompressionOptions::DEFAULT(),
+                      ZstdCompressionOptions::DEFAULT());
+}
+
+TEST(ZstdBuffers, Levels) {
+  for (int level : {-5, 1, 9, 19}) {
+    ZstdCompressionOptions options;
+    options.compression_level = level;
+    TestAllCombinations(ZstdCompressionOptions::DEFAULT(), options);
+  }
+}
+
+TEST(ZstdBuffers, Dictionary) {
+  ZstdCompressionOptions options;
+  options.dictionary = GetRecord();
+  TestAllCombinations(options, options);
+}
+
+TEST(ZstdBuffers, MultipleWritesWithFlush) {
+  Env* env = Env::Default();
+  string fname;
+  ASSERT_TRUE(env->LocalTempFilename(&fname));
+  string data = GenTestString();
+  string expected_result;
+
+  std::unique_ptr<WritableFile> file_writer;
+  TF_ASSERT_OK(env->NewWritableFile(fname, &file_writer));
+  ZstdOutputBuffer out(file_writer.get(), 200, 200,
+                       ZstdCompressionOptions::DEFAULT());
+  TF_ASSERT_OK(out.Init());
+  uint64 last_size = 0;
+  for (int i = 0; i < 10; i++) {
+    TF_ASSERT_OK(out.Append(StringPiece(data)));
+    TF_ASSERT_OK(out.Flush());
+    TF_ASSERT_OK(file_writer->Flush());
+    // Every flush must make the appended data visible in the file.
+    uint64 size;
+    TF_ASSERT_OK(env->GetFileSize(fname, &size));
+    EXPECT_GT(size, last_size);
+    last_size = size;
+    strings::StrAppend(&expected_result, data);
+  }
+  TF_ASSERT_OK(out.Close());
+  TF_ASSERT_OK(file_writer->Close());
+
+  std::unique_ptr<RandomAccessFile> file_reader;
+  TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file_reader));
+  std::unique_ptr<RandomAccessInputStream> input_stream(
+      new RandomAccessInputStream(file_reader.get()));
+  ZstdInputStream in(input_stream.get(), 200, 200,
+                     ZstdCompressionOptions::DEFAULT());
+  tstring result;
+  TF_ASSERT_OK(in.ReadNBytes(expected_result.size(), &result));
+  EXPECT_EQ(result, expected_result);
+}
+
+TEST(ZstdBuffers, AppendAfterClose) {
+  Env* env = Env::Default();
+  string fname;
+  ASSERT_TRUE(env->LocalTempFilename(&fname));
+  std::unique_ptr<WritableFile> file_writer;
+  TF_ASSERT_OK(env->NewWritableFile(fname, &file_writer));
+  ZstdOutputBuffer out(file_writer.get(), 200, 200,
+                       ZstdCompressionOptions::DEFAULT());
+  TF_ASSERT_OK(out.Init());
+  TF_ASSERT_OK(out.Append(StringPiece("abc")));
+  TF_ASSERT_OK(out.Close());
+  EXPECT_FALSE(out.Append(StringPiece("abc")).ok());
+  // Second call to close is fine.
+  TF_EXPECT_OK(out.Close());
+}
+
+TEST(ZstdInputStream, Reset) {
+  Env* env = Env::Default();
+  string fname;
+  ASSERT_TRUE(env->LocalTempFilename(&fname));
+  string data = GenTestString(10);
+  WriteCompressed(fname, data, 100, 100, ZstdCompressionOptions::DEFAULT());
+
+  std::unique_ptr<RandomAccessFile> file_reader;
+  TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file_reader));
+  std::unique_ptr<RandomAccessInputStream> input_stream(
+      new RandomAccessInputStream(file_reader.get()));
+  ZstdInputStream in(input_stream.get(), 100, 100,
+                     ZstdCompressionOptions::DEFAULT());
+  tstring first;
+  TF_ASSERT_OK(in.ReadNBytes(100, &first));
+  TF_ASSERT_OK(in.Reset());
+  EXPECT_EQ(in.Tell(), 0);
+  tstring result;
+  TF_ASSERT_OK(in.ReadNBytes(data.size(), &result));
+  EXPECT_EQ(result, data);
+}
+
+TEST(ZstdInputStream, FailsOnCorruptData) {
+  Env* env = Env::Default();
+  string fname;
+  ASSERT_TRUE(env->LocalTempFilename(&fname));
+  string data = GenTestString(10);
+  WriteCompressed(fname, data, 200, 200, ZstdCompressionOptions::DEFAULT());
+
+  string compressed;
+  TF_ASSERT_OK(ReadFileToString(env, fname, &compressed));
+  compressed[compressed.size() / 2] ^= 0x5a;
+  TF_ASSERT_OK(WriteStringToFile(env, fname, compressed));
+
+  std::unique_ptr<RandomAccessFile> file_reader;
+  TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file_reader));
+  std::unique_ptr<RandomAccessInputStream> input_stream(
+      new RandomAccessInputStream(file_reader.get()));
+  ZstdInputStream in(input_stream.get(), 200, 200,
+                     ZstdCompressionOptions::DEFAULT());
+  tstring result;
+  absl::Status read_status = in.ReadNBytes(data.size(), &result);
+  EXPECT_EQ(read_status.code(), error::DATA_LOSS);
+  EXPECT_TRUE(
+      absl::StrContains(read_status.message(), "ZSTD_decompressStream"));
+}
+
+TEST(ZstdInputStream, FailsWithoutDictionary) {
+  Env* env = Env::Default();
+  string fname;
+  ASSERT_TRUE(env->LocalTempFilename(&fname));
+  ZstdCompressionOptions output_options;
+  output_options.dictionary = GetRecord();
+  string data = GenTestString(10);
+  WriteCompressed(fname, data, 200, 200, output_options);
+
+  std::unique_ptr<RandomAccessFile> file_reader;
+  TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file_reader));
+  std::unique_ptr<RandomAccessInputStream> input_stream(
+      new RandomAccessInputStream(file_reader.get()));
+  ZstdInputStream in(input_stream.get(), 200, 200,
+                     ZstdCompressionOptions::DEFAULT());
+  tstring result;
+  EXPECT_EQ(in.ReadNBytes(data.size(), &result).code(), error::DATA_LOSS);
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace tsl
@@ -0,0 +1,65 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TSL_LIB_IO_ZSTD_COMPRESSION_OPTIONS_H_
+#define TENSORFLOW_TSL_LIB_IO_ZSTD_COMPRESSION_OPTIONS_H_
+
+#include <string>
+
+#include "tsl/platform/types.h"
+
+namespace tsl {
+namespace io {
+
+class ZstdCompressionOptions {
+ public:
+  static ZstdCompressionOptions DEFAULT() { return ZstdCompressionOptions(); }
+
+  // Size of the buffer used for caching the data read from source file.
+  int64_t input_buffer_size = 256 << 10;
+
+  // Size of the sink buffer where the compressed/decompressed data produced by
+  // zstd is cached.
+  int64_t output_buffer_size = 256 << 10;
+
+  // From the zstd manual (http://facebook.github.io/zstd/zstd_manual.html):
+  // Compression levels range from 1 to ZSTD_maxCLevel() (currently 22), with
+  // higher levels trading speed for ratio. Negative levels, down to
+  // ZSTD_minCLevel(), select the "fast" strategies, which get close to LZ4
+  // in speed. 0 selects the library default (currently 3).
+  //
+  // The level only affects compression; any level can be decompressed with
+  // the same (fast) decoder.
+  int compression_level = 3;
+
+  // The base two logarithm of the maximum back-reference distance. Larger
+  // windows improve the ratio on large, repetitive inputs at the expense of
+  // memory on both sides. 0 uses the default of the compression level.
+  //
+  // Windows larger than 2^27 must also be set on the reading side, which
+  // otherwise rejects them to bound its memory usage.
+  int window_log = 0;
+
+  // Raw content or trained (`zstd --train`) dictionary. Dictionaries help
+  // most when compressing many small records that share structure, such as
+  // serialized tf.train.Examples. Readers must be given the same dictionary
+  // as the writer. Empty means no dictionary.
+  std::string dictionary;
+};
+
+}  // namespace io
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_LIB_IO_ZSTD_COMPRESSION_OPTIONS_H_
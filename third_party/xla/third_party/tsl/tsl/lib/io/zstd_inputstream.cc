@@ -0,0 +1,168 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tsl/lib/io/zstd_inputstream.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "zstd.h"
+#include "tsl/platform/errors.h"
+#include "tsl/platform/logging.h"
+
+namespace tsl {
+namespace io {
+
+ZstdInputStream::ZstdInputStream(InputStreamInterface* input_stream,
+                                 size_t input_buffer_bytes,
+                                 size_t output_buffer_bytes,
+                                 const ZstdCompressionOptions& zstd_options,
+                                 bool owns_input_stream)
+    : owns_input_stream_(owns_input_stream),
+      input_stream_(input_stream),
+      input_buffer_capacity_(input_buffer_bytes),
+      output_buffer_capacity_(output_buffer_bytes),
+      input_buffer_(new char[input_buffer_bytes]),
+      output_buffer_(new char[output_buffer_bytes]),
+      zstd_options_(zstd_options) {
+  init_status_ = Init();
+}
+
+ZstdInputStream::~ZstdInputStream() {
+  ZSTD_freeDCtx(dctx_);
+  if (owns_input_stream_) {
+    delete input_stream_;
+  }
+}
+
+absl::Status ZstdInputStream::Init() {
+  if (input_buffer_capacity_ == 0 || output_buffer_capacity_ == 0) {
+    return errors::InvalidArgument("zstd buffer sizes should be positive");
+  }
+  dctx_ = ZSTD_createDCtx();
+  if (dctx_ == nullptr) {
+    return errors::ResourceExhausted("Failed to create a zstd context");
+  }
+  if (zstd_options_.window_log > 0) {
+    const size_t result = ZSTD_DCtx_setParameter(
+        dctx_, ZSTD_d_windowLogMax, zstd_options_.window_log);
+    if (ZSTD_isError(result)) {
+      return errors::InvalidArgument("Failed to set zstd window log: ",
+                                     ZSTD_getErrorName(result));
+    }
+  }
+  if (!zstd_options_.dictionary.empty()) {
+    const size_t result =
+        ZSTD_DCtx_loadDictionary(dctx_, zstd_options_.dictionary.data(),
+                                 zstd_options_.dictionary.size());
+    if (ZSTD_isError(result)) {
+      return errors::InvalidArgument("Failed to load zstd dictionary: ",
+                                     ZSTD_getErrorName(result));
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ZstdInputStream::Reset() {
+  TF_RETURN_IF_ERROR(init_status_);
+  TF_RETURN_IF_ERROR(input_stream_->Reset());
+  // Keeps the dictionary and parameters.
+  ZSTD_DCtx_reset(dctx_, ZSTD_reset_session_only);
+  input_pos_ = input_size_ = 0;
+  output_pos_ = output_size_ = 0;
+  output_pending_ = false;
+  bytes_read_ = 0;
+  return absl::OkStatus();
+}
+
+absl::Status ZstdInputStream::ReadFromStream() {
+  DCHECK_EQ(input_pos_, input_size_);
+  tstring data;
+  absl::Status s = input_stream_->ReadNBytes(input_buffer_capacity_, &data);
+  memcpy(input_buffer_.get(), data.data(), data.size());
+  input_pos_ = 0;
+  input_size_ = data.size();
+  if (!s.ok() && !errors::IsOutOfRange(s)) {
+    return s;
+  }
+  // We throw OutOfRange error iff no new data has been read from stream.
+  if (data.empty()) {
+    return errors::OutOfRange("EOF reached");
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ZstdInputStream::Decompress() {
+  DCHECK_EQ(output_pos_, output_size_);
+  ZSTD_inBuffer input = {input_buffer_.get(), input_size_, input_pos_};
+  ZSTD_outBuffer output = {output_buffer_.get(), output_buffer_capacity_, 0};
+  const size_t result = ZSTD_decompressStream(dctx_, &output, &input);
+  if (ZSTD_isError(result)) {
+    return errors::DataLoss("ZSTD_decompressStream() failed: ",
+                            ZSTD_getErrorName(result));
+  }
+  input_pos_ = input.pos;
+  output_pos_ = 0;
+  output_size_ = output.pos;
+  output_pending_ = output.pos == output.size;
+  return absl::OkStatus();
+}
+
+size_t ZstdInputStream::ReadBytesFromCache(size_t bytes_to_read,
+                                           tstring* result) {
+  const size_t can_read_bytes =
+      std::min(bytes_to_read, output_size_ - output_pos_);
+  if (can_read_bytes > 0) {
+    result->append(output_buffer_.get() + output_pos_, can_read_bytes);
+    output_pos_ += can_read_bytes;
+  }
+  bytes_read_ += can_read_bytes;
+  return can_read_bytes;
+}
+
+absl::Status ZstdInputStream::ReadNBytes(int64_t bytes_to_read,
+                                         tstring* result) {
+  TF_RETURN_IF_ERROR(init_status_);
+  result->clear();
+  // Read as many bytes as possible from cache.
+  bytes_to_read -= ReadBytesFromCache(bytes_to_read, result);
+
+  while (bytes_to_read > 0) {
+    // At this point the cache is empty. Only ask for more compressed data
+    // once zstd has flushed everything it could produce from the last input.
+    if (input_pos_ == input_size_ && !output_pending_) {
+      TF_RETURN_IF_ERROR(ReadFromStream());
+    }
+    TF_RETURN_IF_ERROR(Decompress());
+    bytes_to_read -= ReadBytesFromCache(bytes_to_read, result);
+  }
+  return absl::OkStatus();
+}
+
+#if defined(TF_CORD_SUPPORT)
+absl::Status ZstdInputStream::ReadNBytes(int64_t bytes_to_read,
+                                         absl::Cord* result) {
+  tstring buf;
+  TF_RETURN_IF_ERROR(ReadNBytes(bytes_to_read, &buf));
+  result->Clear();
+  result->Append(absl::string_view(buf));
+  return absl::OkStatus();
+}
+#endif
+
+int64_t ZstdInputStream::Tell() const { return bytes_read_; }
+
+}  // namespace io
+}  // namespace tsl
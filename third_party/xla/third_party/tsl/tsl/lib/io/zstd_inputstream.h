@@ -0,0 +1,129 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TSL_LIB_IO_ZSTD_INPUTSTREAM_H_
+#define TENSORFLOW_TSL_LIB_IO_ZSTD_INPUTSTREAM_H_
+
+#include <memory>
+#include <string>
+
+#include "tsl/lib/io/inputstream_interface.h"
+#include "tsl/lib/io/zstd_compression_options.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/macros.h"
+#include "tsl/platform/status.h"
+#include "tsl/platform/types.h"
+
+// Forward declare the decompression context of zstd.h, which is only
+// included in the .cc file.
+struct ZSTD_DCtx_s;
+
+namespace tsl {
+namespace io {
+
+// An ZstdInputStream provides support for reading from a stream compressed
+// using zstd (https://facebook.github.io/zstd/), such as one written by
+// ZstdOutputBuffer. Concatenated zstd frames are read as a single stream.
+// Buffers the contents of the file.
+//
+// A given instance of an ZstdInputStream is NOT safe for concurrent use
+// by multiple threads
+class ZstdInputStream : public InputStreamInterface {
+ public:
+  // Create a ZstdInputStream for `input_stream` with a buffer of size
+  // `input_buffer_bytes` bytes for reading contents from `input_stream` and
+  // another buffer with size `output_buffer_bytes` for caching decompressed
+  // contents.
+  //
+  // Takes ownership of `input_stream` iff `owns_input_stream` is true.
+  ZstdInputStream(InputStreamInterface* input_stream, size_t input_buffer_bytes,
+                  size_t output_buffer_bytes,
+                  const ZstdCompressionOptions& zstd_options,
+                  bool owns_input_stream = false);
+
+  ~ZstdInputStream() override;
+
+  // Reads bytes_to_read bytes into *result, overwriting *result.
+  //
+  // Return Status codes:
+  // OK:           If successful.
+  // OUT_OF_RANGE: If there are not enough bytes to read before
+  //               the end of the stream.
+  // DATA_LOSS:    If the stream is not valid zstd data, or its checksum does
+  //               not match.
+  // others:       If reading from stream failed.
+  absl::Status ReadNBytes(int64_t bytes_to_read, tstring* result) override;
+
+#if defined(TF_CORD_SUPPORT)
+  absl::Status ReadNBytes(int64_t bytes_to_read, absl::Cord* result) override;
+#endif
+
+  int64_t Tell() const override;
+
+  absl::Status Reset() override;
+
+ private:
+  // Creates `dctx_` and applies `zstd_options_` to it.
+  absl::Status Init();
+
+  // Refills `input_buffer_` from `input_stream_`. Returns OutOfRange if NO
+  // data could be read from the stream.
+  // REQUIRES: all of `input_buffer_` has been consumed.
+  absl::Status ReadFromStream();
+
+  // Decompresses as much buffered input as fits into `output_buffer_`.
+  // REQUIRES: all of `output_buffer_` has been consumed.
+  absl::Status Decompress();
+
+  // Appends up to `bytes_to_read` decompressed bytes to `result` and returns
+  // the number of bytes appended.
+  size_t ReadBytesFromCache(size_t bytes_to_read, tstring* result);
+
+  const bool owns_input_stream_;
+  InputStreamInterface* input_stream_;
+  const size_t input_buffer_capacity_;
+  const size_t output_buffer_capacity_;
+
+  // Compressed bytes read from `input_stream_`. Bytes in
+  // [input_pos_, input_size_) have not been handed to zstd yet.
+  std::unique_ptr<char[]> input_buffer_;
+  size_t input_pos_ = 0;
+  size_t input_size_ = 0;
+
+  // Decompressed bytes. Bytes in [output_pos_, output_size_) have not been
+  // returned to the caller yet.
+  std::unique_ptr<char[]> output_buffer_;
+  size_t output_pos_ = 0;
+  size_t output_size_ = 0;
+
+  // Whether the last call to zstd filled `output_buffer_`, in which case zstd
+  // may hold more decompressed data without needing more input.
+  bool output_pending_ = false;
+
+  ZstdCompressionOptions const zstd_options_;
+  ZSTD_DCtx_s* dctx_ = nullptr;
+  absl::Status init_status_;
+
+  // Number of *uncompressed* bytes that have been read from this stream.
+  int64_t bytes_read_ = 0;
+
+  ZstdInputStream(const ZstdInputStream&) = delete;
+  void operator=(const ZstdInputStream&) = delete;
+};
+
+}  // namespace io
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_LIB_IO_ZSTD_INPUTSTREAM_H_
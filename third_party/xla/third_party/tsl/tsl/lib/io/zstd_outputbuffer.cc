@@ -0,0 +1,170 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tsl/lib/io/zstd_outputbuffer.h"
+
+#include <cstring>
+
+#include "zstd.h"
+#include "tsl/platform/errors.h"
+#include "tsl/platform/logging.h"
+
+namespace tsl {
+namespace io {
+
+ZstdOutputBuffer::ZstdOutputBuffer(WritableFile* file,
+                                   int32_t input_buffer_bytes,
+                                   int32_t output_buffer_bytes,
+                                   const ZstdCompressionOptions& zstd_options)
+    : file_(file),
+      input_buffer_capacity_(input_buffer_bytes),
+      output_buffer_capacity_(output_buffer_bytes),
+      input_buffer_(new char[input_buffer_bytes]),
+      output_buffer_(new char[output_buffer_bytes]),
+      zstd_options_(zstd_options) {}
+
+ZstdOutputBuffer::~ZstdOutputBuffer() {
+  if (cctx_ != nullptr) {
+    LOG(WARNING) << "ZstdOutputBuffer::Close() not called. Possible data loss";
+    ZSTD_freeCCtx(cctx_);
+  }
+}
+
+absl::Status ZstdOutputBuffer::Init() {
+  if (output_buffer_capacity_ == 0) {
+    return errors::InvalidArgument("output_buffer_bytes should be positive");
+  }
+  cctx_ = ZSTD_createCCtx();
+  if (cctx_ == nullptr) {
+    return errors::ResourceExhausted("Failed to create a zstd context");
+  }
+  auto check = [this](size_t result, const char* what) -> absl::Status {
+    if (!ZSTD_isError(result)) return absl::OkStatus();
+    ZSTD_freeCCtx(cctx_);
+    cctx_ = nullptr;
+    return errors::InvalidArgument("Failed to set zstd ", what, ": ",
+                                   ZSTD_getErrorName(result));
+  };
+  TF_RETURN_IF_ERROR(check(
+      ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel,
+                             zstd_options_.compression_level),
+      "compression level"));
+  TF_RETURN_IF_ERROR(check(
+      ZSTD_CCtx_setParameter(cctx_, ZSTD_c_windowLog, zstd_options_.window_log),
+      "window log"));
+  TF_RETURN_IF_ERROR(check(
+      ZSTD_CCtx_setParameter(cctx_, ZSTD_c_checksumFlag, 1), "checksum flag"));
+  if (!zstd_options_.dictionary.empty()) {
+    TF_RETURN_IF_ERROR(
+        check(ZSTD_CCtx_loadDictionary(cctx_, zstd_options_.dictionary.data(),
+                                       zstd_options_.dictionary.size()),
+              "dictionary"));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ZstdOutputBuffer::Compress(StringPiece data, int mode) {
+  if (cctx_ == nullptr) {
+    return errors::FailedPrecondition(
+        "ZstdOutputBuffer is not initialized or already closed");
+  }
+  const auto directive = static_cast<ZSTD_EndDirective>(mode);
+  ZSTD_inBuffer input = {data.data(), data.size(), 0};
+  bool done;
+  do {
+    ZSTD_outBuffer output = {output_buffer_.get(), output_buffer_capacity_, 0};
+    const size_t remaining =
+        ZSTD_compressStream2(cctx_, &output, &input, directive);
+    if (ZSTD_isError(remaining)) {
+      return errors::DataLoss("ZSTD_compressStream2() failed: ",
+                              ZSTD_getErrorName(remaining));
+    }
+    if (output.pos > 0) {
+      TF_RETURN_IF_ERROR(
+          file_->Append(StringPiece(output_buffer_.get(), output.pos)));
+    }
+    // With ZSTD_e_continue zstd may keep output buffered internally until
+    // later calls; the other directives report how much is left to flush.
+    done = directive == ZSTD_e_continue ? input.pos == input.size
+                                        : remaining == 0;
+  } while (!done);
+  return absl::OkStatus();
+}
+
+absl::Status ZstdOutputBuffer::CompressBuffered(int mode) {
+  TF_RETURN_IF_ERROR(
+      Compress(StringPiece(input_buffer_.get(), input_buffer_size_), mode));
+  input_buffer_size_ = 0;
+  return absl::OkStatus();
+}
+
+absl::Status ZstdOutputBuffer::Append(StringPiece data) {
+  if (cctx_ == nullptr) {
+    return errors::FailedPrecondition(
+        "ZstdOutputBuffer is not initialized or already closed");
+  }
+  if (data.size() <= input_buffer_capacity_ - input_buffer_size_) {
+    memcpy(input_buffer_.get() + input_buffer_size_, data.data(), data.size());
+    input_buffer_size_ += data.size();
+    return absl::OkStatus();
+  }
+  TF_RETURN_IF_ERROR(CompressBuffered(ZSTD_e_continue));
+  if (data.size() <= input_buffer_capacity_) {
+    memcpy(input_buffer_.get(), data.data(), data.size());
+    input_buffer_size_ = data.size();
+    return absl::OkStatus();
+  }
+  // `data` is too large to fit in the input buffer so we compress it directly.
+  return Compress(data, ZSTD_e_continue);
+}
+
+#if defined(TF_CORD_SUPPORT)
+absl::Status ZstdOutputBuffer::Append(const absl::Cord& cord) {
+  for (absl::string_view fragment : cord.Chunks()) {
+    TF_RETURN_IF_ERROR(Append(fragment));
+  }
+  return absl::OkStatus();
+}
+#endif
+
+absl::Status ZstdOutputBuffer::Flush() {
+  TF_RETURN_IF_ERROR(CompressBuffered(ZSTD_e_flush));
+  return file_->Flush();
+}
+
+absl::Status ZstdOutputBuffer::Name(StringPiece* result) const {
+  return file_->Name(result);
+}
+
+absl::Status ZstdOutputBuffer::Sync() {
+  TF_RETURN_IF_ERROR(Flush());
+  return file_->Sync();
+}
+
+absl::Status ZstdOutputBuffer::Close() {
+  if (cctx_ != nullptr) {
+    TF_RETURN_IF_ERROR(CompressBuffered(ZSTD_e_end));
+    ZSTD_freeCCtx(cctx_);
+    cctx_ = nullptr;
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ZstdOutputBuffer::Tell(int64_t* position) {
+  return file_->Tell(position);
+}
+
+}  // namespace io
+}  // namespace tsl
@@ -0,0 +1,127 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TSL_LIB_IO_ZSTD_OUTPUTBUFFER_H_
+#define TENSORFLOW_TSL_LIB_IO_ZSTD_OUTPUTBUFFER_H_
+
+#include <memory>
+#include <string>
+
+#include "tsl/lib/io/zstd_compression_options.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/file_system.h"
+#include "tsl/platform/macros.h"
+#include "tsl/platform/status.h"
+#include "tsl/platform/stringpiece.h"
+#include "tsl/platform/types.h"
+
+// Forward declare the compression context of zstd.h, which is only included
+// in the .cc file.
+struct ZSTD_CCtx_s;
+
+namespace tsl {
+namespace io {
+
+// Provides support for writing compressed output to file using zstd
+// (https://facebook.github.io/zstd/). The output is a single zstd frame with a
+// content checksum, readable by ZstdInputStream and the `zstd` command line
+// tool.
+//
+// A given instance of an ZstdOutputBuffer is NOT safe for concurrent use
+// by multiple threads
+class ZstdOutputBuffer : public WritableFile {
+ public:
+  // Create an ZstdOutputBuffer for `file` with two buffers that cache the
+  // 1. input data to be compressed
+  // 2. the compressed output
+  // with sizes `input_buffer_bytes` and `output_buffer_bytes` respectively.
+  // Does not take ownership of `file`.
+  ZstdOutputBuffer(WritableFile* file, int32_t input_buffer_bytes,
+                   int32_t output_buffer_bytes,
+                   const ZstdCompressionOptions& zstd_options);
+
+  ~ZstdOutputBuffer() override;
+
+  // Initializes the compression context. This call is required before any
+  // other operation on the buffer.
+  absl::Status Init();
+
+  // Adds `data` to the compression pipeline.
+  //
+  // The input data is buffered in `input_buffer_` and is compressed in bulk
+  // when the buffer gets full. Inputs larger than the buffer are compressed
+  // directly.
+  //
+  // To immediately write contents to file call `Flush()`.
+  absl::Status Append(StringPiece data) override;
+
+#if defined(TF_CORD_SUPPORT)
+  absl::Status Append(const absl::Cord& cord) override;
+#endif
+
+  // Compresses any cached input, ends the current zstd block and writes all
+  // output to file.
+  absl::Status Flush() override;
+
+  // Compresses any cached input, ends the zstd frame and writes all output to
+  // file. This must be called before the destructor to avoid any data loss.
+  //
+  // After calling this, any further calls to `Append()` or `Flush()` will
+  // fail.
+  absl::Status Close() override;
+
+  // Returns the name of the underlying file.
+  absl::Status Name(StringPiece* result) const override;
+
+  // Compresses any cached input, writes all output to file and syncs it.
+  absl::Status Sync() override;
+
+  // Returns the write position in the underlying file. The position does not
+  // reflect buffered, un-flushed data.
+  absl::Status Tell(int64_t* position) override;
+
+ private:
+  // Compresses `data` with the zstd end directive `mode` and appends the
+  // produced output to `file_`. Returns once all of `data` is consumed and,
+  // unless `mode` is ZSTD_e_continue, all of its output is written.
+  absl::Status Compress(StringPiece data, int mode);
+
+  // Compresses the contents of `input_buffer_` with `mode`.
+  absl::Status CompressBuffered(int mode);
+
+  WritableFile* file_;  // Not owned
+  const size_t input_buffer_capacity_;
+  const size_t output_buffer_capacity_;
+
+  // Buffer for data that has not been handed to zstd yet.
+  std::unique_ptr<char[]> input_buffer_;
+  size_t input_buffer_size_ = 0;
+
+  // Buffer for compressed data that is written to `file_`.
+  std::unique_ptr<char[]> output_buffer_;
+
+  ZstdCompressionOptions const zstd_options_;
+
+  // Null before `Init()` and after `Close()`.
+  ZSTD_CCtx_s* cctx_ = nullptr;
+
+  ZstdOutputBuffer(const ZstdOutputBuffer&) = delete;
+  void operator=(const ZstdOutputBuffer&) = delete;
+};
+
+}  // namespace io
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_LIB_IO_ZSTD_OUTPUTBUFFER_H_